@@ -49,8 +49,13 @@ namespace DXBC2GLSL
 	class DXBC2GLSL
 	{
 	public:
+		DXBC2GLSL();
+
 		static uint32_t DefaultRules(GLSLVersion version);
 
+		// The IR is optimized before emitting GLSL by default
+		void Optimize(bool optimize);
+
 		void FeedDXBC(void const * dxbc_data,
 			bool has_gs, bool has_ps, ShaderTessellatorPartitioning ds_partitioning, ShaderTessellatorOutputPrimitive ds_output_primitive,
 			GLSLVersion version);
@@ -59,6 +64,7 @@ namespace DXBC2GLSL
 			GLSLVersion version, uint32_t glsl_rules);
 
 		std::string const & GLSLString() const;
+		uint32_t NumInstructions() const;
 
 		uint32_t NumInputParams() const;
 		DXBCSignatureParamDesc const & InputParam(uint32_t index) const;
@@ -91,6 +97,7 @@ namespace DXBC2GLSL
 		std::shared_ptr<DXBCContainer> dxbc_;
 		std::shared_ptr<ShaderProgram> shader_;
 		std::string glsl_;
+		bool optimize_;
 	};
 }
 
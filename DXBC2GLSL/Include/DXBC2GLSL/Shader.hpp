@@ -366,6 +366,81 @@ struct LabelInfo
 	uint32_t end_num; // the last insn in label etc. ret
 };
 
+// Bump allocator for the IR nodes of one ShaderProgram. Nodes are never freed one by one, the blocks go away
+// together with the last node that references the arena.
+class ShaderArena
+{
+public:
+	ShaderArena()
+		: block_used_(0)
+	{
+	}
+	ShaderArena(ShaderArena const & rhs) = delete;
+	ShaderArena& operator=(ShaderArena const & rhs) = delete;
+
+	void* Allocate(size_t size, size_t alignment)
+	{
+		size_t offset = (block_used_ + alignment - 1) & ~(alignment - 1);
+		if (blocks_.empty() || (offset + size > BLOCK_SIZE))
+		{
+			blocks_.push_back(KlayGE::MakeUniquePtr<uint8_t[]>(size > BLOCK_SIZE ? size : BLOCK_SIZE));
+			offset = 0;
+		}
+		block_used_ = offset + size;
+		return blocks_.back().get() + offset;
+	}
+
+private:
+	static size_t constexpr BLOCK_SIZE = 64 * 1024;
+
+	std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+	size_t block_used_;
+};
+
+template <typename T>
+class ShaderArenaAllocator
+{
+	template <typename U>
+	friend class ShaderArenaAllocator;
+
+public:
+	typedef T value_type;
+
+	explicit ShaderArenaAllocator(std::shared_ptr<ShaderArena> const & arena) noexcept
+		: arena_(arena)
+	{
+	}
+	template <typename U>
+	ShaderArenaAllocator(ShaderArenaAllocator<U> const & rhs) noexcept
+		: arena_(rhs.arena_)
+	{
+	}
+
+	T* allocate(size_t n)
+	{
+		return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+	}
+	void deallocate(T* p, size_t n) noexcept
+	{
+		KFL_UNUSED(p);
+		KFL_UNUSED(n);
+	}
+
+	template <typename U>
+	bool operator==(ShaderArenaAllocator<U> const & rhs) const noexcept
+	{
+		return arena_ == rhs.arena_;
+	}
+	template <typename U>
+	bool operator!=(ShaderArenaAllocator<U> const & rhs) const noexcept
+	{
+		return arena_ != rhs.arena_;
+	}
+
+private:
+	std::shared_ptr<ShaderArena> arena_;
+};
+
 struct ShaderProgram
 {
 	TokenizedShaderVersion version;//program version
@@ -391,18 +466,29 @@ struct ShaderProgram
 	//cs stuff
 	uint32_t cs_thread_group_size[3];
 
+	std::shared_ptr<ShaderArena> arena;//owns the dcls, insns and their operands
+
 	ShaderProgram()
 		: gs_input_primitive(SP_Undefined), max_gs_output_vertex(0),
 			gs_instance_count(0), hs_input_control_point_count(0),
 			hs_output_control_point_count(0), ds_tessellator_domain(SDT_Undefined),
-			ds_tessellator_partitioning(STP_Undefined), ds_tessellator_output_primitive(STOP_Undefined)
+			ds_tessellator_partitioning(STP_Undefined), ds_tessellator_output_primitive(STOP_Undefined),
+			arena(KlayGE::MakeSharedPtr<ShaderArena>())
 	{
 		memset(&version, 0, sizeof(version));
 		memset(cs_thread_group_size, 0, sizeof(cs_thread_group_size));
 	}
+
+	template <typename T>
+	std::shared_ptr<T> MakeNode()
+	{
+		return std::allocate_shared<T>(ShaderArenaAllocator<T>(arena));
+	}
 };
 
 std::shared_ptr<ShaderProgram> ShaderParse(DXBCContainer const & dxbc);
+// Copy propagation, swizzle folding, constant folding and dead code elimination on the IR
+void ShaderOptimize(ShaderProgram& program);
 
 // Return the opcode's input type
 inline ShaderImmType GetOpInType(uint32_t opcode)
@@ -34,13 +34,31 @@
 #include <DXBC2GLSL/GLSLGen.hpp>
 #include <sstream>
 
+namespace
+{
+	// Rough size of the GLSL, to reserve the output string up front
+	size_t const GLSL_HEADER_SIZE = 2048;
+	size_t const GLSL_SIZE_PER_DCL = 48;
+	size_t const GLSL_SIZE_PER_INSN = 64;
+}
+
 namespace DXBC2GLSL
 {
+	DXBC2GLSL::DXBC2GLSL()
+		: optimize_(true)
+	{
+	}
+
 	uint32_t DXBC2GLSL::DefaultRules(GLSLVersion version)
 	{
 		return GLSLGen::DefaultRules(version);
 	}
 
+	void DXBC2GLSL::Optimize(bool optimize)
+	{
+		optimize_ = optimize;
+	}
+
 	void DXBC2GLSL::FeedDXBC(void const * dxbc_data,
 			bool has_gs, bool has_ps, ShaderTessellatorPartitioning ds_partitioning, ShaderTessellatorOutputPrimitive ds_output_primitive,
 			GLSLVersion version)
@@ -58,7 +76,14 @@ namespace DXBC2GLSL
 			if (dxbc_->shader_chunk)
 			{
 				shader_ = ShaderParse(*dxbc_);
-
+				if (optimize_)
+				{
+					ShaderOptimize(*shader_);
+				}
+
+				glsl_.clear();
+				glsl_.reserve(GLSL_HEADER_SIZE + shader_->dcls.size() * GLSL_SIZE_PER_DCL
+					+ shader_->insns.size() * GLSL_SIZE_PER_INSN);
 				KlayGE::StringOutputStreamBuf glsl_buff(glsl_);
 				std::ostream ss(&glsl_buff);
 
@@ -74,6 +99,11 @@ namespace DXBC2GLSL
 		return glsl_;
 	}
 
+	uint32_t DXBC2GLSL::NumInstructions() const
+	{
+		return static_cast<uint32_t>(shader_->insns.size());
+	}
+
 	uint32_t DXBC2GLSL::NumInputParams() const
 	{
 		return static_cast<uint32_t>(shader_->params_in.size());
@@ -0,0 +1,858 @@
+/**
+ * @file ShaderOptimize.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <DXBC2GLSL/Shader.hpp>
+#include <DXBC2GLSL/Utils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// The passes only look at temp registers. An instruction is either
+//   pure: one temp or output written component by component through a mask, every other operand is a source,
+//   a boundary: flow control, the values of temps are not tracked across it,
+//   opaque: anything else. All its temp operands are treated as read and written.
+// GLSLGen derives the GLSL type of a temp from the instructions writing it, so the rewrites below are restricted
+// to the cases where the translated code computes the same bits as before.
+
+namespace
+{
+	uint32_t const MAX_ROUNDS = 4;
+
+	enum InsnClass
+	{
+		IC_Pure,
+		IC_Opaque,
+		IC_Boundary
+	};
+
+	InsnClass ClassifyInsn(ShaderInstruction const & insn)
+	{
+		switch (insn.opcode)
+		{
+		case SO_BREAK:
+		case SO_BREAKC:
+		case SO_CALL:
+		case SO_CALLC:
+		case SO_CASE:
+		case SO_CONTINUE:
+		case SO_CONTINUEC:
+		case SO_DEFAULT:
+		case SO_DISCARD:
+		case SO_ELSE:
+		case SO_ENDIF:
+		case SO_ENDLOOP:
+		case SO_ENDSWITCH:
+		case SO_IF:
+		case SO_LABEL:
+		case SO_LOOP:
+		case SO_RET:
+		case SO_RETC:
+		case SO_SWITCH:
+		case SO_INTERFACE_CALL:
+		case SO_HS_DECLS:
+		case SO_HS_CONTROL_POINT_PHASE:
+		case SO_HS_FORK_PHASE:
+		case SO_HS_JOIN_PHASE:
+			return IC_Boundary;
+
+		case SO_MOV:
+		case SO_ADD:
+		case SO_MUL:
+		case SO_MAD:
+		case SO_DP2:
+		case SO_DP3:
+		case SO_DP4:
+		case SO_MIN:
+		case SO_MAX:
+		case SO_DIV:
+		case SO_SQRT:
+		case SO_RSQ:
+		case SO_EXP:
+		case SO_LOG:
+		case SO_FRC:
+		case SO_ROUND_NE:
+		case SO_ROUND_NI:
+		case SO_ROUND_PI:
+		case SO_IADD:
+		case SO_IMAX:
+		case SO_IMIN:
+		case SO_UMAX:
+		case SO_UMIN:
+		case SO_EQ:
+		case SO_NE:
+		case SO_LT:
+		case SO_GE:
+		case SO_IEQ:
+		case SO_INE:
+		case SO_ILT:
+		case SO_IGE:
+		case SO_ULT:
+		case SO_UGE:
+		case SO_FTOI:
+		case SO_FTOU:
+		case SO_ITOF:
+		case SO_UTOF:
+		case SO_INEG:
+		case SO_ISHL:
+		case SO_ISHR:
+		case SO_USHR:
+			if ((insn.num_ops >= 2) && (SOSM_MASK == insn.ops[0]->mode) && (4 == insn.ops[0]->comps)
+				&& (insn.ops[0]->mask != 0))
+			{
+				return IC_Pure;
+			}
+			return IC_Opaque;
+
+		default:
+			return IC_Opaque;
+		}
+	}
+
+	// Positions of the source swizzles that a pure instruction actually reads
+	uint32_t SourcePositions(ShaderInstruction const & insn)
+	{
+		switch (insn.opcode)
+		{
+		case SO_DP2:
+			return 0x3;
+
+		case SO_DP3:
+			return 0x7;
+
+		case SO_DP4:
+			return 0xF;
+
+		default:
+			return insn.ops[0]->mask;
+		}
+	}
+
+	uint32_t FirstPosition(uint32_t positions)
+	{
+		BOOST_ASSERT(positions != 0);
+
+		uint32_t i = 0;
+		while (!(positions & (1UL << i)))
+		{
+			++ i;
+		}
+		return i;
+	}
+
+	uint32_t ReadComps(ShaderOperand const & op, uint32_t positions)
+	{
+		if ((4 != op.comps) || (SOSM_MASK == op.mode))
+		{
+			return 0xF;
+		}
+
+		uint32_t comps = 0;
+		for (uint32_t i = 0; i < 4; ++ i)
+		{
+			if (positions & (1UL << i))
+			{
+				comps |= 1UL << op.swizzle[i];
+			}
+		}
+		return comps;
+	}
+
+	uint32_t TempIndex(ShaderOperand const & op)
+	{
+		BOOST_ASSERT(SOT_TEMP == op.type);
+		BOOST_ASSERT(op.HasSimpleIndex());
+
+		return static_cast<uint32_t>(op.indices[0].disp);
+	}
+
+	template <typename Func>
+	void ForEachIndexTemp(ShaderOperand const & op, Func const & func)
+	{
+		for (uint32_t i = 0; i < op.num_indices; ++ i)
+		{
+			if (op.indices[i].reg)
+			{
+				if (SOT_TEMP == op.indices[i].reg->type)
+				{
+					func(TempIndex(*op.indices[i].reg), 0xFU);
+				}
+				ForEachIndexTemp(*op.indices[i].reg, func);
+			}
+		}
+	}
+
+	// Calls func(temp, comps) for every temp component the instruction may read. Opaque instructions read all
+	// the components of every temp they mention.
+	template <typename Func>
+	void ForEachTempRead(ShaderInstruction const & insn, bool pure, Func const & func)
+	{
+		uint32_t const positions = pure ? SourcePositions(insn) : 0xF;
+		for (uint32_t i = 0; i < insn.num_ops; ++ i)
+		{
+			ShaderOperand const & op = *insn.ops[i];
+			if ((SOT_TEMP == op.type) && (!pure || (i != 0)))
+			{
+				func(TempIndex(op), pure ? ReadComps(op, positions) : 0xFU);
+			}
+			ForEachIndexTemp(op, func);
+		}
+	}
+
+	bool IsSimpleTemp(ShaderOperand const & op)
+	{
+		return (SOT_TEMP == op.type) && (4 == op.comps) && (op.mode != SOSM_MASK) && op.HasSimpleIndex();
+	}
+
+	// Make the swizzles and immediate values on the positions an instruction doesn't read neutral, so they don't
+	// pull the types of unrelated components into the operand.
+	void CanonicalizeSources(ShaderInstruction& insn)
+	{
+		uint32_t const positions = SourcePositions(insn);
+		uint32_t const first = FirstPosition(positions);
+		for (uint32_t i = 1; i < insn.num_ops; ++ i)
+		{
+			ShaderOperand& op = *insn.ops[i];
+			if ((SOT_IMMEDIATE32 == op.type) && (4 == op.comps))
+			{
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					if (!(positions & (1UL << j)))
+					{
+						op.imm_values[j].u64 = 0;
+					}
+				}
+			}
+			else if ((4 == op.comps) && (SOSM_SWIZZLE == op.mode))
+			{
+				for (uint32_t j = 0; j < 4; ++ j)
+				{
+					if (!(positions & (1UL << j)))
+					{
+						op.swizzle[j] = op.swizzle[first];
+					}
+				}
+			}
+		}
+	}
+
+	// GLSLGen prints floats with 6 significant digits
+	bool FloatPrintsExactly(float f)
+	{
+		char str[32];
+		std::snprintf(str, sizeof(str), "%#g", f);
+		float const parsed = std::strtof(str, nullptr);
+		return 0 == memcmp(&parsed, &f, sizeof(f));
+	}
+
+	// Whether GLSLGen would print the immediate values without changing their bits. as_mov is for the source of a
+	// mov, where the values themselves decide between a float and an int constructor.
+	bool ImmediatePrintsExactly(ShaderImmType type, bool as_mov, ShaderAny const * values, uint32_t num)
+	{
+		if (SIT_Int == type)
+		{
+			return true;
+		}
+		if (type != SIT_Float)
+		{
+			return false;
+		}
+
+		bool any_valid = false;
+		bool any_non_zero_int = false;
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			if (ValidFloat(values[i].f32))
+			{
+				if (!FloatPrintsExactly(values[i].f32))
+				{
+					return false;
+				}
+				any_valid = true;
+			}
+			else if (values[i].i32 != 0)
+			{
+				any_non_zero_int = true;
+			}
+		}
+
+		if (as_mov)
+		{
+			return !(any_valid && any_non_zero_int);
+		}
+		else
+		{
+			return !any_non_zero_int && (any_valid || (num > 1));
+		}
+	}
+
+	bool AcceptsImmediates(ShaderInstruction const & insn)
+	{
+		switch (insn.opcode)
+		{
+		case SO_MOV:
+			return SOT_TEMP == insn.ops[0]->type;
+
+		case SO_ADD:
+		case SO_MUL:
+		case SO_MAD:
+		case SO_MIN:
+		case SO_MAX:
+		case SO_DP2:
+		case SO_DP3:
+		case SO_DP4:
+		case SO_DIV:
+		case SO_IADD:
+		case SO_IMAX:
+		case SO_IMIN:
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	bool IsIdentityMov(ShaderInstruction const & insn)
+	{
+		if ((insn.opcode != SO_MOV) || insn.insn.sat)
+		{
+			return false;
+		}
+
+		ShaderOperand const & dst = *insn.ops[0];
+		ShaderOperand const & src = *insn.ops[1];
+		if ((SOT_TEMP != dst.type) || !IsSimpleTemp(src) || src.neg || src.abs || (TempIndex(src) != TempIndex(dst)))
+		{
+			return false;
+		}
+		for (uint32_t i = 0; i < 4; ++ i)
+		{
+			if ((dst.mask & (1UL << i)) && (src.swizzle[i] != i))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	class ShaderOptimizer
+	{
+		struct CopySource
+		{
+			ShaderOperand const * op; // Source of the mov, nullptr if unknown
+			uint32_t comp;
+		};
+
+	public:
+		explicit ShaderOptimizer(ShaderProgram& program)
+			: program_(program), num_temps_(0)
+		{
+			classes_.resize(program_.insns.size());
+			for (size_t i = 0; i < program_.insns.size(); ++ i)
+			{
+				ShaderInstruction& insn = *program_.insns[i];
+				classes_[i] = ClassifyInsn(insn);
+				if (IC_Pure == classes_[i])
+				{
+					CanonicalizeSources(insn);
+				}
+				ForEachTempRead(insn, false,
+					[this](uint32_t reg, uint32_t comps)
+					{
+						KFL_UNUSED(comps);
+						num_temps_ = std::max(num_temps_, reg + 1);
+					});
+			}
+
+			copies_.resize(num_temps_ * 4);
+			copied_from_.resize(num_temps_);
+			read_.resize(num_temps_);
+			live_.resize(num_temps_);
+		}
+
+		void Run()
+		{
+			if (0 == num_temps_)
+			{
+				return;
+			}
+
+			// One forward pass already follows chains of copies, so another round only pays off when dead code
+			// elimination removed something that was in the way.
+			for (uint32_t round = 0; round < MAX_ROUNDS; ++ round)
+			{
+				this->PropagateCopies();
+				if (!this->EliminateDeadCode())
+				{
+					break;
+				}
+			}
+		}
+
+	private:
+		// Forward pass over each basic block. Also collects the temp components read anywhere in the program.
+		void PropagateCopies()
+		{
+			this->ClearCopies();
+			std::fill(read_.begin(), read_.end(), static_cast<uint8_t>(0));
+			auto const mark_read = [this](uint32_t reg, uint32_t comps)
+				{
+					read_[reg] |= static_cast<uint8_t>(comps);
+				};
+
+			for (size_t i = 0; i < program_.insns.size(); ++ i)
+			{
+				ShaderInstruction& insn = *program_.insns[i];
+				switch (classes_[i])
+				{
+				case IC_Boundary:
+					this->ClearCopies();
+					ForEachTempRead(insn, false, mark_read);
+					break;
+
+				case IC_Opaque:
+					ForEachTempRead(insn, false,
+						[this](uint32_t reg, uint32_t comps)
+						{
+							read_[reg] |= static_cast<uint8_t>(comps);
+							this->Invalidate(reg, comps);
+						});
+					break;
+
+				case IC_Pure:
+					for (uint32_t j = 1; j < insn.num_ops; ++ j)
+					{
+						this->RewriteSource(insn, j);
+					}
+					this->FoldConstants(insn);
+					ForEachTempRead(insn, true, mark_read);
+					if (SOT_TEMP == insn.ops[0]->type)
+					{
+						this->Invalidate(TempIndex(*insn.ops[0]), insn.ops[0]->mask);
+						this->Record(insn);
+					}
+					break;
+				}
+			}
+		}
+
+		// Removes writes to temp components that are never read afterwards. Liveness is exact inside a basic block;
+		// at block boundaries every component that is read anywhere in the program counts as live.
+		bool EliminateDeadCode()
+		{
+			std::fill(live_.begin(), live_.end(), static_cast<uint8_t>(0xF));
+			auto const mark_live = [this](uint32_t reg, uint32_t comps)
+				{
+					live_[reg] |= static_cast<uint8_t>(comps);
+				};
+
+			std::vector<bool> dead(program_.insns.size(), false);
+			bool changed = false;
+			for (size_t i = program_.insns.size(); i > 0; -- i)
+			{
+				ShaderInstruction& insn = *program_.insns[i - 1];
+				switch (classes_[i - 1])
+				{
+				case IC_Boundary:
+					std::fill(live_.begin(), live_.end(), static_cast<uint8_t>(0xF));
+					break;
+
+				case IC_Opaque:
+					ForEachTempRead(insn, false, mark_live);
+					break;
+
+				case IC_Pure:
+					{
+						ShaderOperand& dst = *insn.ops[0];
+						if (SOT_TEMP == dst.type)
+						{
+							uint32_t const reg = TempIndex(dst);
+							uint32_t const useful = dst.mask & live_[reg] & read_[reg];
+							if ((0 == useful) || IsIdentityMov(insn))
+							{
+								dead[i - 1] = true;
+								changed = true;
+								break;
+							}
+							if (useful != dst.mask)
+							{
+								dst.mask = static_cast<uint8_t>(useful);
+								CanonicalizeSources(insn);
+								changed = true;
+							}
+							live_[reg] &= static_cast<uint8_t>(~useful);
+						}
+						ForEachTempRead(insn, true, mark_live);
+					}
+					break;
+				}
+			}
+
+			if (changed)
+			{
+				size_t n = 0;
+				for (size_t i = 0; i < program_.insns.size(); ++ i)
+				{
+					if (!dead[i])
+					{
+						program_.insns[n] = std::move(program_.insns[i]);
+						classes_[n] = classes_[i];
+						++ n;
+					}
+				}
+				program_.insns.resize(n);
+				classes_.resize(n);
+			}
+
+			return changed;
+		}
+
+		void ClearCopies()
+		{
+			for (auto& copy : copies_)
+			{
+				copy.op = nullptr;
+				copy.comp = 0;
+			}
+			std::fill(copied_from_.begin(), copied_from_.end(), static_cast<uint8_t>(0));
+		}
+
+		void Invalidate(uint32_t reg, uint32_t comps)
+		{
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				if (comps & (1UL << i))
+				{
+					copies_[reg * 4 + i].op = nullptr;
+				}
+			}
+			if (copied_from_[reg] & comps)
+			{
+				for (auto& copy : copies_)
+				{
+					if (copy.op && (SOT_TEMP == copy.op->type) && (TempIndex(*copy.op) == reg)
+						&& (comps & (1UL << copy.comp)))
+					{
+						copy.op = nullptr;
+					}
+				}
+				copied_from_[reg] &= static_cast<uint8_t>(~comps);
+			}
+		}
+
+		void Record(ShaderInstruction const & insn)
+		{
+			if ((insn.opcode != SO_MOV) || insn.insn.sat)
+			{
+				return;
+			}
+
+			ShaderOperand const & dst = *insn.ops[0];
+			ShaderOperand const & src = *insn.ops[1];
+			if (src.neg || src.abs)
+			{
+				return;
+			}
+
+			bool const from_imm = (SOT_IMMEDIATE32 == src.type);
+			if (!from_imm && !IsSimpleTemp(src))
+			{
+				return;
+			}
+
+			uint32_t const reg = TempIndex(dst);
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				if (dst.mask & (1UL << i))
+				{
+					CopySource& copy = copies_[reg * 4 + i];
+					copy.op = &src;
+					if (from_imm)
+					{
+						copy.comp = (1 == src.comps) ? 0 : i;
+					}
+					else if ((TempIndex(src) == reg) && (dst.mask & (1UL << src.swizzle[i])))
+					{
+						// The source component is overwritten by this mov
+						copy.op = nullptr;
+					}
+					else
+					{
+						copy.comp = src.swizzle[i];
+						copied_from_[TempIndex(src)] |= static_cast<uint8_t>(1UL << copy.comp);
+					}
+				}
+			}
+		}
+
+		// Replaces a temp source that is a known copy by the original register, with the swizzles folded together,
+		// or by the immediate it holds.
+		void RewriteSource(ShaderInstruction& insn, uint32_t index)
+		{
+			ShaderOperand const & use = *insn.ops[index];
+			if (!IsSimpleTemp(use))
+			{
+				return;
+			}
+
+			uint32_t const reg = TempIndex(use);
+			CopySource const * sources[4];
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				sources[i] = &copies_[reg * 4 + use.swizzle[i]];
+				if (!sources[i]->op)
+				{
+					return;
+				}
+			}
+
+			ShaderOperand const & first = *sources[0]->op;
+			bool const from_imm = (SOT_IMMEDIATE32 == first.type);
+			for (uint32_t i = 1; i < 4; ++ i)
+			{
+				ShaderOperand const & op = *sources[i]->op;
+				if (from_imm)
+				{
+					if (op.type != SOT_IMMEDIATE32)
+					{
+						return;
+					}
+				}
+				else if ((op.type != SOT_TEMP) || (TempIndex(op) != TempIndex(first)))
+				{
+					return;
+				}
+			}
+
+			ShaderOperand new_op = first;
+			new_op.neg = use.neg;
+			new_op.abs = use.abs;
+			if (from_imm)
+			{
+				if (!AcceptsImmediates(insn))
+				{
+					return;
+				}
+
+				new_op.comps = (SOSM_SCALAR == use.mode) ? 1 : 4;
+				for (uint32_t i = 0; i < 4; ++ i)
+				{
+					new_op.imm_values[i].u64 = 0;
+				}
+				for (uint32_t i = 0; i < new_op.comps; ++ i)
+				{
+					new_op.imm_values[i].i32 = sources[i]->op->imm_values[sources[i]->comp].i32;
+				}
+
+				bool const as_mov = (SO_MOV == insn.opcode);
+				if (!ImmediatePrintsExactly(as_mov ? SIT_Float : GetOpInType(insn.opcode), as_mov,
+					new_op.imm_values, new_op.comps))
+				{
+					return;
+				}
+			}
+			else
+			{
+				new_op.mode = use.mode;
+				for (uint32_t i = 0; i < 4; ++ i)
+				{
+					new_op.swizzle[i] = static_cast<uint8_t>(sources[i]->comp);
+				}
+				if ((TempIndex(new_op) == reg) && std::equal(use.swizzle, use.swizzle + 4, new_op.swizzle))
+				{
+					return;
+				}
+			}
+
+			insn.ops[index] = program_.MakeNode<ShaderOperand>();
+			*insn.ops[index] = new_op;
+		}
+
+		// Evaluates arithmetic on immediates and turns the instruction into a mov
+		void FoldConstants(ShaderInstruction& insn)
+		{
+			if (insn.insn.sat || (insn.ops[0]->type != SOT_TEMP))
+			{
+				return;
+			}
+
+			bool is_float;
+			switch (insn.opcode)
+			{
+			case SO_ADD:
+			case SO_MUL:
+			case SO_MAD:
+			case SO_MIN:
+			case SO_MAX:
+				is_float = true;
+				break;
+
+			case SO_IADD:
+			case SO_IMAX:
+			case SO_IMIN:
+				is_float = false;
+				break;
+
+			default:
+				return;
+			}
+
+			for (uint32_t i = 1; i < insn.num_ops; ++ i)
+			{
+				ShaderOperand const & op = *insn.ops[i];
+				if ((op.type != SOT_IMMEDIATE32) || (!is_float && op.abs))
+				{
+					return;
+				}
+			}
+
+			ShaderOperand const & dst = *insn.ops[0];
+			ShaderAny results[4];
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				results[i].u64 = 0;
+				if (!(dst.mask & (1UL << i)))
+				{
+					continue;
+				}
+
+				ShaderAny values[3];
+				for (uint32_t j = 1; j < insn.num_ops; ++ j)
+				{
+					ShaderOperand const & op = *insn.ops[j];
+					ShaderAny& value = values[j - 1];
+					value = op.imm_values[(1 == op.comps) ? 0 : i];
+					if (is_float)
+					{
+						if (!ValidFloat(value.f32))
+						{
+							return;
+						}
+						if (op.abs)
+						{
+							value.f32 = std::abs(value.f32);
+						}
+						if (op.neg)
+						{
+							value.f32 = -value.f32;
+						}
+					}
+					else if (op.neg)
+					{
+						value.i32 = static_cast<int32_t>(0U - static_cast<uint32_t>(value.i32));
+					}
+				}
+
+				ShaderAny& result = results[i];
+				switch (insn.opcode)
+				{
+				case SO_ADD:
+					result.f32 = values[0].f32 + values[1].f32;
+					break;
+
+				case SO_MUL:
+					result.f32 = values[0].f32 * values[1].f32;
+					break;
+
+				case SO_MAD:
+					result.f32 = values[0].f32 * values[1].f32 + values[2].f32;
+					break;
+
+				case SO_MIN:
+					result.f32 = std::min(values[0].f32, values[1].f32);
+					break;
+
+				case SO_MAX:
+					result.f32 = std::max(values[0].f32, values[1].f32);
+					break;
+
+				case SO_IADD:
+					result.i32 = static_cast<int32_t>(static_cast<uint32_t>(values[0].i32) + static_cast<uint32_t>(values[1].i32));
+					break;
+
+				case SO_IMAX:
+					result.i32 = std::max(values[0].i32, values[1].i32);
+					break;
+
+				case SO_IMIN:
+					result.i32 = std::min(values[0].i32, values[1].i32);
+					break;
+
+				default:
+					BOOST_ASSERT(false);
+					break;
+				}
+
+				if (is_float && !ValidFloat(result.f32) && (result.i32 != 0))
+				{
+					return;
+				}
+			}
+
+			if (!ImmediatePrintsExactly(SIT_Float, true, results, 4))
+			{
+				return;
+			}
+
+			std::shared_ptr<ShaderOperand> new_op = program_.MakeNode<ShaderOperand>();
+			*new_op = *insn.ops[1];
+			new_op->comps = 4;
+			new_op->neg = false;
+			new_op->abs = false;
+			std::copy(results, results + 4, new_op->imm_values);
+
+			insn.opcode = SO_MOV;
+			insn.num_ops = 2;
+			insn.ops[1] = new_op;
+			for (uint32_t i = 2; i < SM_MAX_OPS; ++ i)
+			{
+				insn.ops[i].reset();
+			}
+		}
+
+	private:
+		ShaderProgram& program_;
+		uint32_t num_temps_;
+		std::vector<InsnClass> classes_;
+
+		std::vector<CopySource> copies_;
+		std::vector<uint8_t> copied_from_; // Components that are the source of some entry in copies_
+		std::vector<uint8_t> read_;
+		std::vector<uint8_t> live_;
+	};
+}
+
+void ShaderOptimize(ShaderProgram& program)
+{
+	ShaderOptimizer optimizer(program);
+	optimizer.Run();
+}
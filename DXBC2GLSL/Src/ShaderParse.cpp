@@ -237,19 +237,19 @@ struct ShaderParser
 				break;
 
 			case SOIP_RELATIVE:
-				op.indices[i].reg = KlayGE::MakeSharedPtr<ShaderOperand>();
+				op.indices[i].reg = program->MakeNode<ShaderOperand>();
 				this->ReadOp(*op.indices[i].reg);
 				break;
 
 			case SOIP_IMM32_PLUS_RELATIVE:
 				op.indices[i].disp = static_cast<int32_t>(this->Read32());
-				op.indices[i].reg = KlayGE::MakeSharedPtr<ShaderOperand>();
+				op.indices[i].reg = program->MakeNode<ShaderOperand>();
 				this->ReadOp(*op.indices[i].reg);
 				break;
 
 			case SOIP_IMM64_PLUS_RELATIVE:
 				op.indices[i].disp = this->Read64();
-				op.indices[i].reg = KlayGE::MakeSharedPtr<ShaderOperand>();
+				op.indices[i].reg = program->MakeNode<ShaderOperand>();
 				this->ReadOp(*op.indices[i].reg);
 				break;
 			}
@@ -293,7 +293,7 @@ struct ShaderParser
 				// immediate constant buffer data
 				uint32_t customlen = this->Read32() - 2;
 
-				std::shared_ptr<ShaderDecl> dcl = KlayGE::MakeSharedPtr<ShaderDecl>();
+				std::shared_ptr<ShaderDecl> dcl = program->MakeNode<ShaderDecl>();
 				program->dcls.push_back(dcl);
 
 				dcl->opcode = SO_IMMEDIATE_CONSTANT_BUFFER;
@@ -310,7 +310,7 @@ struct ShaderParser
 			{
 				// need to interleave these with the declarations or we cannot
 				// assign fork/join phase instance counts to phases
-				std::shared_ptr<ShaderDecl> dcl = KlayGE::MakeSharedPtr<ShaderDecl>();
+				std::shared_ptr<ShaderDecl> dcl = program->MakeNode<ShaderDecl>();
 				program->dcls.push_back(dcl);
 				dcl->opcode = opcode;
 			}
@@ -319,7 +319,7 @@ struct ShaderParser
 				|| ((opcode >= SO_DCL_STREAM) && (opcode <= SO_DCL_RESOURCE_STRUCTURED))
 				|| (SO_DCL_GS_INSTANCE_COUNT == opcode))
 			{
-				std::shared_ptr<ShaderDecl> dcl = KlayGE::MakeSharedPtr<ShaderDecl>();
+				std::shared_ptr<ShaderDecl> dcl = program->MakeNode<ShaderDecl>();
 				program->dcls.push_back(dcl);
 				reinterpret_cast<TokenizedShaderInstruction&>(*dcl) = insntok;
 
@@ -330,7 +330,7 @@ struct ShaderParser
 					this->ReadToken(&exttok);
 				}
 
-#define READ_OP_ANY dcl->op = KlayGE::MakeSharedPtr<ShaderOperand>(); this->ReadOp(*dcl->op);
+#define READ_OP_ANY dcl->op = program->MakeNode<ShaderOperand>(); this->ReadOp(*dcl->op);
 #define READ_OP(FILE) READ_OP_ANY
 				//check(dcl->op->file == SOT_##FILE);
 
@@ -382,7 +382,7 @@ struct ShaderParser
 					break;
 
 				case SO_DCL_INDEXABLE_TEMP:
-					dcl->op = KlayGE::MakeSharedPtr<ShaderOperand>();
+					dcl->op = program->MakeNode<ShaderOperand>();
 					dcl->op->indices[0].disp = this->Read32();
 					dcl->indexable_temp.num = this->Read32();
 					dcl->indexable_temp.comps = this->Read32();
@@ -531,7 +531,7 @@ struct ShaderParser
 				{
 					continue;
 				}
-				std::shared_ptr<ShaderInstruction> insn = KlayGE::MakeSharedPtr<ShaderInstruction>();
+				std::shared_ptr<ShaderInstruction> insn = program->MakeNode<ShaderInstruction>();
 				program->insns.push_back(insn);
 				reinterpret_cast<TokenizedShaderInstruction&>(*insn) = insntok;
 
@@ -574,7 +574,7 @@ struct ShaderParser
 				{
 					BOOST_ASSERT(tokens < insn_end);
 					BOOST_ASSERT(op_num < SM_MAX_OPS);
-					insn->ops[op_num] = KlayGE::MakeSharedPtr<ShaderOperand>();
+					insn->ops[op_num] = program->MakeNode<ShaderOperand>();
 					this->ReadOp(*insn->ops[op_num]);
 					++ op_num;
 				}
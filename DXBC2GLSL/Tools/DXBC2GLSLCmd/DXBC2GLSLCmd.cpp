@@ -29,6 +29,7 @@
  */
 
 #include <DXBC2GLSL/DXBC2GLSL.hpp>
+#include <KFL/Timer.hpp>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -75,8 +76,26 @@ int main(int argc, char** argv)
 
 	try
 	{
+		// Translations are repeated to get a stable timing
+		uint32_t const NUM_RUNS = 8;
+
+		DXBC2GLSL::DXBC2GLSL dxbc2glsl_unopt;
+		dxbc2glsl_unopt.Optimize(false);
+		KlayGE::Timer timer;
+		for (uint32_t i = 0; i < NUM_RUNS; ++ i)
+		{
+			dxbc2glsl_unopt.FeedDXBC(&data[0], true, true, STP_Fractional_Odd, STOP_Triangle_CW, GSV_430);
+		}
+		double const unopt_translate_time = timer.elapsed() / NUM_RUNS;
+
 		DXBC2GLSL::DXBC2GLSL dxbc2glsl;
-		dxbc2glsl.FeedDXBC(&data[0], true, true, STP_Fractional_Odd, STOP_Triangle_CW, GSV_430);
+		timer.restart();
+		for (uint32_t i = 0; i < NUM_RUNS; ++ i)
+		{
+			dxbc2glsl.FeedDXBC(&data[0], true, true, STP_Fractional_Odd, STOP_Triangle_CW, GSV_430);
+		}
+		double const translate_time = timer.elapsed() / NUM_RUNS;
+
 		std::string glsl = dxbc2glsl.GLSLString();
 		if (!screen_only)
 		{
@@ -142,6 +161,13 @@ int main(int argc, char** argv)
 
 			std::cout << "Max GS output vertex " << dxbc2glsl.MaxGSOutputVertex() << std::endl << std::endl;
 		}
+
+		std::cout << "Translation:" << std::endl;
+		std::cout << "\tOptimized: " << dxbc2glsl.NumInstructions() << " instructions, "
+			<< dxbc2glsl.GLSLString().size() << " bytes, " << translate_time * 1000 << " ms" << std::endl;
+		std::cout << "\tUnoptimized: " << dxbc2glsl_unopt.NumInstructions() << " instructions, "
+			<< dxbc2glsl_unopt.GLSLString().size() << " bytes, " << unopt_translate_time * 1000 << " ms" << std::endl;
+		std::cout << std::endl;
 	}
 	catch (std::exception& ex)
 	{
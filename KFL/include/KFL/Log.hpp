@@ -33,12 +33,82 @@
 
 #pragma once
 
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
 namespace KlayGE
 {
+	enum LogLevel : uint8_t
+	{
+		LL_Debug,
+		LL_Info,
+		LL_Warn,
+		LL_Error
+	};
+
+	// Records below this level are compiled out
+#ifndef KLAYGE_LOG_MIN_LEVEL
+#ifdef KLAYGE_DEBUG
+	#define KLAYGE_LOG_MIN_LEVEL KlayGE::LL_Debug
+#else
+	#define KLAYGE_LOG_MIN_LEVEL KlayGE::LL_Info
+#endif
+#endif
+
+	// Each thread writes into its own buffer, a background thread formats the records out to the log.
+	// A stream returned by LogXXX() is per thread, and a record ends at each flush, such as std::endl.
 	std::ostream& LogDebug();
 	std::ostream& LogInfo();
 	std::ostream& LogWarn();
 	std::ostream& LogError();
+
+	class LogField
+	{
+	public:
+		LogField(std::string_view key, std::string_view value)
+			: key_(key), value_(value)
+		{
+		}
+		LogField(std::string_view key, char const * value)
+			: key_(key), value_(value)
+		{
+		}
+		LogField(std::string_view key, std::string const & value)
+			: key_(key), value_(value)
+		{
+		}
+		LogField(std::string_view key, bool value)
+			: key_(key), value_(value ? "true" : "false")
+		{
+		}
+		template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+		LogField(std::string_view key, T value)
+			: key_(key), value_(std::to_string(value))
+		{
+		}
+
+		std::string_view Key() const
+		{
+			return key_;
+		}
+		std::string const & Value() const
+		{
+			return value_;
+		}
+
+	private:
+		std::string_view key_;
+		std::string value_;
+	};
+
+	// Writes "msg key=value ...". Records with the same level and msg are rate limited together, whatever their fields are.
+	void LogWrite(LogLevel level, std::string_view msg, std::initializer_list<LogField> fields = {});
+	// Blocks until everything logged so far is written out
+	void LogFlush();
 }
 
+#define KLAYGE_LOG(level, ...)	do { if ((level) >= KLAYGE_LOG_MIN_LEVEL) { KlayGE::LogWrite(level, __VA_ARGS__); } } while (false)
+
 #endif		// _KFL_LOG_HPP
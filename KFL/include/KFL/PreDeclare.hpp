@@ -47,6 +47,8 @@ namespace KlayGE
 	typedef std::shared_ptr<XMLNode> XMLNodePtr;
 	class XMLAttribute;
 	typedef std::shared_ptr<XMLAttribute> XMLAttributePtr;
+	class XMLNodeView;
+	class XMLAttributeView;
 
 	class bad_join;
 	template <typename ResultType>
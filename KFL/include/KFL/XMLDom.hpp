@@ -34,6 +34,7 @@
 #pragma once
 
 #include <iosfwd>
+#include <iterator>
 #include <vector>
 
 #include <boost/noncopyable.hpp>
@@ -62,14 +63,271 @@ namespace KlayGE
 		XNT_PI
 	};
 
+	class XMLNodeIterator;
+	class XMLAttributeIterator;
+
+	template <typename Iterator>
+	class XMLRange
+	{
+	public:
+		explicit XMLRange(Iterator begin) noexcept
+			: begin_(begin)
+		{
+		}
+
+		Iterator begin() const noexcept
+		{
+			return begin_;
+		}
+		Iterator end() const noexcept
+		{
+			return Iterator();
+		}
+
+	private:
+		Iterator begin_;
+	};
+
+	// Lightweight handles to the nodes and attributes of a document. They are trivially copyable and never allocate,
+	// so they are preferred over XMLNode and XMLAttribute when walking a document. A handle is valid as long as its document.
+	class XMLAttributeView final
+	{
+		friend class XMLAttribute;
+
+	public:
+		XMLAttributeView() noexcept = default;
+		XMLAttributeView(XMLDocument const * doc, rapidxml::xml_attribute<char>* attr) noexcept
+			: doc_(doc), attr_(attr)
+		{
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return attr_ != nullptr;
+		}
+		bool operator==(XMLAttributeView const & rhs) const noexcept
+		{
+			return attr_ == rhs.attr_;
+		}
+		bool operator!=(XMLAttributeView const & rhs) const noexcept
+		{
+			return attr_ != rhs.attr_;
+		}
+
+		std::string_view Name() const;
+
+		XMLAttributeView NextAttrib(std::string_view name) const;
+		XMLAttributeView NextAttrib() const;
+
+		bool TryConvert(int32_t& val) const;
+		bool TryConvert(uint32_t& val) const;
+		bool TryConvert(float& val) const;
+
+		int32_t ValueInt() const;
+		uint32_t ValueUInt() const;
+		float ValueFloat() const;
+		std::string_view ValueString() const;
+
+	private:
+		XMLDocument const * doc_ = nullptr;
+		rapidxml::xml_attribute<char>* attr_ = nullptr;
+	};
+
+	class XMLNodeView final
+	{
+		friend class XMLNode;
+
+	public:
+		XMLNodeView() noexcept = default;
+		XMLNodeView(XMLDocument const * doc, rapidxml::xml_node<char>* node) noexcept
+			: doc_(doc), node_(node)
+		{
+		}
+
+		explicit operator bool() const noexcept
+		{
+			return node_ != nullptr;
+		}
+		bool operator==(XMLNodeView const & rhs) const noexcept
+		{
+			return node_ == rhs.node_;
+		}
+		bool operator!=(XMLNodeView const & rhs) const noexcept
+		{
+			return node_ != rhs.node_;
+		}
+
+		std::string_view Name() const;
+		XMLNodeType Type() const;
+
+		XMLNodeView Parent() const;
+
+		XMLAttributeView FirstAttrib(std::string_view name) const;
+		XMLAttributeView LastAttrib(std::string_view name) const;
+		XMLAttributeView FirstAttrib() const;
+		XMLAttributeView LastAttrib() const;
+
+		XMLAttributeView Attrib(std::string_view name) const;
+
+		// Iterates all attributes, or the ones with the given name
+		XMLRange<XMLAttributeIterator> Attribs() const;
+		XMLRange<XMLAttributeIterator> Attribs(std::string_view name) const;
+
+		bool TryConvertAttrib(std::string_view name, int32_t& val, int32_t default_val) const;
+		bool TryConvertAttrib(std::string_view name, uint32_t& val, uint32_t default_val) const;
+		bool TryConvertAttrib(std::string_view name, float& val, float default_val) const;
+
+		int32_t AttribInt(std::string_view name, int32_t default_val) const;
+		uint32_t AttribUInt(std::string_view name, uint32_t default_val) const;
+		float AttribFloat(std::string_view name, float default_val) const;
+		std::string_view AttribString(std::string_view name, std::string_view default_val) const;
+
+		XMLNodeView FirstNode(std::string_view name) const;
+		XMLNodeView LastNode(std::string_view name) const;
+		XMLNodeView FirstNode() const;
+		XMLNodeView LastNode() const;
+
+		XMLNodeView PrevSibling(std::string_view name) const;
+		XMLNodeView NextSibling(std::string_view name) const;
+		XMLNodeView PrevSibling() const;
+		XMLNodeView NextSibling() const;
+
+		// Iterates all child nodes, or the ones with the given name
+		XMLRange<XMLNodeIterator> Children() const;
+		XMLRange<XMLNodeIterator> Children(std::string_view name) const;
+
+		bool TryConvert(int32_t& val) const;
+		bool TryConvert(uint32_t& val) const;
+		bool TryConvert(float& val) const;
+
+		int32_t ValueInt() const;
+		uint32_t ValueUInt() const;
+		float ValueFloat() const;
+		std::string_view ValueString() const;
+
+	private:
+		XMLDocument const * doc_ = nullptr;
+		rapidxml::xml_node<char>* node_ = nullptr;
+	};
+
+	// An empty name matches every sibling
+	class XMLNodeIterator final
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = XMLNodeView;
+		using difference_type = std::ptrdiff_t;
+		using pointer = XMLNodeView const *;
+		using reference = XMLNodeView const &;
+
+		XMLNodeIterator() noexcept = default;
+		XMLNodeIterator(XMLNodeView node, std::string_view name) noexcept
+			: node_(node), name_(name)
+		{
+		}
+
+		reference operator*() const noexcept
+		{
+			return node_;
+		}
+		pointer operator->() const noexcept
+		{
+			return &node_;
+		}
+
+		XMLNodeIterator& operator++()
+		{
+			node_ = name_.empty() ? node_.NextSibling() : node_.NextSibling(name_);
+			return *this;
+		}
+		XMLNodeIterator operator++(int)
+		{
+			XMLNodeIterator tmp = *this;
+			++ *this;
+			return tmp;
+		}
+
+		bool operator==(XMLNodeIterator const & rhs) const noexcept
+		{
+			return node_ == rhs.node_;
+		}
+		bool operator!=(XMLNodeIterator const & rhs) const noexcept
+		{
+			return node_ != rhs.node_;
+		}
+
+	private:
+		XMLNodeView node_;
+		std::string_view name_;
+	};
+
+	class XMLAttributeIterator final
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = XMLAttributeView;
+		using difference_type = std::ptrdiff_t;
+		using pointer = XMLAttributeView const *;
+		using reference = XMLAttributeView const &;
+
+		XMLAttributeIterator() noexcept = default;
+		XMLAttributeIterator(XMLAttributeView attr, std::string_view name) noexcept
+			: attr_(attr), name_(name)
+		{
+		}
+
+		reference operator*() const noexcept
+		{
+			return attr_;
+		}
+		pointer operator->() const noexcept
+		{
+			return &attr_;
+		}
+
+		XMLAttributeIterator& operator++()
+		{
+			attr_ = name_.empty() ? attr_.NextAttrib() : attr_.NextAttrib(name_);
+			return *this;
+		}
+		XMLAttributeIterator operator++(int)
+		{
+			XMLAttributeIterator tmp = *this;
+			++ *this;
+			return tmp;
+		}
+
+		bool operator==(XMLAttributeIterator const & rhs) const noexcept
+		{
+			return attr_ == rhs.attr_;
+		}
+		bool operator!=(XMLAttributeIterator const & rhs) const noexcept
+		{
+			return attr_ != rhs.attr_;
+		}
+
+	private:
+		XMLAttributeView attr_;
+		std::string_view name_;
+	};
+
 	class XMLDocument : boost::noncopyable
 	{
+		friend class XMLNodeView;
+		friend class XMLAttributeView;
+
 	public:
 		XMLDocument();
 
+		// Accepts both XML text and the compiled form written by Compile().
 		XMLNodePtr Parse(ResIdentifierPtr const & source);
 		void Print(std::ostream& os);
 
+		// The compiled form stores the tree as flat node and attribute tables over an interned string pool.
+		// Numbers in it are converted once, so loading it needs neither tokenizing nor per-value parsing.
+		void Compile(std::ostream& os, uint64_t source_timestamp);
+		static bool IsCompiled(ResIdentifierPtr const & source, uint64_t& source_timestamp);
+
 		XMLNodePtr CloneNode(XMLNodePtr const & node);
 
 		XMLNodePtr AllocNode(XMLNodeType type, std::string_view name);
@@ -80,9 +338,17 @@ namespace KlayGE
 
 		void RootNode(XMLNodePtr const & new_node);
 
+	private:
+		void LoadCompiled();
+		bool TryCompiledValue(std::string_view str, int32_t& val) const;
+		bool TryCompiledValue(std::string_view str, uint32_t& val) const;
+		bool TryCompiledValue(std::string_view str, float& val) const;
+
 	private:
 		std::shared_ptr<rapidxml::xml_document<char>> doc_;
 		std::vector<char> xml_src_;
+		char const * compiled_strings_begin_;
+		char const * compiled_strings_end_;
 
 		XMLNodePtr root_;
 	};
@@ -92,9 +358,15 @@ namespace KlayGE
 		friend class XMLDocument;
 
 	public:
-		explicit XMLNode(rapidxml::xml_node<char>* node);
+		XMLNode(XMLDocument const * doc, rapidxml::xml_node<char>* node);
+		explicit XMLNode(XMLNodeView const & view);
 		XMLNode(rapidxml::xml_document<char>& doc, XMLNodeType type, std::string_view name);
 
+		XMLNodeView View() const noexcept
+		{
+			return XMLNodeView(doc_, node_);
+		}
+
 		std::string_view Name() const;
 		XMLNodeType Type() const;
 
@@ -144,6 +416,7 @@ namespace KlayGE
 		std::string_view ValueString() const;
 
 	private:
+		XMLDocument const * doc_;
 		rapidxml::xml_node<char>* node_;
 		std::string_view name_;
 
@@ -157,9 +430,15 @@ namespace KlayGE
 		friend class XMLNode;
 
 	public:
-		explicit XMLAttribute(rapidxml::xml_attribute<char>* attr);
+		XMLAttribute(XMLDocument const * doc, rapidxml::xml_attribute<char>* attr);
+		explicit XMLAttribute(XMLAttributeView const & view);
 		XMLAttribute(rapidxml::xml_document<char>& doc, std::string_view name, std::string_view value);
 
+		XMLAttributeView View() const noexcept
+		{
+			return XMLAttributeView(doc_, attr_);
+		}
+
 		std::string_view Name() const;
 
 		XMLAttributePtr NextAttrib(std::string_view name) const;
@@ -175,6 +454,7 @@ namespace KlayGE
 		std::string_view ValueString() const;
 
 	private:
+		XMLDocument const * doc_;
 		rapidxml::xml_attribute<char>* attr_;
 		std::string_view name_;
 		std::string_view value_;
@@ -29,16 +29,22 @@
  */
 
 #include <KFL/KFL.hpp>
-#include <KFL/ArrayRef.hpp>
-#include <KFL/CustomizedStreamBuf.hpp>
 
-#include <cstdarg>
-#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
 #include <iostream>
+#include <mutex>
+#include <streambuf>
+#include <thread>
+#include <unordered_map>
+
+#include <boost/lockfree/spsc_queue.hpp>
 
 #ifdef KLAYGE_PLATFORM_ANDROID
 #include <android/log.h>
-#include <cstring>
 #else
 #include <fstream>
 #endif
@@ -49,151 +55,491 @@ namespace
 {
 	using namespace KlayGE;
 
-#ifdef KLAYGE_PLATFORM_ANDROID
-	class AndroidLogStreamCallback : boost::noncopyable
+	uint32_t const LOG_BUFFER_SIZE = 64 * 1024;
+	std::chrono::milliseconds const FLUSH_INTERVAL(10);
+
+	// At most RATE_LIMIT_COUNT records with the same key are written in a RATE_LIMIT_WINDOW
+	uint32_t const RATE_LIMIT_COUNT = 8;
+	std::chrono::seconds const RATE_LIMIT_WINDOW(1);
+
+	struct RecordHeader
+	{
+		uint64_t seq;
+		uint64_t key;
+		uint32_t length;
+		LogLevel level;
+	};
+
+	struct Record
+	{
+		RecordHeader header;
+		std::string text;
+	};
+
+	// Written by one thread, read by the flusher
+	class ThreadLogBuffer : boost::noncopyable
 	{
 	public:
-		explicit AndroidLogStreamCallback(int prio)
-			: prio_(prio)
+		bool Push(char const * data, size_t size)
 		{
+			// A record is pushed in one go, so the flusher never sees half of it
+			if (queue_.write_available() < size)
+			{
+				return false;
+			}
+			queue_.push(data, size);
+			return true;
 		}
-		AndroidLogStreamCallback(AndroidLogStreamCallback&& rhs)
-			: prio_(rhs.prio_)
+
+		bool HalfFull() const
 		{
+			return queue_.write_available() < LOG_BUFFER_SIZE / 2;
 		}
 
-		std::streambuf::int_type operator()(void const * buff, std::streamsize count)
+		void PopAll(std::vector<Record>& records)
 		{
-			std::vector<char> tmp(count + 1);
-			std::memcpy(tmp.data(), buff, count);
-			tmp.back() = 0;
-			__android_log_write(prio_, "KlayGE", tmp.data());
-			return static_cast<std::streambuf::int_type>(count);
+			RecordHeader header;
+			while (queue_.pop(reinterpret_cast<char*>(&header), sizeof(header)) == sizeof(header))
+			{
+				Record record;
+				record.header = header;
+				record.text.resize(header.length);
+				queue_.pop(&record.text[0], header.length);
+				records.push_back(std::move(record));
+			}
+		}
+
+		bool Empty() const
+		{
+			return queue_.read_available() == 0;
 		}
 
 	private:
-		int prio_;
+		boost::lockfree::spsc_queue<char, boost::lockfree::capacity<LOG_BUFFER_SIZE>> queue_;
 	};
+	typedef std::shared_ptr<ThreadLogBuffer> ThreadLogBufferPtr;
 
-	template <int PRIO>
-	std::ostream& AndroidLog()
-	{
-		static CallbackOutputStreamBuf<AndroidLogStreamCallback> log_stream_buff((AndroidLogStreamCallback(PRIO)));
-		static std::ostream log_stream(&log_stream_buff);
-		return log_stream;
-	}
-#else
-	class MultiOStreamsCallback : boost::noncopyable
+	class Logger : boost::noncopyable
 	{
 	public:
-		explicit MultiOStreamsCallback(ArrayRef<std::ostream*> oss)
-			: oss_(oss)
+		static Logger& Instance()
 		{
+			static Logger logger;
+			return logger;
 		}
-		MultiOStreamsCallback(MultiOStreamsCallback&& rhs)
-			: oss_(std::move(rhs.oss_))
+
+		ThreadLogBufferPtr RegisterThread()
 		{
+			auto buffer = MakeSharedPtr<ThreadLogBuffer>();
+
+			std::lock_guard<std::mutex> lock(buffers_mutex_);
+			buffers_.push_back(buffer);
+			return buffer;
 		}
 
-		std::streambuf::int_type operator()(void const * buff, std::streamsize count)
+		void Write(ThreadLogBuffer& buffer, std::string& scratch, LogLevel level, uint64_t key, std::string_view text)
 		{
-			for (auto& os : oss_)
+			RecordHeader header;
+			header.seq = seq_.fetch_add(1, std::memory_order_relaxed);
+			header.key = key;
+			header.length = static_cast<uint32_t>(std::min<size_t>(text.size(), LOG_BUFFER_SIZE - 1 - sizeof(header)));
+			header.level = level;
+
+			scratch.resize(sizeof(header) + header.length);
+			memcpy(&scratch[0], &header, sizeof(header));
+			memcpy(&scratch[sizeof(header)], text.data(), header.length);
+
+			// A full buffer waits for the flusher instead of dropping the record
+			while (!buffer.Push(scratch.data(), scratch.size()))
 			{
-				os->write(static_cast<char const *>(buff), count);
+				this->Wake();
+				std::this_thread::yield();
 			}
-			return static_cast<std::streambuf::int_type>(count);
+
+			if (level >= LL_Error)
+			{
+				// Errors are usually followed by a throw or a terminate, so they are out before Write returns
+				this->Drain();
+			}
+			else if (buffer.HalfFull())
+			{
+				this->Wake();
+			}
+		}
+
+		void Flush()
+		{
+			this->Drain();
 		}
 
 	private:
-		ArrayRef<std::ostream*> oss_;
-	};
+		Logger()
+			: seq_(0), quit_(false), last_sweep_(std::chrono::steady_clock::now())
+		{
+			flusher_ = std::thread([this] { this->Run(); });
+		}
+
+		~Logger()
+		{
+			quit_ = true;
+			this->Wake();
+			flusher_.join();
+
+			this->Drain();
+
+			for (auto& repeat : repeats_)
+			{
+				this->EndRepeatWindow(repeat.second);
+			}
+			this->FlushSinks();
+		}
+
+		void Wake()
+		{
+			wake_cv_.notify_one();
+		}
+
+		void Run()
+		{
+			while (!quit_)
+			{
+				{
+					std::unique_lock<std::mutex> lock(wake_mutex_);
+					wake_cv_.wait_for(lock, FLUSH_INTERVAL);
+				}
+
+				this->Drain();
+			}
+		}
+
+		// Only one thread at a time consumes the buffers
+		void Drain()
+		{
+			std::lock_guard<std::mutex> drain_lock(drain_mutex_);
+
+			records_.clear();
+			{
+				std::lock_guard<std::mutex> lock(buffers_mutex_);
+				for (auto iter = buffers_.begin(); iter != buffers_.end();)
+				{
+					(*iter)->PopAll(records_);
+
+					// The thread is gone and everything it wrote is out
+					if ((iter->use_count() == 1) && (*iter)->Empty())
+					{
+						iter = buffers_.erase(iter);
+					}
+					else
+					{
+						++ iter;
+					}
+				}
+			}
+
+			// Each buffer is in order already, but records from different threads are interleaved
+			std::sort(records_.begin(), records_.end(),
+				[](Record const & lhs, Record const & rhs)
+				{
+					return lhs.header.seq < rhs.header.seq;
+				});
+
+			auto const now = std::chrono::steady_clock::now();
+			for (auto const & record : records_)
+			{
+				auto& repeat = repeats_[record.header.key];
+				if (now - repeat.window_begin > RATE_LIMIT_WINDOW)
+				{
+					this->EndRepeatWindow(repeat);
+					repeat.window_begin = now;
+				}
+
+				++ repeat.count;
+				if (repeat.count <= RATE_LIMIT_COUNT)
+				{
+					this->Output(record.header.level, record.text);
+				}
+				else
+				{
+					if (0 == repeat.suppressed)
+					{
+						repeat.level = record.header.level;
+						repeat.sample = record.text.substr(0, record.text.find('\n'));
+					}
+					++ repeat.suppressed;
+				}
+			}
+
+			if (now - last_sweep_ > RATE_LIMIT_WINDOW)
+			{
+				for (auto iter = repeats_.begin(); iter != repeats_.end();)
+				{
+					if (now - iter->second.window_begin > RATE_LIMIT_WINDOW)
+					{
+						this->EndRepeatWindow(iter->second);
+						iter = repeats_.erase(iter);
+					}
+					else
+					{
+						++ iter;
+					}
+				}
+				last_sweep_ = now;
+			}
+
+			if (!records_.empty())
+			{
+				this->FlushSinks();
+			}
+		}
+
+		struct RepeatState
+		{
+			std::chrono::steady_clock::time_point window_begin;
+			uint32_t count = 0;
+			uint32_t suppressed = 0;
+			LogLevel level;
+			std::string sample;
+		};
+
+		void EndRepeatWindow(RepeatState& repeat)
+		{
+			if (repeat.suppressed > 0)
+			{
+				this->Output(repeat.level, repeat.sample + " (" + std::to_string(repeat.suppressed) + " more suppressed)");
+			}
+			repeat.count = 0;
+			repeat.suppressed = 0;
+		}
+
+#ifdef KLAYGE_PLATFORM_ANDROID
+		void Output(LogLevel level, std::string const & text)
+		{
+			static int const prios[] = { ANDROID_LOG_DEBUG, ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR };
+			__android_log_write(prios[level], "KlayGE", text.c_str());
+		}
+
+		void FlushSinks()
+		{
+		}
+#else
+		void Output(LogLevel level, std::string const & text)
+		{
+			static char const * prefixes[] = { "(DEBUG) KlayGE: ", "(INFO) KlayGE: ", "(WARN) KlayGE: ", "(ERROR) KlayGE: " };
+
+			line_ = prefixes[level];
+			line_ += text;
+			if (line_.back() != '\n')
+			{
+				line_ += '\n';
+			}
 
-	std::ostream& Log()
-	{
 #ifdef KLAYGE_DEBUG
-		static std::ofstream log_file("KlayGE.log");
+			log_file_.write(line_.data(), line_.size());
 #endif
+			std::clog.write(line_.data(), line_.size());
+		}
 
-		static std::ostream* oss[] =
+		void FlushSinks()
 		{
 #ifdef KLAYGE_DEBUG
-			&log_file,
+			log_file_.flush();
 #endif
-			&std::clog
-		};
-		static CallbackOutputStreamBuf<MultiOStreamsCallback> log_stream_buff((MultiOStreamsCallback(oss)));
-		static std::ostream log_stream(&log_stream_buff);
-		return log_stream;
-	}
+			std::clog.flush();
+		}
 #endif
 
-#ifndef KLAYGE_DEBUG
-	class EmptyOStreamsCallback : boost::noncopyable
+	private:
+		std::mutex buffers_mutex_;
+		std::vector<ThreadLogBufferPtr> buffers_;
+		std::atomic<uint64_t> seq_;
+
+		std::mutex wake_mutex_;
+		std::condition_variable wake_cv_;
+		std::atomic<bool> quit_;
+		std::thread flusher_;
+
+		std::mutex drain_mutex_;
+		std::vector<Record> records_;
+		std::unordered_map<uint64_t, RepeatState> repeats_;
+		std::chrono::steady_clock::time_point last_sweep_;
+		std::string line_;
+
+#if !defined(KLAYGE_PLATFORM_ANDROID) && defined(KLAYGE_DEBUG)
+		std::ofstream log_file_{"KlayGE.log"};
+#endif
+	};
+
+	// Collects what is streamed in, and hands it to the logger as one record at each flush
+	class LogStreamBuf : public std::streambuf
 	{
 	public:
-		EmptyOStreamsCallback()
+		LogStreamBuf(LogLevel level, ThreadLogBuffer& buffer, std::string& scratch)
+			: level_(level), buffer_(buffer), scratch_(scratch)
 		{
 		}
-		EmptyOStreamsCallback(EmptyOStreamsCallback&& rhs)
+		~LogStreamBuf() override
 		{
-			KFL_UNUSED(rhs);
+			this->sync();
 		}
 
-		std::streambuf::int_type operator()(void const * buff, std::streamsize count)
+	protected:
+		int_type overflow(int_type ch) override
 		{
-			KFL_UNUSED(buff);
-			return static_cast<std::streambuf::int_type>(count);
+			if (!traits_type::eq_int_type(ch, traits_type::eof()))
+			{
+				text_ += traits_type::to_char_type(ch);
+			}
+			return traits_type::not_eof(ch);
 		}
+
+		std::streamsize xsputn(char_type const * s, std::streamsize count) override
+		{
+			text_.append(s, static_cast<size_t>(count));
+			return count;
+		}
+
+		int sync() override
+		{
+			if (!text_.empty())
+			{
+				Logger::Instance().Write(buffer_, scratch_, level_, std::hash<std::string>()(text_), text_);
+				text_.clear();
+			}
+			return 0;
+		}
+
+	private:
+		LogLevel level_;
+		ThreadLogBuffer& buffer_;
+		std::string& scratch_;
+		std::string text_;
 	};
 
-	std::ostream& EmptyLog()
+	// Everything a thread needs to log. The streams are declared after the buffer, so they are destroyed first and can flush into it.
+	class ThreadLog : boost::noncopyable
 	{
-		static CallbackOutputStreamBuf<EmptyOStreamsCallback> empty_stream_buff((EmptyOStreamsCallback()));
-		static std::ostream empty_stream(&empty_stream_buff);
-		return empty_stream;
+	public:
+		ThreadLog()
+			: buffer_(Logger::Instance().RegisterThread()),
+				stream_buffs_{ { LL_Debug, *buffer_, scratch_ }, { LL_Info, *buffer_, scratch_ },
+					{ LL_Warn, *buffer_, scratch_ }, { LL_Error, *buffer_, scratch_ } },
+				streams_{ std::ostream(&stream_buffs_[LL_Debug]), std::ostream(&stream_buffs_[LL_Info]),
+					std::ostream(&stream_buffs_[LL_Warn]), std::ostream(&stream_buffs_[LL_Error]) }
+		{
+		}
+
+		static ThreadLog& Instance()
+		{
+			static thread_local ThreadLog thread_log;
+			return thread_log;
+		}
+
+		std::ostream& Stream(LogLevel level)
+		{
+			return streams_[level];
+		}
+
+		void Write(LogLevel level, uint64_t key, std::string_view text)
+		{
+			Logger::Instance().Write(*buffer_, scratch_, level, key, text);
+		}
+
+		std::string& Text()
+		{
+			return text_;
+		}
+
+	private:
+		ThreadLogBufferPtr buffer_;
+		std::string scratch_;
+		std::string text_;
+		LogStreamBuf stream_buffs_[4];
+		std::ostream streams_[4];
+	};
+
+	class EmptyStreamBuf : public std::streambuf
+	{
+	protected:
+		int_type overflow(int_type ch) override
+		{
+			return traits_type::not_eof(ch);
+		}
+
+		std::streamsize xsputn(char_type const * s, std::streamsize count) override
+		{
+			KFL_UNUSED(s);
+			return count;
+		}
+	};
+
+	std::ostream& LogStream(LogLevel level)
+	{
+		if (level >= KLAYGE_LOG_MIN_LEVEL)
+		{
+			return ThreadLog::Instance().Stream(level);
+		}
+		else
+		{
+			static EmptyStreamBuf empty_stream_buff;
+			static std::ostream empty_stream(&empty_stream_buff);
+			return empty_stream;
+		}
 	}
-#endif
 }
 
 namespace KlayGE
 {
 	std::ostream& LogDebug()
 	{
-#ifdef KLAYGE_DEBUG
-#ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_DEBUG>();
-#else
-		return Log() << "(DEBUG) KlayGE: ";
-#endif
-#else
-		return EmptyLog();
-#endif
+		return LogStream(LL_Debug);
 	}
 
 	std::ostream& LogInfo()
 	{
-#ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_INFO>();
-#else
-		return Log() << "(INFO) KlayGE: ";
-#endif
+		return LogStream(LL_Info);
 	}
 
 	std::ostream& LogWarn()
 	{
-#ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_WARN>();
-#else
-		return Log() << "(WARN) KlayGE: ";
-#endif
+		return LogStream(LL_Warn);
 	}
 
 	std::ostream& LogError()
 	{
-#ifdef KLAYGE_PLATFORM_ANDROID
-		return AndroidLog<ANDROID_LOG_ERROR>();
-#else
-		return Log() << "(ERROR) KlayGE: ";
-#endif
+		return LogStream(LL_Error);
+	}
+
+	void LogWrite(LogLevel level, std::string_view msg, std::initializer_list<LogField> fields)
+	{
+		auto& thread_log = ThreadLog::Instance();
+
+		auto& text = thread_log.Text();
+		text.assign(msg.begin(), msg.end());
+		for (auto const & field : fields)
+		{
+			text += ' ';
+			text.append(field.Key().begin(), field.Key().end());
+			text += '=';
+
+			std::string const & value = field.Value();
+			if (value.empty() || (value.find_first_of(" \t\n\"") != std::string::npos))
+			{
+				text += '"';
+				text += value;
+				text += '"';
+			}
+			else
+			{
+				text += value;
+			}
+		}
+
+		uint64_t const key = std::hash<std::string_view>()(msg) * 4 + level;
+		thread_log.Write(level, key, text);
+	}
+
+	void LogFlush()
+	{
+		Logger::Instance().Flush();
 	}
 }
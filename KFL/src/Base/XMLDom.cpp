@@ -32,7 +32,12 @@
 #include <KFL/Util.hpp>
 #include <KFL/ResIdentifier.hpp>
 
+#include <KFL/ErrorHandling.hpp>
+
+#include <cstring>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 
 #include <boost/lexical_cast.hpp>
 
@@ -58,10 +63,307 @@
 
 #include <KFL/XMLDom.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t constexpr COMPILED_XML_FOURCC = MakeFourCC<'K', 'X', 'M', 'L'>::value;
+	uint32_t constexpr COMPILED_XML_VERSION = 1;
+
+	// All fields are little endian. Nodes are stored in document order, so a parent always precedes its children.
+	// Attributes are stored in the order of their nodes.
+	struct CompiledHeader
+	{
+		uint32_t fourcc;
+		uint32_t version;
+		uint64_t source_timestamp;
+		uint32_t num_nodes;
+		uint32_t num_attribs;
+		uint32_t strings_size;
+		uint32_t reserved;
+	};
+	static_assert(sizeof(CompiledHeader) == 32);
+
+	struct CompiledNode
+	{
+		uint32_t type;
+		uint32_t name;
+		uint32_t value;
+		uint32_t parent;
+		uint32_t num_attribs;
+	};
+	static_assert(sizeof(CompiledNode) == 20);
+
+	struct CompiledAttrib
+	{
+		uint32_t name;
+		uint32_t value;
+	};
+	static_assert(sizeof(CompiledAttrib) == 8);
+
+	// Every string in the pool is prefixed with its length and numeric interpretation, and followed by a '\0'.
+	// Names and values in the tree point right after the prefix. The prefix isn't aligned.
+	struct CompiledString
+	{
+		uint32_t length_flags;
+		uint32_t bits;
+	};
+	static_assert(sizeof(CompiledString) == 8);
+
+	uint32_t constexpr CS_LENGTH_MASK = (1UL << 28) - 1;
+
+	// An integer is stored in bits. A float is stored in bits only if the string isn't an integer,
+	// since converting the integer gives the same value as parsing it.
+	enum CompiledValueFlag
+	{
+		CVF_Int = 1UL << 28,
+		CVF_UInt = 1UL << 29,
+		CVF_Float = 1UL << 30
+	};
+
+	rapidxml::node_type ToRapidXMLNodeType(XMLNodeType type)
+	{
+		switch (type)
+		{
+		case XNT_Document:
+			return rapidxml::node_document;
+
+		case XNT_Element:
+			return rapidxml::node_element;
+
+		case XNT_Data:
+			return rapidxml::node_data;
+
+		case XNT_CData:
+			return rapidxml::node_cdata;
+
+		case XNT_Comment:
+			return rapidxml::node_comment;
+
+		case XNT_Declaration:
+			return rapidxml::node_declaration;
+
+		case XNT_Doctype:
+			return rapidxml::node_doctype;
+
+		case XNT_PI:
+		default:
+			return rapidxml::node_pi;
+		}
+	}
+
+	XMLNodeType FromRapidXMLNodeType(rapidxml::node_type type)
+	{
+		switch (type)
+		{
+		case rapidxml::node_document:
+			return XNT_Document;
+
+		case rapidxml::node_element:
+			return XNT_Element;
+
+		case rapidxml::node_data:
+			return XNT_Data;
+
+		case rapidxml::node_cdata:
+			return XNT_CData;
+
+		case rapidxml::node_comment:
+			return XNT_Comment;
+
+		case rapidxml::node_declaration:
+			return XNT_Declaration;
+
+		case rapidxml::node_doctype:
+			return XNT_Doctype;
+
+		case rapidxml::node_pi:
+		default:
+			return XNT_PI;
+		}
+	}
+
+	void HeaderLE2Native(CompiledHeader& header)
+	{
+		header.fourcc = LE2Native(header.fourcc);
+		header.version = LE2Native(header.version);
+		header.source_timestamp = LE2Native(header.source_timestamp);
+		header.num_nodes = LE2Native(header.num_nodes);
+		header.num_attribs = LE2Native(header.num_attribs);
+		header.strings_size = LE2Native(header.strings_size);
+	}
+
+	// Nodes cloned from other documents or allocated later keep their own strings, so the range check is required
+	CompiledString FindCompiledString(char const * begin, char const * end, std::string_view str)
+	{
+		if ((str.data() >= begin) && (str.data() < end))
+		{
+			CompiledString cs;
+			std::memcpy(&cs, str.data() - sizeof(cs), sizeof(cs));
+			if ((cs.length_flags & CS_LENGTH_MASK) == str.size())
+			{
+				return cs;
+			}
+		}
+		return CompiledString{ 0, 0 };
+	}
+
+	class XMLCompiler
+	{
+	public:
+		void Compile(rapidxml::xml_node<char> const & doc, std::ostream& os, uint64_t source_timestamp);
+
+	private:
+		void AddNode(rapidxml::xml_node<char> const & node, uint32_t parent);
+		uint32_t InternString(std::string_view str);
+
+	private:
+		std::vector<CompiledNode> nodes_;
+		std::vector<CompiledAttrib> attribs_;
+		std::vector<char> strings_;
+		std::unordered_map<std::string_view, uint32_t> string_offsets_;
+	};
+}
+
+namespace
+{
+	void XMLCompiler::Compile(rapidxml::xml_node<char> const & doc, std::ostream& os, uint64_t source_timestamp)
+	{
+		this->AddNode(doc, 0);
+
+		CompiledHeader header;
+		header.fourcc = Native2LE(COMPILED_XML_FOURCC);
+		header.version = Native2LE(COMPILED_XML_VERSION);
+		header.source_timestamp = Native2LE(source_timestamp);
+		header.num_nodes = Native2LE(static_cast<uint32_t>(nodes_.size()));
+		header.num_attribs = Native2LE(static_cast<uint32_t>(attribs_.size()));
+		header.strings_size = Native2LE(static_cast<uint32_t>(strings_.size()));
+		header.reserved = 0;
+		os.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+		for (auto& node : nodes_)
+		{
+			node.type = Native2LE(node.type);
+			node.name = Native2LE(node.name);
+			node.value = Native2LE(node.value);
+			node.parent = Native2LE(node.parent);
+			node.num_attribs = Native2LE(node.num_attribs);
+		}
+		os.write(reinterpret_cast<char const *>(nodes_.data()), nodes_.size() * sizeof(nodes_[0]));
+
+		for (auto& attrib : attribs_)
+		{
+			attrib.name = Native2LE(attrib.name);
+			attrib.value = Native2LE(attrib.value);
+		}
+		os.write(reinterpret_cast<char const *>(attribs_.data()), attribs_.size() * sizeof(attribs_[0]));
+
+		os.write(strings_.data(), strings_.size());
+	}
+
+	void XMLCompiler::AddNode(rapidxml::xml_node<char> const & node, uint32_t parent)
+	{
+		uint32_t const index = static_cast<uint32_t>(nodes_.size());
+		uint32_t const first_attrib = static_cast<uint32_t>(attribs_.size());
+		nodes_.emplace_back();
+
+		{
+			CompiledNode& compiled_node = nodes_.back();
+			compiled_node.type = FromRapidXMLNodeType(node.type());
+			compiled_node.parent = parent;
+		}
+
+		// InternString could reallocate nodes_, so the offsets are assigned by index
+		uint32_t const name = this->InternString(std::string_view(node.name(), node.name_size()));
+		uint32_t const value = this->InternString(std::string_view(node.value(), node.value_size()));
+		nodes_[index].name = name;
+		nodes_[index].value = value;
+
+		for (auto const * attr = node.first_attribute(); attr; attr = attr->next_attribute())
+		{
+			CompiledAttrib compiled_attrib;
+			compiled_attrib.name = this->InternString(std::string_view(attr->name(), attr->name_size()));
+			compiled_attrib.value = this->InternString(std::string_view(attr->value(), attr->value_size()));
+			attribs_.push_back(compiled_attrib);
+		}
+		nodes_[index].num_attribs = static_cast<uint32_t>(attribs_.size()) - first_attrib;
+
+		for (auto const * child = node.first_node(); child; child = child->next_sibling())
+		{
+			this->AddNode(*child, index);
+		}
+	}
+
+	uint32_t XMLCompiler::InternString(std::string_view str)
+	{
+		auto iter = string_offsets_.find(str);
+		if (iter != string_offsets_.end())
+		{
+			return iter->second;
+		}
+
+		Verify(str.size() <= CS_LENGTH_MASK);
+
+		CompiledString cs;
+		cs.length_flags = static_cast<uint32_t>(str.size());
+		cs.bits = 0;
+
+		int32_t int_val;
+		uint32_t uint_val;
+		float float_val;
+		if (boost::conversion::try_lexical_convert(str, int_val))
+		{
+			cs.length_flags |= CVF_Int;
+			cs.bits = static_cast<uint32_t>(int_val);
+		}
+		if (boost::conversion::try_lexical_convert(str, uint_val) && (str.front() != '-'))
+		{
+			cs.length_flags |= CVF_UInt;
+			cs.bits = uint_val;
+		}
+		if (boost::conversion::try_lexical_convert(str, float_val))
+		{
+			cs.length_flags |= CVF_Float;
+			if (!(cs.length_flags & (CVF_Int | CVF_UInt)))
+			{
+				std::memcpy(&cs.bits, &float_val, sizeof(float_val));
+			}
+		}
+
+		cs.length_flags = Native2LE(cs.length_flags);
+		cs.bits = Native2LE(cs.bits);
+
+		uint32_t const offset = static_cast<uint32_t>(strings_.size() + sizeof(cs));
+		strings_.resize(offset + str.size() + 1, '\0');
+		std::memcpy(&strings_[offset - sizeof(cs)], &cs, sizeof(cs));
+		std::memcpy(&strings_[offset], str.data(), str.size());
+
+		string_offsets_.emplace(str, offset);
+		return offset;
+	}
+}
+
+namespace
+{
+	XMLNodePtr ToNodePtr(XMLNodeView const & view)
+	{
+		return view ? MakeSharedPtr<XMLNode>(view) : XMLNodePtr();
+	}
+
+	XMLAttributePtr ToAttributePtr(XMLAttributeView const & view)
+	{
+		return view ? MakeSharedPtr<XMLAttribute>(view) : XMLAttributePtr();
+	}
+
+	static_assert(std::is_trivially_copyable<XMLNodeView>::value);
+	static_assert(std::is_trivially_copyable<XMLAttributeView>::value);
+}
+
 namespace KlayGE
 {
 	XMLDocument::XMLDocument()
-		: doc_(MakeSharedPtr<rapidxml::xml_document<char>>())
+		: doc_(MakeSharedPtr<rapidxml::xml_document<char>>()),
+			compiled_strings_begin_(nullptr), compiled_strings_end_(nullptr)
 	{
 	}
 
@@ -73,12 +375,192 @@ namespace KlayGE
 		xml_src_.resize(len + 1, 0);
 		source->read(&xml_src_[0], len);
 
-		doc_->parse<0>(&xml_src_[0]);
-		root_ = MakeSharedPtr<XMLNode>(doc_->first_node());
+		uint32_t fourcc = 0;
+		if (len >= static_cast<int>(sizeof(CompiledHeader)))
+		{
+			std::memcpy(&fourcc, &xml_src_[0], sizeof(fourcc));
+		}
+		if (LE2Native(fourcc) == COMPILED_XML_FOURCC)
+		{
+			xml_src_.resize(len);
+			this->LoadCompiled();
+		}
+		else
+		{
+			compiled_strings_begin_ = nullptr;
+			compiled_strings_end_ = nullptr;
+			doc_->parse<0>(&xml_src_[0]);
+		}
+		root_ = MakeSharedPtr<XMLNode>(this, doc_->first_node());
 
 		return root_;
 	}
 
+	void XMLDocument::Compile(std::ostream& os, uint64_t source_timestamp)
+	{
+		XMLCompiler compiler;
+		compiler.Compile(*doc_, os, source_timestamp);
+	}
+
+	bool XMLDocument::IsCompiled(ResIdentifierPtr const & source, uint64_t& source_timestamp)
+	{
+		source->seekg(0, std::ios_base::end);
+		int64_t const len = source->tellg();
+		source->seekg(0, std::ios_base::beg);
+
+		CompiledHeader header;
+		source->read(&header, sizeof(header));
+		bool const has_header = (source->gcount() == static_cast<int64_t>(sizeof(header)));
+		source->clear();
+		source->seekg(0, std::ios_base::beg);
+		if (!has_header)
+		{
+			return false;
+		}
+
+		HeaderLE2Native(header);
+		int64_t const expected_len = sizeof(header) + static_cast<int64_t>(header.num_nodes) * sizeof(CompiledNode)
+			+ static_cast<int64_t>(header.num_attribs) * sizeof(CompiledAttrib) + header.strings_size;
+		if ((header.fourcc == COMPILED_XML_FOURCC) && (header.version == COMPILED_XML_VERSION) && (len == expected_len))
+		{
+			source_timestamp = header.source_timestamp;
+			return true;
+		}
+		return false;
+	}
+
+	void XMLDocument::LoadCompiled()
+	{
+		CompiledHeader header;
+		std::memcpy(&header, xml_src_.data(), sizeof(header));
+		HeaderLE2Native(header);
+		Verify(header.version == COMPILED_XML_VERSION);
+		Verify(header.num_nodes > 0);
+
+		size_t const nodes_offset = sizeof(header);
+		size_t const attribs_offset = nodes_offset + header.num_nodes * sizeof(CompiledNode);
+		size_t const strings_offset = attribs_offset + header.num_attribs * sizeof(CompiledAttrib);
+		Verify(strings_offset + header.strings_size == xml_src_.size());
+
+		auto* nodes = reinterpret_cast<CompiledNode*>(&xml_src_[nodes_offset]);
+		auto* attribs = reinterpret_cast<CompiledAttrib*>(&xml_src_[attribs_offset]);
+		char* strings = &xml_src_[strings_offset];
+		compiled_strings_begin_ = strings;
+		compiled_strings_end_ = strings + header.strings_size;
+
+		KLAYGE_IF_CONSTEXPR (std::endian::native != std::endian::little)
+		{
+			for (uint32_t i = 0; i < header.num_nodes; ++ i)
+			{
+				nodes[i].type = LE2Native(nodes[i].type);
+				nodes[i].name = LE2Native(nodes[i].name);
+				nodes[i].value = LE2Native(nodes[i].value);
+				nodes[i].parent = LE2Native(nodes[i].parent);
+				nodes[i].num_attribs = LE2Native(nodes[i].num_attribs);
+			}
+			for (uint32_t i = 0; i < header.num_attribs; ++ i)
+			{
+				attribs[i].name = LE2Native(attribs[i].name);
+				attribs[i].value = LE2Native(attribs[i].value);
+			}
+			for (uint32_t offset = 0; offset < header.strings_size;)
+			{
+				CompiledString cs;
+				std::memcpy(&cs, strings + offset, sizeof(cs));
+				cs.length_flags = LE2Native(cs.length_flags);
+				cs.bits = LE2Native(cs.bits);
+				std::memcpy(strings + offset, &cs, sizeof(cs));
+				offset += static_cast<uint32_t>(sizeof(cs) + (cs.length_flags & CS_LENGTH_MASK) + 1);
+			}
+		}
+
+		auto string_at = [strings, &header](uint32_t offset)
+		{
+			Verify((offset >= sizeof(CompiledString)) && (offset < header.strings_size));
+			uint32_t length_flags;
+			std::memcpy(&length_flags, strings + offset - sizeof(CompiledString), sizeof(length_flags));
+			uint32_t const length = length_flags & CS_LENGTH_MASK;
+			Verify(offset + length < header.strings_size);
+			return std::make_pair(strings + offset, static_cast<size_t>(length));
+		};
+
+		// Only the node and attribute objects come from the document's pool. Names and values stay in the loaded buffer.
+		doc_->remove_all_nodes();
+		doc_->remove_all_attributes();
+
+		std::vector<rapidxml::xml_node<char>*> xml_nodes(header.num_nodes);
+		xml_nodes[0] = doc_.get();
+		uint32_t first_attrib = 0;
+		for (uint32_t i = 0; i < header.num_nodes; ++ i)
+		{
+			auto const & node = nodes[i];
+			if (i > 0)
+			{
+				Verify(node.parent < i);
+
+				auto const name = string_at(node.name);
+				auto const value = string_at(node.value);
+				xml_nodes[i] = doc_->allocate_node(ToRapidXMLNodeType(static_cast<XMLNodeType>(node.type)),
+					name.first, value.first, name.second, value.second);
+				xml_nodes[node.parent]->append_node(xml_nodes[i]);
+			}
+
+			Verify(first_attrib + node.num_attribs <= header.num_attribs);
+			for (uint32_t j = 0; j < node.num_attribs; ++ j)
+			{
+				auto const & attrib = attribs[first_attrib + j];
+				auto const name = string_at(attrib.name);
+				auto const value = string_at(attrib.value);
+				xml_nodes[i]->append_attribute(doc_->allocate_attribute(name.first, value.first, name.second, value.second));
+			}
+			first_attrib += node.num_attribs;
+		}
+	}
+
+	bool XMLDocument::TryCompiledValue(std::string_view str, int32_t& val) const
+	{
+		CompiledString const cs = FindCompiledString(compiled_strings_begin_, compiled_strings_end_, str);
+		if (cs.length_flags & CVF_Int)
+		{
+			val = static_cast<int32_t>(cs.bits);
+			return true;
+		}
+		return false;
+	}
+
+	bool XMLDocument::TryCompiledValue(std::string_view str, uint32_t& val) const
+	{
+		CompiledString const cs = FindCompiledString(compiled_strings_begin_, compiled_strings_end_, str);
+		if (cs.length_flags & CVF_UInt)
+		{
+			val = cs.bits;
+			return true;
+		}
+		return false;
+	}
+
+	bool XMLDocument::TryCompiledValue(std::string_view str, float& val) const
+	{
+		CompiledString const cs = FindCompiledString(compiled_strings_begin_, compiled_strings_end_, str);
+		if (cs.length_flags & CVF_Float)
+		{
+			if (cs.length_flags & CVF_Int)
+			{
+				val = static_cast<float>(static_cast<int32_t>(cs.bits));
+			}
+			else if (cs.length_flags & CVF_UInt)
+			{
+				val = static_cast<float>(cs.bits);
+			}
+			else
+			{
+				std::memcpy(&val, &cs.bits, sizeof(val));
+			}
+			return true;
+		}
+		return false;
+	}
+
 	void XMLDocument::Print(std::ostream& os)
 	{
 		os << "<?xml version=\"1.0\"?>" << std::endl << std::endl;
@@ -87,12 +569,14 @@ namespace KlayGE
 
 	XMLNodePtr XMLDocument::CloneNode(XMLNodePtr const & node)
 	{
-		return MakeSharedPtr<XMLNode>(doc_->clone_node(node->node_));
+		return MakeSharedPtr<XMLNode>(this, doc_->clone_node(node->node_));
 	}
 
 	XMLNodePtr XMLDocument::AllocNode(XMLNodeType type, std::string_view name)
 	{
-		return MakeSharedPtr<XMLNode>(*doc_, type, name);
+		auto node = MakeSharedPtr<XMLNode>(*doc_, type, name);
+		node->doc_ = this;
+		return node;
 	}
 	
 	XMLAttributePtr XMLDocument::AllocAttribInt(std::string_view name, int32_t value)
@@ -112,8 +596,10 @@ namespace KlayGE
 
 	XMLAttributePtr XMLDocument::AllocAttribString(std::string_view name, std::string_view value)
 	{
-		return MakeSharedPtr<XMLAttribute>(*doc_, std::string_view(doc_->allocate_string(name.data(), name.size()), name.size()),
+		auto attr = MakeSharedPtr<XMLAttribute>(*doc_, std::string_view(doc_->allocate_string(name.data(), name.size()), name.size()),
 			std::string_view(doc_->allocate_string(value.data(), value.size()), value.size()));
+		attr->doc_ = this;
+		return attr;
 	}
 
 	void XMLDocument::RootNode(XMLNodePtr const & new_node)
@@ -124,157 +610,360 @@ namespace KlayGE
 	}
 
 
-	XMLNode::XMLNode(rapidxml::xml_node<char>* node)
-		: node_(node)
+	std::string_view XMLNodeView::Name() const
 	{
-		if (node_ != nullptr)
-		{
-			name_ = std::string_view(node_->name(), node_->name_size());
-		}
+		return std::string_view(node_->name(), node_->name_size());
 	}
 
-	XMLNode::XMLNode(rapidxml::xml_document<char>& doc, XMLNodeType type, std::string_view name)
-		: name_(name)
+	XMLNodeType XMLNodeView::Type() const
 	{
-		rapidxml::node_type xtype;
-		switch (type)
-		{
-		case XNT_Document:
-			xtype = rapidxml::node_document;
-			break;
+		return FromRapidXMLNodeType(node_->type());
+	}
 
-		case XNT_Element:
-			xtype = rapidxml::node_element;
-			break;
+	XMLNodeView XMLNodeView::Parent() const
+	{
+		return XMLNodeView(doc_, node_->parent());
+	}
 
-		case XNT_Data:
-			xtype = rapidxml::node_data;
-			break;
+	XMLAttributeView XMLNodeView::FirstAttrib(std::string_view name) const
+	{
+		return XMLAttributeView(doc_, node_->first_attribute(name.data(), name.size()));
+	}
 
-		case XNT_CData:
-			xtype = rapidxml::node_cdata;
-			break;
+	XMLAttributeView XMLNodeView::LastAttrib(std::string_view name) const
+	{
+		return XMLAttributeView(doc_, node_->last_attribute(name.data(), name.size()));
+	}
 
-		case XNT_Comment:
-			xtype = rapidxml::node_comment;
-			break;
+	XMLAttributeView XMLNodeView::FirstAttrib() const
+	{
+		return XMLAttributeView(doc_, node_->first_attribute());
+	}
 
-		case XNT_Declaration:
-			xtype = rapidxml::node_declaration;
-			break;
+	XMLAttributeView XMLNodeView::LastAttrib() const
+	{
+		return XMLAttributeView(doc_, node_->last_attribute());
+	}
 
-		case XNT_Doctype:
-			xtype = rapidxml::node_doctype;
-			break;
+	XMLAttributeView XMLNodeView::Attrib(std::string_view name) const
+	{
+		return this->FirstAttrib(name);
+	}
 
-		case XNT_PI:
-		default:
-			xtype = rapidxml::node_pi;
-			break;
-		}
+	XMLRange<XMLAttributeIterator> XMLNodeView::Attribs() const
+	{
+		return XMLRange<XMLAttributeIterator>(XMLAttributeIterator(this->FirstAttrib(), std::string_view()));
+	}
 
-		node_ = doc.allocate_node(xtype, name.data(), nullptr, name.size());
+	XMLRange<XMLAttributeIterator> XMLNodeView::Attribs(std::string_view name) const
+	{
+		return XMLRange<XMLAttributeIterator>(XMLAttributeIterator(this->FirstAttrib(name), name));
 	}
 
-	std::string_view XMLNode::Name() const
+	bool XMLNodeView::TryConvertAttrib(std::string_view name, int32_t& val, int32_t default_val) const
 	{
-		return name_;
+		val = default_val;
+
+		auto attr = this->Attrib(name);
+		return attr ? attr.TryConvert(val) : true;
 	}
 
-	XMLNodeType XMLNode::Type() const
+	bool XMLNodeView::TryConvertAttrib(std::string_view name, uint32_t& val, uint32_t default_val) const
 	{
-		switch (node_->type())
-		{
-		case rapidxml::node_document:
-			return XNT_Document;
+		val = default_val;
 
-		case rapidxml::node_element:
-			return XNT_Element;
+		auto attr = this->Attrib(name);
+		return attr ? attr.TryConvert(val) : true;
+	}
 
-		case rapidxml::node_data:
-			return XNT_Data;
+	bool XMLNodeView::TryConvertAttrib(std::string_view name, float& val, float default_val) const
+	{
+		val = default_val;
 
-		case rapidxml::node_cdata:
-			return XNT_CData;
+		auto attr = this->Attrib(name);
+		return attr ? attr.TryConvert(val) : true;
+	}
 
-		case rapidxml::node_comment:
-			return XNT_Comment;
+	int32_t XMLNodeView::AttribInt(std::string_view name, int32_t default_val) const
+	{
+		auto attr = this->Attrib(name);
+		return attr ? attr.ValueInt() : default_val;
+	}
 
-		case rapidxml::node_declaration:
-			return XNT_Declaration;
+	uint32_t XMLNodeView::AttribUInt(std::string_view name, uint32_t default_val) const
+	{
+		auto attr = this->Attrib(name);
+		return attr ? attr.ValueUInt() : default_val;
+	}
 
-		case rapidxml::node_doctype:
-			return XNT_Doctype;
+	float XMLNodeView::AttribFloat(std::string_view name, float default_val) const
+	{
+		auto attr = this->Attrib(name);
+		return attr ? attr.ValueFloat() : default_val;
+	}
 
-		case rapidxml::node_pi:
-		default:
-			return XNT_PI;
+	std::string_view XMLNodeView::AttribString(std::string_view name, std::string_view default_val) const
+	{
+		auto attr = this->Attrib(name);
+		return attr ? attr.ValueString() : default_val;
+	}
+
+	XMLNodeView XMLNodeView::FirstNode(std::string_view name) const
+	{
+		return XMLNodeView(doc_, node_->first_node(name.data(), name.size()));
+	}
+
+	XMLNodeView XMLNodeView::LastNode(std::string_view name) const
+	{
+		return XMLNodeView(doc_, node_->last_node(name.data(), name.size()));
+	}
+
+	XMLNodeView XMLNodeView::FirstNode() const
+	{
+		return XMLNodeView(doc_, node_->first_node());
+	}
+
+	XMLNodeView XMLNodeView::LastNode() const
+	{
+		return XMLNodeView(doc_, node_->last_node());
+	}
+
+	XMLNodeView XMLNodeView::PrevSibling(std::string_view name) const
+	{
+		return XMLNodeView(doc_, node_->previous_sibling(name.data(), name.size()));
+	}
+
+	XMLNodeView XMLNodeView::NextSibling(std::string_view name) const
+	{
+		return XMLNodeView(doc_, node_->next_sibling(name.data(), name.size()));
+	}
+
+	XMLNodeView XMLNodeView::PrevSibling() const
+	{
+		return XMLNodeView(doc_, node_->previous_sibling());
+	}
+
+	XMLNodeView XMLNodeView::NextSibling() const
+	{
+		return XMLNodeView(doc_, node_->next_sibling());
+	}
+
+	XMLRange<XMLNodeIterator> XMLNodeView::Children() const
+	{
+		return XMLRange<XMLNodeIterator>(XMLNodeIterator(this->FirstNode(), std::string_view()));
+	}
+
+	XMLRange<XMLNodeIterator> XMLNodeView::Children(std::string_view name) const
+	{
+		return XMLRange<XMLNodeIterator>(XMLNodeIterator(this->FirstNode(name), name));
+	}
+
+	bool XMLNodeView::TryConvert(int32_t& val) const
+	{
+		auto const str = this->ValueString();
+		if (doc_ && doc_->TryCompiledValue(str, val))
+		{
+			return true;
 		}
+		return boost::conversion::try_lexical_convert(str, val);
 	}
 
-	XMLNodePtr XMLNode::Parent() const
+	bool XMLNodeView::TryConvert(uint32_t& val) const
 	{
-		auto* node = node_->parent();
-		if (node)
+		auto const str = this->ValueString();
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return MakeSharedPtr<XMLNode>(node);
+			return true;
 		}
-		else
+		return boost::conversion::try_lexical_convert(str, val);
+	}
+
+	bool XMLNodeView::TryConvert(float& val) const
+	{
+		auto const str = this->ValueString();
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return XMLNodePtr();
+			return true;
 		}
+		return boost::conversion::try_lexical_convert(str, val);
 	}
 
-	XMLAttributePtr XMLNode::FirstAttrib(std::string_view name) const
+	int32_t XMLNodeView::ValueInt() const
 	{
-		auto* attr = node_->first_attribute(name.data(), name.size());
-		if (attr)
+		auto const str = this->ValueString();
+		int32_t val;
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return MakeSharedPtr<XMLAttribute>(attr);
+			return val;
 		}
-		else
+		return std::stol(std::string(str));
+	}
+
+	uint32_t XMLNodeView::ValueUInt() const
+	{
+		auto const str = this->ValueString();
+		uint32_t val;
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return XMLAttributePtr();
+			return val;
 		}
+		return std::stoul(std::string(str));
 	}
-	
-	XMLAttributePtr XMLNode::LastAttrib(std::string_view name) const
+
+	float XMLNodeView::ValueFloat() const
 	{
-		auto* attr = node_->last_attribute(name.data(), name.size());
-		if (attr)
+		auto const str = this->ValueString();
+		float val;
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return MakeSharedPtr<XMLAttribute>(attr);
+			return val;
 		}
-		else
+		return std::stof(std::string(str));
+	}
+
+	std::string_view XMLNodeView::ValueString() const
+	{
+		return std::string_view(node_->value(), node_->value_size());
+	}
+
+
+	std::string_view XMLAttributeView::Name() const
+	{
+		return std::string_view(attr_->name(), attr_->name_size());
+	}
+
+	XMLAttributeView XMLAttributeView::NextAttrib(std::string_view name) const
+	{
+		return XMLAttributeView(doc_, attr_->next_attribute(name.data(), name.size()));
+	}
+
+	XMLAttributeView XMLAttributeView::NextAttrib() const
+	{
+		return XMLAttributeView(doc_, attr_->next_attribute());
+	}
+
+	bool XMLAttributeView::TryConvert(int32_t& val) const
+	{
+		auto const str = this->ValueString();
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return XMLAttributePtr();
+			return true;
 		}
+		return boost::conversion::try_lexical_convert(str, val);
 	}
 
-	XMLAttributePtr XMLNode::FirstAttrib() const
+	bool XMLAttributeView::TryConvert(uint32_t& val) const
 	{
-		auto* attr = node_->first_attribute();
-		if (attr)
+		auto const str = this->ValueString();
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return MakeSharedPtr<XMLAttribute>(attr);
+			return true;
 		}
-		else
+		return boost::conversion::try_lexical_convert(str, val);
+	}
+
+	bool XMLAttributeView::TryConvert(float& val) const
+	{
+		auto const str = this->ValueString();
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return XMLAttributePtr();
+			return true;
 		}
+		return boost::conversion::try_lexical_convert(str, val);
 	}
 
-	XMLAttributePtr XMLNode::LastAttrib() const
+	int32_t XMLAttributeView::ValueInt() const
 	{
-		auto* attr = node_->last_attribute();
-		if (attr)
+		auto const str = this->ValueString();
+		int32_t val;
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return MakeSharedPtr<XMLAttribute>(attr);
+			return val;
 		}
-		else
+		return std::stol(std::string(str));
+	}
+
+	uint32_t XMLAttributeView::ValueUInt() const
+	{
+		auto const str = this->ValueString();
+		uint32_t val;
+		if (doc_ && doc_->TryCompiledValue(str, val))
+		{
+			return val;
+		}
+		return std::stoul(std::string(str));
+	}
+
+	float XMLAttributeView::ValueFloat() const
+	{
+		auto const str = this->ValueString();
+		float val;
+		if (doc_ && doc_->TryCompiledValue(str, val))
 		{
-			return XMLAttributePtr();
+			return val;
 		}
+		return std::stof(std::string(str));
+	}
+
+	std::string_view XMLAttributeView::ValueString() const
+	{
+		return std::string_view(attr_->value(), attr_->value_size());
+	}
+
+
+	XMLNode::XMLNode(XMLDocument const * doc, rapidxml::xml_node<char>* node)
+		: doc_(doc), node_(node)
+	{
+		if (node_ != nullptr)
+		{
+			name_ = std::string_view(node_->name(), node_->name_size());
+		}
+	}
+
+	XMLNode::XMLNode(XMLNodeView const & view)
+		: XMLNode(view.doc_, view.node_)
+	{
+	}
+
+	XMLNode::XMLNode(rapidxml::xml_document<char>& doc, XMLNodeType type, std::string_view name)
+		: doc_(nullptr), name_(name)
+	{
+		node_ = doc.allocate_node(ToRapidXMLNodeType(type), name.data(), nullptr, name.size());
+	}
+
+	std::string_view XMLNode::Name() const
+	{
+		return name_;
+	}
+
+	XMLNodeType XMLNode::Type() const
+	{
+		return this->View().Type();
+	}
+
+	XMLNodePtr XMLNode::Parent() const
+	{
+		return ToNodePtr(this->View().Parent());
+	}
+
+	XMLAttributePtr XMLNode::FirstAttrib(std::string_view name) const
+	{
+		return ToAttributePtr(this->View().FirstAttrib(name));
+	}
+
+	XMLAttributePtr XMLNode::LastAttrib(std::string_view name) const
+	{
+		return ToAttributePtr(this->View().LastAttrib(name));
+	}
+
+	XMLAttributePtr XMLNode::FirstAttrib() const
+	{
+		return ToAttributePtr(this->View().FirstAttrib());
+	}
+
+	XMLAttributePtr XMLNode::LastAttrib() const
+	{
+		return ToAttributePtr(this->View().LastAttrib());
 	}
 
 	XMLAttributePtr XMLNode::Attrib(std::string_view name) const
@@ -284,154 +973,77 @@ namespace KlayGE
 
 	bool XMLNode::TryConvertAttrib(std::string_view name, int32_t& val, int32_t default_val) const
 	{
-		val = default_val;
-
-		auto attr = this->Attrib(name);
-		return attr ? attr->TryConvert(val) : true;
+		return this->View().TryConvertAttrib(name, val, default_val);
 	}
 
 	bool XMLNode::TryConvertAttrib(std::string_view name, uint32_t& val, uint32_t default_val) const
 	{
-		val = default_val;
-
-		auto attr = this->Attrib(name);
-		return attr ? attr->TryConvert(val) : true;
+		return this->View().TryConvertAttrib(name, val, default_val);
 	}
 
 	bool XMLNode::TryConvertAttrib(std::string_view name, float& val, float default_val) const
 	{
-		val = default_val;
-
-		auto attr = this->Attrib(name);
-		return attr ? attr->TryConvert(val) : true;
+		return this->View().TryConvertAttrib(name, val, default_val);
 	}
 
 	int32_t XMLNode::AttribInt(std::string_view name, int32_t default_val) const
 	{
-		auto attr = this->Attrib(name);
-		return attr ? attr->ValueInt() : default_val;
+		return this->View().AttribInt(name, default_val);
 	}
 
 	uint32_t XMLNode::AttribUInt(std::string_view name, uint32_t default_val) const
 	{
-		auto attr = this->Attrib(name);
-		return attr ? attr->ValueUInt() : default_val;
+		return this->View().AttribUInt(name, default_val);
 	}
 
 	float XMLNode::AttribFloat(std::string_view name, float default_val) const
 	{
-		auto attr = this->Attrib(name);
-		return attr ? attr->ValueFloat() : default_val;
+		return this->View().AttribFloat(name, default_val);
 	}
 
 	std::string_view XMLNode::AttribString(std::string_view name, std::string_view default_val) const
 	{
-		auto attr = this->Attrib(name);
-		return attr ? attr->ValueString() : default_val;
+		return this->View().AttribString(name, default_val);
 	}
 
 	XMLNodePtr XMLNode::FirstNode(std::string_view name) const
 	{
-		auto* node = node_->first_node(name.data(), name.size());
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().FirstNode(name));
 	}
 
 	XMLNodePtr XMLNode::LastNode(std::string_view name) const
 	{
-		auto* node = node_->last_node(name.data(), name.size());
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().LastNode(name));
 	}
 
 	XMLNodePtr XMLNode::FirstNode() const
 	{
-		auto* node = node_->first_node();
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().FirstNode());
 	}
 
 	XMLNodePtr XMLNode::LastNode() const
 	{
-		auto* node = node_->last_node();
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().LastNode());
 	}
 
 	XMLNodePtr XMLNode::PrevSibling(std::string_view name) const
 	{
-		auto* node = node_->previous_sibling(name.data(), name.size());
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().PrevSibling(name));
 	}
 
 	XMLNodePtr XMLNode::NextSibling(std::string_view name) const
 	{
-		auto* node = node_->next_sibling(name.data(), name.size());
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().NextSibling(name));
 	}
 
 	XMLNodePtr XMLNode::PrevSibling() const
 	{
-		auto* node = node_->previous_sibling();
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().PrevSibling());
 	}
 
 	XMLNodePtr XMLNode::NextSibling() const
 	{
-		auto* node = node_->next_sibling();
-		if (node)
-		{
-			return MakeSharedPtr<XMLNode>(node);
-		}
-		else
-		{
-			return XMLNodePtr();
-		}
+		return ToNodePtr(this->View().NextSibling());
 	}
 
 	void XMLNode::InsertNode(XMLNodePtr const & location, XMLNodePtr const & new_node)
@@ -500,42 +1112,42 @@ namespace KlayGE
 
 	bool XMLNode::TryConvert(int32_t& val) const
 	{
-		return boost::conversion::try_lexical_convert(this->ValueString(), val);
+		return this->View().TryConvert(val);
 	}
 
 	bool XMLNode::TryConvert(uint32_t& val) const
 	{
-		return boost::conversion::try_lexical_convert(this->ValueString(), val);
+		return this->View().TryConvert(val);
 	}
 
 	bool XMLNode::TryConvert(float& val) const
 	{
-		return boost::conversion::try_lexical_convert(this->ValueString(), val);
+		return this->View().TryConvert(val);
 	}
 
 	int32_t XMLNode::ValueInt() const
 	{
-		return std::stol(std::string(this->ValueString()));
+		return this->View().ValueInt();
 	}
 
 	uint32_t XMLNode::ValueUInt() const
 	{
-		return std::stoul(std::string(this->ValueString()));
+		return this->View().ValueUInt();
 	}
 
 	float XMLNode::ValueFloat() const
 	{
-		return std::stof(std::string(this->ValueString()));
+		return this->View().ValueFloat();
 	}
 
 	std::string_view XMLNode::ValueString() const
 	{
-		return std::string_view(node_->value(), node_->value_size());
+		return this->View().ValueString();
 	}
 
 
-	XMLAttribute::XMLAttribute(rapidxml::xml_attribute<char>* attr)
-		: attr_(attr)
+	XMLAttribute::XMLAttribute(XMLDocument const * doc, rapidxml::xml_attribute<char>* attr)
+		: doc_(doc), attr_(attr)
 	{
 		if (attr_ != nullptr)
 		{
@@ -545,8 +1157,13 @@ namespace KlayGE
 		}
 	}
 
+	XMLAttribute::XMLAttribute(XMLAttributeView const & view)
+		: XMLAttribute(view.doc_, view.attr_)
+	{
+	}
+
 	XMLAttribute::XMLAttribute(rapidxml::xml_document<char>& doc, std::string_view name, std::string_view value)
-		: name_(name), value_(value)
+		: doc_(nullptr), name_(name), value_(value)
 	{
 		attr_ = doc.allocate_attribute(name.data(), value.data(), name.size(), value.size());
 	}
@@ -558,58 +1175,42 @@ namespace KlayGE
 
 	XMLAttributePtr XMLAttribute::NextAttrib(std::string_view name) const
 	{
-		auto* attr = attr_->next_attribute(name.data(), name.size());
-		if (attr)
-		{
-			return MakeSharedPtr<XMLAttribute>(attr);
-		}
-		else
-		{
-			return XMLAttributePtr();
-		}
+		return ToAttributePtr(this->View().NextAttrib(name));
 	}
 
 	XMLAttributePtr XMLAttribute::NextAttrib() const
 	{
-		auto* attr = attr_->next_attribute();
-		if (attr)
-		{
-			return MakeSharedPtr<XMLAttribute>(attr);
-		}
-		else
-		{
-			return XMLAttributePtr();
-		}
+		return ToAttributePtr(this->View().NextAttrib());
 	}
 
 	bool XMLAttribute::TryConvert(int32_t& val) const
 	{
-		return boost::conversion::try_lexical_convert(value_, val);
+		return this->View().TryConvert(val);
 	}
 
 	bool XMLAttribute::TryConvert(uint32_t& val) const
 	{
-		return boost::conversion::try_lexical_convert(value_, val);
+		return this->View().TryConvert(val);
 	}
 
 	bool XMLAttribute::TryConvert(float& val) const
 	{
-		return boost::conversion::try_lexical_convert(value_, val);
+		return this->View().TryConvert(val);
 	}
 
 	int32_t XMLAttribute::ValueInt() const
 	{
-		return std::stol(std::string(value_));
+		return this->View().ValueInt();
 	}
 
 	uint32_t XMLAttribute::ValueUInt() const
 	{
-		return std::stoul(std::string(value_));
+		return this->View().ValueUInt();
 	}
 
 	float XMLAttribute::ValueFloat() const
 	{
-		return std::stof(std::string(value_));
+		return this->View().ValueFloat();
 	}
 
 	std::string_view XMLAttribute::ValueString() const
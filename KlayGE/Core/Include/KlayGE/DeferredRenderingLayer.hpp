@@ -37,6 +37,7 @@
 
 #include <array>
 #include <functional>
+#include <map>
 
 #include <KlayGE/Light.hpp>
 #include <KlayGE/IndirectLightingLayer.hpp>
@@ -361,6 +362,24 @@ namespace KlayGE
 		uint32_t NumPrimitivesRendered() const;
 		uint32_t NumVerticesRendered() const;
 
+		// Bytes of render targets shared between passes or viewports instead of allocated separately
+		uint64_t TransientRenderTargetMemorySaved() const;
+		uint32_t NumPassScanListRebuilds() const
+		{
+			return num_pass_scan_list_rebuilds_;
+		}
+
+		// Shadow map faces of the current frame whose static casters were rendered, or taken from the cache
+		uint32_t NumShadowFacesRendered() const
+		{
+			return num_shadow_faces_rendered_;
+		}
+		uint32_t NumShadowFacesReused() const
+		{
+			return num_shadow_faces_reused_;
+		}
+		void InvalidateShadowCaches();
+
 #ifndef KLAYGE_SHIP
 		PerfRangePtr const & ShadowMapPerf() const
 		{
@@ -389,9 +408,21 @@ namespace KlayGE
 #endif
 
 	private:
+		// Where a transient target is alive in the jobs of a viewport, in job order
+		enum TransientStage
+		{
+			TS_Lighting,		// G-buffer processing to merging the shading of the last pass
+			TS_PostEffects,		// Post effects and simple forward
+			TS_Finishing		// Depth of field and the copy to the viewport
+		};
+
 		static bool ConfirmDevice();
 
 		void SetupViewportGI(uint32_t vp, bool ssgi_enable);
+		TexturePtr MakeTransientTexture2D(uint32_t vp, TransientStage first_stage, TransientStage last_stage,
+			uint32_t width, uint32_t height, uint32_t num_mip_maps, uint32_t array_size,
+			ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint);
+		void ReleaseTransientTextures(uint32_t vp);
 		void AccumulateToLightingTex(PerViewport const & pvp, PassTargetBuffer pass_tb);
 
 		uint32_t ComposePassScanCode(uint32_t vp_index, PassType pass_type,
@@ -402,6 +433,7 @@ namespace KlayGE
 		void BuildLightList();
 		void BuildVisibleSceneObjList(bool& has_opaque_objs, bool& has_transparency_back_objs, bool& has_transparency_front_objs);
 		void BuildPassScanList(bool has_opaque_objs, bool has_transparency_back_objs, bool has_transparency_front_objs);
+		void MakePassScanKey(std::vector<uint32_t>& key) const;
 		void CheckLightVisible(uint32_t vp_index, uint32_t light_index);
 		void AppendGBufferPassScanCode(uint32_t vp_index, PassTargetBuffer pass_tb);
 		void AppendShadowPassScanCode(uint32_t light_index);
@@ -416,6 +448,9 @@ namespace KlayGE
 		void PrepareLightCamera(PerViewport const & pvp, LightSource const & light,
 			int32_t index_in_pass, PassType pass_type);
 		void PostGenerateShadowMap(PerViewport const & pvp, int32_t org_no, int32_t index_in_pass);
+		void RefreshShadowCasters();
+		void CollectShadowCasters();
+		void UpdateShadowCache(int32_t org_no);
 		void UpdateShadowing(PerViewport const & pvp);
 #if DEFAULT_DEFERRED == LIGHT_INDEXED_DEFERRED
 		void UpdateShadowingCS(PerViewport const & pvp);
@@ -455,6 +490,7 @@ namespace KlayGE
 		uint32_t GBufferProcessingDRJob(PerViewport const & pvp);
 		uint32_t OpaqueGBufferProcessingDRJob(PerViewport const & pvp);
 		uint32_t ShadowMapGenerationDRJob(PerViewport const & pvp, PassType pass_type, int32_t org_no, int32_t index_in_pass);
+		uint32_t ShadowMapCompositionDRJob(PassType pass_type, int32_t org_no, int32_t index_in_pass);
 		uint32_t IndirectLightingDRJob(PerViewport const & pvp, int32_t org_no);
 		uint32_t ShadowingDRJob(PerViewport const & pvp, PassTargetBuffer pass_tb);
 		uint32_t ShadingDRJob(PerViewport const & pvp, PassType pass_type, int32_t index_in_pass);
@@ -531,6 +567,62 @@ namespace KlayGE
 
 		std::vector<std::shared_ptr<DeferredRenderingJob>> jobs_;
 		std::vector<std::shared_ptr<DeferredRenderingJob>>::iterator curr_job_iter_;
+		// Everything the job list depends on. The jobs are only rebuilt when it changes.
+		std::vector<uint32_t> pass_scan_key_;
+		std::vector<uint32_t> new_pass_scan_key_;
+		uint32_t num_pass_scan_list_rebuilds_ = 0;
+
+		// Render targets that are written and consumed inside the passes of one viewport. Viewports are
+		// rendered one after another, so a target can be shared by all viewports that need the same one.
+		// Inside a viewport, targets whose stages don't overlap share one too.
+		struct TransientTexture
+		{
+			struct User
+			{
+				uint32_t vp;
+				TransientStage first_stage;
+				TransientStage last_stage;
+			};
+
+			TexturePtr tex;
+			std::vector<User> users;
+		};
+		std::vector<TransientTexture> transient_texs_;
+
+		// Shadow maps of static lights. The depth of the static casters is kept per face, and only the
+		// moveable casters are rendered on top of it every frame.
+		enum ShadowFaceAction
+		{
+			SFA_RenderStatic,
+			SFA_Composite,
+			SFA_Reuse
+		};
+		struct ShadowCache
+		{
+			size_t static_key = 0;
+			size_t casters_key = 0;
+			uint32_t casters_version = 0;
+			Sphere casters_bound;
+			uint32_t last_frame = 0;
+			int32_t filtered_slot = -1;
+			bool filtered_has_moveable = false;
+			bool has_moveable = false;
+			std::array<TexturePtr, 6> static_depth_texs;
+			std::array<bool, 6> static_valid{};
+			std::array<ShadowFaceAction, 6> actions{};
+		};
+		std::map<LightSource const *, ShadowCache> shadow_caches_;
+		std::vector<SceneNode const *> static_shadow_casters_;
+		std::vector<SceneNode const *> moveable_shadow_casters_;
+		// Static casters whose resources are still loading. Their readiness is part of the key.
+		std::vector<SceneNode const *> pending_shadow_casters_;
+		uint32_t shadow_frame_ = 0;
+		uint32_t shadow_casters_stamp_ = 0;
+		uint32_t shadow_casters_version_ = 0;
+		bool shadow_casters_collected_ = false;
+		bool shadow_casters_refreshed_ = false;
+		uint32_t num_shadow_faces_rendered_ = 0;
+		uint32_t num_shadow_faces_reused_ = 0;
 
 		std::array<std::array<RenderTechnique*, 5>, LightSource::LT_NumLightTypes> technique_shadows_;
 		RenderTechnique* technique_no_lighting_;
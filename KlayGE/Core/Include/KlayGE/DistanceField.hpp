@@ -45,6 +45,15 @@ namespace KlayGE
 
 	KLAYGE_CORE_API void ComputeDistance(std::vector<float> const & aa_2x_data, uint32_t input_width, uint32_t input_height,
 		std::vector<float>& dist_data);
+
+	// Exact Euclidean distance from every texel to the nearest texel with a non-zero mask. It uses the separable algorithm
+	// of Felzenszwalb and Huttenlocher, linear in the number of texels, with the lines of each axis spread over the thread
+	// pool. Set depth to 1 for 2D.
+	KLAYGE_CORE_API void ComputeEuclideanDistance(std::vector<uint8_t> const & mask, uint32_t width, uint32_t height,
+		uint32_t depth, std::vector<float>& dist_data);
+	// Positive inside the mask, negative outside, and zero half way between an inside and an outside texel
+	KLAYGE_CORE_API void ComputeSignedEuclideanDistance(std::vector<uint8_t> const & mask, uint32_t width, uint32_t height,
+		uint32_t depth, std::vector<float>& dist_data);
 }
 
 #endif		// _KLAYGE_DISTANCE_FIELD_HPP
@@ -76,6 +76,9 @@ namespace KlayGE
 		Font(std::shared_ptr<FontRenderable> const & fr, uint32_t flags);
 
 		Size_T<float> CalcSize(std::wstring_view text, float font_size);
+		// Decodes the glyphs not in the cache yet, in parallel. Call it before showing a lot of new text, such as
+		// a dialog in CJK, to avoid decoding them one at a time during RenderText.
+		void PrepareGlyphs(std::wstring_view text);
 		void RenderText(float x, float y, Color const & clr,
 			std::wstring_view text, float font_size);
 		void RenderText(float x, float y, float z, float xScale, float yScale, Color const & clr,
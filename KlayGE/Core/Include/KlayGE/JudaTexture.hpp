@@ -20,9 +20,17 @@
 #include <KlayGE/RenderStateObject.hpp>
 #include <KlayGE/TexCompressionBC.hpp>
 
+#include <atomic>
+#include <list>
+#include <mutex>
 #include <vector>
 #include <deque>
 #include <unordered_map>
+#include <unordered_set>
+
+#include <boost/lockfree/queue.hpp>
+
+#include <KFL/Thread.hpp>
 
 #include <KlayGE/LZMACodec.hpp>
 
@@ -39,19 +47,14 @@ namespace KlayGE
 	private:
 		static uint32_t const EMPTY_DATA_INDEX = static_cast<uint32_t>(-1);
 
-		struct quadtree_node;
-		typedef std::shared_ptr<quadtree_node> quadtree_node_ptr;
-
-		struct quadtree_node
+		// A node of the sparse quadtree. The key is the level in the top bits, followed by the branches of all
+		// levels down to it, so nodes sorted by key are in level order, and in Morton order inside a level.
+		// The array is stored as is in the file.
+		struct tree_node
 		{
-			quadtree_node_ptr children[4];
+			uint32_t key;
 			uint32_t data_index;
 			uint32_t attr;
-
-			quadtree_node()
-				: data_index(EMPTY_DATA_INDEX)
-			{
-			}
 		};
 
 		static uint32_t const MAX_TREE_LEVEL = 12;
@@ -64,11 +67,15 @@ namespace KlayGE
 
 	public:
 		JudaTexture(uint32_t num_tiles, uint32_t tile_size, ElementFormat format);
+		~JudaTexture();
 
 		uint32_t EncodeTileID(uint32_t level, uint32_t tile_x, uint32_t tile_y) const;
 		void DecodeTileID(uint32_t& level, uint32_t& tile_x, uint32_t& tile_y, uint32_t tile_id) const;
 
 		uint32_t NumNonEmptyNodes() const;
+		uint32_t NumNodes() const;
+		size_t TreeMemorySize() const;
+		uint32_t TileAttr(uint32_t tile_id) const;
 
 		uint32_t NumTiles() const;
 		uint32_t TreeLevels() const;
@@ -88,16 +95,37 @@ namespace KlayGE
 
 		void SetParams(RenderEffect const & effect);
 
+		// Missing tiles are decoded in background. They show up in the cache in a later UpdateCache.
 		void UpdateCache(std::vector<uint32_t> const & tile_ids);
 
+		// Number of decompressed data blocks kept in memory
+		void DecodeCacheSize(uint32_t num_blocks);
+		uint32_t DecodeCacheSize() const;
+		// Milliseconds UpdateCache can spend on uploading decoded tiles
+		void UploadBudget(float ms);
+		float UploadBudget() const;
+		uint32_t NumPendingTiles() const;
+		// Decode batches handed to the thread pool that are running or not joined yet. Finished ones are joined in UpdateCache.
+		uint32_t NumDecodeBatches() const;
+
 	private:
 		void DecodeATile(std::vector<uint8_t>* data, uint32_t shuff, uint32_t mipmaps);
-		uint32_t DecodeAAttr(uint32_t shuff);
-		uint8_t* RetriveATile(uint32_t data_index);
-
-		uint32_t NumNonEmptySubNodes(quadtree_node_ptr const & node) const;
-		quadtree_node_ptr const & GetNode(uint32_t shuff);
-		quadtree_node_ptr const & AddNode(uint32_t shuff);
+		uint32_t DecodeAAttr(uint32_t shuff) const;
+		std::shared_ptr<uint8_t const> RetriveATile(uint32_t data_index);
+		void ReadInputFile(uint64_t offset, void* data, uint32_t size);
+
+		void DecodeTileBatch(std::vector<uint32_t> const & tile_ids);
+		void CommitDecodedTiles();
+		void UpdateIndirectTex(std::vector<std::pair<uint32_t, uint32_t>>& updates);
+
+		uint32_t NodeKey(uint32_t shuff, uint32_t level) const;
+		tree_node* FindNode(uint32_t key);
+		tree_node const * FindNode(uint32_t key) const;
+		bool HasChildren(uint32_t key) const;
+		tree_node* GetNode(uint32_t shuff);
+		tree_node& AddNode(uint32_t shuff);
+		void RemoveNode(uint32_t key);
+		void BuildNodeIndices();
 		void CompactNode(uint32_t shuff);
 
 		uint32_t ShuffLevel(uint32_t shuff) const;
@@ -118,7 +146,8 @@ namespace KlayGE
 		void DeallocateDataBlock(uint32_t index);
 
 	private:
-		quadtree_node_ptr root_;
+		std::vector<tree_node> nodes_;
+		std::unordered_map<uint32_t, uint32_t> node_indices_;
 
 		uint32_t num_tiles_;
 		uint32_t tree_levels_;
@@ -167,21 +196,35 @@ namespace KlayGE
 
 	private:
 		// Input only
-		ResIdentifierPtr input_file_;
+		std::string input_file_name_;
+		std::vector<ResIdentifierPtr> input_files_;
+		std::mutex input_file_mutex_;
 		uint32_t data_blocks_offset_;
-		LZMACodec lzma_dec_;
-		struct DecodedBlockInfo
-		{
-			std::unique_ptr<uint8_t[]> data;
-			uint64_t tick;
 
-			DecodedBlockInfo(std::unique_ptr<uint8_t[]>&& d, uint64_t t)
-				: data(std::move(d)), tick(t)
-			{
-			}
+		typedef std::list<std::pair<uint32_t, std::shared_ptr<std::vector<uint8_t>>>> DecodedBlockList;
+		DecodedBlockList decoded_block_lru_;
+		std::unordered_map<uint32_t, DecodedBlockList::iterator> decoded_block_cache_;
+		uint32_t decoded_block_cache_size_ = 64;
+		std::mutex decoded_block_mutex_;
+
+		// Tiles with borders, ready to be copied into the cache
+		struct DecodedTile
+		{
+			uint32_t tile_id;
+			uint32_t attr;
+			std::vector<std::vector<uint8_t>> mip_data;
+			std::vector<uint32_t> mip_row_pitches;
+		};
+		boost::lockfree::queue<DecodedTile*> decoded_tile_queue_;
+		std::deque<std::unique_ptr<DecodedTile>> decoded_tiles_;
+		std::unordered_set<uint32_t> decoding_tile_ids_;
+		struct DecodeBatch
+		{
+			joiner<void> decode_joiner;
+			std::atomic<bool> done{false};
 		};
-		std::unordered_map<uint32_t, DecodedBlockInfo> decoded_block_cache_;
-		uint64_t decode_tick_;
+		std::vector<std::unique_ptr<DecodeBatch>> decode_batches_;
+		float upload_budget_ms_ = 2.0f;
 
 	private:
 		// Cache
@@ -18,14 +18,14 @@
 
 #pragma once
 
+#include <atomic>
+#include <unordered_map>
 #include <vector>
-#include <list>
 #include <KlayGE/Socket.hpp>
+#include <KlayGE/NetMsg.hpp>
 
 namespace KlayGE
 {
-	uint32_t const Max_Buffer(64);
-
 	class Processor : boost::noncopyable
 	{
 	public:
@@ -53,7 +53,7 @@ namespace KlayGE
 
 		uint32_t		time;
 
-		std::list<std::vector<char>> msgs;
+		NetMsgQueue		msgs;
 	};
 
 	class KLAYGE_CORE_API Lobby : boost::noncopyable
@@ -65,20 +65,25 @@ namespace KlayGE
 		Lobby();
 		~Lobby();
 
-		void Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro);
+		// Runs the lobby on the calling thread until Stop is called
+		void Create(std::string const & Name, uint16_t maxPlayers, uint16_t port, Processor const & pro);
+		void Stop();
 		void Close();
 
 		void LobbyName(std::string const & Name);
 		std::string const & LobbyName() const;
 
-		char NumPlayer() const;
+		uint16_t NumPlayer() const;
 
-		void MaxPlayers(char maxPlayers);
-		char MaxPlayers() const;
+		void MaxPlayers(uint16_t maxPlayers);
+		uint16_t MaxPlayers() const;
 
 		int Receive(void* buf, int maxSize, sockaddr_in& from);
 		int Send(void const * buf, int maxSize, sockaddr_in const & to);
 
+		// Queues a message to a player, sent with the next batch. Only call it on the lobby thread, e.g. from Processor.
+		bool Post(uint32_t id, void const * buf, int size);
+
 		void TimeOut(uint32_t timeOut)
 			{ this->socket_.TimeOut(timeOut); }
 		uint32_t TimeOut()
@@ -88,6 +93,11 @@ namespace KlayGE
 			{ return this->sockAddr_; }
 
 	private:
+		void Dispatch(char* revBuf, int numRev, sockaddr_in& from, Processor const & pro);
+		void FlushSends();
+		void CheckTimeOut(Processor const & pro);
+		void RemovePlayer(PlayerAddrsIter iter);
+
 		void OnJoin(char* revbuf, char* sendbuf, int& sendnum, sockaddr_in& From, Processor const & pro);
 		void OnQuit(PlayerAddrsIter iter, char* sendbuf, int& sendnum, Processor const & pro);
 
@@ -99,6 +109,16 @@ namespace KlayGE
 	private:
 		Socket			socket_;
 		PlayerAddrs		players_;
+		std::unordered_map<uint64_t, size_t> addr_to_slot_;
+
+		NetMsgPool		msg_pool_;
+		std::vector<NetMsgBuffer*>		sending_msgs_;
+		std::vector<SocketDatagram>		sending_;
+
+		std::atomic<bool>	running_;
+#if defined KLAYGE_PLATFORM_LINUX
+		int				wake_fd_;
+#endif
 
 		sockaddr_in		sockAddr_;
 
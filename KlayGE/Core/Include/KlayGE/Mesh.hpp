@@ -28,9 +28,11 @@
 #pragma once
 
 #include <KlayGE/PreDeclare.hpp>
+#include <KFL/ArrayRef.hpp>
 #include <KFL/CXX17/string_view.hpp>
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/RenderLayout.hpp>
+#include <KlayGE/MeshCluster.hpp>
 #include <KFL/Math.hpp>
 #include <KlayGE/SceneNode.hpp>
 
@@ -127,6 +129,34 @@ namespace KlayGE
 			return rls_[lod]->StartInstanceLocation();
 		}
 
+		// Clusters of a LoD for CPU culling. Empty if the LoD is not partitioned.
+		void Clusters(uint32_t lod, std::vector<MeshCluster> clusters)
+		{
+			clusters_[lod] = std::move(clusters);
+		}
+		ArrayRef<MeshCluster> Clusters(uint32_t lod) const
+		{
+			return clusters_[lod];
+		}
+		// Appends the index ranges of the visible clusters of a LoD. Two sided materials, shadow maps and the back
+		// faces of transparency skip the backface test.
+		uint32_t CullClusters(MeshClusterCuller& culler, uint32_t lod, float4x4 const & model,
+			std::vector<MeshClusterCuller::IndexRange>& ranges) const;
+
+		// Off by default, the model loader turns it on for static meshes that have clusters. When on, Render culls the
+		// clusters of every instance against the camera of the current frame buffer and issues one draw per merged index
+		// range. Not for skinned meshes, their clusters are bounded in the bind pose.
+		void ClusterCulling(bool enable)
+		{
+			cluster_culling_ = enable;
+		}
+		bool ClusterCulling() const
+		{
+			return cluster_culling_;
+		}
+
+		void Render() override;
+
 		int32_t MaterialID() const
 		{
 			return mtl_id_;
@@ -146,6 +176,9 @@ namespace KlayGE
 
 	protected:
 		int32_t mtl_id_;
+		std::vector<std::vector<MeshCluster>> clusters_;
+		bool cluster_culling_ = false;
+		std::vector<MeshClusterCuller::IndexRange> cluster_ranges_;
 
 		bool hw_res_ready_;
 	};
@@ -252,6 +285,27 @@ namespace KlayGE
 		std::vector<float> bind_scale;
 
 		std::tuple<Quaternion, Quaternion, float> Frame(float frame) const;
+		// Starts the key search from the interval cached in cursor, so sequential playback is O(1)
+		std::tuple<Quaternion, Quaternion, float> Frame(float frame, uint32_t& cursor) const;
+	};
+
+	// Key frames with each key quantized to 8 uint16: the 3 smallest rotation components, the translation and the scale
+	// mapped to the range of the track, and the index of the dropped rotation component. 16 bytes (20 with the frame id) instead of 40 per key.
+	struct KLAYGE_CORE_API CompressedKeyFrameSet
+	{
+		static uint32_t constexpr KEY_SIZE = 8;
+
+		std::vector<uint32_t> frame_id;
+		std::vector<uint16_t> keys;
+		// Multiplied and added to the first and last 4 components of a key
+		float4 dequant_scale[2];
+		float4 dequant_bias[2];
+
+		static CompressedKeyFrameSet Compress(KeyFrameSet const & kf);
+		KeyFrameSet Decompress() const;
+
+		std::tuple<Quaternion, Quaternion, float> Key(uint32_t index) const;
+		std::tuple<Quaternion, Quaternion, float> Frame(float frame, uint32_t& cursor) const;
 	};
 
 	struct KLAYGE_CORE_API AABBKeyFrameSet
@@ -318,6 +372,15 @@ namespace KlayGE
 		{
 			return key_frame_sets_;
 		}
+		// Sampled instead of the uncompressed key frame sets when attached
+		void AttachCompressedKeyFrameSets(std::shared_ptr<std::vector<CompressedKeyFrameSet>> const & kf)
+		{
+			compressed_key_frame_sets_ = kf;
+		}
+		std::shared_ptr<std::vector<CompressedKeyFrameSet>> const & GetCompressedKeyFrameSets() const
+		{
+			return compressed_key_frame_sets_;
+		}
 		uint32_t NumFrames() const
 		{
 			return num_frames_;
@@ -361,6 +424,8 @@ namespace KlayGE
 		std::vector<float4> bind_duals_;
 
 		std::shared_ptr<std::vector<KeyFrameSet>> key_frame_sets_;
+		std::shared_ptr<std::vector<CompressedKeyFrameSet>> compressed_key_frame_sets_;
+		std::vector<uint32_t> key_frame_cursors_;
 		float last_frame_;
 
 		uint32_t num_frames_;
@@ -385,6 +450,10 @@ namespace KlayGE
 		std::shared_ptr<AABBKeyFrameSet> frame_pos_aabbs_;
 	};
 
+	// Sets the frame of each model, evaluating the skeletons in parallel jobs of similar joint counts. Each model can only
+	// be in the list once. SceneManager::QueueSkinnedModelFrame batches the models posed in a frame into one call.
+	KLAYGE_CORE_API void SetSkinnedModelFrames(ArrayRef<SkinnedModelPtr> models, ArrayRef<float> frames);
+
 
 	KLAYGE_CORE_API RenderModelPtr SyncLoadModel(std::string_view model_name, uint32_t access_hint,
 		uint32_t node_attrib,
@@ -400,6 +469,10 @@ namespace KlayGE
 
 	KLAYGE_CORE_API void SaveModel(RenderModel const & model, std::string_view model_name);
 
+	// Header of runtime models. Bump the version whenever SaveModel writes a different layout.
+	uint32_t constexpr MODEL_BIN_FOURCC = MakeFourCC<'K', 'L', 'M', ' '>::value;
+	uint32_t constexpr MODEL_BIN_VERSION = 19;
+
 
 	class KLAYGE_CORE_API RenderableLightSourceProxy : public StaticMesh
 	{
@@ -0,0 +1,111 @@
+/**
+ * @file MeshCluster.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_MESH_CLUSTER_HPP
+#define KLAYGE_CORE_MESH_CLUSTER_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/ArrayRef.hpp>
+#include <KFL/Frustum.hpp>
+#include <KFL/Matrix.hpp>
+#include <KFL/Vector.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// A run of triangles in a mesh LoD's index range, with the data to cull it as a whole
+	struct MeshCluster
+	{
+		// Relative to the start index location of the LoD
+		uint32_t start_index;
+		uint32_t num_indices;
+
+		float3 center;
+		float radius;
+
+		// A cluster is backfacing from eye when dot(center - eye, cone_axis) > cone_cutoff * |center - eye| + radius.
+		// cone_cutoff is 1 if the normals spread too much to be culled together.
+		float3 cone_axis;
+		float cone_cutoff;
+	};
+
+	// Partitions the triangles into spatially coherent clusters of at most max_triangles, and reorders indices so
+	// that every cluster is a contiguous range. Triangles keep their relative order inside a cluster.
+	KLAYGE_CORE_API std::vector<MeshCluster> BuildMeshClusters(ArrayRef<float3> positions, std::vector<uint32_t>& indices,
+		uint32_t max_triangles);
+
+	// Culls clusters against a view frustum and by their normal cones on the CPU, producing index ranges to draw.
+	class KLAYGE_CORE_API MeshClusterCuller
+	{
+	public:
+		struct IndexRange
+		{
+			uint32_t start_index;
+			uint32_t num_indices;
+		};
+
+		struct Stats
+		{
+			uint32_t num_clusters;
+			uint32_t num_frustum_culled;
+			uint32_t num_backface_culled;
+			uint32_t num_triangles;
+			uint32_t num_triangles_culled;
+		};
+
+	public:
+		MeshClusterCuller();
+
+		// Frustum and eye position are in world space
+		void BeginFrame(Frustum const & frustum, float3 const & eye_pos);
+
+		// Appends the index ranges of visible clusters to ranges, merging neighbors. start_index_location is added to
+		// every range. The backface test is skipped if backface_culling is false, or model has a non-uniform scale or
+		// a reflection. Returns the number of visible triangles.
+		uint32_t Cull(ArrayRef<MeshCluster> clusters, uint32_t start_index_location, float4x4 const & model,
+			bool backface_culling, std::vector<IndexRange>& ranges);
+
+		Stats const & FrameStats() const
+		{
+			return stats_;
+		}
+
+	private:
+		Frustum frustum_;
+		float3 eye_pos_;
+
+		Stats stats_;
+	};
+}
+
+#endif		// KLAYGE_CORE_MESH_CLUSTER_HPP
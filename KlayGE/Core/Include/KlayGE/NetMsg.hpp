@@ -15,9 +15,13 @@
 
 #pragma once
 
+#include <memory>
+#include <vector>
 
 namespace KlayGE
 {
+	uint32_t const Max_Buffer(64);
+
 	enum
 	{
 		MSG_JOIN,
@@ -27,6 +31,52 @@ namespace KlayGE
 
 		MSG_NOP,
 	};
+
+	// ̶СϢ
+	struct NetMsgBuffer
+	{
+		NetMsgBuffer*	next;
+		uint32_t		size;
+		char			data[Max_Buffer];
+	};
+
+	// Recycles message buffers through a free list, growing in chunks. Not thread safe, each owner keeps its own pool.
+	class KLAYGE_CORE_API NetMsgPool : boost::noncopyable
+	{
+	public:
+		NetMsgPool();
+
+		NetMsgBuffer* Alloc();
+		void Free(NetMsgBuffer* msg);
+
+	private:
+		std::vector<std::unique_ptr<NetMsgBuffer[]>> chunks_;
+		NetMsgBuffer* free_list_;
+	};
+
+	// ϢУӳĻ
+	class KLAYGE_CORE_API NetMsgQueue
+	{
+	public:
+		NetMsgQueue();
+
+		bool Empty() const
+		{
+			return nullptr == head_;
+		}
+		NetMsgBuffer* Front() const
+		{
+			return head_;
+		}
+
+		void Push(NetMsgBuffer* msg);
+		NetMsgBuffer* Pop();
+		void Clear(NetMsgPool& pool);
+
+	private:
+		NetMsgBuffer* head_;
+		NetMsgBuffer* tail_;
+	};
 }
 
 #endif			// _NETMSG_HPP
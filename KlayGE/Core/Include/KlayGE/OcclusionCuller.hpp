@@ -0,0 +1,153 @@
+/**
+ * @file OcclusionCuller.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_CORE_OCCLUSION_CULLER_HPP
+#define KLAYGE_CORE_OCCLUSION_CULLER_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+#include <KFL/AABBox.hpp>
+#include <KFL/AlignedAllocator.hpp>
+#include <KFL/ArrayRef.hpp>
+#include <KFL/Matrix.hpp>
+#include <KlayGE/SceneComponent.hpp>
+
+#include <vector>
+
+namespace KlayGE
+{
+	// Marks a scene node as an occluder. The geometry should be a conservative (inner) simplification of the
+	// rendered mesh. Without explicit geometry the node's object space bounding box is used, which is only
+	// correct for solid, box-like objects such as buildings.
+	class KLAYGE_CORE_API OccluderComponent : public SceneComponent
+	{
+	public:
+		BOOST_TYPE_INDEX_REGISTER_RUNTIME_CLASS((SceneComponent))
+
+		OccluderComponent();
+		OccluderComponent(std::vector<float3> positions, std::vector<uint32_t> indices);
+
+		bool UseBoundingBox() const
+		{
+			return positions_.empty();
+		}
+
+		ArrayRef<float3> Positions() const
+		{
+			return positions_;
+		}
+		ArrayRef<uint32_t> Indices() const
+		{
+			return indices_;
+		}
+
+	private:
+		std::vector<float3> positions_;
+		std::vector<uint32_t> indices_;
+	};
+
+	// Rasterizes occluders into a low resolution depth buffer on the CPU, and tests bounding boxes against a
+	// max-depth hierarchy of it. Works without any GPU involvement.
+	class KLAYGE_CORE_API SoftwareOcclusionCuller : boost::noncopyable
+	{
+	public:
+		struct Stats
+		{
+			uint32_t num_occluders;
+			uint32_t num_occluder_triangles;
+			uint32_t num_tested;
+			uint32_t num_culled;
+			float rasterize_ms;
+			float test_ms;
+		};
+
+	public:
+		// Width and height are rounded up to powers of 2
+		SoftwareOcclusionCuller(uint32_t width, uint32_t height);
+
+		uint32_t Width() const
+		{
+			return width_;
+		}
+		uint32_t Height() const
+		{
+			return height_;
+		}
+
+		void BeginFrame(float4x4 const & view_proj);
+		void AddOccluder(ArrayRef<float3> positions, ArrayRef<uint32_t> indices, float4x4 const & model);
+		void AddOccluder(AABBox const & box, float4x4 const & model);
+		// Rasterizes all occluders of this frame on worker threads and builds the hierarchical depth.
+		void Rasterize();
+
+		// Returns true if the whole box is behind the occluders. Conservative, boxes crossing the near plane
+		// are never culled.
+		bool IsOccluded(AABBox const & aabb_ws);
+
+		float DepthAt(uint32_t x, uint32_t y) const
+		{
+			return depth_levels_[0][y * width_ + x];
+		}
+
+		Stats const & FrameStats() const
+		{
+			return stats_;
+		}
+
+	private:
+		struct ScreenTriangle
+		{
+			float x[3];
+			float y[3];
+			float z[3];
+			int32_t min_y;
+			int32_t max_y;
+		};
+
+		void SetupTriangle(float4 const & v0, float4 const & v1, float4 const & v2);
+		void RasterizeBand(uint32_t begin_y, uint32_t end_y);
+		void BuildHiZ();
+
+	private:
+		uint32_t width_;
+		uint32_t height_;
+
+		float4x4 view_proj_;
+		std::vector<ScreenTriangle> triangles_;
+
+		// Level 0 is the rasterized depth, level i is the max of 2x2 texels of level i - 1
+		std::vector<std::vector<float, aligned_allocator<float, 16>>> depth_levels_;
+
+		Stats stats_;
+	};
+}
+
+#endif		// KLAYGE_CORE_OCCLUSION_CULLER_HPP
@@ -34,6 +34,8 @@
 #pragma once
 
 #include <KlayGE/PreDeclare.hpp>
+#include <KFL/AlignedAllocator.hpp>
+#include <KFL/ArrayRef.hpp>
 #include <KFL/Math.hpp>
 #include <KlayGE/SceneNodeHelper.hpp>
 
@@ -55,6 +57,95 @@ namespace KlayGE
 		float init_life;
 	};
 
+	enum ParticleStreamType
+	{
+		PST_PosX = 0,
+		PST_PosY,
+		PST_PosZ,
+		PST_VelX,
+		PST_VelY,
+		PST_VelZ,
+		PST_Life,
+		PST_Spin,
+		PST_Size,
+		PST_Alpha,
+		PST_InitLife,
+
+		PST_NumStreams
+	};
+
+	// A non-owning view of a contiguous range of particles in SoA layout. Updaters consume it in batches.
+	struct ParticleSpan
+	{
+		float* streams[PST_NumStreams];
+		uint32_t num;
+
+		float* Stream(ParticleStreamType type) const
+		{
+			return streams[type];
+		}
+
+		ParticleSpan SubSpan(uint32_t offset, uint32_t count) const
+		{
+			BOOST_ASSERT(offset + count <= num);
+
+			ParticleSpan ret;
+			for (uint32_t i = 0; i < PST_NumStreams; ++ i)
+			{
+				ret.streams[i] = streams[i] + offset;
+			}
+			ret.num = count;
+			return ret;
+		}
+	};
+
+	// Structure-of-arrays particle storage. Alive particles are always packed in [0, NumAlive()).
+	class KLAYGE_CORE_API ParticleSoA
+	{
+	public:
+		explicit ParticleSoA(uint32_t capacity);
+
+		uint32_t Capacity() const
+		{
+			return capacity_;
+		}
+		uint32_t NumAlive() const
+		{
+			return num_alive_;
+		}
+
+		void Clear()
+		{
+			num_alive_ = 0;
+		}
+
+		// Appends up to num particles at the end of the alive range. Returns the number actually allocated.
+		uint32_t Allocate(uint32_t num);
+		// Removes particles with non-positive life, preserving the order of the rest.
+		void Compact();
+
+		Particle Get(uint32_t index) const;
+		void Set(uint32_t index, Particle const & par);
+
+		ParticleSpan Span(uint32_t offset, uint32_t count);
+		ParticleSpan AliveSpan()
+		{
+			return this->Span(0, num_alive_);
+		}
+
+		float const * Stream(ParticleStreamType type) const
+		{
+			return &data_[type * stride_];
+		}
+
+	private:
+		uint32_t capacity_;
+		uint32_t stride_;
+		uint32_t num_alive_;
+
+		std::vector<float, aligned_allocator<float, 16>> data_;
+	};
+
 	class KLAYGE_CORE_API ParticleEmitter
 	{
 	public:
@@ -215,7 +306,8 @@ namespace KlayGE
 		virtual std::string const & Type() const = 0;
 		virtual ParticleUpdaterPtr Clone() = 0;
 
-		virtual void Update(Particle& par, float elapse_time) = 0;
+		// Called concurrently on disjoint spans after SnapParams. Must not touch shared mutable state.
+		virtual void Update(ParticleSpan const & particles, float elapse_time) = 0;
 		virtual void SnapParams() = 0;
 
 	protected:
@@ -293,22 +385,21 @@ namespace KlayGE
 
 		uint32_t NumParticles() const
 		{
-			return static_cast<uint32_t>(particles_.size());
+			return particles_.Capacity();
 		}
 		uint32_t NumActiveParticles() const;
 		uint32_t GetActiveParticleIndex(uint32_t i) const;
-		Particle const & GetParticle(uint32_t i) const
+		Particle GetParticle(uint32_t i) const
 		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
-		}
-		Particle& GetParticle(uint32_t i)
-		{
-			BOOST_ASSERT(i < particles_.size());
-			return particles_[i];
+			BOOST_ASSERT(i < particles_.Capacity());
+			return particles_.Get(i);
 		}
 		void ClearParticles();
 
+		// Runs emitters and updaters synchronously, and refreshes the particle buffer where the device allows it off the
+		// main thread. Normally driven by the scene update thread through UpdateParticleSystems.
+		void Update(float elapsed_time);
+
 		void ParticleAlphaFromTex(std::string const & tex_name);
 		std::string const & ParticleAlphaFromTex() const
 		{
@@ -333,6 +424,7 @@ namespace KlayGE
 		void SceneDepthTexture(TexturePtr const & depth_tex);
 
 	private:
+		void RunUpdatersNoLock(ParticleSpan const & particles, float elapsed_time);
 		void UpdateParticlesNoLock(float elapsed_time);
 		void UpdateParticleBufferNoLock();
 
@@ -343,8 +435,10 @@ namespace KlayGE
 		std::vector<ParticleEmitterPtr> emitters_;
 		std::vector<ParticleUpdaterPtr> updaters_;
 
-		std::vector<Particle> particles_;
-		std::vector<std::pair<uint32_t, float>> actived_particles_;
+		ParticleSoA particles_;
+		std::vector<uint32_t> actived_particles_;
+		std::vector<float> depth_keys_;
+		std::vector<uint32_t> sort_scratch_;
 		mutable std::mutex actived_particles_mutex_;
 
 		float gravity_;
@@ -361,6 +455,9 @@ namespace KlayGE
 		bool gs_support_;
 	};
 
+	// Updates several particle systems in parallel on the global thread pool.
+	KLAYGE_CORE_API void UpdateParticleSystems(ArrayRef<ParticleSystemPtr> systems, float elapsed_time);
+
 	KLAYGE_CORE_API ParticleSystemPtr SyncLoadParticleSystem(std::string_view psml_name);
 	KLAYGE_CORE_API ParticleSystemPtr ASyncLoadParticleSystem(std::string_view psml_name);
 
@@ -397,6 +494,7 @@ namespace KlayGE
 		{
 			std::lock_guard<std::mutex> lock(update_mutex_);
 			size_over_life_ = size_over_life;
+			curves_dirty_ = true;
 		}
 		std::vector<float2> const & SizeOverLife() const
 		{
@@ -406,6 +504,7 @@ namespace KlayGE
 		{
 			std::lock_guard<std::mutex> lock(update_mutex_);
 			mass_over_life_ = mass_over_life;
+			curves_dirty_ = true;
 		}
 		std::vector<float2> const & MassOverLife() const
 		{
@@ -415,25 +514,35 @@ namespace KlayGE
 		{
 			std::lock_guard<std::mutex> lock(update_mutex_);
 			opacity_over_life_ = opacity_over_life;
+			curves_dirty_ = true;
 		}
 		std::vector<float2> const & OpacityOverLife() const
 		{
 			return opacity_over_life_;
 		}
 
-		void Update(Particle& par, float elapse_time) override;
+		void Update(ParticleSpan const & particles, float elapse_time) override;
 		void SnapParams() override;
 
 	private:
+		void BakeCurves();
+
+	private:
+		static uint32_t constexpr LUT_SIZE = 256;
+
 		std::mutex update_mutex_;
+		bool curves_dirty_;
 
 		std::vector<float2> size_over_life_;
 		std::vector<float2> mass_over_life_;
 		std::vector<float2> opacity_over_life_;
 
-		std::vector<float2> this_frame_size_over_life_;
-		std::vector<float2> this_frame_mass_over_life_;
-		std::vector<float2> this_frame_opacity_over_life_;
+		// Interleaved {size, mass, opacity, 0} samples of the curves over normalized life, baked in SnapParams
+		std::vector<float4, aligned_allocator<float4, 16>> this_frame_curve_lut_;
+
+		float3 this_frame_force_;
+		float this_frame_gravity_;
+		float this_frame_buoyancy_factor_;
 	};
 }
 
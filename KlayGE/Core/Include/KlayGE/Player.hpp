@@ -18,18 +18,18 @@
 
 #pragma once
 
-#include <list>
-#include <vector>
+#include <atomic>
 
 #include <KFL/Thread.hpp>
 #include <KlayGE/Socket.hpp>
+#include <KlayGE/NetMsg.hpp>
 
 namespace KlayGE
 {
 	struct LobbyDes
 	{
-		char			numPlayer;
-		char			maxPlayers;
+		uint16_t		numPlayer;
+		uint16_t		maxPlayers;
 		std::string		name;
 		sockaddr_in		addr;
 	};
@@ -56,14 +56,16 @@ namespace KlayGE
 
 	private:
 		Socket		socket_;
+		sockaddr_in	lobbyAddr_;
 
-		char		playerID_;
+		uint32_t	playerID_;
 		std::string	name_;
 
-		joiner<void>	receiveThread_;
-		bool			receiveLoop_;
+		joiner<void>		receiveThread_;
+		std::atomic<bool>	receiveLoop_;
 
-		std::list<std::vector<char>> sendQueue_;
+		NetMsgPool		msgPool_;
+		NetMsgQueue		sendQueue_;
 	};
 }
 
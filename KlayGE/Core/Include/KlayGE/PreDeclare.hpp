@@ -54,6 +54,9 @@ namespace KlayGE
 	using SceneObjectLightSourceProxyPtr = std::shared_ptr<SceneObjectLightSourceProxy>;
 	class SceneObjectCameraProxy;
 	using SceneObjectCameraProxyPtr = std::shared_ptr<SceneObjectCameraProxy>;
+	class OccluderComponent;
+	using OccluderComponentPtr = std::shared_ptr<OccluderComponent>;
+	class SoftwareOcclusionCuller;
 
 	class Blitter;
 	typedef std::shared_ptr<Blitter> BlitterPtr;
@@ -622,7 +622,7 @@ namespace KlayGE
 	{
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
-		void Load(XMLNodePtr const & node);
+		void Load(XMLNodeView node);
 #endif
 
 		void StreamIn(ResIdentifierPtr const & res);
@@ -656,7 +656,7 @@ namespace KlayGE
 	{
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
-		void Load(XMLNodePtr const & node);
+		void Load(XMLNodeView node);
 #endif
 
 		void StreamIn(ResIdentifierPtr const & res);
@@ -689,7 +689,7 @@ namespace KlayGE
 	{
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
-		void Load(XMLNodePtr const & node);
+		void Load(XMLNodeView node);
 #endif
 
 		void StreamIn(ResIdentifierPtr const & res);
@@ -912,7 +912,7 @@ namespace KlayGE
 		XMLNodePtr ResolveInheritTechNode(XMLDocument& doc, XMLNode& root, XMLNodePtr const & tech_node);
 		void ResolveOverrideTechs(XMLDocument& doc, XMLNode& root);
 
-		void Load(XMLNode const & root, RenderEffect& effect);
+		void Load(XMLNodeView root, RenderEffect& effect);
 #endif
 
 	private:
@@ -942,7 +942,7 @@ namespace KlayGE
 	{
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
-		void Open(RenderEffect& effect, XMLNodePtr const & node, uint32_t tech_index);
+		void Open(RenderEffect& effect, XMLNodeView node, uint32_t tech_index);
 		void CompileShaders(RenderEffect& effect, uint32_t tech_index);
 #endif
 		void CreateHwShaders(RenderEffect& effect, uint32_t tech_index);
@@ -1037,7 +1037,7 @@ namespace KlayGE
 	{
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
-		void Open(RenderEffect& effect, XMLNodePtr const& node, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
+		void Open(RenderEffect& effect, XMLNodeView node, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
 		void Open(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index, RenderPass const* inherit_pass);
 		void CompileShaders(RenderEffect& effect, uint32_t tech_index, uint32_t pass_index);
 #endif
@@ -1201,7 +1201,7 @@ namespace KlayGE
 	{
 	public:
 #if KLAYGE_IS_DEV_PLATFORM
-		void Load(XMLNodePtr const & node);
+		void Load(XMLNodeView node);
 #endif
 
 		void StreamIn(ResIdentifierPtr const & res);
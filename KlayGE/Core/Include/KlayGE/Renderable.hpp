@@ -252,6 +252,8 @@ namespace KlayGE
 		virtual void UpdateBoundBox();
 
 		float CalcLod(float3 const & eye_pos, float fov_scale) const;
+		// The active LoD, or the one picked for the camera of the current frame buffer if it's automatic
+		uint32_t RenderLod() const;
 
 		// For deferred only
 		void BindDeferredEffect(RenderEffectPtr const & deferred_effect);
@@ -100,6 +100,9 @@ namespace KlayGE
 		void Unmount(std::string_view virtual_path, std::string_view phy_path);
 
 		ResIdentifierPtr Open(std::string_view name);
+		// Opens an XML asset, preferring its compiled form (name + ".kxml") when that was built from the current source.
+		// On dev platforms a stale or missing compiled form is rebuilt and cached next to the source.
+		ResIdentifierPtr OpenXML(std::string_view name);
 		std::string Locate(std::string_view name);
 		uint64_t Timestamp(std::string_view name);
 		std::string AbsPath(std::string_view path);
@@ -28,6 +28,7 @@
 #include <KFL/Frustum.hpp>
 #include <KFL/Thread.hpp>
 
+#include <atomic>
 #include <vector>
 #include <unordered_map>
 
@@ -43,6 +44,9 @@ namespace KlayGE
 		void Resume();
 
 		void SmallObjectThreshold(float area);
+		// Culls nodes hidden behind OccluderComponents with a software depth buffer. Only for the main camera.
+		void OcclusionCulling(bool enable);
+		bool OcclusionCulling() const;
 		void SceneUpdateElapse(float elapse);
 		virtual void ClipScene();
 
@@ -88,15 +92,37 @@ namespace KlayGE
 
 		void Update();
 
+		// Queues a skinned model to be posed at the frame in the next Update, right after the scene nodes are updated.
+		// All the queued models are evaluated together by SetSkinnedModelFrames. Queuing a model again replaces its frame.
+		// Can be called from the node updates of either thread.
+		void QueueSkinnedModelFrame(SkinnedModelPtr const & model, float frame);
+		// Queues a particle system to be updated after the current traversal of the update thread. The queued systems are
+		// updated in parallel by UpdateParticleSystems. Only for the node updates on the update thread.
+		void QueueParticleSystemUpdate(ParticleSystemPtr const & ps);
+
 		uint32_t NumObjectsRendered() const;
 		uint32_t NumRenderablesRendered() const;
 		uint32_t NumPrimitivesRendered() const;
 		uint32_t NumVerticesRendered() const;
 		uint32_t NumDrawCalls() const;
 		uint32_t NumDispatchCalls() const;
+		uint32_t NumOcclusionTestedNodes() const;
+		uint32_t NumOcclusionCulledNodes() const;
+		float OcclusionCullingTime() const;
 
 		virtual void OnSceneChanged() = 0;
 
+		// Bumped whenever a node is added, removed, updated for the first time, or changes visibility. Systems that cache
+		// per-node data compare it with the stamp they were built at instead of walking the scene every frame.
+		uint32_t SceneChangeStamp() const
+		{
+			return scene_change_stamp_;
+		}
+		void MarkSceneChanged()
+		{
+			++ scene_change_stamp_;
+		}
+
 		bool NodesUpdated() const
 		{
 			return nodes_updated_;
@@ -113,6 +139,9 @@ namespace KlayGE
 		BoundOverlap VisibleTestFromParent(SceneNode const & node, float3 const & view_dir, float3 const & eye_pos,
 			float4x4 const & view_proj);
 
+		void PrepareOcclusionCulling(Camera const & camera, float4x4 const & view_proj);
+		bool AABBOccluded(AABBox const & aabb);
+
 	protected:
 		std::vector<CameraPtr> frame_cameras_;
 		Frustum const * frustum_;
@@ -128,8 +157,12 @@ namespace KlayGE
 		std::vector<SceneNode*> all_scene_nodes_;
 		std::vector<SceneNode*> all_overlay_nodes_;
 
+		std::unique_ptr<SoftwareOcclusionCuller> occlusion_culler_;
+		bool occlusion_active_ = false;
+
 	private:
 		void FlushScene();
+		void UpdateSkinnedModels();
 
 	private:
 		uint32_t urt_;
@@ -150,6 +183,15 @@ namespace KlayGE
 		bool deferred_mode_;
 
 		bool nodes_updated_ = false;
+
+		std::atomic<uint32_t> scene_change_stamp_{0};
+
+		std::mutex skinned_models_mutex_;
+		std::vector<SkinnedModelPtr> queued_skinned_models_;
+		std::vector<float> queued_skinned_model_frames_;
+		std::unordered_map<SkinnedModel*, size_t> queued_skinned_model_indices_;
+
+		std::vector<ParticleSystemPtr> queued_particle_systems_;
 	};
 }
 
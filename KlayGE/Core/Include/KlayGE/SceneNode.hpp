@@ -194,6 +194,7 @@ namespace KlayGE
 		void FindAllNode(std::vector<SceneNode*>& nodes, std::wstring_view name);
 
 		void Parent(SceneNode* so);
+		SceneManager* OwnerSceneManager() const;
 		void EmitSceneChanged();
 
 	protected:
@@ -40,6 +40,14 @@
 
 namespace KlayGE
 {
+	// One datagram of a batched send or receive. On receive, len is the buffer size in and the datagram size out.
+	struct SocketDatagram
+	{
+		void*			buf;
+		int				len;
+		sockaddr_in		addr;
+	};
+
 	KLAYGE_CORE_API sockaddr_in TransAddr(std::string const & address, uint16_t port);
 	KLAYGE_CORE_API std::string TransAddr(sockaddr_in const & sockAddr, uint16_t& port);
 	KLAYGE_CORE_API in_addr Host();
@@ -70,6 +78,11 @@ namespace KlayGE
 		int ReceiveFrom(void* buf, int len, sockaddr_in& sockFrom, int flags = 0);
 		int SendTo(void const * buf, int len, sockaddr_in const & sockTo, int flags = 0);
 
+		// Batched datagram I/O. Maps to recvmmsg/sendmmsg where available, otherwise loops over recvfrom/sendto.
+		// Returns the number of datagrams transferred, or -1 if none could be.
+		int ReceiveFromBatch(SocketDatagram* datagrams, int count, int flags = 0);
+		int SendToBatch(SocketDatagram const * datagrams, int count, int flags = 0);
+
 		enum ShutDownMode
 		{
 			SDM_Receives = 0,
@@ -95,6 +108,11 @@ namespace KlayGE
 		void TimeOut(uint32_t microSecs);
 		uint32_t TimeOut();
 
+		SOCKET Handle() const
+		{
+			return socket_;
+		}
+
 	private:
 		SOCKET		socket_;
 	};
@@ -367,6 +367,10 @@ namespace KlayGE
 
 	KLAYGE_CORE_API void SaveTexture(TexturePtr const & texture, std::string const & tex_name);
 
+	// Header of runtime textures. DDS has no version field, the size of the header written by SaveTexture serves as one.
+	uint32_t constexpr TEXTURE_BIN_FOURCC = MakeFourCC<'D', 'D', 'S', ' '>::value;
+	uint32_t constexpr TEXTURE_BIN_VERSION = 124;
+
 	KLAYGE_CORE_API void ResizeTexture(void* dst_data, uint32_t dst_row_pitch, uint32_t dst_slice_pitch, ElementFormat dst_format,
 		uint32_t dst_width, uint32_t dst_height, uint32_t dst_depth,
 		void const * src_data, uint32_t src_row_pitch, uint32_t src_slice_pitch, ElementFormat src_format,
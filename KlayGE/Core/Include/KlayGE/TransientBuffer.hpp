@@ -35,8 +35,11 @@
 
 #include <KlayGE/PreDeclare.hpp>
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <vector>
-#include <list>
 
 namespace KlayGE
 {
@@ -55,19 +58,18 @@ namespace KlayGE
 		}
 	};
 
+	// A ring of dynamic geometry. Allocations bump a head atomically and are reclaimed a whole present at a time,
+	// once the GPU has passed the fence signaled at that present.
+	// Alloc can be called from any thread. EnsureDataReady, OnPresent and GetBuffer belong to the render thread.
+	// EnsureDataReady waits for the allocations being filled, so other threads can keep allocating while it uploads.
+	// Allocations a draw uses still have to be returned before the EnsureDataReady preceding it.
 	class KLAYGE_CORE_API TransientBuffer : boost::noncopyable
 	{
-		// Frames that have ended
-		struct RetiredFrame
+		// Everything before end is retired when the fence is completed
+		struct InFlightPresent
 		{
-			// Sub allocs that are unuseful and will be freed at the end of the frame
-			std::list<SubAlloc> pending_frees_;
-			uint32_t frame_id;
-
-			explicit RetiredFrame(uint32_t id)
-				: frame_id(id)
-			{
-			}
+			uint32_t end;
+			uint64_t fence_id;
 		};
 
 	public:
@@ -82,10 +84,11 @@ namespace KlayGE
 
 		// Allocate a sub space from transient buffer
 		SubAlloc Alloc(uint32_t size_in_byte, void const * data);
-		// Knowtify transient buffer that this alloc is unused and will be freed at the end of the frame.
-		void Dealloc(SubAlloc const & alloc);
+		// Allocate a sub space and let the filler write the data directly into the buffer
+		SubAlloc Alloc(uint32_t size_in_byte, std::function<void(void* dst, uint32_t length)> const & filler);
+		// Upload the data allocated since last call
 		void EnsureDataReady();
-		// Do with retired frames
+		// Everything allocated so far will be reclaimed after the GPU finishes this frame
 		void OnPresent();
 
 		GraphicsBufferPtr const & GetBuffer() const
@@ -93,23 +96,42 @@ namespace KlayGE
 			return buffer_;
 		}
 
+		uint32_t Capacity() const
+		{
+			return capacity_;
+		}
+
 	private:
 		GraphicsBufferPtr DoCreateBuffer(BindFlag bind_flag, uint32_t size_in_byte);
-		// Free the sub alloc and return the space allocated back to transient buffer.
-		void DoFree(SubAlloc const & alloc);
+		bool TryAlloc(uint32_t size_in_byte, uint32_t& offset);
+		bool HasRoom(uint32_t size_in_byte) const;
+		void MakeRoom(uint32_t size_in_byte);
+		void RetirePresents();
+		void Grow(uint32_t size_in_byte);
+		void BlockWriters();
+		void UnblockWriters();
 
 	private:
 		bool use_no_overwrite_;
-		uint32_t num_pre_frames_;
 
 		GraphicsBufferPtr buffer_;
-		std::list<SubAlloc> free_list_;
-		std::list<RetiredFrame> retired_frames_;
 		BindFlag bind_flag_;
-
-		std::vector<uint8_t> simulate_buffer_;
-		uint32_t valid_min_;
-		uint32_t valid_max_;
+		FencePtr fence_;
+
+		// Allocations are written here, and copied to buffer_ in EnsureDataReady. Threads never map buffer_ themselves.
+		std::vector<uint8_t> cpu_buffer_;
+		uint32_t capacity_;
+
+		// The ring is [tail_, head_), wrapped around capacity_ when head_ < tail_
+		std::atomic<uint32_t> head_;
+		std::atomic<uint32_t> tail_;
+		uint32_t upload_begin_;
+		std::deque<InFlightPresent> in_flight_presents_;
+
+		// Slow path only. Growing reallocates cpu_buffer_ and uploading reads it, so both wait until no thread is writing.
+		std::mutex mutex_;
+		std::atomic<bool> writers_blocked_;
+		std::atomic<uint32_t> num_writers_;
 	};
 }
 
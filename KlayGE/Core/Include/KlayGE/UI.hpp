@@ -77,6 +77,17 @@ namespace KlayGE
 	class KLAYGE_CORE_API UIElement
 	{
 	public:
+		UIElement() = default;
+		// A copy belongs to no control until it is added to one, and assigning keeps the owner
+		UIElement(UIElement const & rhs);
+		UIElement& operator=(UIElement const & rhs);
+
+		// The setters mark the geometry of the owner dirty
+		void Owner(UIControl* owner)
+		{
+			owner_ = owner;
+		}
+
 		void SetTexture(uint32_t tex_index, IRect const & tex_rect, Color const & default_texture_color = Color(1, 1, 1, 1));
 
 		void SetFont(uint32_t font_index);
@@ -132,6 +143,8 @@ namespace KlayGE
 
 		UIStatesColor texture_color_;
 		UIStatesColor font_color_;
+
+		UIControl* owner_ = nullptr;
 	};
 
 	class KLAYGE_CORE_API UIControl : public std::enable_shared_from_this<UIControl>, boost::noncopyable
@@ -164,6 +177,14 @@ namespace KlayGE
 
 
 		virtual void Render() = 0;
+		// Controls that change their look without any state change, e.g. a blinking caret, keep the dialog geometry dirty
+		virtual bool IsAnimating() const
+		{
+			return false;
+		}
+
+		// Notify the dialog that the geometry of this control has to be rebuilt
+		void MarkDirty();
 
 		virtual bool CanHaveFocus() const
 		{
@@ -176,18 +197,22 @@ namespace KlayGE
 		virtual void OnFocusIn()
 		{
 			has_focus_ = true;
+			this->MarkDirty();
 		}
 		virtual void OnFocusOut()
 		{
 			has_focus_ = false;
+			this->MarkDirty();
 		}
 		virtual void OnMouseEnter()
 		{
 			is_mouse_over_ = true;
+			this->MarkDirty();
 		}
 		virtual void OnMouseLeave()
 		{
 			is_mouse_over_ = false;
+			this->MarkDirty();
 		}
 		virtual void OnHotkey()
 		{
@@ -205,6 +230,7 @@ namespace KlayGE
 		virtual void SetEnabled(bool bEnabled)
 		{
 			enabled_ = bEnabled;
+			this->MarkDirty();
 		}
 		virtual bool GetEnabled() const
 		{
@@ -213,6 +239,7 @@ namespace KlayGE
 		virtual void SetVisible(bool bVisible)
 		{
 			visible_ = bVisible;
+			this->MarkDirty();
 		}
 		virtual bool GetVisible() const
 		{
@@ -262,6 +289,7 @@ namespace KlayGE
 			{
 				element->FontColor().States[UICS_Normal] = color;
 			}
+			this->MarkDirty();
 		}
 		UIElement* GetElement(uint32_t iElement) const
 		{
@@ -272,11 +300,12 @@ namespace KlayGE
 			// Make certain the array is this large
 			for (uint32_t i = static_cast<uint32_t>(elements_.size()); i <= iElement; ++ i)
 			{
-				elements_.push_back(MakeUniquePtr<UIElement>());
+				this->AddElement(UIElement());
 			}
 
 			// Update the data
 			*elements_[iElement] = element;
+			this->MarkDirty();
 		}
 
 		bool GetIsDefault() const
@@ -336,9 +365,12 @@ namespace KlayGE
 		std::vector<std::unique_ptr<UIElement>> elements_;  // All display elements
 
 	protected:
+		void AddElement(UIElement const & element);
+
 		virtual void UpdateRects()
 		{
 			bounding_box_ = IRect(x_, y_, x_ + width_, y_ + height_);
+			this->MarkDirty();
 		}
 
 		int  id_;				// ID number
@@ -352,6 +384,8 @@ namespace KlayGE
 
 	class KLAYGE_CORE_API UIManager : boost::noncopyable, public std::enable_shared_from_this<UIManager>
 	{
+		friend class UIDialog;
+
 	public:
 		struct VertexFormat
 		{
@@ -426,6 +460,16 @@ namespace KlayGE
 			return mouse_on_ui_;
 		}
 
+		// Statistics of the last frame
+		uint32_t NumQuadsRebuilt() const
+		{
+			return num_quads_rebuilt_;
+		}
+		uint32_t NumQuadsReused() const
+		{
+			return num_quads_reused_;
+		}
+
 	private:
 		void Init();
 		void InputHandler(InputEngine const & sender, InputAction const & action);
@@ -453,7 +497,25 @@ namespace KlayGE
 			std::wstring text;
 			uint32_t align;
 		};
-		std::map<size_t, std::vector<string_cache>> strings_;
+
+		// Geometry emitted by a dialog. It is kept across frames and only rebuilt when the dialog is dirty.
+		struct GeometryCache
+		{
+			std::map<TexturePtr, std::vector<VertexFormat>> quads;
+			std::map<size_t, std::vector<string_cache>> strings;
+
+			void Clear();
+			uint32_t NumQuads() const;
+		};
+		void SubmitGeometry(GeometryCache const & cache);
+
+		GeometryCache immediate_geometry_;	// Geometry not recorded by any dialog
+		GeometryCache submitted_immediate_geometry_;
+		GeometryCache* recording_geometry_;	// Where the draw calls go
+		std::map<size_t, std::vector<string_cache const *>> strings_;
+
+		uint32_t num_quads_rebuilt_;
+		uint32_t num_quads_reused_;
 
 		bool mouse_on_ui_;
 		bool inited_;
@@ -524,6 +586,7 @@ namespace KlayGE
 		void SetVisible(bool bVisible)
 		{
 			visible_ = bVisible;
+			this->MarkDirty();
 		}
 		bool GetMinimized() const
 		{
@@ -532,6 +595,7 @@ namespace KlayGE
 		void SetMinimized(bool bMinimized)
 		{
 			minimized_ = bMinimized;
+			this->MarkDirty();
 		}
 		void SetBackgroundColors(Color const & colorAllCorners);
 		void SetBackgroundColors(Color const & colorTopLeft, Color const & colorTopRight,
@@ -539,6 +603,7 @@ namespace KlayGE
 		void EnableCaption(bool bEnable)
 		{
 			show_caption_ = bEnable;
+			this->MarkDirty();
 		}
 		bool IsCaptionEnabled() const
 		{
@@ -551,6 +616,7 @@ namespace KlayGE
 		void SetCaptionHeight(int nHeight)
 		{
 			caption_height_ = nHeight;
+			this->MarkDirty();
 		}
 		void SetID(std::string const & id)
 		{
@@ -563,6 +629,7 @@ namespace KlayGE
 		void SetCaptionText(std::wstring const & strText)
 		{
 			caption_ = strText;
+			this->MarkDirty();
 		}
 		int2 GetLocation() const
 		{
@@ -576,11 +643,13 @@ namespace KlayGE
 			bounding_box_.top() = y;
 			bounding_box_.right() = x + w;
 			bounding_box_.bottom() = y + h;
+			this->MarkDirty();
 		}
 		void SetSize(int width, int height)
 		{
 			bounding_box_.right() = bounding_box_.left() + width;
 			bounding_box_.bottom() = bounding_box_.top() + height;
+			this->MarkDirty();
 		}
 		int GetWidth() const
 		{
@@ -593,6 +662,7 @@ namespace KlayGE
 		void AlwaysInOpacity(bool opacity)
 		{
 			always_in_opacity_ = opacity;
+			this->MarkDirty();
 		}
 		bool AlwaysInOpacity() const
 		{
@@ -618,6 +688,16 @@ namespace KlayGE
 			return keyboard_input_;
 		}
 
+		// The cached geometry is re-emitted until something marks the dialog dirty
+		void MarkDirty()
+		{
+			geometry_dirty_ = true;
+		}
+		bool IsDirty() const
+		{
+			return geometry_dirty_;
+		}
+
 		bool ContainsPoint(int2 const & pt) const;
 		int2 ToLocal(int2 const & pt) const;
 
@@ -649,6 +729,9 @@ namespace KlayGE
 		// Control events
 		bool OnCycleFocus(bool bForward);
 
+		void UpdateOpacity(bool active);
+		void RebuildGeometry();
+
 	private:
 		bool keyboard_input_;
 		bool mouse_input_;
@@ -681,6 +764,9 @@ namespace KlayGE
 		float depth_base_;
 		float opacity_;
 
+		UIManager::GeometryCache geometry_;
+		bool geometry_dirty_;
+
 		std::map<std::string, int> id_name_;
 		std::map<int, ControlLocation> id_location_;
 	};
@@ -1074,6 +1160,10 @@ namespace KlayGE
 		}
 
 		virtual void Render();
+		virtual bool IsAnimating() const
+		{
+			return arrow_ != CLEAR;
+		}
 		virtual void UpdateRects();
 
 		void SetTrackRange(size_t nStart, size_t nEnd);
@@ -1177,6 +1267,10 @@ namespace KlayGE
 		}
 
 		virtual void    Render();
+		virtual bool IsAnimating() const
+		{
+			return scroll_bar_.IsAnimating();
+		}
 		virtual void    UpdateRects();
 
 		STYLE GetStyle() const
@@ -1190,6 +1284,7 @@ namespace KlayGE
 		void SetStyle(STYLE style)
 		{
 			style_ = style;
+			this->MarkDirty();
 		}
 		int  GetScrollBarWidth() const
 		{
@@ -1204,6 +1299,7 @@ namespace KlayGE
 		{
 			border_ = border;
 			margin_ = margin;
+			this->MarkDirty();
 		}
 		int AddItem(std::wstring const & strText);
 		void SetItemData(int nIndex, std::any const & data);
@@ -1290,6 +1386,10 @@ namespace KlayGE
 		virtual void OnHotkey();
 		virtual void OnFocusOut();
 		virtual void Render();
+		virtual bool IsAnimating() const
+		{
+			return scroll_bar_.IsAnimating();
+		}
 
 		virtual void UpdateRects();
 
@@ -1468,6 +1568,10 @@ namespace KlayGE
 			mouse_drag_ = false;
 		}
 		virtual void Render();
+		virtual bool IsAnimating() const
+		{
+			return has_focus_;	// Caret blinks
+		}
 
 		void SetText(std::wstring const & wszText, bool bSelected = false);
 		std::wstring const & GetText() const
@@ -1482,18 +1586,22 @@ namespace KlayGE
 		virtual void SetTextColor(Color const & Color)
 		{
 			text_color_ = Color;	// Text color
+			this->MarkDirty();
 		}
 		void SetSelectedTextColor(Color const & Color)
 		{
 			sel_text_color_ = Color;	// Selected text color
+			this->MarkDirty();
 		}
 		void SetSelectedBackColor(Color const & Color)
 		{
 			sel_bk_color_ = Color;	// Selected background color
+			this->MarkDirty();
 		}
 		void SetCaretColor(Color const & Color)
 		{
 			caret_color_ = Color;	// Caret color
+			this->MarkDirty();
 		}
 		void SetBorderWidth(int nBorder)
 		{
@@ -31,6 +31,7 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Hash.hpp>
 #include <KFL/Util.hpp>
+#include <KFL/XMLDom.hpp>
 #include <KlayGE/Package.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
@@ -39,6 +40,7 @@
 #endif
 #include <fstream>
 #include <sstream>
+#include <thread>
 
 #if defined KLAYGE_PLATFORM_WINDOWS_DESKTOP
 #include <windows.h>
@@ -720,6 +722,67 @@ namespace KlayGE
 		return ResIdentifierPtr();
 	}
 
+	ResIdentifierPtr ResLoader::OpenXML(std::string_view name)
+	{
+		ResIdentifierPtr source = this->Open(name);
+
+		std::string const compiled_name = std::string(name) + ".kxml";
+		ResIdentifierPtr compiled = this->Open(compiled_name);
+		if (compiled)
+		{
+			// Sources without a timestamp can't be checked, so a compiled form shipped with them is trusted
+			uint64_t source_timestamp;
+			if (XMLDocument::IsCompiled(compiled, source_timestamp)
+				&& (!source || (source->Timestamp() == 0) || (source->Timestamp() == source_timestamp)))
+			{
+				compiled->ResName(name);
+				compiled->Timestamp(source ? source->Timestamp() : source_timestamp);
+				return compiled;
+			}
+		}
+
+#if KLAYGE_IS_DEV_PLATFORM
+		if (source)
+		{
+			std::string const res_path = this->Locate(name);
+#if defined(KLAYGE_CXX17_LIBRARY_FILESYSTEM_SUPPORT) || defined(KLAYGE_TS_LIBRARY_FILESYSTEM_SUPPORT)
+			std::error_code ec;
+#else
+			boost::system::error_code ec;
+#endif
+			if (!res_path.empty() && std::filesystem::is_regular_file(std::filesystem::path(res_path), ec))
+			{
+				XMLDocument doc;
+				doc.Parse(source);
+
+				auto compiled_stream = MakeSharedPtr<std::stringstream>(std::ios_base::in | std::ios_base::out | std::ios_base::binary);
+				doc.Compile(*compiled_stream, source->Timestamp());
+
+				// Resources can be loaded from several threads, so the file is written aside and moved into place
+				std::string const compiled_path = res_path + ".kxml";
+				std::string const tmp_path = compiled_path + '.' + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+				bool written;
+				{
+					std::ofstream ofs(tmp_path.c_str(), std::ios_base::binary | std::ios_base::out);
+					ofs << compiled_stream->rdbuf();
+					written = static_cast<bool>(ofs);
+				}
+				if (written)
+				{
+					std::filesystem::rename(std::filesystem::path(tmp_path), std::filesystem::path(compiled_path), ec);
+				}
+				std::filesystem::remove(std::filesystem::path(tmp_path), ec);
+
+				compiled_stream->clear();
+				compiled_stream->seekg(0, std::ios_base::beg);
+				return MakeSharedPtr<ResIdentifier>(name, source->Timestamp(), compiled_stream);
+			}
+		}
+#endif
+
+		return source;
+	}
+
 	uint64_t ResLoader::Timestamp(std::string_view name)
 	{
 		uint64_t timestamp = 0;
@@ -11,22 +11,50 @@
 /////////////////////////////////////////////////////////////////////////////////
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/ErrorHandling.hpp>
 #include <KlayGE/Player.hpp>
 
 #include <algorithm>
 #include <ctime>
 #include <cstring>
 
+#if defined KLAYGE_PLATFORM_LINUX
+	#include <sys/epoll.h>
+	#include <sys/eventfd.h>
+	#include <unistd.h>
+#endif
+
 #include <KlayGE/NetMsg.hpp>
 #include <KlayGE/Lobby.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	int const BATCH_SIZE = 64;
+
+	// ÿλյΣⷢͺͳʱ鱻
+	int const MAX_BATCHES_PER_WAKE = 16;
+
+	uint64_t AddrKey(sockaddr_in const & addr)
+	{
+		return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+	}
+}
+
 namespace KlayGE
 {
 	// 캯
 	/////////////////////////////////////////////////////////////////////////////////
 	Lobby::Lobby()
+		: running_(true)
 	{
+		std::memset(&sockAddr_, 0, sizeof(sockAddr_));
 		this->socket_.Create(SOCK_DGRAM);
+
+#if defined KLAYGE_PLATFORM_LINUX
+		wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
 	}
 
 	// 
@@ -34,16 +62,21 @@ namespace KlayGE
 	Lobby::~Lobby()
 	{
 		Close();
+
+#if defined KLAYGE_PLATFORM_LINUX
+		if (wake_fd_ >= 0)
+		{
+			close(wake_fd_);
+		}
+#endif
 	}
 
 	Lobby::PlayerAddrsIter Lobby::ID(sockaddr_in const & addr)
 	{
-		for (auto iter = players_.begin(); iter != players_.end(); ++ iter)
+		auto iter = addr_to_slot_.find(AddrKey(addr));
+		if (iter != addr_to_slot_.end())
 		{
-			if (0 == std::memcmp(&addr, &(iter->second.addr), sizeof(addr)))
-			{
-				return iter;
-			}
+			return players_.begin() + iter->second;
 		}
 
 		return players_.end();
@@ -51,86 +84,251 @@ namespace KlayGE
 
 	// Ϸ
 	/////////////////////////////////////////////////////////////////////////////////
-	void Lobby::Create(std::string const & Name, char maxPlayers, uint16_t port, Processor const & pro)
+	void Lobby::Create(std::string const & Name, uint16_t maxPlayers, uint16_t port, Processor const & pro)
 	{
 		this->LobbyName(Name);
 
 		this->MaxPlayers(maxPlayers);
 
 		this->socket_.Bind(TransAddr("", port));
+		socklen_t len = sizeof(sockAddr_);
+		this->socket_.SockName(sockAddr_, len);
+
+		// Ӵ󻺳ԼͻʱĶϵͳʱᱻض
+		int const buf_size = 4 * 1024 * 1024;
+		this->socket_.SetSockOpt(SO_RCVBUF, &buf_size, sizeof(buf_size));
+		this->socket_.SetSockOpt(SO_SNDBUF, &buf_size, sizeof(buf_size));
+
+		// ȴɶ¼Ȼȡѵݱ
+		this->socket_.NonBlock(true);
+
+#if defined KLAYGE_PLATFORM_LINUX
+		int const epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		Verify(epoll_fd >= 0);
+		epoll_event ev;
+		std::memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = this->socket_.Handle();
+		Verify(0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, this->socket_.Handle(), &ev));
+		ev.data.fd = wake_fd_;
+		Verify(0 == epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd_, &ev));
+#endif
+
+		char revBufs[BATCH_SIZE][Max_Buffer + 1];
+		SocketDatagram datagrams[BATCH_SIZE];
+
+		time_t lastCheck = std::time(nullptr);
+		while (running_)
+		{
+			bool readable = false;
+#if defined KLAYGE_PLATFORM_LINUX
+			epoll_event events[2];
+			int const num_events = epoll_wait(epoll_fd, events, 2, 1000);
+			for (int i = 0; i < num_events; ++ i)
+			{
+				if (events[i].data.fd == wake_fd_)
+				{
+					uint64_t val;
+					while (read(wake_fd_, &val, sizeof(val)) > 0);
+				}
+				else
+				{
+					readable = true;
+				}
+			}
+#else
+			fd_set read_set;
+			FD_ZERO(&read_set);
+			FD_SET(this->socket_.Handle(), &read_set);
+			timeval wait_time = { 0, 100 * 1000 };
+			readable = select(static_cast<int>(this->socket_.Handle() + 1), &read_set, nullptr, nullptr, &wait_time) > 0;
+#endif
+
+			if (readable)
+			{
+				for (int batch = 0; batch < MAX_BATCHES_PER_WAKE; ++ batch)
+				{
+					for (int i = 0; i < BATCH_SIZE; ++ i)
+					{
+						datagrams[i].buf = revBufs[i];
+						datagrams[i].len = Max_Buffer;
+					}
+
+					int const num = this->socket_.ReceiveFromBatch(datagrams, BATCH_SIZE);
+					if (num <= 0)
+					{
+						break;
+					}
+
+					for (int i = 0; i < num; ++ i)
+					{
+						if (datagrams[i].len > 0)
+						{
+							revBufs[i][datagrams[i].len] = 0;
+							this->Dispatch(revBufs[i], datagrams[i].len, datagrams[i].addr, pro);
+						}
+					}
+
+					// Ϣ
+					this->FlushSends();
+				}
+			}
+
+			this->FlushSends();
+
+			// Ƿûʱ
+			time_t const now = std::time(nullptr);
+			if (now != lastCheck)
+			{
+				this->CheckTimeOut(pro);
+				lastCheck = now;
+			}
+		}
+
+#if defined KLAYGE_PLATFORM_LINUX
+		close(epoll_fd);
+#endif
+	}
+
+	// ֹͣϷѭԴ̵߳
+	/////////////////////////////////////////////////////////////////////////////////
+	void Lobby::Stop()
+	{
+		running_ = false;
+
+#if defined KLAYGE_PLATFORM_LINUX
+		uint64_t const val = 1;
+		if (write(wake_fd_, &val, sizeof(val)) < 0)
+		{
+			// Ѿлź
+		}
+#endif
+	}
 
-		sockaddr_in from;
-		char revBuf[Max_Buffer];
-		char sendBuf[Max_Buffer];
+	void Lobby::Dispatch(char* revBuf, int numRev, sockaddr_in& from, Processor const & pro)
+	{
+		NetMsgBuffer* reply = msg_pool_.Alloc();
+		char* sendBuf = reply->data;
 		int numSend = 0;
-		for (;;)
+
+		// ÿϢǰ涼1ֽڵϢ
+		char* revPtr(&revBuf[1]);
+		char* sendPtr(&sendBuf[1]);
+		sendBuf[0] = revBuf[0];
+
+		auto iter = this->ID(from);
+		if (iter != players_.end())
 		{
-			this->Receive(revBuf, sizeof(revBuf), from);
+			iter->second.time = static_cast<uint32_t>(std::time(nullptr));
+		}
 
-			// ÿϢǰ涼1ֽڵϢ
-			char* revPtr(&revBuf[1]);
-			char* sendPtr(&sendBuf[1]);
-			sendBuf[0] = revBuf[0];
+		switch (revBuf[0])
+		{
+		case MSG_JOIN:
+			this->OnJoin(revPtr, sendPtr, numSend, from, pro);
+			break;
 
-			switch (revBuf[0])
-			{
-			case MSG_JOIN:
-				this->OnJoin(revPtr, sendPtr, numSend, from, pro);
-				break;
+		case MSG_QUIT:
+			this->OnQuit(iter, sendPtr, numSend, pro);
+			break;
 
-			case MSG_QUIT:
-				this->OnQuit(this->ID(from), sendPtr, numSend, pro);
-				break;
+		case MSG_GETLOBBYINFO:
+			this->OnGetLobbyInfo(sendPtr, numSend, pro);
+			break;
 
-			case MSG_GETLOBBYINFO:
-				this->OnGetLobbyInfo(sendPtr, numSend, pro);
-				break;
+		case MSG_NOP:
+			this->OnNop(iter);
+			break;
 
-			case MSG_NOP:
-				this->OnNop(this->ID(from));
-				break;
+		default:
+			pro.OnDefault(revBuf, numRev, sendBuf, numSend, from);
+			break;
+		}
 
-			default:
-				pro.OnDefault(revBuf, sizeof(revBuf), sendBuf, numSend, from);
-				break;
-			}
+		if (numSend != 0)
+		{
+			reply->size = std::min(static_cast<uint32_t>(numSend + 1), Max_Buffer);
+			SocketDatagram const dg = { reply->data, static_cast<int>(reply->size), from };
+			sending_.push_back(dg);
+			sending_msgs_.push_back(reply);
+		}
+		else
+		{
+			msg_pool_.Free(reply);
+		}
+	}
 
-			if (numSend != 0)
+	void Lobby::FlushSends()
+	{
+		for (auto& player : players_)
+		{
+			if (player.first != 0)
 			{
-				this->Send(sendBuf, numSend + 1, from);
+				while (!player.second.msgs.Empty())
+				{
+					NetMsgBuffer* msg = player.second.msgs.Pop();
+					SocketDatagram const dg = { msg->data, static_cast<int>(msg->size), player.second.addr };
+					sending_.push_back(dg);
+					sending_msgs_.push_back(msg);
+				}
 			}
+		}
+
+		if (!sending_.empty())
+		{
+			socket_.SendToBatch(sending_.data(), static_cast<int>(sending_.size()));
 
-			// Ϣ
-			for (auto const & player : players_)
+			for (auto msg : sending_msgs_)
 			{
-				auto const & msgs = player.second.msgs;
-				for (auto const & msg : msgs)
-				{
-					socket_.SendTo(&msg[0], static_cast<int>(msg.size()), player.second.addr);
-				}
+				msg_pool_.Free(msg);
 			}
+			sending_.clear();
+			sending_msgs_.clear();
+		}
+	}
 
-			// Ƿûʱ
-			for (auto iter = players_.begin(); iter != players_.end();)
+	void Lobby::CheckTimeOut(Processor const & pro)
+	{
+		uint32_t const now = static_cast<uint32_t>(std::time(nullptr));
+		for (auto iter = players_.begin(); iter != players_.end(); ++ iter)
+		{
+			// 20
+			if ((iter->first != 0) && (now - iter->second.time >= 20))
 			{
-				// 20
-				if (std::time(nullptr) - iter->second.time >= 20 * 1000)
-				{
-					iter = players_.erase(iter);
-				}
-				else
-				{
-					++ iter;
-				}
+				pro.OnQuit(iter->first);
+				this->RemovePlayer(iter);
 			}
 		}
 	}
 
+	void Lobby::RemovePlayer(PlayerAddrsIter iter)
+	{
+		addr_to_slot_.erase(AddrKey(iter->second.addr));
+		iter->first = 0;
+		iter->second.name.clear();
+		iter->second.msgs.Clear(msg_pool_);
+	}
+
+	bool Lobby::Post(uint32_t id, void const * buf, int size)
+	{
+		if ((0 == id) || (id > players_.size()) || (players_[id - 1].first != id)
+			|| (size <= 0) || (static_cast<uint32_t>(size) > Max_Buffer))
+		{
+			return false;
+		}
+
+		NetMsgBuffer* msg = msg_pool_.Alloc();
+		std::memcpy(msg->data, buf, size);
+		msg->size = size;
+		players_[id - 1].second.msgs.Push(msg);
+		return true;
+	}
+
 	// 
 	/////////////////////////////////////////////////////////////////////////////////
-	char Lobby::NumPlayer() const
+	uint16_t Lobby::NumPlayer() const
 	{
-		return static_cast<char>(std::count_if(
+		return static_cast<uint16_t>(std::count_if(
 			players_.begin(), players_.end(), [](std::pair<uint32_t, PlayerDes> const& player) { return (player.first != 0); }));
 	}
 
@@ -157,8 +355,14 @@ namespace KlayGE
 
 	// 
 	/////////////////////////////////////////////////////////////////////////////////
-	void Lobby::MaxPlayers(char maxPlayers)
+	void Lobby::MaxPlayers(uint16_t maxPlayers)
 	{
+		for (auto& player : players_)
+		{
+			player.second.msgs.Clear(msg_pool_);
+		}
+		addr_to_slot_.clear();
+
 		players_.resize(maxPlayers);
 		PlayerAddrs(players_).swap(players_);
 
@@ -170,9 +374,9 @@ namespace KlayGE
 
 	// ȡ
 	/////////////////////////////////////////////////////////////////////////////////
-	char Lobby::MaxPlayers() const
+	uint16_t Lobby::MaxPlayers() const
 	{
-		return static_cast<char>(this->players_.size());
+		return static_cast<uint16_t>(this->players_.size());
 	}
 
 	// رϷ
@@ -203,41 +407,43 @@ namespace KlayGE
 		// ʽ:
 		//			Player		16 ֽ
 
-		char id = 1;
-		auto iter = players_.begin();
-		for (; iter != this->players_.end(); ++ iter, ++ id)
+		uint32_t id = 0;
+		auto iter = this->ID(from);
+		if (iter != players_.end())
 		{
-			if (0 == iter->first)
+			// ظ룬ԭID
+			id = iter->first;
+		}
+		else
+		{
+			for (iter = players_.begin(); iter != players_.end(); ++ iter)
 			{
-				size_t i(0);
-				while (revBuf[i] != 0)
+				if (0 == iter->first)
 				{
-					++ i;
+					size_t i(0);
+					while ((i < 16) && (revBuf[i] != 0))
+					{
+						++ i;
+					}
+					std::string name(&revBuf[0], i);
+					id = static_cast<uint32_t>(iter - players_.begin() + 1);
+					iter->first			= id;
+					iter->second.name	= name;
+					iter->second.addr	= from;
+					iter->second.time	= static_cast<uint32_t>(std::time(nullptr));
+					addr_to_slot_[AddrKey(from)] = iter - players_.begin();
+
+					pro.OnJoin(iter->first);
+					break;
 				}
-				std::string name(&revBuf[0], i);
-				iter->first			= id;
-				iter->second.name	= name;
-				iter->second.addr	= from;
-
-				pro.OnJoin(iter->first);
-				break;
 			}
 		}
 
 		// ظʽ:
-		//			Player ID		1 ֽ
+		//			Player ID		4 ֽڣѾΪ0
 
-		// Ѿ
-		if (iter == players_.end())
-		{
-			sendBuf[0] = 1;
-		}
-		else
-		{
-			sendBuf[0] = 0;
-		}
-
-		numSend = 1;
+		std::memcpy(sendBuf, &id, sizeof(id));
+		numSend = sizeof(id);
 	}
 
 	void Lobby::OnQuit(PlayerAddrsIter iter, char* sendBuf,
@@ -246,7 +452,7 @@ namespace KlayGE
 		if (iter != this->players_.end())
 		{
 			pro.OnQuit(iter->first);
-			iter->first = 0;
+			this->RemovePlayer(iter);
 			sendBuf[0] = 0;
 		}
 		else
@@ -260,15 +466,17 @@ namespace KlayGE
 	void Lobby::OnGetLobbyInfo(char* sendBuf, int& numSend, Processor const & /*pro*/)
 	{
 		// ظʽ:
-		//			ǰPlayers	1 ֽ
-		//			Players	1 ֽ
+		//			ǰPlayers	2 ֽ
+		//			Players	2 ֽ
 		//			Lobby		16 ֽ
 
-		memset(sendBuf, 0, 18);
-		sendBuf[0] = this->NumPlayer();
-		sendBuf[1] = this->MaxPlayers();
-		this->LobbyName().copy(&sendBuf[2], this->LobbyName().length());
-		numSend = 18;
+		memset(sendBuf, 0, 20);
+		uint16_t const num_player = this->NumPlayer();
+		uint16_t const max_players = this->MaxPlayers();
+		std::memcpy(&sendBuf[0], &num_player, sizeof(num_player));
+		std::memcpy(&sendBuf[2], &max_players, sizeof(max_players));
+		this->LobbyName().copy(&sendBuf[4], this->LobbyName().length());
+		numSend = 20;
 	}
 
 	void Lobby::OnNop(PlayerAddrsIter iter)
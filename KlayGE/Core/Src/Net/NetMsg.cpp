@@ -0,0 +1,119 @@
+/**
+ * @file NetMsg.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+
+#include <boost/assert.hpp>
+
+#include <KlayGE/NetMsg.hpp>
+
+namespace
+{
+	uint32_t const CHUNK_SIZE = 64;
+}
+
+namespace KlayGE
+{
+	NetMsgPool::NetMsgPool()
+		: free_list_(nullptr)
+	{
+	}
+
+	NetMsgBuffer* NetMsgPool::Alloc()
+	{
+		if (nullptr == free_list_)
+		{
+			chunks_.emplace_back(MakeUniquePtr<NetMsgBuffer[]>(CHUNK_SIZE));
+			NetMsgBuffer* chunk = chunks_.back().get();
+			for (uint32_t i = 0; i < CHUNK_SIZE; ++ i)
+			{
+				chunk[i].next = (i + 1 < CHUNK_SIZE) ? &chunk[i + 1] : nullptr;
+			}
+			free_list_ = chunk;
+		}
+
+		NetMsgBuffer* msg = free_list_;
+		free_list_ = msg->next;
+		msg->next = nullptr;
+		msg->size = 0;
+		return msg;
+	}
+
+	void NetMsgPool::Free(NetMsgBuffer* msg)
+	{
+		BOOST_ASSERT(msg != nullptr);
+
+		msg->next = free_list_;
+		free_list_ = msg;
+	}
+
+
+	NetMsgQueue::NetMsgQueue()
+		: head_(nullptr), tail_(nullptr)
+	{
+	}
+
+	void NetMsgQueue::Push(NetMsgBuffer* msg)
+	{
+		msg->next = nullptr;
+		if (tail_ != nullptr)
+		{
+			tail_->next = msg;
+		}
+		else
+		{
+			head_ = msg;
+		}
+		tail_ = msg;
+	}
+
+	NetMsgBuffer* NetMsgQueue::Pop()
+	{
+		NetMsgBuffer* msg = head_;
+		if (msg != nullptr)
+		{
+			head_ = msg->next;
+			if (nullptr == head_)
+			{
+				tail_ = nullptr;
+			}
+			msg->next = nullptr;
+		}
+		return msg;
+	}
+
+	void NetMsgQueue::Clear(NetMsgPool& pool)
+	{
+		while (!this->Empty())
+		{
+			pool.Free(this->Pop());
+		}
+	}
+}
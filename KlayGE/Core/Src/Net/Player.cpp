@@ -45,7 +45,9 @@ namespace KlayGE
 	// 캯
 	/////////////////////////////////////////////////////////////////////////////////
 	Player::Player()
+		: playerID_(0), receiveLoop_(false)
 	{
+		std::memset(&lobbyAddr_, 0, sizeof(lobbyAddr_));
 	}
 
 	// 
@@ -59,56 +61,80 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void Player::ReceiveFunc()
 	{
-		static time_t lastTime = std::time(nullptr);
+		int const BATCH_SIZE = 16;
 
-		for (;;)
+		time_t lastTime = std::time(nullptr);
+		char revBufs[BATCH_SIZE][Max_Buffer];
+		SocketDatagram datagrams[BATCH_SIZE];
+
+		while (receiveLoop_)
 		{
-			if (std::time(nullptr) - lastTime >= 10 * 1000)
+			if (std::time(nullptr) - lastTime >= 10)
 			{
 				char msg(MSG_NOP);
 				socket_.Send(&msg, sizeof(msg));
 				lastTime = std::time(nullptr);
 			}
 
-			if (!sendQueue_.empty())
+			if (!sendQueue_.Empty())
 			{
 				// ͶϢ
-				for (auto const & msg : sendQueue_)
+				int num = 0;
+				for (NetMsgBuffer* msg = sendQueue_.Front(); (msg != nullptr) && (num < BATCH_SIZE); msg = msg->next, ++ num)
 				{
-					socket_.Send(&msg[0], static_cast<int>(msg.size()));
+					datagrams[num].buf = msg->data;
+					datagrams[num].len = static_cast<int>(msg->size);
+					datagrams[num].addr = lobbyAddr_;
 				}
+				socket_.SendToBatch(datagrams, num);
+			}
+
+			for (int i = 0; i < BATCH_SIZE; ++ i)
+			{
+				std::memset(revBufs[i], 0, Max_Buffer);
+				datagrams[i].buf = revBufs[i];
+				datagrams[i].len = Max_Buffer;
 			}
 
-			char revBuf[Max_Buffer];
-			memset(revBuf, 0, sizeof(revBuf));
-			if (socket_.Receive(revBuf, sizeof(revBuf)) != -1)
+			// ʱsocketĽճʱܼʱ˳
+			int const num = socket_.ReceiveFromBatch(datagrams, BATCH_SIZE);
+			for (int i = 0; i < num; ++ i)
 			{
+				char const * revBuf = revBufs[i];
+
 				uint32_t ID;
 				std::memcpy(&ID, &revBuf[1], 4);
 
 				// ɾѷ͵Ϣ
-				for (auto iter = sendQueue_.begin(); iter != sendQueue_.end();)
+				NetMsgQueue remains;
+				while (!sendQueue_.Empty())
 				{
-					std::vector<char>& msg = *iter;
+					NetMsgBuffer* msg = sendQueue_.Pop();
 
 					uint32_t sendID;
-					std::memcpy(&sendID, &msg[1], 4);
+					std::memcpy(&sendID, &msg->data[1], 4);
 					if (sendID == ID)
 					{
-						iter = sendQueue_.erase(iter);
+						msgPool_.Free(msg);
 					}
 					else
 					{
-						++ iter;
+						remains.Push(msg);
 					}
 				}
+				while (!remains.Empty())
+				{
+					sendQueue_.Push(remains.Pop());
+				}
 
 				if (MSG_QUIT == revBuf[0])
 				{
-					break;
+					receiveLoop_ = false;
 				}
 			}
 		}
+
+		sendQueue_.Clear(msgPool_);
 	}
 
 	// 
@@ -118,6 +144,7 @@ namespace KlayGE
 		socket_.Close();
 		socket_.Create(SOCK_DGRAM);
 		socket_.Connect(lobbyAddr);
+		lobbyAddr_ = lobbyAddr;
 
 		socket_.TimeOut(2000);
 
@@ -127,9 +154,18 @@ namespace KlayGE
 		buf[0] = MSG_JOIN;
 		name_.copy(&buf[1], this->name_.length());
 
-		socket_.Send(buf, sizeof(buf));
+		socket_.Send(buf, static_cast<int>(1 + name_.length() + 1));
 
-		socket_.Receive(&playerID_, sizeof(playerID_));
+		// ظʽ:
+		//			MSG_JOIN		1 ֽ
+		//			Player ID		4 ֽ
+		playerID_ = 0;
+		char reply[5];
+		if ((socket_.Receive(reply, sizeof(reply)) != sizeof(reply)) || (reply[0] != MSG_JOIN))
+		{
+			return false;
+		}
+		std::memcpy(&playerID_, &reply[1], sizeof(playerID_));
 		if (0 == playerID_)
 		{
 			return false;
@@ -145,13 +181,17 @@ namespace KlayGE
 	/////////////////////////////////////////////////////////////////////////////////
 	void Player::Quit()
 	{
-		if (receiveLoop_)
+		if (receiveThread_ != joiner<void>())
 		{
-			char msg(MSG_QUIT);
-			socket_.Send(&msg, sizeof(msg));
+			if (receiveLoop_)
+			{
+				char msg(MSG_QUIT);
+				socket_.Send(&msg, sizeof(msg));
 
-			receiveLoop_ = false;
+				receiveLoop_ = false;
+			}
 			receiveThread_();
+			receiveThread_ = joiner<void>();
 		}
 	}
 
@@ -172,18 +212,18 @@ namespace KlayGE
 		char msg(MSG_GETLOBBYINFO);
 		socket_.Send(&msg, sizeof(msg));
 
-		char buf[18];
-		socket_.Receive(buf, sizeof(buf));
-		if (MSG_GETLOBBYINFO == buf[0])
+		char buf[21];
+		if ((socket_.Receive(buf, sizeof(buf)) == sizeof(buf)) && (MSG_GETLOBBYINFO == buf[0]))
 		{
-			lobbydes.numPlayer = buf[1];
-			lobbydes.maxPlayers = buf[2];
+			std::memcpy(&lobbydes.numPlayer, &buf[1], sizeof(lobbydes.numPlayer));
+			std::memcpy(&lobbydes.maxPlayers, &buf[3], sizeof(lobbydes.maxPlayers));
 			size_t i(0);
-			while (buf[3 + i] != 0)
+			while ((i < 16) && (buf[5 + i] != 0))
 			{
 				++ i;
 			}
-			lobbydes.name = std::string(&buf[3], i);
+			lobbydes.name = std::string(&buf[5], i);
+			lobbydes.addr = lobbyAddr_;
 		}
 
 		return lobbydes;
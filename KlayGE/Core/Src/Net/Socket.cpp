@@ -16,12 +16,17 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ErrorHandling.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <system_error>
 #include <boost/assert.hpp>
 
 #include <KlayGE/Socket.hpp>
 
+#if defined KLAYGE_PLATFORM_LINUX
+	#include <sys/uio.h>
+#endif
+
 #if defined KLAYGE_PLATFORM_WINDOWS
 	// ʼWinsock
 	/////////////////////////////////////////////////////////////////////////////////
@@ -285,6 +290,119 @@ namespace KlayGE
 			reinterpret_cast<sockaddr const *>(&sockTo), sizeof(sockTo));
 	}
 
+	// 
+	/////////////////////////////////////////////////////////////////////////////////
+	int Socket::ReceiveFromBatch(SocketDatagram* datagrams, int count, int flags)
+	{
+		BOOST_ASSERT(this->socket_ != INVALID_SOCKET);
+
+#if defined KLAYGE_PLATFORM_LINUX
+		int const batch = 64;
+		mmsghdr msgs[batch];
+		iovec iovs[batch];
+		int received = 0;
+		while (received < count)
+		{
+			int const n = std::min(count - received, batch);
+			for (int i = 0; i < n; ++ i)
+			{
+				SocketDatagram& dg = datagrams[received + i];
+				iovs[i].iov_base = dg.buf;
+				iovs[i].iov_len = dg.len;
+				std::memset(&msgs[i], 0, sizeof(msgs[i]));
+				msgs[i].msg_hdr.msg_name = &dg.addr;
+				msgs[i].msg_hdr.msg_namelen = sizeof(dg.addr);
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			// Only the first datagram may block. Without MSG_WAITFORONE a blocking socket waits for all n of them.
+			int const ret = recvmmsg(this->socket_, msgs, n,
+				(received > 0) ? (flags | MSG_DONTWAIT) : (flags | MSG_WAITFORONE), nullptr);
+			if (ret <= 0)
+			{
+				break;
+			}
+			for (int i = 0; i < ret; ++ i)
+			{
+				datagrams[received + i].len = static_cast<int>(msgs[i].msg_len);
+			}
+			received += ret;
+			if (ret < n)
+			{
+				break;
+			}
+		}
+
+		return (received > 0) ? received : -1;
+#else
+		// Without recvmmsg there is no way to tell whether a following recvfrom would block
+		if (count <= 0)
+		{
+			return -1;
+		}
+		int const len = this->ReceiveFrom(datagrams[0].buf, datagrams[0].len, datagrams[0].addr, flags);
+		if (len < 0)
+		{
+			return -1;
+		}
+		datagrams[0].len = len;
+		return 1;
+#endif
+	}
+
+	// 
+	/////////////////////////////////////////////////////////////////////////////////
+	int Socket::SendToBatch(SocketDatagram const * datagrams, int count, int flags)
+	{
+		BOOST_ASSERT(this->socket_ != INVALID_SOCKET);
+
+		// A datagram that fails to send is dropped, as it would be on the wire, so it can't hold up the rest
+		int sent = 0;
+#if defined KLAYGE_PLATFORM_LINUX
+		int const batch = 64;
+		mmsghdr msgs[batch];
+		iovec iovs[batch];
+		int pos = 0;
+		while (pos < count)
+		{
+			int const n = std::min(count - pos, batch);
+			for (int i = 0; i < n; ++ i)
+			{
+				SocketDatagram const & dg = datagrams[pos + i];
+				iovs[i].iov_base = dg.buf;
+				iovs[i].iov_len = dg.len;
+				std::memset(&msgs[i], 0, sizeof(msgs[i]));
+				msgs[i].msg_hdr.msg_name = const_cast<sockaddr_in*>(&dg.addr);
+				msgs[i].msg_hdr.msg_namelen = sizeof(dg.addr);
+				msgs[i].msg_hdr.msg_iov = &iovs[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int const ret = sendmmsg(this->socket_, msgs, n, flags);
+			if (ret > 0)
+			{
+				sent += ret;
+				pos += ret;
+			}
+			else
+			{
+				++ pos;
+			}
+		}
+#else
+		for (int i = 0; i < count; ++ i)
+		{
+			if (this->SendTo(datagrams[i].buf, datagrams[i].len, datagrams[i].addr, flags) >= 0)
+			{
+				++ sent;
+			}
+		}
+#endif
+
+		return (sent > 0) ? sent : -1;
+	}
+
 	// ӷ
 	/////////////////////////////////////////////////////////////////////////////////
 	void Socket::Connect(sockaddr_in const & sockAddr)
@@ -302,7 +420,7 @@ namespace KlayGE
 		timeval timeOut;
 
 		timeOut.tv_sec = MicroSecs / 1000;
-		timeOut.tv_usec = MicroSecs % 1000;
+		timeOut.tv_usec = (MicroSecs % 1000) * 1000;
 
 		SetSockOpt(SO_RCVTIMEO, &timeOut, sizeof(timeOut));
 		SetSockOpt(SO_SNDTIMEO, &timeOut, sizeof(timeOut));
@@ -317,6 +435,6 @@ namespace KlayGE
 
 		this->GetSockOpt(SO_RCVTIMEO, &timeOut, len);
 
-		return timeOut.tv_sec * 1000 + timeOut.tv_usec;
+		return static_cast<uint32_t>(timeOut.tv_sec * 1000 + timeOut.tv_usec / 1000);
 	}
 }
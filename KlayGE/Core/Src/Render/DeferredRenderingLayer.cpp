@@ -33,6 +33,7 @@
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Util.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Hash.hpp>
 #include <KlayGE/DepthOfField.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/Renderable.hpp>
@@ -43,6 +44,7 @@
 #include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
 #include <KlayGE/SceneNodeHelper.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/App3D.hpp>
@@ -63,6 +65,7 @@ namespace
 	using namespace KlayGE;
 
 	int const SM_SIZE = 512;
+	uint32_t const SHADOW_CACHE_EVICT_FRAMES = 64;
 
 	int const MAX_IL_MIPMAP_LEVELS = 3;
 
@@ -410,6 +413,17 @@ namespace
 			*(effect_->ParameterByName("depth_near_far_invfar")) = float3(camera.NearPlane(), camera.FarPlane(), 1 / camera.FarPlane());
 		}
 	};
+
+	// A caster still streaming in renders nothing into the shadow map
+	bool RenderablesReady(SceneNode const & node)
+	{
+		bool ready = true;
+		node.ForEachComponentOfType<RenderableComponent>([&ready](RenderableComponent& component)
+			{
+				ready &= component.BoundRenderable().AllHWResourceReady();
+			});
+		return ready;
+	}
 }
 
 namespace KlayGE
@@ -1042,6 +1056,8 @@ namespace KlayGE
 		pvp.sample_count = sample_count;
 		pvp.sample_quality = sample_quality;
 
+		this->ReleaseTransientTextures(index);
+
 		if (fb)
 		{
 			pvp.attrib |= VPAM_Enabled;
@@ -1182,12 +1198,13 @@ namespace KlayGE
 			hint |= EAH_GPU_Unordered;
 		}
 #endif
-		pvp.shadowing_tex = rf.MakeTexture2D(width / 2, height / 2, 1, 1, fmt, 1, 0, hint);
+		pvp.shadowing_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_Lighting, width / 2, height / 2, 1, 1, fmt, 1, 0, hint);
 		pvp.shadowing_fb->Attach(FrameBuffer::Attachment::Color0, rf.Make2DRtv(pvp.shadowing_tex, 0, 1, 0));
 
 		fmt = caps.BestMatchTextureRenderTargetFormat({ EF_B10G11R11F, EF_ABGR8_SRGB, EF_ARGB8_SRGB, EF_ABGR8, EF_ARGB8 }, 1, 0);
 		BOOST_ASSERT(fmt != EF_Unknown);
-		pvp.projective_shadowing_tex = rf.MakeTexture2D(width / 2, height / 2, 1, 1, fmt, 1, 0, hint);
+		pvp.projective_shadowing_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_Lighting,
+			width / 2, height / 2, 1, 1, fmt, 1, 0, hint);
 		pvp.projective_shadowing_fb->Attach(FrameBuffer::Attachment::Color0, rf.Make2DRtv(pvp.projective_shadowing_tex, 0, 1, 0));
 
 		pvp.reflection_tex = rf.MakeTexture2D(width / 2, height / 2, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
@@ -1205,9 +1222,12 @@ namespace KlayGE
 
 		uint32_t const vdm_width = std::max(1U, width / 4);
 		uint32_t const vdm_height = std::max(1U, height / 4);
-		pvp.vdm_color_tex = rf.MakeTexture2D(vdm_width, vdm_height, 1, 1, shading_fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
-		pvp.vdm_transition_tex = rf.MakeTexture2D(vdm_width, vdm_height, 1, 1, EF_GR16F, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
-		pvp.vdm_count_tex = rf.MakeTexture2D(vdm_width, vdm_height, 1, 1, EF_GR16F, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
+		pvp.vdm_color_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_PostEffects, vdm_width, vdm_height, 1, 1,
+			shading_fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
+		pvp.vdm_transition_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_PostEffects, vdm_width, vdm_height, 1, 1,
+			EF_GR16F, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
+		pvp.vdm_count_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_PostEffects, vdm_width, vdm_height, 1, 1,
+			EF_GR16F, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
 		pvp.vdm_fb->Attach(FrameBuffer::Attachment::Color0, rf.Make2DRtv(pvp.vdm_color_tex, 0, 1, 0));
 		pvp.vdm_fb->Attach(FrameBuffer::Attachment::Color1, rf.Make2DRtv(pvp.vdm_transition_tex, 0, 1, 0));
 		pvp.vdm_fb->Attach(FrameBuffer::Attachment::Color2, rf.Make2DRtv(pvp.vdm_count_tex, 0, 1, 0));
@@ -1222,8 +1242,9 @@ namespace KlayGE
 			hint |= EAH_GPU_Unordered;
 		}
 #endif
-		pvp.shading_tex = rf.MakeTexture2D(width, height, 1, 1, shading_fmt, sample_count, sample_quality,
-			(sample_count == 1) ? hint : (EAH_GPU_Read | EAH_GPU_Write));
+		// Only the transparent passes shade into shading_tex, and it's merged before the post effects
+		pvp.shading_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_Lighting, width, height, 1, 1,
+			shading_fmt, sample_count, sample_quality, (sample_count == 1) ? hint : (EAH_GPU_Read | EAH_GPU_Write));
 		for (size_t i = 0; i < pvp.merged_shading_texs.size(); ++ i)
 		{
 			pvp.merged_shading_texs[i] = rf.MakeTexture2D(width, height, 1, 1, fmt, sample_count, sample_quality,
@@ -1250,7 +1271,9 @@ namespace KlayGE
 
 		if (!(attrib & VPAM_NoDoF))
 		{
-			pvp.dof_tex = rf.MakeTexture2D(width, height, 1, 1, fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
+			// In shading_fmt, so it takes the memory of shading_tex when that isn't multisampled
+			pvp.dof_tex = this->MakeTransientTexture2D(index, TS_Finishing, TS_Finishing, width, height, 1, 1,
+				shading_fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write);
 		}
 
 #if DEFAULT_DEFERRED == LIGHT_INDEXED_DEFERRED
@@ -1258,8 +1281,8 @@ namespace KlayGE
 		{
 			if (!typed_uav_)
 			{
-				pvp.temp_shading_tex = rf.MakeTexture2D(width, height, 1, 1, shading_fmt, sample_count, sample_quality,
-					EAH_GPU_Read | ((sample_count == 1) ? EAH_GPU_Unordered : EAH_GPU_Write));
+				pvp.temp_shading_tex = this->MakeTransientTexture2D(index, TS_Lighting, TS_Lighting, width, height, 1, 1,
+					shading_fmt, sample_count, sample_quality, EAH_GPU_Read | ((sample_count == 1) ? EAH_GPU_Unordered : EAH_GPU_Write));
 				if (sample_count != 1)
 				{
 					pvp.temp_shading_fb = rf.MakeFrameBuffer();
@@ -1269,8 +1292,8 @@ namespace KlayGE
 
 			if (sample_count != 1)
 			{
-				pvp.temp_shading_tex_array = rf.MakeTexture2D(width, height, 1, sample_count, fmt, 1, 0,
-					EAH_GPU_Read | EAH_GPU_Write | EAH_GPU_Unordered);
+				pvp.temp_shading_tex_array = this->MakeTransientTexture2D(index, TS_Lighting, TS_Lighting, width, height, 1, sample_count,
+					fmt, 1, 0, EAH_GPU_Read | EAH_GPU_Write | EAH_GPU_Unordered);
 
 				auto const multi_sample_mask_fmt = caps.BestMatchTextureRenderTargetFormat({ EF_R8, EF_ABGR8, EF_ARGB8 }, 1, 0);
 				pvp.multi_sample_mask_tex = rf.MakeTexture2D(width, height, 1, 1, multi_sample_mask_fmt, 1, 0,
@@ -1334,6 +1357,87 @@ namespace KlayGE
 #endif
 			dr_debug_pp_->InputPin(4, this->SmallSSVOTex(index));
 		}
+
+		uint64_t const saved = this->TransientRenderTargetMemorySaved();
+		if (saved > 0)
+		{
+			LogInfo() << "Deferred rendering shares " << (saved + 1023) / 1024
+				<< " KB of render targets between passes and viewports." << std::endl;
+		}
+	}
+
+	TexturePtr DeferredRenderingLayer::MakeTransientTexture2D(uint32_t vp, TransientStage first_stage, TransientStage last_stage,
+		uint32_t width, uint32_t height, uint32_t num_mip_maps, uint32_t array_size,
+		ElementFormat format, uint32_t sample_count, uint32_t sample_quality, uint32_t access_hint)
+	{
+		BOOST_ASSERT(first_stage <= last_stage);
+
+		TransientTexture::User const user = { vp, first_stage, last_stage };
+		for (auto& tt : transient_texs_)
+		{
+			// Extra access hints on the shared target don't hurt
+			if ((tt.tex->Width(0) != width) || (tt.tex->Height(0) != height)
+				|| (tt.tex->NumMipMaps() != num_mip_maps) || (tt.tex->ArraySize() != array_size)
+				|| (tt.tex->Format() != format) || (tt.tex->SampleCount() != sample_count)
+				|| (tt.tex->SampleQuality() != sample_quality) || ((tt.tex->AccessHint() & access_hint) != access_hint))
+			{
+				continue;
+			}
+
+			// Jobs of a viewport run in stage order, so a target can serve the stages that don't overlap
+			bool const in_use = std::any_of(tt.users.begin(), tt.users.end(),
+				[&user](TransientTexture::User const & other)
+				{
+					return (other.vp == user.vp)
+						&& (other.first_stage <= user.last_stage) && (user.first_stage <= other.last_stage);
+				});
+			if (!in_use)
+			{
+				tt.users.push_back(user);
+				return tt.tex;
+			}
+		}
+
+		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+		TransientTexture tt;
+		tt.tex = rf.MakeTexture2D(width, height, num_mip_maps, array_size, format, sample_count, sample_quality, access_hint);
+		tt.users.push_back(user);
+		transient_texs_.push_back(tt);
+		return transient_texs_.back().tex;
+	}
+
+	void DeferredRenderingLayer::ReleaseTransientTextures(uint32_t vp)
+	{
+		for (auto& tt : transient_texs_)
+		{
+			tt.users.erase(std::remove_if(tt.users.begin(), tt.users.end(),
+				[vp](TransientTexture::User const & user)
+				{
+					return user.vp == vp;
+				}), tt.users.end());
+		}
+		transient_texs_.erase(std::remove_if(transient_texs_.begin(), transient_texs_.end(),
+			[](TransientTexture const & tt)
+			{
+				return tt.users.empty();
+			}), transient_texs_.end());
+	}
+
+	uint64_t DeferredRenderingLayer::TransientRenderTargetMemorySaved() const
+	{
+		uint64_t saved = 0;
+		for (auto const & tt : transient_texs_)
+		{
+			uint64_t size = 0;
+			for (uint32_t level = 0; level < tt.tex->NumMipMaps(); ++ level)
+			{
+				size += static_cast<uint64_t>(tt.tex->Width(level)) * tt.tex->Height(level) * NumFormatBytes(tt.tex->Format());
+			}
+			size *= tt.tex->ArraySize() * tt.tex->SampleCount();
+
+			saved += size * (tt.users.size() - 1);
+		}
+		return saved;
 	}
 
 	RenderEffectPtr const & DeferredRenderingLayer::GBufferEffect(RenderMaterial const * material, bool line, bool skinning) const
@@ -1421,6 +1525,22 @@ namespace KlayGE
 		{
 			curr_cascade_index_ = -1;
 
+			++ shadow_frame_;
+			shadow_casters_refreshed_ = false;
+			num_shadow_faces_rendered_ = 0;
+			num_shadow_faces_reused_ = 0;
+			for (auto iter = shadow_caches_.begin(); iter != shadow_caches_.end();)
+			{
+				if (shadow_frame_ - iter->second.last_frame > SHADOW_CACHE_EVICT_FRAMES)
+				{
+					iter = shadow_caches_.erase(iter);
+				}
+				else
+				{
+					++ iter;
+				}
+			}
+
 			this->BuildLightList();
 
 			bool has_opaque_objs = false;
@@ -1637,6 +1757,44 @@ namespace KlayGE
 
 	void DeferredRenderingLayer::BuildPassScanList(bool has_opaque_objs, bool has_transparency_back_objs, bool has_transparency_front_objs)
 	{
+		if (dr_effect_->HWResourceReady())
+		{
+			for (uint32_t vpi = 0; vpi < viewports_.size(); ++ vpi)
+			{
+				PerViewport& pvp = viewports_[vpi];
+				if (pvp.attrib & VPAM_Enabled)
+				{
+					pvp.g_buffer_enables[PTB_Opaque] = (pvp.attrib & VPAM_NoOpaque) ? false : has_opaque_objs;
+					pvp.g_buffer_enables[PTB_TransparencyBack] = (pvp.attrib & VPAM_NoTransparencyBack) ? false : has_transparency_back_objs;
+					pvp.g_buffer_enables[PTB_TransparencyFront]
+						= (pvp.attrib & VPAM_NoTransparencyFront) ? false : has_transparency_front_objs;
+
+					pvp.light_visibles.resize(lights_.size());
+					for (uint32_t li = 0; li < lights_.size(); ++ li)
+					{
+						auto const & light = *lights_[li];
+						if (light.Enabled())
+						{
+							this->CheckLightVisible(vpi, li);
+						}
+						else
+						{
+							pvp.light_visibles[li] = false;
+						}
+					}
+				}
+			}
+		}
+
+		// The jobs only refer to viewports and lights by index, so the list can be kept as long as the configuration is the same
+		this->MakePassScanKey(new_pass_scan_key_);
+		if (!jobs_.empty() && (new_pass_scan_key_ == pass_scan_key_))
+		{
+			return;
+		}
+		pass_scan_key_.swap(new_pass_scan_key_);
+		++ num_pass_scan_list_rebuilds_;
+
 		jobs_.clear();
 
 		if (dr_effect_->HWResourceReady())
@@ -1670,25 +1828,6 @@ namespace KlayGE
 
 					jobs_.push_back(MakeSharedPtr<DeferredRenderingJob>([this, vpi] { return this->SwitchViewportDRJob(vpi); }));
 
-					pvp.g_buffer_enables[PTB_Opaque] = (pvp.attrib & VPAM_NoOpaque) ? false : has_opaque_objs;
-					pvp.g_buffer_enables[PTB_TransparencyBack] = (pvp.attrib & VPAM_NoTransparencyBack) ? false : has_transparency_back_objs;
-					pvp.g_buffer_enables[PTB_TransparencyFront]
-						= (pvp.attrib & VPAM_NoTransparencyFront) ? false : has_transparency_front_objs;
-
-					pvp.light_visibles.resize(lights_.size());
-					for (uint32_t li = 0; li < lights_.size(); ++ li)
-					{
-						auto const & light = *lights_[li];
-						if (light.Enabled())
-						{
-							this->CheckLightVisible(vpi, li);
-						}
-						else
-						{
-							pvp.light_visibles[li] = false;
-						}
-					}
-
 					for (uint32_t i = PTB_Opaque; i < PTB_None; ++ i)
 					{
 						PassTargetBuffer const pass_tb = static_cast<PassTargetBuffer>(i);
@@ -1792,6 +1931,45 @@ namespace KlayGE
 		}
 	}
 
+	void DeferredRenderingLayer::MakePassScanKey(std::vector<uint32_t>& key) const
+	{
+		key.clear();
+
+		key.push_back(dr_effect_->HWResourceReady());
+		key.push_back(display_type_);
+		key.push_back(illum_);
+		key.push_back(rsm_fb_ ? 1 : 0);
+		key.push_back(cascaded_shadow_index_);
+		key.push_back(has_reflective_objs_);
+		key.push_back(has_simple_forward_objs_);
+		key.push_back(has_vdm_objs_);
+
+		key.push_back(static_cast<uint32_t>(lights_.size()));
+		for (auto const * light : lights_)
+		{
+			key.push_back(light->Enabled());
+			key.push_back(light->Type());
+			key.push_back(light->Attrib());
+		}
+
+		for (auto const & pvp : viewports_)
+		{
+			key.push_back(pvp.attrib);
+			if (pvp.attrib & VPAM_Enabled)
+			{
+				key.push_back(pvp.num_cascades);
+				for (auto enable : pvp.g_buffer_enables)
+				{
+					key.push_back(enable);
+				}
+				for (auto visible : pvp.light_visibles)
+				{
+					key.push_back(visible);
+				}
+			}
+		}
+	}
+
 	void DeferredRenderingLayer::CheckLightVisible(uint32_t vp_index, uint32_t light_index)
 	{
 		SceneManager& scene_mgr = Context::Instance().SceneManagerInstance();
@@ -1917,6 +2095,11 @@ namespace KlayGE
 						{
 							return this->ShadowMapGenerationDRJob(viewports_[0], shadow_pt, light_index, 0);
 						}));
+					jobs_.push_back(MakeSharedPtr<DeferredRenderingJob>(
+						[this, shadow_pt, light_index]
+						{
+							return this->ShadowMapCompositionDRJob(shadow_pt, light_index, 0);
+						}));
 					jobs_.push_back(MakeSharedPtr<DeferredRenderingJob>(
 						[this, shadow_pt, light_index]
 						{
@@ -1938,6 +2121,14 @@ namespace KlayGE
 						{
 							return this->ShadowMapGenerationDRJob(viewports_[0], shadow_pt, light_index, j);
 						}));
+					if (j < 6)
+					{
+						jobs_.push_back(MakeSharedPtr<DeferredRenderingJob>(
+							[this, shadow_pt, light_index, j]
+							{
+								return this->ShadowMapCompositionDRJob(shadow_pt, light_index, j);
+							}));
+					}
 				}
 			}
 			break;
@@ -2280,6 +2471,161 @@ namespace KlayGE
 		}
 	}
 
+	void DeferredRenderingLayer::InvalidateShadowCaches()
+	{
+		shadow_caches_.clear();
+	}
+
+	void DeferredRenderingLayer::RefreshShadowCasters()
+	{
+		auto& scene_mgr = Context::Instance().SceneManagerInstance();
+		uint32_t const stamp = scene_mgr.SceneChangeStamp();
+		if (!shadow_casters_collected_ || (shadow_casters_stamp_ != stamp))
+		{
+			this->CollectShadowCasters();
+			shadow_casters_stamp_ = stamp;
+			++ shadow_casters_version_;
+		}
+		else if (!pending_shadow_casters_.empty())
+		{
+			auto const iter = std::remove_if(pending_shadow_casters_.begin(), pending_shadow_casters_.end(),
+				[](SceneNode const * node)
+				{
+					return RenderablesReady(*node);
+				});
+			if (iter != pending_shadow_casters_.end())
+			{
+				pending_shadow_casters_.erase(iter, pending_shadow_casters_.end());
+				++ shadow_casters_version_;
+			}
+		}
+
+		shadow_casters_refreshed_ = true;
+	}
+
+	void DeferredRenderingLayer::CollectShadowCasters()
+	{
+		static_shadow_casters_.clear();
+		moveable_shadow_casters_.clear();
+		pending_shadow_casters_.clear();
+
+		auto& scene_mgr = Context::Instance().SceneManagerInstance();
+		scene_mgr.SceneRootNode().Traverse([this](SceneNode& node)
+			{
+				uint32_t const attr = node.Attrib();
+				if (node.Visible() && !(attr & SceneNode::SOA_NotCastShadow)
+					&& (node.FirstComponentOfType<RenderableComponent>() != nullptr))
+				{
+					if (attr & SceneNode::SOA_Moveable)
+					{
+						moveable_shadow_casters_.push_back(&node);
+					}
+					else
+					{
+						static_shadow_casters_.push_back(&node);
+						if (!RenderablesReady(node))
+						{
+							pending_shadow_casters_.push_back(&node);
+						}
+					}
+				}
+				return node.Visible();
+			});
+
+		shadow_casters_collected_ = true;
+	}
+
+	void DeferredRenderingLayer::UpdateShadowCache(int32_t org_no)
+	{
+		if (!shadow_casters_refreshed_)
+		{
+			this->RefreshShadowCasters();
+		}
+
+		auto const & light = *lights_[org_no];
+		uint32_t const num_faces = (LightSource::LT_Spot == light.Type()) ? 1 : 6;
+
+		Sphere const bound(light.Position(), light.Range());
+		auto overlaps = [&bound](SceneNode const & node)
+		{
+			return !(node.Attrib() & SceneNode::SOA_Cullable) || MathLib::intersect_aabb_sphere(node.PosBoundWS(), bound);
+		};
+
+		auto& cache = shadow_caches_[&light];
+
+		// The static casters only need to be hashed again when the scene changed, a caster finished loading, or the light
+		// moved. Static nodes are expected to stay where they are, as the octree does.
+		if ((cache.casters_version != shadow_casters_version_) || (cache.casters_bound != bound))
+		{
+			size_t casters_key = 0;
+			for (auto const * node : static_shadow_casters_)
+			{
+				if (overlaps(*node))
+				{
+					HashCombine(casters_key, node);
+					float4x4 const & xform = node->TransformToWorld();
+					HashRange(casters_key, xform.begin(), xform.end());
+					HashCombine(casters_key, RenderablesReady(*node));
+				}
+			}
+
+			cache.casters_key = casters_key;
+			cache.casters_version = shadow_casters_version_;
+			cache.casters_bound = bound;
+		}
+
+		// Anything that changes the static part of the shadow map goes into the key
+		size_t static_key = cache.casters_key;
+		HashCombine(static_key, light.Type());
+		HashCombine(static_key, has_sss_objs_ && translucency_enabled_);
+		for (uint32_t i = 0; i < num_faces; ++ i)
+		{
+			float4x4 const & view_proj = light.SMCamera(i)->ViewProjMatrix();
+			HashRange(static_key, view_proj.begin(), view_proj.end());
+		}
+
+		bool has_moveable = false;
+		for (auto const * node : moveable_shadow_casters_)
+		{
+			if (overlaps(*node))
+			{
+				has_moveable = true;
+				break;
+			}
+		}
+
+		if (cache.static_key != static_key)
+		{
+			cache.static_key = static_key;
+			cache.static_valid.fill(false);
+		}
+
+		// The filtered maps are only untouched if this light had the same slot in the previous frame
+		int32_t const slot = sm_light_indices_[org_no].first;
+		bool const filtered_valid = (cache.last_frame + 1 == shadow_frame_) && (cache.filtered_slot == slot)
+			&& !cache.filtered_has_moveable && !has_moveable;
+		for (uint32_t i = 0; i < num_faces; ++ i)
+		{
+			if (!cache.static_valid[i])
+			{
+				cache.actions[i] = SFA_RenderStatic;
+			}
+			else if (filtered_valid)
+			{
+				cache.actions[i] = SFA_Reuse;
+			}
+			else
+			{
+				cache.actions[i] = SFA_Composite;
+			}
+		}
+
+		cache.last_frame = shadow_frame_;
+		cache.filtered_slot = slot;
+		cache.filtered_has_moveable = has_moveable;
+		cache.has_moveable = has_moveable;
+	}
+
 	void DeferredRenderingLayer::PostGenerateShadowMap(PerViewport const & pvp, int32_t org_no, int32_t index_in_pass)
 	{
 		LightSource::LightType const type = lights_[org_no]->Type();
@@ -4179,9 +4525,19 @@ namespace KlayGE
 		}
 
 		auto const & light = *lights_[org_no];
+		ShadowCache* cache = nullptr;
+		if ((PT_GenShadowMap == pass_type) && (light.Type() != LightSource::LT_Directional))
+		{
+			if (0 == index_in_pass)
+			{
+				this->UpdateShadowCache(org_no);
+			}
+			cache = &shadow_caches_[&light];
+		}
+
 		this->PrepareLightCamera(pvp, light, index_in_pass, pass_type);
 
-		if (index_in_pass > 0)
+		if ((index_in_pass > 0) && ((cache == nullptr) || (cache->actions[index_in_pass - 1] != SFA_Reuse)))
 		{
 			this->PostGenerateShadowMap(pvp, org_no, index_in_pass);
 		}
@@ -4195,6 +4551,11 @@ namespace KlayGE
 			curr_cascade_index_ = -1;
 			urv = 0;
 		}
+		else if ((cache != nullptr) && (SFA_Reuse == cache->actions[index_in_pass]))
+		{
+			++ num_shadow_faces_reused_;
+			urv = 0;
+		}
 		else
 		{
 			scene_mgr.SmallObjectThreshold(0.002f);
@@ -4207,7 +4568,22 @@ namespace KlayGE
 			case PRT_ShadowMap:
 				re.BindFrameBuffer(sm_fb_);
 				sm_fb_->AttachedRtv(FrameBuffer::Attachment::Color0)->Discard();
-				sm_fb_->AttachedDsv()->ClearDepth(1.0f);
+				if ((cache != nullptr) && (SFA_Composite == cache->actions[index_in_pass]))
+				{
+					// Start from the cached static casters, only the moveable ones need to be drawn
+					cache->static_depth_texs[index_in_pass]->CopyToTexture(*sm_depth_tex_);
+					urv = cache->has_moveable ? (urv | App3DFramework::URV_MoveableOnly) : 0;
+					++ num_shadow_faces_reused_;
+				}
+				else
+				{
+					sm_fb_->AttachedDsv()->ClearDepth(1.0f);
+					if (cache != nullptr)
+					{
+						urv |= App3DFramework::URV_StaticOnly;
+					}
+					++ num_shadow_faces_rendered_;
+				}
 				break;
 
 			case PRT_CascadedShadowMap:
@@ -4235,6 +4611,41 @@ namespace KlayGE
 		return urv;
 	}
 
+	uint32_t DeferredRenderingLayer::ShadowMapCompositionDRJob(PassType pass_type, int32_t org_no, int32_t index_in_pass)
+	{
+		auto const & light = *lights_[org_no];
+		if ((pass_type != PT_GenShadowMap) || (LightSource::LT_Directional == light.Type()))
+		{
+			return 0;
+		}
+
+		auto& cache = shadow_caches_[&light];
+		if (cache.actions[index_in_pass] != SFA_RenderStatic)
+		{
+			return 0;
+		}
+
+		// sm_fb_ holds only the static casters now. Keep them, and draw the moveable casters on top.
+		auto& tex = cache.static_depth_texs[index_in_pass];
+		if (!tex)
+		{
+			auto& rf = Context::Instance().RenderFactoryInstance();
+			tex = rf.MakeTexture2D(SM_SIZE, SM_SIZE, 1, 1, sm_depth_tex_->Format(), 1, 0, EAH_GPU_Read | EAH_GPU_Write);
+		}
+		sm_depth_tex_->CopyToTexture(*tex);
+		cache.static_valid[index_in_pass] = true;
+
+		if (cache.has_moveable)
+		{
+			Context::Instance().SceneManagerInstance().SmallObjectThreshold(0.002f);
+			return App3DFramework::URV_NeedFlush | App3DFramework::URV_OpaqueOnly | App3DFramework::URV_MoveableOnly;
+		}
+		else
+		{
+			return 0;
+		}
+	}
+
 	uint32_t DeferredRenderingLayer::IndirectLightingDRJob(PerViewport const & pvp, int32_t org_no)
 	{
 		depth_to_esm_pp_->Apply();
@@ -29,8 +29,204 @@
  */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/Thread.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <limits>
+
 #include <KlayGE/DistanceField.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	float const DIST_INF = 1e20f;
+	uint32_t const NO_FEATURE = 0xFFFFFFFFU;
+
+	// Below this many texels in a pass, the thread pool costs more than it saves
+	uint32_t const MIN_TEXELS_PER_TASK = 16 * 1024;
+
+	uint32_t NumDistanceThreads()
+	{
+		static uint32_t const num_threads = std::max(CPUInfo().NumHWThreads(), 1);
+		return num_threads;
+	}
+
+	// Calls func(begin, end) on ranges of [0, num_lines), spread over the thread pool
+	template <typename Func>
+	void ParallelForLines(uint32_t num_lines, uint32_t line_length, Func const & func)
+	{
+		uint32_t const num_tasks = std::max(1U, std::min({ NumDistanceThreads(), num_lines,
+			static_cast<uint32_t>(static_cast<uint64_t>(num_lines) * line_length / MIN_TEXELS_PER_TASK) }));
+		uint32_t const lines_per_task = (num_lines + num_tasks - 1) / num_tasks;
+
+		auto& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(num_tasks - 1);
+		for (uint32_t i = 1; i < num_tasks; ++ i)
+		{
+			uint32_t const begin = i * lines_per_task;
+			if (begin < num_lines)
+			{
+				uint32_t const end = std::min(begin + lines_per_task, num_lines);
+				joiners.push_back(tp([&func, begin, end] { func(begin, end); }));
+			}
+		}
+		func(0, std::min(lines_per_task, num_lines));
+
+		for (auto& joiner : joiners)
+		{
+			joiner();
+		}
+	}
+
+	// Lower envelope of the parabolas rooted at the finite samples of f. Gives the squared distance of each sample, and the
+	// sample it comes from. v and z are scratch of n and n + 1 elements. Returns false if there is no finite sample.
+	bool DistanceTransform1D(float const * f, uint32_t n, float* d, uint32_t* nearest, uint32_t* v, double* z)
+	{
+		uint32_t k = 0;
+		bool found = false;
+		for (uint32_t q = 0; q < n; ++ q)
+		{
+			if (f[q] >= DIST_INF)
+			{
+				continue;
+			}
+
+			double const fq = f[q] + static_cast<double>(q) * q;
+			if (!found)
+			{
+				v[0] = q;
+				z[0] = -std::numeric_limits<double>::infinity();
+				z[1] = +std::numeric_limits<double>::infinity();
+				found = true;
+				continue;
+			}
+
+			double s;
+			for (;;)
+			{
+				uint32_t const p = v[k];
+				s = (fq - (f[p] + static_cast<double>(p) * p)) / (2.0 * (q - p));
+				if (s > z[k])
+				{
+					break;
+				}
+				-- k;
+			}
+
+			++ k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = +std::numeric_limits<double>::infinity();
+		}
+
+		if (!found)
+		{
+			return false;
+		}
+
+		k = 0;
+		for (uint32_t q = 0; q < n; ++ q)
+		{
+			while (z[k + 1] < q)
+			{
+				++ k;
+			}
+
+			uint32_t const p = v[k];
+			float const dq = static_cast<float>(q) - p;
+			d[q] = dq * dq + f[p];
+			nearest[q] = p;
+		}
+		return true;
+	}
+
+	// Exact squared Euclidean distance transform, one separable pass per axis. sq_dist is 0 at the features and DIST_INF
+	// elsewhere on input. If features is given, it starts as the index of each feature texel and ends as the index of the
+	// nearest one.
+	void SquaredEuclideanDistance(std::vector<float>& sq_dist, std::vector<uint32_t>* features,
+		uint32_t width, uint32_t height, uint32_t depth)
+	{
+		BOOST_ASSERT(sq_dist.size() == static_cast<size_t>(width) * height * depth);
+		BOOST_ASSERT(!features || (features->size() == sq_dist.size()));
+
+		uint32_t const dims[] = { width, height, depth };
+		uint32_t const strides[] = { 1, width, width * height };
+		for (uint32_t axis = 0; axis < 3; ++ axis)
+		{
+			uint32_t const n = dims[axis];
+			uint32_t const stride = strides[axis];
+			if (n <= 1)
+			{
+				continue;
+			}
+
+			uint32_t const num_lines = static_cast<uint32_t>(sq_dist.size() / n);
+			ParallelForLines(num_lines, n, [&sq_dist, features, n, stride](uint32_t begin, uint32_t end)
+				{
+					std::vector<float> f(n);
+					std::vector<float> d(n);
+					std::vector<uint32_t> nearest(n);
+					std::vector<uint32_t> line_features(n);
+					std::vector<uint32_t> v(n);
+					std::vector<double> z(n + 1);
+
+					for (uint32_t line = begin; line < end; ++ line)
+					{
+						size_t const base = static_cast<size_t>(line / stride) * stride * n + line % stride;
+						for (uint32_t q = 0; q < n; ++ q)
+						{
+							f[q] = sq_dist[base + q * stride];
+						}
+
+						if (!DistanceTransform1D(f.data(), n, d.data(), nearest.data(), v.data(), z.data()))
+						{
+							continue;
+						}
+
+						for (uint32_t q = 0; q < n; ++ q)
+						{
+							sq_dist[base + q * stride] = d[q];
+						}
+						if (features)
+						{
+							for (uint32_t q = 0; q < n; ++ q)
+							{
+								line_features[q] = (*features)[base + q * stride];
+							}
+							for (uint32_t q = 0; q < n; ++ q)
+							{
+								(*features)[base + q * stride] = line_features[nearest[q]];
+							}
+						}
+					}
+				});
+		}
+	}
+
+	void EuclideanDistance(std::vector<uint8_t> const & mask, bool inside, uint32_t width, uint32_t height, uint32_t depth,
+		std::vector<float>& dist_data)
+	{
+		BOOST_ASSERT(mask.size() == static_cast<size_t>(width) * height * depth);
+
+		dist_data.resize(mask.size());
+		for (size_t i = 0; i < mask.size(); ++ i)
+		{
+			dist_data[i] = ((mask[i] != 0) != inside) ? 0 : DIST_INF;
+		}
+
+		SquaredEuclideanDistance(dist_data, nullptr, width, height, depth);
+
+		for (auto& dist : dist_data)
+		{
+			dist = MathLib::sqrt(dist);
+		}
+	}
+}
+
 namespace KlayGE
 {
 	float EdgeDistance(float2 const & grad, float val)
@@ -115,23 +311,50 @@ namespace KlayGE
 	void AAEuclideanDistance(std::vector<float> const & img, std::vector<float2> const & grad,
 		int width, int height, std::vector<float>& dist)
 	{
-		std::vector<int2> dist_xy(img.size(), int2(0, 0));
-
+		// Start from the nearest covered texel of each texel, given by an exact feature transform. The nearest texel center
+		// isn't always the nearest edge, so the sweeps below still run, but only to refine the sub-texel edge distances.
+		std::vector<float> sq_dist(img.size());
+		std::vector<uint32_t> features(img.size());
 		for (size_t i = 0; i < img.size(); ++ i)
 		{
-			if (img[i] <= 0)
+			if (img[i] > 0)
 			{
-				dist[i] = 1e10f;
-			}
-			else if (img[i] < 1)
-			{
-				dist[i] = EdgeDistance(grad[i], img[i]);
+				sq_dist[i] = 0;
+				features[i] = static_cast<uint32_t>(i);
 			}
 			else
 			{
-				dist[i] = 0;
+				sq_dist[i] = DIST_INF;
+				features[i] = NO_FEATURE;
 			}
 		}
+		SquaredEuclideanDistance(sq_dist, &features, width, height, 1);
+
+		std::vector<int2> dist_xy(img.size(), int2(0, 0));
+		ParallelForLines(height, width, [&img, &grad, &features, &dist_xy, &dist, width](uint32_t begin, uint32_t end)
+			{
+				for (int y = static_cast<int>(begin); y < static_cast<int>(end); ++ y)
+				{
+					for (int x = 0; x < width; ++ x)
+					{
+						int const addr = y * width + x;
+						uint32_t const closest = features[addr];
+						if (img[addr] >= 1)
+						{
+							dist[addr] = 0;
+						}
+						else if (NO_FEATURE == closest)
+						{
+							dist[addr] = 1e10f;
+						}
+						else
+						{
+							dist_xy[addr] = int2(x - static_cast<int>(closest % width), y - static_cast<int>(closest / width));
+							dist[addr] = AADist(img, grad, width, addr, dist_xy[addr], float2(dist_xy[addr]));
+						}
+					}
+				}
+			});
 
 		bool changed;
 		do
@@ -278,4 +501,32 @@ namespace KlayGE
 			dist_data[i] = inside[i] - outside[i];
 		}
 	}
+
+	void ComputeEuclideanDistance(std::vector<uint8_t> const & mask, uint32_t width, uint32_t height, uint32_t depth,
+		std::vector<float>& dist_data)
+	{
+		EuclideanDistance(mask, false, width, height, depth, dist_data);
+	}
+
+	void ComputeSignedEuclideanDistance(std::vector<uint8_t> const & mask, uint32_t width, uint32_t height, uint32_t depth,
+		std::vector<float>& dist_data)
+	{
+		std::vector<float> outside;
+		EuclideanDistance(mask, false, width, height, depth, outside);
+		std::vector<float> inside;
+		EuclideanDistance(mask, true, width, height, depth, inside);
+
+		dist_data.resize(mask.size());
+		for (size_t i = 0; i < mask.size(); ++ i)
+		{
+			if (mask[i] != 0)
+			{
+				dist_data[i] = inside[i] - 0.5f;
+			}
+			else
+			{
+				dist_data[i] = 0.5f - outside[i];
+			}
+		}
+	}
 }
@@ -29,6 +29,7 @@
  */
 
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KFL/Util.hpp>
 #include <KFL/Half.hpp>
 #include <KlayGE/RenderLayout.hpp>
@@ -73,8 +74,7 @@ namespace KlayGE
 		explicit FontRenderable(std::shared_ptr<KFont> const & kfl)
 				: Renderable(L"Font"),
 					three_dim_(false),
-					kfont_loader_(kfl),
-					tick_(0)
+					kfont_loader_(kfl)
 		{
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 
@@ -94,14 +94,14 @@ namespace KlayGE
 
 			RenderEngine const & renderEngine = rf.RenderEngineInstance();
 			RenderDeviceCaps const & caps = renderEngine.DeviceCaps();
-			uint32_t size = std::min<uint32_t>(2048U, std::min<uint32_t>(caps.max_texture_width, caps.max_texture_height)) / kfont_char_size * kfont_char_size;
-			dist_texture_ = rf.MakeTexture2D(size, size, 1, 1, EF_R8, 1, 0, EAH_GPU_Read);
-			a_char_data_.resize(kfont_char_size * kfont_char_size);
-
-			char_free_list_.emplace_back(0, size * size / kfont_char_size / kfont_char_size);
+			tex_size_ = std::min<uint32_t>(2048U, std::min<uint32_t>(caps.max_texture_width, caps.max_texture_height)) / kfont_char_size * kfont_char_size;
+			num_chars_a_row_ = tex_size_ / kfont_char_size;
+			slots_per_page_ = num_chars_a_row_ * num_chars_a_row_;
+			this->AddPage();
 
 			effect_ = SyncLoadRenderEffect("Font.fxml");
-			*(effect_->ParameterByName("distance_tex")) = dist_texture_;
+			distance_tex_ep_ = effect_->ParameterByName("distance_tex");
+			*distance_tex_ep_ = dist_textures_[0];
 			*(effect_->ParameterByName("distance_base_scale")) = float2(kfont_loader_->DistBase() / 32768.0f * 32 + 1, (kfont_loader_->DistScale() / 32768.0f + 1.0f) * 32);
 
 			half_width_height_ep_ = effect_->ParameterByName("half_width_height");
@@ -158,6 +158,7 @@ namespace KlayGE
 
 			tb_vb_sub_allocs_.clear();
 			tb_ib_sub_allocs_.clear();
+			sub_alloc_pages_.clear();
 
 			tb_vb_->OnPresent();
 			tb_ib_->OnPresent();
@@ -170,14 +171,17 @@ namespace KlayGE
 			this->OnRenderBegin();
 
 			BOOST_ASSERT(tb_vb_sub_allocs_.size() == tb_ib_sub_allocs_.size());
+			BOOST_ASSERT(tb_vb_sub_allocs_.size() == sub_alloc_pages_.size());
 
 			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
 			{
+				uint32_t const page = sub_alloc_pages_[i];
 				uint32_t vert_length = tb_vb_sub_allocs_[i].length_;
 				uint32_t const ind_offset = tb_ib_sub_allocs_[i].offset_;
 				uint32_t ind_length = tb_ib_sub_allocs_[i].length_;
 
 				while ((i + 1 < tb_vb_sub_allocs_.size())
+					&& (sub_alloc_pages_[i + 1] == page)
 					&& (tb_vb_sub_allocs_[i].offset_ + tb_vb_sub_allocs_[i].length_ == tb_vb_sub_allocs_[i + 1].offset_)
 					&& (tb_ib_sub_allocs_[i].offset_ + tb_ib_sub_allocs_[i].length_ == tb_ib_sub_allocs_[i + 1].offset_))
 				{
@@ -190,21 +194,16 @@ namespace KlayGE
 				rls_[0]->StartIndexLocation(ind_offset / sizeof(uint16_t));
 				rls_[0]->NumIndices(ind_length / sizeof(uint16_t));
 
+				*distance_tex_ep_ = dist_textures_[page];
 				re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rls_[0]);
 			}
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				tb_vb_->Dealloc(tb_vb_sub_allocs_[i]);
-				tb_ib_->Dealloc(tb_ib_sub_allocs_[i]);
-			}
-
 			this->OnRenderEnd();
 		}
 
 		Size_T<float> CalcSize(std::wstring_view text, float font_size)
 		{
-			this->UpdateTexture(text);
+			this->PrepareGlyphs(text);
 
 			KFont& kl = *kfont_loader_;
 
@@ -253,18 +252,137 @@ namespace KlayGE
 			this->AddText(0, 0, 0, 1, 1, clr, text, font_size);
 		}
 
+		// Makes sure all glyphs of the text are in the atlas. Missing glyphs are read from the font, then
+		// decompressed on the thread pool, then uploaded.
+		void PrepareGlyphs(std::wstring_view text)
+		{
+			KFont& kl = *kfont_loader_;
+			uint32_t const kfont_char_size = kl.CharSize();
+			uint32_t const char_data_size = kfont_char_size * kfont_char_size;
+
+			uint32_t const frame = Context::Instance().AppValid() ? Context::Instance().AppInstance().TotalNumFrames() : 0;
+
+			missing_glyphs_.clear();
+			for (auto const & ch : text)
+			{
+				int32_t const index = kl.CharIndex(ch);
+				if (index != -1)
+				{
+					auto cmiter = char_info_map_.find(ch);
+					if (cmiter != char_info_map_.end())
+					{
+						this->TouchSlot(cmiter->second.slot, frame);
+					}
+					else
+					{
+						missing_glyphs_.emplace_back(ch, index);
+					}
+				}
+			}
+			if (missing_glyphs_.empty())
+			{
+				return;
+			}
+
+			std::sort(missing_glyphs_.begin(), missing_glyphs_.end());
+			missing_glyphs_.erase(std::unique(missing_glyphs_.begin(), missing_glyphs_.end()), missing_glyphs_.end());
+			uint32_t const num_glyphs = static_cast<uint32_t>(missing_glyphs_.size());
+
+			std::vector<uint32_t> glyph_slots(num_glyphs);
+			for (uint32_t i = 0; i < num_glyphs; ++ i)
+			{
+				wchar_t const ch = missing_glyphs_[i].first;
+				KFont::font_info const & fi = kl.CharInfo(missing_glyphs_[i].second);
+
+				uint32_t const slot = this->AllocSlot(frame);
+				slots_[slot].ch = ch;
+				glyph_slots[i] = slot;
+
+				int2 const char_pos = this->SlotPosition(slot);
+
+				CharInfo char_info;
+				char_info.page = slot / slots_per_page_;
+				char_info.slot = slot;
+				char_info.rc.left() = static_cast<float>(char_pos.x()) / tex_size_;
+				char_info.rc.top() = static_cast<float>(char_pos.y()) / tex_size_;
+				char_info.rc.right() = char_info.rc.left() + static_cast<float>(fi.width) / tex_size_;
+				char_info.rc.bottom() = char_info.rc.top() + static_cast<float>(fi.height) / tex_size_;
+				char_info_map_[ch] = char_info;
+			}
+
+			// The font stream is shared, so the compressed data has to be read in sequence
+			std::vector<uint32_t> lzma_offsets(num_glyphs + 1);
+			lzma_offsets[0] = 0;
+			for (uint32_t i = 0; i < num_glyphs; ++ i)
+			{
+				uint32_t size;
+				kl.GetLZMADistanceData(nullptr, size, missing_glyphs_[i].second);
+				lzma_offsets[i + 1] = lzma_offsets[i] + size;
+			}
+			lzma_data_.resize(lzma_offsets[num_glyphs]);
+			for (uint32_t i = 0; i < num_glyphs; ++ i)
+			{
+				uint32_t size;
+				kl.GetLZMADistanceData(&lzma_data_[lzma_offsets[i]], size, missing_glyphs_[i].second);
+			}
+
+			decoded_data_.resize(num_glyphs * char_data_size);
+			auto decode_glyphs = [this, &lzma_offsets, char_data_size](uint32_t begin, uint32_t end)
+			{
+				LZMACodec lzma;
+				for (uint32_t i = begin; i < end; ++ i)
+				{
+					lzma.Decode(&decoded_data_[i * char_data_size],
+						MakeArrayRef(&lzma_data_[lzma_offsets[i]], lzma_offsets[i + 1] - lzma_offsets[i]), char_data_size);
+				}
+			};
+
+			static uint32_t const num_threads = std::max(CPUInfo().NumHWThreads(), 1);
+			uint32_t const num_tasks = std::min(num_threads, num_glyphs / MIN_GLYPHS_PER_TASK);
+			if (num_tasks <= 1)
+			{
+				decode_glyphs(0, num_glyphs);
+			}
+			else
+			{
+				uint32_t const glyphs_per_task = (num_glyphs + num_tasks - 1) / num_tasks;
+
+				auto& tp = Context::Instance().ThreadPool();
+				std::vector<joiner<void>> joiners;
+				joiners.reserve(num_tasks - 1);
+				for (uint32_t i = 1; i < num_tasks; ++ i)
+				{
+					uint32_t const begin = std::min(i * glyphs_per_task, num_glyphs);
+					uint32_t const end = std::min(begin + glyphs_per_task, num_glyphs);
+					joiners.push_back(tp([&decode_glyphs, begin, end] { decode_glyphs(begin, end); }));
+				}
+				decode_glyphs(0, std::min(glyphs_per_task, num_glyphs));
+
+				for (auto& joiner : joiners)
+				{
+					joiner();
+				}
+			}
+
+			// Upload in allocation order, so if a slot is reused within this batch the last glyph wins
+			for (uint32_t i = 0; i < num_glyphs; ++ i)
+			{
+				uint32_t const slot = glyph_slots[i];
+				int2 const char_pos = this->SlotPosition(slot);
+				dist_textures_[slot / slots_per_page_]->UpdateSubresource2D(0, 0, char_pos.x(), char_pos.y(),
+					kfont_char_size, kfont_char_size, &decoded_data_[i * char_data_size], kfont_char_size);
+			}
+		}
+
 	private:
 		void AddText(Rect const & rc, float sz,
 			float xScale, float yScale, Color const & clr, std::wstring_view text, float font_size, uint32_t align)
 		{
-			this->UpdateTexture(text);
+			this->PrepareGlyphs(text);
 
 			KFont const & kl = *kfont_loader_;
 			auto const & cim = char_info_map_;
 
-			std::vector<FontVert> vertices;
-			std::vector<uint16_t> indices;
-
 			float const h = font_size * yScale;
 			float const rel_size = font_size / kl.CharSize();
 			float const rel_size_x = rel_size * xScale;
@@ -330,16 +448,11 @@ namespace KlayGE
 				}
 			}
 
-			uint32_t const index_per_char = restart_ ? 5 : 6;
-
 			uint32_t const clr32 = clr.ABGR();
 			for (size_t i = 0; i < sx.size(); ++ i)
 			{
-				size_t const maxSize = lines[i].second.length();
 				float x = sx[i], y = sy[i];
 
-				vertices.reserve(maxSize * 4);
-
 				for (auto const & ch : lines[i].second)
 				{
 					std::pair<int32_t, uint32_t> const & offset_adv = kl.CharIndexAdvance(ch);
@@ -353,24 +466,14 @@ namespace KlayGE
 						float height = ci.height * rel_size_y;
 
 						auto cmiter = cim.find(ch);
-						Rect const & texRect(cmiter->second.rc);
-
-						Rect pos_rc(x + left, y + top, x + left + width, y + top + height);
-						Rect intersect_rc = pos_rc & rc;
-						if ((intersect_rc.Width() > 0) && (intersect_rc.Height() > 0))
+						if (cmiter != cim.end())
 						{
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz),
-													clr32,
-													float2(texRect.left(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz),
-													clr32,
-													float2(texRect.right(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz),
-													clr32,
-													float2(texRect.right(), texRect.bottom())));
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz),
-													clr32,
-													float2(texRect.left(), texRect.bottom())));
+							Rect pos_rc(x + left, y + top, x + left + width, y + top + height);
+							Rect intersect_rc = pos_rc & rc;
+							if ((intersect_rc.Width() > 0) && (intersect_rc.Height() > 0))
+							{
+								this->AddQuad(cmiter->second.page, cmiter->second.rc, pos_rc, sz, clr32);
+							}
 						}
 					}
 
@@ -378,61 +481,28 @@ namespace KlayGE
 					y += (offset_adv.second >> 16) * rel_size_y;
 				}
 
-				tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
-
-				uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
-				uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
-				indices.reserve(num_chars * index_per_char);
-				for (uint32_t c = 0; c < num_chars; ++ c)
-				{
-					indices.push_back(last_index + 0);
-					indices.push_back(last_index + 1);
-					if (restart_)
-					{
-						indices.push_back(last_index + 3);
-						indices.push_back(last_index + 2);
-						indices.push_back(0xFFFF);
-					}
-					else
-					{
-						indices.push_back(last_index + 2);
-						indices.push_back(last_index + 2);
-						indices.push_back(last_index + 3);
-						indices.push_back(last_index + 0);
-					}
-					last_index += 4;
-				}
-				BOOST_ASSERT(last_index + 3 <= 0xFFFF);
-				tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
-
 				pos_aabb_ |= AABBox(float3(sx[i], sy[i], sz), float3(sx[i] + lines[i].first, sy[i] + h, sz + 0.1f));
 			}
+
+			this->CommitQuads();
 		}
 
 		void AddText(float sx, float sy, float sz,
 			float xScale, float yScale, Color const & clr, std::wstring_view text, float font_size)
 		{
-			this->UpdateTexture(text);
+			this->PrepareGlyphs(text);
 
 			KFont const & kl = *kfont_loader_;
 			auto const & cim = char_info_map_;
 
-			std::vector<FontVert> vertices;
-			std::vector<uint16_t> indices;
-
 			uint32_t const clr32 = clr.ABGR();
 			float const h = font_size * yScale;
 			float const rel_size = font_size / kl.CharSize();
 			float const rel_size_x = rel_size * xScale;
 			float const rel_size_y = rel_size * yScale;
-			size_t const maxSize = text.length() - std::count(text.begin(), text.end(), L'\n');
 			float x = sx, y = sy;
 			float maxx = sx, maxy = sy;
 
-			uint32_t const index_per_char = restart_ ? 5 : 6;
-
-			vertices.reserve(maxSize * 4);
-
 			for (auto const & ch : text)
 			{
 				if (ch != L'\n')
@@ -450,21 +520,8 @@ namespace KlayGE
 						auto cmiter = cim.find(ch);
 						if (cmiter != cim.end())
 						{
-							Rect const & texRect(cmiter->second.rc);
 							Rect pos_rc(x + left, y + top, x + left + width, y + top + height);
-
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz),
-												clr32,
-												float2(texRect.left(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz),
-												clr32,
-												float2(texRect.right(), texRect.top())));
-							vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz),
-												clr32,
-												float2(texRect.right(), texRect.bottom())));
-							vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz),
-												clr32,
-												float2(texRect.left(), texRect.bottom())));
+							this->AddQuad(cmiter->second.page, cmiter->second.rc, pos_rc, sz, clr32);
 						}
 					}
 
@@ -488,176 +545,184 @@ namespace KlayGE
 				}
 			}
 
-			tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
-
-			uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
-			uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
-			indices.reserve(num_chars * index_per_char);
-			for (uint32_t c = 0; c < num_chars; ++ c)
-			{
-				indices.push_back(last_index + 0);
-				indices.push_back(last_index + 1);
-				if (restart_)
-				{
-					indices.push_back(last_index + 3);
-					indices.push_back(last_index + 2);
-					indices.push_back(0xFFFF);
-				}
-				else
-				{
-					indices.push_back(last_index + 2);
-					indices.push_back(last_index + 2);
-					indices.push_back(last_index + 3);
-					indices.push_back(last_index + 0);
-				}
-				last_index += 4;
-			}
-			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+			this->CommitQuads();
 
 			pos_aabb_ |= AABBox(float3(sx, sy, sz), float3(maxx, maxy, sz + 0.1f));
 		}
 
-		// ʹLRU㷨
-		/////////////////////////////////////////////////////////////////////////////////
-		void UpdateTexture(std::wstring_view text)
+		void AddQuad(uint32_t page, Rect const & tex_rc, Rect const & pos_rc, float sz, uint32_t clr32)
 		{
-			++ tick_;
-
-			uint32_t const tex_size = dist_texture_->Width(0);
+			auto& vertices = page_vertices_[page];
+			vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.top(), sz), clr32, float2(tex_rc.left(), tex_rc.top())));
+			vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.top(), sz), clr32, float2(tex_rc.right(), tex_rc.top())));
+			vertices.push_back(FontVert(float3(pos_rc.right(), pos_rc.bottom(), sz), clr32, float2(tex_rc.right(), tex_rc.bottom())));
+			vertices.push_back(FontVert(float3(pos_rc.left(), pos_rc.bottom(), sz), clr32, float2(tex_rc.left(), tex_rc.bottom())));
+		}
 
-			KFont& kl = *kfont_loader_;
-			auto& cim = char_info_map_;
+		// Moves the quads added by AddQuad into the transient buffers, one sub allocation per atlas page
+		void CommitQuads()
+		{
+			uint32_t const index_per_char = restart_ ? 5 : 6;
 
-			uint32_t const kfont_char_size = kl.CharSize();
+			for (uint32_t page = 0; page < page_vertices_.size(); ++ page)
+			{
+				auto& vertices = page_vertices_[page];
+				if (vertices.empty())
+				{
+					continue;
+				}
 
-			uint32_t const num_chars_a_row = tex_size / kfont_char_size;
-			uint32_t const num_total_chars = num_chars_a_row * num_chars_a_row;
+				tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
 
-			for (auto const & ch : text)
-			{
-				int32_t offset = kl.CharIndex(ch);
-				if (offset != -1)
+				uint16_t last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(FontVert));
+				uint32_t const num_chars = static_cast<uint32_t>(vertices.size() / 4);
+				indices_.clear();
+				indices_.reserve(num_chars * index_per_char);
+				for (uint32_t c = 0; c < num_chars; ++ c)
 				{
-					auto cmiter = cim.find(ch);
-					if (cmiter != cim.end())
+					indices_.push_back(last_index + 0);
+					indices_.push_back(last_index + 1);
+					if (restart_)
 					{
-						// ҵ
-
-						cmiter->second.tick = tick_;
+						indices_.push_back(last_index + 3);
+						indices_.push_back(last_index + 2);
+						indices_.push_back(0xFFFF);
 					}
 					else
 					{
-						// ҲԵ
-
-						KFont::font_info const & ci = kl.CharInfo(offset);
-
-						uint32_t width = ci.width;
-						uint32_t height = ci.height;
-
-						int2 char_pos;
-						CharInfo charInfo;
-						if (cim.size() < num_total_chars)
-						{
-							// пռ
+						indices_.push_back(last_index + 2);
+						indices_.push_back(last_index + 2);
+						indices_.push_back(last_index + 3);
+						indices_.push_back(last_index + 0);
+					}
+					last_index += 4;
+				}
+				BOOST_ASSERT(last_index + 3 <= 0xFFFF);
+				tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices_.size() * sizeof(indices_[0])), &indices_[0]));
+				sub_alloc_pages_.push_back(page);
 
-							uint32_t const s = char_free_list_.front().first;
-						
-							char_pos.y() = s / num_chars_a_row;
-							char_pos.x() = s - char_pos.y() * num_chars_a_row;
+				vertices.clear();
+			}
+		}
 
-							char_pos.x() *= kfont_char_size;
-							char_pos.y() *= kfont_char_size;
+		int2 SlotPosition(uint32_t slot) const
+		{
+			uint32_t const cell = slot % slots_per_page_;
+			uint32_t const char_size = tex_size_ / num_chars_a_row_;
+			return int2((cell % num_chars_a_row_) * char_size, (cell / num_chars_a_row_) * char_size);
+		}
 
-							charInfo.rc.left() = static_cast<float>(char_pos.x()) / tex_size;
-							charInfo.rc.top() = static_cast<float>(char_pos.y()) / tex_size;
+		void AddPage()
+		{
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 
-							++ char_free_list_.front().first;
-							if (char_free_list_.front().first == char_free_list_.front().second)
-							{
-								char_free_list_.pop_front();
-							}
-						}
-						else
-						{
-							// ҵʹʱûʹõ
+			uint32_t const page = static_cast<uint32_t>(dist_textures_.size());
+			dist_textures_.push_back(rf.MakeTexture2D(tex_size_, tex_size_, 1, 1, EF_R8, 1, 0, EAH_GPU_Read));
+			page_vertices_.resize(dist_textures_.size());
 
-							uint64_t min_tick = cim.begin()->second.tick;
-							auto min_chiter = cim.begin();
-							for (auto chiter = cim.begin(); chiter != cim.end(); ++ chiter)
-							{
-								if (chiter->second.tick < min_tick)
-								{
-									min_tick = chiter->second.tick;
-									min_chiter = chiter;
-								}
-							}
+			slots_.resize(slots_.size() + slots_per_page_);
+			free_slots_.reserve(free_slots_.size() + slots_per_page_);
+			for (uint32_t i = slots_per_page_; i > 0; -- i)
+			{
+				free_slots_.push_back(page * slots_per_page_ + i - 1);
+			}
+		}
 
-							char_pos.x() = static_cast<int32_t>(min_chiter->second.rc.left() * tex_size);
-							char_pos.y() = static_cast<int32_t>(min_chiter->second.rc.top() * tex_size);
-							charInfo.rc.left() = min_chiter->second.rc.left();
-							charInfo.rc.top() = min_chiter->second.rc.top();
+		void UnlinkSlot(uint32_t slot)
+		{
+			GlyphSlot& gs = slots_[slot];
+			if (gs.prev != INVALID_SLOT)
+			{
+				slots_[gs.prev].next = gs.next;
+			}
+			else
+			{
+				lru_head_ = gs.next;
+			}
+			if (gs.next != INVALID_SLOT)
+			{
+				slots_[gs.next].prev = gs.prev;
+			}
+			else
+			{
+				lru_tail_ = gs.prev;
+			}
+			gs.prev = INVALID_SLOT;
+			gs.next = INVALID_SLOT;
+		}
 
-							for (auto chiter = cim.begin(); chiter != cim.end(); ++ chiter)
-							{
-								if (chiter->second.tick == min_tick)
-								{
-									uint32_t const x = static_cast<int32_t>(chiter->second.rc.left() * tex_size);
-									uint32_t const y = static_cast<int32_t>(chiter->second.rc.top() * tex_size);
-									uint32_t const id = y * num_chars_a_row + x;
-									auto freeiter = char_free_list_.begin();
-									while ((freeiter != char_free_list_.end()) && (freeiter->second <= id))
-									{
-										++ freeiter;
-									}
-									char_free_list_.emplace(freeiter, id, id + 1);
-
-									cim.erase(chiter);
-									break;
-								}
-							}
-							for (auto freeiter = char_free_list_.begin(); freeiter != char_free_list_.end();)
-							{
-								auto nextiter = freeiter;
-								++ nextiter;
-
-								if (nextiter != char_free_list_.end())
-								{
-									if (freeiter->second == nextiter->first)
-									{
-										freeiter->second = nextiter->second;
-										char_free_list_.erase(nextiter);
-									}
-									else
-									{
-										++ freeiter;
-									}
-								}
-								else
-								{
-									break;
-								}
-							}
-						}
+		void LinkSlotAtTail(uint32_t slot)
+		{
+			GlyphSlot& gs = slots_[slot];
+			gs.prev = lru_tail_;
+			gs.next = INVALID_SLOT;
+			if (lru_tail_ != INVALID_SLOT)
+			{
+				slots_[lru_tail_].next = slot;
+			}
+			else
+			{
+				lru_head_ = slot;
+			}
+			lru_tail_ = slot;
+		}
 
-						charInfo.rc.right()		= charInfo.rc.left() + static_cast<float>(width) / tex_size;
-						charInfo.rc.bottom()	= charInfo.rc.top() + static_cast<float>(height) / tex_size;
-						charInfo.tick			= tick_;
+		void TouchSlot(uint32_t slot, uint32_t frame)
+		{
+			slots_[slot].last_frame = frame;
+			if (slot != lru_tail_)
+			{
+				this->UnlinkSlot(slot);
+				this->LinkSlotAtTail(slot);
+			}
+		}
 
-						kl.GetDistanceData(&a_char_data_[0], kfont_char_size, offset);
-						dist_texture_->UpdateSubresource2D(0, 0, char_pos.x(), char_pos.y(), kfont_char_size, kfont_char_size,
-							&a_char_data_[0], kfont_char_size);
+		// Takes a free slot, or evicts the least recently used glyph. Glyphs used in the current frame could
+		// already be in the vertex buffers, so a new page is added instead of evicting them, up to MAX_PAGES.
+		uint32_t AllocSlot(uint32_t frame)
+		{
+			if (free_slots_.empty() && (slots_[lru_head_].last_frame == frame) && (dist_textures_.size() < MAX_PAGES))
+			{
+				this->AddPage();
+			}
 
-						cim.emplace(ch, charInfo);
-					}
-				}
+			uint32_t slot;
+			if (!free_slots_.empty())
+			{
+				slot = free_slots_.back();
+				free_slots_.pop_back();
+			}
+			else
+			{
+				slot = lru_head_;
+				this->UnlinkSlot(slot);
+				char_info_map_.erase(slots_[slot].ch);
 			}
+
+			slots_[slot].last_frame = frame;
+			this->LinkSlotAtTail(slot);
+			return slot;
 		}
 
 	private:
+		static uint32_t const INVALID_SLOT = 0xFFFFFFFF;
+		static uint32_t const MAX_PAGES = 4;
+		static uint32_t const MIN_GLYPHS_PER_TASK = 8;
+
 		struct CharInfo
 		{
 			Rect rc;
-			uint64_t tick;
+			uint32_t page;
+			uint32_t slot;
+		};
+
+		// An atlas cell. The used ones form an intrusive doubly linked list from least to most recently used.
+		struct GlyphSlot
+		{
+			wchar_t ch = 0;
+			uint32_t last_frame = 0;
+			uint32_t prev = INVALID_SLOT;
+			uint32_t next = INVALID_SLOT;
 		};
 
 #ifdef KLAYGE_HAS_STRUCT_PACK
@@ -684,7 +749,14 @@ namespace KlayGE
 		bool restart_;
 
 		std::unordered_map<wchar_t, CharInfo> char_info_map_;
-		std::list<std::pair<uint32_t, uint32_t>> char_free_list_;
+		std::vector<GlyphSlot> slots_;
+		std::vector<uint32_t> free_slots_;
+		uint32_t lru_head_ = INVALID_SLOT;
+		uint32_t lru_tail_ = INVALID_SLOT;
+
+		std::vector<std::pair<wchar_t, int32_t>> missing_glyphs_;
+		std::vector<uint8_t> lzma_data_;
+		std::vector<uint8_t> decoded_data_;
 
 		bool three_dim_;
 
@@ -692,17 +764,22 @@ namespace KlayGE
 		std::unique_ptr<TransientBuffer> tb_ib_;
 		std::vector<SubAlloc> tb_vb_sub_allocs_;
 		std::vector<SubAlloc> tb_ib_sub_allocs_;
+		std::vector<uint32_t> sub_alloc_pages_;
+		std::vector<std::vector<FontVert>> page_vertices_;
+		std::vector<uint16_t> indices_;
+
+		uint32_t tex_size_;
+		uint32_t num_chars_a_row_;
+		uint32_t slots_per_page_;
+		std::vector<TexturePtr> dist_textures_;
 
-		TexturePtr		dist_texture_;
-		std::vector<uint8_t> a_char_data_;
+		RenderEffectParameter* distance_tex_ep_;
 
 		RenderEffectParameter* half_width_height_ep_;
 		RenderEffectParameter* dpi_scale_ep_;
 		RenderEffectParameter* mvp_ep_;
 
 		std::shared_ptr<KFont> kfont_loader_;
-
-		uint64_t tick_;
 	};
 }
 
@@ -751,8 +828,13 @@ namespace
 				return;
 			}
 
-			ResIdentifierPtr kfont_input = ResLoader::Instance().Open(font_desc_.res_name);
-			font_desc_.kfont_loader->Load(kfont_input);
+			// Map the font file in place if it's on disk. Fonts in packages are streamed.
+			std::string const font_path = ResLoader::Instance().Locate(font_desc_.res_name);
+			if (font_path.empty() || !font_desc_.kfont_loader->Load(font_path))
+			{
+				ResIdentifierPtr kfont_input = ResLoader::Instance().Open(font_desc_.res_name);
+				font_desc_.kfont_loader->Load(kfont_input);
+			}
 
 			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 			RenderDeviceCaps const & caps = rf.RenderEngineInstance().DeviceCaps();
@@ -855,6 +937,14 @@ namespace KlayGE
 		}
 	}
 
+	void Font::PrepareGlyphs(std::wstring_view text)
+	{
+		if (!text.empty())
+		{
+			font_renderable_->PrepareGlyphs(text);
+		}
+	}
+
 	// ָλû
 	/////////////////////////////////////////////////////////////////////////////////
 	void Font::RenderText(float sx, float sy, Color const & clr,
@@ -85,7 +85,7 @@ namespace KlayGE
 				return;
 			}
 
-			ResIdentifierPtr impml_input = ResLoader::Instance().Open(imposter_desc_.res_name);
+			ResIdentifierPtr impml_input = ResLoader::Instance().OpenXML(imposter_desc_.res_name);
 
 			KlayGE::XMLDocument doc;
 			XMLNodePtr root = doc.Parse(impml_input);
@@ -12,6 +12,9 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
 #include <KlayGE/ResLoader.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEngine.hpp>
@@ -29,7 +32,7 @@ namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const JUDA_TEX_VERSION = 2;
+	uint32_t const JUDA_TEX_VERSION = 3;
 
 	void u8_copy_1(uint8_t* output, uint8_t const * rhs)
 	{
@@ -115,10 +118,9 @@ namespace KlayGE
 	int const THRESHOLD_BIAS = 10;
 
 	JudaTexture::JudaTexture(uint32_t num_tiles, uint32_t tile_size, ElementFormat format)
-		: root_(MakeSharedPtr<quadtree_node>()),
-			num_tiles_(num_tiles), tile_size_(tile_size), format_(format),
+		: num_tiles_(num_tiles), tile_size_(tile_size), format_(format),
 			texel_size_(NumFormatBytes(format)),
-			decode_tick_(0), tile_tick_(0)
+			decoded_tile_queue_(64), tile_tick_(0)
 	{
 		BOOST_ASSERT(num_tiles_ <= MAX_NUM_TILES);
 		BOOST_ASSERT(tile_size_ <= MAX_TILE_SIZE);
@@ -177,6 +179,22 @@ namespace KlayGE
 		{
 			++ lower_levels_;
 		}
+
+		this->AddNode(0);
+	}
+
+	JudaTexture::~JudaTexture()
+	{
+		for (auto& batch : decode_batches_)
+		{
+			batch->decode_joiner();
+		}
+
+		DecodedTile* decoded;
+		while (decoded_tile_queue_.pop(decoded))
+		{
+			delete decoded;
+		}
 	}
 
 	uint32_t JudaTexture::EncodeTileID(uint32_t level, uint32_t tile_x, uint32_t tile_y) const
@@ -197,7 +215,35 @@ namespace KlayGE
 
 	uint32_t JudaTexture::NumNonEmptyNodes() const
 	{
-		return this->NumNonEmptySubNodes(root_);
+		uint32_t n = 0;
+		for (auto const & node : nodes_)
+		{
+			if (node.data_index != EMPTY_DATA_INDEX)
+			{
+				++ n;
+			}
+		}
+		return n;
+	}
+
+	uint32_t JudaTexture::NumNodes() const
+	{
+		return static_cast<uint32_t>(nodes_.size());
+	}
+
+	size_t JudaTexture::TreeMemorySize() const
+	{
+		// Node array, plus buckets and entries of the index
+		return nodes_.capacity() * sizeof(nodes_[0])
+			+ node_indices_.bucket_count() * sizeof(void*)
+			+ node_indices_.size() * (sizeof(std::pair<uint32_t const, uint32_t>) + sizeof(void*));
+	}
+
+	uint32_t JudaTexture::TileAttr(uint32_t tile_id) const
+	{
+		uint32_t level, tile_x, tile_y;
+		this->DecodeTileID(level, tile_x, tile_y, tile_id);
+		return this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
 	}
 
 	uint32_t JudaTexture::NumTiles() const
@@ -227,20 +273,18 @@ namespace KlayGE
 			return;
 		}
 
-		quadtree_node_ptr const & node = this->GetNode(shuff);
-		for (int i = 0; i < 4; ++ i)
+		uint32_t const key = this->NodeKey(shuff, this->ShuffLevel(shuff));
+		for (uint32_t i = 0; i < 4; ++ i)
 		{
-			if (node->children[i])
+			uint32_t const child_key = this->GetChildShuff(key, i);
+			if (this->FindNode(child_key) != nullptr)
 			{
-				this->CompactNode(this->GetChildShuff(shuff, i));
+				this->CompactNode(child_key);
 
-				if ((EMPTY_DATA_INDEX == node->children[i]->data_index)
-					&& !node->children[i]->children[0]
-					&& !node->children[i]->children[1]
-					&& !node->children[i]->children[2]
-					&& !node->children[i]->children[3])
+				// Removing nodes moves others around in nodes_, so look the child up again
+				if ((EMPTY_DATA_INDEX == this->FindNode(child_key)->data_index) && !this->HasChildren(child_key))
 				{
-					node->children[i].reset();
+					this->RemoveNode(child_key);
 				}
 			}
 		}
@@ -263,11 +307,12 @@ namespace KlayGE
 	{
 		uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
 
-		if (EMPTY_DATA_INDEX == root_->data_index)
+		tree_node* root = this->FindNode(0);
+		if (EMPTY_DATA_INDEX == root->data_index)
 		{
-			root_->data_index = this->AllocateDataBlock();
-			root_->attr = 0xFFFFFFFF;
-			data_blocks_[root_->data_index].resize(full_tile_bytes, 0);
+			root->data_index = this->AllocateDataBlock();
+			root->attr = 0xFFFFFFFF;
+			data_blocks_[root->data_index].resize(full_tile_bytes, 0);
 		}
 
 		std::vector<uint32_t> shuffs(tile_ids.size());
@@ -277,13 +322,13 @@ namespace KlayGE
 			this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
 			shuffs[i] = this->Pos2Shuff(level, tile_x, tile_y);
 
-			quadtree_node_ptr node = this->AddNode(shuffs[i]);
-			if (EMPTY_DATA_INDEX == node->data_index)
+			tree_node& node = this->AddNode(shuffs[i]);
+			if (EMPTY_DATA_INDEX == node.data_index)
 			{
-				node->data_index = this->AllocateDataBlock();
+				node.data_index = this->AllocateDataBlock();
 			}
-			node->attr = tile_attrs[i];
-			data_blocks_[node->data_index] = data[i];
+			node.attr = tile_attrs[i];
+			data_blocks_[node.data_index] = data[i];
 		}
 		
 		for (uint32_t ll = 0; ll < tree_levels_ - 1; ll += lower_levels_)
@@ -304,7 +349,7 @@ namespace KlayGE
 			for (size_t i = 0; i < upper_shuffs.size(); ++ i)
 			{
 				uint32_t shuff = upper_shuffs[i];
-				quadtree_node_ptr node = this->GetNode(shuff);
+				tree_node* node = this->GetNode(shuff);
 				if (EMPTY_DATA_INDEX == node->data_index)
 				{
 					node->data_index = this->AllocateDataBlock();
@@ -317,7 +362,7 @@ namespace KlayGE
 			for (size_t i = 0; i < shuffs.size(); ++ i)
 			{
 				uint32_t shuff = shuffs[i];
-				quadtree_node_ptr node = this->GetNode(shuff);
+				tree_node* node = this->GetNode(shuff);
 
 				int offset_x = 0;
 				int offset_y = 0;
@@ -448,15 +493,14 @@ namespace KlayGE
 
 	void JudaTexture::DecodeATile(std::vector<uint8_t>* data, uint32_t shuff, uint32_t mipmaps)
 	{
-		++ decode_tick_;
-
 		uint32_t const full_tile_bytes = cache_tile_size_ * cache_tile_size_ * texel_size_;
 		uint32_t target_level = this->ShuffLevel(shuff);
 
-		quadtree_node_ptr node = root_;
+		uint32_t const root_data_index = this->FindNode(0)->data_index;
+		bool on_tree = true;
 		if (0 == target_level)
 		{
-			std::memcpy(&data[0][0], this->RetriveATile(root_->data_index), full_tile_bytes);
+			std::memcpy(&data[0][0], this->RetriveATile(root_data_index).get(), full_tile_bytes);
 		}
 		else
 		{
@@ -506,10 +550,12 @@ namespace KlayGE
 					{
 						uint32_t start_x = (start_sub_tile_x >> shift) * used_w;
 						uint32_t start_y = (start_sub_tile_y >> shift) * used_h;
+						std::shared_ptr<uint8_t const> root_data;
 						uint8_t const * src;
 						if (1 == ll_b)
 						{
-							src = this->RetriveATile(root_->data_index);
+							root_data = this->RetriveATile(root_data_index);
+							src = root_data.get();
 						}
 						else
 						{
@@ -525,15 +571,17 @@ namespace KlayGE
 					start_sub_tile_x &= ~(1UL << (tree_levels_ - 1 - i));
 					start_sub_tile_y &= ~(1UL << (tree_levels_ - 1 - i));
 
-					if (node)
+					if (on_tree)
 					{
-						node = node->children[branches[i]];
-				
-						if (node && (node->data_index != EMPTY_DATA_INDEX))
+						tree_node const * node = this->FindNode(this->NodeKey(shuff, i));
+						on_tree = (node != nullptr);
+
+						if (on_tree && (node->data_index != EMPTY_DATA_INDEX))
 						{
 							uint32_t start_x = (start_sub_tile_x >> shift) * used_w * 2;
 							uint32_t start_y = (start_sub_tile_y >> shift) * used_h * 2;
-							uint8_t const * start_src = this->RetriveATile(node->data_index) + (start_y * tile_size_ + start_x) * texel_size_;
+							auto const block_data = this->RetriveATile(node->data_index);
+							uint8_t const * start_src = block_data.get() + (start_y * tile_size_ + start_x) * texel_size_;
 							uint8_t* dst = &temp[0];
 							for (size_t y = 0; y < used_h * 2; ++ y)
 							{
@@ -559,178 +607,184 @@ namespace KlayGE
 		}
 	}
 
-	uint32_t JudaTexture::DecodeAAttr(uint32_t shuff)
+	uint32_t JudaTexture::DecodeAAttr(uint32_t shuff) const
 	{
-		uint32_t target_level = this->ShuffLevel(shuff);
-
-		uint32_t ret_attr = 0xFFFFFFFF;
-		quadtree_node_ptr node = root_;
+		uint32_t const target_level = this->ShuffLevel(shuff);
 		if (0 == target_level)
 		{
-			ret_attr = root_->attr;
+			return this->FindNode(0)->attr;
 		}
-		else
+
+		// The attribute of the deepest node on the path. A node only exists if all its ancestors do.
+		for (uint32_t level = target_level; level > 0; -- level)
 		{
-			int step = (tree_levels_ - 1) % lower_levels_;
-			if (0 == step)
+			tree_node const * node = this->FindNode(this->NodeKey(shuff, level));
+			if (node != nullptr)
 			{
-				step = lower_levels_;
+				return node->attr;
 			}
+		}
 
-			std::vector<uint32_t> branches(tree_levels_);
-			for (uint32_t i = 0; i <= tree_levels_ - 1; ++ i)
-			{
-				branches[i] = this->GetLevelBranch(shuff, i);
-			}
+		return 0xFFFFFFFF;
+	}
 
-			for (uint32_t ll = 1; ll <= target_level; ll += step)
+	std::shared_ptr<uint8_t const> JudaTexture::RetriveATile(uint32_t data_index)
+	{
+		if (data_blocks_.empty())
+		{
 			{
-				uint32_t const ll_b = ll;
-				if (ll > 1)
-				{
-					step = lower_levels_;
-				}
-				uint32_t const ll_e = ll + step;
+				std::lock_guard<std::mutex> lock(decoded_block_mutex_);
 
-				for (uint32_t i = ll_b, i_end = std::min(target_level + 1, ll_e); i < i_end; ++ i)
+				auto iter = decoded_block_cache_.find(data_index);
+				if (iter != decoded_block_cache_.end())
 				{
-					if (node)
-					{
-						node = node->children[branches[i]];
-				
-						if (node)
-						{
-							ret_attr = node->attr;
-						}
-					}
+					decoded_block_lru_.splice(decoded_block_lru_.begin(), decoded_block_lru_, iter->second);
+					auto const & block = iter->second->second;
+					return std::shared_ptr<uint8_t const>(block, block->data());
 				}
 			}
-		}
 
-		return ret_attr;
-	}
+			uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
+			auto data = MakeSharedPtr<std::vector<uint8_t>>(full_tile_bytes, static_cast<uint8_t>(0));
+			if (data_index != EMPTY_DATA_INDEX)
+			{
+				uint64_t offsets[2];
+				this->ReadInputFile(data_blocks_offset_ + data_index * sizeof(uint64_t), offsets, sizeof(offsets));
+				uint32_t const comed_len = static_cast<uint32_t>(offsets[1] - offsets[0]);
+				auto comed_data = MakeUniquePtr<uint8_t[]>(comed_len);
+				this->ReadInputFile(offsets[0], comed_data.get(), comed_len);
+
+				LZMACodec lzma_dec;
+				lzma_dec.Decode(data->data(), MakeArrayRef(comed_data.get(), comed_len), full_tile_bytes);
+			}
+
+			std::lock_guard<std::mutex> lock(decoded_block_mutex_);
 
-	uint8_t* JudaTexture::RetriveATile(uint32_t data_index)
-	{
-		if (data_blocks_.empty())
-		{
 			auto iter = decoded_block_cache_.find(data_index);
 			if (iter != decoded_block_cache_.end())
 			{
-				iter->second.tick = decode_tick_;
+				// Another thread decoded the same block in the meantime
+				decoded_block_lru_.splice(decoded_block_lru_.begin(), decoded_block_lru_, iter->second);
+				data = iter->second->second;
 			}
 			else
 			{
-				if (decoded_block_cache_.size() >= 64)
-				{
-					auto min_iter = decoded_block_cache_.begin();
-					uint64_t min_tick = min_iter->second.tick;
-					for (auto dbiter = decoded_block_cache_.begin();
-						dbiter != decoded_block_cache_.end(); ++ dbiter)
-					{
-						if (dbiter->second.tick < min_tick)
-						{
-							min_tick = dbiter->second.tick;
-							min_iter = dbiter;
-						}
-					}
-
-					for (auto dbiter = decoded_block_cache_.begin();
-						dbiter != decoded_block_cache_.end();)
-					{
-						if (dbiter->second.tick == min_tick)
-						{
-							dbiter = decoded_block_cache_.erase(dbiter);
-						}
-						else
-						{
-							++ dbiter;
-						}
-					}
-				}
-
-				uint32_t const full_tile_bytes = tile_size_ * tile_size_ * texel_size_;
-				auto data = MakeUniquePtr<uint8_t[]>(full_tile_bytes);
-				if (data_index != EMPTY_DATA_INDEX)
-				{
-					uint64_t offsets[2];
-					input_file_->seekg(data_blocks_offset_ + data_index * sizeof(uint64_t), std::ios_base::beg);
-					input_file_->read(offsets, sizeof(offsets));
-					uint32_t const comed_len = static_cast<uint32_t>(offsets[1] - offsets[0]);
-					auto comed_data = MakeUniquePtr<uint8_t[]>(comed_len);
-					input_file_->seekg(offsets[0], std::ios_base::beg);
-					input_file_->read(comed_data.get(), comed_len);
-					lzma_dec_.Decode(data.get(), MakeArrayRef(comed_data.get(), comed_len), full_tile_bytes);
-				}
-				else
+				decoded_block_lru_.emplace_front(data_index, data);
+				decoded_block_cache_.emplace(data_index, decoded_block_lru_.begin());
+				while (decoded_block_lru_.size() > decoded_block_cache_size_)
 				{
-					memset(data.get(), 0, full_tile_bytes);
+					decoded_block_cache_.erase(decoded_block_lru_.back().first);
+					decoded_block_lru_.pop_back();
 				}
-
-				iter = decoded_block_cache_.emplace(data_index, DecodedBlockInfo(std::move(data), decode_tick_)).first;
 			}
 
-			return iter->second.data.get();
+			return std::shared_ptr<uint8_t const>(data, data->data());
 		}
 		else
 		{
-			return &data_blocks_[data_index][0];
+			return std::shared_ptr<uint8_t const>(std::shared_ptr<uint8_t const>(), &data_blocks_[data_index][0]);
 		}
 	}
 
-	uint32_t JudaTexture::NumNonEmptySubNodes(quadtree_node_ptr const & node) const
+	void JudaTexture::ReadInputFile(uint64_t offset, void* data, uint32_t size)
 	{
-		uint32_t n = 0;
-		if (node->data_index != EMPTY_DATA_INDEX)
-		{
-			++ n;
-		}
-		for (size_t i = 0; i < 4; ++ i)
+		// Every reader owns a stream while reading, so the seek and the read can't be interleaved with another thread
+		ResIdentifierPtr file;
 		{
-			if (node->children[i])
+			std::lock_guard<std::mutex> lock(input_file_mutex_);
+			if (!input_files_.empty())
 			{
-				n += this->NumNonEmptySubNodes(node->children[i]);
+				file = std::move(input_files_.back());
+				input_files_.pop_back();
 			}
 		}
-		return n;
+		if (!file)
+		{
+			file = ResLoader::Instance().Open(input_file_name_);
+		}
+
+		file->seekg(static_cast<int64_t>(offset), std::ios_base::beg);
+		file->read(data, size);
+
+		std::lock_guard<std::mutex> lock(input_file_mutex_);
+		input_files_.push_back(std::move(file));
 	}
 
-	JudaTexture::quadtree_node_ptr const & JudaTexture::GetNode(uint32_t shuff)
+	uint32_t JudaTexture::NodeKey(uint32_t shuff, uint32_t level) const
 	{
-		uint32_t target_level = this->ShuffLevel(shuff);
-		quadtree_node_ptr* node = &root_;
-		for (uint32_t level = 1; level <= target_level; ++ level)
+		uint32_t const branch_mask = (1UL << (2 * MAX_TREE_LEVEL)) - (1UL << (2 * (MAX_TREE_LEVEL - level)));
+		return (level << LEVEL_SHIFT) | (shuff & branch_mask);
+	}
+
+	JudaTexture::tree_node* JudaTexture::FindNode(uint32_t key)
+	{
+		auto iter = node_indices_.find(key);
+		return (iter != node_indices_.end()) ? &nodes_[iter->second] : nullptr;
+	}
+
+	JudaTexture::tree_node const * JudaTexture::FindNode(uint32_t key) const
+	{
+		auto iter = node_indices_.find(key);
+		return (iter != node_indices_.end()) ? &nodes_[iter->second] : nullptr;
+	}
+
+	bool JudaTexture::HasChildren(uint32_t key) const
+	{
+		for (uint32_t i = 0; i < 4; ++ i)
 		{
-			uint32_t branch = this->GetLevelBranch(shuff, level);
-			if (*node)
-			{
-				node = &((*node)->children[branch]);
-			}
-			else
+			if (this->FindNode(this->GetChildShuff(key, i)) != nullptr)
 			{
-				break;
+				return true;
 			}
 		}
+		return false;
+	}
 
-		return *node;
+	JudaTexture::tree_node* JudaTexture::GetNode(uint32_t shuff)
+	{
+		uint32_t const target_level = this->ShuffLevel(shuff);
+		return this->FindNode(this->NodeKey(shuff, target_level));
 	}
 
-	JudaTexture::quadtree_node_ptr const & JudaTexture::AddNode(uint32_t shuff)
+	JudaTexture::tree_node& JudaTexture::AddNode(uint32_t shuff)
 	{
-		uint32_t target_level = this->ShuffLevel(shuff);
-		quadtree_node_ptr* node = &root_;
-		for (uint32_t level = 1; level <= target_level; ++ level)
+		uint32_t const target_level = this->ShuffLevel(shuff);
+		for (uint32_t level = 0; level <= target_level; ++ level)
 		{
-			uint32_t branch = this->GetLevelBranch(shuff, level);
-			if (!(*node)->children[branch])
+			uint32_t const key = this->NodeKey(shuff, level);
+			if (node_indices_.find(key) == node_indices_.end())
 			{
-				(*node)->children[branch] = MakeSharedPtr<quadtree_node>();
+				node_indices_.emplace(key, static_cast<uint32_t>(nodes_.size()));
+				nodes_.push_back({ key, EMPTY_DATA_INDEX, 0xFFFFFFFF });
 			}
-			
-			node = &((*node)->children[branch]);
 		}
 
-		return *node;
+		return *this->GetNode(shuff);
+	}
+
+	void JudaTexture::RemoveNode(uint32_t key)
+	{
+		auto iter = node_indices_.find(key);
+		BOOST_ASSERT(iter != node_indices_.end());
+
+		uint32_t const index = iter->second;
+		node_indices_.erase(iter);
+		if (index != nodes_.size() - 1)
+		{
+			nodes_[index] = nodes_.back();
+			node_indices_[nodes_[index].key] = index;
+		}
+		nodes_.pop_back();
+	}
+
+	void JudaTexture::BuildNodeIndices()
+	{
+		node_indices_.clear();
+		node_indices_.reserve(nodes_.size());
+		for (uint32_t i = 0; i < nodes_.size(); ++ i)
+		{
+			node_indices_.emplace(nodes_[i].key, i);
+		}
 	}
 
 	uint32_t JudaTexture::ShuffLevel(uint32_t shuff) const
@@ -888,7 +942,7 @@ namespace KlayGE
 
 		uint32_t version;
 		file->read(&version, sizeof(version));
-		Verify(JUDA_TEX_VERSION == version);
+		Verify((2 == version) || (JUDA_TEX_VERSION == version));
 
 		file->read(&num_tiles, sizeof(num_tiles));
 		file->read(&tile_size, sizeof(tile_size));
@@ -922,78 +976,75 @@ namespace KlayGE
 
 		JudaTexturePtr ret = MakeSharedPtr<JudaTexture>(num_tiles, tile_size, format);
 
-		uint32_t tree_levels = ret->TreeLevels();
-
-		uint32_t data_index = 0;
-
-		std::vector<JudaTexture::quadtree_node_ptr> last_level;
-		std::vector<uint32_t> last_start_index_levels;
-		for (size_t i = 0; i < tree_levels; ++ i)
+		ret->nodes_.clear();
+		if (version >= 3)
+		{
+			// The nodes are stored as the same level ordered array that is used in memory
+			uint32_t num_nodes;
+			file->read(&num_nodes, sizeof(num_nodes));
+			ret->nodes_.resize(num_nodes);
+			file->read(ret->nodes_.data(), num_nodes * sizeof(ret->nodes_[0]));
+		}
+		else
 		{
-			uint32_t size;
-			file->read(&size, sizeof(size));
+			uint32_t tree_levels = ret->TreeLevels();
 
-			std::vector<JudaTexture::quadtree_node_ptr> this_level(size);
-			std::vector<uint32_t> this_start_index_levels(size);
-			file->read(&this_start_index_levels[0], size * sizeof(this_start_index_levels[0]));
-			for (size_t j = 0; j < size; ++ j)
-			{
-				this_level[j] = MakeSharedPtr<JudaTexture::quadtree_node>();
+			uint32_t data_index = 0;
 
-				if (!(this_start_index_levels[j] >> 31))
-				{
-					this_level[j]->data_index = data_index;
-					++ data_index;
-				}
-			}
-			if (i == tree_levels - 1)
+			std::vector<uint32_t> this_level_keys(1, 0);
+			for (size_t i = 0; i < tree_levels; ++ i)
 			{
-				std::vector<uint32_t> this_attr_levels(size);
-				file->read(&this_attr_levels[0], size * sizeof(this_attr_levels[0]));
-				for (size_t j = 0; j < size; ++ j)
+				uint32_t size;
+				file->read(&size, sizeof(size));
+				BOOST_ASSERT(size == this_level_keys.size());
+
+				std::vector<uint32_t> this_start_index_levels(size);
+				file->read(&this_start_index_levels[0], size * sizeof(this_start_index_levels[0]));
+				std::vector<uint32_t> this_attr_levels(size, 0xFFFFFFFF);
+				if (i == tree_levels - 1)
 				{
-					this_level[j]->attr = this_attr_levels[j];
+					file->read(&this_attr_levels[0], size * sizeof(this_attr_levels[0]));
 				}
-			}
-			else
-			{
+
+				std::vector<uint32_t> next_level_keys;
 				for (size_t j = 0; j < size; ++ j)
 				{
-					this_level[j]->attr = 0xFFFFFFFF;
-				}
-			}
+					uint32_t node_data_index = JudaTexture::EMPTY_DATA_INDEX;
+					if (!(this_start_index_levels[j] >> 31))
+					{
+						node_data_index = data_index;
+						++ data_index;
+					}
+					ret->nodes_.push_back({ this_level_keys[j], node_data_index, this_attr_levels[j] });
 
-			if (i > 0)
-			{
-				for (size_t j = 0; j < last_start_index_levels.size(); ++ j)
-				{
-					if ((last_start_index_levels[j] & 0x7FFFFFF0) != 0x7FFFFFF0)
+					if ((this_start_index_levels[j] & 0x7FFFFFF0) != 0x7FFFFFF0)
 					{
-						uint32_t start_index = (last_start_index_levels[j] & 0x7FFFFFFF) >> 4;
-						uint32_t mask = last_start_index_levels[j] & 0xF;
+						uint32_t start_index = (this_start_index_levels[j] & 0x7FFFFFFF) >> 4;
+						uint32_t mask = this_start_index_levels[j] & 0xF;
 
 						int l = 0;
-						for (size_t k = 0; k < 4; ++ k)
+						for (uint32_t k = 0; k < 4; ++ k)
 						{
 							if (mask & (1UL << k))
 							{
-								last_level[j]->children[k] = this_level[start_index + l];
+								if (next_level_keys.size() <= start_index + l)
+								{
+									next_level_keys.resize(start_index + l + 1);
+								}
+								next_level_keys[start_index + l] = ret->GetChildShuff(this_level_keys[j], k);
 								++ l;
 							}
 						}
 					}
 				}
-			}
-			else
-			{
-				ret->root_ = this_level[0];
-			}
 
-			last_level.swap(this_level);
-			last_start_index_levels.swap(this_start_index_levels);
+				this_level_keys.swap(next_level_keys);
+			}
 		}
+		ret->BuildNodeIndices();
 
-		ret->input_file_ = file;
+		ret->input_file_name_ = file->ResName();
+		ret->input_files_.push_back(file);
 		ret->data_blocks_offset_ = data_blocks_offset - (non_empty_nodes + 1) * sizeof(uint64_t);
 		ret->image_entries_ = image_entries;
 
@@ -1004,9 +1055,6 @@ namespace KlayGE
 	{
 		LZMACodec lzma_enc;
 
-		std::vector<JudaTexture::quadtree_node_ptr> this_level;
-		std::vector<JudaTexture::quadtree_node_ptr> next_level;
-
 		std::shared_ptr<std::ostream> ofs = MakeSharedPtr<std::ofstream>(file_name.c_str(), std::ios_base::out | std::ios_base::binary);
 		
 		uint32_t fourcc = MakeFourCC<'J', 'D', 'T', ' '>::value;
@@ -1048,63 +1096,26 @@ namespace KlayGE
 		std::vector<uint32_t> non_empty_block_data_index;
 		non_empty_block_data_index.reserve(non_empty_nodes);
 
-		this_level.push_back(juda_tex->root_);
-		for (size_t i = 0; i < juda_tex->TreeLevels(); ++ i)
-		{
-			uint32_t size = static_cast<uint32_t>(this_level.size());
-			ofs->write(reinterpret_cast<char const *>(&size), sizeof(size));
-
-			uint32_t num_nodes = 0;
-			next_level.reserve(this_level.size() * 4);
-			for (size_t j = 0; j < this_level.size(); ++ j)
+		// Keys start with the level, so sorting them gives level order, and Morton order inside a level
+		std::vector<JudaTexture::tree_node> nodes = juda_tex->nodes_;
+		std::sort(nodes.begin(), nodes.end(),
+			[](JudaTexture::tree_node const & lhs, JudaTexture::tree_node const & rhs)
 			{
-				uint32_t index;
-				if (!this_level[j]->children[0]
-					&& !this_level[j]->children[1]
-					&& !this_level[j]->children[2]
-					&& !this_level[j]->children[3])
-				{
-					index = 0x7FFFFFFF;
-				}
-				else
-				{
-					BOOST_ASSERT(num_nodes <= 0x07FFFFFF);
-
-					index = num_nodes << 4;
-
-					for (size_t k = 0; k < 4; ++ k)
-					{
-						if (this_level[j]->children[k])
-						{
-							next_level.push_back(this_level[j]->children[k]);
-							index |= (1UL << k);
-							++ num_nodes;
-						}
-					}
-				}
-				if (JudaTexture::EMPTY_DATA_INDEX == this_level[j]->data_index)
-				{
-					index |= 1UL << 31;
-				}
-				else
-				{
-					non_empty_block_data_index.push_back(this_level[j]->data_index);
-				}
-				ofs->write(reinterpret_cast<char const *>(&index), sizeof(index));
-			}
-
-			if (i == juda_tex->TreeLevels() - 1)
+				return lhs.key < rhs.key;
+			});
+		for (auto& node : nodes)
+		{
+			if (node.data_index != JudaTexture::EMPTY_DATA_INDEX)
 			{
-				for (size_t j = 0; j < this_level.size(); ++ j)
-				{
-					ofs->write(reinterpret_cast<char const *>(&this_level[j]->attr), sizeof(this_level[j]->attr));
-				}
+				non_empty_block_data_index.push_back(node.data_index);
+				node.data_index = static_cast<uint32_t>(non_empty_block_data_index.size() - 1);
 			}
-
-			this_level.clear();
-			this_level.swap(next_level);
 		}
 
+		uint32_t const num_nodes = static_cast<uint32_t>(nodes.size());
+		ofs->write(reinterpret_cast<char const *>(&num_nodes), sizeof(num_nodes));
+		ofs->write(reinterpret_cast<char const *>(nodes.data()), nodes.size() * sizeof(nodes[0]));
+
 		uint32_t block_start_offset_pos = static_cast<uint32_t>(ofs->tellp());
 		data_blocks_offset = block_start_offset_pos + (non_empty_nodes + 1) * sizeof(uint64_t);
 
@@ -1208,6 +1219,44 @@ namespace KlayGE
 		}
 	}
 
+	void JudaTexture::DecodeCacheSize(uint32_t num_blocks)
+	{
+		BOOST_ASSERT(num_blocks > 0);
+
+		std::lock_guard<std::mutex> lock(decoded_block_mutex_);
+		decoded_block_cache_size_ = num_blocks;
+		while (decoded_block_lru_.size() > decoded_block_cache_size_)
+		{
+			decoded_block_cache_.erase(decoded_block_lru_.back().first);
+			decoded_block_lru_.pop_back();
+		}
+	}
+
+	uint32_t JudaTexture::DecodeCacheSize() const
+	{
+		return decoded_block_cache_size_;
+	}
+
+	void JudaTexture::UploadBudget(float ms)
+	{
+		upload_budget_ms_ = ms;
+	}
+
+	float JudaTexture::UploadBudget() const
+	{
+		return upload_budget_ms_;
+	}
+
+	uint32_t JudaTexture::NumPendingTiles() const
+	{
+		return static_cast<uint32_t>(decoding_tile_ids_.size());
+	}
+
+	uint32_t JudaTexture::NumDecodeBatches() const
+	{
+		return static_cast<uint32_t>(decode_batches_.size());
+	}
+
 	TexturePtr const & JudaTexture::CacheTex() const
 	{
 		return tex_cache_;
@@ -1253,138 +1302,172 @@ namespace KlayGE
 
 		++ tile_tick_;
 
-		uint32_t const tex_width = tex_cache_ ? tex_cache_->Width(0) : tex_cache_array_[0]->Width(0);
-		uint32_t const tex_height = tex_cache_ ? tex_cache_->Height(0) : tex_cache_array_[0]->Height(0);
-		uint32_t const tex_layer = tex_cache_ ? tex_cache_->ArraySize() : static_cast<uint32_t>(tex_cache_array_.size());
-		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
+		std::vector<uint32_t> new_tile_ids;
+		for (auto const tile_id : tile_ids)
+		{
+			auto tmiter = tile_info_map_.find(tile_id);
+			if (tmiter != tile_info_map_.end())
+			{
+				// Exists in cache
 
-		uint32_t const num_cache_tiles_a_row = tex_width / tile_with_border_size;
-		uint32_t const num_cache_tiles_a_layer = num_cache_tiles_a_row * tex_height / tile_with_border_size;
-		uint32_t const num_cache_total_tiles = num_cache_tiles_a_layer * tex_layer;
+				tmiter->second.tick = tile_tick_;
+			}
+			else if (decoding_tile_ids_.insert(tile_id).second)
+			{
+				new_tile_ids.push_back(tile_id);
+			}
+		}
 
+		// Only the batches still in flight are kept, no matter whether new tiles are requested every frame
+		for (auto iter = decode_batches_.begin(); iter != decode_batches_.end();)
+		{
+			if ((*iter)->done)
+			{
+				(*iter)->decode_joiner();
+				iter = decode_batches_.erase(iter);
+			}
+			else
+			{
+				++ iter;
+			}
+		}
+
+		if (!new_tile_ids.empty())
+		{
+			// Tiles are read, decompressed and encoded in the thread pool, and come back through decoded_tile_queue_
+			auto batch = MakeUniquePtr<DecodeBatch>();
+			DecodeBatch* batch_ptr = batch.get();
+			batch->decode_joiner = Context::Instance().ThreadPool()(
+				[this, batch_ptr, new_tile_ids]
+				{
+					this->DecodeTileBatch(new_tile_ids);
+					batch_ptr->done = true;
+				});
+			decode_batches_.push_back(std::move(batch));
+		}
+
+		this->CommitDecodedTiles();
+	}
+
+	void JudaTexture::DecodeTileBatch(std::vector<uint32_t> const & tile_ids)
+	{
 		std::unordered_map<uint32_t, uint32_t> neighbor_id_map;
 		std::vector<uint32_t> all_neighbor_ids;
 		std::vector<uint32_t> neighbor_ids;
 		std::vector<uint32_t> tile_attrs;
 		std::vector<bool> in_same_image;
-		auto& tim = tile_info_map_;
 		for (size_t i = 0; i < tile_ids.size(); ++ i)
 		{
-			auto tmiter = tim.find(tile_ids[i]);
-			if (tmiter != tim.end())
-			{
-				// Exists in cache
-
-				tmiter->second.tick = tile_tick_;
-			}
-			else
-			{
-				uint32_t level, tile_x, tile_y;
-				this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
+			uint32_t level, tile_x, tile_y;
+			this->DecodeTileID(level, tile_x, tile_y, tile_ids[i]);
 
-				std::array<uint32_t, 9> new_tile_id_with_neighbors;
-				new_tile_id_with_neighbors.fill(0xFFFFFFFF);
-				new_tile_id_with_neighbors[0] = tile_ids[i];
+			std::array<uint32_t, 9> new_tile_id_with_neighbors;
+			new_tile_id_with_neighbors.fill(0xFFFFFFFF);
+			new_tile_id_with_neighbors[0] = tile_ids[i];
 
-				std::array<bool, 9> new_in_same_image;
-				new_in_same_image.fill(false);
-				new_in_same_image[0] = true;
+			std::array<bool, 9> new_in_same_image;
+			new_in_same_image.fill(false);
+			new_in_same_image[0] = true;
 
-				uint32_t attr = this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
-				tile_attrs.push_back(attr);
-				if (attr != 0xFFFFFFFF)
-				{
-					std::array<int32_t, 9> new_tile_id_x;
-					std::array<int32_t, 9> new_tile_id_y;
+			uint32_t attr = this->DecodeAAttr(this->Pos2Shuff(level, tile_x, tile_y));
+			tile_attrs.push_back(attr);
+			if (attr != 0xFFFFFFFF)
+			{
+				std::array<int32_t, 9> new_tile_id_x;
+				std::array<int32_t, 9> new_tile_id_y;
 
-					int32_t left = tile_x - 1;
-					int32_t right = tile_x + 1;
-					int32_t up = tile_y - 1;
-					int32_t down = tile_y + 1;
+				int32_t left = tile_x - 1;
+				int32_t right = tile_x + 1;
+				int32_t up = tile_y - 1;
+				int32_t down = tile_y + 1;
 
-					ImageEntry const & entry = image_entries_[attr];
-					if (TAM_Wrap == (entry.addr_u_v & 0xF))
-					{
-						left = entry.x + (left - entry.x + entry.w) % entry.w;
-						right = entry.x + (right - entry.x + entry.w) % entry.w;
-					}
-					if (TAM_Wrap == ((entry.addr_u_v >> 4) & 0xF))
-					{
-						up = entry.y + (up - entry.y + entry.h) % entry.h;
-						down = entry.y + (down - entry.y + entry.h) % entry.h;
-					}
+				ImageEntry const & entry = image_entries_[attr];
+				if (TAM_Wrap == (entry.addr_u_v & 0xF))
+				{
+					left = entry.x + (left - entry.x + entry.w) % entry.w;
+					right = entry.x + (right - entry.x + entry.w) % entry.w;
+				}
+				if (TAM_Wrap == ((entry.addr_u_v >> 4) & 0xF))
+				{
+					up = entry.y + (up - entry.y + entry.h) % entry.h;
+					down = entry.y + (down - entry.y + entry.h) % entry.h;
+				}
 
-					new_tile_id_x[1] = left;
-					new_tile_id_y[1] = up;
-					new_tile_id_x[2] = tile_x;
-					new_tile_id_y[2] = up;
-					new_tile_id_x[3] = right;
-					new_tile_id_y[3] = up;
-
-					new_tile_id_x[4] = left;
-					new_tile_id_y[4] = tile_y;
-					new_tile_id_x[5] = right;
-					new_tile_id_y[5] = tile_y;
-
-					new_tile_id_x[6] = left;
-					new_tile_id_y[6] = down;
-					new_tile_id_x[7] = tile_x;
-					new_tile_id_y[7] = down;
-					new_tile_id_x[8] = right;
-					new_tile_id_y[8] = down;
-
-					for (int j = 1; j < 9; ++ j)
+				new_tile_id_x[1] = left;
+				new_tile_id_y[1] = up;
+				new_tile_id_x[2] = tile_x;
+				new_tile_id_y[2] = up;
+				new_tile_id_x[3] = right;
+				new_tile_id_y[3] = up;
+
+				new_tile_id_x[4] = left;
+				new_tile_id_y[4] = tile_y;
+				new_tile_id_x[5] = right;
+				new_tile_id_y[5] = tile_y;
+
+				new_tile_id_x[6] = left;
+				new_tile_id_y[6] = down;
+				new_tile_id_x[7] = tile_x;
+				new_tile_id_y[7] = down;
+				new_tile_id_x[8] = right;
+				new_tile_id_y[8] = down;
+
+				for (int j = 1; j < 9; ++ j)
+				{
+					if ((new_tile_id_x[j] >= 0) && (new_tile_id_y[j] >= 0)
+						&& (new_tile_id_x[j] < static_cast<int32_t>(num_tiles_) - 1)
+						&& (new_tile_id_y[j] < static_cast<int32_t>(num_tiles_) - 1))
 					{
-						if ((new_tile_id_x[j] >= 0) && (new_tile_id_y[j] >= 0)
-							&& (new_tile_id_x[j] < static_cast<int32_t>(num_tiles_) - 1)
-							&& (new_tile_id_y[j] < static_cast<int32_t>(num_tiles_) - 1))
+						new_tile_id_with_neighbors[j] = this->EncodeTileID(level, new_tile_id_x[j], new_tile_id_y[j]);
+						if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
 						{
-							new_tile_id_with_neighbors[j] = this->EncodeTileID(level, new_tile_id_x[j], new_tile_id_y[j]);
-							if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
+							if (attr == this->DecodeAAttr(this->Pos2Shuff(level, new_tile_id_x[j], new_tile_id_y[j])))
 							{
-								if (attr == this->DecodeAAttr(this->Pos2Shuff(level, new_tile_id_x[j], new_tile_id_y[j])))
-								{
-									new_in_same_image[j] = true;
-								}
+								new_in_same_image[j] = true;
 							}
 						}
-						else
-						{
-							new_tile_id_with_neighbors[j] = 0xFFFFFFFF;
-						}
+					}
+					else
+					{
+						new_tile_id_with_neighbors[j] = 0xFFFFFFFF;
 					}
 				}
+			}
 
-				for (size_t j = 0; j < new_tile_id_with_neighbors.size(); ++ j)
+			for (size_t j = 0; j < new_tile_id_with_neighbors.size(); ++ j)
+			{
+				if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
 				{
-					if (new_tile_id_with_neighbors[j] != 0xFFFFFFFF)
+					if (neighbor_id_map.find(new_tile_id_with_neighbors[j]) == neighbor_id_map.end())
 					{
-						if (neighbor_id_map.find(new_tile_id_with_neighbors[j]) == neighbor_id_map.end())
-						{
-							neighbor_id_map.emplace(new_tile_id_with_neighbors[j], static_cast<uint32_t>(neighbor_ids.size()));
-							neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
-						}
+						neighbor_id_map.emplace(new_tile_id_with_neighbors[j], static_cast<uint32_t>(neighbor_ids.size()));
+						neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
 					}
-					all_neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
-					in_same_image.push_back(new_in_same_image[j]);
 				}
+				all_neighbor_ids.push_back(new_tile_id_with_neighbors[j]);
+				in_same_image.push_back(new_in_same_image[j]);
 			}
 		}
 
-		uint32_t mipmaps = tex_cache_->NumMipMaps();
+		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
+		uint32_t const mipmaps = tex_cache_ ? tex_cache_->NumMipMaps() : tex_cache_array_[0]->NumMipMaps();
+		ElementFormat const format = tex_cache_ ? tex_cache_->Format() : tex_cache_array_[0]->Format();
 		std::vector<std::vector<uint8_t>> neighbor_data;
 		this->DecodeTiles(neighbor_data, neighbor_ids, mipmaps);
 
-		TileInfo tile_info;
-		tile_info.tick = tile_tick_;
 		for (size_t i = 0; i < all_neighbor_ids.size(); i += 9)
 		{
-			tile_info.attr = tile_attrs[i / 9];
+			auto tile = MakeUniquePtr<DecodedTile>();
+			tile->tile_id = all_neighbor_ids[i];
+			tile->attr = tile_attrs[i / 9];
+			tile->mip_data.resize(mipmaps);
+			tile->mip_row_pitches.resize(mipmaps);
+
 			uint8_t border_clr[4];
 			TexAddressingMode addr_u, addr_v;
-			if (tile_info.attr != 0xFFFFFFFF)
+			if (tile->attr != 0xFFFFFFFF)
 			{
-				ImageEntry const & entry = image_entries_[tile_info.attr];
+				ImageEntry const & entry = image_entries_[tile->attr];
 				addr_u = static_cast<TexAddressingMode>(entry.addr_u_v & 0xF);
 				addr_v = static_cast<TexAddressingMode>((entry.addr_u_v >> 4) & 0xF);
 				texel_op_.from_float4(border_clr, &entry.border_clr.r());
@@ -1396,77 +1479,6 @@ namespace KlayGE
 				border_clr[0] = border_clr[1] = border_clr[2] = border_clr[3] = 0;
 			}
 
-			if (tile_info_map_.size() < num_cache_total_tiles)
-			{
-				// Still has space in cache
-
-				uint32_t const s = tile_free_list_.front().first;
-				tile_info.z = s / num_cache_tiles_a_layer;
-				tile_info.y = (s - tile_info.z * num_cache_tiles_a_layer) / num_cache_tiles_a_row;
-				tile_info.x = s - tile_info.z * num_cache_tiles_a_layer - tile_info.y * num_cache_tiles_a_row;
-
-				++ tile_free_list_.front().first;
-				if (tile_free_list_.front().first == tile_free_list_.front().second)
-				{
-					tile_free_list_.pop_front();
-				}
-			}
-			else
-			{
-				// Find tiles that are not used for the longest time
-
-				uint64_t min_tick = tim.begin()->second.tick;
-				auto min_tileiter = tim.begin();
-				for (auto tileiter = tim.begin(); tileiter != tim.end(); ++ tileiter)
-				{
-					if (tileiter->second.tick < min_tick)
-					{
-						min_tick = tileiter->second.tick;
-						min_tileiter = tileiter;
-					}
-				}
-
-				tile_info.x = min_tileiter->second.x;
-				tile_info.y = min_tileiter->second.y;
-				tile_info.z = min_tileiter->second.z;
-
-				for (auto tileiter = tim.begin(); tileiter != tim.end();)
-				{
-					if (tileiter->second.tick == min_tick)
-					{
-						uint32_t const id = tileiter->second.z * num_cache_tiles_a_layer + tileiter->second.y * num_cache_tiles_a_row + tileiter->second.x;
-						auto freeiter = tile_free_list_.begin();
-						while ((freeiter != tile_free_list_.end()) && (freeiter->second <= id))
-						{
-							++ freeiter;
-						}
-						tile_free_list_.emplace(freeiter, id, id + 1);
-
-						tileiter = tim.erase(tileiter);
-					}
-					else
-					{
-						 ++ tileiter;
-					}
-				}
-				for (auto freeiter = tile_free_list_.begin(); freeiter != tile_free_list_.end() - 1;)
-				{
-					auto nextiter = freeiter;
-					++ nextiter;
-
-					if (freeiter->second == nextiter->first)
-					{
-						freeiter->second = nextiter->second;
-						freeiter = tile_free_list_.erase(nextiter);
-						-- freeiter;
-					}
-					else
-					{
-						++ freeiter;
-					}
-				}
-			}
-
 			std::array<uint32_t, 9> index_with_neighbors = { { 0 } };
 			for (size_t j = 0; j < index_with_neighbors.size(); ++ j)
 			{
@@ -1527,7 +1539,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -1640,7 +1652,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_tile_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_tile_size * mip_border_size);
@@ -1750,7 +1762,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -1864,7 +1876,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_tile_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_tile_size);
@@ -1977,7 +1989,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_tile_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_tile_size);
@@ -2091,7 +2103,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -2204,7 +2216,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_tile_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_tile_size * mip_border_size);
@@ -2314,7 +2326,7 @@ namespace KlayGE
 					}
 					else
 					{
-						if (tile_info.attr != 0xFFFFFFFF)
+						if (tile->attr != 0xFFFFFFFF)
 						{
 							std::vector<int32_t> border_coords_x(mip_border_size * mip_border_size);
 							std::vector<int32_t> border_coords_y(mip_border_size * mip_border_size);
@@ -2419,29 +2431,6 @@ namespace KlayGE
 					}
 				}
 
-				ElementFormat format;
-				if (tex_cache_)
-				{
-					format = tex_cache_->Format();
-				}
-				else
-				{
-					format = tex_cache_array_[tile_info.z]->Format();
-				}
-
-				TexturePtr target_tex;
-				uint32_t target_array_index;
-				if (tex_cache_)
-				{
-					target_tex = tex_cache_;
-					target_array_index = tile_info.z;
-				}
-				else
-				{
-					target_tex = tex_cache_array_[tile_info.z];
-					target_array_index = 0;
-				}
-
 				if (IsCompressedFormat(format))
 				{
 					uint32_t const block_width = BlockWidth(format);
@@ -2528,17 +2517,13 @@ namespace KlayGE
 							&bc[0], bc_row_pitch, bc_slice_pitch, p_argb, row_pitch, slice_pitch, TCM_Quality);
 					}
 
-					target_tex->UpdateSubresource2D(target_array_index, l,
-						tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size,
-						mip_tile_with_border_size, mip_tile_with_border_size,
-						&bc[0], bc_row_pitch);
+					tile->mip_data[l] = std::move(bc);
+					tile->mip_row_pitches[l] = bc_row_pitch;
 				}
 				else
 				{
-					target_tex->UpdateSubresource2D(target_array_index, l,
-						tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size,
-						mip_tile_with_border_size, mip_tile_with_border_size,
-						&tex_a_tile_data[0], mip_tile_with_border_size * texel_size_);
+					tile->mip_data[l] = std::move(tex_a_tile_data);
+					tile->mip_row_pitches[l] = mip_tile_with_border_size * texel_size_;
 				}
 
 				mip_tile_size /= 2;
@@ -2546,18 +2531,189 @@ namespace KlayGE
 				mip_border_size /= 2;
 			}
 
-			uint8_t const a_tile_indirect[] =
+			decoded_tile_queue_.push(tile.release());
+		}
+	}
+
+	void JudaTexture::CommitDecodedTiles()
+	{
+		DecodedTile* decoded;
+		while (decoded_tile_queue_.pop(decoded))
+		{
+			decoded_tiles_.emplace_back(decoded);
+		}
+		if (decoded_tiles_.empty())
+		{
+			return;
+		}
+
+		uint32_t const tex_width = tex_cache_ ? tex_cache_->Width(0) : tex_cache_array_[0]->Width(0);
+		uint32_t const tex_height = tex_cache_ ? tex_cache_->Height(0) : tex_cache_array_[0]->Height(0);
+		uint32_t const tex_layer = tex_cache_ ? tex_cache_->ArraySize() : static_cast<uint32_t>(tex_cache_array_.size());
+		uint32_t const tile_with_border_size = cache_tile_size_ + cache_tile_border_size_ * 2;
+
+		uint32_t const num_cache_tiles_a_row = tex_width / tile_with_border_size;
+		uint32_t const num_cache_tiles_a_layer = num_cache_tiles_a_row * tex_height / tile_with_border_size;
+		uint32_t const num_cache_total_tiles = num_cache_tiles_a_layer * tex_layer;
+
+		// Uploads are spread over several frames if they don't fit in the budget
+		auto& tim = tile_info_map_;
+		std::vector<std::pair<uint32_t, uint32_t>> indirect_updates;
+		Timer timer;
+		while (!decoded_tiles_.empty())
+		{
+			DecodedTile const & decoded_tile = *decoded_tiles_.front();
+
+			TileInfo tile_info;
+			tile_info.tick = tile_tick_;
+			tile_info.attr = decoded_tile.attr;
+
+			if (tile_info_map_.size() < num_cache_total_tiles)
+			{
+				// Still has space in cache
+
+				uint32_t const s = tile_free_list_.front().first;
+				tile_info.z = s / num_cache_tiles_a_layer;
+				tile_info.y = (s - tile_info.z * num_cache_tiles_a_layer) / num_cache_tiles_a_row;
+				tile_info.x = s - tile_info.z * num_cache_tiles_a_layer - tile_info.y * num_cache_tiles_a_row;
+
+				++ tile_free_list_.front().first;
+				if (tile_free_list_.front().first == tile_free_list_.front().second)
+				{
+					tile_free_list_.pop_front();
+				}
+			}
+			else
 			{
-				static_cast<uint8_t>(tile_info.x),
-				static_cast<uint8_t>(tile_info.y),
-				static_cast<uint8_t>(tile_info.z),
-				0
-			};
+				// Find tiles that are not used for the longest time
+
+				uint64_t min_tick = tim.begin()->second.tick;
+				auto min_tileiter = tim.begin();
+				for (auto tileiter = tim.begin(); tileiter != tim.end(); ++ tileiter)
+				{
+					if (tileiter->second.tick < min_tick)
+					{
+						min_tick = tileiter->second.tick;
+						min_tileiter = tileiter;
+					}
+				}
+
+				tile_info.x = min_tileiter->second.x;
+				tile_info.y = min_tileiter->second.y;
+				tile_info.z = min_tileiter->second.z;
+
+				for (auto tileiter = tim.begin(); tileiter != tim.end();)
+				{
+					if (tileiter->second.tick == min_tick)
+					{
+						uint32_t const id = tileiter->second.z * num_cache_tiles_a_layer + tileiter->second.y * num_cache_tiles_a_row + tileiter->second.x;
+						auto freeiter = tile_free_list_.begin();
+						while ((freeiter != tile_free_list_.end()) && (freeiter->second <= id))
+						{
+							++ freeiter;
+						}
+						tile_free_list_.emplace(freeiter, id, id + 1);
+
+						tileiter = tim.erase(tileiter);
+					}
+					else
+					{
+						 ++ tileiter;
+					}
+				}
+				for (auto freeiter = tile_free_list_.begin(); freeiter != tile_free_list_.end() - 1;)
+				{
+					auto nextiter = freeiter;
+					++ nextiter;
+
+					if (freeiter->second == nextiter->first)
+					{
+						freeiter->second = nextiter->second;
+						freeiter = tile_free_list_.erase(nextiter);
+						-- freeiter;
+					}
+					else
+					{
+						++ freeiter;
+					}
+				}
+			}
+
+			uint32_t mip_tile_with_border_size = tile_with_border_size;
+			for (uint32_t l = 0; l < decoded_tile.mip_data.size(); ++ l)
+			{
+				TexturePtr target_tex;
+				uint32_t target_array_index;
+				if (tex_cache_)
+				{
+					target_tex = tex_cache_;
+					target_array_index = tile_info.z;
+				}
+				else
+				{
+					target_tex = tex_cache_array_[tile_info.z];
+					target_array_index = 0;
+				}
+
+				target_tex->UpdateSubresource2D(target_array_index, l,
+					tile_info.x * mip_tile_with_border_size, tile_info.y * mip_tile_with_border_size,
+					mip_tile_with_border_size, mip_tile_with_border_size,
+					&decoded_tile.mip_data[l][0], decoded_tile.mip_row_pitches[l]);
+
+				mip_tile_with_border_size /= 2;
+			}
+
 			uint32_t level, tile_x, tile_y;
-			this->DecodeTileID(level, tile_x, tile_y, all_neighbor_ids[i]);
-			tex_indirect_->UpdateSubresource2D(0, 0, tile_x, tile_y, 1, 1, a_tile_indirect, sizeof(a_tile_indirect));
+			this->DecodeTileID(level, tile_x, tile_y, decoded_tile.tile_id);
+			uint32_t const a_tile_indirect = (tile_info.x << 0) | (tile_info.y << 8) | (tile_info.z << 16);
+			indirect_updates.emplace_back((tile_y << MAX_TREE_LEVEL) | tile_x, a_tile_indirect);
+
+			tim.emplace(decoded_tile.tile_id, tile_info);
+			decoding_tile_ids_.erase(decoded_tile.tile_id);
+			decoded_tiles_.pop_front();
+
+			if (timer.elapsed() * 1000 >= upload_budget_ms_)
+			{
+				break;
+			}
+		}
+
+		this->UpdateIndirectTex(indirect_updates);
+	}
+
+	void JudaTexture::UpdateIndirectTex(std::vector<std::pair<uint32_t, uint32_t>>& updates)
+	{
+		// Only the changed texels are written. Neighbors in a row go in one update.
+		std::stable_sort(updates.begin(), updates.end(),
+			[](std::pair<uint32_t, uint32_t> const & lhs, std::pair<uint32_t, uint32_t> const & rhs)
+			{
+				return lhs.first < rhs.first;
+			});
+		std::vector<uint32_t> run;
+		for (size_t i = 0; i < updates.size();)
+		{
+			uint32_t const y = updates[i].first >> MAX_TREE_LEVEL;
+			uint32_t const x = updates[i].first & TILE_MASK;
+
+			run.clear();
+			run.push_back(updates[i].second);
+			size_t j = i + 1;
+			while ((j < updates.size()) && (updates[j].first == updates[j - 1].first + 1)
+				&& ((updates[j].first >> MAX_TREE_LEVEL) == y))
+			{
+				run.push_back(updates[j].second);
+				++ j;
+			}
+			while ((j < updates.size()) && (updates[j].first == updates[j - 1].first))
+			{
+				// Same texel written twice, the last one wins
+				run.back() = updates[j].second;
+				++ j;
+			}
 
-			tim.emplace(all_neighbor_ids[i], tile_info);
+			tex_indirect_->UpdateSubresource2D(0, 0, x, y, static_cast<uint32_t>(run.size()), 1, run.data(),
+				static_cast<uint32_t>(run.size() * sizeof(run[0])));
+			i = j;
 		}
 	}
 }
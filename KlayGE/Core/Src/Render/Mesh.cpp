@@ -23,8 +23,11 @@
 #include <KFL/CXX17/filesystem.hpp>
 #include <KFL/ErrorHandling.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/Thread.hpp>
 #include <KlayGE/Context.hpp>
 #include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/RenderEffect.hpp>
 #include <KlayGE/ResLoader.hpp>
@@ -44,13 +47,213 @@
 #include <sstream>
 #include <cstring>
 
+#if defined(KLAYGE_SSE_SUPPORT)
+	#include <emmintrin.h>
+#endif
+
 #include <KlayGE/Mesh.hpp>
 
 namespace
 {
 	using namespace KlayGE;
 
-	uint32_t const MODEL_BIN_VERSION = 17;
+	enum KeyFrameFormat
+	{
+		KFF_Raw = 0,
+		KFF_Compressed
+	};
+
+	uint32_t const MIN_JOINTS_PER_TASK = 4 * 1024;
+
+	uint32_t NumAnimationThreads()
+	{
+		static uint32_t const num_threads = std::max(CPUInfo().NumHWThreads(), 1);
+		return num_threads;
+	}
+
+	// Returns index0 with frame_id[index0] <= frame < frame_id[index0 + 1]. Playback mostly stays in the cached
+	// interval, moves to the next one, or wraps to the first one, so those are tried before the binary search.
+	uint32_t LocateKeyFrame(std::vector<uint32_t> const & frame_id, float frame, uint32_t cursor)
+	{
+		uint32_t const num_keys = static_cast<uint32_t>(frame_id.size());
+		for (uint32_t const index0 : { cursor, cursor + 1, 0U })
+		{
+			if ((index0 < num_keys) && (frame_id[index0] <= frame)
+				&& ((index0 + 1 == num_keys) || (frame < frame_id[index0 + 1])))
+			{
+				return index0;
+			}
+		}
+
+		auto iter = std::upper_bound(frame_id.begin(), frame_id.end(), frame);
+		return static_cast<uint32_t>(iter - frame_id.begin()) - 1;
+	}
+
+	// Finds the keys around frame for a track with at least 2 keys, returns the interpolation factor between them
+	float LocateKeyFrames(std::vector<uint32_t> const & frame_id, float frame, uint32_t& cursor, int& index0, int& index1)
+	{
+		float const period = static_cast<float>(frame_id.back() + 1);
+		if (frame >= period)
+		{
+			frame = std::fmod(frame, period);
+		}
+
+		cursor = LocateKeyFrame(frame_id, frame, cursor);
+
+		index0 = cursor;
+		index1 = (cursor + 1) % frame_id.size();
+		int frame0 = frame_id[index0];
+		int frame1 = frame_id[index1];
+		return (frame - frame0) / (frame1 - frame0);
+	}
+
+	uint16_t QuantizeUNorm16(float v)
+	{
+		return static_cast<uint16_t>(MathLib::clamp(v, 0.0f, 1.0f) * 65535 + 0.5f);
+	}
+
+	void UpdateBind(Joint const & joint, float4& bind_real_part, float4& bind_dual_part)
+	{
+		Quaternion bind_real, bind_dual;
+		float bind_scale;
+		if ((MathLib::SignBit(joint.inverse_origin_scale) > 0) && (MathLib::SignBit(joint.bind_scale) > 0))
+		{
+			bind_real = MathLib::mul_real(joint.inverse_origin_real, joint.bind_real);
+			bind_dual = MathLib::mul_dual(joint.inverse_origin_real, joint.inverse_origin_dual,
+				joint.bind_real, joint.bind_dual);
+			bind_scale = joint.inverse_origin_scale * joint.bind_scale;
+
+			if (MathLib::SignBit(bind_real.w()) < 0)
+			{
+				bind_real = -bind_real;
+				bind_dual = -bind_dual;
+			}
+		}
+		else
+		{
+			float4x4 tmp_mat = MathLib::scaling(MathLib::abs(joint.inverse_origin_scale), MathLib::abs(joint.inverse_origin_scale), joint.inverse_origin_scale)
+				* MathLib::to_matrix(joint.inverse_origin_real)
+				* MathLib::translation(MathLib::udq_to_trans(joint.inverse_origin_real, joint.inverse_origin_dual))
+				* MathLib::scaling(MathLib::abs(joint.bind_scale), MathLib::abs(joint.bind_scale), joint.bind_scale)
+				* MathLib::to_matrix(joint.bind_real)
+				* MathLib::translation(MathLib::udq_to_trans(joint.bind_real, joint.bind_dual));
+
+			float flip = 1;
+			if (MathLib::dot(MathLib::cross(float3(tmp_mat(0, 0), tmp_mat(0, 1), tmp_mat(0, 2)),
+				float3(tmp_mat(1, 0), tmp_mat(1, 1), tmp_mat(1, 2))),
+				float3(tmp_mat(2, 0), tmp_mat(2, 1), tmp_mat(2, 2))) < 0)
+			{
+				tmp_mat(2, 0) = -tmp_mat(2, 0);
+				tmp_mat(2, 1) = -tmp_mat(2, 1);
+				tmp_mat(2, 2) = -tmp_mat(2, 2);
+
+				flip = -1;
+			}
+
+			float3 scale;
+			Quaternion rot;
+			float3 trans;
+			MathLib::decompose(scale, rot, trans, tmp_mat);
+
+			bind_real = rot;
+			bind_dual = MathLib::quat_trans_to_udq(rot, trans);
+			bind_scale = scale.x();
+
+			if (flip * MathLib::SignBit(bind_real.w()) < 0)
+			{
+				bind_real = -bind_real;
+				bind_dual = -bind_dual;
+			}
+		}
+
+		bind_real_part = float4(bind_real.x(), bind_real.y(), bind_real.z(), bind_real.w()) * bind_scale;
+		bind_dual_part = float4(bind_dual.x(), bind_dual.y(), bind_dual.z(), bind_dual.w());
+	}
+
+#if defined(KLAYGE_SSE_SUPPORT)
+	struct QuaternionSoA
+	{
+		__m128 x, y, z, w;
+	};
+
+	QuaternionSoA LoadQuaternions(Quaternion const & q0, Quaternion const & q1, Quaternion const & q2, Quaternion const & q3)
+	{
+		QuaternionSoA ret = { _mm_loadu_ps(&q0[0]), _mm_loadu_ps(&q1[0]), _mm_loadu_ps(&q2[0]), _mm_loadu_ps(&q3[0]) };
+		_MM_TRANSPOSE4_PS(ret.x, ret.y, ret.z, ret.w);
+		return ret;
+	}
+
+	void StoreQuaternions(float4* dst, QuaternionSoA q)
+	{
+		_MM_TRANSPOSE4_PS(q.x, q.y, q.z, q.w);
+		_mm_storeu_ps(&dst[0][0], q.x);
+		_mm_storeu_ps(&dst[1][0], q.y);
+		_mm_storeu_ps(&dst[2][0], q.z);
+		_mm_storeu_ps(&dst[3][0], q.w);
+	}
+
+	// Same component order as MathLib::mul
+	QuaternionSoA MulQuaternions(QuaternionSoA const & lhs, QuaternionSoA const & rhs)
+	{
+		QuaternionSoA ret;
+		ret.x = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(lhs.x, rhs.w), _mm_mul_ps(lhs.y, rhs.z)),
+			_mm_mul_ps(lhs.z, rhs.y)), _mm_mul_ps(lhs.w, rhs.x));
+		ret.y = _mm_add_ps(_mm_sub_ps(_mm_add_ps(_mm_mul_ps(lhs.x, rhs.z), _mm_mul_ps(lhs.y, rhs.w)),
+			_mm_mul_ps(lhs.z, rhs.x)), _mm_mul_ps(lhs.w, rhs.y));
+		ret.z = _mm_add_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(lhs.y, rhs.x), _mm_mul_ps(lhs.x, rhs.y)),
+			_mm_mul_ps(lhs.z, rhs.w)), _mm_mul_ps(lhs.w, rhs.z));
+		ret.w = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_mul_ps(lhs.w, rhs.w), _mm_mul_ps(lhs.x, rhs.x)),
+			_mm_mul_ps(lhs.y, rhs.y)), _mm_mul_ps(lhs.z, rhs.z));
+		return ret;
+	}
+
+	// Dual quaternion version of the positive scale path in UpdateBind, 4 joints at a time.
+	// Returns false without writing anything if any of the joints needs the matrix path.
+	bool UpdateBinds4(Joint const * joints, float4* bind_real_parts, float4* bind_dual_parts)
+	{
+		__m128 const inv_origin_scale = _mm_setr_ps(joints[0].inverse_origin_scale, joints[1].inverse_origin_scale,
+			joints[2].inverse_origin_scale, joints[3].inverse_origin_scale);
+		__m128 const bind_scale = _mm_setr_ps(joints[0].bind_scale, joints[1].bind_scale,
+			joints[2].bind_scale, joints[3].bind_scale);
+		if (_mm_movemask_ps(_mm_or_ps(inv_origin_scale, bind_scale)) != 0)
+		{
+			return false;
+		}
+
+		QuaternionSoA const inv_origin_real = LoadQuaternions(joints[0].inverse_origin_real, joints[1].inverse_origin_real,
+			joints[2].inverse_origin_real, joints[3].inverse_origin_real);
+		QuaternionSoA const inv_origin_dual = LoadQuaternions(joints[0].inverse_origin_dual, joints[1].inverse_origin_dual,
+			joints[2].inverse_origin_dual, joints[3].inverse_origin_dual);
+		QuaternionSoA const bind_real = LoadQuaternions(joints[0].bind_real, joints[1].bind_real,
+			joints[2].bind_real, joints[3].bind_real);
+		QuaternionSoA const bind_dual = LoadQuaternions(joints[0].bind_dual, joints[1].bind_dual,
+			joints[2].bind_dual, joints[3].bind_dual);
+
+		QuaternionSoA real = MulQuaternions(inv_origin_real, bind_real);
+		QuaternionSoA dual = MulQuaternions(inv_origin_real, bind_dual);
+		QuaternionSoA const dual_rhs = MulQuaternions(inv_origin_dual, bind_real);
+		dual.x = _mm_add_ps(dual.x, dual_rhs.x);
+		dual.y = _mm_add_ps(dual.y, dual_rhs.y);
+		dual.z = _mm_add_ps(dual.z, dual_rhs.z);
+		dual.w = _mm_add_ps(dual.w, dual_rhs.w);
+
+		// Flip to the positive w hemisphere by xoring the sign of w into every component, and fold in the scale
+		__m128 const sign = _mm_and_ps(real.w, _mm_set1_ps(-0.0f));
+		__m128 const scale = _mm_xor_ps(_mm_mul_ps(inv_origin_scale, bind_scale), sign);
+		real.x = _mm_mul_ps(real.x, scale);
+		real.y = _mm_mul_ps(real.y, scale);
+		real.z = _mm_mul_ps(real.z, scale);
+		real.w = _mm_mul_ps(real.w, scale);
+		dual.x = _mm_xor_ps(dual.x, sign);
+		dual.y = _mm_xor_ps(dual.y, sign);
+		dual.z = _mm_xor_ps(dual.z, sign);
+		dual.w = _mm_xor_ps(dual.w, sign);
+
+		StoreQuaternions(bind_real_parts, real);
+		StoreQuaternions(bind_dual_parts, dual);
+		return true;
+	}
+#endif
 
 	class RenderModelLoadingDesc : public ResLoadingDesc
 	{
@@ -479,7 +682,9 @@ namespace KlayGE
 					mesh.NumIndices(lod, src_mesh.NumIndices(lod));
 					mesh.StartVertexLocation(lod, src_mesh.StartVertexLocation(lod));
 					mesh.StartIndexLocation(lod, src_mesh.StartIndexLocation(lod));
+					mesh.Clusters(lod, src_mesh.Clusters(lod).ToVector());
 				}
+				mesh.ClusterCulling(src_mesh.ClusterCulling());
 			}
 
 			this->AssignMeshes(meshes.begin(), meshes.end());
@@ -561,6 +766,77 @@ namespace KlayGE
 			}
 			rl->TopologyType(RenderLayout::TT_TriangleList);
 		}
+
+		clusters_.clear();
+		clusters_.resize(lods);
+	}
+
+	uint32_t StaticMesh::CullClusters(MeshClusterCuller& culler, uint32_t lod, float4x4 const & model,
+		std::vector<MeshClusterCuller::IndexRange>& ranges) const
+	{
+		bool backface_culling = !(mtl_ && mtl_->two_sided);
+		if (Context::Instance().DeferredRenderingLayerInstance())
+		{
+			backface_culling &= (GetPassCategory(type_) != PC_ShadowMap) && (GetPassTargetBuffer(type_) != PTB_TransparencyBack);
+		}
+		return culler.Cull(clusters_[lod], rls_[lod]->StartIndexLocation(), model, backface_culling, ranges);
+	}
+
+	void StaticMesh::Render()
+	{
+		uint32_t const lod = this->RenderLod();
+		RenderLayout& layout = this->GetRenderLayout(lod);
+		bool const hw_instancing = layout.InstanceStream() || (!instances_.empty() && !instances_[0]->InstanceFormat().empty());
+		if (!cluster_culling_ || clusters_[lod].empty() || hw_instancing)
+		{
+			Renderable::Render();
+			return;
+		}
+
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		auto const & camera = *re.CurFrameBuffer()->GetViewport()->camera;
+
+		MeshClusterCuller culler;
+		culler.BeginFrame(camera.ViewFrustum(), camera.EyePos());
+
+		RenderTechnique const & tech = *this->GetRenderTechnique();
+		auto const & effect = *this->GetRenderEffect();
+
+		uint32_t const start_index = layout.StartIndexLocation();
+		uint32_t const num_indices = layout.NumIndices();
+
+		// Each instance is culled with the world transform of its own node
+		auto render_visible_clusters = [this, &re, &culler, &tech, &effect, &layout, lod]()
+			{
+				cluster_ranges_.clear();
+				if (this->CullClusters(culler, lod, model_mat_, cluster_ranges_) > 0)
+				{
+					this->OnRenderBegin();
+					for (auto const & range : cluster_ranges_)
+					{
+						layout.StartIndexLocation(range.start_index);
+						layout.NumIndices(range.num_indices);
+						re.Render(effect, tech, layout);
+					}
+					this->OnRenderEnd();
+				}
+			};
+
+		if (instances_.empty())
+		{
+			render_visible_clusters();
+		}
+		else
+		{
+			for (auto const * node : instances_)
+			{
+				this->BindSceneNode(node);
+				render_visible_clusters();
+			}
+		}
+
+		layout.StartIndexLocation(start_index);
+		layout.NumIndices(num_indices);
 	}
 
 	void StaticMesh::DoBuildMeshInfo(RenderModel const & model)
@@ -646,6 +922,12 @@ namespace KlayGE
 
 
 	std::tuple<Quaternion, Quaternion, float> KeyFrameSet::Frame(float frame) const
+	{
+		uint32_t cursor = 0;
+		return this->Frame(frame, cursor);
+	}
+
+	std::tuple<Quaternion, Quaternion, float> KeyFrameSet::Frame(float frame, uint32_t& cursor) const
 	{
 		std::tuple<Quaternion, Quaternion, float> ret;
 		if (frame_id.size() == 1)
@@ -654,22 +936,165 @@ namespace KlayGE
 		}
 		else
 		{
-			frame = std::fmod(frame, static_cast<float>(frame_id.back() + 1));
+			int index0;
+			int index1;
+			float const factor = LocateKeyFrames(frame_id, frame, cursor, index0, index1);
+			if (factor == 0)
+			{
+				// Exactly on a key, sclerp would give back the key itself
+				ret = std::make_tuple(bind_real[index0], bind_dual[index0], bind_scale[index0]);
+			}
+			else
+			{
+				auto dq = MathLib::sclerp(bind_real[index0], bind_dual[index0], bind_real[index1], bind_dual[index1], factor);
+				ret = std::make_tuple(dq.first, dq.second, MathLib::lerp(bind_scale[index0], bind_scale[index1], factor));
+			}
+		}
+		return ret;
+	}
 
-			auto iter = std::upper_bound(frame_id.begin(), frame_id.end(), frame);
-			int index = static_cast<int>(iter - frame_id.begin());
+	CompressedKeyFrameSet CompressedKeyFrameSet::Compress(KeyFrameSet const & kf)
+	{
+		uint32_t const num_keys = static_cast<uint32_t>(kf.frame_id.size());
+
+		std::vector<float3> translations(num_keys);
+		float3 trans_min(+1e30f, +1e30f, +1e30f);
+		float3 trans_max(-1e30f, -1e30f, -1e30f);
+		float scale_min = +1e30f;
+		float scale_max = -1e30f;
+		for (uint32_t i = 0; i < num_keys; ++ i)
+		{
+			translations[i] = MathLib::udq_to_trans(kf.bind_real[i], kf.bind_dual[i]);
+			trans_min = MathLib::minimize(trans_min, translations[i]);
+			trans_max = MathLib::maximize(trans_max, translations[i]);
+			scale_min = std::min(scale_min, kf.bind_scale[i]);
+			scale_max = std::max(scale_max, kf.bind_scale[i]);
+		}
+		float3 const trans_extent = trans_max - trans_min;
+		float const scale_extent = scale_max - scale_min;
+
+		// The 3 smallest components of a unit quaternion are within [-1/sqrt(2), 1/sqrt(2)]
+		float const rot_range = 2 / std::sqrt(2.0f);
+
+		CompressedKeyFrameSet ret;
+		ret.frame_id = kf.frame_id;
+		ret.keys.resize(num_keys * KEY_SIZE);
+		ret.dequant_scale[0] = float4(rot_range, rot_range, rot_range, trans_extent.x()) / 65535.0f;
+		ret.dequant_bias[0] = float4(-rot_range / 2, -rot_range / 2, -rot_range / 2, trans_min.x());
+		ret.dequant_scale[1] = float4(trans_extent.y(), trans_extent.z(), scale_extent, 0) / 65535.0f;
+		ret.dequant_bias[1] = float4(trans_min.y(), trans_min.z(), scale_min, 0);
+
+		for (uint32_t i = 0; i < num_keys; ++ i)
+		{
+			uint16_t* key = &ret.keys[i * KEY_SIZE];
+
+			Quaternion real = kf.bind_real[i];
+			uint16_t largest = 0;
+			for (uint16_t j = 1; j < 4; ++ j)
+			{
+				if (MathLib::abs(real[j]) > MathLib::abs(real[largest]))
+				{
+					largest = j;
+				}
+			}
+			if (real[largest] < 0)
+			{
+				real = -real;
+			}
+			for (uint32_t j = 0, k = 0; j < 4; ++ j)
+			{
+				if (j != largest)
+				{
+					key[k] = QuantizeUNorm16(real[j] / rot_range + 0.5f);
+					++ k;
+				}
+			}
 
-			int index0 = index - 1;
-			int index1 = index % frame_id.size();
-			int frame0 = frame_id[index0];
-			int frame1 = frame_id[index1];
-			float factor = (frame - frame0) / (frame1 - frame0);
-			auto dq = MathLib::sclerp(bind_real[index0], bind_dual[index0], bind_real[index1], bind_dual[index1], factor);
-			ret = std::make_tuple(dq.first, dq.second, MathLib::lerp(bind_scale[index0], bind_scale[index1], factor));
+			for (uint32_t j = 0; j < 3; ++ j)
+			{
+				key[3 + j] = (trans_extent[j] > 0) ? QuantizeUNorm16((translations[i][j] - trans_min[j]) / trans_extent[j]) : 0;
+			}
+			key[6] = (scale_extent > 0) ? QuantizeUNorm16((kf.bind_scale[i] - scale_min) / scale_extent) : 0;
+			key[7] = largest;
+		}
+
+		return ret;
+	}
+
+	KeyFrameSet CompressedKeyFrameSet::Decompress() const
+	{
+		KeyFrameSet ret;
+		ret.frame_id = frame_id;
+		for (uint32_t i = 0; i < frame_id.size(); ++ i)
+		{
+			auto const key = this->Key(i);
+			ret.bind_real.push_back(std::get<0>(key));
+			ret.bind_dual.push_back(std::get<1>(key));
+			ret.bind_scale.push_back(std::get<2>(key));
 		}
 		return ret;
 	}
 
+	std::tuple<Quaternion, Quaternion, float> CompressedKeyFrameSet::Key(uint32_t index) const
+	{
+		uint16_t const * key = &keys[index * KEY_SIZE];
+
+		float4 lo;
+		float4 hi;
+#if defined(KLAYGE_SSE_SUPPORT)
+		__m128i const packed = _mm_loadu_si128(reinterpret_cast<__m128i const *>(key));
+		__m128i const zero = _mm_setzero_si128();
+		__m128 const lo_v = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero));
+		__m128 const hi_v = _mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero));
+		_mm_storeu_ps(&lo[0], _mm_add_ps(_mm_mul_ps(lo_v, _mm_loadu_ps(&dequant_scale[0][0])), _mm_loadu_ps(&dequant_bias[0][0])));
+		_mm_storeu_ps(&hi[0], _mm_add_ps(_mm_mul_ps(hi_v, _mm_loadu_ps(&dequant_scale[1][0])), _mm_loadu_ps(&dequant_bias[1][0])));
+#else
+		for (uint32_t i = 0; i < 4; ++ i)
+		{
+			lo[i] = key[i] * dequant_scale[0][i] + dequant_bias[0][i];
+			hi[i] = key[4 + i] * dequant_scale[1][i] + dequant_bias[1][i];
+		}
+#endif
+
+		uint16_t const largest = key[7];
+		Quaternion real;
+		for (uint32_t j = 0, k = 0; j < 4; ++ j)
+		{
+			if (j == largest)
+			{
+				real[j] = std::sqrt(std::max(1 - lo.x() * lo.x() - lo.y() * lo.y() - lo.z() * lo.z(), 0.0f));
+			}
+			else
+			{
+				real[j] = lo[k];
+				++ k;
+			}
+		}
+
+		return std::make_tuple(real, MathLib::quat_trans_to_udq(real, float3(lo.w(), hi.x(), hi.y())), hi.z());
+	}
+
+	std::tuple<Quaternion, Quaternion, float> CompressedKeyFrameSet::Frame(float frame, uint32_t& cursor) const
+	{
+		if (frame_id.size() == 1)
+		{
+			return this->Key(0);
+		}
+
+		int index0;
+		int index1;
+		float const factor = LocateKeyFrames(frame_id, frame, cursor, index0, index1);
+		if (factor == 0)
+		{
+			return this->Key(index0);
+		}
+
+		auto const key0 = this->Key(index0);
+		auto const key1 = this->Key(index1);
+		auto dq = MathLib::sclerp(std::get<0>(key0), std::get<1>(key0), std::get<0>(key1), std::get<1>(key1), factor);
+		return std::make_tuple(dq.first, dq.second, MathLib::lerp(std::get<2>(key0), std::get<2>(key1), factor));
+	}
+
 	AABBox AABBKeyFrameSet::Frame(float frame) const
 	{
 		if (frame_id.size() == 1)
@@ -708,12 +1133,15 @@ namespace KlayGE
 
 	void SkinnedModel::BuildBones(float frame)
 	{
+		key_frame_cursors_.resize(joints_.size(), 0);
+
 		for (size_t i = 0; i < joints_.size(); ++ i)
 		{
 			Joint& joint = joints_[i];
-			KeyFrameSet const & kf = (*key_frame_sets_)[i];
 
-			std::tuple<Quaternion, Quaternion, float> key_dq = kf.Frame(frame);
+			std::tuple<Quaternion, Quaternion, float> key_dq = compressed_key_frame_sets_
+				? (*compressed_key_frame_sets_)[i].Frame(frame, key_frame_cursors_[i])
+				: (*key_frame_sets_)[i].Frame(frame, key_frame_cursors_[i]);
 
 			if (joint.parent != -1)
 			{
@@ -779,64 +1207,23 @@ namespace KlayGE
 	{
 		bind_reals_.resize(joints_.size());
 		bind_duals_.resize(joints_.size());
-		for (size_t i = 0; i < joints_.size(); ++ i)
-		{
-			Joint const & joint = joints_[i];
 
-			Quaternion bind_real, bind_dual;
-			float bind_scale;
-			if ((MathLib::SignBit(joint.inverse_origin_scale) > 0) && (MathLib::SignBit(joint.bind_scale) > 0))
-			{
-				bind_real = MathLib::mul_real(joint.inverse_origin_real, joint.bind_real);
-				bind_dual = MathLib::mul_dual(joint.inverse_origin_real, joint.inverse_origin_dual,
-					joint.bind_real, joint.bind_dual);
-				bind_scale = joint.inverse_origin_scale * joint.bind_scale;
-
-				if (MathLib::SignBit(bind_real.w()) < 0)
-				{
-					bind_real = -bind_real;
-					bind_dual = -bind_dual;
-				}
-			}
-			else
+		size_t i = 0;
+#if defined(KLAYGE_SSE_SUPPORT)
+		for (; i + 4 <= joints_.size(); i += 4)
+		{
+			if (!UpdateBinds4(&joints_[i], &bind_reals_[i], &bind_duals_[i]))
 			{
-				float4x4 tmp_mat = MathLib::scaling(MathLib::abs(joint.inverse_origin_scale), MathLib::abs(joint.inverse_origin_scale), joint.inverse_origin_scale)
-					* MathLib::to_matrix(joint.inverse_origin_real)
-					* MathLib::translation(MathLib::udq_to_trans(joint.inverse_origin_real, joint.inverse_origin_dual))
-					* MathLib::scaling(MathLib::abs(joint.bind_scale), MathLib::abs(joint.bind_scale), joint.bind_scale)
-					* MathLib::to_matrix(joint.bind_real)
-					* MathLib::translation(MathLib::udq_to_trans(joint.bind_real, joint.bind_dual));
-
-				float flip = 1;
-				if (MathLib::dot(MathLib::cross(float3(tmp_mat(0, 0), tmp_mat(0, 1), tmp_mat(0, 2)),
-					float3(tmp_mat(1, 0), tmp_mat(1, 1), tmp_mat(1, 2))),
-					float3(tmp_mat(2, 0), tmp_mat(2, 1), tmp_mat(2, 2))) < 0)
-				{
-					tmp_mat(2, 0) = -tmp_mat(2, 0);
-					tmp_mat(2, 1) = -tmp_mat(2, 1);
-					tmp_mat(2, 2) = -tmp_mat(2, 2);
-
-					flip = -1;
-				}
-
-				float3 scale;
-				Quaternion rot;
-				float3 trans;
-				MathLib::decompose(scale, rot, trans, tmp_mat);
-
-				bind_real = rot;
-				bind_dual = MathLib::quat_trans_to_udq(rot, trans);
-				bind_scale = scale.x();
-
-				if (flip * MathLib::SignBit(bind_real.w()) < 0)
+				for (size_t j = i; j < i + 4; ++ j)
 				{
-					bind_real = -bind_real;
-					bind_dual = -bind_dual;
+					UpdateBind(joints_[j], bind_reals_[j], bind_duals_[j]);
 				}
 			}
-
-			bind_reals_[i] = float4(bind_real.x(), bind_real.y(), bind_real.z(), bind_real.w()) * bind_scale;
-			bind_duals_[i] = float4(bind_dual.x(), bind_dual.y(), bind_dual.z(), bind_dual.w());
+		}
+#endif
+		for (; i < joints_.size(); ++ i)
+		{
+			UpdateBind(joints_[i], bind_reals_[i], bind_duals_[i]);
 		}
 	}
 
@@ -927,6 +1314,7 @@ namespace KlayGE
 			}
 			skinned_model.AssignJoints(joints.begin(), joints.end());
 			skinned_model.AttachKeyFrameSets(src_skinned_model.GetKeyFrameSets());
+			skinned_model.AttachCompressedKeyFrameSets(src_skinned_model.GetCompressedKeyFrameSets());
 
 			skinned_model.NumFrames(src_skinned_model.NumFrames());
 			skinned_model.FrameRate(src_skinned_model.FrameRate());
@@ -960,6 +1348,63 @@ namespace KlayGE
 	}
 
 
+	void SetSkinnedModelFrames(ArrayRef<SkinnedModelPtr> models, ArrayRef<float> frames)
+	{
+		BOOST_ASSERT(models.size() == frames.size());
+
+		size_t total_joints = 0;
+		for (auto const & model : models)
+		{
+			total_joints += model->NumJoints();
+		}
+
+		auto set_frames = [models, frames](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++ i)
+				{
+					models[i]->SetFrame(frames[i]);
+				}
+			};
+
+		size_t const num_tasks = std::min<size_t>(NumAnimationThreads(), total_joints / MIN_JOINTS_PER_TASK);
+		if (num_tasks <= 1)
+		{
+			set_frames(0, models.size());
+			return;
+		}
+
+		// Cut the model list where the running joint count crosses each task boundary
+		size_t const joints_per_task = (total_joints + num_tasks - 1) / num_tasks;
+		std::vector<size_t> task_begins(1, 0);
+		size_t joints = 0;
+		for (size_t i = 0; i < models.size(); ++ i)
+		{
+			joints += models[i]->NumJoints();
+			if ((joints >= joints_per_task * task_begins.size()) && (i + 1 < models.size()))
+			{
+				task_begins.push_back(i + 1);
+			}
+		}
+		task_begins.push_back(models.size());
+
+		auto& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(task_begins.size() - 2);
+		for (size_t i = 1; i < task_begins.size() - 1; ++ i)
+		{
+			size_t const begin = task_begins[i];
+			size_t const end = task_begins[i + 1];
+			joiners.push_back(tp([&set_frames, begin, end] { set_frames(begin, end); }));
+		}
+		set_frames(task_begins[0], task_begins[1]);
+
+		for (auto& joiner : joiners)
+		{
+			joiner();
+		}
+	}
+
+
 	RenderModelPtr SyncLoadModel(std::string_view model_name, uint32_t access_hint, uint32_t node_attrib,
 		std::function<void(RenderModel&)> OnFinishLoading,
 		std::function<RenderModelPtr(std::wstring_view, uint32_t)> CreateModelFactoryFunc,
@@ -1019,7 +1464,7 @@ namespace KlayGE
 				uint32_t ver;
 				runtime_file->read(&ver, sizeof(ver));
 				ver = LE2Native(ver);
-				if ((fourcc != MakeFourCC<'K', 'L', 'M', ' '>::value) || (ver != MODEL_BIN_VERSION))
+				if ((fourcc != MODEL_BIN_FOURCC) || (ver != MODEL_BIN_VERSION))
 				{
 					jit = true;
 				}
@@ -1064,10 +1509,12 @@ namespace KlayGE
 		std::vector<uint32_t> mesh_base_vertices;
 		std::vector<uint32_t> mesh_num_indices;
 		std::vector<uint32_t> mesh_start_indices;
+		std::vector<std::vector<MeshCluster>> mesh_clusters;
 		std::vector<std::pair<SceneNodePtr, std::vector<uint16_t>>> nodes;
 		std::vector<Joint> joints;
 		std::shared_ptr<std::vector<AnimationAction>> actions;
 		std::shared_ptr<std::vector<KeyFrameSet>> kfs;
+		std::shared_ptr<std::vector<CompressedKeyFrameSet>> compressed_kfs;
 		uint32_t num_frames = 0;
 		uint32_t frame_rate = 0;
 		std::vector<std::shared_ptr<AABBKeyFrameSet>> frame_pos_bbs;
@@ -1077,7 +1524,7 @@ namespace KlayGE
 		uint32_t fourcc;
 		runtime_file->read(&fourcc, sizeof(fourcc));
 		fourcc = LE2Native(fourcc);
-		BOOST_ASSERT((fourcc == MakeFourCC<'K', 'L', 'M', ' '>::value));
+		BOOST_ASSERT((fourcc == MODEL_BIN_FOURCC));
 
 		uint32_t ver;
 		runtime_file->read(&ver, sizeof(ver));
@@ -1385,46 +1832,95 @@ namespace KlayGE
 			decoded->read(&frame_rate, sizeof(frame_rate));
 			frame_rate = LE2Native(frame_rate);
 
-			kfs = MakeSharedPtr<std::vector<KeyFrameSet>>(joints.size());
-			for (uint32_t kf_index = 0; kf_index < num_kfs; ++ kf_index)
+			uint32_t key_frame_format;
+			decoded->read(&key_frame_format, sizeof(key_frame_format));
+			key_frame_format = LE2Native(key_frame_format);
+
+			if (KFF_Compressed == key_frame_format)
 			{
-				uint32_t joint_index = kf_index;
+				compressed_kfs = MakeSharedPtr<std::vector<CompressedKeyFrameSet>>(joints.size());
+				for (uint32_t kf_index = 0; kf_index < num_kfs; ++ kf_index)
+				{
+					uint32_t joint_index = kf_index;
 
-				uint32_t num_kf;
-				decoded->read(&num_kf, sizeof(num_kf));
-				num_kf = LE2Native(num_kf);
+					uint32_t num_kf;
+					decoded->read(&num_kf, sizeof(num_kf));
+					num_kf = LE2Native(num_kf);
 
-				KeyFrameSet kf;
-				kf.frame_id.resize(num_kf);
-				kf.bind_real.resize(num_kf);
-				kf.bind_dual.resize(num_kf);
-				kf.bind_scale.resize(num_kf);
-				for (uint32_t k_index = 0; k_index < num_kf; ++ k_index)
-				{
-					decoded->read(&kf.frame_id[k_index], sizeof(kf.frame_id[k_index]));
-					kf.frame_id[k_index] = LE2Native(kf.frame_id[k_index]);
-					decoded->read(&kf.bind_real[k_index], sizeof(kf.bind_real[k_index]));
-					kf.bind_real[k_index][0] = LE2Native(kf.bind_real[k_index][0]);
-					kf.bind_real[k_index][1] = LE2Native(kf.bind_real[k_index][1]);
-					kf.bind_real[k_index][2] = LE2Native(kf.bind_real[k_index][2]);
-					kf.bind_real[k_index][3] = LE2Native(kf.bind_real[k_index][3]);
-					decoded->read(&kf.bind_dual[k_index], sizeof(kf.bind_dual[k_index]));
-					kf.bind_dual[k_index][0] = LE2Native(kf.bind_dual[k_index][0]);
-					kf.bind_dual[k_index][1] = LE2Native(kf.bind_dual[k_index][1]);
-					kf.bind_dual[k_index][2] = LE2Native(kf.bind_dual[k_index][2]);
-					kf.bind_dual[k_index][3] = LE2Native(kf.bind_dual[k_index][3]);
-
-					float flip = MathLib::SignBit(kf.bind_real[k_index].w());
-
-					kf.bind_scale[k_index] = MathLib::length(kf.bind_real[k_index]);
-					kf.bind_real[k_index] /= kf.bind_scale[k_index];
-
-					kf.bind_scale[k_index] *= flip;
-				}
+					CompressedKeyFrameSet kf;
+					for (uint32_t i = 0; i < 2; ++ i)
+					{
+						decoded->read(&kf.dequant_scale[i], sizeof(kf.dequant_scale[i]));
+						decoded->read(&kf.dequant_bias[i], sizeof(kf.dequant_bias[i]));
+						for (uint32_t j = 0; j < 4; ++ j)
+						{
+							kf.dequant_scale[i][j] = LE2Native(kf.dequant_scale[i][j]);
+							kf.dequant_bias[i][j] = LE2Native(kf.dequant_bias[i][j]);
+						}
+					}
 
-				if (joint_index < num_joints)
+					kf.frame_id.resize(num_kf);
+					decoded->read(kf.frame_id.data(), kf.frame_id.size() * sizeof(kf.frame_id[0]));
+					for (auto& id : kf.frame_id)
+					{
+						id = LE2Native(id);
+					}
+					kf.keys.resize(num_kf * CompressedKeyFrameSet::KEY_SIZE);
+					decoded->read(kf.keys.data(), kf.keys.size() * sizeof(kf.keys[0]));
+					for (auto& key : kf.keys)
+					{
+						key = LE2Native(key);
+					}
+
+					if (joint_index < num_joints)
+					{
+						(*compressed_kfs)[joint_index] = std::move(kf);
+					}
+				}
+			}
+			else
+			{
+				kfs = MakeSharedPtr<std::vector<KeyFrameSet>>(joints.size());
+				for (uint32_t kf_index = 0; kf_index < num_kfs; ++ kf_index)
 				{
-					(*kfs)[joint_index] = kf;
+					uint32_t joint_index = kf_index;
+
+					uint32_t num_kf;
+					decoded->read(&num_kf, sizeof(num_kf));
+					num_kf = LE2Native(num_kf);
+
+					KeyFrameSet kf;
+					kf.frame_id.resize(num_kf);
+					kf.bind_real.resize(num_kf);
+					kf.bind_dual.resize(num_kf);
+					kf.bind_scale.resize(num_kf);
+					for (uint32_t k_index = 0; k_index < num_kf; ++ k_index)
+					{
+						decoded->read(&kf.frame_id[k_index], sizeof(kf.frame_id[k_index]));
+						kf.frame_id[k_index] = LE2Native(kf.frame_id[k_index]);
+						decoded->read(&kf.bind_real[k_index], sizeof(kf.bind_real[k_index]));
+						kf.bind_real[k_index][0] = LE2Native(kf.bind_real[k_index][0]);
+						kf.bind_real[k_index][1] = LE2Native(kf.bind_real[k_index][1]);
+						kf.bind_real[k_index][2] = LE2Native(kf.bind_real[k_index][2]);
+						kf.bind_real[k_index][3] = LE2Native(kf.bind_real[k_index][3]);
+						decoded->read(&kf.bind_dual[k_index], sizeof(kf.bind_dual[k_index]));
+						kf.bind_dual[k_index][0] = LE2Native(kf.bind_dual[k_index][0]);
+						kf.bind_dual[k_index][1] = LE2Native(kf.bind_dual[k_index][1]);
+						kf.bind_dual[k_index][2] = LE2Native(kf.bind_dual[k_index][2]);
+						kf.bind_dual[k_index][3] = LE2Native(kf.bind_dual[k_index][3]);
+
+						float flip = MathLib::SignBit(kf.bind_real[k_index].w());
+
+						kf.bind_scale[k_index] = MathLib::length(kf.bind_real[k_index]);
+						kf.bind_real[k_index] /= kf.bind_scale[k_index];
+
+						kf.bind_scale[k_index] *= flip;
+					}
+
+					if (joint_index < num_joints)
+					{
+						(*kfs)[joint_index] = kf;
+					}
 				}
 			}
 
@@ -1473,7 +1969,31 @@ namespace KlayGE
 			}
 		}
 
-		bool const skinned = kfs && !kfs->empty();
+		mesh_clusters.resize(mesh_num_indices.size());
+		for (auto& clusters : mesh_clusters)
+		{
+			uint32_t num_clusters;
+			decoded->read(&num_clusters, sizeof(num_clusters));
+			num_clusters = LE2Native(num_clusters);
+
+			clusters.resize(num_clusters);
+			for (auto& cluster : clusters)
+			{
+				decoded->read(&cluster, sizeof(cluster));
+				cluster.start_index = LE2Native(cluster.start_index);
+				cluster.num_indices = LE2Native(cluster.num_indices);
+				cluster.center.x() = LE2Native(cluster.center.x());
+				cluster.center.y() = LE2Native(cluster.center.y());
+				cluster.center.z() = LE2Native(cluster.center.z());
+				cluster.radius = LE2Native(cluster.radius);
+				cluster.cone_axis.x() = LE2Native(cluster.cone_axis.x());
+				cluster.cone_axis.y() = LE2Native(cluster.cone_axis.y());
+				cluster.cone_axis.z() = LE2Native(cluster.cone_axis.z());
+				cluster.cone_cutoff = LE2Native(cluster.cone_cutoff);
+			}
+		}
+
+		bool const skinned = (kfs && !kfs->empty()) || (compressed_kfs && !compressed_kfs->empty());
 
 		RenderModelPtr model;
 		if (skinned)
@@ -1525,6 +2045,7 @@ namespace KlayGE
 
 			uint32_t const lods = mesh_lods[mesh_index];
 			mesh->NumLods(lods);
+			bool has_clusters = false;
 			for (uint32_t lod = 0; lod < lods; ++ lod, ++ mesh_lod_index)
 			{
 				for (uint32_t ve_index = 0; ve_index < merged_buff.size(); ++ ve_index)
@@ -1537,10 +2058,15 @@ namespace KlayGE
 				mesh->NumIndices(lod, mesh_num_indices[mesh_lod_index]);
 				mesh->StartVertexLocation(lod, mesh_base_vertices[mesh_lod_index]);
 				mesh->StartIndexLocation(lod, mesh_start_indices[mesh_lod_index]);
+				has_clusters |= !mesh_clusters[mesh_lod_index].empty();
+				mesh->Clusters(lod, std::move(mesh_clusters[mesh_lod_index]));
 			}
+
+			// Clusters of skinned meshes are bounded in the bind pose, so they can't be culled
+			mesh->ClusterCulling(has_clusters && !skinned);
 		}
 
-		if (kfs && !kfs->empty())
+		if (skinned)
 		{
 			if (!joints.empty())
 			{
@@ -1548,6 +2074,7 @@ namespace KlayGE
 
 				skinned_model->AssignJoints(joints.begin(), joints.end());
 				skinned_model->AttachKeyFrameSets(kfs);
+				skinned_model->AttachCompressedKeyFrameSets(compressed_kfs);
 
 				skinned_model->NumFrames(num_frames);
 				skinned_model->FrameRate(frame_rate);
@@ -1806,6 +2333,8 @@ namespace KlayGE
 		os.write(reinterpret_cast<char*>(&num_frames), sizeof(num_frames));
 		frame_rate = Native2LE(frame_rate);
 		os.write(reinterpret_cast<char*>(&frame_rate), sizeof(frame_rate));
+		uint32_t key_frame_format = Native2LE(static_cast<uint32_t>(KFF_Raw));
+		os.write(reinterpret_cast<char*>(&key_frame_format), sizeof(key_frame_format));
 
 		for (size_t i = 0; i < kfs.size(); ++ i)
 		{
@@ -1835,6 +2364,47 @@ namespace KlayGE
 		}
 	}
 
+	void WriteCompressedKeyFramesChunk(uint32_t num_frames, uint32_t frame_rate, std::vector<CompressedKeyFrameSet> const & kfs,
+		std::ostream& os)
+	{
+		num_frames = Native2LE(num_frames);
+		os.write(reinterpret_cast<char*>(&num_frames), sizeof(num_frames));
+		frame_rate = Native2LE(frame_rate);
+		os.write(reinterpret_cast<char*>(&frame_rate), sizeof(frame_rate));
+		uint32_t key_frame_format = Native2LE(static_cast<uint32_t>(KFF_Compressed));
+		os.write(reinterpret_cast<char*>(&key_frame_format), sizeof(key_frame_format));
+
+		for (size_t i = 0; i < kfs.size(); ++ i)
+		{
+			uint32_t num_kf = Native2LE(static_cast<uint32_t>(kfs[i].frame_id.size()));
+			os.write(reinterpret_cast<char*>(&num_kf), sizeof(num_kf));
+
+			for (uint32_t j = 0; j < 2; ++ j)
+			{
+				float4 dequant_scale = kfs[i].dequant_scale[j];
+				float4 dequant_bias = kfs[i].dequant_bias[j];
+				for (uint32_t k = 0; k < 4; ++ k)
+				{
+					dequant_scale[k] = Native2LE(dequant_scale[k]);
+					dequant_bias[k] = Native2LE(dequant_bias[k]);
+				}
+				os.write(reinterpret_cast<char*>(&dequant_scale), sizeof(dequant_scale));
+				os.write(reinterpret_cast<char*>(&dequant_bias), sizeof(dequant_bias));
+			}
+
+			for (uint32_t frame_id : kfs[i].frame_id)
+			{
+				frame_id = Native2LE(frame_id);
+				os.write(reinterpret_cast<char*>(&frame_id), sizeof(frame_id));
+			}
+			for (uint16_t key : kfs[i].keys)
+			{
+				key = Native2LE(key);
+				os.write(reinterpret_cast<char*>(&key), sizeof(key));
+			}
+		}
+	}
+
 	void WriteBBKeyFramesChunk(std::vector<std::shared_ptr<AABBKeyFrameSet>> const & frame_pos_bbs, std::ostream& os)
 	{
 		for (size_t i = 0; i < frame_pos_bbs.size(); ++ i)
@@ -1876,6 +2446,30 @@ namespace KlayGE
 		}
 	}
 
+	void WriteClustersChunk(std::vector<std::vector<MeshCluster>> const & mesh_clusters, std::ostream& os)
+	{
+		for (auto const & clusters : mesh_clusters)
+		{
+			uint32_t num_clusters = Native2LE(static_cast<uint32_t>(clusters.size()));
+			os.write(reinterpret_cast<char*>(&num_clusters), sizeof(num_clusters));
+
+			for (auto cluster : clusters)
+			{
+				cluster.start_index = Native2LE(cluster.start_index);
+				cluster.num_indices = Native2LE(cluster.num_indices);
+				cluster.center.x() = Native2LE(cluster.center.x());
+				cluster.center.y() = Native2LE(cluster.center.y());
+				cluster.center.z() = Native2LE(cluster.center.z());
+				cluster.radius = Native2LE(cluster.radius);
+				cluster.cone_axis.x() = Native2LE(cluster.cone_axis.x());
+				cluster.cone_axis.y() = Native2LE(cluster.cone_axis.y());
+				cluster.cone_axis.z() = Native2LE(cluster.cone_axis.z());
+				cluster.cone_cutoff = Native2LE(cluster.cone_cutoff);
+				os.write(reinterpret_cast<char*>(&cluster), sizeof(cluster));
+			}
+		}
+	}
+
 	void SaveModel(std::string const & jit_name, std::vector<RenderMaterialPtr> const & mtls,
 		std::vector<VertexElement> const & merged_ves, char all_is_index_16_bit,
 		std::vector<std::vector<uint8_t>> const & merged_buffs, std::vector<uint8_t> const & merged_indices,
@@ -1883,11 +2477,16 @@ namespace KlayGE
 		std::vector<AABBox> const & pos_bbs, std::vector<AABBox> const & tc_bbs,
 		std::vector<uint32_t> const & mesh_num_vertices, std::vector<uint32_t> const & mesh_base_vertices,
 		std::vector<uint32_t> const & mesh_num_indices, std::vector<uint32_t> const & mesh_base_indices,
+		std::vector<std::vector<MeshCluster>> const & mesh_clusters,
 		std::vector<SceneNode const *> const & nodes, std::vector<Renderable const *> const & renderables,
 		std::vector<Joint> const & joints, std::shared_ptr<std::vector<AnimationAction>> const & actions,
-		std::shared_ptr<std::vector<KeyFrameSet>> const & kfs, uint32_t num_frames, uint32_t frame_rate,
+		std::shared_ptr<std::vector<KeyFrameSet>> const & kfs,
+		std::shared_ptr<std::vector<CompressedKeyFrameSet>> const & compressed_kfs, uint32_t num_frames, uint32_t frame_rate,
 		std::vector<std::shared_ptr<AABBKeyFrameSet>> const & frame_pos_bbs)
 	{
+		bool const has_compressed_kfs = compressed_kfs && !compressed_kfs->empty();
+		bool const has_kfs = has_compressed_kfs || (kfs && !kfs->empty());
+
 		std::ostringstream ss;
 
 		{
@@ -1903,7 +2502,8 @@ namespace KlayGE
 			uint32_t num_joints = Native2LE(static_cast<uint32_t>(joints.size()));
 			ss.write(reinterpret_cast<char*>(&num_joints), sizeof(num_joints));
 
-			uint32_t num_kfs = Native2LE(kfs ? static_cast<uint32_t>(kfs->size()) : 0);
+			uint32_t num_kfs = Native2LE(has_compressed_kfs ? static_cast<uint32_t>(compressed_kfs->size())
+				: (kfs ? static_cast<uint32_t>(kfs->size()) : 0));
 			ss.write(reinterpret_cast<char*>(&num_kfs), sizeof(num_kfs));
 
 			uint32_t num_actions = Native2LE(actions ? std::max(static_cast<uint32_t>(actions->size()), 1U) : 0);
@@ -1932,18 +2532,27 @@ namespace KlayGE
 			WriteBonesChunk(joints, ss);
 		}
 
-		if (kfs && !kfs->empty())
+		if (has_kfs)
 		{
-			WriteKeyFramesChunk(num_frames, frame_rate, *kfs, ss);
+			if (has_compressed_kfs)
+			{
+				WriteCompressedKeyFramesChunk(num_frames, frame_rate, *compressed_kfs, ss);
+			}
+			else
+			{
+				WriteKeyFramesChunk(num_frames, frame_rate, *kfs, ss);
+			}
 
 			WriteBBKeyFramesChunk(frame_pos_bbs, ss);
 
 			WriteActionsChunk(*actions, ss);
 		}
 
+		WriteClustersChunk(mesh_clusters, ss);
+
 		std::ofstream ofs(jit_name.c_str(), std::ios_base::binary);
 		BOOST_ASSERT(ofs);
-		uint32_t fourcc = Native2LE(MakeFourCC<'K', 'L', 'M', ' '>::value);
+		uint32_t fourcc = Native2LE(MODEL_BIN_FOURCC);
 		ofs.write(reinterpret_cast<char*>(&fourcc), sizeof(fourcc));
 
 		uint32_t ver = Native2LE(MODEL_BIN_VERSION);
@@ -1998,6 +2607,7 @@ namespace KlayGE
 		std::vector<uint32_t> mesh_base_vertices;
 		std::vector<uint32_t> mesh_num_indices;
 		std::vector<uint32_t> mesh_base_indices;
+		std::vector<std::vector<MeshCluster>> mesh_clusters;
 		if (!mesh_names.empty())
 		{
 			{
@@ -2083,6 +2693,7 @@ namespace KlayGE
 					mesh_base_vertices.push_back(mesh.StartVertexLocation(lod));
 					mesh_num_indices.push_back(mesh.NumIndices(lod));
 					mesh_base_indices.push_back(mesh.StartIndexLocation(lod));
+					mesh_clusters.push_back(mesh.Clusters(lod).ToVector());
 				}
 			}
 
@@ -2106,6 +2717,7 @@ namespace KlayGE
 		std::vector<Joint> joints;
 		std::shared_ptr<std::vector<AnimationAction>> actions;
 		std::shared_ptr<std::vector<KeyFrameSet>> kfs;
+		std::shared_ptr<std::vector<CompressedKeyFrameSet>> compressed_kfs;
 		uint32_t num_frame = 0;
 		uint32_t frame_rate = 0;
 		std::vector<std::shared_ptr<AABBKeyFrameSet>> frame_pos_bbs;
@@ -2157,6 +2769,7 @@ namespace KlayGE
 			frame_rate = skinned_model.FrameRate();
 
 			kfs = skinned_model.GetKeyFrameSets();
+			compressed_kfs = skinned_model.GetCompressedKeyFrameSets();
 
 			frame_pos_bbs.resize(mesh_names.size());
 			for (uint32_t mesh_index = 0; mesh_index < mesh_names.size(); ++ mesh_index)
@@ -2168,9 +2781,9 @@ namespace KlayGE
 
 		SaveModel(output_path.string(), mtls, merged_ves, all_is_index_16_bit, merged_buffs, merged_indices,
 			mesh_names, mtl_ids, mesh_lods, pos_bbs, tc_bbs,
-			mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices,
+			mesh_num_vertices, mesh_base_vertices, mesh_num_indices, mesh_base_indices, mesh_clusters,
 			nodes, renderables,
-			joints, actions, kfs, num_frame, frame_rate, frame_pos_bbs);
+			joints, actions, kfs, compressed_kfs, num_frame, frame_rate, frame_pos_bbs);
 
 #if KLAYGE_IS_DEV_PLATFORM
 		if (need_conversion)
@@ -0,0 +1,363 @@
+/**
+ * @file MeshCluster.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include <KlayGE/MeshCluster.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const INVALID_INDEX = 0xFFFFFFFFU;
+
+	float3 TriangleNormal(ArrayRef<float3> positions, uint32_t const * triangle)
+	{
+		float3 const & p0 = positions[triangle[0]];
+		float3 const n = MathLib::cross(positions[triangle[1]] - p0, positions[triangle[2]] - p0);
+		float const len = MathLib::length(n);
+		return (len > 0) ? n / len : float3(0, 0, 0);
+	}
+
+	MeshCluster MakeCluster(ArrayRef<float3> positions, ArrayRef<uint32_t> indices, uint32_t start_index, uint32_t num_indices)
+	{
+		MeshCluster cluster;
+		cluster.start_index = start_index;
+		cluster.num_indices = num_indices;
+
+		float3 min_pos = positions[indices[start_index]];
+		float3 max_pos = min_pos;
+		for (uint32_t i = start_index; i < start_index + num_indices; ++ i)
+		{
+			min_pos = MathLib::minimize(min_pos, positions[indices[i]]);
+			max_pos = MathLib::maximize(max_pos, positions[indices[i]]);
+		}
+		cluster.center = (min_pos + max_pos) * 0.5f;
+
+		float radius_sq = 0;
+		for (uint32_t i = start_index; i < start_index + num_indices; ++ i)
+		{
+			radius_sq = std::max(radius_sq, MathLib::length_sq(positions[indices[i]] - cluster.center));
+		}
+		cluster.radius = std::sqrt(radius_sq);
+
+		float3 axis(0, 0, 0);
+		for (uint32_t i = start_index; i < start_index + num_indices; i += 3)
+		{
+			axis += TriangleNormal(positions, &indices[i]);
+		}
+
+		cluster.cone_axis = float3(0, 0, 0);
+		cluster.cone_cutoff = 1;
+
+		float const axis_len = MathLib::length(axis);
+		if (axis_len > 0)
+		{
+			axis /= axis_len;
+
+			float min_dot = 1;
+			for (uint32_t i = start_index; i < start_index + num_indices; i += 3)
+			{
+				float3 const n = TriangleNormal(positions, &indices[i]);
+				if (MathLib::length_sq(n) > 0)
+				{
+					min_dot = std::min(min_dot, MathLib::dot(n, axis));
+				}
+			}
+
+			// The normals are within asin(cone_cutoff) around the axis. Beyond 90 degrees the cluster is never backfacing.
+			if (min_dot > 0)
+			{
+				cluster.cone_axis = axis;
+				cluster.cone_cutoff = std::sqrt(1 - min_dot * min_dot);
+			}
+		}
+
+		return cluster;
+	}
+}
+
+namespace KlayGE
+{
+	std::vector<MeshCluster> BuildMeshClusters(ArrayRef<float3> positions, std::vector<uint32_t>& indices,
+		uint32_t max_triangles)
+	{
+		BOOST_ASSERT(max_triangles > 0);
+
+		uint32_t const num_vertices = static_cast<uint32_t>(positions.size());
+		uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+
+		// Triangles around every vertex, packed in one array
+		std::vector<uint32_t> vertex_tri_offsets(num_vertices + 1, 0);
+		for (auto const index : indices)
+		{
+			BOOST_ASSERT(index < num_vertices);
+			++ vertex_tri_offsets[index + 1];
+		}
+		std::partial_sum(vertex_tri_offsets.begin(), vertex_tri_offsets.end(), vertex_tri_offsets.begin());
+		std::vector<uint32_t> vertex_tris(indices.size());
+		{
+			std::vector<uint32_t> fill(vertex_tri_offsets.begin(), vertex_tri_offsets.end() - 1);
+			for (uint32_t i = 0; i < indices.size(); ++ i)
+			{
+				vertex_tris[fill[indices[i]]] = i / 3;
+				++ fill[indices[i]];
+			}
+		}
+
+		std::vector<float3> tri_normals(num_triangles);
+		std::vector<float3> tri_centroids(num_triangles);
+		for (uint32_t i = 0; i < num_triangles; ++ i)
+		{
+			tri_normals[i] = TriangleNormal(positions, &indices[i * 3]);
+			tri_centroids[i] = (positions[indices[i * 3 + 0]] + positions[indices[i * 3 + 1]] + positions[indices[i * 3 + 2]])
+				/ 3.0f;
+		}
+
+		std::vector<uint32_t> tri_cluster(num_triangles, INVALID_INDEX);
+		std::vector<uint32_t> candidate_cluster(num_triangles, INVALID_INDEX);
+		std::vector<uint32_t> vertex_cluster(num_vertices, INVALID_INDEX);
+
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> cluster_tris;
+		cluster_tris.reserve(max_triangles);
+
+		std::vector<uint32_t> new_indices;
+		new_indices.reserve(indices.size());
+		std::vector<MeshCluster> clusters;
+
+		uint32_t seed = 0;
+		for (;;)
+		{
+			while ((seed < num_triangles) && (tri_cluster[seed] != INVALID_INDEX))
+			{
+				++ seed;
+			}
+			if (seed == num_triangles)
+			{
+				break;
+			}
+
+			uint32_t const cluster_id = static_cast<uint32_t>(clusters.size());
+			cluster_tris.clear();
+			candidates.clear();
+
+			float3 normal_sum(0, 0, 0);
+			float3 centroid_sum(0, 0, 0);
+			float3 min_pos = positions[indices[seed * 3]];
+			float3 max_pos = min_pos;
+
+			auto add_triangle = [&](uint32_t tri)
+			{
+				tri_cluster[tri] = cluster_id;
+				cluster_tris.push_back(tri);
+				normal_sum += tri_normals[tri];
+				centroid_sum += tri_centroids[tri];
+
+				for (uint32_t v = 0; v < 3; ++ v)
+				{
+					uint32_t const vertex = indices[tri * 3 + v];
+					min_pos = MathLib::minimize(min_pos, positions[vertex]);
+					max_pos = MathLib::maximize(max_pos, positions[vertex]);
+
+					if (vertex_cluster[vertex] != cluster_id)
+					{
+						vertex_cluster[vertex] = cluster_id;
+						for (uint32_t i = vertex_tri_offsets[vertex]; i < vertex_tri_offsets[vertex + 1]; ++ i)
+						{
+							uint32_t const adj_tri = vertex_tris[i];
+							if ((tri_cluster[adj_tri] == INVALID_INDEX) && (candidate_cluster[adj_tri] != cluster_id))
+							{
+								candidate_cluster[adj_tri] = cluster_id;
+								candidates.push_back(adj_tri);
+							}
+						}
+					}
+				}
+			};
+
+			add_triangle(seed);
+			uint32_t next_seed = seed + 1;
+			while (cluster_tris.size() < max_triangles)
+			{
+				float3 const center = centroid_sum / static_cast<float>(cluster_tris.size());
+				float const normal_len = MathLib::length(normal_sum);
+				float3 const axis = (normal_len > 0) ? normal_sum / normal_len : float3(0, 0, 0);
+				float const radius = std::max(MathLib::length(max_pos - min_pos) * 0.5f, 1e-20f);
+
+				// Grow towards triangles that add few vertices, face the same way and are close to the cluster
+				uint32_t best_tri = INVALID_INDEX;
+				float best_score = std::numeric_limits<float>::max();
+				for (size_t i = 0; i < candidates.size();)
+				{
+					uint32_t const tri = candidates[i];
+					if (tri_cluster[tri] != INVALID_INDEX)
+					{
+						candidates[i] = candidates.back();
+						candidates.pop_back();
+						continue;
+					}
+
+					uint32_t num_shared = 0;
+					for (uint32_t v = 0; v < 3; ++ v)
+					{
+						if (vertex_cluster[indices[tri * 3 + v]] == cluster_id)
+						{
+							++ num_shared;
+						}
+					}
+
+					float const score = (3 - num_shared) + (1 - MathLib::dot(tri_normals[tri], axis))
+						+ MathLib::length(tri_centroids[tri] - center) / radius;
+					if (score < best_score)
+					{
+						best_score = score;
+						best_tri = tri;
+					}
+
+					++ i;
+				}
+
+				if (best_tri == INVALID_INDEX)
+				{
+					// Disconnected pieces join the cluster only when they are nearby
+					while ((next_seed < num_triangles) && (tri_cluster[next_seed] != INVALID_INDEX))
+					{
+						++ next_seed;
+					}
+					if ((next_seed < num_triangles) && (MathLib::length(tri_centroids[next_seed] - center) <= radius * 2))
+					{
+						best_tri = next_seed;
+					}
+					else
+					{
+						break;
+					}
+				}
+
+				add_triangle(best_tri);
+			}
+
+			std::sort(cluster_tris.begin(), cluster_tris.end());
+
+			uint32_t const start_index = static_cast<uint32_t>(new_indices.size());
+			for (auto const tri : cluster_tris)
+			{
+				new_indices.insert(new_indices.end(), &indices[tri * 3], &indices[tri * 3] + 3);
+			}
+			clusters.push_back(MakeCluster(positions, new_indices, start_index, static_cast<uint32_t>(cluster_tris.size() * 3)));
+		}
+
+		indices.swap(new_indices);
+
+		return clusters;
+	}
+
+
+	MeshClusterCuller::MeshClusterCuller()
+		: eye_pos_(0, 0, 0)
+	{
+		std::memset(&stats_, 0, sizeof(stats_));
+	}
+
+	void MeshClusterCuller::BeginFrame(Frustum const & frustum, float3 const & eye_pos)
+	{
+		frustum_ = frustum;
+		eye_pos_ = eye_pos;
+		std::memset(&stats_, 0, sizeof(stats_));
+	}
+
+	uint32_t MeshClusterCuller::Cull(ArrayRef<MeshCluster> clusters, uint32_t start_index_location, float4x4 const & model,
+		bool backface_culling, std::vector<IndexRange>& ranges)
+	{
+		float3 const x_axis(model(0, 0), model(0, 1), model(0, 2));
+		float3 const y_axis(model(1, 0), model(1, 1), model(1, 2));
+		float3 const z_axis(model(2, 0), model(2, 1), model(2, 2));
+		float const scale_x = MathLib::length(x_axis);
+		float const scale_y = MathLib::length(y_axis);
+		float const scale_z = MathLib::length(z_axis);
+		float const max_scale = std::max(std::max(scale_x, scale_y), scale_z);
+		float const min_scale = std::min(std::min(scale_x, scale_y), scale_z);
+
+		// Normal cones don't survive non-uniform scales, and reflections swap the front faces
+		bool const cone_test = backface_culling && (max_scale - min_scale <= max_scale * 1e-3f)
+			&& (MathLib::dot(MathLib::cross(x_axis, y_axis), z_axis) > 0);
+
+		size_t const first_range = ranges.size();
+		uint32_t num_visible_triangles = 0;
+		for (auto const & cluster : clusters)
+		{
+			uint32_t const num_triangles = cluster.num_indices / 3;
+			++ stats_.num_clusters;
+			stats_.num_triangles += num_triangles;
+
+			float3 const center = MathLib::transform_coord(cluster.center, model);
+			float const radius = cluster.radius * max_scale;
+			if (frustum_.Intersect(Sphere(center, radius)) == BO_No)
+			{
+				++ stats_.num_frustum_culled;
+				stats_.num_triangles_culled += num_triangles;
+				continue;
+			}
+
+			if (cone_test && (cluster.cone_cutoff < 1))
+			{
+				float3 const axis = MathLib::transform_normal(cluster.cone_axis, model) / max_scale;
+				float3 const dir = center - eye_pos_;
+				if (MathLib::dot(dir, axis) > cluster.cone_cutoff * MathLib::length(dir) + radius)
+				{
+					++ stats_.num_backface_culled;
+					stats_.num_triangles_culled += num_triangles;
+					continue;
+				}
+			}
+
+			uint32_t const start_index = start_index_location + cluster.start_index;
+			if ((ranges.size() > first_range) && (ranges.back().start_index + ranges.back().num_indices == start_index))
+			{
+				ranges.back().num_indices += cluster.num_indices;
+			}
+			else
+			{
+				ranges.push_back({ start_index, cluster.num_indices });
+			}
+			num_visible_triangles += num_triangles;
+		}
+
+		return num_visible_triangles;
+	}
+}
@@ -39,13 +39,21 @@
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/Camera.hpp>
 #include <KlayGE/ResLoader.hpp>
+#include <KlayGE/SceneManager.hpp>
 #include <KFL/XMLDom.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/Thread.hpp>
 
+#include <cstring>
 #include <fstream>
 #include <string>
 
+#if defined(KLAYGE_SSE_SUPPORT)
+	#include <emmintrin.h>
+#endif
+
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
@@ -57,6 +65,105 @@ namespace
 
 	uint32_t const NUM_PARTICLES = 4096;
 
+	// Systems with more alive particles than this split their updater pass across the thread pool
+	uint32_t const PARALLEL_UPDATE_THRESHOLD = 32 * 1024;
+	uint32_t const MIN_PARTICLES_PER_TASK = 16 * 1024;
+
+	uint32_t NumUpdateThreads()
+	{
+		static uint32_t const num_threads = std::max(CPUInfo().NumHWThreads(), 1);
+		return num_threads;
+	}
+
+	// Maps a float to an uint32_t whose unsigned order is the reverse of the float order
+	uint32_t DescendingFloatKey(float f)
+	{
+		uint32_t u;
+		std::memcpy(&u, &f, sizeof(u));
+		u = (u & 0x80000000U) ? ~u : (u | 0x80000000U);
+		return ~u;
+	}
+
+	// LSD radix sort, 3 passes of 11 bits. Sorts indices so that keys are in descending order.
+	// scratch is resized to hold the ping-pong key and index buffers.
+	void RadixSortDescending(float const * keys, uint32_t num, std::vector<uint32_t>& indices, std::vector<uint32_t>& scratch)
+	{
+		uint32_t const RADIX_BITS = 11;
+		uint32_t const RADIX_SIZE = 1UL << RADIX_BITS;
+		uint32_t const RADIX_MASK = RADIX_SIZE - 1;
+		uint32_t const NUM_PASSES = 3;
+
+		indices.resize(num);
+		scratch.resize(num * 3);
+		uint32_t* src_keys = &scratch[0];
+		uint32_t* dst_keys = &scratch[num];
+		uint32_t* src_indices = indices.data();
+		uint32_t* dst_indices = &scratch[num * 2];
+
+		std::vector<uint32_t> histograms(RADIX_SIZE * NUM_PASSES, 0);
+		for (uint32_t i = 0; i < num; ++ i)
+		{
+			uint32_t const key = DescendingFloatKey(keys[i]);
+			src_keys[i] = key;
+			src_indices[i] = i;
+			for (uint32_t pass = 0; pass < NUM_PASSES; ++ pass)
+			{
+				++ histograms[pass * RADIX_SIZE + ((key >> (pass * RADIX_BITS)) & RADIX_MASK)];
+			}
+		}
+
+		for (uint32_t pass = 0; pass < NUM_PASSES; ++ pass)
+		{
+			uint32_t* histogram = &histograms[pass * RADIX_SIZE];
+			uint32_t const shift = pass * RADIX_BITS;
+
+			// All keys fall into one bucket, this pass wouldn't change the order
+			if (histogram[(src_keys[0] >> shift) & RADIX_MASK] == num)
+			{
+				continue;
+			}
+
+			uint32_t sum = 0;
+			for (uint32_t i = 0; i < RADIX_SIZE; ++ i)
+			{
+				uint32_t const count = histogram[i];
+				histogram[i] = sum;
+				sum += count;
+			}
+
+			for (uint32_t i = 0; i < num; ++ i)
+			{
+				uint32_t const dst = histogram[(src_keys[i] >> shift) & RADIX_MASK] ++;
+				dst_keys[dst] = src_keys[i];
+				dst_indices[dst] = src_indices[i];
+			}
+
+			std::swap(src_keys, dst_keys);
+			std::swap(src_indices, dst_indices);
+		}
+
+		if (src_indices != indices.data())
+		{
+			std::memcpy(indices.data(), src_indices, num * sizeof(uint32_t));
+		}
+	}
+
+	float EvalPolyline(std::vector<float2> const & curve, float pos)
+	{
+		float ret = curve.back().y();
+		for (auto iter = std::next(curve.begin()); iter != curve.end(); ++ iter)
+		{
+			if (iter->x() >= pos)
+			{
+				float2 const & prev = *std::prev(iter);
+				float const s = (pos - prev.x()) / (iter->x() - prev.x());
+				ret = MathLib::lerp(prev.y(), iter->y(), s);
+				break;
+			}
+		}
+		return ret;
+	}
+
 	class ParticleSystemLoadingDesc : public ResLoadingDesc
 	{
 	private:
@@ -121,7 +228,7 @@ namespace
 				return;
 			}
 
-			ResIdentifierPtr psmm_input = ResLoader::Instance().Open(ps_desc_.res_name);
+			ResIdentifierPtr psmm_input = ResLoader::Instance().OpenXML(ps_desc_.res_name);
 
 			KlayGE::XMLDocument doc;
 			XMLNodePtr root = doc.Parse(psmm_input);
@@ -597,6 +704,91 @@ namespace KlayGE
 	}
 
 
+	ParticleSoA::ParticleSoA(uint32_t capacity)
+		: capacity_(capacity), stride_((capacity + 3) & ~3U), num_alive_(0),
+			data_(static_cast<size_t>(stride_) * PST_NumStreams, 0.0f)
+	{
+	}
+
+	uint32_t ParticleSoA::Allocate(uint32_t num)
+	{
+		uint32_t const allocated = std::min(num, capacity_ - num_alive_);
+		num_alive_ += allocated;
+		return allocated;
+	}
+
+	void ParticleSoA::Compact()
+	{
+		float const * life = &data_[PST_Life * stride_];
+
+		uint32_t dst = 0;
+		while ((dst < num_alive_) && (life[dst] > 0))
+		{
+			++ dst;
+		}
+
+		for (uint32_t src = dst + 1; src < num_alive_; ++ src)
+		{
+			if (life[src] > 0)
+			{
+				for (uint32_t s = 0; s < PST_NumStreams; ++ s)
+				{
+					float* stream = &data_[s * stride_];
+					stream[dst] = stream[src];
+				}
+				++ dst;
+			}
+		}
+
+		num_alive_ = dst;
+	}
+
+	Particle ParticleSoA::Get(uint32_t index) const
+	{
+		BOOST_ASSERT(index < capacity_);
+
+		Particle par;
+		par.pos = float3(data_[PST_PosX * stride_ + index], data_[PST_PosY * stride_ + index], data_[PST_PosZ * stride_ + index]);
+		par.vel = float3(data_[PST_VelX * stride_ + index], data_[PST_VelY * stride_ + index], data_[PST_VelZ * stride_ + index]);
+		par.life = data_[PST_Life * stride_ + index];
+		par.spin = data_[PST_Spin * stride_ + index];
+		par.size = data_[PST_Size * stride_ + index];
+		par.alpha = data_[PST_Alpha * stride_ + index];
+		par.init_life = data_[PST_InitLife * stride_ + index];
+		return par;
+	}
+
+	void ParticleSoA::Set(uint32_t index, Particle const & par)
+	{
+		BOOST_ASSERT(index < capacity_);
+
+		data_[PST_PosX * stride_ + index] = par.pos.x();
+		data_[PST_PosY * stride_ + index] = par.pos.y();
+		data_[PST_PosZ * stride_ + index] = par.pos.z();
+		data_[PST_VelX * stride_ + index] = par.vel.x();
+		data_[PST_VelY * stride_ + index] = par.vel.y();
+		data_[PST_VelZ * stride_ + index] = par.vel.z();
+		data_[PST_Life * stride_ + index] = par.life;
+		data_[PST_Spin * stride_ + index] = par.spin;
+		data_[PST_Size * stride_ + index] = par.size;
+		data_[PST_Alpha * stride_ + index] = par.alpha;
+		data_[PST_InitLife * stride_ + index] = par.init_life;
+	}
+
+	ParticleSpan ParticleSoA::Span(uint32_t offset, uint32_t count)
+	{
+		BOOST_ASSERT(offset + count <= capacity_);
+
+		ParticleSpan ret;
+		for (uint32_t i = 0; i < PST_NumStreams; ++ i)
+		{
+			ret.streams[i] = &data_[i * stride_ + offset];
+		}
+		ret.num = count;
+		return ret;
+	}
+
+
 	ParticleSystem::ParticleSystem(uint32_t max_num_particles, bool sort_particles)
 		: root_node_(MakeSharedPtr<SceneNode>(L"ParticleSystemRootNode", SceneNode::SOA_Moveable | SceneNode::SOA_NotCastShadow)),
 			particles_(max_num_particles),
@@ -628,17 +820,10 @@ namespace KlayGE
 			{
 				KFL_UNUSED(node);
 				KFL_UNUSED(app_time);
+				KFL_UNUSED(elapsed_time);
 
-				std::lock_guard<std::mutex> lock(actived_particles_mutex_);
-
-				this->UpdateParticlesNoLock(elapsed_time);
-
-				auto& rf = Context::Instance().RenderFactoryInstance();
-				auto const& caps = rf.RenderEngineInstance().DeviceCaps();
-				if (caps.arbitrary_multithread_rendering_support)
-				{
-					this->UpdateParticleBufferNoLock();
-				}
+				// Updated together with the other systems in the scene once the traversal is done
+				Context::Instance().SceneManagerInstance().QueueParticleSystemUpdate(this->shared_from_this());
 			});
 	}
 
@@ -747,109 +932,147 @@ namespace KlayGE
 	uint32_t ParticleSystem::GetActiveParticleIndex(uint32_t i) const
 	{
 		std::lock_guard<std::mutex> lock(actived_particles_mutex_);
-		return actived_particles_[i].first;
+		return actived_particles_[i];
 	}
 
 	void ParticleSystem::ClearParticles()
 	{
-		for (auto& particle : particles_)
-		{
-			particle.life = 0;
-		}
+		particles_.Clear();
 	}
 
-	void ParticleSystem::UpdateParticlesNoLock(float elapsed_time)
+	void ParticleSystem::Update(float elapsed_time)
 	{
-		auto emitter_iter = emitters_.begin();
-		uint32_t new_particle = (*emitter_iter)->Update(elapsed_time);
-
-		auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
-		auto const& camera = *re.DefaultFrameBuffer()->GetViewport()->camera;
-		float4x4 const& view_mat = camera.ViewMatrix();
-
-		actived_particles_.clear();
+		std::lock_guard<std::mutex> lock(actived_particles_mutex_);
 
-		float3 min_bb(+1e10f, +1e10f, +1e10f);
-		float3 max_bb(-1e10f, -1e10f, -1e10f);
+		this->UpdateParticlesNoLock(elapsed_time);
 
-		for (auto const & updater : updaters_)
+		auto& rf = Context::Instance().RenderFactoryInstance();
+		auto const& caps = rf.RenderEngineInstance().DeviceCaps();
+		if (caps.arbitrary_multithread_rendering_support)
 		{
-			updater->SnapParams();
+			this->UpdateParticleBufferNoLock();
 		}
+	}
 
-		for (uint32_t i = 0; i < particles_.size(); ++ i)
+	void ParticleSystem::RunUpdatersNoLock(ParticleSpan const & particles, float elapsed_time)
+	{
+		if (updaters_.empty() || (particles.num == 0))
 		{
-			Particle& particle = particles_[i];
+			return;
+		}
 
-			if (particle.life > 0)
+		auto update_span = [this, elapsed_time](ParticleSpan const & span)
 			{
 				for (auto const & updater : updaters_)
 				{
-					updater->Update(particle, elapsed_time);
+					updater->Update(span, elapsed_time);
 				}
-			}
-			else
+			};
+
+		uint32_t const num_tasks = (particles.num < PARALLEL_UPDATE_THRESHOLD) ? 1
+			: std::min(NumUpdateThreads(), particles.num / MIN_PARTICLES_PER_TASK);
+		if (num_tasks <= 1)
+		{
+			update_span(particles);
+		}
+		else
+		{
+			// Keep every task 4-particle aligned so the SIMD kernels see whole batches
+			uint32_t const particles_per_task = ((particles.num + num_tasks - 1) / num_tasks + 3) & ~3U;
+
+			auto& tp = Context::Instance().ThreadPool();
+			std::vector<joiner<void>> joiners;
+			joiners.reserve(num_tasks - 1);
+			for (uint32_t i = 1; i < num_tasks; ++ i)
 			{
-				if (new_particle > 0)
-				{
-					(*emitter_iter)->Emit(particle);
-					for (auto const & updater : updaters_)
-					{
-						updater->Update(particle, 0);
-					}
-					-- new_particle;
-				}
-				else
+				uint32_t const offset = i * particles_per_task;
+				if (offset < particles.num)
 				{
-					if (emitter_iter != emitters_.end())
-					{
-						++ emitter_iter;
-						if (emitter_iter != emitters_.end())
-						{
-							new_particle = (*emitter_iter)->Update(elapsed_time);
-						}
-					}
+					ParticleSpan const span = particles.SubSpan(offset, std::min(particles_per_task, particles.num - offset));
+					joiners.push_back(tp([&update_span, span] { update_span(span); }));
 				}
 			}
+			update_span(particles.SubSpan(0, std::min(particles_per_task, particles.num)));
 
-			if (particle.life > 0)
+			for (auto& joiner : joiners)
 			{
-				float3 const & pos = particle.pos;
-
-				float depth_es;
-				if (sort_particles_)
-				{
-					float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
-					float4 const z_row = view_mat.Col(2);
-					float4 const w_row = view_mat.Col(3);
+				joiner();
+			}
+		}
+	}
 
-					depth_es = MathLib::dot(pos4, z_row) / MathLib::dot(pos4, w_row);
-				}
-				else
-				{
-					depth_es = 0;
-				}
+	void ParticleSystem::UpdateParticlesNoLock(float elapsed_time)
+	{
+		for (auto const & updater : updaters_)
+		{
+			updater->SnapParams();
+		}
 
-				actived_particles_.emplace_back(i, depth_es);
+		this->RunUpdatersNoLock(particles_.AliveSpan(), elapsed_time);
+		particles_.Compact();
 
-				min_bb = MathLib::minimize(min_bb, pos);
-				max_bb = MathLib::maximize(min_bb, pos);
+		uint32_t const first_new_particle = particles_.NumAlive();
+		for (auto const & emitter : emitters_)
+		{
+			uint32_t const first = particles_.NumAlive();
+			uint32_t const num_new_particles = particles_.Allocate(emitter->Update(elapsed_time));
+			for (uint32_t i = 0; i < num_new_particles; ++ i)
+			{
+				Particle par;
+				emitter->Emit(par);
+				particles_.Set(first + i, par);
 			}
 		}
+		this->RunUpdatersNoLock(particles_.Span(first_new_particle, particles_.NumAlive() - first_new_particle), 0);
 
-		if (!actived_particles_.empty())
+		uint32_t const num_alive = particles_.NumAlive();
+		if (num_alive == 0)
+		{
+			actived_particles_.clear();
+			return;
+		}
+
+		float const * pos_x = particles_.Stream(PST_PosX);
+		float const * pos_y = particles_.Stream(PST_PosY);
+		float const * pos_z = particles_.Stream(PST_PosZ);
+
+		float3 min_bb(+1e10f, +1e10f, +1e10f);
+		float3 max_bb(-1e10f, -1e10f, -1e10f);
+		for (uint32_t i = 0; i < num_alive; ++ i)
 		{
-			if (sort_particles_)
+			float3 const pos(pos_x[i], pos_y[i], pos_z[i]);
+			min_bb = MathLib::minimize(min_bb, pos);
+			max_bb = MathLib::maximize(max_bb, pos);
+		}
+
+		if (sort_particles_)
+		{
+			auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			auto const& camera = *re.DefaultFrameBuffer()->GetViewport()->camera;
+			float4x4 const& view_mat = camera.ViewMatrix();
+			float4 const z_col = view_mat.Col(2);
+			float4 const w_col = view_mat.Col(3);
+
+			depth_keys_.resize(num_alive);
+			for (uint32_t i = 0; i < num_alive; ++ i)
 			{
-				std::sort(actived_particles_.begin(), actived_particles_.end(),
-					[](std::pair<uint32_t, float> const & lhs, std::pair<uint32_t, float> const & rhs)
-					{
-						return lhs.second > rhs.second;
-					});
+				float const z = pos_x[i] * z_col.x() + pos_y[i] * z_col.y() + pos_z[i] * z_col.z() + z_col.w();
+				float const w = pos_x[i] * w_col.x() + pos_y[i] * w_col.y() + pos_z[i] * w_col.z() + w_col.w();
+				depth_keys_[i] = z / w;
 			}
 
-			checked_cast<RenderParticles&>(*render_particles_).PosBound(AABBox(min_bb, max_bb));
+			RadixSortDescending(depth_keys_.data(), num_alive, actived_particles_, sort_scratch_);
+		}
+		else
+		{
+			actived_particles_.resize(num_alive);
+			for (uint32_t i = 0; i < num_alive; ++ i)
+			{
+				actived_particles_[i] = i;
+			}
 		}
+
+		checked_cast<RenderParticles&>(*render_particles_).PosBound(AABBox(min_bb, max_bb));
 	}
 
 	void ParticleSystem::UpdateParticleBufferNoLock()
@@ -899,17 +1122,26 @@ namespace KlayGE
 			}
 
 			{
+				float const * pos_x = particles_.Stream(PST_PosX);
+				float const * pos_y = particles_.Stream(PST_PosY);
+				float const * pos_z = particles_.Stream(PST_PosZ);
+				float const * life = particles_.Stream(PST_Life);
+				float const * spin = particles_.Stream(PST_Spin);
+				float const * size = particles_.Stream(PST_Size);
+				float const * alpha = particles_.Stream(PST_Alpha);
+				float const * init_life = particles_.Stream(PST_InitLife);
+
 				GraphicsBuffer::Mapper mapper(*instance_gb, BA_Write_Only);
 				ParticleInstance* instance_data = mapper.Pointer<ParticleInstance>();
 				for (uint32_t i = 0; i < num_active_particles; ++ i, ++ instance_data)
 				{
-					Particle const & par = particles_[actived_particles_[i].first];
-					instance_data->pos = par.pos;
-					instance_data->life = par.life;
-					instance_data->spin = par.spin;
-					instance_data->size = par.size;
-					instance_data->life_factor = (par.init_life - par.life) / par.init_life;
-					instance_data->alpha = par.alpha;
+					uint32_t const index = actived_particles_[i];
+					instance_data->pos = float3(pos_x[index], pos_y[index], pos_z[index]);
+					instance_data->life = life[index];
+					instance_data->spin = spin[index];
+					instance_data->size = size[index];
+					instance_data->life_factor = (init_life[index] - life[index]) / init_life[index];
+					instance_data->alpha = alpha[index];
 				}
 			}
 		}
@@ -945,6 +1177,29 @@ namespace KlayGE
 	}
 
 
+	void UpdateParticleSystems(ArrayRef<ParticleSystemPtr> systems, float elapsed_time)
+	{
+		if (systems.empty())
+		{
+			return;
+		}
+
+		auto& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void>> joiners;
+		joiners.reserve(systems.size() - 1);
+		for (size_t i = 1; i < systems.size(); ++ i)
+		{
+			ParticleSystem* ps = systems[i].get();
+			joiners.push_back(tp([ps, elapsed_time] { ps->Update(elapsed_time); }));
+		}
+		systems[0]->Update(elapsed_time);
+
+		for (auto& joiner : joiners)
+		{
+			joiner();
+		}
+	}
+
 	ParticleSystemPtr SyncLoadParticleSystem(std::string_view psml_name)
 	{
 		return ResLoader::Instance().SyncQueryT<ParticleSystem>(MakeSharedPtr<ParticleSystemLoadingDesc>(psml_name));
@@ -1156,7 +1411,9 @@ namespace KlayGE
 
 
 	PolylineParticleUpdater::PolylineParticleUpdater(ParticleSystemPtr const& ps)
-		: ParticleUpdater(ps)
+		: ParticleUpdater(ps),
+			curves_dirty_(true),
+			this_frame_force_(0, 0, 0), this_frame_gravity_(0), this_frame_buoyancy_factor_(0)
 	{
 	}
 
@@ -1176,67 +1433,152 @@ namespace KlayGE
 		return ret;
 	}
 
-	void PolylineParticleUpdater::Update(Particle& par, float elapse_time)
+	void PolylineParticleUpdater::Update(ParticleSpan const & particles, float elapse_time)
 	{
-		BOOST_ASSERT(!this_frame_size_over_life_.empty());
-		BOOST_ASSERT(!this_frame_mass_over_life_.empty());
-		BOOST_ASSERT(!this_frame_opacity_over_life_.empty());
-
-		float pos = (par.init_life - par.life) / par.init_life;
-
-		float cur_size = this_frame_size_over_life_.back().y();
-		for (auto iter = std::next(this_frame_size_over_life_.begin()); iter != this_frame_size_over_life_.end(); ++ iter)
+		BOOST_ASSERT(this_frame_curve_lut_.size() == LUT_SIZE + 1);
+
+		float* pos_x = particles.Stream(PST_PosX);
+		float* pos_y = particles.Stream(PST_PosY);
+		float* pos_z = particles.Stream(PST_PosZ);
+		float* vel_x = particles.Stream(PST_VelX);
+		float* vel_y = particles.Stream(PST_VelY);
+		float* vel_z = particles.Stream(PST_VelZ);
+		float* life = particles.Stream(PST_Life);
+		float* spin = particles.Stream(PST_Spin);
+		float* size = particles.Stream(PST_Size);
+		float* alpha = particles.Stream(PST_Alpha);
+		float const * init_life = particles.Stream(PST_InitLife);
+
+		float4 const * lut = this_frame_curve_lut_.data();
+
+		uint32_t i = 0;
+#if defined(KLAYGE_SSE_SUPPORT)
 		{
-			if (iter->x() >= pos)
+			__m128 const zero = _mm_setzero_ps();
+			__m128 const one = _mm_set1_ps(1.0f);
+			__m128 const lut_scale = _mm_set1_ps(static_cast<float>(LUT_SIZE - 1));
+			__m128 const dt = _mm_set1_ps(elapse_time);
+			__m128 const spin_inc = _mm_set1_ps(0.001f);
+			__m128 const force_x = _mm_set1_ps(this_frame_force_.x());
+			__m128 const force_y = _mm_set1_ps(this_frame_force_.y());
+			__m128 const force_z = _mm_set1_ps(this_frame_force_.z());
+			__m128 const gravity = _mm_set1_ps(this_frame_gravity_);
+			__m128 const buoyancy_factor = _mm_set1_ps(this_frame_buoyancy_factor_);
+
+			for (; i + 4 <= particles.num; i += 4)
 			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_size = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
+				__m128 const cur_life = _mm_loadu_ps(life + i);
+				__m128 const cur_init_life = _mm_loadu_ps(init_life + i);
+
+				// Normalized age, NaN from a zero init life is flushed to 0 by max
+				__m128 t = _mm_div_ps(_mm_sub_ps(cur_init_life, cur_life), cur_init_life);
+				t = _mm_min_ps(_mm_max_ps(t, zero), one);
+				__m128 const fidx = _mm_mul_ps(t, lut_scale);
+				__m128i const idx = _mm_cvttps_epi32(fidx);
+				__m128 const frac = _mm_sub_ps(fidx, _mm_cvtepi32_ps(idx));
+
+				alignas(16) int32_t idx_arr[4];
+				_mm_store_si128(reinterpret_cast<__m128i*>(idx_arr), idx);
+
+				// Each lane loads one interleaved {size, mass, opacity} sample, then transpose to SoA
+				__m128 s0 = _mm_load_ps(&lut[idx_arr[0]].x());
+				__m128 s1 = _mm_load_ps(&lut[idx_arr[1]].x());
+				__m128 s2 = _mm_load_ps(&lut[idx_arr[2]].x());
+				__m128 s3 = _mm_load_ps(&lut[idx_arr[3]].x());
+				s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&lut[idx_arr[0] + 1].x()), s0),
+					_mm_shuffle_ps(frac, frac, _MM_SHUFFLE(0, 0, 0, 0))));
+				s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&lut[idx_arr[1] + 1].x()), s1),
+					_mm_shuffle_ps(frac, frac, _MM_SHUFFLE(1, 1, 1, 1))));
+				s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&lut[idx_arr[2] + 1].x()), s2),
+					_mm_shuffle_ps(frac, frac, _MM_SHUFFLE(2, 2, 2, 2))));
+				s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&lut[idx_arr[3] + 1].x()), s3),
+					_mm_shuffle_ps(frac, frac, _MM_SHUFFLE(3, 3, 3, 3))));
+				_MM_TRANSPOSE4_PS(s0, s1, s2, s3);
+				__m128 const cur_size = s0;
+				__m128 const cur_mass = s1;
+				__m128 const cur_alpha = s2;
+
+				__m128 const buoyancy = _mm_mul_ps(buoyancy_factor, _mm_mul_ps(cur_size, _mm_mul_ps(cur_size, cur_size)));
+				__m128 const inv_mass = _mm_div_ps(one, cur_mass);
+				__m128 const accel_x = _mm_mul_ps(force_x, inv_mass);
+				__m128 const accel_y = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(force_y, buoyancy), inv_mass), gravity);
+				__m128 const accel_z = _mm_mul_ps(force_z, inv_mass);
+
+				__m128 const vx = _mm_add_ps(_mm_loadu_ps(vel_x + i), _mm_mul_ps(accel_x, dt));
+				__m128 const vy = _mm_add_ps(_mm_loadu_ps(vel_y + i), _mm_mul_ps(accel_y, dt));
+				__m128 const vz = _mm_add_ps(_mm_loadu_ps(vel_z + i), _mm_mul_ps(accel_z, dt));
+				_mm_storeu_ps(vel_x + i, vx);
+				_mm_storeu_ps(vel_y + i, vy);
+				_mm_storeu_ps(vel_z + i, vz);
+				_mm_storeu_ps(pos_x + i, _mm_add_ps(_mm_loadu_ps(pos_x + i), _mm_mul_ps(vx, dt)));
+				_mm_storeu_ps(pos_y + i, _mm_add_ps(_mm_loadu_ps(pos_y + i), _mm_mul_ps(vy, dt)));
+				_mm_storeu_ps(pos_z + i, _mm_add_ps(_mm_loadu_ps(pos_z + i), _mm_mul_ps(vz, dt)));
+				_mm_storeu_ps(life + i, _mm_sub_ps(cur_life, dt));
+				_mm_storeu_ps(spin + i, _mm_add_ps(_mm_loadu_ps(spin + i), spin_inc));
+				_mm_storeu_ps(size + i, cur_size);
+				_mm_storeu_ps(alpha + i, cur_alpha);
 			}
 		}
+#endif
 
-		float cur_mass = this_frame_mass_over_life_.back().y();
-		for (auto iter = std::next(this_frame_mass_over_life_.begin()); iter != this_frame_mass_over_life_.end(); ++ iter)
+		for (; i < particles.num; ++ i)
 		{
-			if (iter->x() >= pos)
-			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_mass = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
-			}
+			float t = (init_life[i] > 0) ? (init_life[i] - life[i]) / init_life[i] : 0;
+			t = MathLib::clamp(t, 0.0f, 1.0f);
+			float const fidx = t * (LUT_SIZE - 1);
+			uint32_t const idx = static_cast<uint32_t>(fidx);
+			float4 const sample = MathLib::lerp(lut[idx], lut[idx + 1], fidx - idx);
+			float const cur_size = sample.x();
+			float const cur_mass = sample.y();
+			float const cur_alpha = sample.z();
+
+			float const buoyancy = this_frame_buoyancy_factor_ * MathLib::cube(cur_size);
+			float3 const accel = (this_frame_force_ + float3(0, buoyancy, 0)) / cur_mass - float3(0, this_frame_gravity_, 0);
+			vel_x[i] += accel.x() * elapse_time;
+			vel_y[i] += accel.y() * elapse_time;
+			vel_z[i] += accel.z() * elapse_time;
+			pos_x[i] += vel_x[i] * elapse_time;
+			pos_y[i] += vel_y[i] * elapse_time;
+			pos_z[i] += vel_z[i] * elapse_time;
+			life[i] -= elapse_time;
+			spin[i] += 0.001f;
+			size[i] = cur_size;
+			alpha[i] = cur_alpha;
 		}
+	}
 
-		float cur_alpha = this_frame_opacity_over_life_.back().y();
-		for (auto iter = std::next(this_frame_opacity_over_life_.begin()); iter != this_frame_opacity_over_life_.end(); ++ iter)
+	void PolylineParticleUpdater::SnapParams()
+	{
 		{
-			if (iter->x() >= pos)
+			std::lock_guard<std::mutex> lock(update_mutex_);
+
+			if (curves_dirty_)
 			{
-				float2 const & prev = *std::prev(iter);
-				float const s = (pos - prev.x()) / (iter->x() - prev.x());
-				cur_alpha = MathLib::lerp(prev.y(), iter->y(), s);
-				break;
+				this->BakeCurves();
+				curves_dirty_ = false;
 			}
 		}
 
 		ParticleSystemPtr ps = ps_.lock();
-		float buoyancy = 4.0f / 3 * PI * MathLib::cube(cur_size) * ps->MediaDensity() * ps->Gravity();
-		float3 accel = (ps->Force() + float3(0, buoyancy, 0)) / cur_mass - float3(0, ps->Gravity(), 0);
-		par.vel += accel * elapse_time;
-		par.pos += par.vel * elapse_time;
-		par.life -= elapse_time;
-		par.spin += 0.001f;
-		par.size = cur_size;
-		par.alpha = cur_alpha;
+		this_frame_force_ = ps->Force();
+		this_frame_gravity_ = ps->Gravity();
+		this_frame_buoyancy_factor_ = 4.0f / 3 * PI * ps->MediaDensity() * ps->Gravity();
 	}
 
-	void PolylineParticleUpdater::SnapParams()
+	void PolylineParticleUpdater::BakeCurves()
 	{
-		std::lock_guard<std::mutex> lock(update_mutex_);
+		BOOST_ASSERT(!size_over_life_.empty());
+		BOOST_ASSERT(!mass_over_life_.empty());
+		BOOST_ASSERT(!opacity_over_life_.empty());
 
-		this_frame_size_over_life_ = size_over_life_;
-		this_frame_mass_over_life_ = mass_over_life_;
-		this_frame_opacity_over_life_ = opacity_over_life_;
+		// One extra entry so the lerp at t == 1 never reads past the end
+		this_frame_curve_lut_.resize(LUT_SIZE + 1);
+		for (uint32_t i = 0; i < LUT_SIZE; ++ i)
+		{
+			float const pos = static_cast<float>(i) / (LUT_SIZE - 1);
+			this_frame_curve_lut_[i] = float4(EvalPolyline(size_over_life_, pos), EvalPolyline(mass_over_life_, pos),
+				EvalPolyline(opacity_over_life_, pos), 0);
+		}
+		this_frame_curve_lut_[LUT_SIZE] = this_frame_curve_lut_[LUT_SIZE - 1];
 	}
 }
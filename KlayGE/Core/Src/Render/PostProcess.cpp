@@ -97,7 +97,7 @@ namespace
 				return;
 			}
 
-			ResIdentifierPtr ppmm_input = ResLoader::Instance().Open(pp_desc_.res_name);
+			ResIdentifierPtr ppmm_input = ResLoader::Instance().OpenXML(pp_desc_.res_name);
 
 			KlayGE::XMLDocument doc;
 			XMLNodePtr root = doc.Parse(ppmm_input);
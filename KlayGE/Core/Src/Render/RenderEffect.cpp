@@ -454,23 +454,23 @@ namespace
 		}
 	}
 
-	int get_index(XMLNode const & node)
+	int get_index(XMLNodeView node)
 	{
 		int index = 0;
-		XMLAttributePtr attr = node.Attrib("index");
+		XMLAttributeView attr = node.Attrib("index");
 		if (attr)
 		{
-			index = attr->ValueInt();
+			index = attr.ValueInt();
 		}
 		return index;
 	}
 
-	std::string get_profile(XMLNode const & node)
+	std::string get_profile(XMLNodeView node)
 	{
-		XMLAttributePtr attr = node.Attrib("profile");
+		XMLAttributeView attr = node.Attrib("profile");
 		if (attr)
 		{
-			return std::string(attr->ValueString());
+			return std::string(attr.ValueString());
 		}
 		else
 		{
@@ -478,16 +478,16 @@ namespace
 		}
 	}
 
-	std::string get_func_name(XMLNode const & node)
+	std::string get_func_name(XMLNodeView node)
 	{
-		std::string_view value = node.Attrib("value")->ValueString();
+		std::string_view value = node.Attrib("value").ValueString();
 		return std::string(value.substr(0, value.find("(")));
 	}
 
-	std::unique_ptr<RenderVariable> read_var(XMLNode const & node, uint32_t type, uint32_t array_size)
+	std::unique_ptr<RenderVariable> read_var(XMLNodeView node, uint32_t type, uint32_t array_size)
 	{
 		std::unique_ptr<RenderVariable> var;
-		XMLAttributePtr attr;
+		XMLAttributeView attr;
 
 		switch (type)
 		{
@@ -498,7 +498,7 @@ namespace
 				bool tmp = false;
 				if (attr)
 				{
-					tmp = BoolFromStr(attr->ValueString());
+					tmp = BoolFromStr(attr.ValueString());
 				}
 
 				var = MakeUniquePtr<RenderVariableBool>();
@@ -513,7 +513,7 @@ namespace
 				uint32_t tmp = 0;
 				if (attr)
 				{
-					tmp = attr->ValueInt();
+					tmp = attr.ValueInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableUInt>();
@@ -523,13 +523,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableUIntArray>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<uint32_t> init_val(std::min(array_size, static_cast<uint32_t>(strs.size())), 0);
@@ -554,7 +554,7 @@ namespace
 				int32_t tmp = 0;
 				if (attr)
 				{
-					tmp = attr->ValueInt();
+					tmp = attr.ValueInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableInt>();
@@ -564,13 +564,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableIntArray>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<int32_t> init_val(std::min(array_size, static_cast<uint32_t>(strs.size())), 0);
@@ -594,7 +594,7 @@ namespace
 				std::string tmp;
 				if (attr)
 				{
-					tmp = std::string(attr->ValueString());
+					tmp = std::string(attr.ValueString());
 				}
 
 				var = MakeUniquePtr<RenderVariableString>();
@@ -615,7 +615,7 @@ namespace
 			attr = node.Attrib("elem_type");
 			if (attr)
 			{
-				*var = std::string(attr->ValueString());
+				*var = std::string(attr.ValueString());
 			}
 			else
 			{
@@ -638,7 +638,7 @@ namespace
 			attr = node.Attrib("elem_type");
 			if (attr)
 			{
-				*var = std::string(attr->ValueString());
+				*var = std::string(attr.ValueString());
 			}
 			else
 			{
@@ -656,7 +656,7 @@ namespace
 				attr = node.Attrib("elem_type");
 				if (attr)
 				{
-					elem_type = std::string(attr->ValueString());
+					elem_type = std::string(attr.ValueString());
 				}
 				else
 				{
@@ -667,7 +667,7 @@ namespace
 				attr = node.Attrib("sample_count");
 				if (attr)
 				{
-					sample_count = std::string(attr->ValueString());
+					sample_count = std::string(attr.ValueString());
 					*var = elem_type + ", " + sample_count;
 				}
 				else
@@ -681,16 +681,16 @@ namespace
 			{
 				SamplerStateDesc desc;
 
-				for (XMLNodePtr state_node = node.FirstNode("state"); state_node; state_node = state_node->NextSibling("state"))
+				for (XMLNodeView state_node : node.Children("state"))
 				{
-					std::string_view const name = state_node->Attrib("name")->ValueString();
+					std::string_view const name = state_node.Attrib("name").ValueString();
 					size_t const name_hash = HashRange(name.begin(), name.end());
 
-					XMLAttributePtr const value_attr = state_node->Attrib("value");
+					XMLAttributeView const value_attr = state_node.Attrib("value");
 					std::string_view value_str;
 					if (value_attr)
 					{
-						value_str = value_attr->ValueString();
+						value_str = value_attr.ValueString();
 					}
 
 					if (CT_HASH("filtering") == name_hash)
@@ -711,19 +711,19 @@ namespace
 					}
 					else if (CT_HASH("max_anisotropy") == name_hash)
 					{
-						desc.max_anisotropy = static_cast<uint8_t>(value_attr->ValueUInt());
+						desc.max_anisotropy = static_cast<uint8_t>(value_attr.ValueUInt());
 					}
 					else if (CT_HASH("min_lod") == name_hash)
 					{
-						desc.min_lod = value_attr->ValueFloat();
+						desc.min_lod = value_attr.ValueFloat();
 					}
 					else if (CT_HASH("max_lod") == name_hash)
 					{
-						desc.max_lod = value_attr->ValueFloat();
+						desc.max_lod = value_attr.ValueFloat();
 					}
 					else if (CT_HASH("mip_map_lod_bias") == name_hash)
 					{
-						desc.mip_map_lod_bias = value_attr->ValueFloat();
+						desc.mip_map_lod_bias = value_attr.ValueFloat();
 					}
 					else if (CT_HASH("cmp_func") == name_hash)
 					{
@@ -731,25 +731,25 @@ namespace
 					}
 					else if (CT_HASH("border_clr") == name_hash)
 					{
-						attr = state_node->Attrib("r");
+						attr = state_node.Attrib("r");
 						if (attr)
 						{
-							desc.border_clr.r() = attr->ValueFloat();
+							desc.border_clr.r() = attr.ValueFloat();
 						}
-						attr = state_node->Attrib("g");
+						attr = state_node.Attrib("g");
 						if (attr)
 						{
-							desc.border_clr.g() = attr->ValueFloat();
+							desc.border_clr.g() = attr.ValueFloat();
 						}
-						attr = state_node->Attrib("b");
+						attr = state_node.Attrib("b");
 						if (attr)
 						{
-							desc.border_clr.b() = attr->ValueFloat();
+							desc.border_clr.b() = attr.ValueFloat();
 						}
-						attr = state_node->Attrib("a");
+						attr = state_node.Attrib("a");
 						if (attr)
 						{
-							desc.border_clr.a() = attr->ValueFloat();
+							desc.border_clr.a() = attr.ValueFloat();
 						}
 					}
 					else
@@ -781,7 +781,7 @@ namespace
 				attr = node.Attrib("value");
 				if (attr)
 				{
-					tmp = attr->ValueFloat();
+					tmp = attr.ValueFloat();
 				}
 
 				var = MakeUniquePtr<RenderVariableFloat>();
@@ -791,13 +791,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableFloatArray>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<float> init_val(std::min(array_size, static_cast<uint32_t>(strs.size())), 0.0f);
@@ -822,12 +822,12 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueUInt();
+					tmp.x() = attr.ValueUInt();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueUInt();
+					tmp.y() = attr.ValueUInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableUInt2>();
@@ -837,13 +837,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableInt2Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<uint2> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 1) / 2)), int2(0, 0));
@@ -871,17 +871,17 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueUInt();
+					tmp.x() = attr.ValueUInt();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueUInt();
+					tmp.y() = attr.ValueUInt();
 				}
 				attr = node.Attrib("z");
 				if (attr)
 				{
-					tmp.z() = attr->ValueUInt();
+					tmp.z() = attr.ValueUInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableUInt3>();
@@ -891,13 +891,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableInt3Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<uint3> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 2) / 3)), int3(0, 0, 0));
@@ -925,22 +925,22 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueUInt();
+					tmp.x() = attr.ValueUInt();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueUInt();
+					tmp.y() = attr.ValueUInt();
 				}
 				attr = node.Attrib("z");
 				if (attr)
 				{
-					tmp.z() = attr->ValueUInt();
+					tmp.z() = attr.ValueUInt();
 				}
 				attr = node.Attrib("w");
 				if (attr)
 				{
-					tmp.w() = attr->ValueUInt();
+					tmp.w() = attr.ValueUInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableUInt4>();
@@ -950,13 +950,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableInt4Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<int4> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 3) / 4)), int4(0, 0, 0, 0));
@@ -984,12 +984,12 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueInt();
+					tmp.x() = attr.ValueInt();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueInt();
+					tmp.y() = attr.ValueInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableInt2>();
@@ -999,13 +999,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableInt2Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<int2> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 1) / 2)), int2(0, 0));
@@ -1033,17 +1033,17 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueInt();
+					tmp.x() = attr.ValueInt();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueInt();
+					tmp.y() = attr.ValueInt();
 				}
 				attr = node.Attrib("z");
 				if (attr)
 				{
-					tmp.z() = attr->ValueInt();
+					tmp.z() = attr.ValueInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableInt3>();
@@ -1053,13 +1053,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableInt3Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<int3> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 2) / 3)), int3(0, 0, 0));
@@ -1087,22 +1087,22 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueInt();
+					tmp.x() = attr.ValueInt();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueInt();
+					tmp.y() = attr.ValueInt();
 				}
 				attr = node.Attrib("z");
 				if (attr)
 				{
-					tmp.z() = attr->ValueInt();
+					tmp.z() = attr.ValueInt();
 				}
 				attr = node.Attrib("w");
 				if (attr)
 				{
-					tmp.w() = attr->ValueInt();
+					tmp.w() = attr.ValueInt();
 				}
 
 				var = MakeUniquePtr<RenderVariableInt4>();
@@ -1112,13 +1112,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableInt4Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<int4> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 3) / 4)), int4(0, 0, 0, 0));
@@ -1146,12 +1146,12 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueFloat();
+					tmp.x() = attr.ValueFloat();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueFloat();
+					tmp.y() = attr.ValueFloat();
 				}
 
 				var = MakeUniquePtr<RenderVariableFloat2>();
@@ -1161,13 +1161,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableFloat2Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<float2> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 1) / 2)), float2(0, 0));
@@ -1195,17 +1195,17 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueFloat();
+					tmp.x() = attr.ValueFloat();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueFloat();
+					tmp.y() = attr.ValueFloat();
 				}
 				attr = node.Attrib("z");
 				if (attr)
 				{
-					tmp.z() = attr->ValueFloat();
+					tmp.z() = attr.ValueFloat();
 				}
 
 				var = MakeUniquePtr<RenderVariableFloat3>();
@@ -1215,13 +1215,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableFloat3Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<float3> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 2) / 3)), float3(0, 0, 0));
@@ -1249,22 +1249,22 @@ namespace
 				attr = node.Attrib("x");
 				if (attr)
 				{
-					tmp.x() = attr->ValueFloat();
+					tmp.x() = attr.ValueFloat();
 				}
 				attr = node.Attrib("y");
 				if (attr)
 				{
-					tmp.y() = attr->ValueFloat();
+					tmp.y() = attr.ValueFloat();
 				}
 				attr = node.Attrib("z");
 				if (attr)
 				{
-					tmp.z() = attr->ValueFloat();
+					tmp.z() = attr.ValueFloat();
 				}
 				attr = node.Attrib("w");
 				if (attr)
 				{
-					tmp.w() = attr->ValueFloat();
+					tmp.w() = attr.ValueFloat();
 				}
 
 				var = MakeUniquePtr<RenderVariableFloat4>();
@@ -1274,13 +1274,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableFloat4Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<float4> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 3) / 4)), float4(0, 0, 0, 0));
@@ -1313,7 +1313,7 @@ namespace
 							+ static_cast<char>('0' + y) + static_cast<char>('0' + x));
 						if (attr)
 						{
-							tmp[y * 4 + x] = attr->ValueFloat();
+							tmp[y * 4 + x] = attr.ValueFloat();
 						}
 					}
 				}
@@ -1325,13 +1325,13 @@ namespace
 			{
 				var = MakeUniquePtr<RenderVariableFloat4x4Array>();
 
-				XMLNodePtr value_node = node.FirstNode("value");
+				XMLNodeView value_node = node.FirstNode("value");
 				if (value_node)
 				{
-					value_node = value_node->FirstNode();
-					if (value_node && (XNT_CData == value_node->Type()))
+					value_node = value_node.FirstNode();
+					if (value_node && (XNT_CData == value_node.Type()))
 					{
-						std::string_view const value_str = value_node->ValueString();
+						std::string_view const value_str = value_node.ValueString();
 						std::vector<std::string> strs;
 						boost::algorithm::split(strs, value_str, boost::is_any_of(","));
 						std::vector<float4x4> init_val(std::min(array_size, static_cast<uint32_t>((strs.size() + 15) / 16)),
@@ -1362,7 +1362,7 @@ namespace
 			attr = node.Attrib("elem_type");
 			if (attr)
 			{
-				*var = std::string(attr->ValueString());
+				*var = std::string(attr.ValueString());
 			}
 			else
 			{
@@ -1379,7 +1379,7 @@ namespace
 			attr = node.Attrib("elem_type");
 			if (attr)
 			{
-				*var = std::string(attr->ValueString());
+				*var = std::string(attr.ValueString());
 			}
 			else
 			{
@@ -2642,11 +2642,11 @@ namespace KlayGE
 
 
 #if KLAYGE_IS_DEV_PLATFORM
-	void RenderEffectAnnotation::Load(XMLNodePtr const & node)
+	void RenderEffectAnnotation::Load(XMLNodeView node)
 	{
-		type_ = TypeCodeFromName(node->Attrib("type")->ValueString());
-		name_ = std::string(node->Attrib("name")->ValueString());
-		var_ = read_var(*node, type_, 0);
+		type_ = TypeCodeFromName(node.Attrib("type").ValueString());
+		name_ = std::string(node.Attrib("name").ValueString());
+		var_ = read_var(node, type_, 0);
 	}
 #endif
 
@@ -2881,7 +2881,7 @@ namespace KlayGE
 			std::string const include_name = std::string(attr->ValueString());
 
 			include_docs.push_back(MakeUniquePtr<XMLDocument>());
-			XMLNodePtr include_root = include_docs.back()->Parse(ResLoader::Instance().Open(include_name));
+			XMLNodePtr include_root = include_docs.back()->Parse(ResLoader::Instance().OpenXML(include_name));
 
 			std::vector<std::string> include_names;
 			this->RecursiveIncludeNode(*include_root, include_names);
@@ -2907,7 +2907,7 @@ namespace KlayGE
 					else
 					{
 						include_docs.push_back(MakeUniquePtr<XMLDocument>());
-						XMLNodePtr recursive_include_root = include_docs.back()->Parse(ResLoader::Instance().Open(*iter));
+						XMLNodePtr recursive_include_root = include_docs.back()->Parse(ResLoader::Instance().OpenXML(*iter));
 						this->InsertIncludeNodes(doc, root, node, *recursive_include_root);
 
 						whole_include_names.push_back(*iter);
@@ -2948,7 +2948,7 @@ namespace KlayGE
 			std::string const include_name = std::string(attr->ValueString());
 
 			XMLDocument include_doc;
-			XMLNodePtr include_root = include_doc.Parse(ResLoader::Instance().Open(include_name));
+			XMLNodePtr include_root = include_doc.Parse(ResLoader::Instance().OpenXML(include_name));
 			this->RecursiveIncludeNode(*include_root, include_names);
 
 			bool found = false;
@@ -3101,26 +3101,23 @@ namespace KlayGE
 		}
 	}
 
-	void RenderEffectTemplate::Load(XMLNode const & root, RenderEffect& effect)
+	void RenderEffectTemplate::Load(XMLNodeView root, RenderEffect& effect)
 	{
+		for (XMLNodeView macro_node : root.Children("macro"))
 		{
-			XMLNodePtr macro_node = root.FirstNode("macro");
-			for (; macro_node; macro_node = macro_node->NextSibling("macro"))
-			{
-				macros_.emplace_back(std::make_pair(macro_node->Attrib("name")->ValueString(), macro_node->Attrib("value")->ValueString()), true);
-			}
+			macros_.emplace_back(std::make_pair(macro_node.Attrib("name").ValueString(), macro_node.Attrib("value").ValueString()), true);
 		}
 
-		std::vector<XMLNodePtr> parameter_nodes;
-		for (XMLNodePtr node = root.FirstNode(); node; node = node->NextSibling())
+		std::vector<XMLNodeView> parameter_nodes;
+		for (XMLNodeView node : root.Children())
 		{
-			if ("parameter" == node->Name())
+			if ("parameter" == node.Name())
 			{
 				parameter_nodes.push_back(node);
 			}
-			else if ("cbuffer" == node->Name())
+			else if ("cbuffer" == node.Name())
 			{
-				for (XMLNodePtr sub_node = node->FirstNode("parameter"); sub_node; sub_node = sub_node->NextSibling("parameter"))
+				for (XMLNodeView sub_node : node.Children("parameter"))
 				{
 					parameter_nodes.push_back(sub_node);
 				}
@@ -3129,9 +3126,9 @@ namespace KlayGE
 
 		for (uint32_t param_index = 0; param_index < parameter_nodes.size(); ++ param_index)
 		{
-			XMLNodePtr const & node = parameter_nodes[param_index];
+			XMLNodeView node = parameter_nodes[param_index];
 
-			uint32_t type = TypeCodeFromName(node->Attrib("type")->ValueString());
+			uint32_t type = TypeCodeFromName(node.Attrib("type").ValueString());
 			if ((type != REDT_sampler)
 				&& (type != REDT_texture1D) && (type != REDT_texture2D) && (type != REDT_texture2DMS) && (type != REDT_texture3D)
 				&& (type != REDT_textureCUBE)
@@ -3151,8 +3148,8 @@ namespace KlayGE
 				&& (type != REDT_rasterizer_ordered_texture3D))
 			{
 				RenderEffectConstantBuffer* cbuff = nullptr;
-				XMLNodePtr parent_node = node->Parent();
-				std::string const cbuff_name = std::string(parent_node->AttribString("name", "global_cb"));
+				XMLNodeView parent_node = node.Parent();
+				std::string const cbuff_name = std::string(parent_node.AttribString("name", "global_cb"));
 				size_t const cbuff_name_hash = RT_HASH(cbuff_name.c_str());
 
 				bool found = false;
@@ -3180,16 +3177,14 @@ namespace KlayGE
 			effect.params_.back()->Load(node);
 		}
 
-		for (XMLNodePtr shader_graph_nodes_node = root.FirstNode("shader_graph_nodes"); shader_graph_nodes_node;
-			shader_graph_nodes_node = shader_graph_nodes_node->NextSibling("shader_graph_nodes"))
+		for (XMLNodeView shader_graph_nodes_node : root.Children("shader_graph_nodes"))
 		{
-			for (XMLNodePtr shader_node = shader_graph_nodes_node->FirstNode("node"); shader_node;
-				shader_node = shader_node->NextSibling("node"))
+			for (XMLNodeView shader_node : shader_graph_nodes_node.Children("node"))
 			{
-				auto name_attr = shader_node->Attrib("name");
+				auto name_attr = shader_node.Attrib("name");
 				BOOST_ASSERT(name_attr);
 
-				auto const & node_name = name_attr->ValueString();
+				auto const & node_name = name_attr.ValueString();
 				size_t const node_name_hash = HashRange(node_name.begin(), node_name.end());
 				bool found = false;
 				for (auto& gn : shader_graph_nodes_)
@@ -3210,7 +3205,7 @@ namespace KlayGE
 			}
 		}
 
-		for (XMLNodePtr shader_node = root.FirstNode("shader"); shader_node; shader_node = shader_node->NextSibling("shader"))
+		for (XMLNodeView shader_node : root.Children("shader"))
 		{
 			shader_frags_.push_back(RenderShaderFragment());
 			shader_frags_.back().Load(shader_node);
@@ -3219,7 +3214,7 @@ namespace KlayGE
 		this->GenHLSLShaderText(effect);
 
 		uint32_t index = 0;
-		for (XMLNodePtr node = root.FirstNode("technique"); node; node = node->NextSibling("technique"), ++ index)
+		for (XMLNodeView node = root.FirstNode("technique"); node; node = node.NextSibling("technique"), ++ index)
 		{
 			techniques_.push_back(MakeUniquePtr<RenderTechnique>());
 			techniques_.back()->Open(effect, node, index);
@@ -3255,7 +3250,7 @@ namespace KlayGE
 		{
 			timestamp_ = 0;
 
-			ResIdentifierPtr source = ResLoader::Instance().Open(name);
+			ResIdentifierPtr source = ResLoader::Instance().OpenXML(name);
 			if (source)
 			{
 				timestamp_ = std::max(timestamp_, source->Timestamp());
@@ -3296,7 +3291,7 @@ namespace KlayGE
 			std::vector<std::unique_ptr<XMLDocument>> include_docs;
 			std::vector<std::unique_ptr<XMLDocument>> frag_docs(names.size());
 
-			ResIdentifierPtr main_source = ResLoader::Instance().Open(names[0]);
+			ResIdentifierPtr main_source = ResLoader::Instance().OpenXML(names[0]);
 			if (main_source)
 			{
 				frag_docs[0] = MakeUniquePtr<XMLDocument>();
@@ -3305,7 +3300,7 @@ namespace KlayGE
 
 				for (size_t i = 1; i < names.size(); ++ i)
 				{
-					ResIdentifierPtr source = ResLoader::Instance().Open(names[i]);
+					ResIdentifierPtr source = ResLoader::Instance().OpenXML(names[i]);
 					if (source)
 					{
 						frag_docs[i] = MakeUniquePtr<XMLDocument>();
@@ -3322,7 +3317,7 @@ namespace KlayGE
 
 				this->ResolveOverrideTechs(*frag_docs[0], *root);
 
-				this->Load(*root, effect);
+				this->Load(root->View(), effect);
 
 				kfx_name_ = kfx_name;
 				need_compile_ = true;
@@ -4053,16 +4048,16 @@ namespace KlayGE
 
 
 #if KLAYGE_IS_DEV_PLATFORM
-	void RenderTechnique::Open(RenderEffect& effect, XMLNodePtr const & node, uint32_t tech_index)
+	void RenderTechnique::Open(RenderEffect& effect, XMLNodeView node, uint32_t tech_index)
 	{
-		name_ = std::string(node->Attrib("name")->ValueString());
+		name_ = std::string(node.Attrib("name").ValueString());
 		name_hash_ = HashRange(name_.begin(), name_.end());
 
 		RenderTechnique* parent_tech = nullptr;
-		XMLAttributePtr inherit_attr = node->Attrib("inherit");
+		XMLAttributeView inherit_attr = node.Attrib("inherit");
 		if (inherit_attr)
 		{
-			std::string_view const inherit = inherit_attr->ValueString();
+			std::string_view const inherit = inherit_attr.ValueString();
 			BOOST_ASSERT(inherit != name_);
 
 			parent_tech = effect.TechniqueByName(inherit);
@@ -4070,7 +4065,7 @@ namespace KlayGE
 		}
 
 		{
-			XMLNodePtr anno_node = node->FirstNode("annotation");
+			XMLNodeView anno_node = node.FirstNode("annotation");
 			if (anno_node)
 			{
 				annotations_ = MakeSharedPtr<std::remove_reference<decltype(*annotations_)>::type>();
@@ -4078,7 +4073,7 @@ namespace KlayGE
 				{
 					*annotations_ = *parent_tech->annotations_;
 				}
-				for (; anno_node; anno_node = anno_node->NextSibling("annotation"))
+				for (; anno_node; anno_node = anno_node.NextSibling("annotation"))
 				{
 					RenderEffectAnnotationPtr annotation = MakeSharedPtr<RenderEffectAnnotation>();
 					annotations_->push_back(annotation);
@@ -4093,7 +4088,7 @@ namespace KlayGE
 		}
 
 		{
-			XMLNodePtr macro_node = node->FirstNode("macro");
+			XMLNodeView macro_node = node.FirstNode("macro");
 			if (macro_node)
 			{
 				macros_ = MakeSharedPtr<std::remove_reference<decltype(*macros_)>::type>();
@@ -4101,10 +4096,10 @@ namespace KlayGE
 				{
 					*macros_ = *parent_tech->macros_;
 				}
-				for (; macro_node; macro_node = macro_node->NextSibling("macro"))
+				for (; macro_node; macro_node = macro_node.NextSibling("macro"))
 				{
-					std::string_view const name = macro_node->Attrib("name")->ValueString();
-					std::string_view const value = macro_node->Attrib("value")->ValueString();
+					std::string_view const name = macro_node.Attrib("name").ValueString();
+					std::string_view const value = macro_node.Attrib("value").ValueString();
 					bool found = false;
 					for (size_t i = 0; i < macros_->size(); ++ i)
 					{
@@ -4127,7 +4122,7 @@ namespace KlayGE
 			}
 		}
 
-		if (!node->FirstNode("pass") && parent_tech)
+		if (!node.FirstNode("pass") && parent_tech)
 		{
 			is_validate_ = parent_tech->is_validate_;
 			has_discard_ = parent_tech->has_discard_;
@@ -4170,7 +4165,7 @@ namespace KlayGE
 			}
 		
 			uint32_t index = 0;
-			for (XMLNodePtr pass_node = node->FirstNode("pass"); pass_node; pass_node = pass_node->NextSibling("pass"), ++ index)
+			for (XMLNodeView pass_node = node.FirstNode("pass"); pass_node; pass_node = pass_node.NextSibling("pass"), ++ index)
 			{
 				RenderPassPtr pass = MakeSharedPtr<RenderPass>();
 				passes_.push_back(pass);
@@ -4185,14 +4180,14 @@ namespace KlayGE
 
 				is_validate_ &= pass->Validate();
 
-				for (XMLNodePtr state_node = pass_node->FirstNode("state"); state_node; state_node = state_node->NextSibling("state"))
+				for (XMLNodeView state_node : pass_node.Children("state"))
 				{
 					++ weight_;
 
-					std::string_view const state_name = state_node->Attrib("name")->ValueString();
+					std::string_view const state_name = state_node.Attrib("name").ValueString();
 					if ("blend_enable" == state_name)
 					{
-						std::string_view const value_str = state_node->Attrib("value")->ValueString();
+						std::string_view const value_str = state_node.Attrib("value").ValueString();
 						if (BoolFromStr(value_str))
 						{
 							transparent_ = true;
@@ -4377,14 +4372,14 @@ namespace KlayGE
 
 
 #if KLAYGE_IS_DEV_PLATFORM
-	void RenderPass::Open(RenderEffect& effect, XMLNodePtr const & node,
+	void RenderPass::Open(RenderEffect& effect, XMLNodeView node,
 		uint32_t tech_index, uint32_t pass_index, RenderPass const * inherit_pass)
 	{
-		name_ = std::string(node->Attrib("name")->ValueString());
+		name_ = std::string(node.Attrib("name").ValueString());
 		name_hash_ = HashRange(name_.begin(), name_.end());
 
 		{
-			XMLNodePtr anno_node = node->FirstNode("annotation");
+			XMLNodeView anno_node = node.FirstNode("annotation");
 			if (anno_node)
 			{
 				annotations_ = MakeSharedPtr<std::remove_reference<decltype(*annotations_)>::type>();
@@ -4392,7 +4387,7 @@ namespace KlayGE
 				{
 					*annotations_ = *inherit_pass->annotations_;
 				}
-				for (; anno_node; anno_node = anno_node->NextSibling("annotation"))
+				for (; anno_node; anno_node = anno_node.NextSibling("annotation"))
 				{
 					RenderEffectAnnotationPtr annotation = MakeSharedPtr<RenderEffectAnnotation>();
 					annotations_->push_back(annotation);
@@ -4407,7 +4402,7 @@ namespace KlayGE
 		}
 
 		{
-			XMLNodePtr macro_node = node->FirstNode("macro");
+			XMLNodeView macro_node = node.FirstNode("macro");
 			if (macro_node)
 			{
 				macros_ = MakeSharedPtr<std::remove_reference<decltype(*macros_)>::type>();
@@ -4415,10 +4410,10 @@ namespace KlayGE
 				{
 					*macros_ = *inherit_pass->macros_;
 				}
-				for (; macro_node; macro_node = macro_node->NextSibling("macro"))
+				for (; macro_node; macro_node = macro_node.NextSibling("macro"))
 				{
-					std::string_view const name = macro_node->Attrib("name")->ValueString();
-					std::string_view const value = macro_node->Attrib("value")->ValueString();
+					std::string_view const name = macro_node.Attrib("name").ValueString();
+					std::string_view const value = macro_node.Attrib("value").ValueString();
 					bool found = false;
 					for (size_t i = 0; i < macros_->size(); ++ i)
 					{
@@ -4476,16 +4471,16 @@ namespace KlayGE
 			shader_desc_ids_ = inherit_pass->shader_desc_ids_;
 		}
 
-		for (XMLNodePtr state_node = node->FirstNode("state"); state_node; state_node = state_node->NextSibling("state"))
+		for (XMLNodeView state_node : node.Children("state"))
 		{
-			std::string_view const name = state_node->Attrib("name")->ValueString();
+			std::string_view const name = state_node.Attrib("name").ValueString();
 			size_t const state_name_hash = HashRange(name.begin(), name.end());
 
-			XMLAttributePtr const value_attr = state_node->Attrib("value");
+			XMLAttributeView const value_attr = state_node.Attrib("value");
 			std::string_view value_str;
 			if (value_attr)
 			{
-				value_str = value_attr->ValueString();
+				value_str = value_attr.ValueString();
 			}
 
 			if (CT_HASH("polygon_mode") == state_name_hash)
@@ -4506,11 +4501,11 @@ namespace KlayGE
 			}
 			else if (CT_HASH("polygon_offset_factor") == state_name_hash)
 			{
-				rs_desc.polygon_offset_factor = value_attr->ValueFloat();
+				rs_desc.polygon_offset_factor = value_attr.ValueFloat();
 			}
 			else if (CT_HASH("polygon_offset_units") == state_name_hash)
 			{
-				rs_desc.polygon_offset_units = value_attr->ValueFloat();
+				rs_desc.polygon_offset_units = value_attr.ValueFloat();
 			}
 			else if (CT_HASH("depth_clip_enable") == state_name_hash)
 			{
@@ -4534,80 +4529,80 @@ namespace KlayGE
 			}
 			else if (CT_HASH("blend_enable") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.blend_enable[index] = BoolFromStr(value_str);
 			}
 			else if (CT_HASH("logic_op_enable") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.logic_op_enable[index] = BoolFromStr(value_str);
 			}
 			else if (CT_HASH("blend_op") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.blend_op[index] = BlendOperationFromName(value_str);
 			}
 			else if (CT_HASH("src_blend") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.src_blend[index] = AlphaBlendFactorFromName(value_str);
 			}
 			else if (CT_HASH("dest_blend") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.dest_blend[index] = AlphaBlendFactorFromName(value_str);
 			}
 			else if (CT_HASH("blend_op_alpha") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.blend_op_alpha[index] = BlendOperationFromName(value_str);
 			}
 			else if (CT_HASH("src_blend_alpha") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.src_blend_alpha[index] = AlphaBlendFactorFromName(value_str);
 			}
 			else if (CT_HASH("dest_blend_alpha") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.dest_blend_alpha[index] = AlphaBlendFactorFromName(value_str);
 			}
 			else if (CT_HASH("logic_op") == state_name_hash)
 			{
-				int index = get_index(*state_node);
+				int index = get_index(state_node);
 				bs_desc.logic_op[index] = LogicOperationFromName(value_str);
 			}
 			else if (CT_HASH("color_write_mask") == state_name_hash)
 			{
-				int index = get_index(*state_node);
-				bs_desc.color_write_mask[index] = static_cast<uint8_t>(value_attr->ValueUInt());
+				int index = get_index(state_node);
+				bs_desc.color_write_mask[index] = static_cast<uint8_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("blend_factor") == state_name_hash)
 			{
-				XMLAttributePtr attr = state_node->Attrib("r");
+				XMLAttributeView attr = state_node.Attrib("r");
 				if (attr)
 				{
-					bs_desc.blend_factor.r() = attr->ValueFloat();
+					bs_desc.blend_factor.r() = attr.ValueFloat();
 				}
-				attr = state_node->Attrib("g");
+				attr = state_node.Attrib("g");
 				if (attr)
 				{
-					bs_desc.blend_factor.g() = attr->ValueFloat();
+					bs_desc.blend_factor.g() = attr.ValueFloat();
 				}
-				attr = state_node->Attrib("b");
+				attr = state_node.Attrib("b");
 				if (attr)
 				{
-					bs_desc.blend_factor.b() = attr->ValueFloat();
+					bs_desc.blend_factor.b() = attr.ValueFloat();
 				}
-				attr = state_node->Attrib("a");
+				attr = state_node.Attrib("a");
 				if (attr)
 				{
-					bs_desc.blend_factor.a() = attr->ValueFloat();
+					bs_desc.blend_factor.a() = attr.ValueFloat();
 				}
 			}
 			else if (CT_HASH("sample_mask") == state_name_hash)
 			{
-				bs_desc.sample_mask = value_attr->ValueUInt();
+				bs_desc.sample_mask = value_attr.ValueUInt();
 			}
 			else if (CT_HASH("depth_enable") == state_name_hash)
 			{
@@ -4631,15 +4626,15 @@ namespace KlayGE
 			}
 			else if (CT_HASH("front_stencil_ref") == state_name_hash)
 			{
-				dss_desc.front_stencil_ref = static_cast<uint16_t>(value_attr->ValueUInt());
+				dss_desc.front_stencil_ref = static_cast<uint16_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("front_stencil_read_mask") == state_name_hash)
 			{
-				dss_desc.front_stencil_read_mask = static_cast<uint16_t>(value_attr->ValueUInt());
+				dss_desc.front_stencil_read_mask = static_cast<uint16_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("front_stencil_write_mask") == state_name_hash)
 			{
-				dss_desc.front_stencil_write_mask = static_cast<uint16_t>(value_attr->ValueUInt());
+				dss_desc.front_stencil_write_mask = static_cast<uint16_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("front_stencil_fail") == state_name_hash)
 			{
@@ -4663,15 +4658,15 @@ namespace KlayGE
 			}
 			else if (CT_HASH("back_stencil_ref") == state_name_hash)
 			{
-				dss_desc.back_stencil_ref = static_cast<uint16_t>(value_attr->ValueUInt());
+				dss_desc.back_stencil_ref = static_cast<uint16_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("back_stencil_read_mask") == state_name_hash)
 			{
-				dss_desc.back_stencil_read_mask = static_cast<uint16_t>(value_attr->ValueUInt());
+				dss_desc.back_stencil_read_mask = static_cast<uint16_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("back_stencil_write_mask") == state_name_hash)
 			{
-				dss_desc.back_stencil_write_mask = static_cast<uint16_t>(value_attr->ValueUInt());
+				dss_desc.back_stencil_write_mask = static_cast<uint16_t>(value_attr.ValueUInt());
 			}
 			else if (CT_HASH("back_stencil_fail") == state_name_hash)
 			{
@@ -4717,25 +4712,25 @@ namespace KlayGE
 				}
 
 				ShaderDesc sd;
-				sd.profile = get_profile(*state_node);
-				sd.func_name = get_func_name(*state_node);
+				sd.profile = get_profile(state_node);
+				sd.func_name = get_func_name(state_node);
 				sd.macros_hash = macros_hash;
 
 				if ((ShaderStage::Vertex == stage) || (ShaderStage::Geometry == stage))
 				{
-					XMLNodePtr so_node = state_node->FirstNode("stream_output");
+					XMLNodeView so_node = state_node.FirstNode("stream_output");
 					if (so_node)
 					{
-						for (XMLNodePtr entry_node = so_node->FirstNode("entry"); entry_node; entry_node = entry_node->NextSibling("entry"))
+						for (XMLNodeView entry_node : so_node.Children("entry"))
 						{
 							ShaderDesc::StreamOutputDecl decl;
 
-							std::string_view const usage_str = entry_node->Attrib("usage")->ValueString();
+							std::string_view const usage_str = entry_node.Attrib("usage").ValueString();
 							size_t const usage_str_hash = HashRange(usage_str.begin(), usage_str.end());
-							XMLAttributePtr attr = entry_node->Attrib("usage_index");
+							XMLAttributeView attr = entry_node.Attrib("usage_index");
 							if (attr)
 							{
-								decl.usage_index = static_cast<uint8_t>(attr->ValueInt());
+								decl.usage_index = static_cast<uint8_t>(attr.ValueInt());
 							}
 							else
 							{
@@ -4786,11 +4781,11 @@ namespace KlayGE
 								KFL_UNREACHABLE("Invalid usage");
 							}
 
-							attr = entry_node->Attrib("component");
+							attr = entry_node.Attrib("component");
 							std::string component_str;
 							if (attr)
 							{
-								component_str = std::string(attr->ValueString());
+								component_str = std::string(attr.ValueString());
 							}
 							else
 							{
@@ -4799,10 +4794,10 @@ namespace KlayGE
 							decl.start_component = static_cast<uint8_t>(component_str[0] - 'x');
 							decl.component_count = static_cast<uint8_t>(std::min(static_cast<size_t>(4), component_str.size()));
 
-							attr = entry_node->Attrib("slot");
+							attr = entry_node.Attrib("slot");
 							if (attr)
 							{
-								decl.slot = static_cast<uint8_t>(attr->ValueInt());
+								decl.slot = static_cast<uint8_t>(attr.ValueInt());
 							}
 							else
 							{
@@ -5327,28 +5322,28 @@ namespace KlayGE
 
 
 #if KLAYGE_IS_DEV_PLATFORM
-	void RenderEffectParameter::Load(XMLNodePtr const & node)
+	void RenderEffectParameter::Load(XMLNodeView node)
 	{
-		type_ = TypeCodeFromName(node->Attrib("type")->ValueString());
+		type_ = TypeCodeFromName(node.Attrib("type").ValueString());
 		name_ = MakeSharedPtr<std::remove_reference<decltype(*name_)>::type>();
-		name_->first = std::string(node->Attrib("name")->ValueString());
+		name_->first = std::string(node.Attrib("name").ValueString());
 		name_->second = HashRange(name_->first.begin(), name_->first.end());
 
-		XMLAttributePtr attr = node->Attrib("semantic");
+		XMLAttributeView attr = node.Attrib("semantic");
 		if (attr)
 		{
 			semantic_ = MakeSharedPtr<std::remove_reference<decltype(*semantic_)>::type>();
-			semantic_->first = std::string(attr->ValueString());
+			semantic_->first = std::string(attr.ValueString());
 			semantic_->second = HashRange(semantic_->first.begin(), semantic_->first.end());
 		}
 
 		uint32_t as;
-		attr = node->Attrib("array_size");
+		attr = node.Attrib("array_size");
 		if (attr)
 		{
-			array_size_ = MakeSharedPtr<std::string>(attr->ValueString());
+			array_size_ = MakeSharedPtr<std::string>(attr.ValueString());
 
-			if (!attr->TryConvert(as))
+			if (!attr.TryConvert(as))
 			{
 				as = 1;  // dummy array size
 			}
@@ -5357,14 +5352,14 @@ namespace KlayGE
 		{
 			as = 0;
 		}
-		var_ = read_var(*node, type_, as);
+		var_ = read_var(node, type_, as);
 
 		{
-			XMLNodePtr anno_node = node->FirstNode("annotation");
+			XMLNodeView anno_node = node.FirstNode("annotation");
 			if (anno_node)
 			{
 				annotations_ = MakeSharedPtr<std::remove_reference<decltype(*annotations_)>::type>();
-				for (; anno_node; anno_node = anno_node->NextSibling("annotation"))
+				for (; anno_node; anno_node = anno_node.NextSibling("annotation"))
 				{
 					annotations_->push_back(MakeUniquePtr<RenderEffectAnnotation>());
 					annotations_->back()->Load(anno_node);
@@ -5579,13 +5574,13 @@ namespace KlayGE
 
 
 #if KLAYGE_IS_DEV_PLATFORM
-	void RenderShaderFragment::Load(XMLNodePtr const & node)
+	void RenderShaderFragment::Load(XMLNodeView node)
 	{
 		stage_ = ShaderStage::NumStages;
-		XMLAttributePtr attr = node->Attrib("type");
+		XMLAttributeView attr = node.Attrib("type");
 		if (attr)
 		{
-			std::string_view const type_str = attr->ValueString();
+			std::string_view const type_str = attr.ValueString();
 			size_t const type_str_hash = HashRange(type_str.begin(), type_str.end());
 			if (CT_HASH("vertex_shader") == type_str_hash)
 			{
@@ -5615,31 +5610,31 @@ namespace KlayGE
 		}
 		
 		ver_ = ShaderModel(0, 0);
-		attr = node->Attrib("major_version");
+		attr = node.Attrib("major_version");
 		if (attr)
 		{
 			uint8_t minor_ver = 0;
-			XMLAttributePtr minor_attr = node->Attrib("minor_version");
+			XMLAttributeView minor_attr = node.Attrib("minor_version");
 			if (minor_attr)
 			{
-				minor_ver = static_cast<uint8_t>(minor_attr->ValueInt());
+				minor_ver = static_cast<uint8_t>(minor_attr.ValueInt());
 			}
-			ver_ = ShaderModel(static_cast<uint8_t>(attr->ValueInt()), minor_ver);
+			ver_ = ShaderModel(static_cast<uint8_t>(attr.ValueInt()), minor_ver);
 		}
 		else
 		{
-			attr = node->Attrib("version");
+			attr = node.Attrib("version");
 			if (attr)
 			{
-				ver_ = ShaderModel(static_cast<uint8_t>(attr->ValueInt()), 0);
+				ver_ = ShaderModel(static_cast<uint8_t>(attr.ValueInt()), 0);
 			}
 		}
 
-		for (XMLNodePtr shader_text_node = node->FirstNode(); shader_text_node; shader_text_node = shader_text_node->NextSibling())
+		for (XMLNodeView shader_text_node : node.Children())
 		{
-			if ((XNT_Comment == shader_text_node->Type()) || (XNT_CData == shader_text_node->Type()))
+			if ((XNT_Comment == shader_text_node.Type()) || (XNT_CData == shader_text_node.Type()))
 			{
-				str_ += std::string(shader_text_node->ValueString());
+				str_ += std::string(shader_text_node.ValueString());
 			}
 		}
 	}
@@ -5676,45 +5671,45 @@ namespace KlayGE
 
 
 #if KLAYGE_IS_DEV_PLATFORM
-	void RenderShaderGraphNode::Load(XMLNodePtr const & node)
+	void RenderShaderGraphNode::Load(XMLNodeView node)
 	{
-		XMLAttributePtr attr = node->Attrib("name");
+		XMLAttributeView attr = node.Attrib("name");
 		BOOST_ASSERT(attr);
 
 		if (!name_.empty())
 		{
-			BOOST_ASSERT(name_ == std::string(attr->ValueString()));
+			BOOST_ASSERT(name_ == std::string(attr.ValueString()));
 		}
 		else
 		{
-			name_ = std::string(attr->ValueString());
+			name_ = std::string(attr.ValueString());
 			name_hash_ = HashRange(name_.begin(), name_.end());
 
-			attr = node->Attrib("return");
+			attr = node.Attrib("return");
 			if (attr)
 			{
-				return_type_ = std::string(attr->ValueString());
+				return_type_ = std::string(attr.ValueString());
 			}
 			else
 			{
 				return_type_ = "void";
 			}
 
-			for (XMLNodePtr param_node = node->FirstNode(); param_node; param_node = param_node->NextSibling())
+			for (XMLNodeView param_node : node.Children())
 			{
-				XMLAttributePtr type_attr = param_node->Attrib("type");
-				XMLAttributePtr name_attr = param_node->Attrib("name");
+				XMLAttributeView type_attr = param_node.Attrib("type");
+				XMLAttributeView name_attr = param_node.Attrib("name");
 				BOOST_ASSERT(type_attr);
 				BOOST_ASSERT(name_attr);
 
-				params_.emplace_back(type_attr->ValueString(), name_attr->ValueString());
+				params_.emplace_back(type_attr.ValueString(), name_attr.ValueString());
 			}
 		}
 
-		attr = node->Attrib("impl");
+		attr = node.Attrib("impl");
 		if (attr)
 		{
-			impl_ = std::string(attr->ValueString());
+			impl_ = std::string(attr.ValueString());
 		}
 	}
 #endif
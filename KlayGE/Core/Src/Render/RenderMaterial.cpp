@@ -128,7 +128,7 @@ namespace
 				return;
 			}
 
-			ResIdentifierPtr mtl_input = ResLoader::Instance().Open(mtl_desc_.res_name);
+			ResIdentifierPtr mtl_input = ResLoader::Instance().OpenXML(mtl_desc_.res_name);
 
 			KlayGE::XMLDocument doc;
 			XMLNodePtr root = doc.Parse(mtl_input);
@@ -240,18 +240,7 @@ namespace KlayGE
 
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
-		int32_t lod;
-		if (active_lod_ < 0)
-		{
-			auto const & camera = *re.CurFrameBuffer()->GetViewport()->camera;
-			lod = MathLib::clamp(static_cast<int32_t>(this->CalcLod(camera.EyePos(), camera.ProjMatrix()(0, 0)) + 0.5f),
-				0, static_cast<int32_t>(this->NumLods() - 1));
-		}
-		else
-		{
-			lod = active_lod_;
-		}
-		RenderLayout const & layout = this->GetRenderLayout(lod);
+		RenderLayout const & layout = this->GetRenderLayout(this->RenderLod());
 		GraphicsBufferPtr const & inst_stream = layout.InstanceStream();
 		RenderTechnique const & tech = *this->GetRenderTechnique();
 		auto const & effect = *this->GetRenderEffect();
@@ -368,6 +357,21 @@ namespace KlayGE
 		return dist_sq / area / fov_scale;
 	}
 
+	uint32_t Renderable::RenderLod() const
+	{
+		if (active_lod_ < 0)
+		{
+			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+			auto const & camera = *re.CurFrameBuffer()->GetViewport()->camera;
+			return MathLib::clamp(static_cast<int32_t>(this->CalcLod(camera.EyePos(), camera.ProjMatrix()(0, 0)) + 0.5f),
+				0, static_cast<int32_t>(this->NumLods() - 1));
+		}
+		else
+		{
+			return active_lod_;
+		}
+	}
+
 	bool Renderable::AllHWResourceReady() const
 	{
 		bool ready = this->HWResourceReady();
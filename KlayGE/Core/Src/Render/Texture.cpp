@@ -173,6 +173,7 @@ namespace
 		DDSCAPS2		dds_caps;			// direct draw surface capabilities
 		uint32_t		reserved2;
 	};
+	static_assert(sizeof(DDSSURFACEDESC2) == TEXTURE_BIN_VERSION, "TEXTURE_BIN_VERSION must match the DDS header.");
 
 	enum D3D_RESOURCE_DIMENSION
 	{
@@ -1714,7 +1715,7 @@ namespace KlayGE
 		uint32_t magic;
 		tex_res->read(&magic, sizeof(magic));
 		magic = LE2Native(magic);
-		BOOST_ASSERT((MakeFourCC<'D', 'D', 'S', ' '>::value) == magic);
+		BOOST_ASSERT(TEXTURE_BIN_FOURCC == magic);
 
 		DDSSURFACEDESC2 desc;
 		tex_res->read(&desc, sizeof(desc));
@@ -2370,7 +2371,7 @@ namespace KlayGE
 			file.open((ResLoader::Instance().LocalFolder() + tex_name).c_str(), std::ios_base::binary);
 		}
 
-		uint32_t magic = Native2LE(MakeFourCC<'D', 'D', 'S', ' '>::value);
+		uint32_t magic = Native2LE(TEXTURE_BIN_FOURCC);
 		file.write(reinterpret_cast<char*>(&magic), sizeof(magic));
 
 		DDSSURFACEDESC2 desc;
@@ -30,42 +30,30 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ErrorHandling.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/Fence.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/RenderEngine.hpp>
-#include <KlayGE/App3D.hpp>
 
 #include <cstring>
+#include <thread>
 
 #include <KlayGE/TransientBuffer.hpp>
 
 namespace KlayGE
 {
 	TransientBuffer::TransientBuffer(uint32_t size_in_byte, TransientBuffer::BindFlag bind_flag)
-		: bind_flag_(bind_flag)
+		: bind_flag_(bind_flag), capacity_(size_in_byte), head_(0), tail_(0), upload_begin_(0), writers_blocked_(false), num_writers_(0)
 	{
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 		RenderEngine const & re = rf.RenderEngineInstance();
 		RenderDeviceCaps const & caps = re.DeviceCaps();
 		use_no_overwrite_ = caps.no_overwrite_support;
 
-		buffer_ = this->DoCreateBuffer(bind_flag_, size_in_byte);
-		if (use_no_overwrite_)
-		{
-			num_pre_frames_ = 3;
-		}
-		else
-		{
-			num_pre_frames_ = 1;
-			simulate_buffer_.resize(buffer_->Size());
-			valid_min_ = 0;
-			valid_max_ = 0;
-		}
-
-		SubAlloc alloc(0, size_in_byte);
-		free_list_.push_back(alloc);
-
-		App3DFramework const & app = Context::Instance().AppInstance();
-		retired_frames_.push_back(RetiredFrame(app.TotalNumFrames() + 1));
+		buffer_ = this->DoCreateBuffer(bind_flag_, capacity_);
+		fence_ = rf.MakeFence();
+		cpu_buffer_.resize(capacity_);
 	}
 
 	GraphicsBufferPtr TransientBuffer::DoCreateBuffer(TransientBuffer::BindFlag bind_flag, uint32_t size_in_byte)
@@ -89,206 +77,215 @@ namespace KlayGE
 	}
 
 	SubAlloc TransientBuffer::Alloc(uint32_t size_in_byte, void const * data)
+	{
+		return this->Alloc(size_in_byte, [data](void* dst, uint32_t length)
+			{
+				memcpy(dst, data, length);
+			});
+	}
+
+	SubAlloc TransientBuffer::Alloc(uint32_t size_in_byte, std::function<void(void* dst, uint32_t length)> const & filler)
 	{
 		SubAlloc ret;
+		ret.length_ = size_in_byte;
 
-		// Use first fit method to find a free sub alloc
-		bool found = false;
-		auto iter = free_list_.begin();
-		auto first_fit_iter = iter;
-		for (; iter != free_list_.end(); ++ iter)
+		for (;;)
 		{
-			if (iter->length_ >= size_in_byte)
+			// A writer is counted before it looks at writers_blocked_, and BlockWriters sets writers_blocked_ before it waits
+			// for the count to drop. So either the writer sees the block, or BlockWriters waits for the writer.
+			// A blocked writer queues up on mutex_ in MakeRoom.
+			++ num_writers_;
+			if (!writers_blocked_ && this->TryAlloc(size_in_byte, ret.offset_))
 			{
-				first_fit_iter = iter;
-				found = true;
+				filler(cpu_buffer_.data() + ret.offset_, ret.length_);
+				-- num_writers_;
 				break;
 			}
+			-- num_writers_;
+
+			this->MakeRoom(size_in_byte);
 		}
 
-		// If there is not enough space, reallocate a larger buffer.
-		if (!found)
+		return ret;
+	}
+
+	bool TransientBuffer::TryAlloc(uint32_t size_in_byte, uint32_t& offset)
+	{
+		uint32_t head = head_;
+		for (;;)
 		{
-			uint32_t const old_buffer_size = buffer_->Size();
-			uint32_t larger_buffer_size = std::max(old_buffer_size * 2, old_buffer_size + size_in_byte);
-			GraphicsBufferPtr larger_buffer = this->DoCreateBuffer(bind_flag_, larger_buffer_size);
-			SubAlloc alloc(old_buffer_size, larger_buffer_size - old_buffer_size);
-			if (!free_list_.empty() && (free_list_.back().offset_ + free_list_.back().length_ == alloc.offset_))
+			// tail_ only moves towards head_, so a stale tail underestimates the free space, never overestimates
+			uint32_t const tail = tail_;
+
+			uint32_t new_head;
+			if (head >= tail)
 			{
-				free_list_.back().length_ += alloc.length_;
+				if (head + size_in_byte <= capacity_)
+				{
+					offset = head;
+					new_head = head + size_in_byte;
+				}
+				else if (size_in_byte < tail)
+				{
+					// Wrap around. The space between head and the end is skipped for this lap.
+					offset = 0;
+					new_head = size_in_byte;
+				}
+				else
+				{
+					return false;
+				}
 			}
 			else
 			{
-				free_list_.push_back(alloc);
-			}
-			first_fit_iter = free_list_.end();
-			-- first_fit_iter;
-			if (use_no_overwrite_)
-			{
-				buffer_->CopyToBuffer(*larger_buffer);
+				// Keep head strictly behind tail, head == tail means an empty ring
+				if (head + size_in_byte < tail)
+				{
+					offset = head;
+					new_head = head + size_in_byte;
+				}
+				else
+				{
+					return false;
+				}
 			}
-			else
+
+			if (head_.compare_exchange_weak(head, new_head))
 			{
-				simulate_buffer_.resize(larger_buffer_size);
+				return true;
 			}
-			buffer_ = larger_buffer;
 		}
+	}
 
-		uint32_t left_size = first_fit_iter->length_ - size_in_byte;
-		ret.length_ = size_in_byte;
-		ret.offset_ = first_fit_iter->offset_;
-		if (0 == left_size)
+	bool TransientBuffer::HasRoom(uint32_t size_in_byte) const
+	{
+		uint32_t const head = head_;
+		uint32_t const tail = tail_;
+		if (head >= tail)
 		{
-			free_list_.erase(first_fit_iter);
+			return (head + size_in_byte <= capacity_) || (size_in_byte < tail);
 		}
 		else
 		{
-			first_fit_iter->length_ = left_size;
-			first_fit_iter->offset_ += size_in_byte;
+			return head + size_in_byte < tail;
 		}
+	}
 
-		if (use_no_overwrite_)
+	void TransientBuffer::MakeRoom(uint32_t size_in_byte)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		this->RetirePresents();
+		while (!this->HasRoom(size_in_byte) && !in_flight_presents_.empty())
 		{
-			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_No_Overwrite);
-			uint8_t* buffer_data = mapper.Pointer<uint8_t>();
-			memcpy(buffer_data + ret.offset_, data, ret.length_);
+			fence_->Wait(in_flight_presents_.front().fence_id);
+			this->RetirePresents();
 		}
-		else
+
+		// Only the current frame is left in the ring, and it doesn't fit
+		if (!this->HasRoom(size_in_byte))
 		{
-			memcpy(&simulate_buffer_[ret.offset_], data, ret.length_);
-			valid_min_ = std::min(valid_min_, ret.offset_);
-			valid_max_ = std::max(valid_max_, ret.offset_ + ret.length_);
+			this->Grow(size_in_byte);
 		}
-
-		return ret;
 	}
 
-	void TransientBuffer::Dealloc(SubAlloc const & alloc)
+	void TransientBuffer::RetirePresents()
 	{
-		if ((alloc.length_ > 0) && !retired_frames_.empty())
+		while (!in_flight_presents_.empty() && fence_->Completed(in_flight_presents_.front().fence_id))
 		{
-			RetiredFrame& frame = retired_frames_.back();
-			frame.pending_frees_.push_back(alloc);
-
-			if (!use_no_overwrite_)
-			{
-				if (alloc.offset_ == valid_min_)
-				{
-					valid_min_ += alloc.length_;
-				}
-				if (alloc.offset_ + alloc.length_ == valid_max_)
-				{
-					valid_max_ -= alloc.length_;
-				}
-			}
+			tail_ = in_flight_presents_.front().end;
+			in_flight_presents_.pop_front();
 		}
 	}
 
-	void TransientBuffer::OnPresent()
+	void TransientBuffer::Grow(uint32_t size_in_byte)
 	{
-		if (!retired_frames_.empty())
-		{
-			App3DFramework const & app = Context::Instance().AppInstance();
-			uint32_t const frame_id = app.TotalNumFrames();
+		BOOST_ASSERT(in_flight_presents_.empty());
 
-			// First, deal with deletes from this frame
-			RetiredFrame& ret_frame = retired_frames_.back();
-			if (!ret_frame.pending_frees_.empty()) 
-			{
-				// Append a new (empty) RetiredFrame to retired_frames_
-				retired_frames_.push_back(RetiredFrame(frame_id + 1));
-			}
-			// Second, return pending frees to free_list
-			auto frame_iter = retired_frames_.begin();
-			for (; frame_iter != retired_frames_.end();)
-			{
-				if (frame_iter->frame_id + num_pre_frames_ <= frame_id)
-				{
-					auto iter = frame_iter->pending_frees_.begin();
-					for (; iter != frame_iter->pending_frees_.end(); ++ iter)
-					{
-						this->DoFree(*iter);
-					}
-					frame_iter = retired_frames_.erase(frame_iter);
-				}
-				else
-				{
-					++ frame_iter;
-				}
-			}
+		this->BlockWriters();
+
+		uint32_t const head = head_;
+		uint32_t const tail = tail_;
+		if (head < tail)
+		{
+			// Offsets already handed out can't move. The free gap in between is treated as used until the frame retires,
+			// which keeps the ring a single range after the new space is appended.
+			tail_ = 0;
+			head_ = capacity_;
 		}
+
+		capacity_ = std::max(capacity_ * 2, capacity_ + size_in_byte);
+		cpu_buffer_.resize(capacity_);
+		buffer_ = this->DoCreateBuffer(bind_flag_, capacity_);
+
+		// Nothing is in the new buffer yet
+		upload_begin_ = tail_;
+
+		this->UnblockWriters();
 	}
 
-	void TransientBuffer::DoFree(SubAlloc const & alloc)
+	void TransientBuffer::BlockWriters()
 	{
-		if (free_list_.empty())
+		writers_blocked_ = true;
+		while (num_writers_ != 0)
 		{
-			free_list_.push_back(alloc);
+			std::this_thread::yield();
 		}
-		else
-		{
-			// Find where to insert the alloc
-			auto insert_position = free_list_.begin();
-			while (insert_position != free_list_.end())
-			{
-				if (insert_position->offset_ > alloc.offset_)
-				{
-					break;
-				}
-				++ insert_position;
-			}
+	}
 
-			bool left_merged = false;
-			// If the alloc is adjacent to previous alloc, merge them.
-			auto previous = insert_position;
-			if (insert_position != free_list_.begin())
-			{
-				-- previous;
-				if (previous->offset_ + previous->length_ == alloc.offset_)
-				{
-					previous->length_ += alloc.length_;
-					left_merged = true;
-				}
-			}
+	void TransientBuffer::UnblockWriters()
+	{
+		writers_blocked_ = false;
+	}
+
+	void TransientBuffer::EnsureDataReady()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
 
-			bool right_merged = false;
-			// If the alloc is adjecent to next alloc, merge them.
-			auto next = insert_position;
-			if (insert_position != free_list_.end())
+		// head_ is bumped before the filler runs. Without draining the writers, a range still being filled could be
+		// uploaded half written and then skipped by the next upload.
+		this->BlockWriters();
+
+		// Without no-overwrite every map discards the buffer, so everything still alive has to be copied again
+		uint32_t const begin = use_no_overwrite_ ? upload_begin_ : static_cast<uint32_t>(tail_);
+		uint32_t const end = head_;
+		if (begin != end)
+		{
+			GraphicsBuffer::Mapper mapper(*buffer_, use_no_overwrite_ ? BA_Write_No_Overwrite : BA_Write_Only);
+			uint8_t* dst = mapper.Pointer<uint8_t>();
+			if (begin < end)
 			{
-				if (left_merged)
-				{
-					if (previous->offset_ + previous->length_ == next->offset_)
-					{
-						previous->length_ += next->length_;
-						free_list_.erase(next);
-						right_merged = true;
-					}
-				}
-				else
-				{
-					if (alloc.offset_ + alloc.length_ == next->offset_)
-					{
-						next->offset_ -= alloc.length_;
-						next->length_ += alloc.length_;
-						right_merged = true;
-					}
-				}
+				memcpy(dst + begin, cpu_buffer_.data() + begin, end - begin);
 			}
-			if (!(left_merged || right_merged))
+			else
 			{
-				free_list_.emplace(insert_position, alloc);
+				memcpy(dst + begin, cpu_buffer_.data() + begin, capacity_ - begin);
+				memcpy(dst, cpu_buffer_.data(), end);
 			}
 		}
+		upload_begin_ = end;
+
+		this->UnblockWriters();
 	}
 
-	void TransientBuffer::EnsureDataReady()
+	void TransientBuffer::OnPresent()
 	{
-		if (!use_no_overwrite_)
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		uint32_t const head = head_;
+		if (use_no_overwrite_)
+		{
+			uint32_t const last_end = in_flight_presents_.empty() ? static_cast<uint32_t>(tail_) : in_flight_presents_.back().end;
+			if (head != last_end)
+			{
+				in_flight_presents_.push_back({ head, fence_->Signal(Fence::FT_Render) });
+			}
+			this->RetirePresents();
+		}
+		else
 		{
-			GraphicsBuffer::Mapper mapper(*buffer_, BA_Write_Only);
-			memcpy(mapper.Pointer<uint8_t>() + valid_min_, &simulate_buffer_[valid_min_],
-				valid_max_ - valid_min_);
+			// The GPU keeps its own copy of a discarded buffer, so the space can be reused right away
+			tail_ = head;
 		}
 	}
 }
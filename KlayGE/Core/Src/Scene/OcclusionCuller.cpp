@@ -0,0 +1,456 @@
+/**
+ * @file OcclusionCuller.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CpuInfo.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(KLAYGE_SSE_SUPPORT)
+	#include <emmintrin.h>
+#endif
+
+#include <KlayGE/OcclusionCuller.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const MIN_ROWS_PER_BAND = 16;
+
+	uint32_t RoundUpPow2(uint32_t v)
+	{
+		uint32_t ret = 4;
+		while (ret < v)
+		{
+			ret <<= 1;
+		}
+		return ret;
+	}
+
+	// Clips a clip space polygon against the near plane (z >= 0). Returns the number of output vertices.
+	uint32_t ClipNear(float4 const * in_verts, uint32_t num_in, float4* out_verts)
+	{
+		uint32_t num_out = 0;
+		for (uint32_t i = 0; i < num_in; ++ i)
+		{
+			float4 const & a = in_verts[i];
+			float4 const & b = in_verts[(i + 1) % num_in];
+			bool const a_in = a.z() >= 0;
+			bool const b_in = b.z() >= 0;
+			if (a_in)
+			{
+				out_verts[num_out] = a;
+				++ num_out;
+			}
+			if (a_in != b_in)
+			{
+				float const t = a.z() / (a.z() - b.z());
+				out_verts[num_out] = MathLib::lerp(a, b, t);
+				++ num_out;
+			}
+		}
+		return num_out;
+	}
+}
+
+namespace KlayGE
+{
+	OccluderComponent::OccluderComponent() = default;
+
+	OccluderComponent::OccluderComponent(std::vector<float3> positions, std::vector<uint32_t> indices)
+		: positions_(std::move(positions)), indices_(std::move(indices))
+	{
+		BOOST_ASSERT(indices_.size() % 3 == 0);
+	}
+
+
+	SoftwareOcclusionCuller::SoftwareOcclusionCuller(uint32_t width, uint32_t height)
+		: width_(RoundUpPow2(width)), height_(RoundUpPow2(height)),
+			view_proj_(float4x4::Identity())
+	{
+		uint32_t w = width_;
+		uint32_t h = height_;
+		for (;;)
+		{
+			depth_levels_.emplace_back(w * h, 1.0f);
+			if ((1 == w) && (1 == h))
+			{
+				break;
+			}
+			w = std::max(w / 2, 1U);
+			h = std::max(h / 2, 1U);
+		}
+
+		std::memset(&stats_, 0, sizeof(stats_));
+	}
+
+	void SoftwareOcclusionCuller::BeginFrame(float4x4 const & view_proj)
+	{
+		view_proj_ = view_proj;
+		triangles_.clear();
+		std::memset(&stats_, 0, sizeof(stats_));
+	}
+
+	void SoftwareOcclusionCuller::AddOccluder(ArrayRef<float3> positions, ArrayRef<uint32_t> indices, float4x4 const & model)
+	{
+		Timer timer;
+
+		float4x4 const mvp = model * view_proj_;
+
+		std::vector<float4> clip_verts(positions.size());
+		for (size_t i = 0; i < positions.size(); ++ i)
+		{
+			clip_verts[i] = MathLib::transform(float4(positions[i].x(), positions[i].y(), positions[i].z(), 1), mvp);
+		}
+
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			float4 const verts[] = { clip_verts[indices[i + 0]], clip_verts[indices[i + 1]], clip_verts[indices[i + 2]] };
+
+			// Trivially reject triangles completely outside one of the side planes
+			bool outside = false;
+			for (uint32_t axis = 0; (axis < 2) && !outside; ++ axis)
+			{
+				outside = ((verts[0][axis] > verts[0].w()) && (verts[1][axis] > verts[1].w()) && (verts[2][axis] > verts[2].w()))
+					|| ((verts[0][axis] < -verts[0].w()) && (verts[1][axis] < -verts[1].w()) && (verts[2][axis] < -verts[2].w()));
+			}
+			if (outside)
+			{
+				continue;
+			}
+
+			if ((verts[0].z() >= 0) && (verts[1].z() >= 0) && (verts[2].z() >= 0))
+			{
+				this->SetupTriangle(verts[0], verts[1], verts[2]);
+			}
+			else
+			{
+				float4 clipped[4];
+				uint32_t const num_clipped = ClipNear(verts, 3, clipped);
+				for (uint32_t j = 2; j < num_clipped; ++ j)
+				{
+					this->SetupTriangle(clipped[0], clipped[j - 1], clipped[j]);
+				}
+			}
+		}
+
+		++ stats_.num_occluders;
+		stats_.rasterize_ms += static_cast<float>(timer.elapsed() * 1000);
+	}
+
+	void SoftwareOcclusionCuller::AddOccluder(AABBox const & box, float4x4 const & model)
+	{
+		float3 corners[8];
+		for (uint32_t i = 0; i < 8; ++ i)
+		{
+			corners[i] = box.Corner(i);
+		}
+
+		// Corner(i) uses bit 0 for x, bit 1 for y, bit 2 for z
+		static uint32_t const indices[] =
+		{
+			0, 2, 3, 0, 3, 1,
+			4, 5, 7, 4, 7, 6,
+			0, 4, 6, 0, 6, 2,
+			1, 3, 7, 1, 7, 5,
+			0, 1, 5, 0, 5, 4,
+			2, 6, 7, 2, 7, 3
+		};
+
+		this->AddOccluder(ArrayRef<float3>(corners), ArrayRef<uint32_t>(indices), model);
+	}
+
+	void SoftwareOcclusionCuller::SetupTriangle(float4 const & v0, float4 const & v1, float4 const & v2)
+	{
+		float4 const verts[] = { v0, v1, v2 };
+
+		ScreenTriangle tri;
+		for (uint32_t i = 0; i < 3; ++ i)
+		{
+			float const inv_w = 1 / verts[i].w();
+			tri.x[i] = (verts[i].x() * inv_w * 0.5f + 0.5f) * width_;
+			tri.y[i] = (0.5f - verts[i].y() * inv_w * 0.5f) * height_;
+			tri.z[i] = MathLib::clamp(verts[i].z() * inv_w, 0.0f, 1.0f);
+		}
+
+		float const area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+		if (MathLib::abs(area) < 1e-6f)
+		{
+			return;
+		}
+		if (area < 0)
+		{
+			// Make every triangle counter-clockwise in raster space so the inside test doesn't depend on winding
+			std::swap(tri.x[1], tri.x[2]);
+			std::swap(tri.y[1], tri.y[2]);
+			std::swap(tri.z[1], tri.z[2]);
+		}
+
+		float const min_y = std::min(std::min(tri.y[0], tri.y[1]), tri.y[2]);
+		float const max_y = std::max(std::max(tri.y[0], tri.y[1]), tri.y[2]);
+		if ((max_y < 0) || (min_y >= height_))
+		{
+			return;
+		}
+		tri.min_y = static_cast<int32_t>(std::max(min_y, 0.0f));
+		tri.max_y = static_cast<int32_t>(std::min(max_y, height_ - 1.0f));
+
+		triangles_.push_back(tri);
+		++ stats_.num_occluder_triangles;
+	}
+
+	void SoftwareOcclusionCuller::Rasterize()
+	{
+		Timer timer;
+
+		std::fill(depth_levels_[0].begin(), depth_levels_[0].end(), 1.0f);
+
+		if (!triangles_.empty())
+		{
+			static uint32_t const num_hw_threads = std::max(CPUInfo().NumHWThreads(), 1);
+			uint32_t const num_bands = std::max(std::min(num_hw_threads, height_ / MIN_ROWS_PER_BAND), 1U);
+			uint32_t const rows_per_band = (height_ + num_bands - 1) / num_bands;
+
+			auto& tp = Context::Instance().ThreadPool();
+			std::vector<joiner<void>> joiners;
+			joiners.reserve(num_bands - 1);
+			for (uint32_t i = 1; i < num_bands; ++ i)
+			{
+				uint32_t const begin_y = i * rows_per_band;
+				uint32_t const end_y = std::min(begin_y + rows_per_band, height_);
+				joiners.push_back(tp([this, begin_y, end_y] { this->RasterizeBand(begin_y, end_y); }));
+			}
+			this->RasterizeBand(0, std::min(rows_per_band, height_));
+
+			for (auto& joiner : joiners)
+			{
+				joiner();
+			}
+		}
+
+		this->BuildHiZ();
+
+		stats_.rasterize_ms += static_cast<float>(timer.elapsed() * 1000);
+	}
+
+	void SoftwareOcclusionCuller::RasterizeBand(uint32_t begin_y, uint32_t end_y)
+	{
+		float* depth = depth_levels_[0].data();
+
+		for (auto const & tri : triangles_)
+		{
+			int32_t const y0 = std::max(tri.min_y, static_cast<int32_t>(begin_y));
+			int32_t const y1 = std::min(tri.max_y, static_cast<int32_t>(end_y) - 1);
+			if (y0 > y1)
+			{
+				continue;
+			}
+
+			float const min_x = std::min(std::min(tri.x[0], tri.x[1]), tri.x[2]);
+			float const max_x = std::max(std::max(tri.x[0], tri.x[1]), tri.x[2]);
+			if ((max_x < 0) || (min_x >= width_))
+			{
+				continue;
+			}
+			// Start on a 4-pixel boundary so that the SIMD loop works on aligned quads
+			int32_t const x0 = static_cast<int32_t>(std::max(min_x, 0.0f)) & ~3;
+			int32_t const x1 = static_cast<int32_t>(std::min(max_x, width_ - 1.0f));
+
+			// Edge functions E(x, y) = a * x + b * y + c, positive inside
+			float ea[3];
+			float eb[3];
+			float ec[3];
+			for (uint32_t i = 0; i < 3; ++ i)
+			{
+				uint32_t const j = (i + 1) % 3;
+				ea[i] = -(tri.y[j] - tri.y[i]);
+				eb[i] = tri.x[j] - tri.x[i];
+				ec[i] = -(ea[i] * tri.x[i] + eb[i] * tri.y[i]);
+			}
+
+			// Depth plane from barycentrics. Edge i is opposite to vertex (i + 2) % 3.
+			float const inv_area = 1 / (ea[0] * tri.x[2] + eb[0] * tri.y[2] + ec[0]);
+			float const za = (ea[1] * tri.z[0] + ea[2] * tri.z[1] + ea[0] * tri.z[2]) * inv_area;
+			float const zb = (eb[1] * tri.z[0] + eb[2] * tri.z[1] + eb[0] * tri.z[2]) * inv_area;
+			float const zc = (ec[1] * tri.z[0] + ec[2] * tri.z[1] + ec[0] * tri.z[2]) * inv_area;
+
+#if defined(KLAYGE_SSE_SUPPORT)
+			__m128 const zero = _mm_setzero_ps();
+			__m128 const pixel_offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			__m128 const ea0 = _mm_set1_ps(ea[0]);
+			__m128 const ea1 = _mm_set1_ps(ea[1]);
+			__m128 const ea2 = _mm_set1_ps(ea[2]);
+			__m128 const za4 = _mm_set1_ps(za);
+#endif
+
+			for (int32_t y = y0; y <= y1; ++ y)
+			{
+				float const py = y + 0.5f;
+				float* row = depth + y * width_;
+
+#if defined(KLAYGE_SSE_SUPPORT)
+				__m128 const row0 = _mm_set1_ps(eb[0] * py + ec[0]);
+				__m128 const row1 = _mm_set1_ps(eb[1] * py + ec[1]);
+				__m128 const row2 = _mm_set1_ps(eb[2] * py + ec[2]);
+				__m128 const rowz = _mm_set1_ps(zb * py + zc);
+				for (int32_t x = x0; x <= x1; x += 4)
+				{
+					__m128 const px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), pixel_offsets);
+					__m128 const e0 = _mm_add_ps(_mm_mul_ps(ea0, px), row0);
+					__m128 const e1 = _mm_add_ps(_mm_mul_ps(ea1, px), row1);
+					__m128 const e2 = _mm_add_ps(_mm_mul_ps(ea2, px), row2);
+					__m128 const inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+						_mm_cmpge_ps(e2, zero));
+					if (_mm_movemask_ps(inside) != 0)
+					{
+						__m128 const z = _mm_add_ps(_mm_mul_ps(za4, px), rowz);
+						__m128 const old_z = _mm_load_ps(row + x);
+						__m128 const new_z = _mm_min_ps(old_z, z);
+						_mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_z), _mm_andnot_ps(inside, old_z)));
+					}
+				}
+#else
+				for (int32_t x = x0; x <= x1; ++ x)
+				{
+					float const px = x + 0.5f;
+					if ((ea[0] * px + eb[0] * py + ec[0] >= 0) && (ea[1] * px + eb[1] * py + ec[1] >= 0)
+						&& (ea[2] * px + eb[2] * py + ec[2] >= 0))
+					{
+						row[x] = std::min(row[x], za * px + zb * py + zc);
+					}
+				}
+#endif
+			}
+		}
+	}
+
+	void SoftwareOcclusionCuller::BuildHiZ()
+	{
+		uint32_t src_w = width_;
+		uint32_t src_h = height_;
+		for (size_t level = 1; level < depth_levels_.size(); ++ level)
+		{
+			uint32_t const dst_w = std::max(src_w / 2, 1U);
+			uint32_t const dst_h = std::max(src_h / 2, 1U);
+			float const * src = depth_levels_[level - 1].data();
+			float* dst = depth_levels_[level].data();
+			for (uint32_t y = 0; y < dst_h; ++ y)
+			{
+				uint32_t const sy0 = std::min(y * 2, src_h - 1);
+				uint32_t const sy1 = std::min(y * 2 + 1, src_h - 1);
+				for (uint32_t x = 0; x < dst_w; ++ x)
+				{
+					uint32_t const sx0 = std::min(x * 2, src_w - 1);
+					uint32_t const sx1 = std::min(x * 2 + 1, src_w - 1);
+					dst[y * dst_w + x] = std::max(std::max(src[sy0 * src_w + sx0], src[sy0 * src_w + sx1]),
+						std::max(src[sy1 * src_w + sx0], src[sy1 * src_w + sx1]));
+				}
+			}
+
+			src_w = dst_w;
+			src_h = dst_h;
+		}
+	}
+
+	bool SoftwareOcclusionCuller::IsOccluded(AABBox const & aabb_ws)
+	{
+		Timer timer;
+
+		++ stats_.num_tested;
+
+		float2 min_ndc(+1e10f, +1e10f);
+		float2 max_ndc(-1e10f, -1e10f);
+		float min_z = 1e10f;
+		bool crosses_near = false;
+		for (uint32_t i = 0; (i < 8) && !crosses_near; ++ i)
+		{
+			float3 const corner = aabb_ws.Corner(i);
+			float4 const clip = MathLib::transform(float4(corner.x(), corner.y(), corner.z(), 1), view_proj_);
+			if (clip.z() < 0)
+			{
+				crosses_near = true;
+			}
+			else
+			{
+				float const inv_w = 1 / clip.w();
+				float2 const ndc(clip.x() * inv_w, clip.y() * inv_w);
+				min_ndc = MathLib::minimize(min_ndc, ndc);
+				max_ndc = MathLib::maximize(max_ndc, ndc);
+				min_z = std::min(min_z, clip.z() * inv_w);
+			}
+		}
+
+		bool occluded = false;
+		if (!crosses_near && (max_ndc.x() >= -1) && (min_ndc.x() <= 1) && (max_ndc.y() >= -1) && (min_ndc.y() <= 1))
+		{
+			uint32_t const x0 = static_cast<uint32_t>(MathLib::clamp((min_ndc.x() * 0.5f + 0.5f) * width_, 0.0f, width_ - 1.0f));
+			uint32_t const x1 = static_cast<uint32_t>(MathLib::clamp((max_ndc.x() * 0.5f + 0.5f) * width_, 0.0f, width_ - 1.0f));
+			uint32_t const y0 = static_cast<uint32_t>(MathLib::clamp((0.5f - max_ndc.y() * 0.5f) * height_, 0.0f, height_ - 1.0f));
+			uint32_t const y1 = static_cast<uint32_t>(MathLib::clamp((0.5f - min_ndc.y() * 0.5f) * height_, 0.0f, height_ - 1.0f));
+
+			// Pick the level where the rect covers at most 3x3 texels
+			uint32_t const extent = std::max(x1 - x0, y1 - y0);
+			uint32_t level = 0;
+			while (((extent >> level) > 2) && (level + 1 < depth_levels_.size()))
+			{
+				++ level;
+			}
+
+			uint32_t const level_w = std::max(width_ >> level, 1U);
+			uint32_t const level_h = std::max(height_ >> level, 1U);
+			float const * level_depth = depth_levels_[level].data();
+			float max_depth = 0;
+			for (uint32_t y = std::min(y0 >> level, level_h - 1); y <= std::min(y1 >> level, level_h - 1); ++ y)
+			{
+				for (uint32_t x = std::min(x0 >> level, level_w - 1); x <= std::min(x1 >> level, level_w - 1); ++ x)
+				{
+					max_depth = std::max(max_depth, level_depth[y * level_w + x]);
+				}
+			}
+
+			occluded = min_z > max_depth;
+		}
+
+		if (occluded)
+		{
+			++ stats_.num_culled;
+		}
+		stats_.test_ms += static_cast<float>(timer.elapsed() * 1000);
+
+		return occluded;
+	}
+}
@@ -48,10 +48,13 @@
 #include <KlayGE/Renderable.hpp>
 #include <KlayGE/RenderEffect.hpp>
 #include <KlayGE/Light.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/ParticleSystem.hpp>
 #include <KlayGE/Input.hpp>
 #include <KlayGE/InputFactory.hpp>
 #include <KlayGE/FrameBuffer.hpp>
 #include <KlayGE/DeferredRenderingLayer.hpp>
+#include <KlayGE/OcclusionCuller.hpp>
 #include <KFL/Hash.hpp>
 
 #include <map>
@@ -106,6 +109,28 @@ namespace KlayGE
 		small_obj_threshold_ = area;
 	}
 
+	void SceneManager::OcclusionCulling(bool enable)
+	{
+		if (enable)
+		{
+			if (!occlusion_culler_)
+			{
+				occlusion_culler_ = MakeUniquePtr<SoftwareOcclusionCuller>(256, 128);
+			}
+		}
+		else
+		{
+			occlusion_culler_.reset();
+			occlusion_active_ = false;
+		}
+		visible_marks_map_.clear();
+	}
+
+	bool SceneManager::OcclusionCulling() const
+	{
+		return !!occlusion_culler_;
+	}
+
 	void SceneManager::SceneUpdateElapse(float elapse)
 	{
 		update_elapse_ = elapse;
@@ -129,6 +154,8 @@ namespace KlayGE
 			}
 		}
 
+		this->PrepareOcclusionCulling(camera, view_proj);
+
 		for (auto* sn : all_scene_nodes_)
 		{
 			auto& node = *sn;
@@ -164,6 +191,11 @@ namespace KlayGE
 						visible = this->AABBVisible(node.PosBoundWS());
 					}
 				}
+
+				if ((attr & SceneNode::SOA_Cullable) && (visible != BO_No) && this->AABBOccluded(node.PosBoundWS()))
+				{
+					visible = BO_No;
+				}
 			}
 			else
 			{
@@ -329,6 +361,11 @@ namespace KlayGE
 		std::lock_guard<std::mutex> lock(update_mutex_);
 		scene_root_.ClearChildren();
 		overlay_root_.ClearChildren();
+
+		std::lock_guard<std::mutex> skinned_lock(skinned_models_mutex_);
+		queued_skinned_models_.clear();
+		queued_skinned_model_frames_.clear();
+		queued_skinned_model_indices_.clear();
 	}
 
 	// ³
@@ -375,6 +412,8 @@ namespace KlayGE
 			overlay_root_.ClearChildren();
 		}
 
+		this->UpdateSkinnedModels();
+
 		nodes_updated_ = true;
 
 		this->FlushScene();
@@ -502,7 +541,10 @@ namespace KlayGE
 
 		for (auto* node : scene_nodes)
 		{
-			if (node->VisibleMark() != BO_No)
+			bool const moveable = (node->Attrib() & SceneNode::SOA_Moveable) != 0;
+			if ((node->VisibleMark() != BO_No)
+				&& !((urt & App3DFramework::URV_StaticOnly) && moveable)
+				&& !((urt & App3DFramework::URV_MoveableOnly) && !moveable))
 			{
 				node->ForEachComponentOfType<RenderableComponent>([node](RenderableComponent& renderable_comp) {
 					auto& renderable = renderable_comp.BoundRenderable();
@@ -623,6 +665,21 @@ namespace KlayGE
 		return num_dispatch_calls_;
 	}
 
+	uint32_t SceneManager::NumOcclusionTestedNodes() const
+	{
+		return occlusion_culler_ ? occlusion_culler_->FrameStats().num_tested : 0;
+	}
+
+	uint32_t SceneManager::NumOcclusionCulledNodes() const
+	{
+		return occlusion_culler_ ? occlusion_culler_->FrameStats().num_culled : 0;
+	}
+
+	float SceneManager::OcclusionCullingTime() const
+	{
+		return occlusion_culler_ ? occlusion_culler_->FrameStats().rasterize_ms + occlusion_culler_->FrameStats().test_ms : 0;
+	}
+
 	void SceneManager::FlushScene()
 	{
 		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
@@ -665,6 +722,43 @@ namespace KlayGE
 		num_dispatch_calls_ = re.NumDispatchesJustCalled();
 	}
 
+	void SceneManager::QueueSkinnedModelFrame(SkinnedModelPtr const & model, float frame)
+	{
+		std::lock_guard<std::mutex> lock(skinned_models_mutex_);
+
+		// A model must not be in two batches, they might run at the same time
+		auto iter = queued_skinned_model_indices_.find(model.get());
+		if (iter == queued_skinned_model_indices_.end())
+		{
+			queued_skinned_model_indices_.emplace(model.get(), queued_skinned_models_.size());
+			queued_skinned_models_.push_back(model);
+			queued_skinned_model_frames_.push_back(frame);
+		}
+		else
+		{
+			queued_skinned_model_frames_[iter->second] = frame;
+		}
+	}
+
+	void SceneManager::UpdateSkinnedModels()
+	{
+		std::lock_guard<std::mutex> lock(skinned_models_mutex_);
+
+		if (!queued_skinned_models_.empty())
+		{
+			SetSkinnedModelFrames(queued_skinned_models_, queued_skinned_model_frames_);
+
+			queued_skinned_models_.clear();
+			queued_skinned_model_frames_.clear();
+			queued_skinned_model_indices_.clear();
+		}
+	}
+
+	void SceneManager::QueueParticleSystemUpdate(ParticleSystemPtr const & ps)
+	{
+		queued_particle_systems_.push_back(ps);
+	}
+
 	void SceneManager::UpdateThreadFunc()
 	{
 		Timer timer;
@@ -688,6 +782,9 @@ namespace KlayGE
 					};
 					scene_root_.Traverse(updater);
 					overlay_root_.Traverse(updater);
+
+					UpdateParticleSystems(queued_particle_systems_, frame_time);
+					queued_particle_systems_.clear();
 				}
 
 				if (frame_time < update_elapse_)
@@ -738,4 +835,66 @@ namespace KlayGE
 
 		return visible;
 	}
+
+	void SceneManager::PrepareOcclusionCulling(Camera const & camera, float4x4 const & view_proj)
+	{
+		occlusion_active_ = false;
+
+		if (!occlusion_culler_ || camera.OmniDirectionalMode())
+		{
+			return;
+		}
+
+		// Only the main view has the same occluders from pass to pass. Shadow and reflection views are left alone.
+		RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+		if (&camera != re.DefaultFrameBuffer()->GetViewport()->camera.get())
+		{
+			return;
+		}
+		auto drl = Context::Instance().DeferredRenderingLayerInstance();
+		if (drl && (drl->CurrCascadeIndex() >= 0))
+		{
+			return;
+		}
+
+		occlusion_culler_->BeginFrame(view_proj);
+		for (auto* node : all_scene_nodes_)
+		{
+			if (!node->Visible())
+			{
+				continue;
+			}
+
+			bool const has_bound = (node->Attrib() & (SceneNode::SOA_Cullable | SceneNode::SOA_Moveable)) != 0;
+			if (has_bound && frustum_ && (BO_No == frustum_->Intersect(node->PosBoundWS())))
+			{
+				continue;
+			}
+
+			node->ForEachComponentOfType<OccluderComponent>([this, node, has_bound](OccluderComponent& occluder) {
+				if (occluder.Enabled())
+				{
+					if (!occluder.UseBoundingBox())
+					{
+						occlusion_culler_->AddOccluder(occluder.Positions(), occluder.Indices(), node->TransformToWorld());
+					}
+					else if (has_bound)
+					{
+						occlusion_culler_->AddOccluder(node->PosBoundOS(), node->TransformToWorld());
+					}
+				}
+			});
+		}
+
+		if (occlusion_culler_->FrameStats().num_occluders > 0)
+		{
+			occlusion_culler_->Rasterize();
+			occlusion_active_ = true;
+		}
+	}
+
+	bool SceneManager::AABBOccluded(AABBox const & aabb)
+	{
+		return occlusion_active_ && occlusion_culler_->IsOccluded(aabb);
+	}
 }
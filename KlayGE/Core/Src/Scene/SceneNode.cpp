@@ -445,6 +445,7 @@ namespace KlayGE
 
 	void SceneNode::Visible(bool vis)
 	{
+		uint32_t const old_attrib = attrib_;
 		if (vis)
 		{
 			attrib_ &= ~SOA_Invisible;
@@ -454,6 +455,15 @@ namespace KlayGE
 			attrib_ |= SOA_Invisible;
 		}
 
+		// Visibility doesn't change the spatial structures, so only the stamp is bumped
+		if (attrib_ != old_attrib)
+		{
+			if (auto* scene_mgr = this->OwnerSceneManager())
+			{
+				scene_mgr->MarkSceneChanged();
+			}
+		}
+
 		for (auto const & child : children_)
 		{
 			child->Visible(vis);
@@ -637,12 +647,12 @@ namespace KlayGE
 		}
 	}
 
-	void SceneNode::EmitSceneChanged()
+	SceneManager* SceneNode::OwnerSceneManager() const
 	{
 		auto& context = Context::Instance();
 		if (context.SceneManagerValid())
 		{
-			auto* node = this;
+			auto const * node = this;
 			while (node->Parent() != nullptr)
 			{
 				node = node->Parent();
@@ -651,8 +661,18 @@ namespace KlayGE
 			auto& scene_mgr = context.SceneManagerInstance();
 			if (node == &scene_mgr.SceneRootNode())
 			{
-				scene_mgr.OnSceneChanged();
+				return &scene_mgr;
 			}
 		}
+		return nullptr;
+	}
+
+	void SceneNode::EmitSceneChanged()
+	{
+		if (auto* scene_mgr = this->OwnerSceneManager())
+		{
+			scene_mgr->MarkSceneChanged();
+			scene_mgr->OnSceneChanged();
+		}
 	}
 }
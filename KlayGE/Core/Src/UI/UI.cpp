@@ -134,7 +134,7 @@ namespace KlayGE
 
 		bool Empty() const
 		{
-			return tb_ib_sub_allocs_.empty();
+			return batches_.empty();
 		}
 
 		void OnRenderBegin()
@@ -162,74 +162,83 @@ namespace KlayGE
 			tb_vb_->OnPresent();
 			tb_ib_->OnPresent();
 
-			tb_vb_sub_allocs_.clear();
-			tb_ib_sub_allocs_.clear();
+			this->ClearQuads();
 		}
 
 		void Render()
 		{
 			RenderEngine& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
 
-			this->OnRenderBegin();
+			uint32_t const index_per_quad = restart_ ? 5 : 6;
+			uint32_t const num_vertices = num_quads_ * 4;
 
-			BOOST_ASSERT(tb_vb_sub_allocs_.size() == tb_ib_sub_allocs_.size());
+			// All batches go into one sub alloc, so the whole texture is drawn in one call
+			SubAlloc const vb_sub_alloc = tb_vb_->Alloc(num_vertices * sizeof(UIManager::VertexFormat),
+				[this](void* dst, uint32_t /*length*/)
+				{
+					auto* vertices = static_cast<uint8_t*>(dst);
+					for (auto const & batch : batches_)
+					{
+						uint32_t const size = batch.second * 4 * sizeof(UIManager::VertexFormat);
+						memcpy(vertices, batch.first, size);
+						vertices += size;
+					}
+				});
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				uint32_t vert_length = tb_vb_sub_allocs_[i].length_;
-				uint32_t const ind_offset = tb_ib_sub_allocs_[i].offset_;
-				uint32_t ind_length = tb_ib_sub_allocs_[i].length_;
+			uint32_t const base_index = vb_sub_alloc.offset_ / sizeof(UIManager::VertexFormat);
+			BOOST_ASSERT(base_index + num_vertices <= 0xFFFF);
 
-				while ((i + 1 < tb_vb_sub_allocs_.size())
-					&& (tb_vb_sub_allocs_[i].offset_ + tb_vb_sub_allocs_[i].length_ == tb_vb_sub_allocs_[i + 1].offset_)
-					&& (tb_ib_sub_allocs_[i].offset_ + tb_ib_sub_allocs_[i].length_ == tb_ib_sub_allocs_[i + 1].offset_))
+			SubAlloc const ib_sub_alloc = tb_ib_->Alloc(num_quads_ * index_per_quad * sizeof(uint16_t),
+				[this, base_index](void* dst, uint32_t /*length*/)
 				{
-					vert_length += tb_vb_sub_allocs_[i + 1].length_;
-					ind_length += tb_ib_sub_allocs_[i + 1].length_;
-					++ i;
-				}
+					auto* indices = static_cast<uint16_t*>(dst);
+					for (uint32_t i = 0; i < num_quads_; ++ i)
+					{
+						uint16_t const first = static_cast<uint16_t>(base_index + i * 4);
+						indices[0] = first + 0;
+						indices[1] = first + 1;
+						if (restart_)
+						{
+							indices[2] = first + 3;
+							indices[3] = first + 2;
+							indices[4] = 0xFFFF;
+							indices += 5;
+						}
+						else
+						{
+							indices[2] = first + 2;
+							indices[3] = first + 2;
+							indices[4] = first + 3;
+							indices[5] = first + 0;
+							indices += 6;
+						}
+					}
+				});
 
-				rls_[0]->NumVertices(vert_length / sizeof(UIManager::VertexFormat));
-				rls_[0]->StartIndexLocation(ind_offset / sizeof(uint16_t));
-				rls_[0]->NumIndices(ind_length / sizeof(uint16_t));
+			this->OnRenderBegin();
 
-				re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rls_[0]);
-			}
+			rls_[0]->NumVertices(num_vertices);
+			rls_[0]->StartIndexLocation(ib_sub_alloc.offset_ / sizeof(uint16_t));
+			rls_[0]->NumIndices(ib_sub_alloc.length_ / sizeof(uint16_t));
 
-			for (size_t i = 0; i < tb_vb_sub_allocs_.size(); ++ i)
-			{
-				tb_vb_->Dealloc(tb_vb_sub_allocs_[i]);
-				tb_ib_->Dealloc(tb_ib_sub_allocs_[i]);
-			}
+			re.Render(*this->GetRenderEffect(), *this->GetRenderTechnique(), *rls_[0]);
 
 			this->OnRenderEnd();
 		}
 
-		void AddQuad(std::vector<UIManager::VertexFormat> const & vertices)
+		// The vertices are referenced, not copied. They have to stay alive until this renderable is rendered.
+		void AddQuads(UIManager::VertexFormat const * vertices, uint32_t num_quads)
 		{
-			tb_vb_sub_allocs_.push_back(tb_vb_->Alloc(static_cast<uint32_t>(vertices.size() * sizeof(vertices[0])), &vertices[0]));
-			
-			uint16_t const last_index = static_cast<uint16_t>(tb_vb_sub_allocs_.back().offset_ / sizeof(UIManager::VertexFormat));
-			std::vector<uint16_t> indices;
-			indices.resize(restart_ ? 5 : 6);
-			indices[0] = last_index + 0;
-			indices[1] = last_index + 1;
-			if (restart_)
-			{
-				indices[2] = last_index + 3;
-				indices[3] = last_index + 2;
-				indices[4] = 0xFFFF;
-			}
-			else
-			{
-				indices[2] = last_index + 2;
-				indices[3] = last_index + 2;
-				indices[4] = last_index + 3;
-				indices[5] = last_index + 0;
-			}
-			BOOST_ASSERT(last_index + 3 <= 0xFFFF);
+			BOOST_ASSERT(num_quads > 0);
+
+			batches_.emplace_back(vertices, num_quads);
+			num_quads_ += num_quads;
+		}
 
-			tb_ib_sub_allocs_.push_back(tb_ib_->Alloc(static_cast<uint32_t>(indices.size() * sizeof(indices[0])), &indices[0]));
+		void ClearQuads()
+		{
+			batches_.clear();
+			num_quads_ = 0;
 		}
 
 	private:
@@ -243,11 +252,28 @@ namespace KlayGE
 
 		std::unique_ptr<TransientBuffer> tb_vb_;
 		std::unique_ptr<TransientBuffer> tb_ib_;
-		std::vector<SubAlloc> tb_vb_sub_allocs_;
-		std::vector<SubAlloc> tb_ib_sub_allocs_;
+
+		std::vector<std::pair<UIManager::VertexFormat const *, uint32_t>> batches_;
+		uint32_t num_quads_ = 0;
 	};
 
 
+	void UIControl::MarkDirty()
+	{
+		auto dialog = dialog_.lock();
+		if (dialog)
+		{
+			dialog->MarkDirty();
+		}
+	}
+
+	void UIControl::AddElement(UIElement const & element)
+	{
+		elements_.push_back(MakeUniquePtr<UIElement>(element));
+		elements_.back()->Owner(this);
+	}
+
+
 	void UIStatesColor::Init(Color const & default_color,
 			Color const & disabled_color,
 			Color const & hidden_color)
@@ -268,11 +294,36 @@ namespace KlayGE
 	}
 
 
+	UIElement::UIElement(UIElement const & rhs)
+		: tex_index_(rhs.tex_index_), font_index_(rhs.font_index_), text_align_(rhs.text_align_),
+			tex_rect_(rhs.tex_rect_), texture_color_(rhs.texture_color_), font_color_(rhs.font_color_)
+	{
+	}
+
+	UIElement& UIElement::operator=(UIElement const & rhs)
+	{
+		if (this != &rhs)
+		{
+			tex_index_ = rhs.tex_index_;
+			font_index_ = rhs.font_index_;
+			text_align_ = rhs.text_align_;
+			tex_rect_ = rhs.tex_rect_;
+			texture_color_ = rhs.texture_color_;
+			font_color_ = rhs.font_color_;
+		}
+		return *this;
+	}
+
 	void UIElement::SetTexture(uint32_t tex_index, IRect const & tex_rect, Color const & default_texture_color)
 	{
 		tex_index_ = tex_index;
 		tex_rect_ = tex_rect;
 		texture_color_.Init(default_texture_color);
+
+		if (owner_)
+		{
+			owner_->MarkDirty();
+		}
 	}
 
 	void UIElement::SetFont(uint32_t font_index)
@@ -290,6 +341,11 @@ namespace KlayGE
 		font_index_ = font_index;
 		text_align_ = text_align;
 		font_color_.Init(default_font_color);
+
+		if (owner_)
+		{
+			owner_->MarkDirty();
+		}
 	}
 
 	void UIElement::Refresh()
@@ -300,7 +356,9 @@ namespace KlayGE
 
 
 	UIManager::UIManager()
-		: mouse_on_ui_(false),
+		: recording_geometry_(&immediate_geometry_),
+			num_quads_rebuilt_(0), num_quads_reused_(0),
+			mouse_on_ui_(false),
 			inited_(false)
 	{
 	}
@@ -430,7 +488,7 @@ namespace KlayGE
 			{
 				attr = node->Attrib("name");
 				include_docs.push_back(MakeUniquePtr<XMLDocument>());
-				XMLNodePtr include_root = include_docs.back()->Parse(ResLoader::Instance().Open(std::string(attr->ValueString())));
+				XMLNodePtr include_root = include_docs.back()->Parse(ResLoader::Instance().OpenXML(std::string(attr->ValueString())));
 
 				for (XMLNodePtr child_node = include_root->FirstNode(); child_node; child_node = child_node->NextSibling())
 				{
@@ -918,18 +976,53 @@ namespace KlayGE
 		}
 	}
 
+	void UIManager::GeometryCache::Clear()
+	{
+		// Keep the capacity, the next rebuild usually emits the same amount of geometry
+		for (auto& quad : quads)
+		{
+			quad.second.clear();
+		}
+		for (auto& str : strings)
+		{
+			str.second.clear();
+		}
+	}
+
+	uint32_t UIManager::GeometryCache::NumQuads() const
+	{
+		uint32_t num = 0;
+		for (auto const & quad : quads)
+		{
+			num += static_cast<uint32_t>(quad.second.size() / 4);
+		}
+		return num;
+	}
+
 	void UIManager::Render()
 	{
+		for (auto const & rect : rects_)
+		{
+			checked_pointer_cast<UIRectRenderable>(rect.second)->ClearQuads();
+		}
 		for (auto& str : strings_)
 		{
 			str.second.clear();
 		}
 
+		num_quads_rebuilt_ = 0;
+		num_quads_reused_ = 0;
+
 		for (auto const & dialog : dialogs_)
 		{
 			dialog->Render();
 		}
 
+		// Geometry drawn outside of dialogs lives for one frame only
+		std::swap(immediate_geometry_, submitted_immediate_geometry_);
+		immediate_geometry_.Clear();
+		this->SubmitGeometry(submitted_immediate_geometry_);
+
 		for (auto const & rect : rects_)
 		{
 			if (!checked_pointer_cast<UIRectRenderable>(rect.second)->Empty())
@@ -941,9 +1034,38 @@ namespace KlayGE
 		for (auto const & str : strings_)
 		{
 			auto const & font = font_cache_[str.first];
-			for (auto const & s : str.second)
+			for (auto const * s : str.second)
 			{
-				font.first->RenderText(s.rc, s.depth, 1, 1, s.clr, s.text, font.second, s.align);
+				font.first->RenderText(s->rc, s->depth, 1, 1, s->clr, s->text, font.second, s->align);
+			}
+		}
+
+	}
+
+	void UIManager::SubmitGeometry(GeometryCache const & cache)
+	{
+		for (auto const & quads : cache.quads)
+		{
+			if (!quads.second.empty())
+			{
+				auto& rect = rects_[quads.first];
+				if (!rect)
+				{
+					rect = MakeSharedPtr<UIRectRenderable>(quads.first, effect_);
+				}
+				checked_pointer_cast<UIRectRenderable>(rect)->AddQuads(quads.second.data(),
+					static_cast<uint32_t>(quads.second.size() / 4));
+			}
+		}
+		for (auto const & strs : cache.strings)
+		{
+			if (!strs.second.empty())
+			{
+				auto& dst = strings_[strs.first];
+				for (auto const & str : strs.second)
+				{
+					dst.push_back(&str);
+				}
 			}
 		}
 	}
@@ -964,63 +1086,32 @@ namespace KlayGE
 			texcoord = Rect(0, 0, 0, 0);
 		}
 
-		std::shared_ptr<UIRectRenderable> renderable;
-		if (rects_.find(texture) == rects_.end())
-		{
-			renderable = MakeSharedPtr<UIRectRenderable>(texture, effect_);
-			rects_[texture] = renderable;
-		}
-		else
-		{
-			renderable = checked_pointer_cast<UIRectRenderable>(rects_[texture]);
-		}
-		BOOST_ASSERT(renderable);
-
-		std::vector<VertexFormat> vertices(4);
-		vertices[0] = VertexFormat(pos + float3(0, 0, 0),
+		auto& vertices = recording_geometry_->quads[texture];
+		vertices.emplace_back(pos + float3(0, 0, 0),
 			clrs[0], float2(texcoord.left(), texcoord.top()));
-		vertices[1] = VertexFormat(pos + float3(width, 0, 0),
+		vertices.emplace_back(pos + float3(width, 0, 0),
 			clrs[1], float2(texcoord.right(), texcoord.top()));
-		vertices[2] = VertexFormat(pos + float3(width, height, 0),
+		vertices.emplace_back(pos + float3(width, height, 0),
 			clrs[2], float2(texcoord.right(), texcoord.bottom()));
-		vertices[3] = VertexFormat(pos + float3(0, height, 0),
+		vertices.emplace_back(pos + float3(0, height, 0),
 			clrs[3], float2(texcoord.left(), texcoord.bottom()));
-
-		renderable->AddQuad(vertices);
 	}
 
 	void UIManager::DrawQuad(float3 const & offset, VertexFormat const * vertices, TexturePtr const & texture)
 	{
-		std::shared_ptr<UIRectRenderable> renderable;
-		if (rects_.find(texture) == rects_.end())
-		{
-			renderable = MakeSharedPtr<UIRectRenderable>(texture, effect_);
-			rects_[texture] = renderable;
-		}
-		else
+		auto& verts = recording_geometry_->quads[texture];
+		for (int i = 0; i < 4; ++ i)
 		{
-			renderable = checked_pointer_cast<UIRectRenderable>(rects_[texture]);
+			verts.emplace_back(offset + vertices[i].pos, vertices[i].clr, vertices[i].tex);
 		}
-		BOOST_ASSERT(renderable);
-
-		std::vector<VertexFormat> verts(4);
-		verts[0] = VertexFormat(offset + vertices[0].pos,
-			vertices[0].clr, vertices[0].tex);
-		verts[1] = VertexFormat(offset + vertices[1].pos,
-			vertices[1].clr, vertices[1].tex);
-		verts[2] = VertexFormat(offset + vertices[2].pos,
-			vertices[2].clr, vertices[2].tex);
-		verts[3] = VertexFormat(offset + vertices[3].pos,
-			vertices[3].clr, vertices[3].tex);
-
-		renderable->AddQuad(verts);
 	}
 
 	void UIManager::DrawString(std::wstring const & strText, uint32_t font_index,
 		IRect const & rc, float depth, Color const & clr, uint32_t align)
 	{
-		strings_[font_index].push_back(string_cache());
-		string_cache& sc = strings_[font_index].back();
+		auto& strings = recording_geometry_->strings[font_index];
+		strings.push_back(string_cache());
+		string_cache& sc = strings.back();
 		sc.rc = rc;
 		sc.depth = depth;
 		sc.clr = clr;
@@ -1232,7 +1323,8 @@ namespace KlayGE
 					caption_height_(18),
 					top_left_clr_(0, 0, 0, 0), top_right_clr_(0, 0, 0, 0),
 					bottom_left_clr_(0, 0, 0, 0), bottom_right_clr_(0, 0, 0, 0),
-					opacity_(0.5f)
+					opacity_(0.5f),
+					geometry_dirty_(true)
 	{
 		TexturePtr ct;
 		if (control_tex)
@@ -1270,6 +1362,7 @@ namespace KlayGE
 
 		// Add to the list
 		controls_.push_back(control);
+		this->MarkDirty();
 	}
 
 	void UIDialog::InitControl(UIControl& control)
@@ -1363,6 +1456,40 @@ namespace KlayGE
 			return;
 		}
 
+		if (!geometry_dirty_)
+		{
+			for (auto const & control : controls_)
+			{
+				if (control->GetVisible() && control->IsAnimating())
+				{
+					geometry_dirty_ = true;
+					break;
+				}
+			}
+		}
+
+		auto& ui_mgr = UIManager::Instance();
+		if (geometry_dirty_)
+		{
+			geometry_.Clear();
+
+			ui_mgr.recording_geometry_ = &geometry_;
+			this->RebuildGeometry();
+			ui_mgr.recording_geometry_ = &ui_mgr.immediate_geometry_;
+
+			geometry_dirty_ = false;
+			ui_mgr.num_quads_rebuilt_ += geometry_.NumQuads();
+		}
+		else
+		{
+			ui_mgr.num_quads_reused_ += geometry_.NumQuads();
+		}
+
+		ui_mgr.SubmitGeometry(geometry_);
+	}
+
+	void UIDialog::RebuildGeometry()
+	{
 		depth_base_ = 0.5f;
 
 		bool bBackgroundIsVisible = (top_left_clr_.a() != 0) || (top_right_clr_.a() != 0)
@@ -1523,6 +1650,7 @@ namespace KlayGE
 		top_right_clr_ = colorTopRight;
 		bottom_left_clr_ = colorBottomLeft;
 		bottom_right_clr_ = colorBottomRight;
+		this->MarkDirty();
 	}
 
 	bool UIDialog::ContainsPoint(int2 const & pt) const
@@ -1632,6 +1760,7 @@ namespace KlayGE
 				}
 
 				controls_.erase(controls_.begin() + i);
+				this->MarkDirty();
 
 				return;
 			}
@@ -1647,6 +1776,7 @@ namespace KlayGE
 		control_mouse_over_.reset();
 
 		controls_.clear();
+		this->MarkDirty();
 	}
 
 	// Device state notification
@@ -1666,6 +1796,7 @@ namespace KlayGE
 		{
 			control->Refresh();
 		}
+		this->MarkDirty();
 
 		if (keyboard_input_)
 		{
@@ -1683,6 +1814,7 @@ namespace KlayGE
 			fonts_.resize(index + 1, -1);
 		}
 		fonts_[index] = static_cast<int>(UIManager::Instance().AddFont(font, font_size));
+		this->MarkDirty();
 	}
 
 	FontPtr const & UIDialog::GetFont(size_t index) const
@@ -1836,6 +1968,16 @@ namespace KlayGE
 		return size;
 	}
 
+	void UIDialog::UpdateOpacity(bool active)
+	{
+		float const opacity = active ? 1.0f : 0.5f;
+		if (opacity_ != opacity)
+		{
+			opacity_ = opacity;
+			this->MarkDirty();
+		}
+	}
+
 	bool UIDialog::OnCycleFocus(bool bForward)
 	{
 		for (size_t i = 0; i < controls_.size(); ++ i)
@@ -1957,6 +2099,7 @@ namespace KlayGE
 		if (control_focus_.lock() && control_focus_.lock()->GetEnabled())
 		{
 			control_focus_.lock()->KeyDownHandler(*this, key);
+			this->MarkDirty();
 		}
 		else
 		{
@@ -1971,6 +2114,7 @@ namespace KlayGE
 					if (control->GetHotkey() == static_cast<uint8_t>(key & 0xFF))
 					{
 						control->OnHotkey();
+						this->MarkDirty();
 						handled = true;
 						break;
 					}
@@ -2004,14 +2148,7 @@ namespace KlayGE
 			}
 		}
 
-		if (control_focus_.lock() || control_mouse_over_.lock())
-		{
-			opacity_ = 1.0f;
-		}
-		else
-		{
-			opacity_ = 0.5f;
-		}
+		this->UpdateOpacity(control_focus_.lock() || control_mouse_over_.lock());
 	}
 
 	void UIDialog::KeyUpHandler(uint32_t key)
@@ -2019,16 +2156,10 @@ namespace KlayGE
 		if (control_focus_.lock() && control_focus_.lock()->GetEnabled())
 		{
 			control_focus_.lock()->KeyUpHandler(*this, key);
+			this->MarkDirty();
 		}
 
-		if (control_focus_.lock() || control_mouse_over_.lock())
-		{
-			opacity_ = 1.0f;
-		}
-		else
-		{
-			opacity_ = 0.5f;
-		}
+		this->UpdateOpacity(control_focus_.lock() || control_mouse_over_.lock());
 	}
 
 	void UIDialog::MouseDownHandler(uint32_t buttons, int2 const & pt)
@@ -2050,6 +2181,7 @@ namespace KlayGE
 		if (control)
 		{
 			control->MouseDownHandler(*this, buttons, local_pt);
+			this->MarkDirty();
 		}
 		else
 		{
@@ -2060,14 +2192,7 @@ namespace KlayGE
 			}
 		}
 
-		if (this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock())
-		{
-			opacity_ = 1.0f;
-		}
-		else
-		{
-			opacity_ = 0.5f;
-		}
+		this->UpdateOpacity(this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock());
 	}
 
 	void UIDialog::MouseUpHandler(uint32_t buttons, int2 const & pt)
@@ -2089,6 +2214,7 @@ namespace KlayGE
 		if (control)
 		{
 			control->MouseUpHandler(*this, buttons, local_pt);
+			this->MarkDirty();
 		}
 		else
 		{
@@ -2099,14 +2225,7 @@ namespace KlayGE
 			}
 		}
 
-		if (this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock())
-		{
-			opacity_ = 1.0f;
-		}
-		else
-		{
-			opacity_ = 0.5f;
-		}
+		this->UpdateOpacity(this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock());
 	}
 
 	void UIDialog::MouseWheelHandler(uint32_t buttons, int2 const & pt, int32_t z_delta)
@@ -2128,6 +2247,7 @@ namespace KlayGE
 		if (control)
 		{
 			control->MouseWheelHandler(*this, buttons, local_pt, z_delta);
+			this->MarkDirty();
 		}
 		else
 		{
@@ -2138,14 +2258,7 @@ namespace KlayGE
 			}
 		}
 
-		if (this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock())
-		{
-			opacity_ = 1.0f;
-		}
-		else
-		{
-			opacity_ = 0.5f;
-		}
+		this->UpdateOpacity(this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock());
 	}
 
 	void UIDialog::MouseOverHandler(uint32_t buttons, int2 const & pt)
@@ -2183,15 +2296,9 @@ namespace KlayGE
 		if (control)
 		{
 			control->MouseOverHandler(*this, buttons, local_pt);
+			this->MarkDirty();
 		}
 
-		if (this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock())
-		{
-			opacity_ = 1.0f;
-		}
-		else
-		{
-			opacity_ = 0.5f;
-		}
+		this->UpdateOpacity(this->ContainsPoint(pt) || control_focus_.lock() || control_mouse_over_.lock());
 	}
 }
@@ -40,7 +40,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Pressed] = Color(1, 1, 1, 200.0f / 255);
 			Element.FontColor().States[UICS_MouseOver] = Color(0, 0, 0, 1.0f);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Fill layer
@@ -50,7 +50,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Pressed] = Color(0, 0, 0, 60.0f / 255);
 			Element.TextureColor().States[UICS_Focus] = Color(1, 1, 1, 30.0f / 255);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 	}
 
@@ -180,6 +180,7 @@ namespace KlayGE
 	void UIButton::SetText(std::wstring const & strText)
 	{
 		text_ = strText;
+		this->MarkDirty();
 	}
 
 	void UIButton::OnHotkey()
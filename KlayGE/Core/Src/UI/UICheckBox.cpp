@@ -42,14 +42,14 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Focus] = Color(1, 1, 1, 200.0f / 255);
 			Element.TextureColor().States[UICS_Pressed] = Color(1, 1, 1, 1);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Check
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_CheckBox, 1));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 	}
 
@@ -118,6 +118,7 @@ namespace KlayGE
 		checked_ = bChecked;
 
 		this->OnChangedEvent()(*this);
+		this->MarkDirty();
 	}
 
 	void UICheckBox::UpdateRects()
@@ -127,6 +128,7 @@ namespace KlayGE
 		text_rc_.left() += static_cast<int32_t>(1.25f * button_rc_.Width());
 
 		bounding_box_ = button_rc_ | text_rc_;
+		this->MarkDirty();
 	}
 
 	void UICheckBox::Render()
@@ -187,6 +189,7 @@ namespace KlayGE
 	void UICheckBox::SetText(std::wstring const & strText)
 	{
 		text_ = strText;
+		this->MarkDirty();
 	}
 
 	void UICheckBox::OnHotkey()
@@ -45,7 +45,7 @@ namespace KlayGE
 			Element.FontColor().States[UICS_Pressed] = Color(0, 0, 0, 1);
 			Element.FontColor().States[UICS_Disabled] = Color(200.0f / 255, 200.0f / 255, 200.0f / 255, 200.0f / 255);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Button
@@ -56,7 +56,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Focus] = Color(1, 1, 1, 200.0f / 255);
 			Element.TextureColor().States[UICS_Disabled] = Color(1, 1, 1, 70.0f / 255);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Dropdown
@@ -64,7 +64,7 @@ namespace KlayGE
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_ComboBox, 2));
 			Element.SetFont(0, Color(0, 0, 0, 1), Font::FA_Hor_Left | Font::FA_Ver_Top);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Selection
@@ -72,7 +72,7 @@ namespace KlayGE
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_ComboBox, 3));
 			Element.SetFont(0, Color(1, 1, 1, 1), Font::FA_Hor_Left | Font::FA_Ver_Top);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		this->GetDialog()->InitControl(scroll_bar_);
@@ -107,6 +107,7 @@ namespace KlayGE
 		{
 			dropdown_element->FontColor().States[UICS_Normal] = color;
 		}
+		this->MarkDirty();
 	}
 
 	void UIComboBox::OnFocusOut()
@@ -566,6 +567,7 @@ namespace KlayGE
 			focused_ = 0;
 			this->OnSelectionChangedEvent()(*this);
 		}
+		this->MarkDirty();
 
 		return ret;
 	}
@@ -600,6 +602,7 @@ namespace KlayGE
 			focused_ = 0;
 			this->OnSelectionChangedEvent()(*this);
 		}
+		this->MarkDirty();
 
 		return ret;
 	}
@@ -612,6 +615,7 @@ namespace KlayGE
 		{
 			selected_ = static_cast<int>(items_.size() - 1);
 		}
+		this->MarkDirty();
 	}
 
 	void UIComboBox::RemoveAllItems()
@@ -619,6 +623,7 @@ namespace KlayGE
 		items_.clear();
 		scroll_bar_.SetTrackRange(0, 1);
 		focused_ = selected_ = -1;
+		this->MarkDirty();
 	}
 
 	bool UIComboBox::ContainsItem(std::wstring const & strText, uint32_t iStart) const
@@ -699,6 +704,7 @@ namespace KlayGE
 
 		focused_ = selected_ = index;
 		this->OnSelectionChangedEvent()(*this);
+		this->MarkDirty();
 	}
 
 	void UIComboBox::SetSelectedByText(std::wstring const & strText)
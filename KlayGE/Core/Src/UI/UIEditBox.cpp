@@ -215,55 +215,55 @@ namespace KlayGE
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 0));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 1));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 2));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 3));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 4));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 5));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 6));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 7));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_EditBox, 8));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		WindowPtr const & main_wnd = Context::Instance().AppInstance().MainWnd();
@@ -352,6 +352,7 @@ namespace KlayGE
 		first_visible_ = 0;
 		this->PlaceCaret(0);
 		sel_start_ = 0;
+		this->MarkDirty();
 	}
 
 	void UIEditBox::SetText(std::wstring const & wszText, bool bSelected)
@@ -361,6 +362,7 @@ namespace KlayGE
 		// Move the caret to the end of the text
 		this->PlaceCaret(buffer_.GetTextSize());
 		sel_start_ = bSelected ? 0 : caret_pos_;
+		this->MarkDirty();
 	}
 
 	void UIEditBox::DeleteSelectionText()
@@ -42,7 +42,7 @@ namespace KlayGE
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_ListBox, 0));
 			Element.SetFont(0, Color(0, 0, 0, 1), Font::FA_Hor_Left | Font::FA_Ver_Top);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Selection
@@ -50,7 +50,7 @@ namespace KlayGE
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_ListBox, 1));
 			Element.SetFont(0, Color(1, 1, 1, 1), Font::FA_Hor_Left | Font::FA_Ver_Top);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		this->GetDialog()->InitControl(scroll_bar_);
@@ -111,6 +111,7 @@ namespace KlayGE
 
 		items_.push_back(pNewItem);
 		scroll_bar_.SetTrackRange(0, items_.size());
+		this->MarkDirty();
 
 		return ret;
 	}
@@ -132,6 +133,7 @@ namespace KlayGE
 
 		items_.push_back(pNewItem);
 		scroll_bar_.SetTrackRange(0, items_.size());
+		this->MarkDirty();
 
 		return ret;
 	}
@@ -146,6 +148,7 @@ namespace KlayGE
 
 		items_.insert(items_.begin() + nIndex, pNewItem);
 		scroll_bar_.SetTrackRange(0, items_.size());
+		this->MarkDirty();
 	}
 
 	void UIListBox::RemoveItem(int nIndex)
@@ -160,12 +163,14 @@ namespace KlayGE
 		}
 
 		this->OnSelectionEvent()(*this);
+		this->MarkDirty();
 	}
 
 	void UIListBox::RemoveAllItems()
 	{
 		items_.clear();
 		scroll_bar_.SetTrackRange(0, 1);
+		this->MarkDirty();
 	}
 
 	std::shared_ptr<UIListBoxItem> UIListBox::GetItem(int nIndex) const
@@ -246,6 +251,7 @@ namespace KlayGE
 		}
 
 		this->OnSelectionEvent()(*this);
+		this->MarkDirty();
 	}
 
 	void UIListBox::KeyDownHandler(UIDialog const & sender, uint32_t key)
@@ -37,14 +37,14 @@ namespace KlayGE
 		{
 			Element.TextureColor().States[UICS_Normal] = Color(0.7f, 0.7f, 0.7f, 1.0f);
 			Element.TextureColor().SetState(UICS_Normal);
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Coord line
 		{
 			Element.TextureColor().States[UICS_Normal] = Color(0.6f, 0.6f, 0.6f, 1.0f);
 			Element.TextureColor().SetState(UICS_Normal);
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Polyline
@@ -52,7 +52,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Normal] = Color(0, 1, 0, 1);
 			Element.TextureColor().States[UICS_MouseOver] = Color(1, 0, 0, 1);
 			Element.TextureColor().SetState(UICS_Normal);
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Control points
@@ -60,7 +60,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Normal] = Color(1, 1, 1, 1);
 			Element.TextureColor().States[UICS_MouseOver] = Color(1, 0, 0, 1);
 			Element.TextureColor().SetState(UICS_Normal);
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 	}
 
@@ -91,6 +91,7 @@ namespace KlayGE
 		active_pt_ = -1;
 		ctrl_points_.clear();
 		move_point_ = false;
+		this->MarkDirty();
 	}
 
 	int UIPolylineEditBox::AddCtrlPoint(float pos, float value)
@@ -118,6 +119,7 @@ namespace KlayGE
 			ctrl_points_.push_back(float2(pos, value));
 		}
 		this->ActivePoint(index);
+		this->MarkDirty();
 
 		return index;
 	}
@@ -143,16 +145,19 @@ namespace KlayGE
 	void UIPolylineEditBox::SetCtrlPoint(int index, float pos, float value)
 	{
 		ctrl_points_[index] = float2(pos, value);
+		this->MarkDirty();
 	}
 
 	void UIPolylineEditBox::SetCtrlPoints(std::vector<float2> const & ctrl_points)
 	{
 		ctrl_points_ = ctrl_points;
+		this->MarkDirty();
 	}
 
 	void UIPolylineEditBox::SetColor(Color const & clr)
 	{
 		elements_[POLYLINE_INDEX]->TextureColor().States[UICS_Normal] = clr;
+		this->MarkDirty();
 	}
 
 	size_t UIPolylineEditBox::NumCtrlPoints() const
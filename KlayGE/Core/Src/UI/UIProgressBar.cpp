@@ -36,14 +36,14 @@ namespace KlayGE
 		{
 			Element.TextureColor().States[UICS_Normal] = Color(1.0f, 1.0f, 1.0f, 1.0f);
 			Element.TextureColor().SetState(UICS_Normal);
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Bar
 		{
 			Element.TextureColor().States[UICS_Normal] = Color(0.2f, 0.4f, 0.6f, 1.0f);
 			Element.TextureColor().SetState(UICS_Normal);
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 	}
 
@@ -63,6 +63,7 @@ namespace KlayGE
 	void UIProgressBar::SetValue(int value)
 	{
 		progress_ = value;
+		this->MarkDirty();
 	}
 	
 	int UIProgressBar::GetValue() const
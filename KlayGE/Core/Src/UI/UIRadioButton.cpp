@@ -42,14 +42,14 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Focus] = Color(1, 1, 1, 200.0f / 255);
 			Element.TextureColor().States[UICS_Pressed] = Color(1, 1, 1, 1);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Check
 		{
 			Element.SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_RadioButton, 1));
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 	}
 
@@ -130,6 +130,7 @@ namespace KlayGE
 
 		checked_ = bChecked;
 		this->OnChangedEvent()(*this);
+		this->MarkDirty();
 	}
 
 	void UIRadioButton::UpdateRects()
@@ -203,6 +204,7 @@ namespace KlayGE
 	void UIRadioButton::SetText(std::wstring const & strText)
 	{
 		text_ = strText;
+		this->MarkDirty();
 	}
 
 	void UIRadioButton::OnHotkey()
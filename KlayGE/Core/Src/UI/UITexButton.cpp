@@ -41,7 +41,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Pressed] = Color(0, 0, 0, 60.0f / 255);
 			Element.TextureColor().States[UICS_Focus] = Color(1, 1, 1, 30.0f / 255);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 
 		// Button
@@ -52,7 +52,7 @@ namespace KlayGE
 			Element.TextureColor().States[UICS_Pressed] = Color(1, 1, 1, 1);
 			Element.FontColor().States[UICS_MouseOver] = Color(0, 0, 0, 1);
 
-			elements_.push_back(MakeUniquePtr<UIElement>(Element));
+			this->AddElement(Element);
 		}
 	}
 
@@ -223,6 +223,7 @@ namespace KlayGE
 		{
 			elements_[9]->SetTexture(static_cast<uint32_t>(tex_index_), IRect(0, 0, 1, 1));
 		}
+		this->MarkDirty();
 	}
 
 	void UITexButton::OnHotkey()
@@ -0,0 +1,106 @@
+/**
+ * @file AssetCache.hpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#ifndef KLAYGE_PLUGINS_DEV_HELPER_ASSET_CACHE_HPP
+#define KLAYGE_PLUGINS_DEV_HELPER_ASSET_CACHE_HPP
+
+#pragma once
+
+#include <KlayGE/PreDeclare.hpp>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <KlayGE/DevHelper/DevHelper.hpp>
+
+namespace KlayGE
+{
+	class MeshMetadata;
+	class TexMetadata;
+
+	// A content-addressed store of converted assets. Artifacts are keyed by a hash of the source content, the metadata,
+	// every file the metadata or the importer pulls in, the converter version and the runtime format version, so they
+	// survive touching files and switching branches, and can be shared by several checkouts.
+	class KLAYGE_DEV_HELPER_API AssetCache
+	{
+	public:
+		// Bump it when MeshConverter or TexConverter produce different output from the same input
+		static uint32_t constexpr CONVERTER_VERSION = 1;
+
+		// Uses KLAYGE_ASSET_CACHE_DIR, or KlayGEAssetCache under the system temp directory
+		AssetCache();
+		explicit AssetCache(std::string_view cache_dir);
+
+		static AssetCache& Instance();
+
+		std::string const & CacheDirectory() const
+		{
+			return cache_dir_;
+		}
+
+		// Empty if the input can't be located. Covers the sidecar files recorded for the same sources.
+		std::string ModelKey(std::string_view input_name, std::string_view metadata_name, MeshMetadata const & metadata) const;
+		// Records the files the importer read besides the sources, see MeshConverter::ImportedFiles. Returns the key
+		// that covers them, to store the converted model under.
+		std::string RecordModelSidecars(std::string_view input_name, std::string_view metadata_name,
+			MeshMetadata const & metadata, std::vector<std::string> const & sidecar_files);
+		std::string TextureKey(std::string_view input_name, TexMetadata const & metadata) const;
+
+		// Misses on artifacts whose header doesn't match the current MODEL_BIN_VERSION or TEXTURE_BIN_VERSION
+		bool Fetch(std::string_view key, std::string_view output_name);
+		void Store(std::string_view key, std::string_view output_name);
+
+		uint32_t NumHits() const
+		{
+			return num_hits_;
+		}
+		uint32_t NumMisses() const
+		{
+			return num_misses_;
+		}
+
+	private:
+		std::string ModelSourceKey(std::string_view input_name, std::string_view metadata_name,
+			MeshMetadata const & metadata) const;
+		std::string SidecarListPath(std::string_view source_key) const;
+		std::string ArtifactPath(std::string_view key, std::string_view output_name) const;
+		std::string TempPath(std::string const & path);
+
+	private:
+		std::string cache_dir_;
+
+		std::atomic<uint32_t> num_hits_{0};
+		std::atomic<uint32_t> num_misses_{0};
+		std::atomic<uint32_t> num_stores_{0};
+	};
+}
+
+#endif		// KLAYGE_PLUGINS_DEV_HELPER_ASSET_CACHE_HPP
@@ -38,6 +38,7 @@
 #include <KlayGE/Mesh.hpp>
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include <KlayGE/DevHelper/DevHelper.hpp>
@@ -50,9 +51,50 @@ namespace KlayGE
 {
 	class KLAYGE_DEV_HELPER_API MeshConverter
 	{
+	public:
+		// Post-transform vertex cache behavior of LoD 0, simulated with a 16-entry FIFO cache
+		struct VertexCacheStats
+		{
+			uint32_t num_vertices = 0;
+			uint32_t num_triangles = 0;
+			uint32_t num_cache_misses = 0;
+
+			// Average cache miss ratio, transformed vertices per triangle
+			float Acmr() const
+			{
+				return (num_triangles > 0) ? static_cast<float>(num_cache_misses) / num_triangles : 0.0f;
+			}
+			// Average transform to vertex ratio, 1 is the best possible
+			float Atvr() const
+			{
+				return (num_vertices > 0) ? static_cast<float>(num_cache_misses) / num_vertices : 0.0f;
+			}
+		};
+
 	public:
 		RenderModelPtr Load(std::string_view input_name, MeshMetadata const & metadata);
 		void Save(RenderModel& model, std::string_view output_name);
+
+		// Statistics of the last Load, before and after the mesh optimization pass
+		VertexCacheStats const & InputVertexCacheStats() const
+		{
+			return input_vertex_cache_stats_;
+		}
+		VertexCacheStats const & OutputVertexCacheStats() const
+		{
+			return output_vertex_cache_stats_;
+		}
+
+		// Files the importer read in the last Load besides the sources of the LoDs, such as the .mtl of an .obj
+		std::vector<std::string> const & ImportedFiles() const
+		{
+			return imported_files_;
+		}
+
+	private:
+		VertexCacheStats input_vertex_cache_stats_;
+		VertexCacheStats output_vertex_cache_stats_;
+		std::vector<std::string> imported_files_;
 	};
 }
 
@@ -117,11 +117,82 @@ namespace KlayGE
 		std::string_view LodFileName(uint32_t lod) const;
 		void LodFileName(uint32_t lod, std::string_view lod_name);
 
+		// LoDs simplified from LoD 0 when no LoD files are given. Ratios are target triangle counts relative to LoD 0.
+		uint32_t NumAutoLods() const;
+		void NumAutoLods(uint32_t lods);
+		float AutoLodRatio(uint32_t lod) const;
+		void AutoLodRatio(uint32_t lod, float ratio);
+		// Simplification stops early once the error reaches this fraction of the bounding box diagonal
+		float AutoLodMaxError() const
+		{
+			return auto_lod_max_error_;
+		}
+		void AutoLodMaxError(float max_error)
+		{
+			auto_lod_max_error_ = max_error;
+		}
+
+		// Reorders triangles and vertices for the vertex cache, overdraw and fetch, and splits meshes to keep 16-bit indices
+		bool OptimizeMeshes() const
+		{
+			return optimize_meshes_;
+		}
+		void OptimizeMeshes(bool optimize)
+		{
+			optimize_meshes_ = optimize;
+		}
+
+		// Bits per component of the vertex normal stream, 8 or 10
+		uint32_t NormalBits() const
+		{
+			return normal_bits_;
+		}
+		void NormalBits(uint32_t bits)
+		{
+			normal_bits_ = bits;
+		}
+		// Bits per component of the tangent frame quaternion stream, 8 or 16
+		uint32_t TangentFrameBits() const
+		{
+			return tangent_frame_bits_;
+		}
+		void TangentFrameBits(uint32_t bits)
+		{
+			tangent_frame_bits_ = bits;
+		}
+
+		// Static meshes are partitioned into clusters of at most this many triangles for CPU culling. 0 disables it.
+		uint32_t MaxClusterTriangles() const
+		{
+			return max_cluster_triangles_;
+		}
+		void MaxClusterTriangles(uint32_t triangles)
+		{
+			max_cluster_triangles_ = triangles;
+		}
+
 		uint32_t NumMaterials() const;
 		void NumMaterials(uint32_t materials);
 		std::string_view MaterialFileName(uint32_t mtl_index) const;
 		void MaterialFileName(uint32_t mtl_index, std::string_view mtlml_name);
 
+		float KeyFrameErrorThreshold() const
+		{
+			return key_frame_error_threshold_;
+		}
+		void KeyFrameErrorThreshold(float threshold)
+		{
+			key_frame_error_threshold_ = threshold;
+		}
+		bool CompressKeyFrames() const
+		{
+			return compress_key_frames_;
+		}
+		void CompressKeyFrames(bool compress)
+		{
+			compress_key_frames_ = compress;
+		}
+
 		float4x4 const & Transform() const
 		{
 			return transform_;
@@ -143,7 +214,15 @@ namespace KlayGE
 		uint8_t axis_mapping_[3] = { 0, 1, 2 };
 		bool flip_winding_order_ = false;
 		std::vector<std::string> lod_file_names_;
+		std::vector<float> auto_lod_ratios_;
+		float auto_lod_max_error_ = 1e-2f;
+		bool optimize_meshes_ = true;
+		uint32_t normal_bits_ = 8;
+		uint32_t tangent_frame_bits_ = 8;
+		uint32_t max_cluster_triangles_ = 128;
 		std::vector<std::string> material_file_names_;
+		float key_frame_error_threshold_ = 1e-3f;
+		bool compress_key_frames_ = false;
 
 		float4x4 transform_ = float4x4::Identity();
 		float4x4 transform_it_ = float4x4::Identity();
@@ -191,6 +191,7 @@ namespace KlayGE
 
 		uint32_t ArraySize() const;
 		void ArraySize(uint32_t size);
+		uint32_t NumPlaneMipmaps(uint32_t array_index) const;
 		std::string_view PlaneFileName(uint32_t array_index, uint32_t mip) const;
 		void PlaneFileName(uint32_t array_index, uint32_t mip, std::string_view name);
 
@@ -35,12 +35,109 @@
 
 #include <KlayGE/PreDeclare.hpp>
 
+#include <KFL/Thread.hpp>
 #include <KlayGE/Audio.hpp>
 
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <boost/lockfree/spsc_queue.hpp>
+
 namespace KlayGE
 {
+	class NullAudioEngine;
+
+	// Receives the mixed output as interleaved stereo floats
+	class NullAudioSink : boost::noncopyable
+	{
+	public:
+		virtual ~NullAudioSink()
+		{
+		}
+
+		virtual void Write(float const * samples, uint32_t num_frames) = 0;
+	};
+
+	class NullAudioDiscardSink : public NullAudioSink
+	{
+	public:
+		NullAudioDiscardSink();
+
+		void Write(float const * samples, uint32_t num_frames) override;
+
+		uint64_t NumFrames() const
+		{
+			return num_frames_;
+		}
+
+	private:
+		std::atomic<uint64_t> num_frames_;
+	};
+
+	class NullAudioWavSink : public NullAudioSink
+	{
+	public:
+		NullAudioWavSink(std::string const & path, uint32_t freq);
+		~NullAudioWavSink() override;
+
+		void Write(float const * samples, uint32_t num_frames) override;
+
+	private:
+		void WriteHeader();
+
+	private:
+		std::ofstream file_;
+		uint32_t freq_;
+		uint32_t data_size_;
+		std::vector<int16_t> pcm_;
+	};
+
+	// One playing instance of a buffer. The members are guarded by the engine's voice mutex.
+	class NullAudioVoice : boost::noncopyable
+	{
+	public:
+		NullAudioVoice();
+		virtual ~NullAudioVoice();
+
+		// Deinterleaves source frames from the play cursor on. Returns how many are available, up to num_frames.
+		virtual uint32_t Peek(float* left, float* right, uint32_t num_frames) = 0;
+		// Returns false once the voice has run out of data
+		virtual bool Advance(uint32_t num_frames) = 0;
+		// Called by the mixer once per block
+		virtual void Update()
+		{
+		}
+
+	public:
+		uint32_t channels;
+		uint32_t freq;
+
+		bool playing;
+		float volume;
+		float3 pos;
+
+		float frac;
+		uint32_t underruns;
+	};
+
 	class NullSoundBuffer : public SoundBuffer
 	{
+		class SoundVoice : public NullAudioVoice
+		{
+		public:
+			explicit SoundVoice(NullSoundBuffer const & buffer);
+
+			uint32_t Peek(float* left, float* right, uint32_t num_frames) override;
+			bool Advance(uint32_t num_frames) override;
+
+		public:
+			NullSoundBuffer const & buffer;
+			uint32_t cursor;
+			bool loop;
+		};
+
 	public:
 		NullSoundBuffer(AudioDataSourcePtr const & data_source, uint32_t num_sources, float volume);
 		~NullSoundBuffer() override;
@@ -63,6 +160,14 @@ namespace KlayGE
 		void DoReset() override;
 
 	private:
+		NullAudioEngine& engine_;
+
+		uint32_t num_frames_;
+		std::vector<float> left_;
+		std::vector<float> right_;
+
+		std::vector<std::unique_ptr<SoundVoice>> voices_;
+
 		float3 pos_;
 		float3 vel_;
 		float3 dir_;
@@ -70,6 +175,27 @@ namespace KlayGE
 
 	class NullMusicBuffer : public MusicBuffer
 	{
+		class MusicVoice : public NullAudioVoice
+		{
+		public:
+			explicit MusicVoice(NullMusicBuffer& buffer);
+
+			uint32_t Peek(float* left, float* right, uint32_t num_frames) override;
+			bool Advance(uint32_t num_frames) override;
+			void Update() override;
+
+			void Clear();
+
+		private:
+			uint32_t Stage(uint32_t num_frames);
+
+		private:
+			NullMusicBuffer& buffer_;
+
+			// Frames taken from the ring but not played yet
+			std::vector<float> stage_;
+		};
+
 	public:
 		NullMusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds, float volume);
 		~NullMusicBuffer() override;
@@ -90,14 +216,43 @@ namespace KlayGE
 		void DoPlay(bool loop) override;
 		void DoStop() override;
 
+		void Decode();
+		void StopStreaming();
+
 	private:
-		float3 pos_;
+		NullAudioEngine& engine_;
+		MusicVoice voice_;
+
+		// Decoded interleaved samples, produced by a thread pool task and consumed by the mixer
+		boost::lockfree::spsc_queue<float> ring_;
+		uint32_t ring_capacity_;
+
+		std::atomic<bool> decoding_;
+		std::atomic<bool> stop_decoding_;
+		std::atomic<bool> eof_;
+		joiner<void> decode_thread_;
+		bool loop_;
+		bool at_start_;
+
 		float3 vel_;
 		float3 dir_;
 	};
 
+	// Mixes all voices in software on one thread, for builds without an audio device
 	class NullAudioEngine : public AudioEngine
 	{
+	public:
+		static uint32_t constexpr MIX_FREQ = 44100;
+		static uint32_t constexpr MIX_FRAMES = 512;
+
+		struct MixerStats
+		{
+			uint32_t num_voices;
+			uint32_t num_virtual_voices;
+			float ns_per_voice;
+			uint32_t underruns;
+		};
+
 	public:
 		NullAudioEngine();
 		~NullAudioEngine() override;
@@ -111,15 +266,62 @@ namespace KlayGE
 		void GetListenerOri(float3& face, float3& up) const override;
 		void SetListenerOri(float3 const & face, float3 const & up) override;
 
+		// Virtual, so the tests can call these on the engine from the audio factory without linking the plugin
+		virtual void Sink(std::unique_ptr<NullAudioSink> sink);
+
+		// Voices above the limit keep their play cursor moving but aren't mixed
+		virtual void MaxVoices(uint32_t num);
+		virtual uint32_t MaxVoices() const;
+
+		virtual MixerStats Stats() const;
+
+		// Mixes one block on the calling thread. The mixer thread calls this at the output rate.
+		virtual void MixBlock();
+
+		void AddVoice(NullAudioVoice* voice);
+		void RemoveVoice(NullAudioVoice* voice);
+		std::mutex& VoiceMutex()
+		{
+			return mutex_;
+		}
+
 	private:
 		void DoSuspend() override;
 		void DoResume() override;
 
+		void MixLoop();
+		void VoiceGains(NullAudioVoice const & voice, float& gain_l, float& gain_r) const;
+		uint32_t SourceFrames(NullAudioVoice const & voice, uint32_t num_frames) const;
+		void MixVoice(NullAudioVoice& voice, float gain_l, float gain_r);
+
 	private:
+		mutable std::mutex mutex_;
+
 		float3 pos_;
 		float3 vel_;
 		float3 face_;
 		float3 up_;
+
+		std::vector<NullAudioVoice*> voices_;
+		std::vector<std::pair<float, NullAudioVoice*>> active_voices_;
+		uint32_t max_voices_;
+		bool suspended_;
+
+		std::unique_ptr<NullAudioSink> sink_;
+
+		std::vector<float> mix_left_;
+		std::vector<float> mix_right_;
+		std::vector<float> src_left_;
+		std::vector<float> src_right_;
+		std::vector<float> output_;
+
+		uint64_t stats_ns_;
+		uint64_t stats_voice_blocks_;
+		uint32_t stats_blocks_;
+		MixerStats stats_;
+
+		std::atomic<bool> quit_;
+		joiner<void> mix_thread_;
 	};
 }
 
@@ -28,29 +28,81 @@
  * from http://www.klayge.org/licensing/.
  */
 
+
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#if defined(KLAYGE_SSE_SUPPORT)
+	#include <emmintrin.h>
+#endif
 
 #include <KlayGE/NullAudio/NullAudio.hpp>
 
+namespace
+{
+	// Distance at which attenuation starts, as OpenAL's default inverse distance clamped model
+	float const REFERENCE_DISTANCE = 1.0f;
+
+	// Blocks averaged into one MixerStats sample, about one second
+	uint32_t const STATS_BLOCKS = KlayGE::NullAudioEngine::MIX_FREQ / KlayGE::NullAudioEngine::MIX_FRAMES;
+}
+
 namespace KlayGE
 {
+	NullAudioVoice::NullAudioVoice()
+		: channels(1), freq(NullAudioEngine::MIX_FREQ),
+			playing(false), volume(1), pos(0, 0, 0),
+			frac(0), underruns(0)
+	{
+	}
+
+	NullAudioVoice::~NullAudioVoice()
+	{
+	}
+
+
 	NullAudioEngine::NullAudioEngine()
+		: max_voices_(32), suspended_(false),
+			sink_(MakeUniquePtr<NullAudioDiscardSink>()),
+			mix_left_(MIX_FRAMES), mix_right_(MIX_FRAMES), output_(MIX_FRAMES * 2),
+			stats_ns_(0), stats_voice_blocks_(0), stats_blocks_(0),
+			quit_(false)
 	{
+		std::memset(&stats_, 0, sizeof(stats_));
+
 		this->SetListenerPos(float3(0, 0, 0));
 		this->SetListenerVel(float3(0, 0, 0));
 		this->SetListenerOri(float3(0, 0, 1), float3(0, 1, 0));
+
+		mix_thread_ = Context::Instance().ThreadPool()([this] { this->MixLoop(); });
 	}
 
 	NullAudioEngine::~NullAudioEngine()
 	{
+		quit_ = true;
+		mix_thread_();
+
+		// Buffers unregister their voices from this engine when they go away
+		audio_buffs_.clear();
 	}
 
 	void NullAudioEngine::DoSuspend()
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		suspended_ = true;
 	}
 
 	void NullAudioEngine::DoResume()
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		suspended_ = false;
 	}
 
 	std::wstring const & NullAudioEngine::Name() const
@@ -61,33 +113,304 @@ namespace KlayGE
 
 	float3 NullAudioEngine::GetListenerPos() const
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
 		return pos_;
 	}
 
 	void NullAudioEngine::SetListenerPos(float3 const & v)
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
 		pos_ = v;
 	}
 
 	float3 NullAudioEngine::GetListenerVel() const
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
 		return vel_;
 	}
 
 	void NullAudioEngine::SetListenerVel(float3 const & v)
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
 		vel_ = v;
 	}
 
 	void NullAudioEngine::GetListenerOri(float3& face, float3& up) const
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
 		face = face_;
 		up = up_;
 	}
 
 	void NullAudioEngine::SetListenerOri(float3 const & face, float3 const & up)
 	{
+		std::lock_guard<std::mutex> lock(mutex_);
 		face_ = face;
 		up_ = up;
 	}
+
+	void NullAudioEngine::Sink(std::unique_ptr<NullAudioSink> sink)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		sink_ = std::move(sink);
+	}
+
+	void NullAudioEngine::MaxVoices(uint32_t num)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		max_voices_ = num;
+	}
+
+	uint32_t NullAudioEngine::MaxVoices() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return max_voices_;
+	}
+
+	NullAudioEngine::MixerStats NullAudioEngine::Stats() const
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		return stats_;
+	}
+
+	void NullAudioEngine::AddVoice(NullAudioVoice* voice)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		voices_.push_back(voice);
+	}
+
+	void NullAudioEngine::RemoveVoice(NullAudioVoice* voice)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		voices_.erase(std::remove(voices_.begin(), voices_.end(), voice), voices_.end());
+	}
+
+	void NullAudioEngine::MixLoop()
+	{
+		auto const block_time = std::chrono::microseconds(MIX_FRAMES * 1000000ULL / MIX_FREQ);
+		auto next = std::chrono::steady_clock::now();
+		while (!quit_)
+		{
+			this->MixBlock();
+
+			next += block_time;
+			auto const now = std::chrono::steady_clock::now();
+			if (now > next + block_time * 8)
+			{
+				// Fell too far behind to catch up, drop the backlog instead of mixing a burst
+				next = now;
+			}
+			std::this_thread::sleep_until(next);
+		}
+	}
+
+	void NullAudioEngine::MixBlock()
+	{
+		auto const start = std::chrono::high_resolution_clock::now();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (suspended_)
+		{
+			return;
+		}
+
+		std::fill(mix_left_.begin(), mix_left_.end(), 0.0f);
+		std::fill(mix_right_.begin(), mix_right_.end(), 0.0f);
+
+		active_voices_.clear();
+		for (auto voice : voices_)
+		{
+			if (voice->playing)
+			{
+				float gain_l, gain_r;
+				this->VoiceGains(*voice, gain_l, gain_r);
+				active_voices_.emplace_back(std::max(gain_l, gain_r), voice);
+			}
+		}
+
+		// Only the most audible voices are mixed
+		uint32_t const num_real = std::min(static_cast<uint32_t>(active_voices_.size()), max_voices_);
+		if (num_real < active_voices_.size())
+		{
+			std::nth_element(active_voices_.begin(), active_voices_.begin() + num_real, active_voices_.end(),
+				[](std::pair<float, NullAudioVoice*> const & lhs, std::pair<float, NullAudioVoice*> const & rhs)
+				{
+					return lhs.first > rhs.first;
+				});
+		}
+
+		uint32_t underruns = 0;
+		for (size_t i = 0; i < active_voices_.size(); ++ i)
+		{
+			NullAudioVoice& voice = *active_voices_[i].second;
+			if (i < num_real)
+			{
+				float gain_l, gain_r;
+				this->VoiceGains(voice, gain_l, gain_r);
+				this->MixVoice(voice, gain_l, gain_r);
+			}
+
+			double const end_pos = voice.frac + static_cast<double>(MIX_FRAMES) * voice.freq / MIX_FREQ;
+			uint32_t const consumed = static_cast<uint32_t>(end_pos);
+			voice.frac = static_cast<float>(end_pos - consumed);
+			if (!voice.Advance(consumed))
+			{
+				voice.playing = false;
+			}
+			underruns += voice.underruns;
+		}
+
+		for (auto voice : voices_)
+		{
+			voice->Update();
+		}
+
+		float const * left = mix_left_.data();
+		float const * right = mix_right_.data();
+		float* out = output_.data();
+		uint32_t i = 0;
+#if defined(KLAYGE_SSE_SUPPORT)
+		__m128 const one = _mm_set1_ps(1.0f);
+		__m128 const neg_one = _mm_set1_ps(-1.0f);
+		for (; i + 4 <= MIX_FRAMES; i += 4)
+		{
+			__m128 const l = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(left + i), one), neg_one);
+			__m128 const r = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(right + i), one), neg_one);
+			_mm_storeu_ps(out + i * 2 + 0, _mm_unpacklo_ps(l, r));
+			_mm_storeu_ps(out + i * 2 + 4, _mm_unpackhi_ps(l, r));
+		}
+#endif
+		for (; i < MIX_FRAMES; ++ i)
+		{
+			out[i * 2 + 0] = MathLib::clamp(left[i], -1.0f, 1.0f);
+			out[i * 2 + 1] = MathLib::clamp(right[i], -1.0f, 1.0f);
+		}
+
+		sink_->Write(out, MIX_FRAMES);
+
+		stats_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::high_resolution_clock::now() - start).count();
+		stats_voice_blocks_ += num_real;
+		++ stats_blocks_;
+		if (stats_blocks_ >= STATS_BLOCKS)
+		{
+			stats_.num_voices = num_real;
+			stats_.num_virtual_voices = static_cast<uint32_t>(active_voices_.size()) - num_real;
+			stats_.ns_per_voice = static_cast<float>(stats_ns_) / std::max<uint64_t>(stats_voice_blocks_, 1);
+			stats_.underruns = underruns;
+
+			stats_ns_ = 0;
+			stats_voice_blocks_ = 0;
+			stats_blocks_ = 0;
+		}
+	}
+
+	void NullAudioEngine::VoiceGains(NullAudioVoice const & voice, float& gain_l, float& gain_r) const
+	{
+		// Like OpenAL, only mono sources are positioned
+		if (voice.channels != 1)
+		{
+			gain_l = gain_r = voice.volume;
+			return;
+		}
+
+		float3 const to_voice = voice.pos - pos_;
+		float const dist = MathLib::length(to_voice);
+		float const attenuation = REFERENCE_DISTANCE / std::max(dist, REFERENCE_DISTANCE);
+
+		float pan = 0;
+		float3 const right = MathLib::cross(up_, face_);
+		float const right_len = MathLib::length(right);
+		if ((dist > 1e-4f) && (right_len > 1e-4f))
+		{
+			pan = MathLib::clamp(MathLib::dot(to_voice, right) / (dist * right_len), -1.0f, 1.0f);
+		}
+
+		// Equal power panning
+		float const angle = (pan + 1) * PI / 4;
+		gain_l = voice.volume * attenuation * std::cos(angle);
+		gain_r = voice.volume * attenuation * std::sin(angle);
+	}
+
+	uint32_t NullAudioEngine::SourceFrames(NullAudioVoice const & voice, uint32_t num_frames) const
+	{
+		// Linear interpolation reads one frame past the last position, plus one more in case the float positions round up
+		return static_cast<uint32_t>(voice.frac + static_cast<double>(num_frames - 1) * voice.freq / MIX_FREQ) + 3;
+	}
+
+	void NullAudioEngine::MixVoice(NullAudioVoice& voice, float gain_l, float gain_r)
+	{
+		uint32_t const num_src = this->SourceFrames(voice, MIX_FRAMES);
+		if (src_left_.size() < num_src)
+		{
+			src_left_.resize(num_src);
+			src_right_.resize(num_src);
+		}
+
+		uint32_t const avail = voice.Peek(src_left_.data(), src_right_.data(), num_src);
+		std::fill(src_left_.begin() + avail, src_left_.begin() + num_src, 0.0f);
+		std::fill(src_right_.begin() + avail, src_right_.begin() + num_src, 0.0f);
+
+		float const * src_l = src_left_.data();
+		float const * src_r = (2 == voice.channels) ? src_right_.data() : src_left_.data();
+		float* mix_l = mix_left_.data();
+		float* mix_r = mix_right_.data();
+
+		float const step = static_cast<float>(voice.freq) / MIX_FREQ;
+		float const frac = voice.frac;
+		uint32_t i = 0;
+		if ((voice.freq == MIX_FREQ) && (0 == frac))
+		{
+#if defined(KLAYGE_SSE_SUPPORT)
+			__m128 const v_gain_l = _mm_set1_ps(gain_l);
+			__m128 const v_gain_r = _mm_set1_ps(gain_r);
+			for (; i + 4 <= MIX_FRAMES; i += 4)
+			{
+				_mm_storeu_ps(mix_l + i, _mm_add_ps(_mm_loadu_ps(mix_l + i), _mm_mul_ps(_mm_loadu_ps(src_l + i), v_gain_l)));
+				_mm_storeu_ps(mix_r + i, _mm_add_ps(_mm_loadu_ps(mix_r + i), _mm_mul_ps(_mm_loadu_ps(src_r + i), v_gain_r)));
+			}
+#endif
+			for (; i < MIX_FRAMES; ++ i)
+			{
+				mix_l[i] += src_l[i] * gain_l;
+				mix_r[i] += src_r[i] * gain_r;
+			}
+		}
+		else
+		{
+#if defined(KLAYGE_SSE_SUPPORT)
+			__m128 const v_gain_l = _mm_set1_ps(gain_l);
+			__m128 const v_gain_r = _mm_set1_ps(gain_r);
+			__m128 const v_step = _mm_set1_ps(step);
+			__m128 const lanes = _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), v_step);
+			alignas(16) int32_t idx[4];
+			for (; i + 4 <= MIX_FRAMES; i += 4)
+			{
+				__m128 const p = _mm_add_ps(_mm_set1_ps(frac + i * step), lanes);
+				__m128i const ip = _mm_cvttps_epi32(p);
+				__m128 const t = _mm_sub_ps(p, _mm_cvtepi32_ps(ip));
+				_mm_store_si128(reinterpret_cast<__m128i*>(idx), ip);
+
+				__m128 const l0 = _mm_set_ps(src_l[idx[3]], src_l[idx[2]], src_l[idx[1]], src_l[idx[0]]);
+				__m128 const l1 = _mm_set_ps(src_l[idx[3] + 1], src_l[idx[2] + 1], src_l[idx[1] + 1], src_l[idx[0] + 1]);
+				__m128 const r0 = _mm_set_ps(src_r[idx[3]], src_r[idx[2]], src_r[idx[1]], src_r[idx[0]]);
+				__m128 const r1 = _mm_set_ps(src_r[idx[3] + 1], src_r[idx[2] + 1], src_r[idx[1] + 1], src_r[idx[0] + 1]);
+				__m128 const l = _mm_add_ps(l0, _mm_mul_ps(_mm_sub_ps(l1, l0), t));
+				__m128 const r = _mm_add_ps(r0, _mm_mul_ps(_mm_sub_ps(r1, r0), t));
+
+				_mm_storeu_ps(mix_l + i, _mm_add_ps(_mm_loadu_ps(mix_l + i), _mm_mul_ps(l, v_gain_l)));
+				_mm_storeu_ps(mix_r + i, _mm_add_ps(_mm_loadu_ps(mix_r + i), _mm_mul_ps(r, v_gain_r)));
+			}
+#endif
+			for (; i < MIX_FRAMES; ++ i)
+			{
+				float const p = frac + i * step;
+				uint32_t const ip = static_cast<uint32_t>(p);
+				float const t = p - ip;
+				mix_l[i] += (src_l[ip] + (src_l[ip + 1] - src_l[ip]) * t) * gain_l;
+				mix_r[i] += (src_r[ip] + (src_r[ip + 1] - src_r[ip]) * t) * gain_r;
+			}
+		}
+	}
 }
@@ -0,0 +1,105 @@
+/**
+ * @file NullAudioSink.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/ErrorHandling.hpp>
+#include <KFL/Util.hpp>
+
+#include <cmath>
+
+#include <KlayGE/NullAudio/NullAudio.hpp>
+
+namespace KlayGE
+{
+	NullAudioDiscardSink::NullAudioDiscardSink()
+		: num_frames_(0)
+	{
+	}
+
+	void NullAudioDiscardSink::Write(float const * samples, uint32_t num_frames)
+	{
+		KFL_UNUSED(samples);
+		num_frames_ += num_frames;
+	}
+
+
+	NullAudioWavSink::NullAudioWavSink(std::string const & path, uint32_t freq)
+		: file_(path, std::ios_base::binary), freq_(freq), data_size_(0)
+	{
+		Verify(!file_.fail());
+		this->WriteHeader();
+	}
+
+	NullAudioWavSink::~NullAudioWavSink()
+	{
+		file_.seekp(0);
+		this->WriteHeader();
+	}
+
+	void NullAudioWavSink::Write(float const * samples, uint32_t num_frames)
+	{
+		pcm_.resize(num_frames * 2);
+		for (size_t i = 0; i < pcm_.size(); ++ i)
+		{
+			pcm_[i] = Native2LE(static_cast<int16_t>(std::lrint(samples[i] * 32767)));
+		}
+		file_.write(reinterpret_cast<char const *>(pcm_.data()), pcm_.size() * sizeof(pcm_[0]));
+		data_size_ += static_cast<uint32_t>(pcm_.size() * sizeof(pcm_[0]));
+	}
+
+	void NullAudioWavSink::WriteHeader()
+	{
+		uint16_t const num_channels = 2;
+		uint16_t const bits_per_sample = 16;
+		uint16_t const block_align = Native2LE<uint16_t>(num_channels * bits_per_sample / 8);
+		uint32_t const freq = Native2LE(freq_);
+		uint32_t const byte_rate = Native2LE(freq_ * num_channels * bits_per_sample / 8);
+		uint32_t const riff_size = Native2LE(36 + data_size_);
+		uint32_t const data_size = Native2LE(data_size_);
+		uint32_t const fmt_size = Native2LE<uint32_t>(16);
+		uint16_t const format_pcm = Native2LE<uint16_t>(1);
+		uint16_t const num_channels_le = Native2LE(num_channels);
+		uint16_t const bits_per_sample_le = Native2LE(bits_per_sample);
+
+		file_.write("RIFF", 4);
+		file_.write(reinterpret_cast<char const *>(&riff_size), sizeof(riff_size));
+		file_.write("WAVEfmt ", 8);
+		file_.write(reinterpret_cast<char const *>(&fmt_size), sizeof(fmt_size));
+		file_.write(reinterpret_cast<char const *>(&format_pcm), sizeof(format_pcm));
+		file_.write(reinterpret_cast<char const *>(&num_channels_le), sizeof(num_channels_le));
+		file_.write(reinterpret_cast<char const *>(&freq), sizeof(freq));
+		file_.write(reinterpret_cast<char const *>(&byte_rate), sizeof(byte_rate));
+		file_.write(reinterpret_cast<char const *>(&block_align), sizeof(block_align));
+		file_.write(reinterpret_cast<char const *>(&bits_per_sample_le), sizeof(bits_per_sample_le));
+		file_.write("data", 4);
+		file_.write(reinterpret_cast<char const *>(&data_size), sizeof(data_size));
+	}
+}
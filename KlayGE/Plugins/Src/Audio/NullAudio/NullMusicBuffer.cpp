@@ -1,5 +1,5 @@
 /**
- * @file NullMusicBuffer.hpp
+ * @file NullMusicBuffer.cpp
  * @author Minmin Gong
  *
  * @section DESCRIPTION
@@ -28,16 +28,119 @@
  * from http://www.klayge.org/licensing/.
  */
 
+
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/AudioDataSource.hpp>
+#include <KlayGE/AudioFactory.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 #include <KlayGE/NullAudio/NullAudio.hpp>
 
+namespace
+{
+	using namespace KlayGE;
+
+	// Frames decoded per data source read
+	uint32_t const READ_FRAMES = 4096;
+
+	uint32_t NumChannels(AudioFormat format)
+	{
+		return ((AF_Stereo8 == format) || (AF_Stereo16 == format)) ? 2 : 1;
+	}
+
+	bool Is16Bit(AudioFormat format)
+	{
+		return (AF_Mono16 == format) || (AF_Stereo16 == format);
+	}
+}
+
 namespace KlayGE
 {
+	NullMusicBuffer::MusicVoice::MusicVoice(NullMusicBuffer& buffer)
+		: buffer_(buffer)
+	{
+	}
+
+	uint32_t NullMusicBuffer::MusicVoice::Stage(uint32_t num_frames)
+	{
+		uint32_t const staged = static_cast<uint32_t>(stage_.size() / channels);
+		if (staged < num_frames)
+		{
+			size_t const old_size = stage_.size();
+			stage_.resize(old_size + (num_frames - staged) * channels);
+			size_t const popped = buffer_.ring_.pop(stage_.data() + old_size, stage_.size() - old_size);
+			stage_.resize(old_size + popped);
+		}
+		return std::min(num_frames, static_cast<uint32_t>(stage_.size() / channels));
+	}
+
+	uint32_t NullMusicBuffer::MusicVoice::Peek(float* left, float* right, uint32_t num_frames)
+	{
+		uint32_t const avail = this->Stage(num_frames);
+		if (2 == channels)
+		{
+			for (uint32_t i = 0; i < avail; ++ i)
+			{
+				left[i] = stage_[i * 2 + 0];
+				right[i] = stage_[i * 2 + 1];
+			}
+		}
+		else
+		{
+			std::memcpy(left, stage_.data(), avail * sizeof(float));
+		}
+		return avail;
+	}
+
+	bool NullMusicBuffer::MusicVoice::Advance(uint32_t num_frames)
+	{
+		uint32_t const avail = this->Stage(num_frames);
+		stage_.erase(stage_.begin(), stage_.begin() + avail * channels);
+		if (avail < num_frames)
+		{
+			if (buffer_.eof_ && buffer_.ring_.empty())
+			{
+				return false;
+			}
+
+			// The decoder fell behind
+			++ underruns;
+		}
+		return true;
+	}
+
+	void NullMusicBuffer::MusicVoice::Update()
+	{
+		if (playing && !buffer_.eof_ && !buffer_.decoding_ && (buffer_.ring_.read_available() < buffer_.ring_capacity_ / 2))
+		{
+			buffer_.decoding_ = true;
+			NullMusicBuffer* buffer = &buffer_;
+			buffer_.decode_thread_ = Context::Instance().ThreadPool()([buffer] { buffer->Decode(); });
+		}
+	}
+
+	void NullMusicBuffer::MusicVoice::Clear()
+	{
+		stage_.clear();
+	}
+
+
 	NullMusicBuffer::NullMusicBuffer(AudioDataSourcePtr const & data_source, uint32_t buffer_seconds, float volume)
-					: MusicBuffer(data_source)
+					: MusicBuffer(data_source),
+						engine_(checked_cast<NullAudioEngine&>(Context::Instance().AudioFactoryInstance().AudioEngineInstance())),
+						voice_(*this),
+						ring_(std::max(buffer_seconds, 1U) * freq_ * NumChannels(format_)),
+						ring_capacity_(std::max(buffer_seconds, 1U) * freq_ * NumChannels(format_)),
+						decoding_(false), stop_decoding_(false), eof_(false),
+						loop_(false), at_start_(false)
 	{
-		KFL_UNUSED(buffer_seconds);
+		voice_.channels = NumChannels(format_);
+		voice_.freq = freq_;
+		engine_.AddVoice(&voice_);
 
 		this->Position(float3::Zero());
 		this->Velocity(float3::Zero());
@@ -50,41 +153,133 @@ namespace KlayGE
 
 	NullMusicBuffer::~NullMusicBuffer()
 	{
-		this->Stop();
+		this->StopStreaming();
+		engine_.RemoveVoice(&voice_);
+	}
+
+	// Runs on a thread pool thread while the mixer drains the ring, or synchronously when nothing else touches it
+	void NullMusicBuffer::Decode()
+	{
+		uint32_t const channels = voice_.channels;
+		uint32_t const sample_size = Is16Bit(format_) ? 2 : 1;
+
+		std::vector<uint8_t> data(READ_FRAMES * channels * sample_size);
+		std::vector<float> samples(READ_FRAMES * channels);
+		bool rewound = false;
+		while (!stop_decoding_ && (ring_.write_available() >= samples.size()))
+		{
+			size_t num_samples = data_source_->Read(data.data(), data.size()) / sample_size;
+			num_samples -= num_samples % channels;
+			if (0 == num_samples)
+			{
+				if (loop_ && !rewound)
+				{
+					data_source_->Reset();
+					rewound = true;
+					continue;
+				}
+
+				eof_ = true;
+				break;
+			}
+			rewound = false;
+
+			if (2 == sample_size)
+			{
+				for (size_t i = 0; i < num_samples; ++ i)
+				{
+					int16_t s16;
+					std::memcpy(&s16, &data[i * 2], sizeof(s16));
+					samples[i] = LE2Native(s16) / 32768.0f;
+				}
+			}
+			else
+			{
+				for (size_t i = 0; i < num_samples; ++ i)
+				{
+					samples[i] = (data[i] - 128) / 128.0f;
+				}
+			}
+			ring_.push(samples.data(), num_samples);
+		}
+
+		decoding_ = false;
+	}
+
+	void NullMusicBuffer::StopStreaming()
+	{
+		joiner<void> decode_thread;
+		{
+			std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+			voice_.playing = false;
+			decode_thread = decode_thread_;
+			decode_thread_ = joiner<void>();
+		}
+
+		if (decode_thread != joiner<void>())
+		{
+			stop_decoding_ = true;
+			decode_thread();
+			stop_decoding_ = false;
+		}
+		decoding_ = false;
 	}
 
 	void NullMusicBuffer::DoReset()
 	{
+		this->StopStreaming();
+
 		data_source_->Reset();
+		ring_.reset();
+		voice_.Clear();
+		eof_ = false;
+
+		// Prefill so playback starts without waiting on the decoder
+		this->Decode();
+		at_start_ = true;
 	}
 
 	void NullMusicBuffer::DoPlay(bool loop)
 	{
-		KFL_UNUSED(loop);
+		loop_ = loop;
+		if (!at_start_)
+		{
+			this->DoReset();
+		}
+		at_start_ = false;
+
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		voice_.frac = 0;
+		voice_.playing = true;
 	}
 
 	void NullMusicBuffer::DoStop()
 	{
+		this->StopStreaming();
 	}
 
 	bool NullMusicBuffer::IsPlaying() const
 	{
-		return false;
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		return voice_.playing;
 	}
 
 	void NullMusicBuffer::Volume(float vol)
 	{
-		KFL_UNUSED(vol);
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		voice_.volume = vol;
 	}
 
 	float3 NullMusicBuffer::Position() const
 	{
-		return pos_;
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		return voice_.pos;
 	}
 
 	void NullMusicBuffer::Position(float3 const & v)
 	{
-		pos_ = v;
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		voice_.pos = v;
 	}
 
 	float3 NullMusicBuffer::Velocity() const
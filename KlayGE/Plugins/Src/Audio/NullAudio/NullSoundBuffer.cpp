@@ -28,16 +28,107 @@
  * from http://www.klayge.org/licensing/.
  */
 
+
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/AudioDataSource.hpp>
+#include <KlayGE/AudioFactory.hpp>
+#include <KlayGE/Context.hpp>
+
+#include <algorithm>
+#include <cstring>
 
 #include <KlayGE/NullAudio/NullAudio.hpp>
 
 namespace KlayGE
 {
+	NullSoundBuffer::SoundVoice::SoundVoice(NullSoundBuffer const & buffer)
+		: buffer(buffer), cursor(0), loop(false)
+	{
+	}
+
+	uint32_t NullSoundBuffer::SoundVoice::Peek(float* left, float* right, uint32_t num_frames)
+	{
+		uint32_t const total = buffer.num_frames_;
+		uint32_t copied = 0;
+		uint32_t pos = cursor;
+		while ((copied < num_frames) && (pos < total))
+		{
+			uint32_t const n = std::min(num_frames - copied, total - pos);
+			std::memcpy(left + copied, &buffer.left_[pos], n * sizeof(float));
+			if (2 == channels)
+			{
+				std::memcpy(right + copied, &buffer.right_[pos], n * sizeof(float));
+			}
+			copied += n;
+			pos += n;
+			if (loop && (pos == total))
+			{
+				pos = 0;
+			}
+		}
+		return copied;
+	}
+
+	bool NullSoundBuffer::SoundVoice::Advance(uint32_t num_frames)
+	{
+		uint32_t const total = buffer.num_frames_;
+		cursor += num_frames;
+		if (cursor >= total)
+		{
+			if (!loop || (0 == total))
+			{
+				return false;
+			}
+			cursor %= total;
+		}
+		return true;
+	}
+
+
 	NullSoundBuffer::NullSoundBuffer(AudioDataSourcePtr const & data_source, uint32_t num_sources, float volume)
-					: SoundBuffer(data_source)
+					: SoundBuffer(data_source),
+						engine_(checked_cast<NullAudioEngine&>(Context::Instance().AudioFactoryInstance().AudioEngineInstance()))
 	{
-		KFL_UNUSED(num_sources);
+		std::vector<uint8_t> data(data_source_->Size());
+		data.resize(data_source_->Read(data.data(), data.size()));
+
+		// Decode once to planar float so the mixer can read it directly
+		uint32_t const channels = ((AF_Stereo8 == format_) || (AF_Stereo16 == format_)) ? 2 : 1;
+		bool const is_16_bit = (AF_Mono16 == format_) || (AF_Stereo16 == format_);
+		num_frames_ = static_cast<uint32_t>(data.size() / (channels * (is_16_bit ? 2 : 1)));
+		left_.resize(num_frames_);
+		if (2 == channels)
+		{
+			right_.resize(num_frames_);
+		}
+		for (uint32_t i = 0; i < num_frames_; ++ i)
+		{
+			for (uint32_t c = 0; c < channels; ++ c)
+			{
+				float sample;
+				if (is_16_bit)
+				{
+					int16_t s16;
+					std::memcpy(&s16, &data[(i * channels + c) * 2], sizeof(s16));
+					sample = LE2Native(s16) / 32768.0f;
+				}
+				else
+				{
+					sample = (data[i * channels + c] - 128) / 128.0f;
+				}
+				(0 == c ? left_ : right_)[i] = sample;
+			}
+		}
+
+		for (uint32_t i = 0; i < std::max(num_sources, 1U); ++ i)
+		{
+			auto voice = MakeUniquePtr<SoundVoice>(*this);
+			voice->channels = channels;
+			voice->freq = freq_;
+			engine_.AddVoice(voice.get());
+			voices_.push_back(std::move(voice));
+		}
 
 		this->Position(float3(0, 0, 0));
 		this->Velocity(float3(0, 0, 0));
@@ -51,29 +142,77 @@ namespace KlayGE
 	NullSoundBuffer::~NullSoundBuffer()
 	{
 		this->Stop();
+
+		for (auto const & voice : voices_)
+		{
+			engine_.RemoveVoice(voice.get());
+		}
 	}
 
 	void NullSoundBuffer::Play(bool loop)
 	{
-		KFL_UNUSED(loop);
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+
+		// Take a free voice, or cut off the one that has played the longest
+		SoundVoice* voice = voices_[0].get();
+		for (auto const & v : voices_)
+		{
+			if (!v->playing)
+			{
+				voice = v.get();
+				break;
+			}
+			if (v->cursor > voice->cursor)
+			{
+				voice = v.get();
+			}
+		}
+
+		voice->cursor = 0;
+		voice->frac = 0;
+		voice->loop = loop;
+		voice->playing = true;
 	}
 
 	void NullSoundBuffer::Stop()
 	{
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		for (auto const & voice : voices_)
+		{
+			voice->playing = false;
+		}
 	}
 
 	void NullSoundBuffer::DoReset()
 	{
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		for (auto const & voice : voices_)
+		{
+			voice->cursor = 0;
+			voice->frac = 0;
+		}
 	}
 
 	bool NullSoundBuffer::IsPlaying() const
 	{
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		for (auto const & voice : voices_)
+		{
+			if (voice->playing)
+			{
+				return true;
+			}
+		}
 		return false;
 	}
 
 	void NullSoundBuffer::Volume(float vol)
 	{
-		KFL_UNUSED(vol);
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
+		for (auto const & voice : voices_)
+		{
+			voice->volume = vol;
+		}
 	}
 
 	float3 NullSoundBuffer::Position() const
@@ -83,7 +222,12 @@ namespace KlayGE
 
 	void NullSoundBuffer::Position(float3 const & v)
 	{
+		std::lock_guard<std::mutex> lock(engine_.VoiceMutex());
 		pos_ = v;
+		for (auto const & voice : voices_)
+		{
+			voice->pos = v;
+		}
 	}
 
 	float3 NullSoundBuffer::Velocity() const
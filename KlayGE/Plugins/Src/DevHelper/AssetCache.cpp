@@ -0,0 +1,543 @@
+/**
+ * @file AssetCache.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/ErrorHandling.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <KlayGE/ResLoader.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/Texture.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <KlayGE/DevHelper/MeshMetadata.hpp>
+#include <KlayGE/DevHelper/TexMetadata.hpp>
+#include <KlayGE/DevHelper/AssetCache.hpp>
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint64_t Rotl64(uint64_t x, uint32_t r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	uint64_t FMix64(uint64_t k)
+	{
+		k ^= k >> 33;
+		k *= 0xFF51AFD7ED558CCDULL;
+		k ^= k >> 33;
+		k *= 0xC4CEB9FE1A85EC53ULL;
+		k ^= k >> 33;
+		return k;
+	}
+
+	// MurmurHash3 x64 128-bit. Strong enough to tell artifacts apart, and fast enough to hash every source file on each JIT.
+	std::array<uint64_t, 2> MurmurHash3(void const * data, size_t len, uint64_t seed)
+	{
+		uint64_t const C1 = 0x87C37B91114253D5ULL;
+		uint64_t const C2 = 0x4CF5AD432745937FULL;
+
+		uint8_t const * bytes = static_cast<uint8_t const *>(data);
+		size_t const num_blocks = len / 16;
+
+		uint64_t h1 = seed;
+		uint64_t h2 = seed;
+		for (size_t i = 0; i < num_blocks; ++ i)
+		{
+			uint64_t k1;
+			uint64_t k2;
+			std::memcpy(&k1, bytes + i * 16, sizeof(k1));
+			std::memcpy(&k2, bytes + i * 16 + 8, sizeof(k2));
+			k1 = LE2Native(k1);
+			k2 = LE2Native(k2);
+
+			k1 *= C1;
+			k1 = Rotl64(k1, 31);
+			k1 *= C2;
+			h1 ^= k1;
+			h1 = Rotl64(h1, 27);
+			h1 += h2;
+			h1 = h1 * 5 + 0x52DCE729;
+
+			k2 *= C2;
+			k2 = Rotl64(k2, 33);
+			k2 *= C1;
+			h2 ^= k2;
+			h2 = Rotl64(h2, 31);
+			h2 += h1;
+			h2 = h2 * 5 + 0x38495AB5;
+		}
+
+		uint8_t const * tail = bytes + num_blocks * 16;
+		size_t const rem = len & 15;
+		uint64_t k1 = 0;
+		uint64_t k2 = 0;
+		for (size_t i = rem; i > 8; -- i)
+		{
+			k2 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 9) * 8);
+		}
+		if (rem > 8)
+		{
+			k2 *= C2;
+			k2 = Rotl64(k2, 33);
+			k2 *= C1;
+			h2 ^= k2;
+		}
+		for (size_t i = std::min<size_t>(rem, 8); i > 0; -- i)
+		{
+			k1 ^= static_cast<uint64_t>(tail[i - 1]) << ((i - 1) * 8);
+		}
+		if (rem > 0)
+		{
+			k1 *= C1;
+			k1 = Rotl64(k1, 31);
+			k1 *= C2;
+			h1 ^= k1;
+		}
+
+		h1 ^= len;
+		h2 ^= len;
+		h1 += h2;
+		h2 += h1;
+		h1 = FMix64(h1);
+		h2 = FMix64(h2);
+		h1 += h2;
+		h2 += h1;
+
+		return { { h1, h2 } };
+	}
+
+	// Hashes each piece on its own and chains the digests, so large sources never have to be concatenated
+	class KeyBuilder
+	{
+	public:
+		KeyBuilder(std::string_view kind, uint32_t format_version)
+		{
+			this->AddString(kind);
+			this->AddUInt(AssetCache::CONVERTER_VERSION);
+			this->AddUInt(format_version);
+		}
+
+		void AddBytes(void const * data, size_t len)
+		{
+			auto const hash = MurmurHash3(data, len, len);
+			digests_.insert(digests_.end(), hash.begin(), hash.end());
+		}
+
+		void AddString(std::string_view str)
+		{
+			this->AddBytes(str.data(), str.size());
+		}
+
+		void AddUInt(uint32_t value)
+		{
+			value = Native2LE(value);
+			this->AddBytes(&value, sizeof(value));
+		}
+
+		void AddFloat(float value)
+		{
+			uint32_t bits;
+			std::memcpy(&bits, &value, sizeof(bits));
+			this->AddUInt(bits);
+		}
+
+		bool AddFile(std::string_view name)
+		{
+			ResIdentifierPtr file = ResLoader::Instance().Open(name);
+			if (!file)
+			{
+				return false;
+			}
+
+			file->seekg(0, std::ios_base::end);
+			std::vector<uint8_t> content(static_cast<size_t>(file->tellg()));
+			file->seekg(0, std::ios_base::beg);
+			file->read(content.data(), content.size());
+			this->AddBytes(content.data(), content.size());
+			return true;
+		}
+
+		// A missing optional file still changes the key, so adding one later invalidates the artifact
+		void AddOptionalFile(std::string_view name)
+		{
+			if (name.empty() || !this->AddFile(name))
+			{
+				this->AddUInt(0);
+			}
+		}
+
+		std::string Key() const
+		{
+			auto const hash = MurmurHash3(digests_.data(), digests_.size() * sizeof(digests_[0]), 0);
+
+			static char const HEX_DIGITS[] = "0123456789abcdef";
+			std::string key(32, '0');
+			for (size_t i = 0; i < hash.size(); ++ i)
+			{
+				for (uint32_t j = 0; j < 16; ++ j)
+				{
+					key[i * 16 + j] = HEX_DIGITS[(hash[i] >> ((15 - j) * 4)) & 0xF];
+				}
+			}
+			return key;
+		}
+
+	private:
+		std::vector<uint64_t> digests_;
+	};
+
+	// An artifact is only usable if the loader accepts its header. Keys already cover the format versions, this catches
+	// artifacts written by a build that forgot to bump one.
+	bool IsCurrentArtifact(std::filesystem::path const & artifact_path)
+	{
+		std::ifstream ifs(artifact_path, std::ios_base::binary);
+		uint32_t header[2];
+		if (!ifs.read(reinterpret_cast<char*>(header), sizeof(header)))
+		{
+			return false;
+		}
+
+		uint32_t const fourcc = LE2Native(header[0]);
+		uint32_t const ver = LE2Native(header[1]);
+		return ((fourcc == MODEL_BIN_FOURCC) && (ver == MODEL_BIN_VERSION))
+			|| ((fourcc == TEXTURE_BIN_FOURCC) && (ver == TEXTURE_BIN_VERSION));
+	}
+
+	// Sidecar files are listed relative to the directory of the input, so checkouts at other places share the list
+	std::string ModelKeyWithSidecars(std::string const & source_key, std::string_view input_name,
+		std::vector<std::string> const & sidecar_names)
+	{
+		if (sidecar_names.empty())
+		{
+			return source_key;
+		}
+
+		std::filesystem::path const input_dir = std::filesystem::path(ResLoader::Instance().Locate(input_name)).parent_path();
+
+		KeyBuilder builder("model_sidecars", MODEL_BIN_VERSION);
+		builder.AddString(source_key);
+		for (auto const & name : sidecar_names)
+		{
+			builder.AddString(name);
+
+			std::filesystem::path path(name);
+			if (path.is_relative())
+			{
+				path = input_dir / path;
+			}
+			builder.AddOptionalFile(path.string());
+		}
+		return builder.Key();
+	}
+
+	std::string DefaultCacheDirectory()
+	{
+		char const * dir = std::getenv("KLAYGE_ASSET_CACHE_DIR");
+		if (dir && (dir[0] != '\0'))
+		{
+			return dir;
+		}
+
+		std::error_code ec;
+		auto const temp_dir = std::filesystem::temp_directory_path(ec);
+		if (ec)
+		{
+			return "KlayGEAssetCache";
+		}
+		return (temp_dir / "KlayGEAssetCache").string();
+	}
+}
+
+namespace KlayGE
+{
+	AssetCache::AssetCache()
+		: AssetCache(DefaultCacheDirectory())
+	{
+	}
+
+	AssetCache::AssetCache(std::string_view cache_dir)
+		: cache_dir_(cache_dir)
+	{
+	}
+
+	AssetCache& AssetCache::Instance()
+	{
+		static AssetCache cache;
+		return cache;
+	}
+
+	std::string AssetCache::ModelKey(std::string_view input_name, std::string_view metadata_name,
+		MeshMetadata const & metadata) const
+	{
+		std::string const source_key = this->ModelSourceKey(input_name, metadata_name, metadata);
+		if (source_key.empty())
+		{
+			return source_key;
+		}
+
+		// Sources that pulled in other files on an earlier conversion have them listed next to the artifacts
+		std::vector<std::string> sidecar_names;
+		std::ifstream ifs(this->SidecarListPath(source_key));
+		std::string name;
+		while (std::getline(ifs, name))
+		{
+			if (!name.empty())
+			{
+				sidecar_names.push_back(name);
+			}
+		}
+
+		return ModelKeyWithSidecars(source_key, input_name, sidecar_names);
+	}
+
+	std::string AssetCache::RecordModelSidecars(std::string_view input_name, std::string_view metadata_name,
+		MeshMetadata const & metadata, std::vector<std::string> const & sidecar_files)
+	{
+		std::string const source_key = this->ModelSourceKey(input_name, metadata_name, metadata);
+		if (source_key.empty())
+		{
+			return source_key;
+		}
+
+		std::string const input_dir
+			= std::filesystem::path(ResLoader::Instance().Locate(input_name)).parent_path().generic_string() + '/';
+		std::vector<std::string> sidecar_names;
+		for (auto const & file : sidecar_files)
+		{
+			std::string name = std::filesystem::path(file).generic_string();
+			if (name.compare(0, input_dir.size(), input_dir) == 0)
+			{
+				name = name.substr(input_dir.size());
+			}
+			sidecar_names.push_back(name);
+		}
+		std::sort(sidecar_names.begin(), sidecar_names.end());
+		sidecar_names.erase(std::unique(sidecar_names.begin(), sidecar_names.end()), sidecar_names.end());
+
+		if (!sidecar_names.empty())
+		{
+			std::filesystem::path const list_path(this->SidecarListPath(source_key));
+			std::filesystem::path const tmp_path(this->TempPath(list_path.string()));
+
+			std::error_code ec;
+			std::filesystem::create_directories(list_path.parent_path(), ec);
+			{
+				std::ofstream ofs(tmp_path);
+				for (auto const & name : sidecar_names)
+				{
+					ofs << name << '\n';
+				}
+			}
+			std::filesystem::rename(tmp_path, list_path, ec);
+			if (ec)
+			{
+				LogWarn() << "Could NOT record the sidecar files of " << input_name << " in the asset cache: " << ec.message()
+					<< std::endl;
+				std::filesystem::remove(tmp_path, ec);
+			}
+		}
+
+		return ModelKeyWithSidecars(source_key, input_name, sidecar_names);
+	}
+
+	std::string AssetCache::ModelSourceKey(std::string_view input_name, std::string_view metadata_name,
+		MeshMetadata const & metadata) const
+	{
+		KeyBuilder builder("model", MODEL_BIN_VERSION);
+		if (!builder.AddFile(input_name))
+		{
+			return std::string();
+		}
+		builder.AddOptionalFile(metadata_name);
+
+		for (uint32_t lod = 1; lod < metadata.NumLods(); ++ lod)
+		{
+			builder.AddOptionalFile(metadata.LodFileName(lod));
+		}
+		for (uint32_t mtl = 0; mtl < metadata.NumMaterials(); ++ mtl)
+		{
+			builder.AddOptionalFile(metadata.MaterialFileName(mtl));
+		}
+
+		return builder.Key();
+	}
+
+	std::string AssetCache::TextureKey(std::string_view input_name, TexMetadata const & metadata) const
+	{
+		KeyBuilder builder("texture", TEXTURE_BIN_VERSION);
+		if (!builder.AddFile(input_name))
+		{
+			return std::string();
+		}
+
+		// Tools fill in defaults per texture type, and the output format comes from the device caps, so the key is built
+		// from the effective settings instead of the .kmeta file
+		builder.AddUInt(metadata.Type());
+		builder.AddUInt(metadata.Slot());
+		uint64_t const format = metadata.PreferedFormat();
+		builder.AddUInt(static_cast<uint32_t>(format));
+		builder.AddUInt(static_cast<uint32_t>(format >> 32));
+		builder.AddUInt(metadata.ForceSRGB());
+		for (uint32_t ch = 0; ch < 4; ++ ch)
+		{
+			builder.AddUInt(static_cast<uint32_t>(metadata.ChannelMapping(ch)));
+		}
+		builder.AddUInt(metadata.RgbToLum());
+		builder.AddUInt(metadata.MipmapEnabled());
+		builder.AddUInt(metadata.AutoGenMipmap());
+		builder.AddUInt(metadata.NumMipmaps());
+		builder.AddUInt(metadata.LinearMipmap());
+		builder.AddUInt(metadata.BumpToNormal());
+		builder.AddFloat(metadata.BumpScale());
+		builder.AddUInt(metadata.BumpToOcclusion());
+		builder.AddFloat(metadata.OcclusionAmplitude());
+		builder.AddUInt(metadata.NormalToHeight());
+		builder.AddFloat(metadata.HeightMinZ());
+
+		builder.AddUInt(metadata.ArraySize());
+		for (uint32_t arr = 0; arr < metadata.ArraySize(); ++ arr)
+		{
+			for (uint32_t mip = 0; mip < metadata.NumPlaneMipmaps(arr); ++ mip)
+			{
+				if ((arr != 0) || (mip != 0))
+				{
+					builder.AddOptionalFile(metadata.PlaneFileName(arr, mip));
+				}
+			}
+		}
+
+		return builder.Key();
+	}
+
+	bool AssetCache::Fetch(std::string_view key, std::string_view output_name)
+	{
+		if (key.empty())
+		{
+			return false;
+		}
+
+		std::filesystem::path const artifact_path(this->ArtifactPath(key, output_name));
+		std::filesystem::path const output_path(output_name.begin(), output_name.end());
+
+		std::error_code ec;
+		if (!std::filesystem::is_regular_file(artifact_path, ec))
+		{
+			++ num_misses_;
+			return false;
+		}
+		if (!IsCurrentArtifact(artifact_path))
+		{
+			LogWarn() << "Discarding stale artifact " << artifact_path.string() << std::endl;
+			std::filesystem::remove(artifact_path, ec);
+			++ num_misses_;
+			return false;
+		}
+
+		if (output_path.has_parent_path())
+		{
+			std::filesystem::create_directories(output_path.parent_path(), ec);
+		}
+		std::filesystem::copy_file(artifact_path, output_path, std::filesystem::copy_options::overwrite_existing, ec);
+		if (ec)
+		{
+			LogWarn() << "Could NOT copy " << artifact_path.string() << " to " << output_name << ": " << ec.message()
+				<< std::endl;
+			++ num_misses_;
+			return false;
+		}
+
+		++ num_hits_;
+		return true;
+	}
+
+	void AssetCache::Store(std::string_view key, std::string_view output_name)
+	{
+		if (key.empty())
+		{
+			return;
+		}
+
+		std::filesystem::path const artifact_path(this->ArtifactPath(key, output_name));
+
+		// Copy to a unique name and rename, so concurrent builds from other checkouts never see a partial artifact
+		std::filesystem::path const tmp_path(this->TempPath(artifact_path.string()));
+
+		std::error_code ec;
+		std::filesystem::create_directories(artifact_path.parent_path(), ec);
+		std::filesystem::copy_file(std::filesystem::path(output_name.begin(), output_name.end()), tmp_path,
+			std::filesystem::copy_options::overwrite_existing, ec);
+		if (!ec)
+		{
+			std::filesystem::rename(tmp_path, artifact_path, ec);
+		}
+		if (ec)
+		{
+			LogWarn() << "Could NOT store " << output_name << " in the asset cache: " << ec.message() << std::endl;
+			std::filesystem::remove(tmp_path, ec);
+		}
+	}
+
+	std::string AssetCache::SidecarListPath(std::string_view source_key) const
+	{
+		BOOST_ASSERT(source_key.size() > 2);
+
+		std::filesystem::path list_path = std::filesystem::path(cache_dir_) / std::string(source_key.substr(0, 2));
+		list_path /= std::string(source_key) + ".sidecars";
+		return list_path.string();
+	}
+
+	std::string AssetCache::TempPath(std::string const & path)
+	{
+		return path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "_"
+			+ std::to_string(num_stores_ ++) + ".tmp";
+	}
+
+	std::string AssetCache::ArtifactPath(std::string_view key, std::string_view output_name) const
+	{
+		BOOST_ASSERT(key.size() > 2);
+
+		std::filesystem::path const output_path(output_name.begin(), output_name.end());
+		std::filesystem::path artifact_path = std::filesystem::path(cache_dir_) / std::string(key.substr(0, 2));
+		artifact_path /= std::string(key) + output_path.extension().string();
+		return artifact_path.string();
+	}
+}
@@ -36,6 +36,7 @@
 #include <string>
 
 #include <KlayGE/DevHelper.hpp>
+#include <KlayGE/DevHelper/AssetCache.hpp>
 #include <KlayGE/DevHelper/MeshMetadata.hpp>
 #include <KlayGE/DevHelper/MeshConverter.hpp>
 #include <KlayGE/DevHelper/TexMetadata.hpp>
@@ -61,17 +62,22 @@ namespace KlayGE
 				metadata.Load(metadata_name);
 			}
 
-			MeshConverter mc;
-			auto model = mc.Load(input_name, metadata);
+			std::string const output_path = this->OutputPath(input_name, output_name);
 
-			std::filesystem::path input_path(input_name.begin(), input_name.end());
-			std::filesystem::path output_path(output_name.begin(), output_name.end());
-			if (output_path.parent_path() == input_path.parent_path())
+			auto& cache = AssetCache::Instance();
+			std::string const key = cache.ModelKey(input_name, metadata_name, metadata);
+			if (cache.Fetch(key, output_path))
 			{
-				output_path = std::filesystem::path(ResLoader::Instance().Locate(input_name)).parent_path() / output_path.filename();
+				return LoadSoftwareModel(output_path);
 			}
 
-			mc.Save(*model, output_path.string());
+			MeshConverter mc;
+			auto model = mc.Load(input_name, metadata);
+			if (model)
+			{
+				mc.Save(*model, output_path);
+				cache.Store(cache.RecordModelSidecars(input_name, metadata_name, metadata, mc.ImportedFiles()), output_path);
+			}
 
 			return model;
 		}
@@ -81,17 +87,22 @@ namespace KlayGE
 		{
 			auto metadata = this->LoadTexMetadata(metadata_name, caps);
 
-			TexConverter tc;
-			auto texture = tc.Load(input_name, metadata);
+			std::string const output_path = this->OutputPath(input_name, output_name);
 
-			std::filesystem::path input_path(input_name.begin(), input_name.end());
-			std::filesystem::path output_path(output_name.begin(), output_name.end());
-			if (output_path.parent_path() == input_path.parent_path())
+			auto& cache = AssetCache::Instance();
+			std::string const key = cache.TextureKey(input_name, metadata);
+			if (cache.Fetch(key, output_path))
 			{
-				output_path = std::filesystem::path(ResLoader::Instance().Locate(input_name)).parent_path() / output_path.filename();
+				return LoadSoftwareTexture(output_path);
 			}
 
-			SaveTexture(texture, output_path.string());
+			TexConverter tc;
+			auto texture = tc.Load(input_name, metadata);
+			if (texture)
+			{
+				SaveTexture(texture, output_path);
+				cache.Store(key, output_path);
+			}
 
 			return texture;
 		}
@@ -109,6 +120,19 @@ namespace KlayGE
 		}
 
 	private:
+		std::string OutputPath(std::string_view input_name, std::string_view output_name)
+		{
+			std::filesystem::path input_path(input_name.begin(), input_name.end());
+			std::filesystem::path output_path(output_name.begin(), output_name.end());
+			if (output_path.parent_path() == input_path.parent_path())
+			{
+				output_path = std::filesystem::path(ResLoader::Instance().Locate(input_name)).parent_path() / output_path.filename();
+			}
+			return output_path.string();
+		}
+
+		// Matches PlatformDeployer for textures with a .kmeta. Without one, the batch conversion applies defaults per
+		// texture type, which aren't known here, so their artifacts are keyed apart.
 		KlayGE::TexMetadata LoadTexMetadata(std::string_view metadata_name, RenderDeviceCaps const * caps)
 		{
 			KlayGE::TexMetadata metadata;
@@ -38,11 +38,15 @@
 #include <KlayGE/RenderMaterial.hpp>
 #include <KlayGE/ResLoader.hpp>
 
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <numeric>
 
 #include <assimp/cimport.h>
 #include <assimp/cexport.h>
+#include <assimp/cfileio.h>
 #include <assimp/postprocess.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -188,15 +192,168 @@ namespace
 		}
 	}
 
+	// Encodes a value in [-1, 1] the way the GPU decodes SNORM16, max(v / 32767, -1)
+	int16_t QuantizeSNorm16(float v)
+	{
+		return static_cast<int16_t>(MathLib::clamp(static_cast<int32_t>(std::lround(v * 32767)), -32767, 32767));
+	}
+
+	float DequantizeSNorm16(int16_t v)
+	{
+		return std::max(v / 32767.0f, -1.0f);
+	}
+
+	uint32_t QuantizeUNorm(float v, uint32_t bits)
+	{
+		uint32_t const max_val = (1UL << bits) - 1;
+		return static_cast<uint32_t>(MathLib::clamp(v, 0.0f, 1.0f) * max_val + 0.5f);
+	}
+
+	// Serves the file accesses of Assimp with stdio and records every file it opens. Importers pull in files the
+	// caller never names, such as the .mtl of an .obj or the .bin of a .gltf.
+	class RecordingFileIO
+	{
+	public:
+		RecordingFileIO()
+		{
+			io_.OpenProc = &RecordingFileIO::Open;
+			io_.CloseProc = &RecordingFileIO::Close;
+			io_.UserData = reinterpret_cast<aiUserData>(this);
+		}
+
+		aiFileIO* FileIO()
+		{
+			return &io_;
+		}
+
+		std::vector<std::string> const & OpenedFiles() const
+		{
+			return opened_files_;
+		}
+
+	private:
+		static aiFile* Open(aiFileIO* io, char const * name, char const * mode)
+		{
+			std::FILE* fp = std::fopen(name, mode);
+			if (fp == nullptr)
+			{
+				return nullptr;
+			}
+
+			auto& opened_files = reinterpret_cast<RecordingFileIO*>(io->UserData)->opened_files_;
+			if (std::find(opened_files.begin(), opened_files.end(), name) == opened_files.end())
+			{
+				opened_files.push_back(name);
+			}
+
+			auto* file = new aiFile;
+			file->ReadProc = &RecordingFileIO::Read;
+			file->WriteProc = &RecordingFileIO::Write;
+			file->TellProc = &RecordingFileIO::Tell;
+			file->FileSizeProc = &RecordingFileIO::FileSize;
+			file->SeekProc = &RecordingFileIO::Seek;
+			file->FlushProc = &RecordingFileIO::Flush;
+			file->UserData = reinterpret_cast<aiUserData>(fp);
+			return file;
+		}
+
+		static void Close(aiFileIO* io, aiFile* file)
+		{
+			KFL_UNUSED(io);
+
+			std::fclose(Stream(file));
+			delete file;
+		}
+
+		static size_t Read(aiFile* file, char* buffer, size_t size, size_t count)
+		{
+			return std::fread(buffer, size, count, Stream(file));
+		}
+
+		static size_t Write(aiFile* file, char const * buffer, size_t size, size_t count)
+		{
+			return std::fwrite(buffer, size, count, Stream(file));
+		}
+
+		static size_t Tell(aiFile* file)
+		{
+			return static_cast<size_t>(std::ftell(Stream(file)));
+		}
+
+		static size_t FileSize(aiFile* file)
+		{
+			std::FILE* fp = Stream(file);
+			long const pos = std::ftell(fp);
+			std::fseek(fp, 0, SEEK_END);
+			long const size = std::ftell(fp);
+			std::fseek(fp, pos, SEEK_SET);
+			return static_cast<size_t>(size);
+		}
+
+		static aiReturn Seek(aiFile* file, size_t offset, aiOrigin origin)
+		{
+			int whence;
+			switch (origin)
+			{
+			case aiOrigin_SET:
+				whence = SEEK_SET;
+				break;
+
+			case aiOrigin_CUR:
+				whence = SEEK_CUR;
+				break;
+
+			default:
+				whence = SEEK_END;
+				break;
+			}
+
+			// Negative offsets come in wrapped around
+			return (std::fseek(Stream(file), static_cast<long>(offset), whence) == 0) ? aiReturn_SUCCESS : aiReturn_FAILURE;
+		}
+
+		static void Flush(aiFile* file)
+		{
+			std::fflush(Stream(file));
+		}
+
+		static std::FILE* Stream(aiFile* file)
+		{
+			return reinterpret_cast<std::FILE*>(file->UserData);
+		}
+
+	private:
+		aiFileIO io_;
+		std::vector<std::string> opened_files_;
+	};
+
 	class MeshLoader
 	{
 	public:
 		RenderModelPtr Load(std::string_view input_name, MeshMetadata const & metadata);
 
+		MeshConverter::VertexCacheStats const & InputVertexCacheStats() const
+		{
+			return input_vertex_cache_stats_;
+		}
+		MeshConverter::VertexCacheStats const & OutputVertexCacheStats() const
+		{
+			return output_vertex_cache_stats_;
+		}
+		std::vector<std::string> const & ImportedFiles() const
+		{
+			return imported_files_;
+		}
+
 	private:
 		void RemoveUnusedJoints();
 		void RemoveUnusedMaterials();
 		void CompressKeyFrameSet(KeyFrameSet& kf);
+		void CompressKeyFrameSets();
+		void GenerateLods(MeshMetadata const & metadata);
+		void OptimizeMeshes();
+		void SplitLargeMeshes();
+		MeshConverter::VertexCacheStats CalcVertexCacheStats() const;
 
 		// From assimp
 		void BuildNodeData(uint32_t num_lods, uint32_t lod, int16_t parent_id, aiNode const * node);
@@ -229,6 +386,7 @@ namespace
 		RenderModelPtr render_model_;
 
 		static uint32_t constexpr MAX_NUMBER_OF_TEXTURECOORDS = 8;
+		static uint32_t constexpr VERTEX_CACHE_SIZE = 16;
 
 		struct Mesh
 		{
@@ -258,6 +416,14 @@ namespace
 			AABBox tc_bb;
 		};
 
+		std::vector<uint32_t> SimplifyLod(Mesh::Lod const & lod, AABBox const & pos_bb, AABBox const & tc_bb,
+			uint32_t target_num_indices, float max_error);
+		Mesh::Lod CompactLod(Mesh::Lod const & lod, std::vector<uint32_t> const & indices);
+		static uint32_t CountCacheMisses(std::vector<uint32_t> const & indices, uint32_t num_vertices);
+		std::vector<uint32_t> OptimizeVertexCache(std::vector<uint32_t> const & indices, uint32_t num_vertices,
+			std::vector<uint32_t>& dead_ends);
+		void OptimizeOverdraw(Mesh::Lod const & lod, std::vector<uint32_t>& indices, std::vector<uint32_t> const & dead_ends);
+
 		struct NodeTransform
 		{
 			SceneNodePtr node;
@@ -272,11 +438,16 @@ namespace
 		std::vector<Mesh> meshes_;
 		std::vector<NodeTransform> nodes_;
 		std::vector<Joint> joints_;
+		float key_frame_error_threshold_;
 		bool has_normal_;
 		bool has_tangent_quat_;
 		bool has_texcoord_;
 		bool has_diffuse_;
 		bool has_specular_;
+
+		MeshConverter::VertexCacheStats input_vertex_cache_stats_;
+		MeshConverter::VertexCacheStats output_vertex_cache_stats_;
+		std::vector<std::string> imported_files_;
 	};
 
 	class MeshSaver
@@ -1000,6 +1171,8 @@ namespace
 			aiReleaseImport(scene);
 		};
 
+		RecordingFileIO file_io;
+		std::vector<std::string> lod_file_names(num_lods);
 		std::vector<std::shared_ptr<aiScene const>> scenes(num_lods);
 		for (uint32_t lod = 0; lod < num_lods; ++ lod)
 		{
@@ -1010,6 +1183,7 @@ namespace
 				LogError() << "Could NOT find " << lod_file_name << " for LoD " << lod << '.' << std::endl;
 				return;
 			}
+			lod_file_names[lod] = file_name;
 
 			scenes[lod].reset(aiImportFileExWithProperties(file_name.c_str(),
 				ppsteps // configurable pp steps
@@ -1017,7 +1191,7 @@ namespace
 				| aiProcess_Triangulate // triangulate polygons with more than 3 edges
 				| aiProcess_ConvertToLeftHanded // convert everything to D3D left handed space
 				/*| aiProcess_FixInfacingNormals*/, // find normals facing inwards and inverts them
-				nullptr, props.get()), ai_scene_deleter);
+				file_io.FileIO(), props.get()), ai_scene_deleter);
 
 			if (!scenes[lod])
 			{
@@ -1026,6 +1200,24 @@ namespace
 			}
 		}
 
+		for (auto const & opened_file : file_io.OpenedFiles())
+		{
+			bool is_lod_file = false;
+			for (auto const & lod_file_name : lod_file_names)
+			{
+				std::error_code ec;
+				if (std::filesystem::equivalent(opened_file, lod_file_name, ec))
+				{
+					is_lod_file = true;
+					break;
+				}
+			}
+			if (!is_lod_file)
+			{
+				imported_files_.push_back(opened_file);
+			}
+		}
+
 		this->BuildJoints(scenes[0].get());
 
 		bool const skinned = !joints_.empty();
@@ -1306,12 +1498,9 @@ namespace
 								int16_t const * p_16 = mapper.Pointer<int16_t>() + start_vertex * 4;
 								for (uint32_t j = 0; j < ai_mesh.mNumVertices; ++ j)
 								{
-									ai_mesh.mVertices[j].x
-										= ((p_16[j * 4 + 0] + 32768) / 65535.0f * 2 - 1) * pos_extent.x() + pos_center.x();
-									ai_mesh.mVertices[j].y
-										= ((p_16[j * 4 + 1] + 32768) / 65535.0f * 2 - 1) * pos_extent.y() + pos_center.y();
-									ai_mesh.mVertices[j].z
-										= ((p_16[j * 4 + 2] + 32768) / 65535.0f * 2 - 1) * pos_extent.z() + pos_center.z();
+									ai_mesh.mVertices[j].x = DequantizeSNorm16(p_16[j * 4 + 0]) * pos_extent.x() + pos_center.x();
+									ai_mesh.mVertices[j].y = DequantizeSNorm16(p_16[j * 4 + 1]) * pos_extent.y() + pos_center.y();
+									ai_mesh.mVertices[j].z = DequantizeSNorm16(p_16[j * 4 + 2]) * pos_extent.z() + pos_center.z();
 								}
 
 								break;
@@ -1366,6 +1555,30 @@ namespace
 								break;
 							}
 
+						case EF_ABGR16:
+							{
+								uint16_t const * tangent_quats = mapper.Pointer<uint16_t>() + start_vertex * 4;
+								for (uint32_t j = 0; j < ai_mesh.mNumVertices; ++ j)
+								{
+									Quaternion tangent_quat;
+									tangent_quat.x() = (tangent_quats[j * 4 + 0] / 65535.0f) * 2 - 1;
+									tangent_quat.y() = (tangent_quats[j * 4 + 1] / 65535.0f) * 2 - 1;
+									tangent_quat.z() = (tangent_quats[j * 4 + 2] / 65535.0f) * 2 - 1;
+									tangent_quat.w() = (tangent_quats[j * 4 + 3] / 65535.0f) * 2 - 1;
+									tangent_quat = MathLib::normalize(tangent_quat);
+
+									auto const tangent = MathLib::transform_quat(float3(1, 0, 0), tangent_quat);
+									auto const binormal = MathLib::transform_quat(float3(0, 1, 0), tangent_quat)
+										* MathLib::sgn(tangent_quat.w());
+									auto const normal = MathLib::transform_quat(float3(0, 0, 1), tangent_quat);
+
+									ai_mesh.mTangents[j] = aiVector3D(tangent.x(), tangent.y(), tangent.z());
+									ai_mesh.mBitangents[j] = aiVector3D(binormal.x(), binormal.y(), binormal.z());
+									ai_mesh.mNormals[j] = aiVector3D(normal.x(), normal.y(), normal.z());
+								}
+								break;
+							}
+
 						default:
 							KFL_UNREACHABLE("Unsupported tangent frame format.");
 						}
@@ -1392,6 +1605,22 @@ namespace
 								break;
 							}
 
+						case EF_A2BGR10:
+							{
+								uint32_t const * normals = mapper.Pointer<uint32_t>() + start_vertex;
+								for (uint32_t j = 0; j < ai_mesh.mNumVertices; ++ j)
+								{
+									float3 normal;
+									normal.x() = (((normals[j] >> 0) & 0x3FF) / 1023.0f) * 2 - 1;
+									normal.y() = (((normals[j] >> 10) & 0x3FF) / 1023.0f) * 2 - 1;
+									normal.z() = (((normals[j] >> 20) & 0x3FF) / 1023.0f) * 2 - 1;
+									normal = MathLib::normalize(normal);
+
+									ai_mesh.mNormals[j] = aiVector3D(normal.x(), normal.y(), normal.z());
+								}
+								break;
+							}
+
 						default:
 							KFL_UNREACHABLE("Unsupported normal format.");
 						}
@@ -1497,9 +1726,9 @@ namespace
 								for (uint32_t j = 0; j < ai_mesh.mNumVertices; ++ j)
 								{
 									ai_mesh.mTextureCoords[ve.usage_index][j].x
-										= ((tc_16[j * 2 + 0] + 32768) / 65535.0f * 2 - 1) * tc_extent.x() + tc_center.x();
+										= DequantizeSNorm16(tc_16[j * 2 + 0]) * tc_extent.x() + tc_center.x();
 									ai_mesh.mTextureCoords[ve.usage_index][j].y
-										= ((tc_16[j * 2 + 1] + 32768) / 65535.0f * 2 - 1) * tc_extent.y() + tc_center.y();
+										= DequantizeSNorm16(tc_16[j * 2 + 1]) * tc_extent.y() + tc_center.y();
 								}
 
 								break;
@@ -3123,26 +3352,24 @@ namespace
 
 	void MeshLoader::CompressKeyFrameSet(KeyFrameSet& kf)
 	{
-		float const THRESHOLD = 1e-3f;
+		// Bounds the work per key, so the reduction stays linear in the number of keys
+		uint32_t const MAX_KEY_SPAN = 64;
 
 		BOOST_ASSERT((kf.bind_real.size() == kf.bind_dual.size())
 			&& (kf.frame_id.size() == kf.bind_scale.size())
 			&& (kf.frame_id.size() == kf.bind_real.size()));
 
-		int base = 0;
-		while (base < static_cast<int>(kf.frame_id.size() - 2))
+		uint32_t const num_keys = static_cast<uint32_t>(kf.frame_id.size());
+		if (num_keys <= 2)
 		{
-			int const frame0 = kf.frame_id[base + 0];
-			int const frame1 = kf.frame_id[base + 1];
-			int const frame2 = kf.frame_id[base + 2];
-			float const factor = static_cast<float>(frame1 - frame0) / (frame2 - frame0);
-			Quaternion interpolate_real;
-			Quaternion interpolate_dual;
-			std::tie(interpolate_real, interpolate_dual) = MathLib::sclerp(kf.bind_real[base + 0], kf.bind_dual[base + 0],
-				kf.bind_real[base + 2], kf.bind_dual[base + 2], factor);
-			float const scale = MathLib::lerp(kf.bind_scale[base + 0], kf.bind_scale[base + 2], factor);
+			return;
+		}
 
-			if (MathLib::dot(kf.bind_real[base + 1], interpolate_real) < 0)
+		float const threshold = key_frame_error_threshold_;
+		auto within_threshold = [&kf, threshold](Quaternion interpolate_real, Quaternion interpolate_dual, float scale,
+			uint32_t key)
+		{
+			if (MathLib::dot(kf.bind_real[key], interpolate_real) < 0)
 			{
 				interpolate_real = -interpolate_real;
 				interpolate_dual = -interpolate_dual;
@@ -3150,25 +3377,887 @@ namespace
 
 			Quaternion diff_real;
 			Quaternion diff_dual;
-			std::tie(diff_real, diff_dual) = MathLib::inverse(kf.bind_real[base + 1], kf.bind_dual[base + 1]);
+			std::tie(diff_real, diff_dual) = MathLib::inverse(kf.bind_real[key], kf.bind_dual[key]);
 			diff_dual = MathLib::mul_dual(diff_real, diff_dual * scale, interpolate_real, interpolate_dual);
 			diff_real = MathLib::mul_real(diff_real, interpolate_real);
-			float diff_scale = scale * kf.bind_scale[base + 1];
+			float diff_scale = scale * kf.bind_scale[key];
+
+			return (MathLib::abs(diff_real.x()) < threshold) && (MathLib::abs(diff_real.y()) < threshold)
+				&& (MathLib::abs(diff_real.z()) < threshold) && (MathLib::abs(diff_real.w() - 1) < threshold)
+				&& (MathLib::abs(diff_dual.x()) < threshold) && (MathLib::abs(diff_dual.y()) < threshold)
+				&& (MathLib::abs(diff_dual.z()) < threshold) && (MathLib::abs(diff_dual.w()) < threshold)
+				&& (MathLib::abs(diff_scale - 1) < threshold);
+		};
 
-			if ((MathLib::abs(diff_real.x()) < THRESHOLD) && (MathLib::abs(diff_real.y()) < THRESHOLD)
-				&& (MathLib::abs(diff_real.z()) < THRESHOLD) && (MathLib::abs(diff_real.w() - 1) < THRESHOLD)
-				&& (MathLib::abs(diff_dual.x()) < THRESHOLD) && (MathLib::abs(diff_dual.y()) < THRESHOLD)
-				&& (MathLib::abs(diff_dual.z()) < THRESHOLD) && (MathLib::abs(diff_dual.w()) < THRESHOLD)
-				&& (MathLib::abs(diff_scale - 1) < THRESHOLD))
+		bool constant = true;
+		for (uint32_t i = 1; (i < num_keys) && constant; ++ i)
+		{
+			constant = within_threshold(kf.bind_real[0], kf.bind_dual[0], kf.bind_scale[0], i);
+		}
+		if (constant)
+		{
+			kf.frame_id.resize(1);
+			kf.bind_real.resize(1);
+			kf.bind_dual.resize(1);
+			kf.bind_scale.resize(1);
+			return;
+		}
+
+		// Kept keys are compacted to [0, num_kept). A key is dropped if it, and every key dropped since the last kept one,
+		// stays within the threshold of the interpolation between the last kept key and the key after it.
+		uint32_t num_kept = 1;
+		uint32_t last_kept = 0;
+		for (uint32_t i = 1; i < num_keys - 1; ++ i)
+		{
+			uint32_t const base = num_kept - 1;
+			bool droppable = (i - last_kept < MAX_KEY_SPAN);
+			for (uint32_t j = last_kept + 1; droppable && (j <= i); ++ j)
 			{
-				kf.frame_id.erase(kf.frame_id.begin() + base + 1);
-				kf.bind_real.erase(kf.bind_real.begin() + base + 1);
-				kf.bind_dual.erase(kf.bind_dual.begin() + base + 1);
-				kf.bind_scale.erase(kf.bind_scale.begin() + base + 1);
+				int const frame0 = kf.frame_id[base];
+				int const frame1 = kf.frame_id[j];
+				int const frame2 = kf.frame_id[i + 1];
+				float const factor = static_cast<float>(frame1 - frame0) / (frame2 - frame0);
+				Quaternion interpolate_real;
+				Quaternion interpolate_dual;
+				std::tie(interpolate_real, interpolate_dual) = MathLib::sclerp(kf.bind_real[base], kf.bind_dual[base],
+					kf.bind_real[i + 1], kf.bind_dual[i + 1], factor);
+				float const scale = MathLib::lerp(kf.bind_scale[base], kf.bind_scale[i + 1], factor);
+
+				droppable = within_threshold(interpolate_real, interpolate_dual, scale, j);
 			}
-			else
+
+			if (!droppable)
 			{
-				++ base;
+				kf.frame_id[num_kept] = kf.frame_id[i];
+				kf.bind_real[num_kept] = kf.bind_real[i];
+				kf.bind_dual[num_kept] = kf.bind_dual[i];
+				kf.bind_scale[num_kept] = kf.bind_scale[i];
+				++ num_kept;
+				last_kept = i;
+			}
+		}
+
+		kf.frame_id[num_kept] = kf.frame_id[num_keys - 1];
+		kf.bind_real[num_kept] = kf.bind_real[num_keys - 1];
+		kf.bind_dual[num_kept] = kf.bind_dual[num_keys - 1];
+		kf.bind_scale[num_kept] = kf.bind_scale[num_keys - 1];
+		++ num_kept;
+
+		kf.frame_id.resize(num_kept);
+		kf.bind_real.resize(num_kept);
+		kf.bind_dual.resize(num_kept);
+		kf.bind_scale.resize(num_kept);
+	}
+
+	void MeshLoader::CompressKeyFrameSets()
+	{
+		auto& skinned_model = checked_cast<SkinnedModel&>(*render_model_);
+		auto const & kfs = *skinned_model.GetKeyFrameSets();
+
+		auto compressed_kfs = MakeSharedPtr<std::vector<CompressedKeyFrameSet>>();
+		compressed_kfs->reserve(kfs.size());
+		for (auto const & kf : kfs)
+		{
+			compressed_kfs->push_back(CompressedKeyFrameSet::Compress(kf));
+		}
+		skinned_model.AttachCompressedKeyFrameSets(compressed_kfs);
+	}
+
+	std::vector<uint32_t> MeshLoader::SimplifyLod(Mesh::Lod const & lod, AABBox const & pos_bb, AABBox const & tc_bb,
+		uint32_t target_num_indices, float max_error)
+	{
+		uint32_t const num_vertices = static_cast<uint32_t>(lod.positions.size());
+		std::vector<uint32_t> indices = lod.indices;
+
+		// Vertices sharing a position are wedges of the same point. Everything topological works on the first wedge.
+		std::vector<uint32_t> wedge_ids(num_vertices);
+		std::vector<bool> locked(num_vertices, false);
+		{
+			std::vector<uint32_t> sorted(num_vertices);
+			std::iota(sorted.begin(), sorted.end(), 0U);
+			auto less_pos = [&lod](uint32_t lhs, uint32_t rhs)
+			{
+				auto const & lhs_pos = lod.positions[lhs];
+				auto const & rhs_pos = lod.positions[rhs];
+				return std::tie(lhs_pos.x(), lhs_pos.y(), lhs_pos.z()) < std::tie(rhs_pos.x(), rhs_pos.y(), rhs_pos.z());
+			};
+			std::sort(sorted.begin(), sorted.end(), less_pos);
+			for (uint32_t i = 0; i < num_vertices;)
+			{
+				uint32_t j = i + 1;
+				while ((j < num_vertices) && (lod.positions[sorted[j]] == lod.positions[sorted[i]]))
+				{
+					++ j;
+				}
+				uint32_t const wedge_id = *std::min_element(sorted.begin() + i, sorted.begin() + j);
+				for (uint32_t k = i; k < j; ++ k)
+				{
+					wedge_ids[sorted[k]] = wedge_id;
+				}
+
+				// Seams of UVs, hard normals or skin weights stay where they are
+				locked[wedge_id] = (j - i > 1);
+				i = j;
+			}
+		}
+
+		// Open or non-manifold edges stay as well
+		{
+			std::vector<uint64_t> half_edges;
+			half_edges.reserve(indices.size());
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				for (uint32_t e = 0; e < 3; ++ e)
+				{
+					uint64_t const v0 = wedge_ids[indices[i + e]];
+					uint64_t const v1 = wedge_ids[indices[i + (e + 1) % 3]];
+					half_edges.push_back((v0 << 32) | v1);
+				}
+			}
+			std::sort(half_edges.begin(), half_edges.end());
+			for (size_t i = 0; i < half_edges.size(); ++ i)
+			{
+				uint64_t const v0 = half_edges[i] >> 32;
+				uint64_t const v1 = half_edges[i] & 0xFFFFFFFFU;
+				bool const duplicated = ((i > 0) && (half_edges[i - 1] == half_edges[i]))
+					|| ((i + 1 < half_edges.size()) && (half_edges[i + 1] == half_edges[i]));
+				auto const twin = std::equal_range(half_edges.begin(), half_edges.end(), (v1 << 32) | v0);
+				if (duplicated || (twin.second - twin.first != 1))
+				{
+					locked[v0] = true;
+					locked[v1] = true;
+				}
+			}
+		}
+
+		// Area weighted plane quadrics, plus the total area to turn them into mean squared distances
+		struct Quadric
+		{
+			double a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+			double weight;
+		};
+		std::vector<Quadric> quadrics(num_vertices, Quadric{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 });
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			float3 const & p0 = lod.positions[indices[i + 0]];
+			float3 const normal = MathLib::cross(lod.positions[indices[i + 1]] - p0, lod.positions[indices[i + 2]] - p0);
+			float const double_area = MathLib::length(normal);
+			if (double_area <= 0)
+			{
+				continue;
+			}
+
+			float3 const n = normal / double_area;
+			double const a = n.x();
+			double const b = n.y();
+			double const c = n.z();
+			double const d = -MathLib::dot(n, p0);
+			double const w = double_area * 0.5;
+			for (uint32_t e = 0; e < 3; ++ e)
+			{
+				auto& q = quadrics[wedge_ids[indices[i + e]]];
+				q.a2 += w * a * a;
+				q.b2 += w * b * b;
+				q.c2 += w * c * c;
+				q.ab += w * a * b;
+				q.ac += w * a * c;
+				q.bc += w * b * c;
+				q.ad += w * a * d;
+				q.bd += w * b * d;
+				q.cd += w * c * d;
+				q.d2 += w * d * d;
+				q.weight += w;
+			}
+		}
+
+		auto quadric_error = [](Quadric const & q0, Quadric const & q1, float3 const & pos)
+		{
+			double const x = pos.x();
+			double const y = pos.y();
+			double const z = pos.z();
+			double const weight = q0.weight + q1.weight;
+			if (weight <= 0)
+			{
+				return 0.0f;
+			}
+			double const err = (q0.a2 + q1.a2) * x * x + (q0.b2 + q1.b2) * y * y + (q0.c2 + q1.c2) * z * z
+				+ 2 * ((q0.ab + q1.ab) * x * y + (q0.ac + q1.ac) * x * z + (q0.bc + q1.bc) * y * z)
+				+ 2 * ((q0.ad + q1.ad) * x + (q0.bd + q1.bd) * y + (q0.cd + q1.cd) * z) + (q0.d2 + q1.d2);
+			return static_cast<float>(std::max(err, 0.0) / weight);
+		};
+
+		// The vertex collapsed away loses its attributes, so their difference is charged over the edge length
+		float3 const tc_size = MathLib::maximize(tc_bb.Max() - tc_bb.Min(), float3(1e-6f, 1e-6f, 1e-6f));
+		auto attribute_error = [&lod, &tc_size](uint32_t from, uint32_t to)
+		{
+			float err = 0;
+			if (!lod.normals.empty())
+			{
+				err += (1 - MathLib::dot(MathLib::normalize(lod.normals[from]), MathLib::normalize(lod.normals[to]))) * 0.5f;
+			}
+			if (!lod.texcoords[0].empty())
+			{
+				float3 const diff = (lod.texcoords[0][from] - lod.texcoords[0][to]) / tc_size;
+				err += MathLib::length_sq(float2(diff.x(), diff.y()));
+			}
+			if (!lod.joint_bindings.empty())
+			{
+				auto weight_of = [](std::vector<std::pair<uint32_t, float>> const & binding, uint32_t joint)
+				{
+					float total = 0;
+					float weight = 0;
+					for (auto const & jw : binding)
+					{
+						total += jw.second;
+						if (jw.first == joint)
+						{
+							weight += jw.second;
+						}
+					}
+					return (total > 0) ? weight / total : 0.0f;
+				};
+
+				auto const & from_binding = lod.joint_bindings[from];
+				auto const & to_binding = lod.joint_bindings[to];
+				float diff = 0;
+				for (auto const & jw : from_binding)
+				{
+					diff += MathLib::abs(weight_of(from_binding, jw.first) - weight_of(to_binding, jw.first));
+				}
+				for (auto const & jw : to_binding)
+				{
+					if (weight_of(from_binding, jw.first) == 0)
+					{
+						diff += weight_of(to_binding, jw.first);
+					}
+				}
+				err += diff * 0.5f;
+			}
+			return err;
+		};
+
+		float const max_error_sq = MathLib::sqr(max_error * MathLib::length(pos_bb.Max() - pos_bb.Min()));
+
+		std::vector<uint32_t> remap(num_vertices);
+		std::vector<bool> collapse_locked(num_vertices);
+		std::vector<uint32_t> tri_offsets(num_vertices + 1);
+		std::vector<uint32_t> tris;
+		struct Collapse
+		{
+			float cost;
+			uint32_t from;
+			uint32_t to;
+		};
+		std::vector<Collapse> collapses;
+		std::vector<uint32_t> ring;
+		std::vector<uint32_t> to_ring;
+		while (indices.size() > target_num_indices)
+		{
+			uint32_t const num_tris = static_cast<uint32_t>(indices.size() / 3);
+
+			std::fill(tri_offsets.begin(), tri_offsets.end(), 0U);
+			for (auto index : indices)
+			{
+				++ tri_offsets[wedge_ids[index] + 1];
+			}
+			std::partial_sum(tri_offsets.begin(), tri_offsets.end(), tri_offsets.begin());
+			tris.resize(indices.size());
+			{
+				std::vector<uint32_t> fill_offsets(tri_offsets.begin(), tri_offsets.end() - 1);
+				for (uint32_t i = 0; i < indices.size(); ++ i)
+				{
+					tris[fill_offsets[wedge_ids[indices[i]]] ++] = i / 3;
+				}
+			}
+
+			collapses.clear();
+			for (uint32_t i = 0; i < indices.size(); i += 3)
+			{
+				for (uint32_t e = 0; e < 3; ++ e)
+				{
+					uint32_t const v0 = indices[i + e];
+					uint32_t const v1 = indices[i + (e + 1) % 3];
+					// Collapsing along the twin half-edge is considered from the neighboring triangle
+					if (!locked[wedge_ids[v0]])
+					{
+						float const edge_len_sq = MathLib::length_sq(lod.positions[v0] - lod.positions[v1]);
+						collapses.push_back({ quadric_error(quadrics[wedge_ids[v0]], quadrics[wedge_ids[v1]], lod.positions[v1])
+							+ edge_len_sq * attribute_error(v0, v1), v0, v1 });
+					}
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(),
+				[](Collapse const & lhs, Collapse const & rhs)
+				{
+					return lhs.cost < rhs.cost;
+				});
+
+			std::iota(remap.begin(), remap.end(), 0U);
+			std::fill(collapse_locked.begin(), collapse_locked.end(), false);
+			uint32_t const num_tris_to_remove = num_tris - target_num_indices / 3;
+			uint32_t num_removed = 0;
+			for (auto const & collapse : collapses)
+			{
+				if ((num_removed >= num_tris_to_remove) || (collapse.cost > max_error_sq))
+				{
+					break;
+				}
+
+				uint32_t const from = wedge_ids[collapse.from];
+				uint32_t const to = wedge_ids[collapse.to];
+				if (collapse_locked[from] || collapse_locked[to])
+				{
+					continue;
+				}
+
+				// Link condition: the two ends share only the apexes of the triangles on the edge
+				ring.clear();
+				uint32_t num_edge_tris = 0;
+				for (uint32_t ti = tri_offsets[from]; ti < tri_offsets[from + 1]; ++ ti)
+				{
+					uint32_t const tri = tris[ti];
+					bool on_edge = false;
+					for (uint32_t e = 0; e < 3; ++ e)
+					{
+						uint32_t const v = wedge_ids[indices[tri * 3 + e]];
+						on_edge |= (v == to);
+						if (v != from)
+						{
+							ring.push_back(v);
+						}
+					}
+					num_edge_tris += on_edge;
+				}
+				std::sort(ring.begin(), ring.end());
+				ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+
+				to_ring.clear();
+				for (uint32_t ti = tri_offsets[to]; ti < tri_offsets[to + 1]; ++ ti)
+				{
+					for (uint32_t e = 0; e < 3; ++ e)
+					{
+						uint32_t const v = wedge_ids[indices[tris[ti] * 3 + e]];
+						if ((v != from) && (v != to) && std::binary_search(ring.begin(), ring.end(), v))
+						{
+							to_ring.push_back(v);
+						}
+					}
+				}
+				std::sort(to_ring.begin(), to_ring.end());
+				if ((num_edge_tris != 2) || (std::unique(to_ring.begin(), to_ring.end()) - to_ring.begin() != 2))
+				{
+					continue;
+				}
+
+				// Reject collapses that flip or squash the triangles that survive
+				bool flipped = false;
+				for (uint32_t ti = tri_offsets[from]; (ti < tri_offsets[from + 1]) && !flipped; ++ ti)
+				{
+					uint32_t const tri = tris[ti];
+					float3 pos[3];
+					float3 new_pos[3];
+					bool on_edge = false;
+					for (uint32_t e = 0; e < 3; ++ e)
+					{
+						uint32_t const v = indices[tri * 3 + e];
+						pos[e] = lod.positions[v];
+						new_pos[e] = (wedge_ids[v] == from) ? lod.positions[collapse.to] : pos[e];
+						on_edge |= (wedge_ids[v] == to);
+					}
+					if (!on_edge)
+					{
+						float3 const normal = MathLib::cross(pos[1] - pos[0], pos[2] - pos[0]);
+						float3 const new_normal = MathLib::cross(new_pos[1] - new_pos[0], new_pos[2] - new_pos[0]);
+						flipped = (MathLib::dot(normal, new_normal) <= 0.25f * MathLib::length(normal) * MathLib::length(new_normal));
+					}
+				}
+				if (flipped)
+				{
+					continue;
+				}
+
+				remap[collapse.from] = collapse.to;
+				collapse_locked[from] = true;
+				for (auto v : ring)
+				{
+					collapse_locked[v] = true;
+				}
+
+				auto& q = quadrics[to];
+				auto const & from_q = quadrics[from];
+				q.a2 += from_q.a2;
+				q.b2 += from_q.b2;
+				q.c2 += from_q.c2;
+				q.ab += from_q.ab;
+				q.ac += from_q.ac;
+				q.bc += from_q.bc;
+				q.ad += from_q.ad;
+				q.bd += from_q.bd;
+				q.cd += from_q.cd;
+				q.d2 += from_q.d2;
+				q.weight += from_q.weight;
+
+				num_removed += num_edge_tris;
+			}
+
+			if (num_removed == 0)
+			{
+				break;
+			}
+
+			uint32_t num_indices = 0;
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				uint32_t const v0 = remap[indices[i + 0]];
+				uint32_t const v1 = remap[indices[i + 1]];
+				uint32_t const v2 = remap[indices[i + 2]];
+				if ((wedge_ids[v0] != wedge_ids[v1]) && (wedge_ids[v1] != wedge_ids[v2]) && (wedge_ids[v2] != wedge_ids[v0]))
+				{
+					indices[num_indices + 0] = v0;
+					indices[num_indices + 1] = v1;
+					indices[num_indices + 2] = v2;
+					num_indices += 3;
+				}
+			}
+			indices.resize(num_indices);
+		}
+
+		return indices;
+	}
+
+	MeshLoader::Mesh::Lod MeshLoader::CompactLod(Mesh::Lod const & lod, std::vector<uint32_t> const & indices)
+	{
+		Mesh::Lod ret;
+
+		std::vector<uint32_t> remap(lod.positions.size(), ~0U);
+		std::vector<uint32_t> used;
+		for (auto index : indices)
+		{
+			if (remap[index] == ~0U)
+			{
+				remap[index] = static_cast<uint32_t>(used.size());
+				used.push_back(index);
+			}
+			ret.indices.push_back(remap[index]);
+		}
+
+		auto gather = [&used](auto const & src, auto& dst)
+		{
+			if (!src.empty())
+			{
+				dst.reserve(used.size());
+				for (auto index : used)
+				{
+					dst.push_back(src[index]);
+				}
+			}
+		};
+		gather(lod.positions, ret.positions);
+		gather(lod.tangents, ret.tangents);
+		gather(lod.binormals, ret.binormals);
+		gather(lod.normals, ret.normals);
+		gather(lod.diffuses, ret.diffuses);
+		gather(lod.speculars, ret.speculars);
+		for (size_t i = 0; i < lod.texcoords.size(); ++ i)
+		{
+			gather(lod.texcoords[i], ret.texcoords[i]);
+		}
+		gather(lod.joint_bindings, ret.joint_bindings);
+
+		return ret;
+	}
+
+	uint32_t MeshLoader::CountCacheMisses(std::vector<uint32_t> const & indices, uint32_t num_vertices)
+	{
+		// FIFO cache. A vertex is cached while fewer than VERTEX_CACHE_SIZE vertices have been inserted after it.
+		std::vector<uint32_t> insert_stamps(num_vertices, 0);
+		uint32_t num_misses = 0;
+		for (auto index : indices)
+		{
+			if ((insert_stamps[index] == 0) || (num_misses - insert_stamps[index] >= VERTEX_CACHE_SIZE))
+			{
+				++ num_misses;
+				insert_stamps[index] = num_misses;
+			}
+		}
+		return num_misses;
+	}
+
+	// Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", Sander et al. 2007
+	std::vector<uint32_t> MeshLoader::OptimizeVertexCache(std::vector<uint32_t> const & indices, uint32_t num_vertices,
+		std::vector<uint32_t>& dead_ends)
+	{
+		uint32_t const num_tris = static_cast<uint32_t>(indices.size() / 3);
+
+		std::vector<uint32_t> live_tris(num_vertices, 0);
+		for (auto index : indices)
+		{
+			++ live_tris[index];
+		}
+		std::vector<uint32_t> adj_offsets(num_vertices + 1, 0);
+		std::partial_sum(live_tris.begin(), live_tris.end(), adj_offsets.begin() + 1);
+		std::vector<uint32_t> adj_tris(indices.size());
+		{
+			std::vector<uint32_t> fill_offsets(adj_offsets.begin(), adj_offsets.end() - 1);
+			for (uint32_t i = 0; i < indices.size(); ++ i)
+			{
+				adj_tris[fill_offsets[indices[i]] ++] = i / 3;
+			}
+		}
+
+		std::vector<int32_t> cache_times(num_vertices, 0);
+		std::vector<bool> emitted(num_tris, false);
+		std::vector<uint32_t> dead_end_stack;
+		std::vector<uint32_t> candidates;
+		int32_t time = VERTEX_CACHE_SIZE + 1;
+		uint32_t cursor = 0;
+
+		auto skip_dead_end = [&live_tris, &dead_end_stack, &cursor, num_vertices]()
+		{
+			while (!dead_end_stack.empty())
+			{
+				uint32_t const v = dead_end_stack.back();
+				dead_end_stack.pop_back();
+				if (live_tris[v] > 0)
+				{
+					return static_cast<int32_t>(v);
+				}
+			}
+			for (; cursor < num_vertices; ++ cursor)
+			{
+				if (live_tris[cursor] > 0)
+				{
+					return static_cast<int32_t>(cursor);
+				}
+			}
+			return -1;
+		};
+
+		std::vector<uint32_t> ret;
+		ret.reserve(indices.size());
+		dead_ends.clear();
+		dead_ends.push_back(0);
+		int32_t fanning = skip_dead_end();
+		while (fanning >= 0)
+		{
+			candidates.clear();
+			for (uint32_t i = adj_offsets[fanning]; i < adj_offsets[fanning + 1]; ++ i)
+			{
+				uint32_t const tri = adj_tris[i];
+				if (emitted[tri])
+				{
+					continue;
+				}
+
+				for (uint32_t e = 0; e < 3; ++ e)
+				{
+					uint32_t const v = indices[tri * 3 + e];
+					ret.push_back(v);
+					dead_end_stack.push_back(v);
+					candidates.push_back(v);
+					-- live_tris[v];
+					if (time - cache_times[v] > static_cast<int32_t>(VERTEX_CACHE_SIZE))
+					{
+						cache_times[v] = time;
+						++ time;
+					}
+				}
+				emitted[tri] = true;
+			}
+
+			// Prefer the candidate that stays in cache for all of its remaining triangles, the older the better
+			int32_t next = -1;
+			int32_t best_priority = -1;
+			for (auto v : candidates)
+			{
+				if (live_tris[v] > 0)
+				{
+					int32_t priority = 0;
+					if (time - cache_times[v] + 2 * static_cast<int32_t>(live_tris[v]) <= static_cast<int32_t>(VERTEX_CACHE_SIZE))
+					{
+						priority = time - cache_times[v];
+					}
+					if (priority > best_priority)
+					{
+						best_priority = priority;
+						next = static_cast<int32_t>(v);
+					}
+				}
+			}
+			if (next < 0)
+			{
+				next = skip_dead_end();
+				if (next >= 0)
+				{
+					dead_ends.push_back(static_cast<uint32_t>(ret.size() / 3));
+				}
+			}
+			fanning = next;
+		}
+
+		return ret;
+	}
+
+	// Splits the cache optimized order into clusters at dead ends, and draws the clusters facing outwards first
+	void MeshLoader::OptimizeOverdraw(Mesh::Lod const & lod, std::vector<uint32_t>& indices,
+		std::vector<uint32_t> const & dead_ends)
+	{
+		// Splitting is accepted while the cluster so far is within this factor of the whole mesh's ACMR
+		float const ACMR_THRESHOLD = 1.05f;
+
+		uint32_t const num_vertices = static_cast<uint32_t>(lod.positions.size());
+		uint32_t const num_tris = static_cast<uint32_t>(indices.size() / 3);
+		if (num_tris == 0)
+		{
+			return;
+		}
+		float const mesh_acmr = static_cast<float>(CountCacheMisses(indices, num_vertices)) / num_tris;
+
+		std::vector<uint32_t> cluster_starts;
+		{
+			std::vector<uint32_t> insert_stamps(num_vertices, 0);
+			uint32_t num_misses = 0;
+			uint32_t cluster_start = 0;
+			uint32_t cluster_misses_start = 0;
+			auto dead_end_iter = dead_ends.begin();
+			for (uint32_t tri = 0; tri < num_tris; ++ tri)
+			{
+				if ((dead_end_iter != dead_ends.end()) && (*dead_end_iter == tri))
+				{
+					++ dead_end_iter;
+					if ((tri == 0)
+						|| (num_misses - cluster_misses_start <= ACMR_THRESHOLD * mesh_acmr * (tri - cluster_start)))
+					{
+						cluster_starts.push_back(tri);
+						cluster_start = tri;
+						cluster_misses_start = num_misses;
+					}
+				}
+
+				for (uint32_t e = 0; e < 3; ++ e)
+				{
+					uint32_t const v = indices[tri * 3 + e];
+					if ((insert_stamps[v] <= cluster_misses_start) || (num_misses - insert_stamps[v] >= VERTEX_CACHE_SIZE))
+					{
+						++ num_misses;
+						insert_stamps[v] = num_misses;
+					}
+				}
+			}
+		}
+		cluster_starts.push_back(num_tris);
+
+		uint32_t const num_clusters = static_cast<uint32_t>(cluster_starts.size() - 1);
+		if (num_clusters <= 1)
+		{
+			return;
+		}
+
+		std::vector<float3> cluster_centroids(num_clusters, float3(0, 0, 0));
+		std::vector<float3> cluster_normals(num_clusters, float3(0, 0, 0));
+		float3 mesh_centroid(0, 0, 0);
+		float mesh_area = 0;
+		for (uint32_t ci = 0; ci < num_clusters; ++ ci)
+		{
+			float cluster_area = 0;
+			for (uint32_t tri = cluster_starts[ci]; tri < cluster_starts[ci + 1]; ++ tri)
+			{
+				float3 const & p0 = lod.positions[indices[tri * 3 + 0]];
+				float3 const & p1 = lod.positions[indices[tri * 3 + 1]];
+				float3 const & p2 = lod.positions[indices[tri * 3 + 2]];
+				float3 const normal = MathLib::cross(p1 - p0, p2 - p0);
+				float const area = MathLib::length(normal);
+				cluster_centroids[ci] += (p0 + p1 + p2) * area;
+				cluster_normals[ci] += normal;
+				cluster_area += area;
+			}
+			mesh_centroid += cluster_centroids[ci];
+			mesh_area += cluster_area;
+			if (cluster_area > 0)
+			{
+				cluster_centroids[ci] /= cluster_area * 3;
+			}
+		}
+		if (mesh_area > 0)
+		{
+			mesh_centroid /= mesh_area * 3;
+		}
+
+		// The winding convention is unknown here, so normals are flipped if they mostly point inwards
+		std::vector<float> occlusion_potentials(num_clusters);
+		float outwards = 0;
+		for (uint32_t ci = 0; ci < num_clusters; ++ ci)
+		{
+			float const len = MathLib::length(cluster_normals[ci]);
+			occlusion_potentials[ci] = (len > 0) ? MathLib::dot(cluster_centroids[ci] - mesh_centroid, cluster_normals[ci]) / len : 0;
+			outwards += MathLib::dot(cluster_centroids[ci] - mesh_centroid, cluster_normals[ci]);
+		}
+		if (outwards < 0)
+		{
+			for (auto& potential : occlusion_potentials)
+			{
+				potential = -potential;
+			}
+		}
+
+		std::vector<uint32_t> cluster_order(num_clusters);
+		std::iota(cluster_order.begin(), cluster_order.end(), 0U);
+		std::stable_sort(cluster_order.begin(), cluster_order.end(),
+			[&occlusion_potentials](uint32_t lhs, uint32_t rhs)
+			{
+				return occlusion_potentials[lhs] > occlusion_potentials[rhs];
+			});
+
+		std::vector<uint32_t> sorted_indices;
+		sorted_indices.reserve(indices.size());
+		for (auto ci : cluster_order)
+		{
+			sorted_indices.insert(sorted_indices.end(), indices.begin() + cluster_starts[ci] * 3,
+				indices.begin() + cluster_starts[ci + 1] * 3);
+		}
+		indices.swap(sorted_indices);
+	}
+
+	void MeshLoader::OptimizeMeshes()
+	{
+		for (auto& mesh : meshes_)
+		{
+			for (auto& lod : mesh.lods)
+			{
+				uint32_t const num_vertices = static_cast<uint32_t>(lod.positions.size());
+
+				std::vector<uint32_t> dead_ends;
+				auto indices = this->OptimizeVertexCache(lod.indices, num_vertices, dead_ends);
+				this->OptimizeOverdraw(lod, indices, dead_ends);
+
+				// Vertices are renumbered in the order of first use, for fetch locality
+				lod = this->CompactLod(lod, indices);
+			}
+		}
+
+		this->SplitLargeMeshes();
+	}
+
+	// Splits meshes whose vertices don't fit in 16-bit indices into parts, with each LoD divided into consecutive ranges
+	void MeshLoader::SplitLargeMeshes()
+	{
+		uint32_t const MAX_16_BIT_VERTICES = 0xFFFF;
+
+		bool need_split = false;
+		for (auto const & mesh : meshes_)
+		{
+			for (auto const & lod : mesh.lods)
+			{
+				need_split |= (lod.positions.size() > MAX_16_BIT_VERTICES);
+			}
+		}
+		if (!need_split)
+		{
+			return;
+		}
+
+		std::vector<Mesh> new_meshes;
+		std::vector<std::vector<uint32_t>> mesh_mapping(meshes_.size());
+		for (size_t mi = 0; mi < meshes_.size(); ++ mi)
+		{
+			auto& mesh = meshes_[mi];
+
+			size_t max_vertices = 0;
+			for (auto const & lod : mesh.lods)
+			{
+				max_vertices = std::max(max_vertices, lod.positions.size());
+			}
+			if (max_vertices <= MAX_16_BIT_VERTICES)
+			{
+				mesh_mapping[mi].push_back(static_cast<uint32_t>(new_meshes.size()));
+				new_meshes.push_back(std::move(mesh));
+				continue;
+			}
+
+			std::vector<Mesh> parts;
+			for (uint32_t num_parts = static_cast<uint32_t>((max_vertices + MAX_16_BIT_VERTICES - 1) / MAX_16_BIT_VERTICES);;
+				++ num_parts)
+			{
+				parts.resize(num_parts);
+				bool fits = true;
+				for (uint32_t pi = 0; (pi < num_parts) && fits; ++ pi)
+				{
+					auto& part = parts[pi];
+					part.mtl_id = mesh.mtl_id;
+					part.name = (pi == 0) ? mesh.name : mesh.name + "_part_" + std::to_string(pi);
+					part.has_normal = mesh.has_normal;
+					part.has_tangent_frame = mesh.has_tangent_frame;
+					part.has_texcoord = mesh.has_texcoord;
+					part.pos_bb = mesh.pos_bb;
+					part.tc_bb = mesh.tc_bb;
+					part.lods.resize(mesh.lods.size());
+
+					for (size_t lod = 0; (lod < mesh.lods.size()) && fits; ++ lod)
+					{
+						auto const & indices = mesh.lods[lod].indices;
+						size_t const num_tris = indices.size() / 3;
+						std::vector<uint32_t> const part_indices(indices.begin() + num_tris * pi / num_parts * 3,
+							indices.begin() + num_tris * (pi + 1) / num_parts * 3);
+						part.lods[lod] = this->CompactLod(mesh.lods[lod], part_indices);
+						fits = (part.lods[lod].positions.size() <= MAX_16_BIT_VERTICES);
+					}
+				}
+
+				if (fits)
+				{
+					break;
+				}
+			}
+
+			for (auto& part : parts)
+			{
+				mesh_mapping[mi].push_back(static_cast<uint32_t>(new_meshes.size()));
+				new_meshes.push_back(std::move(part));
+			}
+		}
+
+		meshes_.swap(new_meshes);
+		for (auto& node : nodes_)
+		{
+			std::vector<uint32_t> mesh_indices;
+			for (auto index : node.mesh_indices)
+			{
+				mesh_indices.insert(mesh_indices.end(), mesh_mapping[index].begin(), mesh_mapping[index].end());
+			}
+			node.mesh_indices.swap(mesh_indices);
+		}
+	}
+
+	MeshConverter::VertexCacheStats MeshLoader::CalcVertexCacheStats() const
+	{
+		MeshConverter::VertexCacheStats stats;
+		for (auto const & mesh : meshes_)
+		{
+			auto const & lod0 = mesh.lods[0];
+			uint32_t const num_vertices = static_cast<uint32_t>(lod0.positions.size());
+			stats.num_vertices += num_vertices;
+			stats.num_triangles += static_cast<uint32_t>(lod0.indices.size() / 3);
+			stats.num_cache_misses += CountCacheMisses(lod0.indices, num_vertices);
+		}
+		return stats;
+	}
+
+	void MeshLoader::GenerateLods(MeshMetadata const & metadata)
+	{
+		uint32_t const num_auto_lods = metadata.NumAutoLods();
+		for (auto& mesh : meshes_)
+		{
+			BOOST_ASSERT(mesh.lods.size() == 1);
+
+			mesh.lods.resize(num_auto_lods + 1);
+			auto const & lod0 = mesh.lods[0];
+			uint32_t const num_tris = static_cast<uint32_t>(lod0.indices.size() / 3);
+			for (uint32_t lod = 1; lod <= num_auto_lods; ++ lod)
+			{
+				float const ratio = MathLib::clamp(metadata.AutoLodRatio(lod - 1), 0.0f, 1.0f);
+				uint32_t const target_num_tris = std::max(static_cast<uint32_t>(num_tris * ratio + 0.5f), 1U);
+				mesh.lods[lod] = this->CompactLod(lod0,
+					this->SimplifyLod(lod0, mesh.pos_bb, mesh.tc_bb, target_num_tris * 3, metadata.AutoLodMaxError()));
 			}
 		}
 	}
@@ -3195,11 +4284,15 @@ namespace
 		meshes_.clear();
 		nodes_.clear();
 		joints_.clear();
+		key_frame_error_threshold_ = metadata.KeyFrameErrorThreshold();
 		has_normal_ = false;
 		has_tangent_quat_ = false;
 		has_texcoord_ = false;
 		has_diffuse_ = false;
 		has_specular_ = false;
+		input_vertex_cache_stats_ = MeshConverter::VertexCacheStats();
+		output_vertex_cache_stats_ = MeshConverter::VertexCacheStats();
+		imported_files_.clear();
 
 		auto const input_ext = input_path.extension();
 		if (input_ext == ".model_bin")
@@ -3229,6 +4322,25 @@ namespace
 			}
 		}
 
+		if (metadata.NumAutoLods() > 0)
+		{
+			if (meshes_[0].lods.size() == 1)
+			{
+				this->GenerateLods(metadata);
+			}
+			else
+			{
+				LogWarn() << "LoDs are loaded from files. Automatic LoD generation is skipped." << std::endl;
+			}
+		}
+
+		input_vertex_cache_stats_ = this->CalcVertexCacheStats();
+		if (metadata.OptimizeMeshes())
+		{
+			this->OptimizeMeshes();
+		}
+		output_vertex_cache_stats_ = this->CalcVertexCacheStats();
+
 		uint32_t const num_lods = static_cast<uint32_t>(meshes_[0].lods.size());
 		bool const skinned = !joints_.empty();
 
@@ -3270,13 +4382,13 @@ namespace
 			}
 			if (has_tangent_quat_)
 			{
-				merged_ves.push_back(VertexElement(VEU_Tangent, 0, EF_ABGR8));
+				merged_ves.push_back(VertexElement(VEU_Tangent, 0, (metadata.TangentFrameBits() > 8) ? EF_ABGR16 : EF_ABGR8));
 				++ stream_index;
 				tangent_quat_stream = stream_index;
 			}
 			else if (has_normal_)
 			{
-				merged_ves.push_back(VertexElement(VEU_Normal, 0, EF_ABGR8));
+				merged_ves.push_back(VertexElement(VEU_Normal, 0, (metadata.NormalBits() > 8) ? EF_A2BGR10 : EF_ABGR8));
 				++ stream_index;
 				normal_stream = stream_index;
 			}
@@ -3330,15 +4442,12 @@ namespace
 
 					for (auto const & position : mesh_lod.positions)
 					{
-						float3 const pos = (position - pos_center) / pos_extent * 0.5f + 0.5f;
+						float3 const pos = (position - pos_center) / pos_extent;
 						int16_t const s_pos[] =
 						{
-							static_cast<int16_t>(
-								MathLib::clamp<int32_t>(static_cast<int32_t>(pos.x() * 65535 - 32768), -32768, 32767)),
-							static_cast<int16_t>(
-								MathLib::clamp<int32_t>(static_cast<int32_t>(pos.y() * 65535 - 32768), -32768, 32767)),
-							static_cast<int16_t>(
-								MathLib::clamp<int32_t>(static_cast<int32_t>(pos.z() * 65535 - 32768), -32768, 32767)),
+							QuantizeSNorm16(pos.x()),
+							QuantizeSNorm16(pos.y()),
+							QuantizeSNorm16(pos.z()),
 							32767
 						};
 
@@ -3347,12 +4456,13 @@ namespace
 					}
 					if (normal_stream != -1)
 					{
+						uint32_t const bits = (merged_ves[normal_stream].format == EF_A2BGR10) ? 10 : 8;
 						for (auto const & n : mesh_lod.normals)
 						{
 							float3 const normal = MathLib::normalize(n) * 0.5f + 0.5f;
-							uint32_t const compact = MathLib::clamp(static_cast<uint32_t>(normal.x() * 255 + 0.5f), 0U, 255U)
-								| (MathLib::clamp(static_cast<uint32_t>(normal.y() * 255 + 0.5f), 0U, 255U) << 8)
-								| (MathLib::clamp(static_cast<uint32_t>(normal.z() * 255 + 0.5f), 0U, 255U) << 16);
+							uint32_t const compact = QuantizeUNorm(normal.x(), bits)
+								| (QuantizeUNorm(normal.y(), bits) << bits)
+								| (QuantizeUNorm(normal.z(), bits) << (bits * 2));
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(&compact);
 							merged_vertices[normal_stream].insert(merged_vertices[normal_stream].end(), p, p + sizeof(compact));
@@ -3360,27 +4470,44 @@ namespace
 					}
 					if (tangent_quat_stream != -1)
 					{
+						uint32_t const bits = (merged_ves[tangent_quat_stream].format == EF_ABGR16) ? 16 : 8;
 						for (size_t i = 0; i < mesh_lod.tangents.size(); ++ i)
 						{
 							float3 const tangent = MathLib::normalize(mesh_lod.tangents[i]);
 							float3 const binormal = MathLib::normalize(mesh_lod.binormals[i]);
 							float3 const normal = MathLib::normalize(mesh_lod.normals[i]);
 
-							Quaternion const tangent_quat = MathLib::to_quaternion(tangent, binormal, normal, 8);
+							Quaternion const tangent_quat = MathLib::to_quaternion(tangent, binormal, normal, bits);
 
-							uint32_t const compact = (
-								MathLib::clamp(
-									static_cast<uint32_t>((tangent_quat.x() * 0.5f + 0.5f) * 255 + 0.5f), 0U, 255U) << 0)
-								| (MathLib::clamp(
-									static_cast<uint32_t>((tangent_quat.y() * 0.5f + 0.5f) * 255 + 0.5f), 0U, 255U) << 8)
-								| (MathLib::clamp(
-									static_cast<uint32_t>((tangent_quat.z() * 0.5f + 0.5f) * 255 + 0.5f), 0U, 255U) << 16)
-								| (MathLib::clamp(
-									static_cast<uint32_t>((tangent_quat.w() * 0.5f + 0.5f) * 255 + 0.5f), 0U, 255U) << 24);
+							uint32_t const compact[] =
+							{
+								QuantizeUNorm(tangent_quat.x() * 0.5f + 0.5f, bits),
+								QuantizeUNorm(tangent_quat.y() * 0.5f + 0.5f, bits),
+								QuantizeUNorm(tangent_quat.z() * 0.5f + 0.5f, bits),
+								QuantizeUNorm(tangent_quat.w() * 0.5f + 0.5f, bits)
+							};
+							if (bits == 16)
+							{
+								uint16_t const compact_16[] =
+								{
+									static_cast<uint16_t>(compact[0]),
+									static_cast<uint16_t>(compact[1]),
+									static_cast<uint16_t>(compact[2]),
+									static_cast<uint16_t>(compact[3])
+								};
+
+								uint8_t const * p = reinterpret_cast<uint8_t const *>(compact_16);
+								merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
+									p, p + sizeof(compact_16));
+							}
+							else
+							{
+								uint32_t const compact_8 = compact[0] | (compact[1] << 8) | (compact[2] << 16) | (compact[3] << 24);
 
-							uint8_t const * p = reinterpret_cast<uint8_t const *>(&compact);
-							merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
-								p, p + sizeof(compact));
+								uint8_t const * p = reinterpret_cast<uint8_t const *>(&compact_8);
+								merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
+									p, p + sizeof(compact_8));
+							}
 						}
 					}
 					if (diffuse_stream != -1)
@@ -3390,8 +4517,7 @@ namespace
 							uint32_t const clr = diffuse.ABGR();
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(&clr);
-							merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
-								p, p + sizeof(clr));
+							merged_vertices[diffuse_stream].insert(merged_vertices[diffuse_stream].end(), p, p + sizeof(clr));
 						}
 					}
 					if (specular_stream != -1)
@@ -3401,8 +4527,7 @@ namespace
 							uint32_t const clr = specular.ABGR();
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(&clr);
-							merged_vertices[tangent_quat_stream].insert(merged_vertices[tangent_quat_stream].end(),
-								p, p + sizeof(clr));
+							merged_vertices[specular_stream].insert(merged_vertices[specular_stream].end(), p, p + sizeof(clr));
 						}
 					}
 					if (texcoord_stream != -1)
@@ -3410,13 +4535,11 @@ namespace
 						for (auto const & tc : mesh_lod.texcoords[0])
 						{
 							float3 tex_coord = float3(tc.x(), tc.y(), 0.0f);
-							tex_coord = (tex_coord - tc_center) / tc_extent * 0.5f + 0.5f;
+							tex_coord = (tex_coord - tc_center) / tc_extent;
 							int16_t const s_tc[2] =
 							{
-								static_cast<int16_t>(MathLib::clamp<int32_t>(static_cast<int32_t>(tex_coord.x() * 65535 - 32768),
-									-32768, 32767)),
-								static_cast<int16_t>(MathLib::clamp<int32_t>(static_cast<int32_t>(tex_coord.y() * 65535 - 32768),
-									-32768, 32767)),
+								QuantizeSNorm16(tex_coord.x()),
+								QuantizeSNorm16(tex_coord.y())
 							};
 
 							uint8_t const * p = reinterpret_cast<uint8_t const *>(s_tc);
@@ -3467,6 +4590,31 @@ namespace
 			}
 		}
 
+		// Clusters reorder the triangles, so they have to be built before indices are written
+		std::vector<std::vector<MeshCluster>> mesh_clusters;
+		if (!skinned && (metadata.MaxClusterTriangles() > 0))
+		{
+			for (auto& mesh : meshes_)
+			{
+				// Bounds are built on float positions. Cover the quantization of the position stream.
+				float const quantization_error = MathLib::length(mesh.pos_bb.HalfSize()) / 32767;
+
+				for (auto& mesh_lod : mesh.lods)
+				{
+					auto clusters = BuildMeshClusters(mesh_lod.positions, mesh_lod.indices, metadata.MaxClusterTriangles());
+					for (auto& cluster : clusters)
+					{
+						cluster.radius += quantization_error;
+						if (metadata.FlipWindingOrder())
+						{
+							cluster.cone_axis = -cluster.cone_axis;
+						}
+					}
+					mesh_clusters.push_back(std::move(clusters));
+				}
+			}
+		}
+
 		{
 			uint32_t max_index = 0;
 			for (auto const & mesh : meshes_)
@@ -3571,6 +4719,10 @@ namespace
 				render_mesh->NumIndices(lod, mesh_num_indices[mesh_lod_index]);
 				render_mesh->StartVertexLocation(lod, mesh_base_vertices[mesh_lod_index]);
 				render_mesh->StartIndexLocation(lod, mesh_start_indices[mesh_lod_index]);
+				if (!mesh_clusters.empty())
+				{
+					render_mesh->Clusters(lod, std::move(mesh_clusters[mesh_lod_index]));
+				}
 			}
 		}
 
@@ -3585,6 +4737,11 @@ namespace
 			}
 			skinned_model.AssignJoints(joints_.begin(), joints_.end());
 
+			if (metadata.CompressKeyFrames())
+			{
+				this->CompressKeyFrameSets();
+			}
+
 			// TODO: Run skinning on CPU to get the bounding box
 			for (uint32_t mesh_index = 0; mesh_index < render_meshes.size(); ++ mesh_index)
 			{
@@ -3632,7 +4789,11 @@ namespace KlayGE
 	RenderModelPtr MeshConverter::Load(std::string_view input_name, MeshMetadata const & metadata)
 	{
 		MeshLoader ml;
-		return ml.Load(input_name, metadata);
+		auto model = ml.Load(input_name, metadata);
+		input_vertex_cache_stats_ = ml.InputVertexCacheStats();
+		output_vertex_cache_stats_ = ml.OutputVertexCacheStats();
+		imported_files_ = ml.ImportedFiles();
+		return model;
 	}
 
 	void MeshConverter::Save(RenderModel& model, std::string_view output_name)
@@ -224,6 +224,54 @@ namespace KlayGE
 				}
 			}
 
+			if (document.HasMember("auto_lod_ratios"))
+			{
+				auto const & ratios_val = document["auto_lod_ratios"];
+				BOOST_ASSERT(ratios_val.IsArray());
+				new_metadata.auto_lod_ratios_.resize(ratios_val.Size());
+				uint32_t index = 0;
+				for (auto iter = ratios_val.Begin(); iter != ratios_val.End(); ++ iter, ++ index)
+				{
+					BOOST_ASSERT(iter->IsNumber());
+					new_metadata.auto_lod_ratios_[index] = GetFloat(*iter);
+				}
+			}
+
+			if (document.HasMember("auto_lod_max_error"))
+			{
+				auto const & max_error_val = document["auto_lod_max_error"];
+				BOOST_ASSERT(max_error_val.IsNumber());
+				new_metadata.auto_lod_max_error_ = GetFloat(max_error_val);
+			}
+
+			if (document.HasMember("optimize_meshes"))
+			{
+				auto const & optimize_meshes_val = document["optimize_meshes"];
+				BOOST_ASSERT(optimize_meshes_val.IsBool());
+				new_metadata.optimize_meshes_ = optimize_meshes_val.GetBool();
+			}
+
+			if (document.HasMember("normal_bits"))
+			{
+				auto const & normal_bits_val = document["normal_bits"];
+				BOOST_ASSERT(normal_bits_val.IsUint());
+				new_metadata.normal_bits_ = normal_bits_val.GetUint();
+			}
+
+			if (document.HasMember("tangent_frame_bits"))
+			{
+				auto const & tangent_frame_bits_val = document["tangent_frame_bits"];
+				BOOST_ASSERT(tangent_frame_bits_val.IsUint());
+				new_metadata.tangent_frame_bits_ = tangent_frame_bits_val.GetUint();
+			}
+
+			if (document.HasMember("max_cluster_triangles"))
+			{
+				auto const & max_cluster_triangles_val = document["max_cluster_triangles"];
+				BOOST_ASSERT(max_cluster_triangles_val.IsUint());
+				new_metadata.max_cluster_triangles_ = max_cluster_triangles_val.GetUint();
+			}
+
 			if (document.HasMember("materials"))
 			{
 				auto const & materials_val = document["materials"];
@@ -237,6 +285,20 @@ namespace KlayGE
 				}
 			}
 
+			if (document.HasMember("key_frame_error_threshold"))
+			{
+				auto const & threshold_val = document["key_frame_error_threshold"];
+				BOOST_ASSERT(threshold_val.IsNumber());
+				new_metadata.key_frame_error_threshold_ = GetFloat(threshold_val);
+			}
+
+			if (document.HasMember("compress_key_frames"))
+			{
+				auto const & compress_key_frames_val = document["compress_key_frames"];
+				BOOST_ASSERT(compress_key_frames_val.IsBool());
+				new_metadata.compress_key_frames_ = compress_key_frames_val.GetBool();
+			}
+
 			new_metadata.UpdateTransforms();
 		}
 		else if(!name.empty())
@@ -345,6 +407,42 @@ namespace KlayGE
 			document.AddMember("lod", array_names_val, allocator);
 		}
 
+		if (!auto_lod_ratios_.empty())
+		{
+			rapidjson::Value ratios_val;
+			ratios_val.SetArray();
+			for (auto ratio : auto_lod_ratios_)
+			{
+				ratios_val.PushBack(ratio, allocator);
+			}
+			document.AddMember("auto_lod_ratios", ratios_val, allocator);
+		}
+
+		if (!MathLib::equal(auto_lod_max_error_, 1e-2f))
+		{
+			document.AddMember("auto_lod_max_error", auto_lod_max_error_, allocator);
+		}
+
+		if (!optimize_meshes_)
+		{
+			document.AddMember("optimize_meshes", optimize_meshes_, allocator);
+		}
+
+		if (normal_bits_ != 8)
+		{
+			document.AddMember("normal_bits", normal_bits_, allocator);
+		}
+
+		if (tangent_frame_bits_ != 8)
+		{
+			document.AddMember("tangent_frame_bits", tangent_frame_bits_, allocator);
+		}
+
+		if (max_cluster_triangles_ != 128)
+		{
+			document.AddMember("max_cluster_triangles", max_cluster_triangles_, allocator);
+		}
+
 		if (!material_file_names_.empty())
 		{
 			rapidjson::Value mtl_names_val;
@@ -359,6 +457,16 @@ namespace KlayGE
 			document.AddMember("materials", mtl_names_val, allocator);
 		}
 
+		if (!MathLib::equal(key_frame_error_threshold_, 1e-3f))
+		{
+			document.AddMember("key_frame_error_threshold", key_frame_error_threshold_, allocator);
+		}
+
+		if (compress_key_frames_)
+		{
+			document.AddMember("compress_key_frames", compress_key_frames_, allocator);
+		}
+
 		rapidjson::StringBuffer sb;
 		rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(sb);
 		document.Accept(writer);
@@ -386,6 +494,26 @@ namespace KlayGE
 		lod_file_names_[lod] = std::string(lod_name);
 	}
 
+	uint32_t MeshMetadata::NumAutoLods() const
+	{
+		return static_cast<uint32_t>(auto_lod_ratios_.size());
+	}
+
+	void MeshMetadata::NumAutoLods(uint32_t lods)
+	{
+		auto_lod_ratios_.resize(lods, 0.5f);
+	}
+
+	float MeshMetadata::AutoLodRatio(uint32_t lod) const
+	{
+		return auto_lod_ratios_[lod];
+	}
+
+	void MeshMetadata::AutoLodRatio(uint32_t lod, float ratio)
+	{
+		auto_lod_ratios_[lod] = ratio;
+	}
+
 	uint32_t MeshMetadata::NumMaterials() const
 	{
 		return static_cast<uint32_t>(material_file_names_.size());
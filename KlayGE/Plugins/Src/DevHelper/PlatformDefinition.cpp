@@ -91,7 +91,7 @@ namespace KlayGE
 
 	PlatformDefinition::PlatformDefinition(std::string_view name)
 	{
-		ResIdentifierPtr plat = ResLoader::Instance().Open(name);
+		ResIdentifierPtr plat = ResLoader::Instance().OpenXML(name);
 
 		KlayGE::XMLDocument doc;
 		XMLNodePtr root = doc.Parse(plat);
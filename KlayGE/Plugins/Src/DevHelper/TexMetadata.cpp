@@ -656,6 +656,11 @@ namespace KlayGE
 		plane_file_names_.resize(size);
 	}
 
+	uint32_t TexMetadata::NumPlaneMipmaps(uint32_t array_index) const
+	{
+		return (array_index < plane_file_names_.size()) ? static_cast<uint32_t>(plane_file_names_[array_index].size()) : 0;
+	}
+
 	std::string_view TexMetadata::PlaneFileName(uint32_t array_index, uint32_t mip) const
 	{
 		return plane_file_names_[array_index][mip];
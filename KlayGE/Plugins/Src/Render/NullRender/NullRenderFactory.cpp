@@ -31,6 +31,9 @@
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/ErrorHandling.hpp>
 
+#include <KlayGE/GraphicsBuffer.hpp>
+
+#include <KlayGE/NullRender/NullFence.hpp>
 #include <KlayGE/NullRender/NullRenderEngine.hpp>
 #include <KlayGE/NullRender/NullRenderStateObject.hpp>
 #include <KlayGE/NullRender/NullShaderObject.hpp>
@@ -103,21 +106,29 @@ namespace KlayGE
 	GraphicsBufferPtr NullRenderFactory::MakeDelayCreationVertexBuffer(BufferUsage usage, uint32_t access_hint,
 			uint32_t size_in_byte, uint32_t structure_byte_stride)
 	{
-		KFL_UNUSED(usage);
-		KFL_UNUSED(access_hint);
-		KFL_UNUSED(size_in_byte);
 		KFL_UNUSED(structure_byte_stride);
-		return GraphicsBufferPtr();
+
+		// Dynamic geometry is written by the CPU every frame, so it needs real memory behind it
+		GraphicsBufferPtr ret;
+		if ((BU_Dynamic == usage) && (access_hint & EAH_CPU_Write))
+		{
+			ret = MakeSharedPtr<SoftwareGraphicsBuffer>(size_in_byte, false);
+		}
+		return ret;
 	}
 
 	GraphicsBufferPtr NullRenderFactory::MakeDelayCreationIndexBuffer(BufferUsage usage, uint32_t access_hint,
 			uint32_t size_in_byte, uint32_t structure_byte_stride)
 	{
-		KFL_UNUSED(usage);
-		KFL_UNUSED(access_hint);
-		KFL_UNUSED(size_in_byte);
 		KFL_UNUSED(structure_byte_stride);
-		return GraphicsBufferPtr();
+
+		// Dynamic geometry is written by the CPU every frame, so it needs real memory behind it
+		GraphicsBufferPtr ret;
+		if ((BU_Dynamic == usage) && (access_hint & EAH_CPU_Write))
+		{
+			ret = MakeSharedPtr<SoftwareGraphicsBuffer>(size_in_byte, false);
+		}
+		return ret;
 	}
 
 	GraphicsBufferPtr NullRenderFactory::MakeDelayCreationConstantBuffer(BufferUsage usage, uint32_t access_hint,
@@ -152,7 +163,7 @@ namespace KlayGE
 
 	FencePtr NullRenderFactory::MakeFence()
 	{
-		return FencePtr();
+		return MakeSharedPtr<NullFence>();
 	}
 	
 	ShaderResourceViewPtr NullRenderFactory::MakeTextureSrv(TexturePtr const & texture, ElementFormat pf, uint32_t first_array_index,
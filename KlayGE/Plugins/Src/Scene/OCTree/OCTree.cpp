@@ -148,11 +148,6 @@ namespace KlayGE
 		checked_pointer_cast<NodeRenderable>(node_renderable_)->ClearInstances();
 #endif
 
-		if (!octree_.empty())
-		{
-			this->NodeVisible(0);
-		}
-
 		App3DFramework& app = Context::Instance().AppInstance();
 		Camera& camera = app.ActiveCamera();
 
@@ -167,6 +162,13 @@ namespace KlayGE
 			}
 		}
 
+		this->PrepareOcclusionCulling(camera, view_proj);
+
+		if (!octree_.empty())
+		{
+			this->NodeVisible(0);
+		}
+
 		if (camera.OmniDirectionalMode())
 		{
 			for (auto* sn : all_scene_nodes_)
@@ -233,6 +235,11 @@ namespace KlayGE
 						}
 					}
 
+					if ((node.Attrib() & SceneNode::SOA_Cullable) && (visible != BO_No) && this->AABBOccluded(node.PosBoundWS()))
+					{
+						visible = BO_No;
+					}
+
 					node.VisibleMark(visible);
 				}
 			}
@@ -343,7 +350,11 @@ namespace KlayGE
 			|| ((MathLib::ortho_area(camera.ForwardVec(), octree_node.bb) > small_obj_threshold_)
 				&& (MathLib::perspective_area(camera.EyePos(), view_proj, octree_node.bb) > small_obj_threshold_)))
 		{
-			BoundOverlap const vis = frustum_->Intersect(octree_node.bb);
+			BoundOverlap vis = frustum_->Intersect(octree_node.bb);
+			if ((vis != BO_No) && this->AABBOccluded(octree_node.bb))
+			{
+				vis = BO_No;
+			}
 			octree_node.visible = vis;
 			if (BO_Partial == vis)
 			{
@@ -0,0 +1,223 @@
+/**
+ * @file AssetCacheTest.cpp
+ * @author Minmin Gong
+ *
+ * @section DESCRIPTION
+ *
+ * This source file is part of KlayGE
+ * For the latest info, see http://www.klayge.org
+ *
+ * @section LICENSE
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ *
+ * You may alternatively use this source under the terms of
+ * the KlayGE Proprietary License (KPL). You can obtained such a license
+ * from http://www.klayge.org/licensing/.
+ */
+
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/Texture.hpp>
+#include <KlayGE/DevHelper/AssetCache.hpp>
+#include <KlayGE/DevHelper/MeshConverter.hpp>
+#include <KlayGE/DevHelper/MeshMetadata.hpp>
+#include <KlayGE/DevHelper/TexMetadata.hpp>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+class AssetCacheTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		root_ = std::filesystem::temp_directory_path() / "KlayGEAssetCacheTest";
+		std::filesystem::remove_all(root_);
+		std::filesystem::create_directories(root_);
+	}
+
+	void TearDown() override
+	{
+		std::filesystem::remove_all(root_);
+	}
+
+	std::string WriteFile(std::string const & name, std::string const & content)
+	{
+		std::string const path = (root_ / name).string();
+		std::ofstream ofs(path, std::ios_base::binary);
+		ofs << content;
+		return path;
+	}
+
+	// A runtime file header followed by a payload
+	std::string Artifact(uint32_t fourcc, uint32_t ver, std::string const & payload)
+	{
+		uint32_t const header[] = { Native2LE(fourcc), Native2LE(ver) };
+		return std::string(reinterpret_cast<char const *>(header), sizeof(header)) + payload;
+	}
+
+	std::string ReadFile(std::string const & path)
+	{
+		std::ifstream ifs(path, std::ios_base::binary);
+		return std::string(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+	}
+
+protected:
+	std::filesystem::path root_;
+};
+
+TEST_F(AssetCacheTest, KeysFollowContent)
+{
+	AssetCache cache((root_ / "cache").string());
+
+	std::string const a = this->WriteFile("a.png", "texels");
+	std::string const b = this->WriteFile("b.png", "texels");
+	std::string const c = this->WriteFile("c.png", "other texels");
+
+	TexMetadata metadata;
+	std::string const key = cache.TextureKey(a, metadata);
+	EXPECT_EQ(key.size(), 32U);
+	EXPECT_EQ(cache.TextureKey(b, metadata), key);
+	EXPECT_NE(cache.TextureKey(c, metadata), key);
+	EXPECT_TRUE(cache.TextureKey((root_ / "missing.png").string(), metadata).empty());
+
+	metadata.PreferedFormat(EF_BC7);
+	EXPECT_NE(cache.TextureKey(a, metadata), key);
+
+	MeshMetadata mesh_metadata;
+	std::string const model_key = cache.ModelKey(a, "", mesh_metadata);
+	EXPECT_NE(model_key, key);
+	EXPECT_EQ(cache.ModelKey(a, (root_ / "a.png.kmeta").string(), mesh_metadata), model_key);
+	std::string const kmeta = this->WriteFile("a.png.kmeta", "{ \"version\": 1 }");
+	EXPECT_NE(cache.ModelKey(a, kmeta, mesh_metadata), model_key);
+}
+
+TEST_F(AssetCacheTest, FetchStore)
+{
+	AssetCache cache((root_ / "cache").string());
+
+	std::string const input = this->WriteFile("tex.png", "texels");
+	std::string const key = cache.TextureKey(input, TexMetadata());
+
+	std::string const output = (root_ / "tex.png.dds").string();
+	EXPECT_FALSE(cache.Fetch(key, output));
+	EXPECT_EQ(cache.NumMisses(), 1U);
+
+	std::string const converted = this->Artifact(TEXTURE_BIN_FOURCC, TEXTURE_BIN_VERSION, "converted");
+	this->WriteFile("tex.png.dds", converted);
+	cache.Store(key, output);
+	std::filesystem::remove(output);
+
+	// Another checkout with the same content
+	std::string const other_output = (root_ / "other" / "tex.png.dds").string();
+	EXPECT_TRUE(cache.Fetch(key, other_output));
+	EXPECT_EQ(cache.NumHits(), 1U);
+	EXPECT_EQ(this->ReadFile(other_output), converted);
+
+	EXPECT_FALSE(cache.Fetch("", output));
+}
+
+TEST_F(AssetCacheTest, VersionMismatch)
+{
+	AssetCache cache((root_ / "cache").string());
+
+	std::string const input = this->WriteFile("mesh.obj", "vertices");
+	std::string const key = cache.ModelKey(input, "", MeshMetadata());
+	EXPECT_NE(key, cache.TextureKey(input, TexMetadata()));
+
+	// Written by a converter that changed the layout without bumping CONVERTER_VERSION
+	std::string const output = (root_ / "mesh.obj.model_bin").string();
+	this->WriteFile("mesh.obj.model_bin", this->Artifact(MODEL_BIN_FOURCC, MODEL_BIN_VERSION - 1, "old layout"));
+	cache.Store(key, output);
+	std::filesystem::remove(output);
+
+	EXPECT_FALSE(cache.Fetch(key, output));
+	EXPECT_EQ(cache.NumHits(), 0U);
+	EXPECT_EQ(cache.NumMisses(), 1U);
+	EXPECT_FALSE(std::filesystem::exists(output));
+
+	// Not a runtime file at all
+	this->WriteFile("mesh.obj.model_bin", "garbage");
+	cache.Store(key, output);
+	EXPECT_FALSE(cache.Fetch(key, output));
+
+	this->WriteFile("mesh.obj.model_bin", this->Artifact(MODEL_BIN_FOURCC, MODEL_BIN_VERSION, "current layout"));
+	cache.Store(key, output);
+	std::filesystem::remove(output);
+	EXPECT_TRUE(cache.Fetch(key, output));
+	EXPECT_EQ(cache.NumHits(), 1U);
+}
+
+TEST_F(AssetCacheTest, ModelSidecars)
+{
+	AssetCache cache((root_ / "cache").string());
+
+	std::string const input = this->WriteFile("mesh.obj", "mtllib mesh.mtl");
+	std::string const mtl = this->WriteFile("mesh.mtl", "newmtl red");
+	MeshMetadata const metadata;
+
+	std::string const source_key = cache.ModelKey(input, "", metadata);
+	EXPECT_EQ(cache.RecordModelSidecars(input, "", metadata, {}), source_key);
+
+	std::string const key = cache.RecordModelSidecars(input, "", metadata, { mtl, mtl });
+	EXPECT_NE(key, source_key);
+	EXPECT_EQ(cache.ModelKey(input, "", metadata), key);
+
+	// The list is shared through the cache directory
+	AssetCache other_cache((root_ / "cache").string());
+	EXPECT_EQ(other_cache.ModelKey(input, "", metadata), key);
+
+	this->WriteFile("mesh.mtl", "newmtl blue");
+	std::string const edited_key = cache.ModelKey(input, "", metadata);
+	EXPECT_NE(edited_key, key);
+	EXPECT_NE(edited_key, source_key);
+
+	std::filesystem::remove(mtl);
+	EXPECT_NE(cache.ModelKey(input, "", metadata), edited_key);
+}
+
+TEST_F(AssetCacheTest, ImporterReadsMaterialLibrary)
+{
+	std::string const input = this->WriteFile("triangle.obj",
+		"mtllib triangle.mtl\n"
+		"usemtl red\n"
+		"v 0 0 0\n"
+		"v 1 0 0\n"
+		"v 0 1 0\n"
+		"f 1 2 3\n");
+	std::string const mtl = this->WriteFile("triangle.mtl",
+		"newmtl red\n"
+		"Kd 1 0 0\n");
+
+	MeshConverter mc;
+	ASSERT_TRUE(mc.Load(input, MeshMetadata()));
+	ASSERT_EQ(mc.ImportedFiles().size(), 1U);
+	EXPECT_TRUE(std::filesystem::equivalent(mc.ImportedFiles()[0], mtl));
+
+	AssetCache cache((root_ / "cache").string());
+	std::string const key = cache.RecordModelSidecars(input, "", MeshMetadata(), mc.ImportedFiles());
+	this->WriteFile("triangle.mtl",
+		"newmtl red\n"
+		"Kd 0 1 0\n");
+	EXPECT_NE(cache.ModelKey(input, "", MeshMetadata()), key);
+}
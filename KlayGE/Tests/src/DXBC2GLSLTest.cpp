@@ -0,0 +1,1114 @@
+#include <KlayGE/KlayGE.hpp>
+
+#include <DXBC2GLSL/DXBC2GLSL.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+
+namespace
+{
+	typedef std::vector<uint32_t> Tokens;
+	typedef std::array<uint32_t, 4> Vec;
+
+	uint32_t AsUInt(float f)
+	{
+		uint32_t u;
+		std::memcpy(&u, &f, sizeof(u));
+		return u;
+	}
+
+	float AsFloat(uint32_t u)
+	{
+		float f;
+		std::memcpy(&f, &u, sizeof(f));
+		return f;
+	}
+
+	// Operand tokens, encoded as in d3d11TokenizedProgramFormat.hpp
+
+	Tokens Operand(ShaderOperandType type, uint32_t index, ShaderOperandSelectionMode mode, uint32_t select, bool neg, bool abs)
+	{
+		Tokens ret(1, 2 | (mode << 2) | (select << 4) | (type << 12) | (1UL << 20));
+		if (neg || abs)
+		{
+			ret[0] |= 1UL << 31;
+			ret.push_back(1 | (neg << 6) | (abs << 7));
+		}
+		ret.push_back(index);
+		return ret;
+	}
+
+	Tokens Dst(ShaderOperandType type, uint32_t index, uint32_t mask)
+	{
+		return Operand(type, index, SOSM_MASK, mask, false, false);
+	}
+
+	// swizzle is like "yzwx", or a single component for a scalar select
+	Tokens Src(ShaderOperandType type, uint32_t index, char const * swizzle, bool neg = false, bool abs = false)
+	{
+		auto comp = [](char c)
+		{
+			return ('w' == c) ? 3U : static_cast<uint32_t>(c - 'x');
+		};
+
+		if (1 == std::strlen(swizzle))
+		{
+			return Operand(type, index, SOSM_SCALAR, comp(swizzle[0]), neg, abs);
+		}
+		else
+		{
+			BOOST_ASSERT(4 == std::strlen(swizzle));
+			uint32_t select = 0;
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				select |= comp(swizzle[i]) << (i * 2);
+			}
+			return Operand(type, index, SOSM_SWIZZLE, select, neg, abs);
+		}
+	}
+
+	Tokens Imm(uint32_t value)
+	{
+		return Tokens{ 1 | (SOT_IMMEDIATE32 << 12), value };
+	}
+
+	Tokens Imm(uint32_t x, uint32_t y, uint32_t z, uint32_t w)
+	{
+		return Tokens{ 2 | (SOT_IMMEDIATE32 << 12), x, y, z, w };
+	}
+
+	Tokens R(uint32_t index, uint32_t mask)
+	{
+		return Dst(SOT_TEMP, index, mask);
+	}
+	Tokens R(uint32_t index, char const * swizzle)
+	{
+		return Src(SOT_TEMP, index, swizzle);
+	}
+	Tokens V(uint32_t index, char const * swizzle)
+	{
+		return Src(SOT_INPUT, index, swizzle);
+	}
+	Tokens O(uint32_t index)
+	{
+		return Dst(SOT_OUTPUT, index, 0xF);
+	}
+
+	uint32_t const X = 1;
+	uint32_t const Y = 2;
+	uint32_t const Z = 4;
+	uint32_t const W = 8;
+	uint32_t const XYZW = 0xF;
+
+	uint32_t const NUM_TEMPS = 8;
+
+	// A vertex shader with 2 float4 inputs, 2 float4 outputs and 8 temps
+	class VertexShaderBuilder
+	{
+	public:
+		VertexShaderBuilder& Insn(ShaderOpcode opcode, std::vector<Tokens> const & ops = {}, bool sat = false, bool test_nz = false)
+		{
+			uint32_t len = 1;
+			for (auto const & op : ops)
+			{
+				len += static_cast<uint32_t>(op.size());
+			}
+			body_.push_back(opcode | (sat << 13) | (test_nz << 18) | (len << 24));
+			for (auto const & op : ops)
+			{
+				body_.insert(body_.end(), op.begin(), op.end());
+			}
+			return *this;
+		}
+
+		std::vector<uint8_t> Build() const
+		{
+			Tokens shdr;
+			for (uint32_t i = 0; i < 2; ++ i)
+			{
+				Tokens const v = Dst(SOT_INPUT, i, XYZW);
+				shdr.push_back(SO_DCL_INPUT | ((1 + v.size()) << 24));
+				shdr.insert(shdr.end(), v.begin(), v.end());
+			}
+			{
+				Tokens const o = Dst(SOT_OUTPUT, 0, XYZW);
+				shdr.push_back(SO_DCL_OUTPUT_SIV | ((2 + o.size()) << 24));
+				shdr.insert(shdr.end(), o.begin(), o.end());
+				shdr.push_back(SN_POSITION);
+			}
+			{
+				Tokens const o = Dst(SOT_OUTPUT, 1, XYZW);
+				shdr.push_back(SO_DCL_OUTPUT | ((1 + o.size()) << 24));
+				shdr.insert(shdr.end(), o.begin(), o.end());
+			}
+			shdr.push_back(SO_DCL_TEMPS | (2 << 24));
+			shdr.push_back(NUM_TEMPS);
+			shdr.insert(shdr.end(), body_.begin(), body_.end());
+			shdr.push_back(SO_RET | (1 << 24));
+
+			// vs_4_0
+			shdr.insert(shdr.begin(), { 0x10040, static_cast<uint32_t>(shdr.size() + 2) });
+
+			std::vector<std::vector<uint8_t>> chunks;
+			chunks.push_back(this->Signature("ISGN", { "POSITION", "TEXCOORD" }, 0));
+			chunks.push_back(this->Signature("OSGN", { "SV_Position", "TEXCOORD" }, SN_POSITION));
+			chunks.push_back(Chunk("SHDR", shdr));
+
+			uint32_t const header_size = 32 + 4 * static_cast<uint32_t>(chunks.size());
+			Tokens header = { MakeFourCC('D', 'X', 'B', 'C'), 0, 0, 0, 0, 1, 0, static_cast<uint32_t>(chunks.size()) };
+			uint32_t offset = header_size;
+			for (auto const & chunk : chunks)
+			{
+				header.push_back(offset);
+				offset += static_cast<uint32_t>(chunk.size());
+			}
+			header[6] = offset;
+
+			std::vector<uint8_t> ret(reinterpret_cast<uint8_t const *>(header.data()),
+				reinterpret_cast<uint8_t const *>(header.data() + header.size()));
+			for (auto const & chunk : chunks)
+			{
+				ret.insert(ret.end(), chunk.begin(), chunk.end());
+			}
+			return ret;
+		}
+
+	private:
+		static uint32_t MakeFourCC(char a, char b, char c, char d)
+		{
+			return a | (b << 8) | (c << 16) | (d << 24);
+		}
+
+		static std::vector<uint8_t> Chunk(char const * fourcc, Tokens const & data)
+		{
+			Tokens tokens = { MakeFourCC(fourcc[0], fourcc[1], fourcc[2], fourcc[3]), static_cast<uint32_t>(data.size() * 4) };
+			tokens.insert(tokens.end(), data.begin(), data.end());
+			return std::vector<uint8_t>(reinterpret_cast<uint8_t const *>(tokens.data()),
+				reinterpret_cast<uint8_t const *>(tokens.data() + tokens.size()));
+		}
+
+		// One float4 element per register. The first output is a system value.
+		static std::vector<uint8_t> Signature(char const * fourcc, std::vector<std::string> const & names, uint32_t first_sv)
+		{
+			bool const is_input = ('I' == fourcc[0]);
+			uint32_t const num = static_cast<uint32_t>(names.size());
+
+			Tokens data = { num, 8 };
+			std::string name_table;
+			for (uint32_t i = 0; i < num; ++ i)
+			{
+				data.push_back(8 + 24 * num + static_cast<uint32_t>(name_table.size()));
+				data.push_back(0);
+				data.push_back((0 == i) ? first_sv : 0);
+				data.push_back(3);
+				data.push_back(i);
+				data.push_back(XYZW | ((is_input ? XYZW : 0) << 8));
+				name_table += names[i];
+				name_table.push_back('\0');
+			}
+			name_table.resize((name_table.size() + 3) & ~3U, '\0');
+			data.resize(data.size() + name_table.size() / 4);
+			std::memcpy(&data[data.size() - name_table.size() / 4], name_table.data(), name_table.size());
+
+			return Chunk(fourcc, data);
+		}
+
+	private:
+		Tokens body_;
+	};
+
+	// Executes the IR of a vertex shader built by VertexShaderBuilder. Supports the ALU instructions the optimizer
+	// knows, plus some it doesn't, and if/else/loop/breakc flow control.
+	class Interpreter
+	{
+	public:
+		Interpreter(ShaderProgram const & program)
+			: program_(program), match_(program.insns.size(), -1), else_(program.insns.size(), -1)
+		{
+			std::vector<size_t> stack;
+			for (size_t i = 0; i < program.insns.size(); ++ i)
+			{
+				switch (program.insns[i]->opcode)
+				{
+				case SO_IF:
+				case SO_LOOP:
+					stack.push_back(i);
+					break;
+
+				case SO_ELSE:
+					else_[stack.back()] = static_cast<int>(i);
+					break;
+
+				case SO_ENDIF:
+				case SO_ENDLOOP:
+					match_[stack.back()] = static_cast<int>(i);
+					match_[i] = static_cast<int>(stack.back());
+					if (else_[stack.back()] >= 0)
+					{
+						match_[else_[stack.back()]] = static_cast<int>(i);
+					}
+					stack.pop_back();
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+
+		// Returns false if the shader doesn't finish, or uses something that isn't supported
+		bool Run(std::array<Vec, 2> const & inputs, std::array<Vec, 2>& outputs)
+		{
+			temps_.fill(Vec{ { 0, 0, 0, 0 } });
+			inputs_ = inputs;
+			outputs_ = std::array<Vec, 2>{};
+
+			auto const & insns = program_.insns;
+			uint32_t steps = 0;
+			for (size_t pc = 0; pc < insns.size(); ++ pc)
+			{
+				if (++ steps > 100000)
+				{
+					return false;
+				}
+
+				ShaderInstruction const & insn = *insns[pc];
+				switch (insn.opcode)
+				{
+				case SO_RET:
+					outputs = outputs_;
+					return true;
+
+				case SO_IF:
+					if ((this->Read(*insn.ops[0], false)[0] != 0) != static_cast<bool>(insn.insn.test_nz))
+					{
+						pc = (else_[pc] >= 0) ? else_[pc] : match_[pc];
+					}
+					continue;
+
+				case SO_ELSE:
+				case SO_ENDLOOP:
+					pc = match_[pc];
+					continue;
+
+				case SO_ENDIF:
+				case SO_LOOP:
+					continue;
+
+				case SO_BREAKC:
+					if ((this->Read(*insn.ops[0], false)[0] != 0) == static_cast<bool>(insn.insn.test_nz))
+					{
+						uint32_t depth = 0;
+						for (++ pc; (insns[pc]->opcode != SO_ENDLOOP) || (depth != 0); ++ pc)
+						{
+							if (SO_LOOP == insns[pc]->opcode)
+							{
+								++ depth;
+							}
+							else if (SO_ENDLOOP == insns[pc]->opcode)
+							{
+								-- depth;
+							}
+						}
+					}
+					continue;
+
+				default:
+					if (!this->Execute(insn))
+					{
+						return false;
+					}
+					break;
+				}
+			}
+			return false;
+		}
+
+	private:
+		Vec Read(ShaderOperand const & op, bool is_float) const
+		{
+			Vec ret;
+			if (SOT_IMMEDIATE32 == op.type)
+			{
+				for (uint32_t i = 0; i < 4; ++ i)
+				{
+					ret[i] = static_cast<uint32_t>(op.imm_values[(1 == op.comps) ? 0 : i].i32);
+				}
+			}
+			else
+			{
+				Vec const & reg = (SOT_TEMP == op.type) ? temps_[op.indices[0].disp] : inputs_[op.indices[0].disp];
+				for (uint32_t i = 0; i < 4; ++ i)
+				{
+					ret[i] = reg[(SOSM_MASK == op.mode) ? i : op.swizzle[i]];
+				}
+			}
+
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				if (is_float)
+				{
+					float f = AsFloat(ret[i]);
+					if (op.abs)
+					{
+						f = std::abs(f);
+					}
+					if (op.neg)
+					{
+						f = -f;
+					}
+					ret[i] = AsUInt(f);
+				}
+				else if (op.neg)
+				{
+					ret[i] = 0U - ret[i];
+				}
+			}
+			return ret;
+		}
+
+		void Write(ShaderOperand const & op, Vec const & value, bool sat)
+		{
+			Vec& reg = (SOT_TEMP == op.type) ? temps_[op.indices[0].disp] : outputs_[op.indices[0].disp];
+			for (uint32_t i = 0; i < 4; ++ i)
+			{
+				if (op.mask & (1UL << i))
+				{
+					reg[i] = sat ? AsUInt(std::min(std::max(AsFloat(value[i]), 0.0f), 1.0f)) : value[i];
+				}
+			}
+		}
+
+		bool Execute(ShaderInstruction const & insn)
+		{
+			bool int_srcs;
+			switch (insn.opcode)
+			{
+			case SO_MOV:
+				// Only modifiers make a mov float
+				int_srcs = !insn.ops[1]->neg && !insn.ops[1]->abs;
+				break;
+
+			case SO_IADD:
+			case SO_IMAX:
+			case SO_IMIN:
+			case SO_UMAX:
+			case SO_UMIN:
+			case SO_IEQ:
+			case SO_INE:
+			case SO_ILT:
+			case SO_IGE:
+			case SO_ULT:
+			case SO_UGE:
+			case SO_INEG:
+			case SO_ISHL:
+			case SO_ISHR:
+			case SO_USHR:
+			case SO_ITOF:
+			case SO_UTOF:
+			case SO_AND:
+			case SO_IMAD:
+			case SO_MOVC:
+				int_srcs = true;
+				break;
+
+			default:
+				int_srcs = false;
+				break;
+			}
+
+			Vec const zero = { { 0, 0, 0, 0 } };
+			Vec const a = this->Read(*insn.ops[1], !int_srcs);
+			Vec const b = (insn.num_ops > 2) ? this->Read(*insn.ops[2], !int_srcs) : zero;
+			Vec const c = (insn.num_ops > 3) ? this->Read(*insn.ops[3], !int_srcs) : zero;
+
+			auto float_op = [&a, &b, &c](std::function<float(float, float, float)> const & func)
+			{
+				Vec ret;
+				for (uint32_t i = 0; i < 4; ++ i)
+				{
+					ret[i] = AsUInt(func(AsFloat(a[i]), AsFloat(b[i]), AsFloat(c[i])));
+				}
+				return ret;
+			};
+			auto int_op = [&a, &b, &c](std::function<uint32_t(uint32_t, uint32_t, uint32_t)> const & func)
+			{
+				Vec ret;
+				for (uint32_t i = 0; i < 4; ++ i)
+				{
+					ret[i] = func(a[i], b[i], c[i]);
+				}
+				return ret;
+			};
+			auto dot = [&a, &b](uint32_t n)
+			{
+				float sum = 0;
+				for (uint32_t i = 0; i < n; ++ i)
+				{
+					sum += AsFloat(a[i]) * AsFloat(b[i]);
+				}
+				return Vec{ { AsUInt(sum), AsUInt(sum), AsUInt(sum), AsUInt(sum) } };
+			};
+			auto test = [](bool t)
+			{
+				return t ? ~0U : 0U;
+			};
+
+			Vec result;
+			bool is_float = true;
+			switch (insn.opcode)
+			{
+			case SO_MOV:
+				result = a;
+				break;
+
+			case SO_ADD:
+				result = float_op([](float x, float y, float) { return x + y; });
+				break;
+
+			case SO_MUL:
+				result = float_op([](float x, float y, float) { return x * y; });
+				break;
+
+			case SO_MAD:
+				result = float_op([](float x, float y, float z) { return x * y + z; });
+				break;
+
+			case SO_MIN:
+				result = float_op([](float x, float y, float) { return std::min(x, y); });
+				break;
+
+			case SO_MAX:
+				result = float_op([](float x, float y, float) { return std::max(x, y); });
+				break;
+
+			case SO_DIV:
+				result = float_op([](float x, float y, float) { return x / y; });
+				break;
+
+			case SO_SQRT:
+				result = float_op([](float x, float, float) { return std::sqrt(x); });
+				break;
+
+			case SO_RSQ:
+				result = float_op([](float x, float, float) { return 1 / std::sqrt(x); });
+				break;
+
+			case SO_EXP:
+				result = float_op([](float x, float, float) { return std::exp2(x); });
+				break;
+
+			case SO_LOG:
+				result = float_op([](float x, float, float) { return std::log2(x); });
+				break;
+
+			case SO_FRC:
+				result = float_op([](float x, float, float) { return x - std::floor(x); });
+				break;
+
+			case SO_ROUND_NE:
+				result = float_op([](float x, float, float) { return std::nearbyint(x); });
+				break;
+
+			case SO_ROUND_NI:
+				result = float_op([](float x, float, float) { return std::floor(x); });
+				break;
+
+			case SO_ROUND_PI:
+				result = float_op([](float x, float, float) { return std::ceil(x); });
+				break;
+
+			case SO_ROUND_Z:
+				result = float_op([](float x, float, float) { return std::trunc(x); });
+				break;
+
+			case SO_DP2:
+				result = dot(2);
+				break;
+
+			case SO_DP3:
+				result = dot(3);
+				break;
+
+			case SO_DP4:
+				result = dot(4);
+				break;
+
+			case SO_EQ:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(AsFloat(x) == AsFloat(y)); });
+				is_float = false;
+				break;
+
+			case SO_NE:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(AsFloat(x) != AsFloat(y)); });
+				is_float = false;
+				break;
+
+			case SO_LT:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(AsFloat(x) < AsFloat(y)); });
+				is_float = false;
+				break;
+
+			case SO_GE:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(AsFloat(x) >= AsFloat(y)); });
+				is_float = false;
+				break;
+
+			case SO_FTOI:
+				result = int_op([](uint32_t x, uint32_t, uint32_t)
+					{
+						float const f = AsFloat(x);
+						return (f != f) ? 0U : static_cast<uint32_t>(static_cast<int32_t>(std::min(std::max(f, -2e9f), 2e9f)));
+					});
+				is_float = false;
+				break;
+
+			case SO_FTOU:
+				result = int_op([](uint32_t x, uint32_t, uint32_t)
+					{
+						float const f = AsFloat(x);
+						return ((f != f) || (f < 0)) ? 0U : static_cast<uint32_t>(std::min(f, 4e9f));
+					});
+				is_float = false;
+				break;
+
+			case SO_ITOF:
+				result = int_op([](uint32_t x, uint32_t, uint32_t) { return AsUInt(static_cast<float>(static_cast<int32_t>(x))); });
+				break;
+
+			case SO_UTOF:
+				result = int_op([](uint32_t x, uint32_t, uint32_t) { return AsUInt(static_cast<float>(x)); });
+				break;
+
+			case SO_IADD:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t) { return x + y; });
+				is_float = false;
+				break;
+
+			case SO_IMAD:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t z) { return x * y + z; });
+				is_float = false;
+				break;
+
+			case SO_IMAX:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t)
+					{
+						return static_cast<uint32_t>(std::max(static_cast<int32_t>(x), static_cast<int32_t>(y)));
+					});
+				is_float = false;
+				break;
+
+			case SO_IMIN:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t)
+					{
+						return static_cast<uint32_t>(std::min(static_cast<int32_t>(x), static_cast<int32_t>(y)));
+					});
+				is_float = false;
+				break;
+
+			case SO_UMAX:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t) { return std::max(x, y); });
+				is_float = false;
+				break;
+
+			case SO_UMIN:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t) { return std::min(x, y); });
+				is_float = false;
+				break;
+
+			case SO_IEQ:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(x == y); });
+				is_float = false;
+				break;
+
+			case SO_INE:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(x != y); });
+				is_float = false;
+				break;
+
+			case SO_ILT:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t)
+					{
+						return test(static_cast<int32_t>(x) < static_cast<int32_t>(y));
+					});
+				is_float = false;
+				break;
+
+			case SO_IGE:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t)
+					{
+						return test(static_cast<int32_t>(x) >= static_cast<int32_t>(y));
+					});
+				is_float = false;
+				break;
+
+			case SO_ULT:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(x < y); });
+				is_float = false;
+				break;
+
+			case SO_UGE:
+				result = int_op([test](uint32_t x, uint32_t y, uint32_t) { return test(x >= y); });
+				is_float = false;
+				break;
+
+			case SO_INEG:
+				result = int_op([](uint32_t x, uint32_t, uint32_t) { return 0U - x; });
+				is_float = false;
+				break;
+
+			case SO_ISHL:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t) { return x << (y & 31); });
+				is_float = false;
+				break;
+
+			case SO_ISHR:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t)
+					{
+						return static_cast<uint32_t>(static_cast<int32_t>(x) >> (y & 31));
+					});
+				is_float = false;
+				break;
+
+			case SO_USHR:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t) { return x >> (y & 31); });
+				is_float = false;
+				break;
+
+			case SO_AND:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t) { return x & y; });
+				is_float = false;
+				break;
+
+			case SO_MOVC:
+				result = int_op([](uint32_t x, uint32_t y, uint32_t z) { return x ? y : z; });
+				is_float = false;
+				break;
+
+			default:
+				return false;
+			}
+
+			this->Write(*insn.ops[0], result, insn.insn.sat && is_float);
+			return true;
+		}
+
+	private:
+		ShaderProgram const & program_;
+		std::vector<int> match_;
+		std::vector<int> else_;
+
+		std::array<Vec, NUM_TEMPS> temps_;
+		std::array<Vec, 2> inputs_;
+		std::array<Vec, 2> outputs_;
+	};
+
+	uint32_t CountOpcode(ShaderProgram const & program, ShaderOpcode opcode)
+	{
+		return static_cast<uint32_t>(std::count_if(program.insns.begin(), program.insns.end(),
+			[opcode](std::shared_ptr<ShaderInstruction> const & insn)
+			{
+				return insn->opcode == opcode;
+			}));
+	}
+
+	// Parses the shader twice, optimizes one copy, and runs both on the same inputs. Returns the optimized one.
+	std::shared_ptr<ShaderProgram> ExpectEquivalent(std::vector<uint8_t> const & dxbc, uint32_t seed)
+	{
+		auto container = DXBCParse(dxbc.data());
+		auto const reference = ShaderParse(*container);
+		auto optimized = ShaderParse(*container);
+		ShaderOptimize(*optimized);
+
+		Interpreter ref_interp(*reference);
+		Interpreter opt_interp(*optimized);
+
+		std::mt19937 gen(seed);
+		float const values[] = { 0.5f, 1.0f, 2.0f, -1.5f, 3.25f, 0.0f, 7.0f, -0.25f };
+		for (uint32_t run = 0; run < 16; ++ run)
+		{
+			// A mix of floats and small ints, so both kinds of instructions see meaningful values
+			std::array<Vec, 2> inputs;
+			for (auto& input : inputs)
+			{
+				for (auto& value : input)
+				{
+					value = (gen() & 1) ? AsUInt(values[gen() % std::size(values)]) : (gen() % 20);
+				}
+			}
+
+			std::array<Vec, 2> ref_outputs;
+			std::array<Vec, 2> opt_outputs;
+			bool const ref_finished = ref_interp.Run(inputs, ref_outputs);
+			EXPECT_EQ(ref_finished, opt_interp.Run(inputs, opt_outputs));
+			if (ref_finished)
+			{
+				EXPECT_TRUE(ref_outputs == opt_outputs) << "Seed " << seed << ", run " << run;
+			}
+		}
+
+		// Both translate
+		for (bool optimize : { false, true })
+		{
+			DXBC2GLSL::DXBC2GLSL dxbc2glsl;
+			dxbc2glsl.Optimize(optimize);
+			EXPECT_NO_THROW(dxbc2glsl.FeedDXBC(dxbc.data(), false, true, STP_Fractional_Odd, STOP_Triangle_CW, GSV_430));
+		}
+
+		return optimized;
+	}
+
+	// Random straight line code, ifs and counted loops over 4 temps. r4 is the loop counter.
+	class RandomShaderGenerator
+	{
+	public:
+		explicit RandomShaderGenerator(uint32_t seed)
+			: gen_(seed)
+		{
+		}
+
+		std::vector<uint8_t> Generate()
+		{
+			VertexShaderBuilder vs;
+			for (uint32_t i = 0; i < NUM_VALUE_TEMPS; ++ i)
+			{
+				vs.Insn(SO_MOV, { R(i, XYZW), V(i % 2, "xyzw") });
+			}
+			this->Block(vs, 0, this->Rand(5, 40));
+			vs.Insn(SO_MOV, { O(0), R(this->Rand(0, NUM_VALUE_TEMPS), "xyzw") });
+			vs.Insn(SO_MOV, { O(1), R(this->Rand(0, NUM_VALUE_TEMPS), "xyzw") });
+			return vs.Build();
+		}
+
+	private:
+		// Temps the generated code computes with. The one after them is the loop counter.
+		static uint32_t const NUM_VALUE_TEMPS = 4;
+
+		uint32_t Rand(uint32_t begin, uint32_t end)
+		{
+			return begin + gen_() % (end - begin);
+		}
+
+		bool Chance(float p)
+		{
+			return std::uniform_real_distribution<float>()(gen_) < p;
+		}
+
+		Tokens Source(bool is_int, bool allow_neg)
+		{
+			static float const floats[] = { 0.5f, 1.0f, 2.0f, -1.5f, 3.25f, 0.0f, 0.25f, -4.0f, 1.0f / 3 };
+			static uint32_t const ints[] = { 0, 1, 2, 7, 3, 0xFFFFFFFD, 16 };
+			static char const comps[] = "xyzw";
+
+			auto rand_value = [this, is_int]
+			{
+				return is_int ? ints[this->Rand(0, std::size(ints))] : AsUInt(floats[this->Rand(0, std::size(floats))]);
+			};
+
+			float const kind = std::uniform_real_distribution<float>()(gen_);
+			bool const neg = allow_neg && this->Chance(0.15f);
+			if (kind >= 0.75f)
+			{
+				if (this->Chance(0.5f))
+				{
+					Tokens ret = Imm(rand_value(), rand_value(), rand_value(), rand_value());
+					if (neg && !is_int)
+					{
+						ret[0] |= 1UL << 31;
+						ret.insert(ret.begin() + 1, 1 | (1 << 6));
+					}
+					return ret;
+				}
+				return Imm(rand_value());
+			}
+
+			ShaderOperandType const type = (kind < 0.6f) ? SOT_TEMP : SOT_INPUT;
+			uint32_t const index = (SOT_TEMP == type) ? this->Rand(0, NUM_VALUE_TEMPS) : this->Rand(0, 2);
+			char swizzle[5] = {};
+			uint32_t const num_comps = this->Chance(0.2f) ? 1 : 4;
+			for (uint32_t i = 0; i < num_comps; ++ i)
+			{
+				swizzle[i] = comps[this->Rand(0, 4)];
+			}
+			return Src(type, index, swizzle, neg, !is_int && this->Chance(0.05f));
+		}
+
+		void Instruction(VertexShaderBuilder& vs)
+		{
+			static ShaderOpcode const float_ops[] = { SO_ADD, SO_MUL, SO_MAD, SO_MIN, SO_MAX, SO_DP2, SO_DP3, SO_DP4, SO_DIV,
+				SO_SQRT, SO_RSQ, SO_EXP, SO_LOG, SO_FRC, SO_ROUND_NE, SO_ROUND_NI, SO_ROUND_PI, SO_EQ, SO_NE, SO_LT, SO_GE,
+				SO_FTOI, SO_FTOU };
+			static ShaderOpcode const int_ops[] = { SO_IADD, SO_IMAX, SO_IMIN, SO_UMAX, SO_UMIN, SO_IEQ, SO_INE, SO_ILT, SO_IGE,
+				SO_ULT, SO_UGE, SO_INEG, SO_ISHL, SO_ISHR, SO_USHR, SO_ITOF, SO_UTOF };
+			// Not known to the optimizer
+			static ShaderOpcode const opaque_ops[] = { SO_AND, SO_MOVC, SO_ROUND_Z, SO_IMAD };
+
+			float const kind = std::uniform_real_distribution<float>()(gen_);
+			ShaderOpcode opcode;
+			bool is_int;
+			if (kind < 0.35f)
+			{
+				opcode = SO_MOV;
+				is_int = this->Chance(0.3f);
+			}
+			else if (kind < 0.7f)
+			{
+				opcode = float_ops[this->Rand(0, std::size(float_ops))];
+				is_int = false;
+			}
+			else if (kind < 0.93f)
+			{
+				opcode = int_ops[this->Rand(0, std::size(int_ops))];
+				is_int = true;
+			}
+			else
+			{
+				opcode = opaque_ops[this->Rand(0, std::size(opaque_ops))];
+				is_int = (SO_AND == opcode) || (SO_IMAD == opcode);
+			}
+
+			bool src_int = is_int;
+			uint32_t num_srcs = 2;
+			bool int_compare = false;
+			switch (opcode)
+			{
+			case SO_ITOF:
+			case SO_UTOF:
+				src_int = true;
+				num_srcs = 1;
+				break;
+
+			case SO_FTOI:
+			case SO_FTOU:
+				src_int = false;
+				num_srcs = 1;
+				break;
+
+			case SO_MAD:
+			case SO_MOVC:
+			case SO_IMAD:
+				num_srcs = 3;
+				break;
+
+			case SO_MOV:
+			case SO_SQRT:
+			case SO_RSQ:
+			case SO_EXP:
+			case SO_LOG:
+			case SO_FRC:
+			case SO_ROUND_NE:
+			case SO_ROUND_NI:
+			case SO_ROUND_PI:
+			case SO_ROUND_Z:
+			case SO_INEG:
+				num_srcs = 1;
+				break;
+
+			case SO_ISHL:
+			case SO_ISHR:
+			case SO_USHR:
+			case SO_UMAX:
+			case SO_UMIN:
+			case SO_ULT:
+			case SO_UGE:
+				int_compare = true;
+				break;
+
+			default:
+				break;
+			}
+
+			std::vector<Tokens> ops(1, R(this->Rand(0, NUM_VALUE_TEMPS), this->Rand(1, 16)));
+			for (uint32_t i = 0; i < num_srcs; ++ i)
+			{
+				ops.push_back(this->Source(src_int, !int_compare));
+			}
+			bool const no_sat = is_int || (SO_FTOI == opcode) || (SO_FTOU == opcode)
+				|| (SO_EQ == opcode) || (SO_NE == opcode) || (SO_LT == opcode) || (SO_GE == opcode);
+			vs.Insn(opcode, ops, !no_sat && this->Chance(0.1f));
+		}
+
+		void Block(VertexShaderBuilder& vs, uint32_t depth, uint32_t num_insns)
+		{
+			for (uint32_t i = 0; i < num_insns; ++ i)
+			{
+				float const kind = std::uniform_real_distribution<float>()(gen_);
+				if ((depth < 2) && (kind < 0.08f))
+				{
+					char const comp[] = { "xyzw"[this->Rand(0, 4)], '\0' };
+					vs.Insn(SO_IF, { R(this->Rand(0, NUM_VALUE_TEMPS), comp) }, false, this->Chance(0.5f));
+					this->Block(vs, depth + 1, this->Rand(1, 6));
+					if (this->Chance(0.5f))
+					{
+						vs.Insn(SO_ELSE);
+						this->Block(vs, depth + 1, this->Rand(1, 6));
+					}
+					vs.Insn(SO_ENDIF);
+				}
+				else if ((depth < 2) && (kind < 0.12f))
+				{
+					vs.Insn(SO_MOV, { R(NUM_VALUE_TEMPS, X), Imm(0) });
+					vs.Insn(SO_LOOP);
+					vs.Insn(SO_IGE, { R(NUM_VALUE_TEMPS, Y), R(NUM_VALUE_TEMPS, "x"), Imm(3) });
+					vs.Insn(SO_BREAKC, { R(NUM_VALUE_TEMPS, "y") }, false, true);
+					this->Block(vs, depth + 1, this->Rand(1, 6));
+					vs.Insn(SO_IADD, { R(NUM_VALUE_TEMPS, X), R(NUM_VALUE_TEMPS, "x"), Imm(1) });
+					vs.Insn(SO_ENDLOOP);
+				}
+				else
+				{
+					this->Instruction(vs);
+				}
+			}
+		}
+
+	private:
+		std::mt19937 gen_;
+	};
+}
+
+TEST(DXBC2GLSLTest, CopyChainAcrossSwizzles)
+{
+	VertexShaderBuilder vs;
+	vs.Insn(SO_MOV, { R(0, XYZW), V(0, "yzwx") });
+	vs.Insn(SO_MOV, { R(1, X | Z), R(0, "wzyx") });
+	vs.Insn(SO_MOV, { R(2, XYZW), R(1, "zxzx") });
+	vs.Insn(SO_ADD, { O(0), R(2, "xyzw"), V(1, "xyzw") });
+	vs.Insn(SO_MOV, { O(1), R(0, "x") });
+
+	auto const program = ExpectEquivalent(vs.Build(), 1);
+
+	// r2 = r1.zxzx = r0.ywyw. Only copies between temps are followed, so the chain stops at r0, and the movs to r1
+	// and r2 are gone.
+	ASSERT_EQ(4U, program->insns.size());
+	EXPECT_EQ(SO_MOV, program->insns[0]->opcode);
+	ShaderInstruction const & add = *program->insns[1];
+	ASSERT_EQ(SO_ADD, add.opcode);
+	EXPECT_EQ(SOT_TEMP, add.ops[1]->type);
+	EXPECT_EQ(0, add.ops[1]->indices[0].disp);
+	uint8_t const expected_swizzle[] = { 1, 3, 1, 3 };
+	EXPECT_TRUE(std::equal(std::begin(expected_swizzle), std::end(expected_swizzle), add.ops[1]->swizzle));
+	EXPECT_EQ(SO_MOV, program->insns[2]->opcode);
+}
+
+TEST(DXBC2GLSLTest, CopyChainBrokenByOverwrite)
+{
+	VertexShaderBuilder vs;
+	vs.Insn(SO_MOV, { R(0, XYZW), V(0, "xyzw") });
+	vs.Insn(SO_MOV, { R(1, XYZW), R(0, "yxwz") });
+	// r1 still holds the old r0.y
+	vs.Insn(SO_MOV, { R(0, Y), V(1, "w") });
+	vs.Insn(SO_MOV, { R(2, XYZW), R(1, "xxxx") });
+	vs.Insn(SO_ADD, { O(0), R(2, "xyzw"), R(0, "yyyy") });
+	vs.Insn(SO_MOV, { O(1), R(1, "xyzw") });
+
+	ExpectEquivalent(vs.Build(), 2);
+}
+
+TEST(DXBC2GLSLTest, DeadWritesBeforeLoop)
+{
+	VertexShaderBuilder vs;
+	vs.Insn(SO_MOV, { R(3, XYZW), V(0, "xyzw") });
+	// Overwritten before anything reads it
+	vs.Insn(SO_MOV, { R(2, XYZW), V(1, "x") });
+	// Only read inside the loop
+	vs.Insn(SO_MOV, { R(2, XYZW), V(0, "y") });
+	// Only read after the loop
+	vs.Insn(SO_MOV, { R(5, XYZW), V(1, "zwxy") });
+	// Only read inside the loop, overwritten after it
+	vs.Insn(SO_MOV, { R(6, XYZW), V(0, "wzyx") });
+	vs.Insn(SO_MOV, { R(4, X), Imm(0) });
+	vs.Insn(SO_LOOP);
+	vs.Insn(SO_IGE, { R(4, Y), R(4, "x"), Imm(3) });
+	vs.Insn(SO_BREAKC, { R(4, "y") }, false, true);
+	vs.Insn(SO_ADD, { R(3, XYZW), R(3, "xyzw"), R(2, "xxxx") });
+	vs.Insn(SO_MUL, { R(3, XYZW), R(3, "xyzw"), R(6, "xyzw") });
+	// Read in the next iteration and after the loop
+	vs.Insn(SO_MOV, { R(2, X), R(3, "w") });
+	// Only read in the next iteration, overwritten after the loop
+	vs.Insn(SO_MOV, { R(6, XYZW), R(3, "yxwz") });
+	vs.Insn(SO_IADD, { R(4, X), R(4, "x"), Imm(1) });
+	vs.Insn(SO_ENDLOOP);
+	vs.Insn(SO_MOV, { R(6, XYZW), V(1, "xyzw") });
+	vs.Insn(SO_ADD, { O(0), R(3, "xyzw"), R(5, "xyzw") });
+	vs.Insn(SO_ADD, { O(1), R(2, "xxxx"), R(6, "xyzw") });
+
+	auto const program = ExpectEquivalent(vs.Build(), 3);
+
+	// Only the first write to r2 goes away
+	uint32_t num_r2_writes_before_loop = 0;
+	for (auto const & insn : program->insns)
+	{
+		if (SO_LOOP == insn->opcode)
+		{
+			break;
+		}
+		if ((insn->num_ops > 0) && (SOT_TEMP == insn->ops[0]->type) && (2 == insn->ops[0]->indices[0].disp))
+		{
+			++ num_r2_writes_before_loop;
+			EXPECT_EQ(SOT_INPUT, insn->ops[1]->type);
+			EXPECT_EQ(0, insn->ops[1]->indices[0].disp);
+		}
+	}
+	EXPECT_EQ(1U, num_r2_writes_before_loop);
+}
+
+TEST(DXBC2GLSLTest, OpaqueInstructions)
+{
+	VertexShaderBuilder vs;
+	vs.Insn(SO_MOV, { R(0, XYZW), V(0, "xyzw") });
+	vs.Insn(SO_MOV, { R(1, XYZW), R(0, "wzyx") });
+	// movc and and aren't known to the optimizer. They read and write all of their temps.
+	vs.Insn(SO_MOVC, { R(2, XYZW), R(1, "xyzw"), R(0, "xyzw"), V(1, "xyzw") });
+	vs.Insn(SO_AND, { R(3, XYZW), R(1, "xyzw"), Imm(0x7FFFFFFF) });
+	// A copy that an opaque instruction overwrites in part isn't a copy anymore
+	vs.Insn(SO_MOV, { R(4, XYZW), R(0, "yyyy") });
+	vs.Insn(SO_AND, { R(4, X), R(4, "x"), Imm(0xFFFF) });
+	// Only the opaque instructions read the r1 overwritten here
+	vs.Insn(SO_MOV, { R(1, XYZW), R(4, "xyzw") });
+	vs.Insn(SO_ADD, { O(0), R(2, "xyzw"), R(3, "xyzw") });
+	vs.Insn(SO_MOV, { O(1), R(1, "xyzw") });
+
+	auto const program = ExpectEquivalent(vs.Build(), 4);
+
+	EXPECT_EQ(1U, CountOpcode(*program, SO_MOVC));
+	EXPECT_EQ(2U, CountOpcode(*program, SO_AND));
+	for (auto const & insn : program->insns)
+	{
+		if ((SO_MOVC == insn->opcode) || (SO_AND == insn->opcode))
+		{
+			// Their sources are left as they were
+			EXPECT_EQ(SOT_TEMP, insn->ops[1]->type);
+		}
+	}
+}
+
+TEST(DXBC2GLSLTest, RandomShaders)
+{
+	uint32_t num_insns_before = 0;
+	uint32_t num_insns_after = 0;
+	for (uint32_t seed = 0; seed < 500; ++ seed)
+	{
+		auto const dxbc = RandomShaderGenerator(seed).Generate();
+		auto const program = ExpectEquivalent(dxbc, seed);
+		if (::testing::Test::HasFailure())
+		{
+			break;
+		}
+
+		num_insns_before += static_cast<uint32_t>(ShaderParse(*DXBCParse(dxbc.data()))->insns.size());
+		num_insns_after += static_cast<uint32_t>(program->insns.size());
+	}
+	EXPECT_LT(num_insns_after, num_insns_before);
+}
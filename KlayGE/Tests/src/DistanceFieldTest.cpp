@@ -0,0 +1,181 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/DistanceField.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	std::vector<uint8_t> RandomMask(uint32_t num, float density, std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> dis(0, 1);
+		std::vector<uint8_t> mask(num);
+		for (auto& m : mask)
+		{
+			m = (dis(gen) < density) ? 255 : 0;
+		}
+		return mask;
+	}
+
+	float BruteForceDistance(std::vector<uint8_t> const & mask, bool inside, uint32_t width, uint32_t height, uint32_t depth,
+		uint32_t x, uint32_t y, uint32_t z)
+	{
+		float min_sq_dist = 1e20f;
+		for (uint32_t fz = 0; fz < depth; ++ fz)
+		{
+			for (uint32_t fy = 0; fy < height; ++ fy)
+			{
+				for (uint32_t fx = 0; fx < width; ++ fx)
+				{
+					if ((mask[(fz * height + fy) * width + fx] != 0) != inside)
+					{
+						float const dx = static_cast<float>(fx) - x;
+						float const dy = static_cast<float>(fy) - y;
+						float const dz = static_cast<float>(fz) - z;
+						min_sq_dist = std::min(min_sq_dist, dx * dx + dy * dy + dz * dz);
+					}
+				}
+			}
+		}
+		return MathLib::sqrt(min_sq_dist);
+	}
+}
+
+TEST(DistanceFieldTest, ExactMatchesBruteForce)
+{
+	std::ranlux24_base gen;
+
+	uint32_t const sizes[][3] = { { 37, 1, 1 }, { 31, 23, 1 }, { 19, 13, 11 }, { 1, 17, 9 } };
+	for (auto const & size : sizes)
+	{
+		for (float density : { 0.002f, 0.05f, 0.5f })
+		{
+			uint32_t const width = size[0];
+			uint32_t const height = size[1];
+			uint32_t const depth = size[2];
+			auto const mask = RandomMask(width * height * depth, density, gen);
+			if (std::find(mask.begin(), mask.end(), 255) == mask.end())
+			{
+				continue;
+			}
+
+			std::vector<float> dist;
+			ComputeEuclideanDistance(mask, width, height, depth, dist);
+			EXPECT_EQ(dist.size(), mask.size());
+
+			for (uint32_t z = 0; z < depth; ++ z)
+			{
+				for (uint32_t y = 0; y < height; ++ y)
+				{
+					for (uint32_t x = 0; x < width; ++ x)
+					{
+						EXPECT_EQ(dist[(z * height + y) * width + x],
+							BruteForceDistance(mask, false, width, height, depth, x, y, z));
+					}
+				}
+			}
+		}
+	}
+}
+
+TEST(DistanceFieldTest, SignedMatchesBruteForce)
+{
+	std::ranlux24_base gen;
+
+	uint32_t const width = 29;
+	uint32_t const height = 21;
+	uint32_t const depth = 7;
+	auto const mask = RandomMask(width * height * depth, 0.3f, gen);
+
+	std::vector<float> dist;
+	ComputeSignedEuclideanDistance(mask, width, height, depth, dist);
+
+	for (uint32_t z = 0; z < depth; ++ z)
+	{
+		for (uint32_t y = 0; y < height; ++ y)
+		{
+			for (uint32_t x = 0; x < width; ++ x)
+			{
+				uint32_t const addr = (z * height + y) * width + x;
+				if (mask[addr] != 0)
+				{
+					EXPECT_EQ(dist[addr], BruteForceDistance(mask, true, width, height, depth, x, y, z) - 0.5f);
+				}
+				else
+				{
+					EXPECT_EQ(dist[addr], 0.5f - BruteForceDistance(mask, false, width, height, depth, x, y, z));
+				}
+			}
+		}
+	}
+}
+
+TEST(DistanceFieldTest, AADistanceMatchesAnalytic)
+{
+	// A filled disk with a soft edge, at 2x resolution
+	uint32_t const size = 64;
+	float const radius = 37.3f;
+	std::vector<float> aa_2x_data(size * size * 4);
+	for (uint32_t y = 0; y < size * 2; ++ y)
+	{
+		for (uint32_t x = 0; x < size * 2; ++ x)
+		{
+			float const r = MathLib::length(float2(x + 0.5f - size * 0.9f, y + 0.5f - size * 1.1f));
+			aa_2x_data[y * size * 2 + x] = MathLib::clamp(radius + 0.5f - r, 0.0f, 1.0f);
+		}
+	}
+
+	std::vector<float> dist;
+	ComputeDistance(aa_2x_data, size * 2, size * 2, dist);
+	EXPECT_EQ(dist.size(), size * size);
+
+	// In the half resolution texel space, the edge is a circle of radius / 2
+	float max_error = 0;
+	for (uint32_t y = 1; y < size - 1; ++ y)
+	{
+		for (uint32_t x = 1; x < size - 1; ++ x)
+		{
+			float const r = MathLib::length(float2(x + 0.5f - size * 0.45f, y + 0.5f - size * 0.55f));
+			max_error = std::max(max_error, MathLib::abs(dist[y * size + x] - (radius / 2 - r)));
+		}
+	}
+	EXPECT_LT(max_error, 0.25f);
+}
+
+TEST(DistanceFieldTest, Performance)
+{
+	uint32_t const size = 256;
+
+	// A sphere and a few slabs
+	std::vector<uint8_t> mask(size * size * size);
+	for (uint32_t z = 0; z < size; ++ z)
+	{
+		for (uint32_t y = 0; y < size; ++ y)
+		{
+			for (uint32_t x = 0; x < size; ++ x)
+			{
+				float3 const p(x - size * 0.5f, y - size * 0.4f, z - size * 0.6f);
+				bool const in_sphere = (MathLib::length(p) < size * 0.3f);
+				bool const in_slab = ((x + y / 2) % 97 == 0);
+				mask[(z * size + y) * size + x] = (in_sphere || in_slab) ? 255 : 0;
+			}
+		}
+	}
+
+	Timer timer;
+	std::vector<float> dist;
+	ComputeSignedEuclideanDistance(mask, size, size, size, dist);
+	double const time = timer.elapsed();
+
+	EXPECT_EQ(dist.size(), mask.size());
+	cout << size << "^3 signed distance field: " << time * 1000 << " ms." << endl;
+}
@@ -0,0 +1,162 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/JudaTexture.hpp>
+#include <KlayGE/ResLoader.hpp>
+
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t const NUM_TILES = 64;
+	uint32_t const TILE_SIZE = 8;
+
+	bool IsFlat(uint32_t x, uint32_t y)
+	{
+		return ((x / 8 + y / 8) % 3) == 0;
+	}
+
+	uint32_t ExpectedAttr(uint32_t x, uint32_t y)
+	{
+		return (x * 7 + y) % 5;
+	}
+
+	JudaTexturePtr CreateJudaTexture()
+	{
+		auto jt = MakeSharedPtr<JudaTexture>(NUM_TILES, TILE_SIZE, EF_ABGR8);
+		jt->AddImageEntry("test", 0, 0, NUM_TILES, NUM_TILES, TAM_Wrap, TAM_Wrap, Color(0, 0, 0, 0));
+
+		std::mt19937 gen(1);
+		for (uint32_t y = 0; y < NUM_TILES; ++ y)
+		{
+			std::vector<std::vector<uint8_t>> tiles(NUM_TILES);
+			std::vector<uint32_t> tile_ids(NUM_TILES);
+			std::vector<uint32_t> tile_attrs(NUM_TILES);
+			for (uint32_t x = 0; x < NUM_TILES; ++ x)
+			{
+				// Flat tiles are fully predicted by their parents, so that parts of the tree get compacted
+				bool const flat = IsFlat(x, y);
+
+				tiles[x].resize(TILE_SIZE * TILE_SIZE * 4);
+				for (auto& texel : tiles[x])
+				{
+					texel = flat ? 128 : static_cast<uint8_t>(gen());
+				}
+				tile_ids[x] = jt->EncodeTileID(jt->TreeLevels() - 1, x, y);
+				tile_attrs[x] = ExpectedAttr(x, y);
+			}
+			jt->CommitTiles(tiles, tile_ids, tile_attrs);
+		}
+
+		return jt;
+	}
+}
+
+TEST(JudaTextureTest, TileAttr)
+{
+	auto jt = CreateJudaTexture();
+	uint32_t const leaf_level = jt->TreeLevels() - 1;
+
+	EXPECT_LE(jt->NumNonEmptyNodes(), jt->NumNodes());
+	for (uint32_t y = 0; y < NUM_TILES; ++ y)
+	{
+		for (uint32_t x = 0; x < NUM_TILES; ++ x)
+		{
+			// A compacted tile has no node of its own, it inherits the attribute of its nearest ancestor
+			if (!IsFlat(x, y))
+			{
+				EXPECT_EQ(jt->TileAttr(jt->EncodeTileID(leaf_level, x, y)), ExpectedAttr(x, y));
+			}
+		}
+	}
+
+	uint32_t const NUM_ROUNDS = 100;
+	uint32_t sum = 0;
+	Timer timer;
+	for (uint32_t r = 0; r < NUM_ROUNDS; ++ r)
+	{
+		for (uint32_t y = 0; y < NUM_TILES; ++ y)
+		{
+			for (uint32_t x = 0; x < NUM_TILES; ++ x)
+			{
+				sum += jt->TileAttr(jt->EncodeTileID(leaf_level, x, y));
+			}
+		}
+	}
+	double const ns = timer.elapsed() * 1e9 / (NUM_ROUNDS * NUM_TILES * NUM_TILES);
+	EXPECT_GT(sum, 0U);
+
+	cout << NUM_TILES * NUM_TILES << " tiles, " << jt->NumNodes() << " nodes, " << jt->TreeMemorySize() << " bytes, "
+		<< ns << " ns/lookup" << endl;
+}
+
+TEST(JudaTextureTest, SaveLoad)
+{
+	auto jt = CreateJudaTexture();
+
+	std::string const file_name = ResLoader::Instance().LocalFolder() + "JudaTextureTest.jdt";
+	SaveJudaTexture(jt, file_name);
+	auto loaded = LoadJudaTexture(file_name);
+	ASSERT_TRUE(loaded);
+
+	EXPECT_EQ(loaded->NumTiles(), jt->NumTiles());
+	EXPECT_EQ(loaded->NumNonEmptyNodes(), jt->NumNonEmptyNodes());
+	EXPECT_EQ(loaded->NumNodes(), jt->NumNodes());
+
+	for (uint32_t level = 0; level < jt->TreeLevels(); ++ level)
+	{
+		for (uint32_t y = 0; y < (1UL << level); ++ y)
+		{
+			for (uint32_t x = 0; x < (1UL << level); ++ x)
+			{
+				uint32_t const tile_id = jt->EncodeTileID(level, x, y);
+				EXPECT_EQ(loaded->TileAttr(tile_id), jt->TileAttr(tile_id));
+			}
+		}
+	}
+}
+
+TEST(JudaTextureTest, AsyncDecode)
+{
+	std::string const file_name = ResLoader::Instance().LocalFolder() + "JudaTextureAsyncTest.jdt";
+	SaveJudaTexture(CreateJudaTexture(), file_name);
+	auto jt = LoadJudaTexture(file_name);
+	ASSERT_TRUE(jt);
+	jt->CacheProperty(256, EF_ABGR8, 1);
+
+	// A tile that was never requested comes every frame, so there is always a new batch
+	uint32_t const leaf_level = jt->TreeLevels() - 1;
+	for (uint32_t i = 0; i < NUM_TILES * 2; ++ i)
+	{
+		jt->UpdateCache({ jt->EncodeTileID(leaf_level, i % NUM_TILES, i / NUM_TILES) });
+
+		// Every batch still held has a tile that isn't in the cache yet, finished batches are gone
+		EXPECT_GE(jt->NumDecodeBatches(), 1U);
+		EXPECT_LE(jt->NumDecodeBatches(), jt->NumPendingTiles());
+	}
+
+	Timer timer;
+	while (((jt->NumPendingTiles() > 0) || (jt->NumDecodeBatches() > 0)) && (timer.elapsed() < 30))
+	{
+		jt->UpdateCache({});
+		std::this_thread::yield();
+	}
+	EXPECT_EQ(jt->NumPendingTiles(), 0U);
+	EXPECT_EQ(jt->NumDecodeBatches(), 0U);
+
+	// Tiles that are in the cache don't start new batches
+	jt->UpdateCache({ jt->EncodeTileID(leaf_level, NUM_TILES - 1, 1) });
+	EXPECT_EQ(jt->NumPendingTiles(), 0U);
+	EXPECT_EQ(jt->NumDecodeBatches(), 0U);
+
+	jt.reset();
+	std::filesystem::remove(file_name);
+}
@@ -0,0 +1,119 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/CXX17/filesystem.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <kfont/kfont.hpp>
+
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t const CHAR_SIZE = 32;
+	wchar_t const FIRST_CHAR = L'A';
+	wchar_t const LAST_CHAR = L'Z';
+
+	// Random distances don't compress, so the distance data is much larger than the tables
+	std::vector<uint8_t> Distances(wchar_t ch)
+	{
+		std::mt19937 gen(ch);
+		std::vector<uint8_t> distances(CHAR_SIZE * CHAR_SIZE);
+		for (auto& d : distances)
+		{
+			d = static_cast<uint8_t>(gen());
+		}
+		return distances;
+	}
+
+	class KFontTest : public testing::Test
+	{
+	public:
+		void SetUp() override
+		{
+			file_name_ = (std::filesystem::temp_directory_path() / "KlayGEKFontTest.kfont").string();
+
+			KFont font;
+			font.CharSize(CHAR_SIZE);
+			font.DistBase(-4);
+			font.DistScale(8);
+			for (wchar_t ch = FIRST_CHAR; ch <= LAST_CHAR; ++ ch)
+			{
+				KFont::font_info fi;
+				fi.top = static_cast<int16_t>(ch - FIRST_CHAR);
+				fi.left = 1;
+				fi.width = 20;
+				fi.height = 24;
+				font.SetDistanceData(ch, Distances(ch).data(), 22, fi);
+			}
+			font.SetLZMADistanceData(L' ', nullptr, 0, 11, KFont::font_info());
+			font.Compact();
+			ASSERT_TRUE(font.Save(file_name_));
+		}
+
+		void TearDown() override
+		{
+			std::filesystem::remove(file_name_);
+		}
+
+		void ExpectGlyphs(KFont const & font)
+		{
+			EXPECT_EQ(font.CharSize(), CHAR_SIZE);
+			EXPECT_EQ(font.DistBase(), -4);
+			EXPECT_EQ(font.DistScale(), 8);
+
+			EXPECT_EQ(font.CharIndex(L' '), -1);
+			EXPECT_EQ(font.CharAdvance(L' '), 11U);
+			EXPECT_EQ(font.CharIndex(L'a'), -1);
+
+			std::vector<uint8_t> distances(CHAR_SIZE * CHAR_SIZE);
+			for (wchar_t ch = FIRST_CHAR; ch <= LAST_CHAR; ++ ch)
+			{
+				auto const index_adv = font.CharIndexAdvance(ch);
+				ASSERT_NE(index_adv.first, -1);
+				EXPECT_EQ(index_adv.second, 22U);
+				EXPECT_EQ(font.CharInfo(index_adv.first).top, ch - FIRST_CHAR);
+
+				font.GetDistanceData(distances.data(), CHAR_SIZE, index_adv.first);
+				EXPECT_EQ(distances, Distances(ch));
+			}
+		}
+
+	protected:
+		std::string file_name_;
+	};
+}
+
+TEST_F(KFontTest, Streamed)
+{
+	KFont font;
+	ASSERT_TRUE(font.Load(MakeSharedPtr<ResIdentifier>(file_name_, 0,
+		MakeSharedPtr<std::ifstream>(file_name_.c_str(), std::ios_base::binary | std::ios_base::in))));
+	EXPECT_FALSE(font.Mapped());
+
+	// Only the tables are in memory. Distance data is read from the stream and doesn't stay.
+	size_t const resident_size = font.ResidentSize();
+	EXPECT_GT(resident_size, 0U);
+	EXPECT_LT(resident_size, std::filesystem::file_size(file_name_) / 4);
+
+	this->ExpectGlyphs(font);
+	EXPECT_EQ(font.ResidentSize(), resident_size);
+}
+
+TEST_F(KFontTest, Mapped)
+{
+	KFont font;
+	ASSERT_TRUE(font.Load(file_name_));
+	this->ExpectGlyphs(font);
+
+	// Every page has been touched, so the whole file counts
+	if (font.Mapped())
+	{
+		EXPECT_GE(font.ResidentSize(), std::filesystem::file_size(file_name_));
+	}
+}
@@ -0,0 +1,187 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Timer.hpp>
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// Captures what the logger writes to std::clog
+	class ClogCapture
+	{
+	public:
+		ClogCapture()
+		{
+			LogFlush();
+			old_buff_ = std::clog.rdbuf(ss_.rdbuf());
+		}
+		~ClogCapture()
+		{
+			std::clog.rdbuf(old_buff_);
+		}
+
+		std::vector<std::string> Lines()
+		{
+			LogFlush();
+
+			std::vector<std::string> lines;
+			std::string line;
+			while (std::getline(ss_, line))
+			{
+				lines.push_back(line);
+			}
+			return lines;
+		}
+
+		// What is out so far, without flushing
+		std::string Written() const
+		{
+			return ss_.str();
+		}
+
+	private:
+		std::stringstream ss_;
+		std::streambuf* old_buff_;
+	};
+}
+
+TEST(LogTest, ThreadsKeepOrder)
+{
+	uint32_t const NUM_THREADS = 4;
+	uint32_t const NUM_RECORDS = 1000;
+
+	ClogCapture capture;
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 0; t < NUM_THREADS; ++ t)
+	{
+		threads.emplace_back([t]
+			{
+				for (uint32_t i = 0; i < NUM_RECORDS; ++ i)
+				{
+					LogInfo() << "LogTest thread " << t << " record " << i << std::endl;
+				}
+			});
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+
+	std::vector<uint32_t> next(NUM_THREADS, 0);
+	for (auto const & line : capture.Lines())
+	{
+		uint32_t t, i;
+		if (sscanf(line.c_str(), "(INFO) KlayGE: LogTest thread %u record %u", &t, &i) == 2)
+		{
+			ASSERT_LT(t, NUM_THREADS);
+			EXPECT_EQ(i, next[t]);
+			next[t] = i + 1;
+		}
+	}
+	for (uint32_t t = 0; t < NUM_THREADS; ++ t)
+	{
+		EXPECT_EQ(next[t], NUM_RECORDS);
+	}
+}
+
+TEST(LogTest, StructuredRateLimit)
+{
+	ClogCapture capture;
+
+	for (uint32_t i = 0; i < 100; ++ i)
+	{
+		KLAYGE_LOG(LL_Warn, "LogTest repeated", { { "index", i }, { "name", "a b" } });
+	}
+
+	uint32_t num_written = 0;
+	for (auto const & line : capture.Lines())
+	{
+		if (line.find("LogTest repeated") != std::string::npos)
+		{
+			if (0 == num_written)
+			{
+				EXPECT_EQ(line, "(WARN) KlayGE: LogTest repeated index=0 name=\"a b\"");
+			}
+			++ num_written;
+		}
+	}
+	EXPECT_GT(num_written, 0U);
+	EXPECT_LT(num_written, 100U);
+}
+
+TEST(LogTest, MacroIsAStatement)
+{
+	ClogCapture capture;
+
+	for (uint32_t i = 0; i < 2; ++ i)
+	{
+		// Without braces on purpose, KLAYGE_LOG has to behave as a single statement
+		if (0 == i)
+			KLAYGE_LOG(LL_Warn, "LogTest if branch");
+		else
+			KLAYGE_LOG(LL_Warn, "LogTest else branch");
+	}
+
+	bool if_written = false;
+	bool else_written = false;
+	for (auto const & line : capture.Lines())
+	{
+		if_written |= (line.find("LogTest if branch") != std::string::npos);
+		else_written |= (line.find("LogTest else branch") != std::string::npos);
+	}
+	EXPECT_TRUE(if_written);
+	EXPECT_TRUE(else_written);
+}
+
+TEST(LogTest, ErrorsAreWrittenImmediately)
+{
+	ClogCapture capture;
+
+	// Nothing drains the queues after a throw or a terminate, so errors can't wait for the flusher
+	LogError() << "LogTest stream error" << std::endl;
+	EXPECT_NE(capture.Written().find("(ERROR) KlayGE: LogTest stream error"), std::string::npos);
+
+	KLAYGE_LOG(LL_Error, "LogTest structured error", { { "code", 42 } });
+	EXPECT_NE(capture.Written().find("(ERROR) KlayGE: LogTest structured error code=42"), std::string::npos);
+
+#if defined(KLAYGE_DEBUG) || !defined(KLAYGE_BUILTIN_UNREACHABLE)
+	EXPECT_ANY_THROW(KFLUnreachableInternal("LogTest unreachable", __FILE__, __LINE__));
+	EXPECT_NE(capture.Written().find("(ERROR) KlayGE: LogTest unreachable"), std::string::npos);
+#endif
+}
+
+TEST(LogTest, Benchmark)
+{
+	uint32_t const NUM_RECORDS = 500;
+
+	ClogCapture capture;
+
+	Timer timer;
+	for (uint32_t i = 0; i < NUM_RECORDS; ++ i)
+	{
+		LogInfo() << "LogTest benchmark " << i << std::endl;
+	}
+	double const ns = timer.elapsed() * 1e9 / NUM_RECORDS;
+
+	uint32_t num_written = 0;
+	for (auto const & line : capture.Lines())
+	{
+		if (line.find("LogTest benchmark") != std::string::npos)
+		{
+			++ num_written;
+		}
+	}
+	EXPECT_EQ(num_written, NUM_RECORDS);
+
+	cout << "Log: " << ns << " ns/record" << endl;
+}
@@ -0,0 +1,374 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/Camera.hpp>
+#include <KlayGE/FrameBuffer.hpp>
+#include <KlayGE/Mesh.hpp>
+#include <KlayGE/MeshCluster.hpp>
+#include <KlayGE/RenderEffect.hpp>
+#include <KlayGE/App3D.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
+#include <KlayGE/Texture.hpp>
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t const NUM_RINGS = 64;
+	uint32_t const NUM_SEGMENTS = 128;
+	uint32_t const MAX_CLUSTER_TRIANGLES = 64;
+
+	void CreateSphere(std::vector<float3>& positions, std::vector<uint32_t>& indices)
+	{
+		positions.clear();
+		indices.clear();
+		for (uint32_t ring = 0; ring <= NUM_RINGS; ++ ring)
+		{
+			float const theta = PI * ring / NUM_RINGS;
+			for (uint32_t seg = 0; seg <= NUM_SEGMENTS; ++ seg)
+			{
+				float const phi = 2 * PI * seg / NUM_SEGMENTS;
+				positions.push_back(float3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)));
+			}
+		}
+		for (uint32_t ring = 0; ring < NUM_RINGS; ++ ring)
+		{
+			for (uint32_t seg = 0; seg < NUM_SEGMENTS; ++ seg)
+			{
+				uint32_t const v0 = ring * (NUM_SEGMENTS + 1) + seg;
+				uint32_t const v1 = v0 + 1;
+				uint32_t const v2 = v0 + NUM_SEGMENTS + 1;
+				uint32_t const v3 = v2 + 1;
+				indices.insert(indices.end(), { v0, v1, v2, v1, v3, v2 });
+			}
+		}
+	}
+
+	std::vector<std::array<uint32_t, 3>> SortedTriangles(std::vector<uint32_t> const & indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			triangles.push_back({ { indices[i + 0], indices[i + 1], indices[i + 2] } });
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	Frustum MakeFrustum(float3 const & eye_pos, float3 const & look_at)
+	{
+		float4x4 const view_proj = MathLib::look_at_lh(eye_pos, look_at, float3(0, 1, 0))
+			* MathLib::perspective_fov_lh(PI / 4, 1.0f, 0.1f, 100.0f);
+		Frustum frustum;
+		frustum.ClipMatrix(view_proj, MathLib::inverse(view_proj));
+		return frustum;
+	}
+
+	bool OutsideFrustum(Frustum const & frustum, float3 const & p0, float3 const & p1, float3 const & p2)
+	{
+		for (uint32_t i = 0; i < 6; ++ i)
+		{
+			auto const & plane = frustum.FrustumPlane(i);
+			if ((MathLib::dot_coord(plane, p0) <= 0) && (MathLib::dot_coord(plane, p1) <= 0)
+				&& (MathLib::dot_coord(plane, p2) <= 0))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	StaticMeshPtr CreateClusteredSphereMesh(std::vector<float3> const & positions, std::vector<uint32_t> const & indices,
+		std::vector<MeshCluster> const & clusters)
+	{
+		auto mesh = MakeSharedPtr<StaticMesh>(L"ClusteredSphere");
+		mesh->AddVertexStream(0, positions.data(), static_cast<uint32_t>(positions.size() * sizeof(positions[0])),
+			VertexElement(VEU_Position, 0, EF_BGR32F), EAH_GPU_Read | EAH_Immutable);
+		mesh->AddIndexStream(0, indices.data(), static_cast<uint32_t>(indices.size() * sizeof(indices[0])), EF_R32UI,
+			EAH_GPU_Read | EAH_Immutable);
+		mesh->NumVertices(0, static_cast<uint32_t>(positions.size()));
+		mesh->NumIndices(0, static_cast<uint32_t>(indices.size()));
+		mesh->PosBound(AABBox(float3(-1, -1, -1), float3(1, 1, 1)));
+		mesh->Clusters(0, clusters);
+		auto effect = SyncLoadRenderEffect("MeshCluster/MeshClusterTest.fxml");
+		mesh->Technique(effect, effect->TechniqueByName("MeshCluster"));
+		return mesh;
+	}
+
+	// Exposes the flush of the scene without running the update thread or the app passes
+	class ClusterTestSceneManager : public SceneManager
+	{
+	public:
+		void RenderScene()
+		{
+			visible_marks_map_.clear();
+			this->Flush(App3DFramework::URV_NeedFlush);
+		}
+
+		void OnSceneChanged() override
+		{
+		}
+
+	protected:
+		void DoSuspend() override
+		{
+		}
+		void DoResume() override
+		{
+		}
+	};
+}
+
+TEST(MeshClusterTest, Build)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	CreateSphere(positions, indices);
+	auto const original_triangles = SortedTriangles(indices);
+
+	auto const clusters = BuildMeshClusters(positions, indices, MAX_CLUSTER_TRIANGLES);
+	EXPECT_EQ(SortedTriangles(indices), original_triangles);
+
+	uint32_t start_index = 0;
+	for (auto const & cluster : clusters)
+	{
+		EXPECT_EQ(cluster.start_index, start_index);
+		EXPECT_LE(cluster.num_indices, MAX_CLUSTER_TRIANGLES * 3);
+		start_index += cluster.num_indices;
+
+		for (uint32_t i = cluster.start_index; i < cluster.start_index + cluster.num_indices; ++ i)
+		{
+			EXPECT_LE(MathLib::length(positions[indices[i]] - cluster.center), cluster.radius * 1.0001f);
+		}
+	}
+	EXPECT_EQ(start_index, indices.size());
+	EXPECT_LT(clusters.size(), original_triangles.size() / MAX_CLUSTER_TRIANGLES * 3 / 2);
+}
+
+TEST(MeshClusterTest, CullIsConservative)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	CreateSphere(positions, indices);
+	auto const clusters = BuildMeshClusters(positions, indices, MAX_CLUSTER_TRIANGLES);
+	uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+
+	float3 const eye_positions[] = { float3(0, 0, -5), float3(3, 2, 1), float3(0, 0, -1.5f), float3(0.5f, 0, -2) };
+	for (auto const & eye_pos : eye_positions)
+	{
+		Frustum const frustum = MakeFrustum(eye_pos, float3(0.3f, 0.2f, 0));
+
+		MeshClusterCuller culler;
+		culler.BeginFrame(frustum, eye_pos);
+		std::vector<MeshClusterCuller::IndexRange> ranges;
+		uint32_t const num_visible = culler.Cull(clusters, 0, float4x4::Identity(), true, ranges);
+
+		auto const & stats = culler.FrameStats();
+		EXPECT_EQ(stats.num_clusters, clusters.size());
+		EXPECT_EQ(stats.num_triangles, num_triangles);
+		EXPECT_EQ(stats.num_triangles_culled + num_visible, num_triangles);
+		EXPECT_GT(stats.num_backface_culled, 0U);
+
+		std::vector<bool> visible(num_triangles, false);
+		uint32_t num_range_triangles = 0;
+		for (size_t i = 0; i < ranges.size(); ++ i)
+		{
+			if (i > 0)
+			{
+				EXPECT_GT(ranges[i].start_index, ranges[i - 1].start_index + ranges[i - 1].num_indices);
+			}
+			for (uint32_t j = ranges[i].start_index; j < ranges[i].start_index + ranges[i].num_indices; j += 3)
+			{
+				visible[j / 3] = true;
+			}
+			num_range_triangles += ranges[i].num_indices / 3;
+		}
+		EXPECT_EQ(num_range_triangles, num_visible);
+
+		for (uint32_t i = 0; i < num_triangles; ++ i)
+		{
+			if (!visible[i])
+			{
+				float3 const & p0 = positions[indices[i * 3 + 0]];
+				float3 const & p1 = positions[indices[i * 3 + 1]];
+				float3 const & p2 = positions[indices[i * 3 + 2]];
+				bool const backfacing = MathLib::dot(p0 - eye_pos, MathLib::cross(p1 - p0, p2 - p0)) >= 0;
+				EXPECT_TRUE(backfacing || OutsideFrustum(frustum, p0, p1, p2));
+			}
+		}
+
+		cout << "Eye at (" << eye_pos.x() << ", " << eye_pos.y() << ", " << eye_pos.z() << "): " << stats.num_frustum_culled
+			<< " clusters culled by frustum, " << stats.num_backface_culled << " by backface, "
+			<< stats.num_triangles_culled * 100.0f / stats.num_triangles << "% triangles culled." << endl;
+	}
+}
+
+TEST(MeshClusterTest, CullTransformed)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	CreateSphere(positions, indices);
+	auto const clusters = BuildMeshClusters(positions, indices, MAX_CLUSTER_TRIANGLES);
+
+	float3 const eye_pos(0, 0, -5);
+	MeshClusterCuller culler;
+	culler.BeginFrame(MakeFrustum(eye_pos, float3(0, 0, 0)), eye_pos);
+
+	// Behind the camera
+	std::vector<MeshClusterCuller::IndexRange> ranges;
+	EXPECT_EQ(culler.Cull(clusters, 0, MathLib::translation(0.0f, 0.0f, -10.0f), true, ranges), 0U);
+	EXPECT_TRUE(ranges.empty());
+	EXPECT_EQ(culler.FrameStats().num_frustum_culled, clusters.size());
+
+	// Uniform scale keeps the backface test, mirroring disables it
+	uint32_t const num_scaled_visible = culler.Cull(clusters, 100, MathLib::scaling(2.0f, 2.0f, 2.0f), true, ranges);
+	EXPECT_LT(num_scaled_visible, indices.size() / 3 * 3 / 4);
+	EXPECT_GE(ranges.front().start_index, 100U);
+	ranges.clear();
+	EXPECT_EQ(culler.Cull(clusters, 0, MathLib::scaling(-1.0f, 1.0f, 1.0f), true, ranges), indices.size() / 3);
+	ranges.clear();
+	EXPECT_EQ(culler.Cull(clusters, 0, float4x4::Identity(), false, ranges), indices.size() / 3);
+	EXPECT_EQ(ranges.size(), 1U);
+}
+
+TEST(MeshClusterTest, RenderSubmitsVisibleClusters)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	CreateSphere(positions, indices);
+	auto const clusters = BuildMeshClusters(positions, indices, MAX_CLUSTER_TRIANGLES);
+	uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+
+	auto& rf = Context::Instance().RenderFactoryInstance();
+	auto& re = rf.RenderEngineInstance();
+
+	auto mesh = CreateClusteredSphereMesh(positions, indices, clusters);
+
+	uint32_t const TARGET_SIZE = 64;
+	auto target = rf.MakeTexture2D(TARGET_SIZE, TARGET_SIZE, 1, 1, EF_ABGR8, 1, 0, EAH_GPU_Write);
+	auto fb = rf.MakeFrameBuffer();
+	fb->Attach(FrameBuffer::Attachment::Color0, rf.Make2DRtv(target, 0, 1, 0));
+
+	auto camera = MakeSharedPtr<Camera>();
+	auto camera_node = MakeSharedPtr<SceneNode>(camera, L"ClusterCamera", 0);
+	camera->ProjParams(PI / 4, 1.0f, 0.1f, 100.0f);
+	fb->GetViewport()->camera = camera;
+	re.BindFrameBuffer(fb);
+
+	float3 const eye_positions[] = { float3(0, 0, -5), float3(3, 2, 1), float3(0, 0, -1.5f) };
+	for (auto const & eye_pos : eye_positions)
+	{
+		camera_node->TransformToWorld(MathLib::inverse(MathLib::look_at_lh(eye_pos, float3(0.3f, 0.2f, 0), float3(0, 1, 0))));
+		camera->DirtyTransforms();
+
+		MeshClusterCuller culler;
+		culler.BeginFrame(camera->ViewFrustum(), camera->EyePos());
+		std::vector<MeshClusterCuller::IndexRange> ranges;
+		uint32_t const num_visible = culler.Cull(clusters, 0, float4x4::Identity(), true, ranges);
+		EXPECT_LT(num_visible, num_triangles);
+
+		re.NumPrimitivesJustRendered();
+		re.NumDrawsJustCalled();
+
+		mesh->ClusterCulling(false);
+		mesh->Render();
+		EXPECT_EQ(re.NumPrimitivesJustRendered(), num_triangles);
+		EXPECT_EQ(re.NumDrawsJustCalled(), 1U);
+
+		// One draw per merged range, and the layout is left as it was
+		mesh->ClusterCulling(true);
+		mesh->Render();
+		EXPECT_EQ(re.NumPrimitivesJustRendered(), num_visible);
+		EXPECT_EQ(re.NumDrawsJustCalled(), ranges.size());
+		EXPECT_EQ(mesh->StartIndexLocation(0), 0U);
+		EXPECT_EQ(mesh->NumIndices(0), indices.size());
+	}
+
+	re.BindFrameBuffer(FrameBufferPtr());
+}
+
+TEST(MeshClusterTest, SceneCullsEachInstance)
+{
+	std::vector<float3> positions;
+	std::vector<uint32_t> indices;
+	CreateSphere(positions, indices);
+	auto const clusters = BuildMeshClusters(positions, indices, MAX_CLUSTER_TRIANGLES);
+	uint32_t const num_triangles = static_cast<uint32_t>(indices.size() / 3);
+
+	auto& rf = Context::Instance().RenderFactoryInstance();
+	auto& re = rf.RenderEngineInstance();
+
+	auto mesh = CreateClusteredSphereMesh(positions, indices, clusters);
+
+	uint32_t const TARGET_SIZE = 64;
+	auto target = rf.MakeTexture2D(TARGET_SIZE, TARGET_SIZE, 1, 1, EF_ABGR8, 1, 0, EAH_GPU_Write);
+	auto fb = rf.MakeFrameBuffer();
+	fb->Attach(FrameBuffer::Attachment::Color0, rf.Make2DRtv(target, 0, 1, 0));
+
+	float3 const eye_pos(0, 0, -5);
+	float3 const look_at(0.3f, 0.2f, 0);
+	auto camera = MakeSharedPtr<Camera>();
+	auto camera_node = MakeSharedPtr<SceneNode>(camera, L"ClusterCamera", 0);
+	camera->ProjParams(PI / 4, 1.0f, 0.1f, 100.0f);
+	camera_node->TransformToWorld(MathLib::inverse(MathLib::look_at_lh(eye_pos, look_at, float3(0, 1, 0))));
+	camera->DirtyTransforms();
+	fb->GetViewport()->camera = camera;
+	re.BindFrameBuffer(fb);
+
+	// Two instances of the mesh, the second one is partly out of the view
+	float4x4 const transforms[] = { MathLib::rotation_y(0.5f), MathLib::translation(1.8f, 0.0f, 0.0f) };
+
+	ClusterTestSceneManager scene_mgr;
+	for (auto const & transform : transforms)
+	{
+		auto node = MakeSharedPtr<SceneNode>(MakeSharedPtr<RenderableComponent>(mesh), L"ClusteredSphereNode", 0);
+		scene_mgr.SceneRootNode().AddChild(node);
+		node->TransformToParent(transform);
+	}
+	scene_mgr.SceneRootNode().Traverse([](SceneNode& node)
+		{
+			node.MainThreadUpdate(0, 0);
+			node.UpdateTransforms();
+			return true;
+		});
+	scene_mgr.SceneRootNode().UpdatePosBoundSubtree();
+
+	MeshClusterCuller culler;
+	culler.BeginFrame(camera->ViewFrustum(), camera->EyePos());
+	uint32_t expected_visible = 0;
+	size_t expected_draws = 0;
+	for (auto const & transform : transforms)
+	{
+		std::vector<MeshClusterCuller::IndexRange> ranges;
+		expected_visible += culler.Cull(clusters, 0, transform, true, ranges);
+		expected_draws += ranges.size();
+	}
+	EXPECT_LT(expected_visible, num_triangles * 2);
+
+	re.NumPrimitivesJustRendered();
+	re.NumDrawsJustCalled();
+
+	mesh->ClusterCulling(false);
+	scene_mgr.RenderScene();
+	EXPECT_EQ(scene_mgr.NumPrimitivesRendered(), num_triangles * 2);
+	EXPECT_EQ(re.NumDrawsJustCalled(), 2U);
+
+	// Every instance is culled with its own transform
+	mesh->ClusterCulling(true);
+	scene_mgr.RenderScene();
+	EXPECT_EQ(scene_mgr.NumPrimitivesRendered(), expected_visible);
+	EXPECT_EQ(re.NumDrawsJustCalled(), expected_draws);
+	EXPECT_EQ(mesh->StartIndexLocation(0), 0U);
+	EXPECT_EQ(mesh->NumIndices(0), indices.size());
+
+	re.BindFrameBuffer(FrameBufferPtr());
+}
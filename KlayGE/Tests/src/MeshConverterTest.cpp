@@ -38,6 +38,11 @@
 #include <KlayGE/DevHelper/MeshConverter.hpp>
 #include <KlayGE/DevHelper/MeshMetadata.hpp>
 
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <random>
+
 #include "KlayGETests.hpp"
 
 using namespace std;
@@ -744,6 +749,162 @@ public:
 			EXPECT_EQ(skinned_model.FrameRate(), sanity_skinned_model.FrameRate());
 		}
 	}
+
+	// Writes a size x size heightfield grid with integer coordinates. Triangles are shuffled so the vertex cache has work to do.
+	static std::string WriteGridObj(std::string const & name, uint32_t size)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles;
+		for (uint32_t y = 0; y + 1 < size; ++ y)
+		{
+			for (uint32_t x = 0; x + 1 < size; ++ x)
+			{
+				uint32_t const v0 = y * size + x + 1;
+				uint32_t const v1 = v0 + 1;
+				uint32_t const v2 = v0 + size;
+				uint32_t const v3 = v2 + 1;
+				triangles.push_back({ v0, v1, v2 });
+				triangles.push_back({ v1, v3, v2 });
+			}
+		}
+		std::shuffle(triangles.begin(), triangles.end(), std::mt19937(0x4B4C4147));
+
+		auto const path = (std::filesystem::temp_directory_path() / name).string();
+		std::ofstream ofs(path.c_str());
+		for (uint32_t y = 0; y < size; ++ y)
+		{
+			for (uint32_t x = 0; x < size; ++ x)
+			{
+				ofs << "v " << x << ' ' << y << ' ' << (x + 2 * y) % 5 << '\n';
+			}
+		}
+		for (auto const & tri : triangles)
+		{
+			ofs << "f " << tri[0] << ' ' << tri[1] << ' ' << tri[2] << '\n';
+		}
+		return path;
+	}
+
+	// Triangles of LoD 0 of all meshes as rounded positions, each rotated to start at its smallest corner, sorted
+	static std::vector<std::array<int32_t, 9>> CanonicalTriangles(RenderModel const & model)
+	{
+		std::vector<std::array<int32_t, 9>> triangles;
+		for (uint32_t i = 0; i < model.NumMeshes(); ++ i)
+		{
+			auto const& mesh = checked_cast<StaticMesh&>(*model.Mesh(i));
+			auto const& rl = mesh.GetRenderLayout(0);
+
+			int position_stream = -1;
+			for (uint32_t j = 0; j < rl.NumVertexStreams(); ++ j)
+			{
+				if (rl.VertexStreamFormat(j)[0].usage == VEU_Position)
+				{
+					position_stream = static_cast<int>(j);
+				}
+			}
+			EXPECT_GE(position_stream, 0);
+			if (position_stream < 0)
+			{
+				continue;
+			}
+			EXPECT_EQ(rl.VertexStreamFormat(position_stream)[0].format, EF_SIGNED_ABGR16);
+
+			float3 const center = mesh.PosBound().Center();
+			float3 const extent = mesh.PosBound().HalfSize();
+
+			GraphicsBuffer::Mapper pos_mapper(*rl.GetVertexStream(position_stream), BA_Read_Only);
+			int16_t const * positions = pos_mapper.Pointer<int16_t>() + mesh.StartVertexLocation(0) * 4;
+
+			GraphicsBuffer::Mapper index_mapper(*rl.GetIndexStream(), BA_Read_Only);
+			bool const index_16 = (rl.IndexStreamFormat() == EF_R16UI);
+			uint32_t const start_index = mesh.StartIndexLocation(0);
+			auto index = [&](uint32_t j)
+			{
+				return index_16 ? index_mapper.Pointer<uint16_t>()[start_index + j]
+					: index_mapper.Pointer<uint32_t>()[start_index + j];
+			};
+
+			for (uint32_t j = 0; j < mesh.NumIndices(0); j += 3)
+			{
+				std::array<std::array<int32_t, 3>, 3> corners;
+				for (uint32_t k = 0; k < 3; ++ k)
+				{
+					uint32_t const vi = index(j + k);
+					EXPECT_LT(vi, mesh.NumVertices(0));
+					for (uint32_t c = 0; c < 3; ++ c)
+					{
+						float const pos = positions[vi * 4 + c] / 32767.0f * extent[c] + center[c];
+						corners[k][c] = static_cast<int32_t>(std::lround(pos));
+					}
+				}
+
+				// Rotation keeps the winding
+				std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+				std::array<int32_t, 9> tri;
+				for (uint32_t k = 0; k < 3; ++ k)
+				{
+					for (uint32_t c = 0; c < 3; ++ c)
+					{
+						tri[k * 3 + c] = corners[k][c];
+					}
+				}
+				triangles.push_back(tri);
+			}
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// Dequantized positions and texcoords of a LoD, with its indices relative to them
+	static void ReadLod(StaticMesh const & mesh, uint32_t lod, std::vector<float3>& positions, std::vector<float2>& texcoords,
+		std::vector<uint32_t>& indices)
+	{
+		auto const& rl = mesh.GetRenderLayout(lod);
+		uint32_t const num_vertices = mesh.NumVertices(lod);
+		uint32_t const start_vertex = mesh.StartVertexLocation(lod);
+
+		positions.clear();
+		texcoords.clear();
+		for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
+		{
+			auto const & ve = rl.VertexStreamFormat(i)[0];
+			if ((ve.usage == VEU_Position) && (ve.format == EF_SIGNED_ABGR16))
+			{
+				float3 const center = mesh.PosBound().Center();
+				float3 const extent = mesh.PosBound().HalfSize();
+
+				GraphicsBuffer::Mapper mapper(*rl.GetVertexStream(i), BA_Read_Only);
+				int16_t const * p = mapper.Pointer<int16_t>() + start_vertex * 4;
+				for (uint32_t j = 0; j < num_vertices; ++ j)
+				{
+					positions.push_back(float3(p[j * 4 + 0] / 32767.0f * extent.x() + center.x(),
+						p[j * 4 + 1] / 32767.0f * extent.y() + center.y(), p[j * 4 + 2] / 32767.0f * extent.z() + center.z()));
+				}
+			}
+			else if ((ve.usage == VEU_TextureCoord) && (ve.usage_index == 0) && (ve.format == EF_SIGNED_GR16))
+			{
+				float3 const center = mesh.TexcoordBound().Center();
+				float3 const extent = mesh.TexcoordBound().HalfSize();
+
+				GraphicsBuffer::Mapper mapper(*rl.GetVertexStream(i), BA_Read_Only);
+				int16_t const * p = mapper.Pointer<int16_t>() + start_vertex * 2;
+				for (uint32_t j = 0; j < num_vertices; ++ j)
+				{
+					texcoords.push_back(float2(p[j * 2 + 0] / 32767.0f * extent.x() + center.x(),
+						p[j * 2 + 1] / 32767.0f * extent.y() + center.y()));
+				}
+			}
+		}
+
+		indices.clear();
+		GraphicsBuffer::Mapper mapper(*rl.GetIndexStream(), BA_Read_Only);
+		uint32_t const start_index = mesh.StartIndexLocation(lod);
+		for (uint32_t i = 0; i < mesh.NumIndices(lod); ++ i)
+		{
+			indices.push_back((rl.IndexStreamFormat() == EF_R16UI) ? mapper.Pointer<uint16_t>()[start_index + i]
+				: mapper.Pointer<uint32_t>()[start_index + i]);
+		}
+	}
 };
 
 TEST_F(MeshConverterTest, StaticNoLod)
@@ -785,3 +946,207 @@ TEST_F(MeshConverterTest, AnimationMeshML)
 {
 	RunTest("anim.meshml", "", "anim.meshml");
 }
+
+TEST_F(MeshConverterTest, LoadEnablesClusterCulling)
+{
+	MeshMetadata metadata("tree2a.nolod.kmeta");
+
+	MeshConverter mc;
+	auto target = mc.Load("tree2a_lod0.obj", metadata);
+	ASSERT_TRUE(target);
+
+	auto const output = (std::filesystem::temp_directory_path() / "KlayGEClusterCulling.model_bin").string();
+	SaveModel(*target, output);
+	auto model = LoadSoftwareModel(output);
+	std::filesystem::remove(output);
+	ASSERT_TRUE(model);
+
+	auto clone = model->Clone();
+	ASSERT_EQ(model->NumMeshes(), target->NumMeshes());
+	ASSERT_EQ(clone->NumMeshes(), target->NumMeshes());
+	uint32_t num_culled_meshes = 0;
+	for (uint32_t i = 0; i < model->NumMeshes(); ++ i)
+	{
+		auto const& mesh = checked_cast<StaticMesh&>(*model->Mesh(i));
+		bool const has_clusters = !mesh.Clusters(0).empty();
+		EXPECT_EQ(mesh.ClusterCulling(), has_clusters);
+		EXPECT_EQ(checked_cast<StaticMesh&>(*clone->Mesh(i)).ClusterCulling(), has_clusters);
+		if (mesh.ClusterCulling())
+		{
+			++ num_culled_meshes;
+		}
+	}
+	EXPECT_GT(num_culled_meshes, 0U);
+}
+
+TEST_F(MeshConverterTest, OptimizeMeshes)
+{
+	auto const input = WriteGridObj("KlayGEOptimizeGrid.obj", 64);
+
+	MeshMetadata metadata;
+	metadata.OptimizeMeshes(false);
+	MeshConverter plain_mc;
+	auto plain = plain_mc.Load(input, metadata);
+	ASSERT_TRUE(plain);
+
+	metadata.OptimizeMeshes(true);
+	MeshConverter mc;
+	auto optimized = mc.Load(input, metadata);
+	std::filesystem::remove(input);
+	ASSERT_TRUE(optimized);
+
+	// Reordering triangles and vertices and compacting the LoD keep every triangle and its winding
+	auto const plain_triangles = CanonicalTriangles(*plain);
+	EXPECT_EQ(plain_triangles.size(), 2U * 63 * 63);
+	EXPECT_EQ(CanonicalTriangles(*optimized), plain_triangles);
+	EXPECT_EQ(optimized->NumMeshes(), plain->NumMeshes());
+
+	auto const & before = mc.InputVertexCacheStats();
+	auto const & after = mc.OutputVertexCacheStats();
+	EXPECT_EQ(plain_mc.InputVertexCacheStats().num_cache_misses, plain_mc.OutputVertexCacheStats().num_cache_misses);
+	EXPECT_EQ(before.num_triangles, plain_triangles.size());
+	EXPECT_EQ(after.num_triangles, before.num_triangles);
+	EXPECT_EQ(after.num_vertices, before.num_vertices);
+	EXPECT_LT(after.Acmr(), before.Acmr());
+	EXPECT_GE(after.Atvr(), 1.0f);
+	EXPECT_LE(after.Atvr(), before.Atvr());
+}
+
+TEST_F(MeshConverterTest, SplitLargeMeshes)
+{
+	uint32_t const size = 300;
+	auto const input = WriteGridObj("KlayGESplitGrid.obj", size);
+
+	MeshMetadata metadata;
+	metadata.OptimizeMeshes(false);
+	MeshConverter plain_mc;
+	auto plain = plain_mc.Load(input, metadata);
+	ASSERT_TRUE(plain);
+	ASSERT_EQ(plain->NumMeshes(), 1U);
+	ASSERT_GT(checked_cast<StaticMesh&>(*plain->Mesh(0)).NumVertices(0), 0xFFFFU);
+
+	metadata.OptimizeMeshes(true);
+	MeshConverter mc;
+	auto optimized = mc.Load(input, metadata);
+	std::filesystem::remove(input);
+	ASSERT_TRUE(optimized);
+
+	EXPECT_GE(optimized->NumMeshes(), 2U);
+	for (uint32_t i = 0; i < optimized->NumMeshes(); ++ i)
+	{
+		auto const& mesh = checked_cast<StaticMesh&>(*optimized->Mesh(i));
+		EXPECT_LE(mesh.NumVertices(0), 0xFFFFU);
+		EXPECT_EQ(mesh.GetRenderLayout(0).IndexStreamFormat(), EF_R16UI);
+	}
+
+	// Together the parts draw exactly the triangles of the unsplit mesh
+	auto const plain_triangles = CanonicalTriangles(*plain);
+	EXPECT_EQ(plain_triangles.size(), 2U * (size - 1) * (size - 1));
+	EXPECT_EQ(CanonicalTriangles(*optimized), plain_triangles);
+
+	EXPECT_EQ(mc.OutputVertexCacheStats().num_triangles, mc.InputVertexCacheStats().num_triangles);
+	EXPECT_LT(mc.OutputVertexCacheStats().Acmr(), mc.InputVertexCacheStats().Acmr());
+}
+
+TEST_F(MeshConverterTest, GenerateLodsKeepsSeamsAndBoundaries)
+{
+	// A tilted plane of size x size vertices. The two halves are separate UV islands, so the middle column is a seam.
+	uint32_t const size = 33;
+	uint32_t const seam = size / 2;
+	auto const input = (std::filesystem::temp_directory_path() / "KlayGESimplifyGrid.obj").string();
+	{
+		std::ofstream ofs(input.c_str());
+		for (uint32_t y = 0; y < size; ++ y)
+		{
+			for (uint32_t x = 0; x < size; ++ x)
+			{
+				ofs << "v " << x << ' ' << y << ' ' << x * 0.5f << '\n';
+			}
+		}
+		for (uint32_t island = 0; island < 2; ++ island)
+		{
+			for (uint32_t y = 0; y < size; ++ y)
+			{
+				for (uint32_t x = 0; x <= seam; ++ x)
+				{
+					ofs << "vt " << island * 0.55f + x * 0.45f / seam << ' ' << static_cast<float>(y) / (size - 1) << '\n';
+				}
+			}
+		}
+		for (uint32_t y = 0; y + 1 < size; ++ y)
+		{
+			for (uint32_t x = 0; x + 1 < size; ++ x)
+			{
+				uint32_t const island = (x < seam) ? 0 : 1;
+				uint32_t const island_x = x - island * seam;
+				uint32_t const v0 = y * size + x + 1;
+				uint32_t const t0 = island * size * (seam + 1) + y * (seam + 1) + island_x + 1;
+				uint32_t const v[] = { v0, v0 + 1, v0 + size, v0 + size + 1 };
+				uint32_t const t[] = { t0, t0 + 1, t0 + seam + 1, t0 + seam + 2 };
+				ofs << "f " << v[0] << '/' << t[0] << ' ' << v[1] << '/' << t[1] << ' ' << v[2] << '/' << t[2] << '\n';
+				ofs << "f " << v[1] << '/' << t[1] << ' ' << v[3] << '/' << t[3] << ' ' << v[2] << '/' << t[2] << '\n';
+			}
+		}
+	}
+
+	float const ratio = 0.5f;
+	MeshMetadata metadata;
+	metadata.NumAutoLods(1);
+	metadata.AutoLodRatio(0, ratio);
+	metadata.AutoLodMaxError(1.0f);
+
+	MeshConverter mc;
+	auto model = mc.Load(input, metadata);
+	std::filesystem::remove(input);
+	ASSERT_TRUE(model);
+	ASSERT_EQ(model->NumMeshes(), 1U);
+
+	auto const& mesh = checked_cast<StaticMesh&>(*model->Mesh(0));
+	ASSERT_EQ(mesh.NumLods(), 2U);
+
+	std::vector<float3> positions;
+	std::vector<float2> texcoords;
+	std::vector<uint32_t> indices;
+
+	// The seam column has a vertex on each island
+	ReadLod(mesh, 0, positions, texcoords, indices);
+	EXPECT_EQ(positions.size(), size * size + size);
+	uint32_t const num_tris = static_cast<uint32_t>(indices.size() / 3);
+	EXPECT_EQ(num_tris, 2 * (size - 1) * (size - 1));
+
+	ReadLod(mesh, 1, positions, texcoords, indices);
+	ASSERT_EQ(texcoords.size(), positions.size());
+	uint32_t const num_lod_tris = static_cast<uint32_t>(indices.size() / 3);
+	EXPECT_GT(num_lod_tris, 0U);
+	EXPECT_LE(num_lod_tris, static_cast<uint32_t>(num_tris * ratio + 0.5f));
+
+	// Grid points still referenced by the LoD, and the U coordinates each is used with
+	std::vector<std::vector<float>> used_us(size * size);
+	for (auto const index : indices)
+	{
+		ASSERT_LT(index, positions.size());
+		int32_t const x = static_cast<int32_t>(std::lround(positions[index].x()));
+		int32_t const y = static_cast<int32_t>(std::lround(positions[index].y()));
+		ASSERT_TRUE((x >= 0) && (x < static_cast<int32_t>(size)) && (y >= 0) && (y < static_cast<int32_t>(size)));
+		used_us[y * size + x].push_back(texcoords[index].x());
+	}
+
+	for (uint32_t y = 0; y < size; ++ y)
+	{
+		for (uint32_t x = 0; x < size; ++ x)
+		{
+			bool const boundary = (0 == x) || (size - 1 == x) || (0 == y) || (size - 1 == y);
+			if (boundary || (seam == x))
+			{
+				auto const & us = used_us[y * size + x];
+				EXPECT_FALSE(us.empty()) << "(" << x << ", " << y << ") is removed";
+				if ((seam == x) && !us.empty())
+				{
+					// Both sides of the seam keep their own UV
+					auto const minmax = std::minmax_element(us.begin(), us.end());
+					EXPECT_GT(*minmax.second - *minmax.first, 0.05f) << "(" << x << ", " << y << ") lost the seam";
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,255 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/Lobby.hpp>
+#include <KlayGE/NetMsg.hpp>
+#include <KlayGE/Player.hpp>
+#include <KlayGE/Socket.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	char const MSG_ECHO = 0x40;
+
+	class EchoProcessor : public Processor
+	{
+	public:
+		void OnDefault(void* revBuf, int maxSize, void* sendBuf, int& numSend, sockaddr_in& /*from*/) const override
+		{
+			if (MSG_ECHO == static_cast<char*>(revBuf)[0])
+			{
+				std::memcpy(static_cast<char*>(sendBuf) + 1, static_cast<char*>(revBuf) + 1, maxSize - 1);
+				numSend = maxSize - 1;
+			}
+		}
+	};
+
+	uint64_t NowNS()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// The lobby may not be bound yet when the first request goes out, so resend until it answers
+	int Request(Socket& socket, void const * msg, int size, void* reply, int reply_size)
+	{
+		for (int retry = 0; retry < 50; ++ retry)
+		{
+			socket.Send(msg, size);
+			int const ret = socket.Receive(reply, reply_size);
+			if (ret > 0)
+			{
+				return ret;
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		}
+		return -1;
+	}
+
+	void Connect(Socket& socket, sockaddr_in const & addr)
+	{
+		socket.Create(SOCK_DGRAM);
+		socket.Connect(addr);
+		socket.TimeOut(2000);
+	}
+
+	uint32_t JoinLobby(Socket& socket, std::string const & name)
+	{
+		char msg[Max_Buffer] = { MSG_JOIN };
+		name.copy(&msg[1], std::min<size_t>(name.size(), 16));
+		char reply[5];
+		uint32_t id = 0;
+		if ((Request(socket, msg, static_cast<int>(1 + name.size() + 1), reply, sizeof(reply)) == sizeof(reply))
+			&& (MSG_JOIN == reply[0]))
+		{
+			std::memcpy(&id, &reply[1], sizeof(id));
+		}
+		return id;
+	}
+}
+
+TEST(NetTest, JoinQuit)
+{
+	uint16_t const PORT = 42901;
+
+	EchoProcessor pro;
+	Lobby lobby;
+	auto lobby_thread = Context::Instance().ThreadPool()([&lobby, &pro] { lobby.Create("NetTest", 4, PORT, pro); });
+
+	sockaddr_in const addr = TransAddr("127.0.0.1", PORT);
+
+	Socket socket;
+	Connect(socket, addr);
+	EXPECT_EQ(JoinLobby(socket, "Raw"), 1U);
+	// Joining again from the same address keeps the ID
+	EXPECT_EQ(JoinLobby(socket, "Raw"), 1U);
+
+	Player player;
+	player.Name("Player");
+	EXPECT_TRUE(player.Join(addr));
+
+	char info_msg = MSG_GETLOBBYINFO;
+	char info[21];
+	ASSERT_EQ(Request(socket, &info_msg, 1, info, sizeof(info)), static_cast<int>(sizeof(info)));
+	uint16_t num_player, max_players;
+	std::memcpy(&num_player, &info[1], sizeof(num_player));
+	std::memcpy(&max_players, &info[3], sizeof(max_players));
+	EXPECT_EQ(num_player, 2);
+	EXPECT_EQ(max_players, 4);
+	EXPECT_EQ(std::string(&info[5]), "NetTest");
+
+	player.Quit();
+
+	char quit_msg = MSG_QUIT;
+	char quit_reply[2];
+	ASSERT_EQ(Request(socket, &quit_msg, 1, quit_reply, sizeof(quit_reply)), 2);
+	EXPECT_EQ(quit_reply[1], 0);
+
+	ASSERT_EQ(Request(socket, &info_msg, 1, info, sizeof(info)), static_cast<int>(sizeof(info)));
+	std::memcpy(&num_player, &info[1], sizeof(num_player));
+	EXPECT_EQ(num_player, 0);
+
+	lobby.Stop();
+	lobby_thread();
+}
+
+TEST(NetTest, LoopbackLoad)
+{
+	uint16_t const PORT = 42902;
+	uint32_t const NUM_PLAYERS = 512;
+	uint32_t const NUM_THREADS = 4;
+	uint32_t const NUM_ROUNDS = 100;
+	uint32_t const WINDOW = 32;
+
+	EchoProcessor pro;
+	Lobby lobby;
+	auto lobby_thread = Context::Instance().ThreadPool()([&lobby, &pro] { lobby.Create("NetTest", NUM_PLAYERS, PORT, pro); });
+
+	sockaddr_in const addr = TransAddr("127.0.0.1", PORT);
+
+	std::vector<Socket> sockets(NUM_PLAYERS);
+	for (uint32_t i = 0; i < NUM_PLAYERS; ++ i)
+	{
+		Connect(sockets[i], addr);
+		ASSERT_EQ(JoinLobby(sockets[i], "Player" + std::to_string(i)), i + 1);
+	}
+
+	// Each thread drives its players in windows, one message in flight per player, so the lobby's socket buffer
+	// isn't overrun the way a real frame-paced client never would
+	std::vector<std::vector<uint64_t>> latencies(NUM_THREADS);
+	std::vector<uint32_t> lost(NUM_THREADS, 0);
+	std::vector<joiner<void>> joiners;
+	Timer timer;
+	for (uint32_t t = 0; t < NUM_THREADS; ++ t)
+	{
+		joiners.push_back(Context::Instance().ThreadPool()(
+			[&sockets, &latencies, &lost, t, NUM_PLAYERS, NUM_THREADS, NUM_ROUNDS, WINDOW]
+			{
+				uint32_t const begin = t * NUM_PLAYERS / NUM_THREADS;
+				uint32_t const end = (t + 1) * NUM_PLAYERS / NUM_THREADS;
+				for (uint32_t round = 0; round < NUM_ROUNDS; ++ round)
+				{
+					for (uint32_t window = begin; window < end; window += WINDOW)
+					{
+						uint32_t const window_end = std::min(window + WINDOW, end);
+						for (uint32_t i = window; i < window_end; ++ i)
+						{
+							char msg[1 + sizeof(uint64_t)] = { MSG_ECHO };
+							uint64_t const now = NowNS();
+							std::memcpy(&msg[1], &now, sizeof(now));
+							sockets[i].Send(msg, sizeof(msg));
+						}
+						for (uint32_t i = window; i < window_end; ++ i)
+						{
+							char reply[Max_Buffer];
+							if (sockets[i].Receive(reply, sizeof(reply)) == 1 + sizeof(uint64_t))
+							{
+								uint64_t sent;
+								std::memcpy(&sent, &reply[1], sizeof(sent));
+								latencies[t].push_back(NowNS() - sent);
+							}
+							else
+							{
+								++ lost[t];
+							}
+						}
+					}
+				}
+			}));
+	}
+	for (auto& joiner : joiners)
+	{
+		joiner();
+	}
+	double const elapsed = timer.elapsed();
+
+	std::vector<uint64_t> all_latencies;
+	uint32_t total_lost = 0;
+	for (uint32_t t = 0; t < NUM_THREADS; ++ t)
+	{
+		all_latencies.insert(all_latencies.end(), latencies[t].begin(), latencies[t].end());
+		total_lost += lost[t];
+	}
+	EXPECT_EQ(total_lost, 0U);
+	ASSERT_FALSE(all_latencies.empty());
+
+	std::sort(all_latencies.begin(), all_latencies.end());
+	double const p99_us = all_latencies[all_latencies.size() * 99 / 100] / 1000.0;
+	cout << "Lobby: " << NUM_PLAYERS << " players, " << all_latencies.size() / elapsed << " msgs/s, p99 "
+		<< p99_us << " us" << endl;
+
+	for (auto& socket : sockets)
+	{
+		char quit_msg = MSG_QUIT;
+		char quit_reply[2];
+		EXPECT_EQ(Request(socket, &quit_msg, 1, quit_reply, sizeof(quit_reply)), 2);
+	}
+
+	lobby.Stop();
+	lobby_thread();
+}
+
+TEST(NetTest, ReceiveBatchReturnsFirstDatagram)
+{
+	uint16_t const PORT = 42903;
+
+	sockaddr_in const addr = TransAddr("127.0.0.1", PORT);
+
+	Socket receiver;
+	receiver.Create(SOCK_DGRAM);
+	receiver.Bind(addr);
+	receiver.TimeOut(2000);
+
+	Socket sender;
+	Connect(sender, addr);
+	char const msg[] = { MSG_ECHO, 1, 2, 3 };
+	sender.Send(msg, sizeof(msg));
+
+	// A blocking batch returns as soon as one datagram is in, instead of waiting for the whole batch or the timeout
+	int const BATCH_SIZE = 16;
+	char bufs[BATCH_SIZE][Max_Buffer];
+	SocketDatagram datagrams[BATCH_SIZE];
+	for (int i = 0; i < BATCH_SIZE; ++ i)
+	{
+		datagrams[i].buf = bufs[i];
+		datagrams[i].len = Max_Buffer;
+	}
+
+	Timer timer;
+	ASSERT_EQ(receiver.ReceiveFromBatch(datagrams, BATCH_SIZE), 1);
+	EXPECT_LT(timer.elapsed(), 1.0);
+	EXPECT_EQ(datagrams[0].len, static_cast<int>(sizeof(msg)));
+	EXPECT_EQ(std::memcmp(bufs[0], msg, sizeof(msg)), 0);
+}
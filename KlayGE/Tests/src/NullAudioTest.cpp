@@ -0,0 +1,235 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Util.hpp>
+#include <KlayGE/AudioDataSource.hpp>
+#include <KlayGE/AudioFactory.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/NullAudio/NullAudio.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	// A mono 16-bit clip at the mixer's rate where every sample is 0.5
+	class ConstantDataSource : public AudioDataSource
+	{
+	public:
+		ConstantDataSource()
+			: samples_(NullAudioEngine::MIX_FRAMES * 4, Native2LE(static_cast<int16_t>(16384))), pos_(0)
+		{
+			format_ = AF_Mono16;
+			freq_ = NullAudioEngine::MIX_FREQ;
+		}
+
+		void Open(ResIdentifierPtr const & file) override
+		{
+			KFL_UNUSED(file);
+		}
+
+		void Close() override
+		{
+		}
+
+		size_t Size() override
+		{
+			return samples_.size() * sizeof(samples_[0]);
+		}
+
+		size_t Read(void* data, size_t size) override
+		{
+			size_t const n = std::min(size, this->Size() - pos_);
+			std::memcpy(data, reinterpret_cast<uint8_t const *>(samples_.data()) + pos_, n);
+			pos_ += n;
+			return n;
+		}
+
+		void Reset() override
+		{
+			pos_ = 0;
+		}
+
+	private:
+		std::vector<int16_t> samples_;
+		size_t pos_;
+	};
+
+	// Keeps the last mixed block
+	class CaptureSink : public NullAudioSink
+	{
+	public:
+		void Write(float const * samples, uint32_t num_frames) override
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			last_block_.assign(samples, samples + num_frames * 2);
+		}
+
+		float2 FirstFrame() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			return float2(last_block_[0], last_block_[1]);
+		}
+
+		bool Constant() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (size_t i = 2; i < last_block_.size(); ++ i)
+			{
+				if (last_block_[i] != last_block_[i & 1])
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		mutable std::mutex mutex_;
+		std::vector<float> last_block_;
+	};
+}
+
+class NullAudioTest : public testing::Test
+{
+public:
+	void SetUp() override
+	{
+		// Swap in NullAudio as the configured audio factory, whatever KlayGE.cfg names
+		ContextCfg cfg = Context::Instance().Config();
+		prev_audio_factory_name_ = cfg.audio_factory_name;
+		cfg.audio_factory_name = "NullAudio";
+		Context::Instance().Config(cfg);
+		Context::Instance().LoadAudioFactory(cfg.audio_factory_name);
+
+		AudioEngine& ae = Context::Instance().AudioFactoryInstance().AudioEngineInstance();
+		ASSERT_TRUE(ae.Name() == L"Null Audio Engine");
+		engine_ = static_cast<NullAudioEngine*>(&ae);
+
+		auto sink = MakeUniquePtr<CaptureSink>();
+		sink_ = sink.get();
+		engine_->Sink(std::move(sink));
+	}
+
+	void TearDown() override
+	{
+		ContextCfg cfg = Context::Instance().Config();
+		cfg.audio_factory_name = prev_audio_factory_name_;
+		Context::Instance().Config(cfg);
+		Context::Instance().LoadAudioFactory(cfg.audio_factory_name);
+	}
+
+	AudioBufferPtr MakeSound(float3 const & pos)
+	{
+		AudioBufferPtr sound = Context::Instance().AudioFactoryInstance().MakeSoundBuffer(MakeSharedPtr<ConstantDataSource>());
+		sound->Position(pos);
+		sound->Play(true);
+		return sound;
+	}
+
+	// The block mixed here starts after everything set before the call
+	float2 Mix()
+	{
+		engine_->MixBlock();
+		EXPECT_TRUE(sink_->Constant());
+		return sink_->FirstFrame();
+	}
+
+protected:
+	std::string prev_audio_factory_name_;
+	NullAudioEngine* engine_;
+	CaptureSink* sink_;
+};
+
+TEST_F(NullAudioTest, PanningAndAttenuation)
+{
+	engine_->SetListenerPos(float3(0, 0, 0));
+	engine_->SetListenerOri(float3(0, 0, 1), float3(0, 1, 0));
+
+	AudioBufferPtr sound = this->MakeSound(float3(0, 0, 1));
+
+	// Straight ahead at the reference distance, equal power on both sides
+	float2 frame = this->Mix();
+	EXPECT_NEAR(0.5f * sqrt(0.5f), frame.x(), 1e-4f);
+	EXPECT_NEAR(0.5f * sqrt(0.5f), frame.y(), 1e-4f);
+
+	// Right, at twice the reference distance
+	sound->Position(float3(2, 0, 0));
+	frame = this->Mix();
+	EXPECT_NEAR(0, frame.x(), 1e-4f);
+	EXPECT_NEAR(0.5f * 0.5f, frame.y(), 1e-4f);
+
+	// Left, at 4 times the reference distance
+	sound->Position(float3(-4, 0, 0));
+	frame = this->Mix();
+	EXPECT_NEAR(0.5f * 0.25f, frame.x(), 1e-4f);
+	EXPECT_NEAR(0, frame.y(), 1e-4f);
+
+	// Closer than the reference distance isn't louder
+	sound->Position(float3(0, 0, 0.25f));
+	frame = this->Mix();
+	EXPECT_NEAR(0.5f * sqrt(0.5f), frame.x(), 1e-4f);
+	EXPECT_NEAR(0.5f * sqrt(0.5f), frame.y(), 1e-4f);
+
+	sound->Stop();
+	frame = this->Mix();
+	EXPECT_EQ(0.0f, frame.x());
+	EXPECT_EQ(0.0f, frame.y());
+}
+
+TEST_F(NullAudioTest, VirtualVoices)
+{
+	uint32_t const MAX_VOICES = 2;
+	uint32_t const NUM_SOUNDS = 5;
+
+	engine_->SetListenerPos(float3(0, 0, 0));
+	engine_->SetListenerOri(float3(0, 0, 1), float3(0, 1, 0));
+	engine_->MaxVoices(MAX_VOICES);
+
+	// Ahead at 1, 2, 4, ... The farthest ones are the quietest, and those become virtual
+	std::vector<AudioBufferPtr> sounds;
+	float expected = 0;
+	for (uint32_t i = 0; i < NUM_SOUNDS; ++ i)
+	{
+		float const dist = static_cast<float>(1U << (NUM_SOUNDS - 1 - i));
+		sounds.push_back(this->MakeSound(float3(0, 0, dist)));
+		if (i >= NUM_SOUNDS - MAX_VOICES)
+		{
+			expected += 0.5f * sqrt(0.5f) / dist;
+		}
+	}
+
+	// Stats are published once every second of output. Mixing that many blocks publishes some after the setup.
+	uint32_t const stats_blocks = NullAudioEngine::MIX_FREQ / NullAudioEngine::MIX_FRAMES;
+	float2 frame;
+	for (uint32_t i = 0; i < stats_blocks; ++ i)
+	{
+		frame = this->Mix();
+	}
+	EXPECT_NEAR(expected, frame.x(), 1e-4f);
+	EXPECT_NEAR(expected, frame.y(), 1e-4f);
+
+	NullAudioEngine::MixerStats const stats = engine_->Stats();
+	EXPECT_EQ(MAX_VOICES, stats.num_voices);
+	EXPECT_EQ(NUM_SOUNDS - MAX_VOICES, stats.num_virtual_voices);
+	EXPECT_EQ(0U, stats.underruns);
+	EXPECT_GT(stats.ns_per_voice, 0);
+	EXPECT_LT(stats.ns_per_voice, 1e6f);
+
+	// Raising the limit mixes all of them
+	engine_->MaxVoices(NUM_SOUNDS);
+	frame = this->Mix();
+	float all = 0;
+	for (uint32_t i = 0; i < NUM_SOUNDS; ++ i)
+	{
+		all += 0.5f * sqrt(0.5f) / (1U << i);
+	}
+	EXPECT_NEAR(all, frame.x(), 1e-4f);
+}
@@ -0,0 +1,48 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KlayGE/OcclusionCuller.hpp>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	void SetupBoxOccluder(SoftwareOcclusionCuller& culler)
+	{
+		float4x4 const view = MathLib::look_at_lh(float3(0, 0, -10), float3(0, 0, 0), float3(0, 1, 0));
+		float4x4 const proj = MathLib::perspective_fov_lh(PI / 3, 2.0f, 1.0f, 1000.0f);
+		culler.BeginFrame(view * proj);
+		culler.AddOccluder(AABBox(float3(-5, -5, -1), float3(5, 5, 1)), float4x4::Identity());
+		culler.Rasterize();
+	}
+}
+
+TEST(OcclusionCullerTest, Rasterize)
+{
+	SoftwareOcclusionCuller culler(200, 100);
+	EXPECT_EQ(culler.Width(), 256U);
+	EXPECT_EQ(culler.Height(), 128U);
+
+	SetupBoxOccluder(culler);
+	EXPECT_EQ(culler.FrameStats().num_occluders, 1U);
+	EXPECT_LT(culler.DepthAt(culler.Width() / 2, culler.Height() / 2), 1.0f);
+	EXPECT_EQ(culler.DepthAt(0, 0), 1.0f);
+}
+
+TEST(OcclusionCullerTest, Occluded)
+{
+	SoftwareOcclusionCuller culler(256, 128);
+	SetupBoxOccluder(culler);
+
+	EXPECT_TRUE(culler.IsOccluded(AABBox(float3(-1, -1, 5), float3(1, 1, 6))));
+	EXPECT_FALSE(culler.IsOccluded(AABBox(float3(20, -1, 5), float3(22, 1, 6))));
+	EXPECT_FALSE(culler.IsOccluded(AABBox(float3(-1, -1, -5), float3(1, 1, -4))));
+	EXPECT_FALSE(culler.IsOccluded(AABBox(float3(-5, -5, -1), float3(5, 5, 1))));
+	EXPECT_FALSE(culler.IsOccluded(AABBox(float3(3, -1, 5), float3(12, 1, 6))));
+	EXPECT_FALSE(culler.IsOccluded(AABBox(float3(-1, -1, -11), float3(1, 1, 6))));
+
+	EXPECT_EQ(culler.FrameStats().num_tested, 6U);
+	EXPECT_EQ(culler.FrameStats().num_culled, 1U);
+}
@@ -0,0 +1,181 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Camera.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/FrameBuffer.hpp>
+#include <KlayGE/ParticleSystem.hpp>
+#include <KlayGE/RenderEngine.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/Viewport.hpp>
+
+#include <iostream>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	float EvalCurve(std::vector<float2> const & curve, float pos)
+	{
+		float ret = curve.back().y();
+		for (size_t i = 1; i < curve.size(); ++ i)
+		{
+			if (curve[i].x() >= pos)
+			{
+				float const s = (pos - curve[i - 1].x()) / (curve[i].x() - curve[i - 1].x());
+				ret = MathLib::lerp(curve[i - 1].y(), curve[i].y(), s);
+				break;
+			}
+		}
+		return ret;
+	}
+
+	std::vector<float2> const size_curve = { float2(0, 0.1f), float2(0.5f, 0.4f), float2(1, 0.2f) };
+	std::vector<float2> const mass_curve = { float2(0, 1.0f), float2(1, 2.0f) };
+	std::vector<float2> const opacity_curve = { float2(0, 1.0f), float2(0.8f, 0.5f), float2(1, 0) };
+
+	ParticleSystemPtr CreateParticleSystem(uint32_t max_num_particles, bool sort_particles, float freq)
+	{
+		auto ps = MakeSharedPtr<ParticleSystem>(max_num_particles, sort_particles);
+		ps->MediaDensity(0.5f);
+		ps->Force(float3(0.1f, 0, -0.2f));
+
+		auto emitter = ps->MakeEmitter("point");
+		emitter->ModelMatrix(float4x4::Identity());
+		emitter->Frequency(freq);
+		emitter->EmitAngle(PI / 3);
+		emitter->MinPosition(float3(-1, -1, -1));
+		emitter->MaxPosition(float3(+1, +1, +1));
+		emitter->MinVelocity(1);
+		emitter->MaxVelocity(2);
+		emitter->MinLife(50);
+		emitter->MaxLife(100);
+		emitter->MinSpin(0);
+		emitter->MaxSpin(1);
+		emitter->MinSize(0.1f);
+		emitter->MaxSize(0.2f);
+		ps->AddEmitter(emitter);
+
+		auto updater = checked_pointer_cast<PolylineParticleUpdater>(ps->MakeUpdater("polyline"));
+		updater->SizeOverLife(size_curve);
+		updater->MassOverLife(mass_curve);
+		updater->OpacityOverLife(opacity_curve);
+		ps->AddUpdater(updater);
+
+		return ps;
+	}
+}
+
+TEST(ParticleSystemTest, BatchUpdateMatchesReference)
+{
+	float const elapsed_time = 0.1f;
+
+	auto ps = CreateParticleSystem(1000, false, 1000);
+	ps->Update(elapsed_time);
+	uint32_t const num_particles = ps->NumActiveParticles();
+	ASSERT_EQ(num_particles, 100U);
+
+	std::vector<Particle> expected(num_particles);
+	for (uint32_t i = 0; i < num_particles; ++ i)
+	{
+		Particle par = ps->GetParticle(ps->GetActiveParticleIndex(i));
+
+		float const pos = (par.init_life - par.life) / par.init_life;
+		float const cur_size = EvalCurve(size_curve, pos);
+		float const cur_mass = EvalCurve(mass_curve, pos);
+		float const buoyancy = 4.0f / 3 * PI * MathLib::cube(cur_size) * ps->MediaDensity() * ps->Gravity();
+		float3 const accel = (ps->Force() + float3(0, buoyancy, 0)) / cur_mass - float3(0, ps->Gravity(), 0);
+		par.vel += accel * elapsed_time;
+		par.pos += par.vel * elapsed_time;
+		par.life -= elapsed_time;
+		par.size = cur_size;
+		par.alpha = EvalCurve(opacity_curve, pos);
+
+		expected[i] = par;
+	}
+
+	ps->Emitter(0)->Frequency(0);
+	ps->Update(elapsed_time);
+	ASSERT_EQ(ps->NumActiveParticles(), num_particles);
+
+	for (uint32_t i = 0; i < num_particles; ++ i)
+	{
+		Particle const par = ps->GetParticle(ps->GetActiveParticleIndex(i));
+		EXPECT_LT(MathLib::length(par.pos - expected[i].pos), 1e-3f);
+		EXPECT_LT(MathLib::length(par.vel - expected[i].vel), 1e-3f);
+		EXPECT_LT(MathLib::abs(par.life - expected[i].life), 1e-5f);
+		EXPECT_LT(MathLib::abs(par.size - expected[i].size), 1e-2f);
+		EXPECT_LT(MathLib::abs(par.alpha - expected[i].alpha), 1e-2f);
+	}
+}
+
+TEST(ParticleSystemTest, SortBackToFront)
+{
+	auto ps = CreateParticleSystem(4096, true, 4096 * 10);
+	ps->Update(0.1f);
+	uint32_t const num_particles = ps->NumActiveParticles();
+	ASSERT_EQ(num_particles, 4096U);
+
+	auto& re = Context::Instance().RenderFactoryInstance().RenderEngineInstance();
+	float4x4 const & view_mat = re.DefaultFrameBuffer()->GetViewport()->camera->ViewMatrix();
+
+	float last_depth = std::numeric_limits<float>::max();
+	for (uint32_t i = 0; i < num_particles; ++ i)
+	{
+		float3 const pos = ps->GetParticle(ps->GetActiveParticleIndex(i)).pos;
+		float4 const pos4(pos.x(), pos.y(), pos.z(), 1);
+		float const depth = MathLib::dot(pos4, view_mat.Col(2)) / MathLib::dot(pos4, view_mat.Col(3));
+		EXPECT_LE(depth, last_depth);
+		last_depth = depth;
+	}
+}
+
+TEST(ParticleSystemTest, Benchmark1M)
+{
+	uint32_t const NUM_PARTICLES = 1024 * 1024;
+	uint32_t const NUM_FRAMES = 10;
+	float const elapsed_time = 1 / 60.0f;
+
+	{
+		auto ps = CreateParticleSystem(NUM_PARTICLES, true, NUM_PARTICLES / elapsed_time);
+		ps->Update(elapsed_time);
+		ASSERT_EQ(ps->NumActiveParticles(), NUM_PARTICLES);
+
+		Timer timer;
+		for (uint32_t i = 0; i < NUM_FRAMES; ++ i)
+		{
+			ps->Update(elapsed_time);
+		}
+		double const ms = timer.elapsed() * 1000 / NUM_FRAMES;
+		EXPECT_EQ(ps->NumActiveParticles(), NUM_PARTICLES);
+
+		cout << "1M particles, 1 system, sorted: " << ms << " ms/frame" << endl;
+	}
+
+	{
+		uint32_t const NUM_SYSTEMS = 8;
+		std::vector<ParticleSystemPtr> systems;
+		for (uint32_t i = 0; i < NUM_SYSTEMS; ++ i)
+		{
+			systems.push_back(CreateParticleSystem(NUM_PARTICLES / NUM_SYSTEMS, true, NUM_PARTICLES / NUM_SYSTEMS / elapsed_time));
+		}
+		UpdateParticleSystems(systems, elapsed_time);
+
+		Timer timer;
+		for (uint32_t i = 0; i < NUM_FRAMES; ++ i)
+		{
+			UpdateParticleSystems(systems, elapsed_time);
+		}
+		double const ms = timer.elapsed() * 1000 / NUM_FRAMES;
+		for (auto const & ps : systems)
+		{
+			EXPECT_EQ(ps->NumActiveParticles(), NUM_PARTICLES / NUM_SYSTEMS);
+		}
+
+		cout << "1M particles, " << NUM_SYSTEMS << " systems, sorted: " << ms << " ms/frame" << endl;
+	}
+}
@@ -0,0 +1,197 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Math.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Mesh.hpp>
+
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	uint32_t const NUM_JOINTS = 64;
+	uint32_t const NUM_KEYS = 31;
+	uint32_t const FRAMES_PER_KEY = 2;
+
+	std::pair<Quaternion, Quaternion> RandomDualQuaternion(std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> dis(-1, 1);
+		Quaternion const real = MathLib::rotation_quat_yaw_pitch_roll(dis(gen) * PI, dis(gen) * PI, dis(gen) * PI);
+		return std::make_pair(real, MathLib::quat_trans_to_udq(real, float3(dis(gen), dis(gen), dis(gen))));
+	}
+
+	std::shared_ptr<std::vector<KeyFrameSet>> CreateKeyFrameSets(std::ranlux24_base& gen)
+	{
+		std::uniform_real_distribution<float> scale_dis(0.8f, 1.2f);
+
+		auto kfs = MakeSharedPtr<std::vector<KeyFrameSet>>(NUM_JOINTS);
+		for (auto& kf : *kfs)
+		{
+			for (uint32_t i = 0; i < NUM_KEYS; ++ i)
+			{
+				auto const dq = RandomDualQuaternion(gen);
+				kf.frame_id.push_back(i * FRAMES_PER_KEY);
+				kf.bind_real.push_back(dq.first);
+				kf.bind_dual.push_back(dq.second);
+				kf.bind_scale.push_back(scale_dis(gen));
+			}
+		}
+		return kfs;
+	}
+
+	SkinnedModelPtr CreateSkinnedModel(std::shared_ptr<std::vector<KeyFrameSet>> const & kfs, std::ranlux24_base& gen)
+	{
+		std::vector<Joint> joints(NUM_JOINTS);
+		for (uint32_t i = 0; i < NUM_JOINTS; ++ i)
+		{
+			auto const dq = RandomDualQuaternion(gen);
+			joints[i].bind_real = dq.first;
+			joints[i].bind_dual = dq.second;
+			joints[i].bind_scale = 1;
+			auto const inv_dq = MathLib::inverse(dq.first, dq.second);
+			joints[i].inverse_origin_real = inv_dq.first;
+			joints[i].inverse_origin_dual = inv_dq.second;
+			joints[i].inverse_origin_scale = 1;
+			joints[i].parent = (i == 0) ? -1 : static_cast<int16_t>((i - 1) / 2);
+		}
+
+		auto model = MakeSharedPtr<SkinnedModel>(L"SkinnedModelTest", 0);
+		model->AssignJoints(joints.begin(), joints.end());
+		model->AttachKeyFrameSets(kfs);
+		model->NumFrames(NUM_KEYS * FRAMES_PER_KEY);
+		model->FrameRate(30);
+		return model;
+	}
+}
+
+TEST(SkinnedModelTest, CursorSamplingMatchesSearch)
+{
+	std::ranlux24_base gen;
+	auto const kfs = CreateKeyFrameSets(gen);
+	KeyFrameSet const & kf = (*kfs)[0];
+
+	uint32_t cursor = 0;
+	for (float frame = 0; frame < NUM_KEYS * FRAMES_PER_KEY * 3; frame += 0.37f)
+	{
+		auto const sampled = kf.Frame(frame, cursor);
+		auto const searched = kf.Frame(frame);
+		EXPECT_EQ(std::get<0>(sampled), std::get<0>(searched));
+		EXPECT_EQ(std::get<1>(sampled), std::get<1>(searched));
+		EXPECT_EQ(std::get<2>(sampled), std::get<2>(searched));
+	}
+
+	// Jumping backwards falls back to the search
+	auto const sampled = kf.Frame(3.5f, cursor);
+	auto const searched = kf.Frame(3.5f);
+	EXPECT_EQ(std::get<0>(sampled), std::get<0>(searched));
+	EXPECT_EQ(cursor, 1U);
+}
+
+TEST(SkinnedModelTest, CompressedKeyFrames)
+{
+	std::ranlux24_base gen;
+	auto const kfs = CreateKeyFrameSets(gen);
+	for (auto const & kf : *kfs)
+	{
+		CompressedKeyFrameSet const compressed_kf = CompressedKeyFrameSet::Compress(kf);
+		EXPECT_EQ(compressed_kf.frame_id, kf.frame_id);
+		EXPECT_EQ(compressed_kf.keys.size(), kf.frame_id.size() * CompressedKeyFrameSet::KEY_SIZE);
+
+		uint32_t cursor = 0;
+		uint32_t compressed_cursor = 0;
+		for (float frame = 0; frame < NUM_KEYS * FRAMES_PER_KEY; frame += 0.37f)
+		{
+			auto const key = kf.Frame(frame, cursor);
+			auto const compressed_key = compressed_kf.Frame(frame, compressed_cursor);
+			EXPECT_GT(MathLib::abs(MathLib::dot(std::get<0>(key), std::get<0>(compressed_key))), 0.99999f);
+			EXPECT_LT(MathLib::length(MathLib::udq_to_trans(std::get<0>(key), std::get<1>(key))
+				- MathLib::udq_to_trans(std::get<0>(compressed_key), std::get<1>(compressed_key))), 1e-3f);
+			EXPECT_LT(MathLib::abs(std::get<2>(key) - std::get<2>(compressed_key)), 1e-4f);
+		}
+
+		KeyFrameSet const decompressed_kf = compressed_kf.Decompress();
+		EXPECT_EQ(decompressed_kf.frame_id, kf.frame_id);
+		for (size_t i = 0; i < kf.frame_id.size(); ++ i)
+		{
+			EXPECT_GT(MathLib::abs(MathLib::dot(decompressed_kf.bind_real[i], kf.bind_real[i])), 0.99999f);
+		}
+	}
+}
+
+TEST(SkinnedModelTest, BatchMatchesSetFrame)
+{
+	uint32_t const NUM_MODELS = 256;
+
+	std::ranlux24_base gen;
+	auto const kfs = CreateKeyFrameSets(gen);
+	std::ranlux24_base model_gen;
+	std::ranlux24_base ref_model_gen;
+	std::vector<SkinnedModelPtr> models;
+	std::vector<SkinnedModelPtr> ref_models;
+	std::vector<float> frames;
+	for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+	{
+		models.push_back(CreateSkinnedModel(kfs, model_gen));
+		ref_models.push_back(CreateSkinnedModel(kfs, ref_model_gen));
+		frames.push_back(i * 0.25f);
+	}
+
+	SetSkinnedModelFrames(models, frames);
+	for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+	{
+		ref_models[i]->SetFrame(frames[i]);
+
+		EXPECT_EQ(models[i]->GetFrame(), frames[i]);
+		EXPECT_EQ(models[i]->GetBindRealParts(), ref_models[i]->GetBindRealParts());
+		EXPECT_EQ(models[i]->GetBindDualParts(), ref_models[i]->GetBindDualParts());
+	}
+}
+
+TEST(SkinnedModelTest, Benchmark)
+{
+	uint32_t const NUM_MODELS = 512;
+	uint32_t const NUM_FRAMES = 60;
+	float const frame_step = 0.5f;
+
+	std::ranlux24_base gen;
+	auto const kfs = CreateKeyFrameSets(gen);
+	std::vector<SkinnedModelPtr> models;
+	std::vector<float> frames(NUM_MODELS);
+	for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+	{
+		models.push_back(CreateSkinnedModel(kfs, gen));
+		frames[i] = static_cast<float>(i % NUM_KEYS);
+	}
+
+	double const num_joints = static_cast<double>(NUM_MODELS) * NUM_JOINTS * NUM_FRAMES;
+
+	Timer timer;
+	for (uint32_t f = 0; f < NUM_FRAMES; ++ f)
+	{
+		for (uint32_t i = 0; i < NUM_MODELS; ++ i)
+		{
+			frames[i] += frame_step;
+			models[i]->SetFrame(frames[i]);
+		}
+	}
+	double const single_ms = timer.elapsed() * 1000;
+
+	timer.restart();
+	for (uint32_t f = 0; f < NUM_FRAMES; ++ f)
+	{
+		for (auto& frame : frames)
+		{
+			frame += frame_step;
+		}
+		SetSkinnedModelFrames(models, frames);
+	}
+	double const batch_ms = timer.elapsed() * 1000;
+
+	cout << NUM_MODELS << " models x " << NUM_JOINTS << " joints. One by one: " << num_joints / single_ms
+		<< " joints/ms. Batched: " << num_joints / batch_ms << " joints/ms." << endl;
+}
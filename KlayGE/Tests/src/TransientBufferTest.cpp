@@ -0,0 +1,202 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/GraphicsBuffer.hpp>
+#include <KlayGE/RenderFactory.hpp>
+#include <KlayGE/TransientBuffer.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	struct ThreadAllocs
+	{
+		std::vector<SubAlloc> allocs;
+		std::vector<uint32_t> values;
+	};
+
+	std::vector<uint8_t> ReadBack(GraphicsBuffer& buff)
+	{
+		GraphicsBufferPtr buff_cpu;
+		GraphicsBuffer* buff_cpu_ptr;
+		if (buff.AccessHint() & EAH_CPU_Read)
+		{
+			buff_cpu_ptr = &buff;
+		}
+		else
+		{
+			RenderFactory& rf = Context::Instance().RenderFactoryInstance();
+			buff_cpu = rf.MakeVertexBuffer(BU_Static, EAH_CPU_Read, buff.Size(), nullptr);
+			buff_cpu_ptr = buff_cpu.get();
+			buff.CopyToBuffer(*buff_cpu_ptr);
+		}
+
+		GraphicsBuffer::Mapper mapper(*buff_cpu_ptr, BA_Read_Only);
+		uint8_t const * p = mapper.Pointer<uint8_t>();
+		return std::vector<uint8_t>(p, p + buff.Size());
+	}
+
+	// Every thread fills its allocations with a value unique to that allocation. num_running drops to 0 when all are done.
+	std::vector<joiner<void>> LaunchAllocs(TransientBuffer& tb, std::vector<ThreadAllocs>& thread_allocs, uint32_t frame,
+		uint32_t allocs_per_thread, std::atomic<uint32_t>& num_running)
+	{
+		num_running = static_cast<uint32_t>(thread_allocs.size());
+
+		std::vector<joiner<void>> joiners;
+		for (uint32_t t = 0; t < thread_allocs.size(); ++ t)
+		{
+			joiners.push_back(Context::Instance().ThreadPool()(
+				[&tb, &thread_allocs, t, frame, allocs_per_thread, &num_running]
+				{
+					std::ranlux24_base gen(frame * 997 + t);
+					std::uniform_int_distribution<uint32_t> dis(1, 256);
+
+					auto& ta = thread_allocs[t];
+					ta.allocs.clear();
+					ta.values.clear();
+					for (uint32_t i = 0; i < allocs_per_thread; ++ i)
+					{
+						uint32_t const value = (frame << 20) | (t << 16) | i;
+						ta.allocs.push_back(tb.Alloc(dis(gen) * sizeof(uint32_t),
+							[value](void* dst, uint32_t length)
+							{
+								std::fill_n(static_cast<uint32_t*>(dst), length / sizeof(uint32_t), value);
+							}));
+						ta.values.push_back(value);
+					}
+
+					-- num_running;
+				}));
+		}
+		return joiners;
+	}
+
+	void AllocFromThreads(TransientBuffer& tb, std::vector<ThreadAllocs>& thread_allocs, uint32_t frame, uint32_t allocs_per_thread)
+	{
+		std::atomic<uint32_t> num_running;
+		for (auto& joiner : LaunchAllocs(tb, thread_allocs, frame, allocs_per_thread, num_running))
+		{
+			joiner();
+		}
+	}
+
+	// Every allocation has its own value in the GPU buffer, and no two allocations overlap
+	void CheckUploaded(TransientBuffer& tb, std::vector<ThreadAllocs> const & thread_allocs)
+	{
+		std::vector<SubAlloc> frame_allocs;
+		std::vector<uint8_t> const data = ReadBack(*tb.GetBuffer());
+		for (auto const & ta : thread_allocs)
+		{
+			for (size_t i = 0; i < ta.allocs.size(); ++ i)
+			{
+				SubAlloc const & alloc = ta.allocs[i];
+				ASSERT_LE(alloc.offset_ + alloc.length_, tb.Capacity());
+
+				uint32_t const * p = reinterpret_cast<uint32_t const *>(&data[alloc.offset_]);
+				EXPECT_TRUE(std::all_of(p, p + alloc.length_ / sizeof(uint32_t),
+					[&ta, i](uint32_t v)
+					{
+						return v == ta.values[i];
+					}));
+
+				frame_allocs.push_back(alloc);
+			}
+		}
+
+		std::sort(frame_allocs.begin(), frame_allocs.end(),
+			[](SubAlloc const & lhs, SubAlloc const & rhs)
+			{
+				return lhs.offset_ < rhs.offset_;
+			});
+		for (size_t i = 1; i < frame_allocs.size(); ++ i)
+		{
+			EXPECT_LE(frame_allocs[i - 1].offset_ + frame_allocs[i - 1].length_, frame_allocs[i].offset_);
+		}
+	}
+}
+
+TEST(TransientBufferTest, ConcurrentAllocs)
+{
+	uint32_t const NUM_THREADS = 4;
+	uint32_t const NUM_FRAMES = 64;
+	uint32_t const ALLOCS_PER_THREAD = 64;
+
+	// Start small, so the buffer grows while threads are writing into it
+	TransientBuffer tb(4 * 1024, TransientBuffer::BF_Vertex);
+
+	std::vector<ThreadAllocs> thread_allocs(NUM_THREADS);
+	for (uint32_t frame = 0; frame < NUM_FRAMES; ++ frame)
+	{
+		AllocFromThreads(tb, thread_allocs, frame, ALLOCS_PER_THREAD);
+		tb.EnsureDataReady();
+
+		CheckUploaded(tb, thread_allocs);
+
+		tb.OnPresent();
+	}
+}
+
+TEST(TransientBufferTest, UploadWhileAllocating)
+{
+	uint32_t const NUM_THREADS = 4;
+	uint32_t const NUM_FRAMES = 64;
+	uint32_t const ALLOCS_PER_THREAD = 256;
+
+	TransientBuffer tb(4 * 1024, TransientBuffer::BF_Vertex);
+
+	std::vector<ThreadAllocs> thread_allocs(NUM_THREADS);
+	for (uint32_t frame = 0; frame < NUM_FRAMES; ++ frame)
+	{
+		// Uploads race with allocations whose filler hasn't run yet. Those have to be uploaded in full by some call.
+		std::atomic<uint32_t> num_running;
+		auto joiners = LaunchAllocs(tb, thread_allocs, frame, ALLOCS_PER_THREAD, num_running);
+		while (num_running != 0)
+		{
+			tb.EnsureDataReady();
+			std::this_thread::yield();
+		}
+		for (auto& joiner : joiners)
+		{
+			joiner();
+		}
+		tb.EnsureDataReady();
+
+		CheckUploaded(tb, thread_allocs);
+
+		tb.OnPresent();
+	}
+}
+
+TEST(TransientBufferTest, Benchmark)
+{
+	uint32_t const NUM_FRAMES = 100;
+	uint32_t const ALLOCS_PER_FRAME = 10000;
+
+	TransientBuffer tb(4 * 1024 * 1024, TransientBuffer::BF_Vertex);
+
+	uint32_t const data[64] = {};
+	Timer timer;
+	for (uint32_t frame = 0; frame < NUM_FRAMES; ++ frame)
+	{
+		for (uint32_t i = 0; i < ALLOCS_PER_FRAME; ++ i)
+		{
+			tb.Alloc(sizeof(data), data);
+		}
+		tb.EnsureDataReady();
+		tb.OnPresent();
+	}
+	double const ns = timer.elapsed() * 1e9 / (NUM_FRAMES * ALLOCS_PER_FRAME);
+
+	cout << "TransientBuffer: " << ns << " ns/alloc" << endl;
+}
@@ -0,0 +1,138 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <KlayGE/Context.hpp>
+#include <KlayGE/Font.hpp>
+#include <KlayGE/SceneManager.hpp>
+#include <KlayGE/SceneNode.hpp>
+#include <KlayGE/UI.hpp>
+
+#include <sstream>
+#include <string>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	std::string const test_uiml =
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>\n"
+		"<ui>\n"
+		"\t<dialog id=\"Test\" caption=\"Test\" x=\"0\" y=\"0\" width=\"200\" height=\"100\">\n"
+		"\t\t<control type=\"check_box\" id=\"Check\" caption=\"Check\" x=\"10\" y=\"10\" width=\"150\" height=\"24\"/>\n"
+		"\t\t<control type=\"radio_button\" id=\"Radio\" caption=\"Radio\" x=\"10\" y=\"40\" width=\"150\" height=\"24\""
+			" button_group=\"1\"/>\n"
+		"\t</dialog>\n"
+		"</ui>\n";
+
+	class UITest : public testing::Test
+	{
+	public:
+		void SetUp() override
+		{
+			auto& ui_mgr = UIManager::Instance();
+			ui_mgr.Load(MakeSharedPtr<ResIdentifier>("test.uiml", 0,
+				MakeSharedPtr<std::stringstream>(test_uiml, std::ios_base::in | std::ios_base::binary)));
+			dialog_ = ui_mgr.GetDialog("Test");
+		}
+
+		void TearDown() override
+		{
+			dialog_.reset();
+			UIManager::Destroy();
+		}
+
+		void RenderFrame()
+		{
+			UIManager::Instance().Render();
+			Context::Instance().SceneManagerInstance().OverlayRootNode().ClearChildren();
+		}
+
+		// Renders a frame that is expected to reuse the cached geometry, then runs the setter and checks the next frame rebuilds it
+		template <typename Setter>
+		void ExpectRebuiltAfter(Setter const & setter)
+		{
+			auto& ui_mgr = UIManager::Instance();
+
+			this->RenderFrame();
+			EXPECT_EQ(ui_mgr.NumQuadsRebuilt(), 0U);
+			EXPECT_GT(ui_mgr.NumQuadsReused(), 0U);
+
+			setter();
+
+			this->RenderFrame();
+			EXPECT_GT(ui_mgr.NumQuadsRebuilt(), 0U);
+			EXPECT_EQ(ui_mgr.NumQuadsReused(), 0U);
+		}
+
+	protected:
+		UIDialogPtr dialog_;
+	};
+}
+
+TEST_F(UITest, GeometryIsReusedWhenClean)
+{
+	ASSERT_TRUE(dialog_);
+
+	auto& ui_mgr = UIManager::Instance();
+
+	this->RenderFrame();
+	EXPECT_GT(ui_mgr.NumQuadsRebuilt(), 0U);
+	EXPECT_EQ(ui_mgr.NumQuadsReused(), 0U);
+
+	this->RenderFrame();
+	EXPECT_EQ(ui_mgr.NumQuadsRebuilt(), 0U);
+	EXPECT_GT(ui_mgr.NumQuadsReused(), 0U);
+}
+
+TEST_F(UITest, CheckBoxSetTextMarksDirty)
+{
+	ASSERT_TRUE(dialog_);
+
+	auto check = dialog_->Control<UICheckBox>(dialog_->IDFromName("Check"));
+	this->RenderFrame();
+	this->ExpectRebuiltAfter([&check] { check->SetText(L"Changed"); });
+}
+
+TEST_F(UITest, RadioButtonSetTextMarksDirty)
+{
+	ASSERT_TRUE(dialog_);
+
+	auto radio = dialog_->Control<UIRadioButton>(dialog_->IDFromName("Radio"));
+	this->RenderFrame();
+	this->ExpectRebuiltAfter([&radio] { radio->SetText(L"Changed"); });
+}
+
+TEST_F(UITest, ElementSetFontMarksDirty)
+{
+	ASSERT_TRUE(dialog_);
+
+	auto check = dialog_->Control<UICheckBox>(dialog_->IDFromName("Check"));
+	this->RenderFrame();
+	this->ExpectRebuiltAfter([&check] { check->GetElement(0)->SetFont(0, Color(1, 0, 0, 1)); });
+	this->ExpectRebuiltAfter([&check] { check->GetElement(0)->SetFont(0, Color(0, 1, 0, 1), Font::FA_Hor_Right | Font::FA_Ver_Middle); });
+	this->ExpectRebuiltAfter([&check] { check->GetElement(0)->SetFont(0); });
+}
+
+TEST_F(UITest, ElementSetTextureMarksDirty)
+{
+	ASSERT_TRUE(dialog_);
+
+	auto check = dialog_->Control<UICheckBox>(dialog_->IDFromName("Check"));
+	this->RenderFrame();
+	this->ExpectRebuiltAfter([&check] {
+		check->GetElement(1)->SetTexture(0, UIManager::Instance().ElementTextureRect(UICT_RadioButton, 1));
+	});
+}
+
+TEST_F(UITest, SetElementKeepsOwner)
+{
+	ASSERT_TRUE(dialog_);
+
+	auto check = dialog_->Control<UICheckBox>(dialog_->IDFromName("Check"));
+	UIElement element = *check->GetElement(0);
+	check->SetElement(0, element);
+	this->RenderFrame();
+	this->ExpectRebuiltAfter([&check] { check->GetElement(0)->SetFont(0, Color(0, 0, 1, 1)); });
+}
@@ -0,0 +1,226 @@
+#include <KlayGE/KlayGE.hpp>
+#include <KFL/ResIdentifier.hpp>
+#include <KFL/Timer.hpp>
+#include <KFL/XMLDom.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "KlayGETests.hpp"
+
+using namespace std;
+using namespace KlayGE;
+
+namespace
+{
+	std::string const test_xml =
+		"<?xml version=\"1.0\"?>\n"
+		"<effect>\n"
+		"\t<parameter type=\"float4\" name=\"color\" value=\"0.25\"/>\n"
+		"\t<parameter type=\"int\" name=\"count\" value=\"-12\" size=\"4000000000\"/>\n"
+		"\t<macro name=\"KLAYGE_MAX\" value=\"3\"/>\n"
+		"\t<shader><![CDATA[float4 main() { return 1; }]]></shader>\n"
+		"\t<text>42</text>\n"
+		"</effect>\n";
+
+	ResIdentifierPtr MakeSource(std::string const & str)
+	{
+		return MakeSharedPtr<ResIdentifier>("test.fxml", 1234,
+			MakeSharedPtr<std::stringstream>(str, std::ios_base::in | std::ios_base::binary));
+	}
+
+	std::string CompileToString(std::string const & xml, uint64_t timestamp)
+	{
+		XMLDocument doc;
+		doc.Parse(MakeSource(xml));
+
+		std::ostringstream oss(std::ios_base::binary);
+		doc.Compile(oss, timestamp);
+		return oss.str();
+	}
+
+	void ExpectSameTree(XMLNode const & lhs, XMLNode const & rhs)
+	{
+		EXPECT_EQ(lhs.Name(), rhs.Name());
+		EXPECT_EQ(lhs.Type(), rhs.Type());
+		EXPECT_EQ(lhs.ValueString(), rhs.ValueString());
+
+		auto lhs_attr = lhs.FirstAttrib();
+		auto rhs_attr = rhs.FirstAttrib();
+		for (; lhs_attr && rhs_attr; lhs_attr = lhs_attr->NextAttrib(), rhs_attr = rhs_attr->NextAttrib())
+		{
+			EXPECT_EQ(lhs_attr->Name(), rhs_attr->Name());
+			EXPECT_EQ(lhs_attr->ValueString(), rhs_attr->ValueString());
+		}
+		EXPECT_FALSE(lhs_attr);
+		EXPECT_FALSE(rhs_attr);
+
+		auto lhs_child = lhs.FirstNode();
+		auto rhs_child = rhs.FirstNode();
+		for (; lhs_child && rhs_child; lhs_child = lhs_child->NextSibling(), rhs_child = rhs_child->NextSibling())
+		{
+			ExpectSameTree(*lhs_child, *rhs_child);
+		}
+		EXPECT_FALSE(lhs_child);
+		EXPECT_FALSE(rhs_child);
+	}
+}
+
+TEST(XMLDomTest, CompiledRoundTrip)
+{
+	XMLDocument text_doc;
+	XMLNodePtr text_root = text_doc.Parse(MakeSource(test_xml));
+
+	std::string const compiled = CompileToString(test_xml, 1234);
+	auto compiled_source = MakeSource(compiled);
+	uint64_t timestamp = 0;
+	EXPECT_TRUE(XMLDocument::IsCompiled(compiled_source, timestamp));
+	EXPECT_EQ(timestamp, 1234U);
+	EXPECT_FALSE(XMLDocument::IsCompiled(MakeSource(test_xml), timestamp));
+	EXPECT_FALSE(XMLDocument::IsCompiled(MakeSource(compiled.substr(0, compiled.size() - 1)), timestamp));
+
+	XMLDocument compiled_doc;
+	XMLNodePtr compiled_root = compiled_doc.Parse(compiled_source);
+	ExpectSameTree(*text_root, *compiled_root);
+
+	// Compiling a compiled document gives back the same bytes
+	std::ostringstream oss(std::ios_base::binary);
+	compiled_doc.Compile(oss, 1234);
+	EXPECT_EQ(oss.str(), compiled);
+}
+
+TEST(XMLDomTest, CompiledValues)
+{
+	XMLDocument doc;
+	XMLNodePtr root = doc.Parse(MakeSource(CompileToString(test_xml, 0)));
+
+	XMLNodePtr color = root->FirstNode("parameter");
+	EXPECT_EQ(color->AttribFloat("value", 0), 0.25f);
+	int32_t int_val;
+	EXPECT_FALSE(color->Attrib("value")->TryConvert(int_val));
+	EXPECT_EQ(color->Attrib("value")->ValueInt(), 0);
+
+	XMLNodePtr count = color->NextSibling("parameter");
+	EXPECT_EQ(count->AttribInt("value", 0), -12);
+	EXPECT_EQ(count->AttribFloat("value", 0), -12.0f);
+	EXPECT_EQ(count->AttribUInt("size", 0), 4000000000U);
+	EXPECT_FALSE(count->Attrib("size")->TryConvert(int_val));
+	EXPECT_EQ(count->AttribString("name", ""), "count");
+
+	EXPECT_EQ(root->FirstNode("macro")->AttribUInt("value", 0), 3U);
+	EXPECT_EQ(root->FirstNode("shader")->FirstNode()->Type(), XNT_CData);
+	EXPECT_EQ(root->FirstNode("shader")->FirstNode()->ValueString(), "float4 main() { return 1; }");
+	EXPECT_EQ(root->FirstNode("text")->ValueInt(), 42);
+}
+
+TEST(XMLDomTest, CompiledEditing)
+{
+	XMLDocument doc;
+	XMLNodePtr root = doc.Parse(MakeSource(CompileToString(test_xml, 0)));
+
+	XMLNodePtr node = doc.AllocNode(XNT_Element, "parameter");
+	node->AppendAttrib(doc.AllocAttribInt("value", 7));
+	root->AppendNode(node);
+
+	XMLDocument other_doc;
+	XMLNodePtr other_root = other_doc.Parse(MakeSource(CompileToString(test_xml, 0)));
+	root->AppendNode(doc.CloneNode(other_root->FirstNode("macro")));
+
+	EXPECT_EQ(root->LastNode("parameter")->AttribInt("value", 0), 7);
+	EXPECT_EQ(root->LastNode("macro")->AttribInt("value", 0), 3);
+	EXPECT_EQ(root->LastNode("macro")->AttribString("name", ""), "KLAYGE_MAX");
+}
+
+TEST(XMLDomTest, ViewIteration)
+{
+	for (bool compiled : { false, true })
+	{
+		XMLDocument doc;
+		XMLNodeView root = doc.Parse(MakeSource(compiled ? CompileToString(test_xml, 0) : test_xml))->View();
+
+		std::vector<std::string_view> names;
+		for (XMLNodeView node : root.Children())
+		{
+			if (XNT_Element == node.Type())
+			{
+				names.push_back(node.Name());
+			}
+		}
+		EXPECT_EQ(names.size(), 5U);
+		EXPECT_EQ(names[0], "parameter");
+		EXPECT_EQ(names[4], "text");
+
+		int num_params = 0;
+		int32_t sum = 0;
+		for (XMLNodeView node : root.Children("parameter"))
+		{
+			EXPECT_EQ(node.Parent(), root);
+			int32_t val;
+			if (node.Attrib("value").TryConvert(val))
+			{
+				sum += val;
+			}
+			++ num_params;
+		}
+		EXPECT_EQ(num_params, 2);
+		EXPECT_EQ(sum, -12);
+
+		std::vector<std::string_view> attr_names;
+		for (XMLAttributeView attr : root.FirstNode("parameter").NextSibling("parameter").Attribs())
+		{
+			attr_names.push_back(attr.Name());
+		}
+		EXPECT_EQ(attr_names.size(), 4U);
+		EXPECT_EQ(attr_names[3], "size");
+
+		EXPECT_FALSE(root.FirstNode("missing"));
+		EXPECT_FALSE(root.Attrib("missing"));
+		EXPECT_TRUE(root.Children("missing").begin() == root.Children("missing").end());
+		EXPECT_EQ(root.FirstNode("macro").AttribString("name", ""), "KLAYGE_MAX");
+		EXPECT_EQ(root.FirstNode("text").ValueInt(), 42);
+	}
+}
+
+TEST(XMLDomTest, CompiledPerformance)
+{
+	std::string xml = "<effect>\n";
+	for (int i = 0; i < 20000; ++ i)
+	{
+		xml += "\t<parameter type=\"float4\" name=\"param_" + std::to_string(i) + "\" value=\"" + std::to_string(i * 0.5f)
+			+ "\" array_size=\"" + std::to_string(i % 16) + "\"/>\n";
+	}
+	xml += "</effect>\n";
+	std::string const compiled = CompileToString(xml, 0);
+
+	auto sum_values = [](XMLNode const & root)
+	{
+		float sum = 0;
+		for (auto node = root.FirstNode("parameter"); node; node = node->NextSibling("parameter"))
+		{
+			sum += node->AttribFloat("value", 0) + node->AttribUInt("array_size", 0);
+		}
+		return sum;
+	};
+
+	Timer timer;
+	float text_sum;
+	{
+		XMLDocument doc;
+		text_sum = sum_values(*doc.Parse(MakeSource(xml)));
+	}
+	double const text_time = timer.elapsed();
+
+	timer.restart();
+	float compiled_sum;
+	{
+		XMLDocument doc;
+		compiled_sum = sum_values(*doc.Parse(MakeSource(compiled)));
+	}
+	double const compiled_time = timer.elapsed();
+
+	EXPECT_EQ(text_sum, compiled_sum);
+	std::cout << "Text: " << xml.size() << " bytes, " << text_time * 1000 << " ms. Compiled: "
+		<< compiled.size() << " bytes, " << compiled_time * 1000 << " ms." << std::endl;
+}
@@ -7,6 +7,7 @@
 #include <KlayGE/App3D.hpp>
 #include <KlayGE/RenderFactory.hpp>
 #include <KlayGE/Context.hpp>
+#include <KlayGE/DistanceField.hpp>
 #include <KlayGE/RenderSettings.hpp>
 
 #include <cmath>
@@ -21,195 +22,26 @@
 using namespace std;
 using namespace KlayGE;
 
-// A type to hold the distance map while it's being constructed
-template <typename DistanceType>
-class DistanceMap
-{
-public:
-	DistanceMap(int width, int height, int depth)
-		: data_(width * height * depth * 3),
-			width_(width), height_(height), depth_(depth)
-	{
-	}
-
-	DistanceType& operator()(int x, int y, int z, int i)
-	{
-		return data_[((z * height_ + y) * width_ + x) * 3 + i];
-	}
-
-	DistanceType const & operator()(int x, int y, int z, int i) const
-	{
-		return data_[((z * height_ + y) * width_ + x) * 3 + i];
-	}
-
-	bool inside(int x, int y, int z) const
-	{
-		return (0 <= x) && (x < width_)
-			&& (0 <= y) && (y < height_)
-			&& (0 <= z) && (z < depth_);
-	}
-
-	// Do a single pass over the data.
-	// Start at (x,y,z) and walk in the direction (cx,cy,cz)
-	// Combine each pixel (x,y,z) with the value at (x+dx,y+dy,z+dz)
-	void combine(int dx, int dy, int dz,
-		int cx, int cy, int cz,
-		int x, int y, int z)
-	{
-		while (inside(x, y, z) && inside(x + dx, y + dy, z + dz))
-		{
-			int d[3] =
-			{
-				abs(dx),
-				abs(dy),
-				abs(dz)
-			};
-
-			uint32_t v1[3], v2[3];
-			for (int i = 0; i < 3; ++ i)
-			{
-				v1[i] = operator()(x, y, z, i);
-				v2[i] = operator()(x + dx, y + dy, z + dz, i) + d[i];
-			}
-
-			if (v1[0] * v1[0] + v1[1] * v1[1] + v1[2] * v1[2] > v2[0] * v2[0] + v2[1] * v2[1] + v2[2] * v2[2])
-			{
-				for (int i = 0; i < 3; ++ i)
-				{
-					operator()(x, y, z, i) = static_cast<DistanceType>(v2[i]);
-				}
-			}
-
-			x += cx;
-			y += cy;
-			z += cz;
-		}
-	}
-
-private:
-	std::vector<DistanceType> data_;
-	int width_, height_, depth_;
-};
-
+// The distance to the solid, over [0, depth]. Or with signed_distance, the distance to the surface over [-depth, depth],
+// positive outside, with 0.5 on the surface.
 void ComputeDistanceField(std::vector<uint8_t>& distances, int width, int height, int depth,
-						std::vector<uint8_t> const & volume)
+						std::vector<uint8_t> const & volume, bool signed_distance)
 {
-	// and +infinity above
-	DistanceMap<uint16_t> dmap(width, height, depth);
-	for (int z = 0; z < depth; ++ z)
-	{
-		for (int y = 0; y < height; ++ y)
-		{
-			for (int x = 0; x < width; ++ x)
-			{
-				for (int i = 0; i < 3; ++ i)
-				{
-					if (volume[(z * height + y) * width + x] != 0)
-					{
-						dmap(x, y, z, i) = 0;
-					}
-					else
-					{
-						dmap(x, y, z, i) = std::numeric_limits<uint16_t>::max();
-					}
-				}
-			}
-		}
-	}
-
-
-	// Compute the rest of dmap by sequential sweeps over the data
-	// using a 3d variant of Danielsson's algorithm
-
-	for (int z = 1; z < depth; ++ z)
-	{
-		// combine with everything with dz = -1
-		for (int y = 0; y < height; ++ y)
-		{
-			dmap.combine(0, 0, -1,
-				1, 0, 0,
-				0, y, z);
-		}
-
-		for (int y = 1; y < height; ++ y)
-		{
-			dmap.combine(0, -1, 0,
-				1, 0, 0,
-				0, y, z);
-			dmap.combine(-1, 0, 0,
-				1, 0, 0,
-				1, y, z);
-			dmap.combine(+1, 0, 0,
-				-1, 0, 0,
-				width - 2, y, z);
-		}
-
-		for (int y = height - 1; y >= 0; -- y)
-		{
-			dmap.combine(0, +1, 0,
-				1, 0, 0,
-				0, y, z);
-			dmap.combine(-1, 0, 0,
-				1, 0, 0,
-				1, y, z);
-			dmap.combine(+1, 0, 0,
-				-1, 0, 0,
-				width - 1, y, z);
-		}
-	}
-
-	for (int z = depth - 1; z >= 0; -- z)
+	std::vector<float> dist;
+	if (signed_distance)
 	{
-		cout << ".";
-
-		// combine with everything with dz = +1
-		for (int y = 0; y < height; ++ y)
-		{
-			dmap.combine(0, 0, +1,
-				1, 0, 0,
-				0, y, z);
-		}
-
-		for (int y = 1; y < height; ++ y)
-		{
-			dmap.combine(0, -1, 0,
-				1, 0, 0,
-				0, y, z);
-			dmap.combine(-1, 0, 0,
-				1, 0, 0,
-				1, y, z);
-			dmap.combine(+1, 0, 0,
-				-1, 0, 0,
-				width - 2, y, z);
-		}
-		for (int y = height - 1; y >= 0; -- y)
+		ComputeSignedEuclideanDistance(volume, width, height, depth, dist);
+		for (size_t i = 0; i < dist.size(); ++ i)
 		{
-			dmap.combine(0, +1, 0,
-				1, 0, 0,
-				0, y, z);
-			dmap.combine(-1, 0, 0,
-				1, 0, 0,
-				1, y, z);
-			dmap.combine(+1, 0, 0,
-				-1, 0, 0,
-				width - 1, y, z);
+			distances[i] = static_cast<uint8_t>(MathLib::clamp(0.5f - dist[i] / (2 * depth), 0.0f, 1.0f) * 255);
 		}
 	}
-
-	for (int z = 0; z < depth; ++ z)
+	else
 	{
-		for (int y = 0; y < height; ++ y)
+		ComputeEuclideanDistance(volume, width, height, depth, dist);
+		for (size_t i = 0; i < dist.size(); ++ i)
 		{
-			for (int x = 0; x < width; ++ x)
-			{
-				float value = 0;
-				for (int i = 0; i < 3; ++ i)
-				{
-					value += dmap(x, y, z, i) * dmap(x, y, z, i);
-				}
-				distances[(z * height + y) * width + x]
-					= static_cast<uint8_t>(MathLib::clamp(sqrt(value) / depth, 0.0f, 1.0f) * 255);
-			}
+			distances[i] = static_cast<uint8_t>(MathLib::clamp(dist[i] / depth, 0.0f, 1.0f) * 255);
 		}
 	}
 }
@@ -235,6 +67,7 @@ public:
 int main(int argc, char* argv[])
 {
 	int width = 256, height = 256, depth = 16;
+	bool signed_distance = false;
 
 	std::string src_name("height.dds");
 	std::string distance_name("distance.dds");
@@ -259,6 +92,10 @@ int main(int argc, char* argv[])
 	{
 		depth = std::stoi(argv[5]);
 	}
+	if (argc > 6)
+	{
+		signed_distance = (std::string(argv[6]) == "signed");
+	}
 
 	Context::Instance().LoadCfg("KlayGE.cfg");
 	ContextCfg context_cfg = Context::Instance().Config();
@@ -334,9 +171,9 @@ int main(int argc, char* argv[])
 	clock_t start = clock();
 
 	std::vector<uint8_t> distances(width * height * depth);
-	ComputeDistanceField(distances, width, height, depth, volume);
+	ComputeDistanceField(distances, width, height, depth, volume, signed_distance);
 
-	cout << endl << "Computing time: " << clock() - start << " ms" << endl;
+	cout << "Computing time: " << clock() - start << " ms" << endl;
 
 	TexturePtr distance_map_texture = render_factory.MakeTexture3D(width, height, depth, 1, 1, EF_R8, 1, 0, EAH_CPU_Read | EAH_CPU_Write);
 
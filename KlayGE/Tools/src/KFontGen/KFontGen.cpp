@@ -35,6 +35,7 @@
 #include <KFL/Math.hpp>
 #include <KFL/Thread.hpp>
 #include <KFL/CpuInfo.hpp>
+#include <KFL/ResIdentifier.hpp>
 #include <KlayGE/LZMACodec.hpp>
 #include <KlayGE/DistanceField.hpp>
 
@@ -46,6 +47,7 @@
 #include <fstream>
 #include <cstring>
 #include <atomic>
+#include <unordered_map>
 
 #ifndef KLAYGE_DEBUG
 #define CXXOPTS_NO_RTTI
@@ -499,7 +501,7 @@ int main(int argc, char* argv[])
 {
 	kfont_header header;
 	header.fourcc = MakeFourCC<'K', 'F', 'N', 'T'>::value;
-	header.version = 2;
+	header.version = 3;
 	header.start_ptr = sizeof(header);
 	header.non_empty_chars = 0;
 	header.char_size = 32;
@@ -533,7 +535,7 @@ int main(int argc, char* argv[])
 	}
 	if (vm.count("version") > 0)
 	{
-		cout << "KlayGE Font Generator, Version 2.0.0" << endl;
+		cout << "KlayGE Font Generator, Version 3.0.0" << endl;
 		return 1;
 	}
 	if (vm.count("input-name") > 0)
@@ -786,4 +788,23 @@ int main(int argc, char* argv[])
 
 		kfont_output.Save(kfont_name.string());
 	}
+
+	{
+		cout << "Loading the output..." << endl;
+
+		timer_stage.restart();
+		KFont mapped_font;
+		mapped_font.Load(kfont_name.string());
+		double const mapped_time = timer_stage.elapsed();
+
+		timer_stage.restart();
+		KFont streamed_font;
+		streamed_font.Load(MakeSharedPtr<ResIdentifier>(kfont_name.string(), 0,
+			MakeSharedPtr<std::ifstream>(kfont_name.string().c_str(), std::ios_base::binary | std::ios_base::in)));
+		double const streamed_time = timer_stage.elapsed();
+
+		cout << "Mapped: " << mapped_time * 1000 << " ms, " << mapped_font.ResidentSize() / 1024.0 << " KB resident"
+			<< (mapped_font.Mapped() ? "" : " (mapping is not available)") << endl;
+		cout << "Streamed: " << streamed_time * 1000 << " ms, " << streamed_font.ResidentSize() / 1024.0 << " KB resident" << endl;
+	}
 }
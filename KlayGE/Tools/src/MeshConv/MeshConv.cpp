@@ -50,6 +50,91 @@
 using namespace std;
 using namespace KlayGE;
 
+namespace
+{
+	void PrintAnimationReport(SkinnedModel const & model)
+	{
+		auto const & kfs = model.GetKeyFrameSets();
+		if (!kfs)
+		{
+			return;
+		}
+
+		size_t num_keys = 0;
+		for (auto const & kf : *kfs)
+		{
+			num_keys += kf.frame_id.size();
+		}
+		cout << "Animation: " << kfs->size() << " tracks, " << num_keys << " keys, "
+			<< num_keys * (sizeof(uint32_t) + sizeof(Quaternion) * 2 + sizeof(float)) << " bytes";
+
+		auto const & compressed_kfs = model.GetCompressedKeyFrameSets();
+		if (compressed_kfs)
+		{
+			size_t compressed_size = 0;
+			float max_rot_error = 0;
+			float max_trans_error = 0;
+			float max_scale_error = 0;
+			for (size_t i = 0; i < kfs->size(); ++ i)
+			{
+				auto const & kf = (*kfs)[i];
+				auto const & compressed_kf = (*compressed_kfs)[i];
+				compressed_size += compressed_kf.frame_id.size() * sizeof(compressed_kf.frame_id[0])
+					+ compressed_kf.keys.size() * sizeof(compressed_kf.keys[0])
+					+ sizeof(compressed_kf.dequant_scale) + sizeof(compressed_kf.dequant_bias);
+
+				uint32_t cursor = 0;
+				uint32_t compressed_cursor = 0;
+				for (uint32_t frame = 0; frame < model.NumFrames(); ++ frame)
+				{
+					auto const key = kf.Frame(static_cast<float>(frame), cursor);
+					auto const compressed_key = compressed_kf.Frame(static_cast<float>(frame), compressed_cursor);
+
+					Quaternion real = std::get<0>(compressed_key);
+					if (MathLib::dot(real, std::get<0>(key)) < 0)
+					{
+						real = -real;
+					}
+					float const rot_error = 4 * std::asin(std::min(MathLib::length(real - std::get<0>(key)) / 2, 1.0f));
+					float const trans_error = MathLib::length(MathLib::udq_to_trans(std::get<0>(key), std::get<1>(key))
+						- MathLib::udq_to_trans(std::get<0>(compressed_key), std::get<1>(compressed_key)));
+					max_rot_error = std::max(max_rot_error, rot_error);
+					max_trans_error = std::max(max_trans_error, trans_error);
+					max_scale_error = std::max(max_scale_error, MathLib::abs(std::get<2>(key) - std::get<2>(compressed_key)));
+				}
+			}
+
+			cout << ", compressed to " << compressed_size << " bytes. Max error: " << MathLib::rad2deg(max_rot_error)
+				<< " degrees in rotation, " << max_trans_error << " in translation, " << max_scale_error << " in scale";
+		}
+		cout << '.' << endl;
+	}
+
+	void PrintVertexStreamReport(RenderModel const & model)
+	{
+		// All meshes share the merged vertex and index buffers
+		auto const & rl = model.Mesh(0)->GetRenderLayout();
+
+		uint32_t vertex_size = 0;
+		uint32_t float_vertex_size = 0;
+		uint32_t vertex_buffer_size = 0;
+		for (uint32_t i = 0; i < rl.NumVertexStreams(); ++ i)
+		{
+			vertex_size += rl.VertexSize(i);
+			for (auto const & ve : rl.VertexStreamFormat(i))
+			{
+				float_vertex_size += NumComponents(ve.format) * sizeof(float);
+			}
+			vertex_buffer_size += rl.GetVertexStream(i)->Size();
+		}
+		uint32_t const num_vertices = (vertex_size > 0) ? vertex_buffer_size / vertex_size : 0;
+
+		cout << "Vertex streams: " << vertex_size << " bytes per vertex (" << float_vertex_size << " as float32), "
+			<< vertex_buffer_size << " bytes of vertices (" << num_vertices * float_vertex_size << " as float32), "
+			<< rl.GetIndexStream()->Size() << " bytes of indices." << endl;
+	}
+}
+
 int main(int argc, char* argv[])
 {
 	Context::Instance().LoadCfg("KlayGE.cfg");
@@ -160,8 +245,6 @@ int main(int argc, char* argv[])
 	filesystem::path const output_path(output_name);
 	if (output_path.extension() == ".model_bin")
 	{
-		uint32_t const MODEL_BIN_VERSION = 17;
-
 		ResIdentifierPtr output_file = ResLoader::Instance().Open(output_name);
 		if (output_file)
 		{
@@ -171,7 +254,7 @@ int main(int argc, char* argv[])
 			uint32_t ver;
 			output_file->read(&ver, sizeof(ver));
 			ver = LE2Native(ver);
-			if ((fourcc != MakeFourCC<'K', 'L', 'M', ' '>::value) || (ver != MODEL_BIN_VERSION))
+			if ((fourcc != MODEL_BIN_FOURCC) || (ver != MODEL_BIN_VERSION))
 			{
 				conversion = true;
 			}
@@ -214,19 +297,50 @@ int main(int argc, char* argv[])
 
 			if (!quiet)
 			{
+				size_t num_lod0_triangles = 0;
 				for (uint32_t lod = 0; lod < model->NumLods(); ++ lod)
 				{
 					size_t num_vertices = 0;
 					size_t num_triangles = 0;
+					size_t num_clusters = 0;
 					for (uint32_t mindex = 0; mindex < model->NumMeshes(); ++ mindex)
 					{
 						auto const& mesh = checked_cast<StaticMesh&>(*model->Mesh(mindex));
 
 						num_vertices += mesh.NumVertices(lod);
 						num_triangles += mesh.NumIndices(lod) / 3;
+						num_clusters += mesh.Clusters(lod).size();
+					}
+
+					cout << "LOD " << lod << ": " << num_vertices << " vertices, " << num_triangles << " triangles";
+					if (num_clusters > 0)
+					{
+						cout << " in " << num_clusters << " clusters";
+					}
+					if (lod == 0)
+					{
+						num_lod0_triangles = num_triangles;
 					}
+					else if (num_lod0_triangles > 0)
+					{
+						cout << " (" << num_triangles * 100.0f / num_lod0_triangles << "% of LOD 0)";
+					}
+					cout << '.' << endl;
+				}
 
-					cout << "LOD " << lod << ": " << num_vertices << " vertices, " << num_triangles << " triangles." << endl;
+				PrintVertexStreamReport(*model);
+
+				auto const & input_stats = mesh_converter.InputVertexCacheStats();
+				auto const & output_stats = mesh_converter.OutputVertexCacheStats();
+				if (input_stats.num_triangles > 0)
+				{
+					cout << "Vertex cache: ACMR " << input_stats.Acmr() << " -> " << output_stats.Acmr()
+						<< ", ATVR " << input_stats.Atvr() << " -> " << output_stats.Atvr() << '.' << endl;
+				}
+
+				if (model->IsSkinned())
+				{
+					PrintAnimationReport(checked_cast<SkinnedModel&>(*model));
 				}
 
 				cout << "Mesh has been saved to " << output_name << "." << endl;
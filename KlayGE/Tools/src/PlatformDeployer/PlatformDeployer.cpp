@@ -30,6 +30,8 @@
 
 #include <KlayGE/KlayGE.hpp>
 #include <KFL/Hash.hpp>
+#include <KFL/Thread.hpp>
+#include <KFL/Timer.hpp>
 #include <KFL/Util.hpp>
 #include <KlayGE/JudaTexture.hpp>
 #include <KlayGE/RenderDeviceCaps.hpp>
@@ -37,8 +39,10 @@
 #include <KFL/XMLDom.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
+#include <atomic>
 #include <iostream>
 #include <fstream>
+#include <mutex>
 #include <vector>
 #include <regex>
 
@@ -53,6 +57,7 @@
 #include <boost/algorithm/string/trim.hpp>
 
 #include <KlayGE/ToolCommon.hpp>
+#include <KlayGE/DevHelper/AssetCache.hpp>
 #include <KlayGE/DevHelper/PlatformDefinition.hpp>
 #include <KlayGE/DevHelper/MeshConverter.hpp>
 #include <KlayGE/DevHelper/MeshMetadata.hpp>
@@ -62,6 +67,9 @@
 using namespace std;
 using namespace KlayGE;
 
+// Only for textures without a .kmeta. The runtime JIT doesn't know the type of a texture and converts those with a
+// default TexMetadata, without the slot, sRGB and mipmap settings here. The outputs differ, so do the cache keys, and
+// only textures with a .kmeta share artifacts between the batch and the JIT.
 TexMetadata DefaultTextureMetadata(size_t res_type_hash, RenderDeviceCaps const & caps)
 {
 	TexMetadata default_metadata;
@@ -129,8 +137,67 @@ MeshMetadata LoadMeshMetadata(std::string const & res_name, MeshMetadata const &
 	}
 }
 
+enum class DeployResult
+{
+	Converted,
+	Cached,
+	Failed
+};
+
+// Converts every resource on the thread pool. Converters look the resource up in the asset cache first, and store the
+// output there after converting, so other checkouts pick up the result. So does the runtime JIT, as long as both end up
+// with the same metadata, see DefaultTextureMetadata.
+template <typename Converter>
+void ConvertInParallel(std::vector<std::string> const & res_names, std::string_view res_type, Converter const & converter)
+{
+	std::mutex log_mutex;
+	std::atomic<uint32_t> num_converted(0);
+	std::atomic<uint32_t> num_cached(0);
+	std::atomic<uint32_t> num_failed(0);
+
+	Timer timer;
+
+	auto& tp = Context::Instance().ThreadPool();
+	std::vector<joiner<void>> joiners;
+	joiners.reserve(res_names.size());
+	for (auto const & res_name : res_names)
+	{
+		joiners.push_back(tp([&, res_name]
+			{
+				DeployResult const result = converter(res_name);
+
+				std::lock_guard<std::mutex> lock(log_mutex);
+				switch (result)
+				{
+				case DeployResult::Converted:
+					std::cout << "Converted " << res_name << " to " << res_type << std::endl;
+					++ num_converted;
+					break;
+
+				case DeployResult::Cached:
+					std::cout << "Fetched " << res_name << " from the asset cache" << std::endl;
+					++ num_cached;
+					break;
+
+				case DeployResult::Failed:
+				default:
+					std::cout << "Could NOT convert " << res_name << std::endl;
+					++ num_failed;
+					break;
+				}
+			}));
+	}
+	for (auto& joiner : joiners)
+	{
+		joiner();
+	}
+
+	std::cout << num_converted << " converted, " << num_cached << " fetched from the asset cache, " << num_failed
+		<< " failed. " << timer.elapsed() << " s." << std::endl;
+}
+
 void Deploy(std::vector<std::string> const & res_names, std::string_view res_type,
-	RenderDeviceCaps const & caps, std::string_view platform)
+	RenderDeviceCaps const & caps, std::string_view platform, AssetCache* cache)
 {
 	size_t const res_type_hash = HashRange(res_type.begin(), res_type.end());
 
@@ -144,37 +211,71 @@ void Deploy(std::vector<std::string> const & res_names, std::string_view res_typ
 	{
 		TexMetadata const default_metadata = DefaultTextureMetadata(res_type_hash, caps);
 
-		TexConverter tc;
-		for (size_t i = 0; i < res_names.size(); ++ i)
-		{
-			std::cout << "Converting " << res_names[i] << " to " << res_type << std::endl;
-
-			auto metadata = LoadTextureMetadata(res_names[i], default_metadata);
-			auto output_tex = tc.Load(res_names[i], metadata);
-			if (output_tex)
+		ConvertInParallel(res_names, res_type, [&default_metadata, &caps, cache](std::string const & res_name)
 			{
-				filesystem::path res_path(res_names[i]);
-				SaveTexture(output_tex, res_path.string() + ".dds");
-			}
-		}
+				auto metadata = LoadTextureMetadata(res_name, default_metadata);
+				metadata.DeviceDependentAdjustment(caps);
+
+				std::string const output_name = res_name + ".dds";
+				std::string key;
+				if (cache)
+				{
+					key = cache->TextureKey(res_name, metadata);
+					if (cache->Fetch(key, output_name))
+					{
+						return DeployResult::Cached;
+					}
+				}
+
+				TexConverter tc;
+				auto output_tex = tc.Load(res_name, metadata);
+				if (!output_tex)
+				{
+					return DeployResult::Failed;
+				}
+
+				SaveTexture(output_tex, output_name);
+				if (cache)
+				{
+					cache->Store(key, output_name);
+				}
+				return DeployResult::Converted;
+			});
 	}
 	else if (CT_HASH("model") == res_type_hash)
 	{
 		MeshMetadata const default_metadata;
 
-		MeshConverter mc;
-		for (size_t i = 0; i < res_names.size(); ++ i)
-		{
-			std::cout << "Converting " << res_names[i] << " to " << res_type << std::endl;
-
-			auto metadata = LoadMeshMetadata(res_names[i], default_metadata);
-			auto output_model = mc.Load(res_names[i], metadata);
-			if (output_model)
+		ConvertInParallel(res_names, res_type, [&default_metadata, cache](std::string const & res_name)
 			{
-				filesystem::path res_path(res_names[i]);
-				SaveModel(*output_model, res_path.string() + ".model_bin");
-			}
-		}
+				auto metadata = LoadMeshMetadata(res_name, default_metadata);
+
+				std::string const output_name = res_name + ".model_bin";
+				std::string key;
+				if (cache)
+				{
+					key = cache->ModelKey(res_name, res_name + ".kmeta", metadata);
+					if (cache->Fetch(key, output_name))
+					{
+						return DeployResult::Cached;
+					}
+				}
+
+				MeshConverter mc;
+				auto output_model = mc.Load(res_name, metadata);
+				if (!output_model)
+				{
+					return DeployResult::Failed;
+				}
+
+				SaveModel(*output_model, output_name);
+				if (cache)
+				{
+					cache->Store(cache->RecordModelSidecars(res_name, res_name + ".kmeta", metadata, mc.ImportedFiles()),
+						output_name);
+				}
+				return DeployResult::Converted;
+			});
 	}
 	else
 	{
@@ -255,6 +356,10 @@ int main(int argc, char* argv[])
 		("I,input-name", "Input resource name.", cxxopts::value<std::string>())
 		("T,type", "Resource type.", cxxopts::value<std::string>())
 		("P,platform", "Platform name.", cxxopts::value<std::string>())
+		("R,recursive", "Match wildcard input names in subdirectories too.")
+		("cache-dir", "Asset cache directory. Default is KLAYGE_ASSET_CACHE_DIR, or a directory in temp.",
+			cxxopts::value<std::string>())
+		("no-cache", "Always convert, and don't store results in the asset cache.")
 		("v,version", "Version.");
 
 	int const argc_backup = argc;
@@ -275,6 +380,7 @@ int main(int argc, char* argv[])
 	if (vm.count("input-name") > 0)
 	{
 		std::string input_name_str = vm["input-name"].as<std::string>();
+		bool const recursive = (vm.count("recursive") > 0);
 
 		std::vector<std::string> tokens;
 		boost::algorithm::split(tokens, input_name_str, boost::is_any_of(",;"));
@@ -293,18 +399,34 @@ int main(int argc, char* argv[])
 
 				std::regex const filter(DosWildcardToRegex(file_name.string()));
 
-				filesystem::directory_iterator end_itr;
-				for (filesystem::directory_iterator i(parent); i != end_itr; ++ i)
+				auto add_if_match = [&res_names, &filter](filesystem::directory_entry const & entry)
 				{
-					if (filesystem::is_regular_file(i->status()))
+					if (filesystem::is_regular_file(entry.status()))
 					{
 						std::smatch what;
-						std::string const name = i->path().filename().string();
+						std::string const name = entry.path().filename().string();
 						if (std::regex_match(name, what, filter))
 						{
-							res_names.push_back((parent / name).string());
+							res_names.push_back(entry.path().string());
 						}
 					}
+				};
+
+				if (recursive)
+				{
+					filesystem::recursive_directory_iterator end_itr;
+					for (filesystem::recursive_directory_iterator i(parent); i != end_itr; ++ i)
+					{
+						add_if_match(*i);
+					}
+				}
+				else
+				{
+					filesystem::directory_iterator end_itr;
+					for (filesystem::directory_iterator i(parent); i != end_itr; ++ i)
+					{
+						add_if_match(*i);
+					}
 				}
 			}
 		}
@@ -392,8 +514,22 @@ int main(int argc, char* argv[])
 		}
 	}
 
+	std::unique_ptr<AssetCache> cache;
+	if (vm.count("no-cache") == 0)
+	{
+		if (vm.count("cache-dir") > 0)
+		{
+			cache = MakeUniquePtr<AssetCache>(vm["cache-dir"].as<std::string>());
+		}
+		else
+		{
+			cache = MakeUniquePtr<AssetCache>();
+		}
+		cout << "Asset cache: " << cache->CacheDirectory() << endl;
+	}
+
 	PlatformDefinition platform_def(platform + ".plat");
-	Deploy(res_names, res_type, platform_def.device_caps, platform);
+	Deploy(res_names, res_type, platform_def.device_caps, platform, cache.get());
 
 	Context::Destroy();
 
@@ -1,6 +1,8 @@
 #include <KlayGE/KlayGE.hpp>
+#include <KFL/CpuInfo.hpp>
 #include <KFL/Half.hpp>
 #include <KFL/Math.hpp>
+#include <KFL/Thread.hpp>
 #include <KFL/Timer.hpp>
 #include <KlayGE/Texture.hpp>
 #include <KlayGE/ResLoader.hpp>
@@ -11,32 +13,54 @@
 #include <KlayGE/RenderMaterial.hpp>
 #include <KFL/CXX17/filesystem.hpp>
 
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <vector>
 
+#if defined(KLAYGE_SSE_SUPPORT)
+#include <xmmintrin.h>
+#endif
+
 #include <boost/assert.hpp>
 
+#ifndef KLAYGE_DEBUG
+#define CXXOPTS_NO_RTTI
+#endif
+#include <cxxopts.hpp>
+
 using namespace std;
 using namespace KlayGE;
 
 namespace
 {
-	void PrefilterCubeGPU(std::string const & in_file, std::string const & out_file)
+	// Mip 0 is the source, the last mip is the diffuse irradiance, and the ones in between are the specular lobes
+	uint32_t NumOutputMipmaps(uint32_t in_width)
 	{
-		TexturePtr in_tex = SyncLoadTexture(in_file, EAH_GPU_Read | EAH_Immutable);
-		uint32_t in_width = in_tex->Width(0);
-
 		uint32_t out_num_mipmaps = 1;
+		uint32_t w = in_width;
+		while (w > 8)
 		{
-			uint32_t w = in_width;
-			while (w > 8)
-			{
-				++ out_num_mipmaps;
+			++ out_num_mipmaps;
 
-				w = std::max<uint32_t>(1U, w / 2);
-			}
+			w = std::max<uint32_t>(1U, w / 2);
 		}
+		return out_num_mipmaps;
+	}
+
+	float SpecularShininess(uint32_t level, uint32_t out_num_mipmaps)
+	{
+		return Glossiness2Shininess(static_cast<float>(out_num_mipmaps - 2 - level) / (out_num_mipmaps - 2));
+	}
+
+	void PrefilterCubeGPU(std::string const & in_file, std::string const & out_file)
+	{
+		TexturePtr in_tex = SyncLoadTexture(in_file, EAH_GPU_Read | EAH_Immutable);
+		uint32_t in_width = in_tex->Width(0);
+
+		uint32_t const out_num_mipmaps = NumOutputMipmaps(in_width);
 
 		RenderFactory& rf = Context::Instance().RenderFactoryInstance();
 
@@ -54,7 +78,7 @@ namespace
 
 			for (uint32_t level = 1; level < out_num_mipmaps - 1; ++ level)
 			{
-				float shininess = Glossiness2Shininess(static_cast<float>(out_num_mipmaps - 2 - level) / (out_num_mipmaps - 2));
+				float shininess = SpecularShininess(level, out_num_mipmaps);
 
 				spec_pp->OutputPin(0, out_tex, level, 0, face);
 				spec_pp->SetParam(0, face);
@@ -71,6 +95,628 @@ namespace
 
 		SaveTexture(out_tex, out_file);
 	}
+
+#if defined(KLAYGE_SSE_SUPPORT)
+	typedef __m128 Color4;
+
+	Color4 ZeroColor()
+	{
+		return _mm_setzero_ps();
+	}
+
+	Color4 LoadColor(float4 const & clr)
+	{
+		return _mm_loadu_ps(&clr[0]);
+	}
+
+	Color4 AddColor(Color4 const & lhs, Color4 const & rhs)
+	{
+		return _mm_add_ps(lhs, rhs);
+	}
+
+	Color4 MulColor(Color4 const & clr, float weight)
+	{
+		return _mm_mul_ps(clr, _mm_set1_ps(weight));
+	}
+
+	Color4 MulAddColor(Color4 const & acc, Color4 const & clr, float weight)
+	{
+		return _mm_add_ps(acc, _mm_mul_ps(clr, _mm_set1_ps(weight)));
+	}
+
+	float4 StoreColor(Color4 const & clr)
+	{
+		float4 ret;
+		_mm_storeu_ps(&ret[0], clr);
+		return ret;
+	}
+#else
+	typedef float4 Color4;
+
+	Color4 ZeroColor()
+	{
+		return float4(0, 0, 0, 0);
+	}
+
+	Color4 LoadColor(float4 const & clr)
+	{
+		return clr;
+	}
+
+	Color4 AddColor(Color4 const & lhs, Color4 const & rhs)
+	{
+		return lhs + rhs;
+	}
+
+	Color4 MulColor(Color4 const & clr, float weight)
+	{
+		return clr * weight;
+	}
+
+	Color4 MulAddColor(Color4 const & acc, Color4 const & clr, float weight)
+	{
+		return acc + clr * weight;
+	}
+
+	float4 StoreColor(Color4 const & clr)
+	{
+		return clr;
+	}
+#endif
+
+	// Same face layout as ToDir in PrefilterCube.fxml
+	float3 ToDir(uint32_t face, float u, float v)
+	{
+		float3 dir;
+		switch (face)
+		{
+		case 0:
+			dir = float3(+1, 1 - v * 2, 1 - u * 2);
+			break;
+
+		case 1:
+			dir = float3(-1, 1 - v * 2, u * 2 - 1);
+			break;
+
+		case 2:
+			dir = float3(u * 2 - 1, +1, v * 2 - 1);
+			break;
+
+		case 3:
+			dir = float3(u * 2 - 1, -1, 1 - v * 2);
+			break;
+
+		case 4:
+			dir = float3(u * 2 - 1, 1 - v * 2, +1);
+			break;
+
+		default:
+			dir = float3(1 - u * 2, 1 - v * 2, -1);
+			break;
+		}
+		return MathLib::normalize(dir);
+	}
+
+	uint32_t ToFace(float3 const & dir, float& u, float& v)
+	{
+		float const ax = std::abs(dir.x());
+		float const ay = std::abs(dir.y());
+		float const az = std::abs(dir.z());
+
+		uint32_t face;
+		float inv_ma;
+		if ((ax >= ay) && (ax >= az))
+		{
+			inv_ma = 0.5f / ax;
+			if (dir.x() > 0)
+			{
+				face = 0;
+				u = 0.5f - dir.z() * inv_ma;
+			}
+			else
+			{
+				face = 1;
+				u = 0.5f + dir.z() * inv_ma;
+			}
+			v = 0.5f - dir.y() * inv_ma;
+		}
+		else if (ay >= az)
+		{
+			inv_ma = 0.5f / ay;
+			u = 0.5f + dir.x() * inv_ma;
+			if (dir.y() > 0)
+			{
+				face = 2;
+				v = 0.5f + dir.z() * inv_ma;
+			}
+			else
+			{
+				face = 3;
+				v = 0.5f - dir.z() * inv_ma;
+			}
+		}
+		else
+		{
+			inv_ma = 0.5f / az;
+			v = 0.5f - dir.y() * inv_ma;
+			if (dir.z() > 0)
+			{
+				face = 4;
+				u = 0.5f + dir.x() * inv_ma;
+			}
+			else
+			{
+				face = 5;
+				u = 0.5f - dir.x() * inv_ma;
+			}
+		}
+		return face;
+	}
+
+	float2 Hammersley2D(uint32_t i, uint32_t n)
+	{
+		uint32_t bits = (i << 16) | (i >> 16);
+		bits = ((bits & 0x55555555U) << 1) | ((bits & 0xAAAAAAAAU) >> 1);
+		bits = ((bits & 0x33333333U) << 2) | ((bits & 0xCCCCCCCCU) >> 2);
+		bits = ((bits & 0x0F0F0F0FU) << 4) | ((bits & 0xF0F0F0F0U) >> 4);
+		bits = ((bits & 0x00FF00FFU) << 8) | ((bits & 0xFF00FF00U) >> 8);
+		return float2(static_cast<float>(i) / n, bits * 2.3283064365386963e-10f);
+	}
+
+	// Float texels of the 6 faces, with box filtered mipmaps for filtered importance sampling
+	class CpuCube
+	{
+	public:
+		CpuCube(std::array<std::vector<float4>, 6> faces, uint32_t width)
+			: width_(width)
+		{
+			for (uint32_t face = 0; face < 6; ++ face)
+			{
+				levels_[face].push_back(std::move(faces[face]));
+
+				uint32_t w = width;
+				while (w > 1)
+				{
+					uint32_t const half_w = w / 2;
+					std::vector<float4> const & src = levels_[face].back();
+					std::vector<float4> dst(half_w * half_w);
+					for (uint32_t y = 0; y < half_w; ++ y)
+					{
+						for (uint32_t x = 0; x < half_w; ++ x)
+						{
+							dst[y * half_w + x] = (src[(y * 2 + 0) * w + x * 2 + 0] + src[(y * 2 + 0) * w + x * 2 + 1]
+								+ src[(y * 2 + 1) * w + x * 2 + 0] + src[(y * 2 + 1) * w + x * 2 + 1]) * 0.25f;
+						}
+					}
+					levels_[face].push_back(std::move(dst));
+					w = half_w;
+				}
+			}
+		}
+
+		uint32_t Width() const
+		{
+			return width_;
+		}
+
+		uint32_t NumLevels() const
+		{
+			return static_cast<uint32_t>(levels_[0].size());
+		}
+
+		std::vector<float4> const & Level(uint32_t face, uint32_t level) const
+		{
+			return levels_[face][level];
+		}
+
+		Color4 Sample(float3 const & dir, float lod) const
+		{
+			float u, v;
+			uint32_t const face = ToFace(dir, u, v);
+
+			lod = std::min(lod, static_cast<float>(this->NumLevels() - 1));
+			uint32_t const level = static_cast<uint32_t>(lod);
+			float const frac = lod - level;
+			Color4 clr = this->SampleBilinear(face, level, u, v, 1 - frac);
+			if (frac > 0)
+			{
+				clr = AddColor(clr, this->SampleBilinear(face, level + 1, u, v, frac));
+			}
+			return clr;
+		}
+
+	private:
+		// Clamps to the face edges, like the skybox_sampler of the GPU path
+		Color4 SampleBilinear(uint32_t face, uint32_t level, float u, float v, float weight) const
+		{
+			uint32_t const w = std::max(width_ >> level, 1U);
+			float const fx = MathLib::clamp(u * w - 0.5f, 0.0f, w - 1.0f);
+			float const fy = MathLib::clamp(v * w - 0.5f, 0.0f, w - 1.0f);
+			uint32_t const x0 = static_cast<uint32_t>(fx);
+			uint32_t const y0 = static_cast<uint32_t>(fy);
+			uint32_t const x1 = std::min(x0 + 1, w - 1);
+			uint32_t const y1 = std::min(y0 + 1, w - 1);
+			float const tx = fx - x0;
+			float const ty = fy - y0;
+
+			// Independent products, so the taps don't wait on each other
+			float4 const * texels = levels_[face][level].data();
+			Color4 const top = AddColor(MulColor(LoadColor(texels[y0 * w + x0]), (1 - tx) * (1 - ty) * weight),
+				MulColor(LoadColor(texels[y0 * w + x1]), tx * (1 - ty) * weight));
+			Color4 const bottom = AddColor(MulColor(LoadColor(texels[y1 * w + x0]), (1 - tx) * ty * weight),
+				MulColor(LoadColor(texels[y1 * w + x1]), tx * ty * weight));
+			return AddColor(top, bottom);
+		}
+
+	private:
+		uint32_t width_;
+		std::array<std::vector<std::vector<float4>>, 6> levels_;
+	};
+
+	struct LobeSample
+	{
+		float3 dir;
+		float weight;
+		float lod;
+	};
+
+	// The Blinn-Phong lobe of PrefilterCubeSpecularPS in tangent space, with n = v = r. Each sample reads from the source mip
+	// whose texels cover about the solid angle the sample stands for.
+	std::vector<LobeSample> SpecularLobe(float shininess, uint32_t num_samples, uint32_t src_width, bool filtered)
+	{
+		float const texel_solid_angle = 4 * PI / (6.0f * src_width * src_width);
+
+		std::vector<LobeSample> samples;
+		for (uint32_t i = 0; i < num_samples; ++ i)
+		{
+			float2 const xi = Hammersley2D(i, num_samples);
+			float const phi = 2 * PI * xi.x();
+			float const cos_theta = pow(MathLib::abs(1 - xi.y() * (shininess + 1) / (shininess + 2)), 1 / (shininess + 1));
+			float const sin_theta = MathLib::sqrt(1 - cos_theta * cos_theta);
+
+			LobeSample sample;
+			sample.dir = float3(2 * cos_theta * sin_theta * MathLib::cos(phi), 2 * cos_theta * sin_theta * MathLib::sin(phi),
+				2 * cos_theta * cos_theta - 1);
+			sample.weight = sample.dir.z();
+			if (sample.weight <= 0)
+			{
+				continue;
+			}
+
+			sample.lod = 0;
+			if (filtered)
+			{
+				float const pdf = (shininess + 2) * pow(cos_theta, shininess) / (2 * PI) / (4 * cos_theta);
+				float const sample_solid_angle = 1 / (num_samples * pdf);
+				sample.lod = std::max(0.5f * MathLib::log(sample_solid_angle / texel_solid_angle) / MathLib::log(2.0f) + 1, 0.0f);
+			}
+			samples.push_back(sample);
+		}
+
+		float total_weight = 0;
+		for (auto const & sample : samples)
+		{
+			total_weight += sample.weight;
+		}
+		for (auto& sample : samples)
+		{
+			sample.weight /= std::max(1e-6f, total_weight);
+		}
+
+		return samples;
+	}
+
+	void PrefilterSpecular(CpuCube const & cube, std::vector<LobeSample> const & lobe, uint32_t face, uint32_t width,
+		uint32_t y_begin, uint32_t y_end, float4* out)
+	{
+		for (uint32_t y = y_begin; y < y_end; ++ y)
+		{
+			for (uint32_t x = 0; x < width; ++ x)
+			{
+				float3 const normal = ToDir(face, (x + 0.5f) / width, (y + 0.5f) / width);
+				float3 const up = (MathLib::abs(normal.z()) < 0.999f) ? float3(0, 0, 1) : float3(1, 0, 0);
+				float3 const tangent = MathLib::normalize(MathLib::cross(up, normal));
+				float3 const binormal = MathLib::cross(normal, tangent);
+
+				Color4 clr = ZeroColor();
+				for (auto const & sample : lobe)
+				{
+					float3 const l = tangent * sample.dir.x() + binormal * sample.dir.y() + normal * sample.dir.z();
+					clr = MulAddColor(clr, cube.Sample(l, sample.lod), sample.weight);
+				}
+
+				float4 out_clr = StoreColor(clr);
+				out_clr.w() = 1;
+				out[y * width + x] = out_clr;
+			}
+		}
+	}
+
+	uint32_t const NUM_SH_COEFFS = 9;
+
+	struct SHCoeffs
+	{
+		Color4 coeffs[NUM_SH_COEFFS];
+	};
+
+	void SHBasis(float3 const & dir, float* basis)
+	{
+		basis[0] = 0.282095f;
+		basis[1] = 0.488603f * dir.y();
+		basis[2] = 0.488603f * dir.z();
+		basis[3] = 0.488603f * dir.x();
+		basis[4] = 1.092548f * dir.x() * dir.y();
+		basis[5] = 1.092548f * dir.y() * dir.z();
+		basis[6] = 0.315392f * (3 * dir.z() * dir.z() - 1);
+		basis[7] = 1.092548f * dir.x() * dir.z();
+		basis[8] = 0.546274f * (dir.x() * dir.x() - dir.y() * dir.y());
+	}
+
+	// Projects the radiance of one face onto the first 3 SH bands, weighting each texel by its solid angle
+	void ProjectSH(CpuCube const & cube, uint32_t face, uint32_t level, SHCoeffs& sh)
+	{
+		uint32_t const width = std::max(cube.Width() >> level, 1U);
+		std::vector<float4> const & texels = cube.Level(face, level);
+
+		for (uint32_t i = 0; i < NUM_SH_COEFFS; ++ i)
+		{
+			sh.coeffs[i] = ZeroColor();
+		}
+		for (uint32_t y = 0; y < width; ++ y)
+		{
+			for (uint32_t x = 0; x < width; ++ x)
+			{
+				float const u = (x + 0.5f) / width * 2 - 1;
+				float const v = (y + 0.5f) / width * 2 - 1;
+				float const solid_angle = 4.0f / (width * width) / pow(1 + u * u + v * v, 1.5f);
+
+				float basis[NUM_SH_COEFFS];
+				SHBasis(ToDir(face, (x + 0.5f) / width, (y + 0.5f) / width), basis);
+
+				Color4 const clr = LoadColor(texels[y * width + x]);
+				for (uint32_t i = 0; i < NUM_SH_COEFFS; ++ i)
+				{
+					sh.coeffs[i] = MulAddColor(sh.coeffs[i], clr, basis[i] * solid_angle);
+				}
+			}
+		}
+	}
+
+	// Irradiance / PI, what PrefilterCubeDiffusePS gives with the cosine weighted samples
+	void EvaluateIrradiance(SHCoeffs const & sh, uint32_t face, uint32_t width, float4* out)
+	{
+		float const band_factors[] = { 1, 2.0f / 3, 2.0f / 3, 2.0f / 3, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+
+		for (uint32_t y = 0; y < width; ++ y)
+		{
+			for (uint32_t x = 0; x < width; ++ x)
+			{
+				float basis[NUM_SH_COEFFS];
+				SHBasis(ToDir(face, (x + 0.5f) / width, (y + 0.5f) / width), basis);
+
+				Color4 clr = ZeroColor();
+				for (uint32_t i = 0; i < NUM_SH_COEFFS; ++ i)
+				{
+					clr = MulAddColor(clr, sh.coeffs[i], basis[i] * band_factors[i]);
+				}
+
+				float4 out_clr = StoreColor(clr);
+				out_clr = float4(std::max(out_clr.x(), 0.0f), std::max(out_clr.y(), 0.0f), std::max(out_clr.z(), 0.0f), 1);
+				out[y * width + x] = out_clr;
+			}
+		}
+	}
+
+	// Runs task(0) to task(num_tasks - 1) on the thread pool. Tasks are handed out one at a time, since their costs differ a lot
+	// between mips.
+	template <typename Task>
+	void ParallelForTasks(uint32_t num_tasks, Task const & task)
+	{
+		static uint32_t const num_threads = std::max(CPUInfo().NumHWThreads(), 1);
+
+		std::atomic<uint32_t> next_task(0);
+		auto worker = [&next_task, &task, num_tasks]
+			{
+				for (uint32_t i = next_task ++; i < num_tasks; i = next_task ++)
+				{
+					task(i);
+				}
+			};
+
+		auto& tp = Context::Instance().ThreadPool();
+		std::vector<joiner<void>> joiners;
+		for (uint32_t i = 1; i < std::min(num_threads, num_tasks); ++ i)
+		{
+			joiners.push_back(tp(worker));
+		}
+		worker();
+
+		for (auto& joiner : joiners)
+		{
+			joiner();
+		}
+	}
+
+	std::vector<float4> DecodeSubresource(ElementInitData const & data, ElementFormat format, uint32_t width)
+	{
+		std::vector<float4> texels(width * width);
+		ResizeTexture(texels.data(), width * sizeof(float4), width * width * sizeof(float4), EF_ABGR32F, width, width, 1,
+			data.data, data.row_pitch, data.slice_pitch, format, width, width, 1, false);
+		return texels;
+	}
+
+	bool PrefilterCubeCPU(std::string const & in_file, std::string const & out_file, uint32_t num_samples)
+	{
+		TexturePtr in_tex = LoadSoftwareTexture(in_file);
+		if (in_tex->Type() != Texture::TT_Cube)
+		{
+			cout << in_file << " is not a cube map." << endl;
+			return false;
+		}
+
+		uint32_t const in_width = in_tex->Width(0);
+		uint32_t const in_num_mipmaps = in_tex->NumMipMaps();
+		auto const & in_data = checked_cast<SoftwareTexture&>(*in_tex).SubresourceData();
+
+		std::array<std::vector<float4>, 6> faces;
+		for (uint32_t face = 0; face < 6; ++ face)
+		{
+			faces[face] = DecodeSubresource(in_data[face * in_num_mipmaps], in_tex->Format(), in_width);
+		}
+		CpuCube const cube(std::move(faces), in_width);
+
+		uint32_t const out_num_mipmaps = NumOutputMipmaps(in_width);
+		uint32_t const diffuse_level = out_num_mipmaps - 1;
+
+		std::vector<std::vector<LobeSample>> lobes(out_num_mipmaps);
+		for (uint32_t level = 1; level < diffuse_level; ++ level)
+		{
+			lobes[level] = SpecularLobe(SpecularShininess(level, out_num_mipmaps), num_samples, in_width, true);
+		}
+
+		std::vector<std::vector<float4>> out_texels(6 * out_num_mipmaps);
+		for (uint32_t face = 0; face < 6; ++ face)
+		{
+			out_texels[face * out_num_mipmaps + 0] = cube.Level(face, 0);
+			for (uint32_t level = 1; level < out_num_mipmaps; ++ level)
+			{
+				uint32_t const w = std::max(in_width >> level, 1U);
+				out_texels[face * out_num_mipmaps + level].resize(w * w);
+			}
+		}
+
+		// The irradiance only keeps 3 SH bands, so projecting a smaller mip of the source is as good as projecting mip 0
+		uint32_t sh_level = 0;
+		while ((in_width >> sh_level) > 128)
+		{
+			++ sh_level;
+		}
+		std::array<SHCoeffs, 6> face_sh;
+		ParallelForTasks(6, [&cube, &face_sh, sh_level](uint32_t face)
+			{
+				ProjectSH(cube, face, sh_level, face_sh[face]);
+			});
+		SHCoeffs sh = face_sh[0];
+		for (uint32_t face = 1; face < 6; ++ face)
+		{
+			for (uint32_t i = 0; i < NUM_SH_COEFFS; ++ i)
+			{
+				sh.coeffs[i] = AddColor(sh.coeffs[i], face_sh[face].coeffs[i]);
+			}
+		}
+
+		struct SpecularTask
+		{
+			uint32_t face;
+			uint32_t level;
+			uint32_t y_begin;
+			uint32_t y_end;
+		};
+		std::vector<SpecularTask> tasks;
+		for (uint32_t level = 1; level < diffuse_level; ++ level)
+		{
+			uint32_t const w = in_width >> level;
+			uint32_t const rows_per_task = std::max(4096 / w, 1U);
+			for (uint32_t face = 0; face < 6; ++ face)
+			{
+				for (uint32_t y = 0; y < w; y += rows_per_task)
+				{
+					tasks.push_back({ face, level, y, std::min(y + rows_per_task, w) });
+				}
+			}
+		}
+		for (uint32_t face = 0; face < 6; ++ face)
+		{
+			tasks.push_back({ face, diffuse_level, 0, 0 });
+		}
+
+		ParallelForTasks(static_cast<uint32_t>(tasks.size()),
+			[&cube, &lobes, &out_texels, &tasks, &sh, in_width, out_num_mipmaps, diffuse_level](uint32_t i)
+			{
+				SpecularTask const & task = tasks[i];
+				uint32_t const w = std::max(in_width >> task.level, 1U);
+				float4* out = out_texels[task.face * out_num_mipmaps + task.level].data();
+				if (task.level == diffuse_level)
+				{
+					EvaluateIrradiance(sh, task.face, w, out);
+				}
+				else
+				{
+					PrefilterSpecular(cube, lobes[task.level], task.face, w, task.y_begin, task.y_end, out);
+				}
+			});
+
+		std::vector<std::vector<uint8_t>> out_data_block(out_texels.size());
+		std::vector<ElementInitData> out_data(out_texels.size());
+		for (uint32_t face = 0; face < 6; ++ face)
+		{
+			for (uint32_t level = 0; level < out_num_mipmaps; ++ level)
+			{
+				uint32_t const index = face * out_num_mipmaps + level;
+				uint32_t const w = std::max(in_width >> level, 1U);
+				uint32_t const row_pitch = w * NumFormatBytes(EF_ABGR16F);
+
+				out_data_block[index].resize(row_pitch * w);
+				out_data[index].data = out_data_block[index].data();
+				out_data[index].row_pitch = row_pitch;
+				out_data[index].slice_pitch = row_pitch * w;
+
+				ResizeTexture(out_data_block[index].data(), row_pitch, row_pitch * w, EF_ABGR16F, w, w, 1,
+					out_texels[index].data(), w * sizeof(float4), w * w * sizeof(float4), EF_ABGR32F, w, w, 1, false);
+			}
+		}
+
+		TexturePtr out_tex = MakeSharedPtr<SoftwareTexture>(Texture::TT_Cube, in_width, in_width, 1, out_num_mipmaps, 1,
+			EF_ABGR16F, true);
+		out_tex->CreateHWResource(out_data, nullptr);
+		SaveTexture(out_tex, out_file);
+
+		return true;
+	}
+
+	// Prints the error of each mip against a reference, e.g. the output of the other path
+	void CompareCubes(std::string const & file, std::string const & ref_file)
+	{
+		TexturePtr tex = LoadSoftwareTexture(file);
+		TexturePtr ref_tex = LoadSoftwareTexture(ref_file);
+		if ((ref_tex->Type() != Texture::TT_Cube) || (ref_tex->Width(0) != tex->Width(0))
+			|| (ref_tex->NumMipMaps() != tex->NumMipMaps()))
+		{
+			cout << ref_file << " doesn't have the same layout as " << file << '.' << endl;
+			return;
+		}
+
+		uint32_t const num_mipmaps = tex->NumMipMaps();
+		auto const & data = checked_cast<SoftwareTexture&>(*tex).SubresourceData();
+		auto const & ref_data = checked_cast<SoftwareTexture&>(*ref_tex).SubresourceData();
+		for (uint32_t level = 0; level < num_mipmaps; ++ level)
+		{
+			uint32_t const w = tex->Width(level);
+
+			double sum_sq_error = 0;
+			double sum_sq_ref = 0;
+			float max_error = 0;
+			for (uint32_t face = 0; face < 6; ++ face)
+			{
+				uint32_t const index = face * num_mipmaps + level;
+				std::vector<float4> const texels = DecodeSubresource(data[index], tex->Format(), w);
+				std::vector<float4> const ref_texels = DecodeSubresource(ref_data[index], ref_tex->Format(), w);
+				for (size_t i = 0; i < texels.size(); ++ i)
+				{
+					for (uint32_t c = 0; c < 3; ++ c)
+					{
+						float const error = texels[i][c] - ref_texels[i][c];
+						sum_sq_error += error * error;
+						sum_sq_ref += ref_texels[i][c] * ref_texels[i][c];
+						max_error = std::max(max_error, std::abs(error));
+					}
+				}
+			}
+
+			cout << "Mip " << level << " (" << w << 'x' << w << "): relative RMSE "
+				<< std::sqrt(sum_sq_error / std::max(sum_sq_ref, 1e-12)) << ", max error " << max_error << endl;
+		}
+	}
 }
 
 class PrefilterCubeApp : public KlayGE::App3DFramework
@@ -94,43 +740,94 @@ public:
 
 int main(int argc, char* argv[])
 {
-	Context::Instance().LoadCfg("KlayGE.cfg");
-	ContextCfg context_cfg = Context::Instance().Config();
-	context_cfg.graphics_cfg.hide_win = true;
-	context_cfg.graphics_cfg.hdr = false;
-	context_cfg.graphics_cfg.color_grading = false;
-	context_cfg.graphics_cfg.gamma = false;
-	Context::Instance().Config(context_cfg);
+	std::string input;
+	std::string output;
+	std::string reference;
+	bool cpu = false;
+	uint32_t num_samples = 128;
 
-	PrefilterCubeApp app;
-	app.Create();
+	cxxopts::Options options("PrefilterCube", "KlayGE Cube Map Prefilter");
+	options.add_options()
+		("H,help", "Produce help message.")
+		("I,input-path", "Input cube map path.", cxxopts::value<std::string>())
+		("O,output-path", "(Optional) Output cube map path. xxx_filtered.dds by default.", cxxopts::value<std::string>())
+		("cpu", "Filter on the CPU. No GPU is needed.")
+		("samples", "(Optional) Specular samples per texel on the CPU. 128 by default.", cxxopts::value<uint32_t>())
+		("compare", "(Optional) Print the error of each mip against this cube map, e.g. the output of the GPU.",
+			cxxopts::value<std::string>());
+	options.parse_positional({ "input-path", "output-path" });
 
-	using namespace KlayGE;
+	int const argc_backup = argc;
+	auto vm = options.parse(argc, argv);
 
-	if (argc < 2)
+	if ((argc_backup <= 1) || (vm.count("help") > 0) || (vm.count("input-path") == 0))
 	{
-		cout << "Usage: PrefilterCube xxx.dds [xxx_filtered.dds]" << endl;
+		cout << "Usage: PrefilterCube xxx.dds [xxx_filtered.dds] [--cpu] [--samples 128] [--compare ref.dds]" << endl;
+		cout << options.help() << endl;
 		return 1;
 	}
 
-	std::string input(argv[1]);
-	std::string output;
-	if (argc >= 3)
+	input = vm["input-path"].as<std::string>();
+	if (vm.count("output-path") > 0)
 	{
-		output = argv[2];
+		output = vm["output-path"].as<std::string>();
 	}
 	else
 	{
-		filesystem::path output_path(argv[1]);
+		filesystem::path output_path(input);
 		output = output_path.stem().string() + "_filtered.dds";
 	}
+	if (vm.count("compare") > 0)
+	{
+		reference = vm["compare"].as<std::string>();
+	}
+	cpu = (vm.count("cpu") > 0);
+	if (vm.count("samples") > 0)
+	{
+		num_samples = std::max(vm["samples"].as<uint32_t>(), 1U);
+	}
+
+	std::unique_ptr<PrefilterCubeApp> app;
+	if (!cpu)
+	{
+		Context::Instance().LoadCfg("KlayGE.cfg");
+		ContextCfg context_cfg = Context::Instance().Config();
+		context_cfg.graphics_cfg.hide_win = true;
+		context_cfg.graphics_cfg.hdr = false;
+		context_cfg.graphics_cfg.color_grading = false;
+		context_cfg.graphics_cfg.gamma = false;
+		Context::Instance().Config(context_cfg);
+
+		app = MakeUniquePtr<PrefilterCubeApp>();
+		app->Create();
+	}
 
 	Timer timer;
 
-	PrefilterCubeGPU(input, output);
+	if (cpu)
+	{
+		if (!PrefilterCubeCPU(input, output, num_samples))
+		{
+			return 1;
+		}
+	}
+	else
+	{
+		PrefilterCubeGPU(input, output);
+	}
 
 	cout << timer.elapsed() << " s" << endl;
 	cout << "Filtered cube map is saved into " << output << endl;
 
+	if (!reference.empty())
+	{
+		CompareCubes(output, reference);
+	}
+
+	if (cpu)
+	{
+		Context::Destroy();
+	}
+
 	return 0;
 }
@@ -33,9 +33,9 @@
 
 #pragma once
 
+#include <memory>
 #include <vector>
 #include <istream>
-#include <unordered_map>
 
 #ifndef KFONT_SOURCE
 	#define KLAYGE_LIB_NAME kfont
@@ -69,6 +69,12 @@ namespace KlayGE
 	#pragma pack(pop)
 #endif
 
+	// Since version 3, a kfont file is laid out to be used in place:
+	//   kfont_header
+	//   char_entry[validate_chars] at start_ptr, sorted by code point
+	//   glyph_entry[non_empty_chars], right after the char entries
+	//   LZMA distance data, starting at the next page boundary. glyph_entry::offset is relative to it.
+	// All the fields are little endian.
 	class KFONT_API KFont
 	{
 	public:
@@ -82,16 +88,30 @@ namespace KlayGE
 			uint16_t width;
 			uint16_t height;
 		};
+
+		struct char_entry
+		{
+			int32_t ch;
+			int32_t index;
+			uint32_t advance;
+		};
+
+		struct glyph_entry
+		{
+			font_info info;
+			uint32_t offset;
+			uint32_t size;
+		};
 #ifdef KLAYGE_HAS_STRUCT_PACK
 	#pragma pack(pop)
 #endif
 
 	public:
-		KFont()
-			: distances_addr_(1, 0)
-		{
-		}
-		
+		KFont();
+
+		// Loading from a file name memory maps the file, so a version 3 font takes no time to parse and only
+		// the touched pages become resident. Loading from a stream keeps the tables in memory and reads the
+		// distance data on demand.
 		bool Load(std::string const & file_name);
 		bool Load(ResIdentifierPtr const & kfont_input);
 		bool Save(std::string const & file_name);
@@ -100,29 +120,58 @@ namespace KlayGE
 		int16_t DistBase() const;
 		int16_t DistScale() const;
 
-		std::pair<int32_t, uint32_t> const & CharIndexAdvance(wchar_t ch) const;
+		std::pair<int32_t, uint32_t> CharIndexAdvance(wchar_t ch) const;
 		int32_t CharIndex(wchar_t ch) const;
 		uint32_t CharAdvance(wchar_t ch) const;
 
 		font_info const & CharInfo(int32_t index) const;
+		// Not thread safe when the font is loaded from a stream, since the stream is shared
 		void GetDistanceData(uint8_t* p, uint32_t pitch, int32_t index) const;
 		void GetLZMADistanceData(uint8_t* p, uint32_t& size, int32_t index) const;
 
+		bool Mapped() const
+		{
+			return mapped_file_ != nullptr;
+		}
+		// Memory held by the font: the heap tables, plus the pages of the mapped file that are in physical memory
+		size_t ResidentSize() const;
+
 		void CharSize(uint32_t size);
 		void DistBase(int16_t base);
 		void DistScale(int16_t scale);
 		void SetDistanceData(wchar_t ch, uint8_t const * p, uint32_t adv, font_info const & fi);
 		void SetLZMADistanceData(wchar_t ch, uint8_t const * p, uint32_t size, uint32_t adv, font_info const & fi);
+		// Sorts the characters added by Set*DistanceData. Has to be called before querying them.
 		void Compact();
 
+	private:
+		void Reset();
+		bool LoadFromMemory(uint8_t const * data, size_t size);
+		bool LoadV2(ResIdentifierPtr const & kfont_input, kfont_header const & header);
+		bool LoadV3(ResIdentifierPtr const & kfont_input, kfont_header const & header);
+		void UseOwnedTables();
+		void MakeOwned();
+
 	private:
 		uint32_t char_size_;
 		int16_t dist_base_;
 		int16_t dist_scale_;
-		std::unordered_map<int32_t, std::pair<int32_t, uint32_t>> char_index_advance_;
-		std::vector<font_info> char_info_;
-		std::vector<size_t> distances_addr_;
-		std::vector<uint8_t> distances_lzma_;
+
+		// Point into the mapped file, or into the owned vectors below
+		char_entry const * char_entries_;
+		uint32_t num_chars_;
+		glyph_entry const * glyph_entries_;
+		uint32_t num_glyphs_;
+		// nullptr if the distance data is read from kfont_input_ on demand
+		uint8_t const * distances_lzma_;
+
+		std::vector<char_entry> owned_char_entries_;
+		std::vector<glyph_entry> owned_glyph_entries_;
+		std::vector<uint8_t> owned_distances_lzma_;
+		bool sorted_;
+
+		std::shared_ptr<void> mapped_file_;
+		size_t mapped_size_;
 		ResIdentifierPtr kfont_input_;
 		int64_t distances_lzma_start_;
 	};
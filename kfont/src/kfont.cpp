@@ -29,6 +29,7 @@
  */
 
 #include <KFL/KFL.hpp>
+#include <KFL/CXX2a/endian.hpp>
 #include <KFL/DllLoader.hpp>
 #include <KFL/Thread.hpp>
 #include <KFL/ResIdentifier.hpp>
@@ -38,13 +39,23 @@
 #include <cstring>
 #include <algorithm>
 
+#if defined(KLAYGE_PLATFORM_WINDOWS_DESKTOP)
+	#include <windows.h>
+	#include <psapi.h>
+#elif defined(KLAYGE_PLATFORM_LINUX) || defined(KLAYGE_PLATFORM_DARWIN)
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 #include <boost/assert.hpp>
 
 #include <C/LzmaLib.h>
 
 namespace KlayGE
 {
-	uint32_t const KFONT_VERSION = 2;
+	uint32_t const KFONT_VERSION = 3;
 
 	std::mutex singleton_mutex;
 
@@ -115,9 +126,247 @@ namespace KlayGE
 		static std::shared_ptr<LZMALoader> instance_;
 	};
 	std::shared_ptr<LZMALoader> LZMALoader::instance_;
+}
+
+namespace
+{
+	using namespace KlayGE;
+
+	uint32_t const KFONT_PAGE_SIZE = 4096;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	uint32_t CharTableStart()
+	{
+		return static_cast<uint32_t>(AlignUp(sizeof(kfont_header), 16));
+	}
+
+	uint64_t DistancesStart(uint32_t start_ptr, uint32_t num_chars, uint32_t num_glyphs)
+	{
+		return AlignUp(start_ptr + num_chars * sizeof(KFont::char_entry) + num_glyphs * sizeof(KFont::glyph_entry),
+			KFONT_PAGE_SIZE);
+	}
+
+	void LE2NativeHeader(kfont_header& header)
+	{
+		header.fourcc = LE2Native(header.fourcc);
+		header.version = LE2Native(header.version);
+		header.start_ptr = LE2Native(header.start_ptr);
+		header.validate_chars = LE2Native(header.validate_chars);
+		header.non_empty_chars = LE2Native(header.non_empty_chars);
+		header.char_size = LE2Native(header.char_size);
+		header.base = LE2Native(header.base);
+		header.scale = LE2Native(header.scale);
+	}
+
+	KFont::char_entry LE2Native(KFont::char_entry ce)
+	{
+		ce.ch = KlayGE::LE2Native(ce.ch);
+		ce.index = KlayGE::LE2Native(ce.index);
+		ce.advance = KlayGE::LE2Native(ce.advance);
+		return ce;
+	}
+
+	KFont::glyph_entry LE2Native(KFont::glyph_entry ge)
+	{
+		ge.info.top = KlayGE::LE2Native(ge.info.top);
+		ge.info.left = KlayGE::LE2Native(ge.info.left);
+		ge.info.width = KlayGE::LE2Native(ge.info.width);
+		ge.info.height = KlayGE::LE2Native(ge.info.height);
+		ge.offset = KlayGE::LE2Native(ge.offset);
+		ge.size = KlayGE::LE2Native(ge.size);
+		return ge;
+	}
+
+	std::shared_ptr<void> MapFile(std::string const & file_name, uint8_t const *& data, size_t& size)
+	{
+#if defined(KLAYGE_PLATFORM_WINDOWS_DESKTOP)
+		std::wstring wname;
+		Convert(wname, file_name);
+		HANDLE file = ::CreateFileW(wname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (INVALID_HANDLE_VALUE == file)
+		{
+			return std::shared_ptr<void>();
+		}
+
+		LARGE_INTEGER file_size;
+		HANDLE mapping = nullptr;
+		if (::GetFileSizeEx(file, &file_size) && (file_size.QuadPart > 0))
+		{
+			mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		}
+		::CloseHandle(file);
+		if (nullptr == mapping)
+		{
+			return std::shared_ptr<void>();
+		}
+
+		void* view = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		::CloseHandle(mapping);
+		if (nullptr == view)
+		{
+			return std::shared_ptr<void>();
+		}
+
+		data = static_cast<uint8_t const *>(view);
+		size = static_cast<size_t>(file_size.QuadPart);
+		return std::shared_ptr<void>(view, [](void* p) { ::UnmapViewOfFile(p); });
+#elif defined(KLAYGE_PLATFORM_LINUX) || defined(KLAYGE_PLATFORM_DARWIN)
+		int fd = ::open(file_name.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			return std::shared_ptr<void>();
+		}
+
+		struct stat st;
+		void* view = MAP_FAILED;
+		if ((0 == ::fstat(fd, &st)) && (st.st_size > 0))
+		{
+			view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		::close(fd);
+		if (MAP_FAILED == view)
+		{
+			return std::shared_ptr<void>();
+		}
+
+		data = static_cast<uint8_t const *>(view);
+		size = static_cast<size_t>(st.st_size);
+		return std::shared_ptr<void>(view, [size](void* p) { ::munmap(p, size); });
+#else
+		KFL_UNUSED(file_name);
+		KFL_UNUSED(data);
+		KFL_UNUSED(size);
+		return std::shared_ptr<void>();
+#endif
+	}
+
+	// Bytes of a mapped view that are in physical memory. Pages of the file that are never touched don't count.
+	size_t ResidentMappedSize(void const * view, size_t size)
+	{
+#if defined(KLAYGE_PLATFORM_WINDOWS_DESKTOP)
+		SYSTEM_INFO si;
+		::GetSystemInfo(&si);
+		size_t const page_size = si.dwPageSize;
+		size_t const num_pages = (size + page_size - 1) / page_size;
+
+		std::vector<PSAPI_WORKING_SET_EX_INFORMATION> infos(num_pages);
+		for (size_t i = 0; i < num_pages; ++ i)
+		{
+			infos[i].VirtualAddress = static_cast<uint8_t*>(const_cast<void*>(view)) + i * page_size;
+		}
+		if (!::QueryWorkingSetEx(::GetCurrentProcess(), infos.data(),
+			static_cast<DWORD>(infos.size() * sizeof(infos[0]))))
+		{
+			return 0;
+		}
+
+		size_t num_resident = 0;
+		for (auto const & info : infos)
+		{
+			if (info.VirtualAttributes.Valid)
+			{
+				++ num_resident;
+			}
+		}
+		return std::min(num_resident * page_size, size);
+#elif defined(KLAYGE_PLATFORM_LINUX) || defined(KLAYGE_PLATFORM_DARWIN)
+		size_t const page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+		size_t const num_pages = (size + page_size - 1) / page_size;
+
+#if defined(KLAYGE_PLATFORM_DARWIN)
+		std::vector<char> vec(num_pages);
+#else
+		std::vector<unsigned char> vec(num_pages);
+#endif
+		if (::mincore(const_cast<void*>(view), size, vec.data()) != 0)
+		{
+			return 0;
+		}
+
+		size_t num_resident = 0;
+		for (auto const v : vec)
+		{
+			if (v & 1)
+			{
+				++ num_resident;
+			}
+		}
+		return std::min(num_resident * page_size, size);
+#else
+		KFL_UNUSED(view);
+		KFL_UNUSED(size);
+		return 0;
+#endif
+	}
+}
+
+namespace KlayGE
+{
+	KFont::KFont()
+	{
+		this->Reset();
+	}
+
+	void KFont::Reset()
+	{
+		char_size_ = 0;
+		dist_base_ = 0;
+		dist_scale_ = 0;
+
+		owned_char_entries_.clear();
+		owned_glyph_entries_.clear();
+		owned_distances_lzma_.clear();
+		sorted_ = true;
+		this->UseOwnedTables();
+
+		mapped_file_.reset();
+		mapped_size_ = 0;
+		kfont_input_.reset();
+		distances_lzma_start_ = 0;
+	}
+
+	void KFont::UseOwnedTables()
+	{
+		char_entries_ = owned_char_entries_.data();
+		num_chars_ = static_cast<uint32_t>(owned_char_entries_.size());
+		glyph_entries_ = owned_glyph_entries_.data();
+		num_glyphs_ = static_cast<uint32_t>(owned_glyph_entries_.size());
+		distances_lzma_ = owned_distances_lzma_.data();
+	}
 
 	bool KFont::Load(std::string const & file_name)
 	{
+		uint8_t const * data = nullptr;
+		size_t size = 0;
+		auto mapped_file = MapFile(file_name, data, size);
+		if (mapped_file)
+		{
+			kfont_header header;
+			if (size >= sizeof(header))
+			{
+				std::memcpy(&header, data, sizeof(header));
+				LE2NativeHeader(header);
+				if ((MakeFourCC<'K', 'F', 'N', 'T'>::value == header.fourcc) && (KFONT_VERSION == header.version))
+				{
+					this->Reset();
+					mapped_file_ = mapped_file;
+					mapped_size_ = size;
+					if (this->LoadFromMemory(data, size))
+					{
+						return true;
+					}
+					this->Reset();
+					return false;
+				}
+			}
+		}
+
+		// Older versions, or mapping is not available on this platform
 		ResIdentifierPtr kfont_input = MakeSharedPtr<ResIdentifier>(file_name, 0,
 			MakeSharedPtr<std::ifstream>(file_name.c_str(), std::ios_base::binary | std::ios_base::in));
 		return this->Load(kfont_input);
@@ -125,94 +374,186 @@ namespace KlayGE
 
 	bool KFont::Load(ResIdentifierPtr const & kfont_input)
 	{
+		this->Reset();
+
 		if (kfont_input)
 		{
-			kfont_input_ = kfont_input;
-
 			kfont_header header;
 			kfont_input->read(&header, sizeof(header));
-			header.fourcc = LE2Native(header.fourcc);
-			header.version = LE2Native(header.version);
-			header.start_ptr = LE2Native(header.start_ptr);
-			header.validate_chars = LE2Native(header.validate_chars);
-			header.non_empty_chars = LE2Native(header.non_empty_chars);
-			header.char_size = LE2Native(header.char_size);
-			header.base = LE2Native(header.base);
-			header.scale = LE2Native(header.scale);
-			if ((MakeFourCC<'K', 'F', 'N', 'T'>::value == header.fourcc) && (KFONT_VERSION == header.version))
+			LE2NativeHeader(header);
+			if (MakeFourCC<'K', 'F', 'N', 'T'>::value == header.fourcc)
 			{
-				char_size_ = header.char_size;
-				dist_base_ = header.base;
-				dist_scale_ = header.scale;
-
-				kfont_input->seekg(header.start_ptr, std::ios_base::beg);
-
-				std::vector<std::pair<int32_t, int32_t>> temp_char_index(header.non_empty_chars);
-				kfont_input->read(&temp_char_index[0], temp_char_index.size() * sizeof(temp_char_index[0]));
-				std::vector<std::pair<int32_t, uint32_t>> temp_char_advance(header.validate_chars);
-				kfont_input->read(&temp_char_advance[0], temp_char_advance.size() * sizeof(temp_char_advance[0]));
-
-				for (auto& ci : temp_char_index)
+				bool ret = false;
+				if (2 == header.version)
 				{
-					ci.first = LE2Native(ci.first);
-					ci.second = LE2Native(ci.second);
-
-					char_index_advance_.emplace(ci.first, std::make_pair(ci.second, 0));
+					ret = this->LoadV2(kfont_input, header);
 				}
-				for (auto& ca : temp_char_advance)
+				else if (KFONT_VERSION == header.version)
 				{
-					ca.first = LE2Native(ca.first);
-					ca.second = LE2Native(ca.second);
-
-					auto iter = char_index_advance_.find(ca.first);
-					if (iter != char_index_advance_.end())
-					{
-						iter->second.second = ca.second;
-					}
-					else
-					{
-						char_index_advance_[ca.first] = std::make_pair(-1, ca.second);
-					}
+					ret = this->LoadV3(kfont_input, header);
 				}
 
-				char_info_.resize(header.non_empty_chars);
-				kfont_input->read(&char_info_[0], char_info_.size() * sizeof(char_info_[0]));
-
-				for (auto& ci : char_info_)
+				if (ret)
 				{
-					ci.left = LE2Native(ci.left);
-					ci.top = LE2Native(ci.top);
-					ci.width = LE2Native(ci.width);
-					ci.height = LE2Native(ci.height);
+					return true;
 				}
+				this->Reset();
+			}
+		}
 
-				distances_addr_.resize(header.non_empty_chars + 1);
-				distances_lzma_start_ = kfont_input->tellg();
-				size_t distances_lzma_size = 0;
+		return false;
+	}
 
-				for (uint32_t i = 0; i < header.non_empty_chars; ++ i)
-				{
-					distances_addr_[i] = distances_lzma_size;
+	bool KFont::LoadFromMemory(uint8_t const * data, size_t size)
+	{
+		kfont_header header;
+		std::memcpy(&header, data, sizeof(header));
+		LE2NativeHeader(header);
 
-					uint64_t len;
-					kfont_input->read(&len, sizeof(len));
-					len = LE2Native(len);
-					distances_lzma_size += static_cast<size_t>(len);
+		char_size_ = header.char_size;
+		dist_base_ = header.base;
+		dist_scale_ = header.scale;
 
-					kfont_input->seekg(len, std::ios_base::cur);
-				}
+		uint64_t const lzma_start = DistancesStart(header.start_ptr, header.validate_chars, header.non_empty_chars);
+		if (lzma_start > size)
+		{
+			return false;
+		}
 
-				distances_addr_[header.non_empty_chars] = distances_lzma_size;
+		KLAYGE_IF_CONSTEXPR (std::endian::native == std::endian::little)
+		{
+			// Used in place. Only the pages that are touched get loaded.
+			char_entries_ = reinterpret_cast<char_entry const *>(data + header.start_ptr);
+			num_chars_ = header.validate_chars;
+			glyph_entries_ = reinterpret_cast<glyph_entry const *>(char_entries_ + num_chars_);
+			num_glyphs_ = header.non_empty_chars;
+		}
+		else
+		{
+			char_entry const * ces = reinterpret_cast<char_entry const *>(data + header.start_ptr);
+			glyph_entry const * ges = reinterpret_cast<glyph_entry const *>(ces + header.validate_chars);
+			owned_char_entries_.resize(header.validate_chars);
+			for (uint32_t i = 0; i < header.validate_chars; ++ i)
+			{
+				owned_char_entries_[i] = LE2Native(ces[i]);
+			}
+			owned_glyph_entries_.resize(header.non_empty_chars);
+			for (uint32_t i = 0; i < header.non_empty_chars; ++ i)
+			{
+				owned_glyph_entries_[i] = LE2Native(ges[i]);
+			}
+			this->UseOwnedTables();
+		}
+		distances_lzma_ = data + lzma_start;
+
+		return (0 == num_glyphs_)
+			|| (lzma_start + glyph_entries_[num_glyphs_ - 1].offset + glyph_entries_[num_glyphs_ - 1].size <= size);
+	}
+
+	bool KFont::LoadV2(ResIdentifierPtr const & kfont_input, kfont_header const & header)
+	{
+		kfont_input_ = kfont_input;
+
+		char_size_ = header.char_size;
+		dist_base_ = header.base;
+		dist_scale_ = header.scale;
 
-				return true;
+		kfont_input->seekg(header.start_ptr, std::ios_base::beg);
+
+		std::vector<std::pair<int32_t, int32_t>> temp_char_index(header.non_empty_chars);
+		kfont_input->read(temp_char_index.data(), temp_char_index.size() * sizeof(temp_char_index[0]));
+		std::vector<std::pair<int32_t, uint32_t>> temp_char_advance(header.validate_chars);
+		kfont_input->read(temp_char_advance.data(), temp_char_advance.size() * sizeof(temp_char_advance[0]));
+
+		// Both tables are sorted by code point, so they can be merged
+		owned_char_entries_.reserve(header.validate_chars);
+		size_t ci = 0;
+		for (auto const & ca : temp_char_advance)
+		{
+			char_entry ce;
+			ce.ch = LE2Native(ca.first);
+			ce.index = -1;
+			ce.advance = LE2Native(ca.second);
+			while ((ci < temp_char_index.size()) && (LE2Native(temp_char_index[ci].first) < ce.ch))
+			{
+				++ ci;
+			}
+			if ((ci < temp_char_index.size()) && (LE2Native(temp_char_index[ci].first) == ce.ch))
+			{
+				ce.index = LE2Native(temp_char_index[ci].second);
 			}
+			owned_char_entries_.push_back(ce);
 		}
 
-		return false;
+		owned_glyph_entries_.resize(header.non_empty_chars);
+		for (auto& ge : owned_glyph_entries_)
+		{
+			kfont_input->read(&ge.info, sizeof(ge.info));
+			ge.info.top = LE2Native(ge.info.top);
+			ge.info.left = LE2Native(ge.info.left);
+			ge.info.width = LE2Native(ge.info.width);
+			ge.info.height = LE2Native(ge.info.height);
+		}
+
+		// Each glyph's data is prefixed with its 64-bit length
+		distances_lzma_start_ = kfont_input->tellg();
+		uint64_t offset = 0;
+		for (auto& ge : owned_glyph_entries_)
+		{
+			uint64_t len;
+			kfont_input->read(&len, sizeof(len));
+			len = LE2Native(len);
+
+			ge.offset = static_cast<uint32_t>(offset + sizeof(len));
+			ge.size = static_cast<uint32_t>(len);
+			offset += sizeof(len) + len;
+
+			kfont_input->seekg(len, std::ios_base::cur);
+		}
+
+		this->UseOwnedTables();
+		distances_lzma_ = nullptr;
+
+		return !!*kfont_input;
+	}
+
+	bool KFont::LoadV3(ResIdentifierPtr const & kfont_input, kfont_header const & header)
+	{
+		kfont_input_ = kfont_input;
+
+		char_size_ = header.char_size;
+		dist_base_ = header.base;
+		dist_scale_ = header.scale;
+
+		kfont_input->seekg(header.start_ptr, std::ios_base::beg);
+
+		owned_char_entries_.resize(header.validate_chars);
+		kfont_input->read(owned_char_entries_.data(), owned_char_entries_.size() * sizeof(owned_char_entries_[0]));
+		for (auto& ce : owned_char_entries_)
+		{
+			ce = LE2Native(ce);
+		}
+
+		owned_glyph_entries_.resize(header.non_empty_chars);
+		kfont_input->read(owned_glyph_entries_.data(), owned_glyph_entries_.size() * sizeof(owned_glyph_entries_[0]));
+		for (auto& ge : owned_glyph_entries_)
+		{
+			ge = LE2Native(ge);
+		}
+
+		distances_lzma_start_ = static_cast<int64_t>(DistancesStart(header.start_ptr, header.validate_chars, header.non_empty_chars));
+
+		this->UseOwnedTables();
+		distances_lzma_ = nullptr;
+
+		return !!*kfont_input;
 	}
 
 	bool KFont::Save(std::string const & file_name)
 	{
+		// The output could be the file this font is mapped from or streamed from
+		this->MakeOwned();
+
 		std::ofstream kfont_output(file_name.c_str(), std::ios_base::binary | std::ios_base::out);
 		if (kfont_output)
 		{
@@ -221,72 +562,52 @@ namespace KlayGE
 			kfont_header header;
 			header.fourcc = Native2LE(MakeFourCC<'K', 'F', 'N', 'T'>::value);
 			header.version = Native2LE(KFONT_VERSION);
-			header.start_ptr = Native2LE(static_cast<uint32_t>(sizeof(header)));
-			header.validate_chars = Native2LE(static_cast<uint32_t>(char_index_advance_.size()));
-			header.non_empty_chars = Native2LE(static_cast<uint32_t>(char_info_.size()));
+			header.start_ptr = Native2LE(CharTableStart());
+			header.validate_chars = Native2LE(num_chars_);
+			header.non_empty_chars = Native2LE(num_glyphs_);
 			header.char_size = Native2LE(char_size_);
 			header.base = Native2LE(dist_base_);
 			header.scale = Native2LE(dist_scale_);
-
 			kfont_output.write(reinterpret_cast<char*>(&header), sizeof(header));
 
-			std::vector<int32_t> chars;
-			for (auto const & cia : char_index_advance_)
-			{
-				chars.push_back(cia.first);
-			}
-			std::sort(chars.begin(), chars.end());
+			std::vector<char> padding(CharTableStart() - sizeof(header), 0);
+			kfont_output.write(padding.data(), padding.size());
 
-			std::vector<std::pair<int32_t, int32_t>> temp_char_index;
-			std::vector<std::pair<int32_t, uint32_t>> temp_char_advance;
-			for (auto const & ch : chars)
+			for (uint32_t i = 0; i < num_chars_; ++ i)
 			{
-				std::pair<int32_t, uint32_t> const & ci = char_index_advance_[ch];
-
-				if (ci.first != -1)
-				{
-					temp_char_index.push_back(std::make_pair(ch, ci.first));
-				}
-				temp_char_advance.push_back(std::make_pair(ch, ci.second));
+				char_entry ce;
+				ce.ch = Native2LE(char_entries_[i].ch);
+				ce.index = Native2LE(char_entries_[i].index);
+				ce.advance = Native2LE(char_entries_[i].advance);
+				kfont_output.write(reinterpret_cast<char*>(&ce), sizeof(ce));
 			}
-			BOOST_ASSERT(temp_char_index.size() == char_info_.size());
-			BOOST_ASSERT(temp_char_advance.size() == char_index_advance_.size());
 
-			for (auto const & ci : temp_char_index)
+			uint32_t offset = 0;
+			for (uint32_t i = 0; i < num_glyphs_; ++ i)
 			{
-				auto tci = std::make_pair(Native2LE(ci.first), Native2LE(ci.second));
-				kfont_output.write(reinterpret_cast<char*>(&tci), sizeof(tci));
-			}
-			for (auto const & ca : temp_char_advance)
-			{
-				auto tca = std::make_pair(Native2LE(ca.first), Native2LE(ca.second));
-				kfont_output.write(reinterpret_cast<char*>(&tca), sizeof(tca));
+				glyph_entry ge;
+				ge.info.top = Native2LE(glyph_entries_[i].info.top);
+				ge.info.left = Native2LE(glyph_entries_[i].info.left);
+				ge.info.width = Native2LE(glyph_entries_[i].info.width);
+				ge.info.height = Native2LE(glyph_entries_[i].info.height);
+				ge.offset = Native2LE(offset);
+				ge.size = Native2LE(glyph_entries_[i].size);
+				kfont_output.write(reinterpret_cast<char*>(&ge), sizeof(ge));
+
+				offset += glyph_entries_[i].size;
 			}
 
-			for (auto const & ci : temp_char_index)
-			{
-				int const index = ci.second;
-
-				int16_t tmp;
-				tmp = Native2LE(char_info_[index].top);
-				kfont_output.write(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-				tmp = Native2LE(char_info_[index].left);
-				kfont_output.write(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-				tmp = Native2LE(char_info_[index].width);
-				kfont_output.write(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-				tmp = Native2LE(char_info_[index].height);
-				kfont_output.write(reinterpret_cast<char*>(&tmp), sizeof(tmp));
-			}
+			uint64_t const lzma_start = DistancesStart(CharTableStart(), num_chars_, num_glyphs_);
+			padding.assign(static_cast<size_t>(lzma_start - kfont_output.tellp()), 0);
+			kfont_output.write(padding.data(), padding.size());
 
-			for (auto const & ci : temp_char_index)
+			for (uint32_t i = 0; i < num_glyphs_; ++ i)
 			{
-				uint32_t index = ci.second;
-				size_t addr = distances_addr_[index];
-				uint64_t len = distances_addr_[index + 1] - addr;
-				uint64_t len_le = Native2LE(len);
-				kfont_output.write(reinterpret_cast<char*>(&len_le), sizeof(len_le));
-				kfont_output.write(reinterpret_cast<char*>(&distances_lzma_[addr]),
-					static_cast<std::streamsize>(len * sizeof(distances_lzma_[0])));
+				uint32_t size;
+				this->GetLZMADistanceData(nullptr, size, i);
+				std::vector<uint8_t> data(size);
+				this->GetLZMADistanceData(data.data(), size, i);
+				kfont_output.write(reinterpret_cast<char*>(data.data()), size);
 			}
 
 			return true;
@@ -310,17 +631,21 @@ namespace KlayGE
 		return dist_scale_;
 	}
 
-	std::pair<int32_t, uint32_t> const & KFont::CharIndexAdvance(wchar_t ch) const
+	std::pair<int32_t, uint32_t> KFont::CharIndexAdvance(wchar_t ch) const
 	{
-		auto iter = char_index_advance_.find(ch);
-		if (iter != char_index_advance_.end())
+		BOOST_ASSERT(sorted_);
+
+		int32_t const code = static_cast<int32_t>(ch);
+		auto const * end = char_entries_ + num_chars_;
+		auto const * iter = std::lower_bound(char_entries_, end, code,
+			[](char_entry const & lhs, int32_t rhs) { return lhs.ch < rhs; });
+		if ((iter != end) && (iter->ch == code))
 		{
-			return iter->second;
+			return std::make_pair(iter->index, iter->advance);
 		}
 		else
 		{
-			static std::pair<int32_t, uint32_t> ret(-1, 0);
-			return ret;
+			return std::make_pair(-1, 0U);
 		}
 	}
 
@@ -336,7 +661,8 @@ namespace KlayGE
 
 	KFont::font_info const & KFont::CharInfo(int32_t index) const
 	{
-		return char_info_[index];
+		BOOST_ASSERT(static_cast<uint32_t>(index) < num_glyphs_);
+		return glyph_entries_[index].info;
 	}
 
 	void KFont::GetDistanceData(uint8_t* p, uint32_t pitch, int32_t index) const
@@ -366,22 +692,36 @@ namespace KlayGE
 
 	void KFont::GetLZMADistanceData(uint8_t* p, uint32_t& size, int32_t index) const
 	{
-		size = static_cast<uint32_t>(distances_addr_[index + 1] - distances_addr_[index]);
+		BOOST_ASSERT(static_cast<uint32_t>(index) < num_glyphs_);
+
+		glyph_entry const & ge = glyph_entries_[index];
+		size = ge.size;
 		if (p != nullptr)
 		{
-			if (kfont_input_)
+			if (distances_lzma_ != nullptr)
 			{
-				kfont_input_->seekg(distances_lzma_start_ + (index + 1) * sizeof(uint64_t) + distances_addr_[index],
-					std::ios_base::beg);
-				kfont_input_->read(p, size);
+				std::memcpy(p, distances_lzma_ + ge.offset, size);
 			}
 			else
 			{
-				memcpy(p, &distances_lzma_[distances_addr_[index]], size);
+				kfont_input_->seekg(distances_lzma_start_ + ge.offset, std::ios_base::beg);
+				kfont_input_->read(p, size);
 			}
 		}
 	}
 
+	size_t KFont::ResidentSize() const
+	{
+		size_t size = owned_char_entries_.capacity() * sizeof(owned_char_entries_[0])
+			+ owned_glyph_entries_.capacity() * sizeof(owned_glyph_entries_[0])
+			+ owned_distances_lzma_.capacity() * sizeof(owned_distances_lzma_[0]);
+		if (mapped_file_)
+		{
+			size += ResidentMappedSize(mapped_file_.get(), mapped_size_);
+		}
+		return size;
+	}
+
 	void KFont::CharSize(uint32_t size)
 	{
 		char_size_ = size;
@@ -413,68 +753,92 @@ namespace KlayGE
 
 	void KFont::SetLZMADistanceData(wchar_t ch, uint8_t const * p, uint32_t size, uint32_t adv, font_info const & fi)
 	{
-		int32_t ci;
+		this->MakeOwned();
+
+		char_entry ce;
+		ce.ch = static_cast<int32_t>(ch);
+		ce.advance = adv;
 		if (size > 0)
 		{
-			ci = static_cast<uint32_t>(distances_addr_.size() - 1);
-			uint32_t offset = static_cast<uint32_t>(distances_lzma_.size());
-			distances_addr_.back() = offset;
-			distances_addr_.push_back(offset + size);
-			distances_lzma_.insert(distances_lzma_.end(), p, p + size);
-
-			char_info_.push_back(fi);
-
-			BOOST_ASSERT(distances_addr_.size() - 1 == char_info_.size());
-			BOOST_ASSERT(distances_addr_.back() == distances_lzma_.size());
+			ce.index = static_cast<int32_t>(owned_glyph_entries_.size());
+
+			glyph_entry ge;
+			ge.info = fi;
+			ge.offset = static_cast<uint32_t>(owned_distances_lzma_.size());
+			ge.size = size;
+			owned_glyph_entries_.push_back(ge);
+			owned_distances_lzma_.insert(owned_distances_lzma_.end(), p, p + size);
 		}
 		else
 		{
-			ci = -1;
+			ce.index = -1;
 		}
-		char_index_advance_.emplace(ch, std::make_pair(ci, adv));
+		owned_char_entries_.push_back(ce);
+
+		sorted_ = false;
+		this->UseOwnedTables();
 	}
 
-	void KFont::Compact()
+	void KFont::MakeOwned()
 	{
-		std::vector<int32_t> chars;
-		for (auto const & cia : char_index_advance_)
+		if (mapped_file_ || kfont_input_)
 		{
-			chars.push_back(cia.first);
+			std::vector<char_entry> char_entries(char_entries_, char_entries_ + num_chars_);
+			std::vector<glyph_entry> glyph_entries(glyph_entries_, glyph_entries_ + num_glyphs_);
+			std::vector<uint8_t> distances;
+			for (uint32_t i = 0; i < num_glyphs_; ++ i)
+			{
+				auto& ge = glyph_entries[i];
+				uint32_t const offset = static_cast<uint32_t>(distances.size());
+				distances.resize(offset + ge.size);
+				this->GetLZMADistanceData(&distances[offset], ge.size, i);
+				ge.offset = offset;
+			}
+
+			owned_char_entries_.swap(char_entries);
+			owned_glyph_entries_.swap(glyph_entries);
+			owned_distances_lzma_.swap(distances);
+			mapped_file_.reset();
+			mapped_size_ = 0;
+			kfont_input_.reset();
+			this->UseOwnedTables();
 		}
-		std::sort(chars.begin(), chars.end());
+	}
 
-		std::unordered_map<int32_t, std::pair<int32_t, uint32_t>> new_char_index_advance;
-		std::vector<font_info> new_char_info;
-		std::vector<size_t> new_distances_addr;
-		std::vector<uint8_t> new_distances_lzma;
-		for (auto const & ch : chars)
+	void KFont::Compact()
+	{
+		if (sorted_)
 		{
-			std::pair<int32_t, uint32_t> const & ci = char_index_advance_[ch];
-			int32_t new_ci;
-			if (ci.first != -1)
-			{
-				new_ci = static_cast<int32_t>(new_char_info.size());
+			return;
+		}
 
-				uint32_t old_offset = ci.first;
-				new_char_info.push_back(char_info_[old_offset]);
-				new_distances_addr.push_back(new_distances_lzma.size());
+		// Keeps the first one of duplicated characters, then numbers the glyphs in code point order
+		std::vector<char_entry> char_entries = owned_char_entries_;
+		std::stable_sort(char_entries.begin(), char_entries.end(),
+			[](char_entry const & lhs, char_entry const & rhs) { return lhs.ch < rhs.ch; });
+		char_entries.erase(std::unique(char_entries.begin(), char_entries.end(),
+			[](char_entry const & lhs, char_entry const & rhs) { return lhs.ch == rhs.ch; }), char_entries.end());
 
-				size_t addr = distances_addr_[old_offset];
-				size_t len = distances_addr_[old_offset + 1] - distances_addr_[old_offset];
-				uint8_t const * p = &distances_lzma_[addr];
-				new_distances_lzma.insert(new_distances_lzma.end(), p, p + len);
-			}
-			else
+		std::vector<glyph_entry> glyph_entries;
+		std::vector<uint8_t> distances;
+		for (auto& ce : char_entries)
+		{
+			if (ce.index != -1)
 			{
-				new_ci = -1;
+				glyph_entry ge = owned_glyph_entries_[ce.index];
+				uint8_t const * p = &owned_distances_lzma_[ge.offset];
+				ge.offset = static_cast<uint32_t>(distances.size());
+				distances.insert(distances.end(), p, p + ge.size);
+
+				ce.index = static_cast<int32_t>(glyph_entries.size());
+				glyph_entries.push_back(ge);
 			}
-			new_char_index_advance.emplace(ch, std::make_pair(new_ci, ci.second));
 		}
-		new_distances_addr.push_back(new_distances_lzma.size());
 
-		char_index_advance_ = new_char_index_advance;
-		char_info_ = new_char_info;
-		distances_addr_ = new_distances_addr;
-		distances_lzma_ = new_distances_lzma;
+		owned_char_entries_.swap(char_entries);
+		owned_glyph_entries_.swap(glyph_entries);
+		owned_distances_lzma_.swap(distances);
+		sorted_ = true;
+		this->UseOwnedTables();
 	}
 }